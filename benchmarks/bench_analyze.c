@@ -0,0 +1,154 @@
+/**
+ * @file bench_analyze.c
+ * @brief ANALYZE time and estimate accuracy on growing tables
+ *
+ * A heap table of versioned rows (unique id, a skewed group, a score with
+ * 1000 values, a customer name with 50000) grows by a factor of four at
+ * a time. Each size is analyzed with the default sample, and the time is
+ * compared with a full scan that decodes every row, which is the least
+ * exact statistics would cost. The benchmark then reports how far the row
+ * count, the distinct counts and a few selectivity estimates are from the
+ * truth.
+ *
+ * Usage: bench_analyze [max rows]
+ */
+
+#include <monodb/core/data/analyze.h>
+#include <monodb/core/storage/buffer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_COLUMNS 4
+#define CUSTOMERS   50000
+
+static const catalog_column_def_t columns[NUM_COLUMNS] = {
+    {"id", TYPE_INT64, false},
+    {"grp", TYPE_INT32, false},
+    {"score", TYPE_FLOAT64, false},
+    {"customer", TYPE_TEXT, false},
+};
+
+/* Keeps decoded values observable */
+static volatile int64_t sink;
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Error of an estimate in percent */
+static double error_pct(double estimate, double truth) {
+    double diff = estimate > truth ? estimate - truth : truth - estimate;
+    return 100 * diff / truth;
+}
+
+/* Row i: grp 0 for half the rows, 1 for a quarter, 2..9 for the rest */
+static bool insert_rows(table_t* table, const record_schema_t* schema, uint32_t from,
+                        uint32_t to) {
+    record_value_t values[NUM_COLUMNS];
+    uint8_t        row[128];
+    char           customer[24];
+    for (uint32_t i = from; i < to; i++) {
+        uint32_t bucket = i % 100;
+        memset(values, 0, sizeof(values));
+        values[0].i    = i;
+        values[1].i    = bucket < 50 ? 0 : bucket < 75 ? 1 : 2 + bucket % 8;
+        values[2].f    = (double)(i * 7919u % 1000) / 10;
+        values[3].len  = (uint16_t)snprintf(customer, sizeof(customer), "customer-%u",
+                                            i * 7u % CUSTOMERS);
+        values[3].data = customer;
+        uint16_t len   = record_schema_encode(schema, values, row, sizeof(row));
+        if (!len || !table_insert(table, row, len, 1, NULL))
+            return false;
+    }
+    return true;
+}
+
+/* Decode every row; returns seconds */
+static double full_scan(table_t* table, const record_schema_t* schema) {
+    record_value_t values[NUM_COLUMNS];
+    int64_t        check = 0;
+    double         start = now_sec();
+    heap_scan_t*   scan  = heap_scan_begin(table_heap(table), HEAP_SCAN_BULKREAD);
+    const void*    data;
+    uint16_t       len;
+    while (heap_scan_next(scan, NULL, &data, &len)) {
+        if (record_schema_decode(schema, data, len, values))
+            check += values[1].i + values[3].len;
+    }
+    heap_scan_end(scan);
+    sink = check;
+    return now_sec() - start;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t max_rows = argc > 1 ? (uint32_t)atoi(argv[1]) : 6400000;
+
+    type_id_t types[NUM_COLUMNS];
+    for (int c = 0; c < NUM_COLUMNS; c++)
+        types[c] = columns[c].type;
+
+    const char*       path    = "./bench_analyze.db";
+    buffer_pool_t*    pool    = buffer_pool_create(1024);
+    record_schema_t*  schema  = record_schema_create(types, NULL, NUM_COLUMNS);
+    catalog_t*        catalog = catalog_create();
+    catalog_reader_t* reader  = catalog ? catalog_reader_open(catalog) : NULL;
+    remove(path);
+    table_t* table = pool ? table_open(pool, path) : NULL;
+    if (!table || !schema || !reader ||
+        !catalog_create_table(catalog, "orders", columns, NUM_COLUMNS, NULL)) {
+        fprintf(stderr, "Failed to create the table\n");
+        return 1;
+    }
+
+    printf("MonoDB ANALYZE benchmark: %d columns, sample of %d rows, %d buckets\n\n",
+           NUM_COLUMNS, ANALYZE_DEFAULT_SAMPLE, ANALYZE_DEFAULT_TARGET);
+    printf("rows       pages    analyze ms  full scan ms  rows err%%  ndv err%% id/score/customer"
+           "  grp=0 err%%  id range err%%\n");
+
+    uint32_t rows = 0;
+    for (uint32_t target = 25000; target <= max_rows; target *= 4) {
+        if (!insert_rows(table, schema, rows, target)) {
+            fprintf(stderr, "Failed to insert rows\n");
+            return 1;
+        }
+        rows = target;
+
+        double start   = now_sec();
+        bool   ok      = analyze_table(table, schema, catalog, "orders", NULL);
+        double analyze = now_sec() - start;
+        double scan    = full_scan(table, schema);
+
+        const catalog_table_t*       entry = catalog_find_table(catalog_enter(reader), "orders");
+        const catalog_table_stats_t* stats = ok && entry ? entry->stats : NULL;
+        if (!stats) {
+            fprintf(stderr, "ANALYZE failed\n");
+            return 1;
+        }
+
+        /* Truths: half the rows in group 0, the middle half of the ids */
+        int32_t zero      = 0;
+        int64_t lo        = rows / 4;
+        int64_t hi        = rows / 4 * 3 - 1;
+        double  customers = rows < CUSTOMERS ? rows : CUSTOMERS;
+        double  eq        = analyze_estimate_eq(&stats->columns[1], TYPE_INT32, &zero, 4);
+        double  range = analyze_estimate_range(&stats->columns[0], TYPE_INT64, &lo, 8, &hi, 8);
+        printf("%-9u  %-7u  %10.1f  %12.1f  %9.1f  %8.1f/%.1f/%.1f  %18.1f  %14.1f\n", rows,
+               stats->pages, analyze * 1e3, scan * 1e3, error_pct(stats->rows, rows),
+               error_pct(stats->columns[0].ndv, rows), error_pct(stats->columns[2].ndv, 1000),
+               error_pct(stats->columns[3].ndv, customers), error_pct(eq, 0.5),
+               error_pct(range, 0.5));
+        catalog_leave(reader);
+    }
+
+    catalog_reader_close(reader);
+    catalog_destroy(catalog);
+    table_close(table);
+    record_schema_destroy(schema);
+    buffer_pool_destroy(pool);
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file bench_art.c
+ * @brief Point lookups in an adaptive radix tree versus the page-based indexes
+ *
+ * The same keys are loaded in a random order into an ART, an extendible
+ * hash index and a B+tree, the latter two in a buffer pool large enough to
+ * hold them, then each is probed with random point lookups. The page-based
+ * indexes pay for a buffer pool lookup, a page latch and a search within a
+ * slotted page per page they touch even when every page is cached; the ART
+ * follows one pointer per key byte it has not compressed away and takes no
+ * locks. Load rate, memory and lookup latency are reported for each.
+ *
+ * Usage: bench_art [records] [lookups]
+ */
+
+#include <monodb/core/data/art.h>
+#include <monodb/core/data/btree.h>
+#include <monodb/core/data/hash_index.h>
+#include <monodb/core/storage/buffer.h>
+#include <monodb/core/storage/disk_manager.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POOL_FRAMES 65536
+
+typedef enum { KIND_BTREE, KIND_HASH, KIND_ART } kind_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* 8-byte hashed key */
+static void make_key(uint8_t* key, uint64_t id) {
+    uint64_t h = id * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 29;
+    for (int i = 0; i < 8; i++)
+        key[i] = (uint8_t)(h >> (56 - 8 * i));
+}
+
+static bool structure_insert(kind_t kind, void* s, const uint8_t* key, uint64_t value) {
+    switch (kind) {
+    case KIND_BTREE:
+        return btree_insert((btree_t*)s, key, 8, &value, sizeof(value));
+    case KIND_HASH:
+        return hash_index_insert((hash_index_t*)s, key, 8, &value, sizeof(value));
+    default:
+        return art_insert((art_t*)s, key, 8, value);
+    }
+}
+
+static bool structure_get(kind_t kind, void* s, const uint8_t* key, uint64_t* value) {
+    switch (kind) {
+    case KIND_BTREE:
+        return btree_get((btree_t*)s, key, 8, value, sizeof(*value), NULL);
+    case KIND_HASH:
+        return hash_index_get((hash_index_t*)s, key, 8, value, sizeof(*value), NULL);
+    default:
+        return art_get((art_t*)s, key, 8, value);
+    }
+}
+
+/* Time random lookups; the first pass warms caches and is not reported */
+static void measure(const char* name, kind_t kind, void* s, uint64_t records, uint32_t lookups,
+                    double load, double memory_mb) {
+    uint8_t  key[8];
+    uint64_t value;
+    uint64_t seed   = 0x9E3779B97F4A7C15ull;
+    uint64_t missed = 0;
+    double   elapsed = 0;
+
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        double start = now_sec();
+        for (uint32_t i = 0; i < lookups; i++) {
+            make_key(key, next_random(&seed) % records);
+            if (!structure_get(kind, s, key, &value))
+                missed++;
+        }
+        elapsed = now_sec() - start;
+    }
+
+    printf("%-10s %10.0f   %9.1f   %9.1f\n", name, records / load, memory_mb,
+           elapsed * 1e9 / lookups);
+    if (missed > 0)
+        printf("  (%llu lookups missed)\n", (unsigned long long)missed);
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t records = argc > 1 ? (uint64_t)atoll(argv[1]) : 1000000;
+    uint32_t lookups = argc > 2 ? (uint32_t)atoi(argv[2]) : 1000000;
+
+    const char* tree_path = "./bench_art.btree";
+    const char* hash_path = "./bench_art.hash";
+    remove(tree_path);
+    remove(hash_path);
+
+    printf("MonoDB ART benchmark: %llu records, %u lookups, 8-byte keys\n\n",
+           (unsigned long long)records, lookups);
+
+    buffer_pool_t* pool = buffer_pool_create(POOL_FRAMES);
+    btree_t*       tree = pool ? btree_open(pool, tree_path) : NULL;
+    hash_index_t*  hash = tree ? hash_index_open(pool, hash_path) : NULL;
+    art_t*         art  = hash ? art_create() : NULL;
+    if (!art) {
+        fprintf(stderr, "Failed to create the indexes\n");
+        return 1;
+    }
+
+    /* Load all three in the same random order */
+    uint64_t* order = (uint64_t*)malloc(records * sizeof(uint64_t));
+    uint64_t  seed  = 0x2545F4914F6CDD1Dull;
+    if (!order)
+        return 1;
+    for (uint64_t i = 0; i < records; i++)
+        order[i] = i;
+    for (uint64_t i = records - 1; i > 0; i--) {
+        uint64_t j = next_random(&seed) % (i + 1);
+        uint64_t t = order[i];
+        order[i]   = order[j];
+        order[j]   = t;
+    }
+
+    uint8_t key[8];
+    double  loads[3];
+    void*   structures[3] = {tree, hash, art};
+    for (int k = 0; k < 3; k++) {
+        double start = now_sec();
+        for (uint64_t i = 0; i < records; i++) {
+            make_key(key, order[i]);
+            structure_insert((kind_t)k, structures[k], key, order[i]);
+        }
+        loads[k] = now_sec() - start;
+    }
+    free(order);
+
+    art_stats_t stats;
+    art_get_stats(art, &stats);
+    printf("ART nodes: %llu x4, %llu x16, %llu x48, %llu x256\n\n",
+           (unsigned long long)stats.nodes[0], (unsigned long long)stats.nodes[1],
+           (unsigned long long)stats.nodes[2], (unsigned long long)stats.nodes[3]);
+
+    const double mb = 1024.0 * 1024.0;
+    printf("structure   inserts/s   memory MB   lookup ns\n");
+    measure("btree", KIND_BTREE, tree, records, lookups, loads[0],
+            (double)disk_manager_num_pages(btree_file(tree)) * PAGE_SIZE / mb);
+    measure("hash", KIND_HASH, hash, records, lookups, loads[1],
+            (double)disk_manager_num_pages(hash_index_file(hash)) * PAGE_SIZE / mb);
+    measure("art", KIND_ART, art, records, lookups, loads[2], (double)stats.memory / mb);
+
+    art_destroy(art);
+    btree_close(tree);
+    hash_index_close(hash);
+    buffer_pool_destroy(pool);
+    remove(tree_path);
+    remove(hash_path);
+    return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file bench_bloom.c
+ * @brief Lookups of absent keys with and without Bloom filters
+ *
+ * A hash index and a B+tree are loaded with the same keys, then probed
+ * with keys neither holds. The B+tree has no filter, so every such lookup
+ * descends to a leaf and searches it; the hash index probes its bucket's
+ * filter first and reads the bucket page only on a false positive. Both
+ * run once with every page cached and once through a pool too small to
+ * hold them, where a page read is a disk read. Lookup latency, pages read
+ * per lookup and the false positive rate are reported, along with the
+ * cost of a bare filter probe.
+ *
+ * Usage: bench_bloom [records] [lookups] [small pool frames]
+ */
+
+#include <monodb/core/data/bloom.h>
+#include <monodb/core/data/btree.h>
+#include <monodb/core/data/hash_index.h>
+#include <monodb/core/storage/buffer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POOL_FRAMES 65536
+#define VALUE_SIZE  16
+
+typedef enum { KIND_BTREE, KIND_HASH } kind_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* 8-byte hashed key; ids at and above the record count are absent */
+static void make_key(uint8_t* key, uint64_t id) {
+    uint64_t h = id * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 29;
+    for (int i = 0; i < 8; i++)
+        key[i] = (uint8_t)(h >> (56 - 8 * i));
+}
+
+static uint64_t pages_read(buffer_pool_t* pool) {
+    buffer_pool_stats_t stats;
+    buffer_pool_get_stats(pool, &stats);
+    return stats.hits[BUFFER_ACCESS_NORMAL] + stats.misses[BUFFER_ACCESS_NORMAL];
+}
+
+/* Time lookups of absent keys; the first pass warms the pool and is not reported */
+static void measure(const char* name, kind_t kind, void* s, buffer_pool_t* pool, uint64_t records,
+                    uint32_t lookups) {
+    uint8_t  key[8];
+    uint8_t  value[VALUE_SIZE];
+    uint64_t found = 0, reads = 0;
+    double   elapsed = 0;
+
+    hash_index_stats_t before, after;
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        if (kind == KIND_HASH)
+            hash_index_get_stats((hash_index_t*)s, &before);
+        uint64_t reads_before = pages_read(pool);
+        double   start        = now_sec();
+        for (uint32_t i = 0; i < lookups; i++) {
+            make_key(key, records + i);
+            found += kind == KIND_BTREE
+                         ? btree_get((btree_t*)s, key, 8, value, VALUE_SIZE, NULL)
+                         : hash_index_get((hash_index_t*)s, key, 8, value, VALUE_SIZE, NULL);
+        }
+        elapsed = now_sec() - start;
+        reads   = pages_read(pool) - reads_before;
+    }
+
+    char fpr[16] = "-";
+    if (kind == KIND_HASH) {
+        hash_index_get_stats((hash_index_t*)s, &after);
+        uint64_t negatives = after.filter_negatives - before.filter_negatives;
+        uint64_t positives = after.filter_false_positives - before.filter_false_positives;
+        if (negatives + positives > 0)
+            snprintf(fpr, sizeof(fpr), "%.3f%%", 100.0 * positives / (negatives + positives));
+    }
+    printf("%-20s %9.1f   %9.3f   %9s\n", name, elapsed * 1e9 / lookups, (double)reads / lookups,
+           fpr);
+    if (found > 0)
+        printf("  (%llu absent keys found)\n", (unsigned long long)found);
+}
+
+/* Time bare probes of a filter holding records keys */
+static void measure_filter(uint64_t records, uint32_t lookups) {
+    bloom_t* filter = bloom_create((uint32_t)records, 10);
+    if (!filter)
+        return;
+    uint8_t key[8];
+    for (uint64_t i = 0; i < records; i++) {
+        make_key(key, i);
+        bloom_add(filter, bloom_hash(key, sizeof(key)));
+    }
+
+    uint64_t hits  = 0;
+    double   start = now_sec();
+    for (uint32_t i = 0; i < lookups; i++) {
+        make_key(key, records + i);
+        hits += bloom_may_contain(filter, bloom_hash(key, sizeof(key)));
+    }
+    double elapsed = now_sec() - start;
+    printf("%-20s %9.1f   %9.3f   %8.3f%%\n", "filter alone", elapsed * 1e9 / lookups, 0.0,
+           100.0 * hits / lookups);
+    printf("  (%.1f MB for %llu keys at 10 bits per key)\n",
+           (double)bloom_memory(filter) / (1024.0 * 1024.0), (unsigned long long)records);
+    bloom_destroy(filter);
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t records = argc > 1 ? (uint64_t)atoll(argv[1]) : 1000000;
+    uint32_t lookups = argc > 2 ? (uint32_t)atoi(argv[2]) : 1000000;
+    uint32_t frames  = argc > 3 ? (uint32_t)atoi(argv[3]) : 1024;
+
+    const char* tree_path = "./bench_bloom.btree";
+    const char* hash_path = "./bench_bloom.hash";
+    remove(tree_path);
+    remove(hash_path);
+
+    printf("MonoDB Bloom filter benchmark: %llu records, %u lookups of absent keys\n\n",
+           (unsigned long long)records, lookups);
+
+    buffer_pool_t* pool = buffer_pool_create(POOL_FRAMES);
+    btree_t*       tree = pool ? btree_open(pool, tree_path) : NULL;
+    hash_index_t*  hash = tree ? hash_index_open(pool, hash_path) : NULL;
+    if (!hash) {
+        fprintf(stderr, "Failed to open the index files\n");
+        return 1;
+    }
+
+    uint8_t key[8];
+    uint8_t value[VALUE_SIZE];
+    memset(value, 'v', sizeof(value));
+    for (uint64_t i = 0; i < records; i++) {
+        make_key(key, i);
+        btree_insert(tree, key, 8, value, VALUE_SIZE);
+        hash_index_insert(hash, key, 8, value, VALUE_SIZE);
+    }
+
+    hash_index_stats_t stats;
+    hash_index_get_stats(hash, &stats);
+    printf("%u buckets, %u with filters, %.1f MB of filters\n\n", stats.buckets, stats.filters,
+           (double)stats.filter_memory / (1024.0 * 1024.0));
+
+    printf("structure            lookup ns   pages/get   false pos\n");
+    measure("btree (cached)", KIND_BTREE, tree, pool, records, lookups);
+    measure("hash (cached)", KIND_HASH, hash, pool, records, lookups);
+    measure_filter(records, lookups);
+
+    /* Reopen both through a small pool; the hash index rebuilds its filters as it reads buckets */
+    btree_close(tree);
+    hash_index_close(hash);
+    buffer_pool_destroy(pool);
+    pool = buffer_pool_create(frames);
+    tree = pool ? btree_open(pool, tree_path) : NULL;
+    hash = tree ? hash_index_open(pool, hash_path) : NULL;
+    if (hash) {
+        char name[32];
+        for (uint64_t i = 0; i < records; i += 7) {
+            make_key(key, i);
+            hash_index_get(hash, key, 8, NULL, 0, NULL);
+        }
+        snprintf(name, sizeof(name), "btree (%u frames)", frames);
+        measure(name, KIND_BTREE, tree, pool, records, lookups / 4);
+        snprintf(name, sizeof(name), "hash (%u frames)", frames);
+        measure(name, KIND_HASH, hash, pool, records, lookups / 4);
+    }
+
+    btree_close(tree);
+    hash_index_close(hash);
+    buffer_pool_destroy(pool);
+    remove(tree_path);
+    remove(hash_path);
+    return 0;
+}
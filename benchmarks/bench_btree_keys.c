@@ -0,0 +1,156 @@
+/**
+ * @file bench_btree_keys.c
+ * @brief B+tree fanout and point lookup latency for long, structured keys
+ *
+ * Keys in multi-tenant schemas repeat long prefixes (tenant/region/user...),
+ * so leaves that store whole keys hold few entries and separators copied
+ * from them make inner nodes wide. This loads a tree with such keys, in
+ * random order, and reports its height, leaf count and size, then the
+ * latency of random point lookups with the tree cached. Short hashed keys,
+ * which share no prefixes, are measured for comparison.
+ *
+ * Usage: bench_btree_keys [records] [lookups]
+ */
+
+#include <monodb/core/data/btree.h>
+#include <monodb/core/storage/buffer.h>
+#include <monodb/core/storage/disk_manager.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POOL_FRAMES 32768
+#define VALUE_SIZE  16
+#define MAX_KEY     64
+
+typedef uint16_t (*key_fn)(uint8_t* key, uint64_t id);
+
+static const char* regions[] = {"eu-west-1", "eu-central-1", "us-east-1", "us-west-2",
+                                "ap-south-1"};
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* tenant/region/user/device: about 50 bytes, most of them shared with neighbours */
+static uint16_t hierarchical_key(uint8_t* key, uint64_t id) {
+    return (uint16_t)snprintf((char*)key, MAX_KEY, "tenant-%04u/region-%s/user-%010u/device-%02u",
+                              (unsigned)(id % 64), regions[(id / 64) % 5],
+                              (unsigned)(id / 320), (unsigned)(id % 7));
+}
+
+/* 8-byte hashed key: no common prefixes beyond what the fanout implies */
+static uint16_t hashed_key(uint8_t* key, uint64_t id) {
+    uint64_t h = id * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 29;
+    for (int i = 0; i < 8; i++)
+        key[i] = (uint8_t)(h >> (56 - 8 * i));
+    return 8;
+}
+
+static void run(buffer_pool_t* pool, const char* name, key_fn make_key, uint64_t records,
+                uint32_t lookups) {
+    const char* path = "./bench_btree_keys.db";
+    remove(path);
+    btree_t* tree = btree_open(pool, path);
+    if (!tree) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return;
+    }
+
+    /* Insert in a random order */
+    uint64_t* order = (uint64_t*)malloc(records * sizeof(uint64_t));
+    uint64_t  seed  = 0x2545F4914F6CDD1Dull;
+    if (!order) {
+        btree_close(tree);
+        return;
+    }
+    for (uint64_t i = 0; i < records; i++)
+        order[i] = i;
+    for (uint64_t i = records - 1; i > 0; i--) {
+        uint64_t j = next_random(&seed) % (i + 1);
+        uint64_t t = order[i];
+        order[i]   = order[j];
+        order[j]   = t;
+    }
+
+    uint8_t  key[MAX_KEY];
+    uint8_t  value[VALUE_SIZE];
+    uint64_t key_bytes = 0;
+    memset(value, 'v', sizeof(value));
+
+    double start = now_sec();
+    for (uint64_t i = 0; i < records; i++) {
+        uint16_t len = make_key(key, order[i]);
+        key_bytes += len;
+        btree_insert(tree, key, len, value, sizeof(value));
+    }
+    double load = now_sec() - start;
+    free(order);
+
+    btree_scan_t* scan = btree_scan_begin(tree, NULL, 0, NULL, 0);
+    const void*   k;
+    const void*   v;
+    uint16_t      key_len, value_len;
+    uint64_t      count = 0;
+    while (btree_scan_next(scan, &k, &key_len, &v, &value_len))
+        count++;
+    uint32_t leaves = btree_scan_leaves_read(scan);
+    btree_scan_end(scan);
+
+    /* Warm up, then time random lookups against the cached tree */
+    uint64_t misses = 0;
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        start = now_sec();
+        for (uint32_t i = 0; i < lookups; i++) {
+            uint16_t len = make_key(key, next_random(&seed) % records);
+            if (!btree_get(tree, key, len, value, sizeof(value), NULL))
+                misses++;
+        }
+    }
+    double lookup = now_sec() - start;
+
+    uint32_t pages = disk_manager_num_pages(btree_file(tree));
+    printf("%-13s %8.2f   %6u   %7u   %7.1f   %7.1f   %9.1f   %11.0f\n", name,
+           (double)key_bytes / (double)records, btree_height(tree), leaves,
+           (double)count / leaves, (double)pages * PAGE_SIZE / (1024.0 * 1024.0),
+           lookup * 1e9 / lookups, records / load);
+    if (count != records || misses > 0)
+        printf("  (%llu of %llu keys scanned, %llu lookups missed)\n", (unsigned long long)count,
+               (unsigned long long)records, (unsigned long long)misses);
+
+    btree_close(tree);
+    remove(path);
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t records = argc > 1 ? (uint64_t)atoll(argv[1]) : 500000;
+    uint32_t lookups = argc > 2 ? (uint32_t)atoi(argv[2]) : 1000000;
+
+    printf("MonoDB B+tree key layout benchmark: %llu records, %u lookups, %d-byte values\n\n",
+           (unsigned long long)records, lookups, VALUE_SIZE);
+
+    buffer_pool_t* pool = buffer_pool_create(POOL_FRAMES);
+    if (!pool) {
+        fprintf(stderr, "Failed to create buffer pool\n");
+        return 1;
+    }
+
+    printf("keys          key bytes   height    leaves   per leaf   size MB   lookup ns   "
+           "inserts/s\n");
+    run(pool, "hierarchical", hierarchical_key, records, lookups);
+    run(pool, "hashed", hashed_key, records, lookups);
+
+    buffer_pool_destroy(pool);
+    return 0;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file bench_buffer.c
+ * @brief OLTP buffer hit ratio while a concurrent full table scan runs
+ *
+ * An OLTP thread reads random pages of a small hot table while a second
+ * thread repeatedly scans a table several times larger than the pool. The
+ * run is repeated with the scan going through the shared clock sweep and
+ * through a BUFFER_ACCESS_BULKREAD ring. The OLTP thread spends a little
+ * simulated work between accesses, as a real transaction would, so its
+ * pages age under the clock sweep. OLTP misses are measured as disk reads
+ * on the hot table's file.
+ *
+ * Usage: bench_buffer [pool_frames] [scan_pages] [scan_passes]
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/storage/buffer.h>
+#include <monodb/core/storage/disk_manager.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* The hot set fills three quarters of the pool */
+#define HOT_FRACTION 0.75
+
+/* Simulated per-transaction work between page accesses, in seconds */
+#define OLTP_THINK_TIME 20e-6
+
+static uint32_t hot_pages;
+
+typedef struct {
+    buffer_pool_t*   pool;
+    disk_manager_t*  file;
+    uint32_t         num_pages;
+    uint32_t         passes;
+    bool             use_ring;
+    _Atomic bool*    done;
+} scan_args_t;
+
+typedef struct {
+    buffer_pool_t*  pool;
+    disk_manager_t* file;
+    _Atomic bool*   done;
+    uint64_t        accesses;
+} oltp_args_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Create a file of num_pages initialized pages */
+static disk_manager_t* create_table(buffer_pool_t* pool, const char* path, uint32_t num_pages) {
+    remove(path);
+    disk_manager_t* dm = disk_manager_open(path);
+    if (!dm)
+        return NULL;
+
+    buffer_strategy_t* load = buffer_strategy_create(pool, BUFFER_ACCESS_BULKWRITE);
+    for (uint32_t i = 0; i < num_pages; i++) {
+        page_id_t   page_id;
+        buffer_id_t buf = buffer_extend(pool, dm, load, &page_id);
+        if (buf < 0)
+            break;
+        buffer_lock(pool, buf, BUFFER_LOCK_EXCLUSIVE);
+        page_init(buffer_page(pool, buf), page_id, PAGE_TYPE_HEAP, 0);
+        buffer_mark_dirty(pool, buf);
+        buffer_unlock(pool, buf, BUFFER_LOCK_EXCLUSIVE);
+        buffer_release(pool, buf);
+    }
+    buffer_strategy_free(load);
+    buffer_drop_file(pool, dm);
+    return dm;
+}
+
+/* Busy-wait to model query work done between buffer accesses */
+static void think(void) {
+    double until = now_sec() + OLTP_THINK_TIME;
+    while (now_sec() < until) {
+    }
+}
+
+static void* scan_thread(void* arg) {
+    scan_args_t*       args     = (scan_args_t*)arg;
+    buffer_strategy_t* strategy = NULL;
+    if (args->use_ring)
+        strategy = buffer_strategy_create(args->pool, BUFFER_ACCESS_BULKREAD);
+
+    for (uint32_t pass = 0; pass < args->passes; pass++) {
+        for (uint32_t i = 0; i < args->num_pages; i++) {
+            buffer_id_t buf = buffer_read(args->pool, args->file, i, strategy);
+            if (buf >= 0)
+                buffer_release(args->pool, buf);
+        }
+    }
+
+    buffer_strategy_free(strategy);
+    atomic_store(args->done, true);
+    return NULL;
+}
+
+static void* oltp_thread(void* arg) {
+    oltp_args_t* args = (oltp_args_t*)arg;
+    uint64_t     seed = 0x9E3779B97F4A7C15ULL;
+
+    while (!atomic_load(args->done)) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        buffer_id_t buf = buffer_read(args->pool, args->file, (page_id_t)(seed % hot_pages), NULL);
+        if (buf >= 0)
+            buffer_release(args->pool, buf);
+        args->accesses++;
+        think();
+    }
+    return NULL;
+}
+
+static void run(disk_manager_t* hot, disk_manager_t* big, uint32_t frames, uint32_t scan_pages,
+                uint32_t passes, bool use_ring) {
+    buffer_pool_t* pool = buffer_pool_create(frames);
+
+    /* Warm the hot set */
+    for (int round = 0; round < 4; round++) {
+        for (page_id_t i = 0; i < hot_pages; i++) {
+            buffer_id_t buf = buffer_read(pool, hot, i, NULL);
+            if (buf >= 0)
+                buffer_release(pool, buf);
+        }
+    }
+
+    disk_manager_stats_t before, after;
+    disk_manager_get_stats(hot, &before);
+
+    _Atomic bool  done = false;
+    scan_args_t   scan = {pool, big, scan_pages, passes, use_ring, &done};
+    oltp_args_t   oltp = {pool, hot, &done, 0};
+    sync_thread_t scan_tid, oltp_tid;
+
+    double start = now_sec();
+    sync_thread_create(&oltp_tid, oltp_thread, &oltp);
+    sync_thread_create(&scan_tid, scan_thread, &scan);
+    sync_thread_join(scan_tid);
+    sync_thread_join(oltp_tid);
+    double elapsed = now_sec() - start;
+
+    disk_manager_get_stats(hot, &after);
+    uint64_t misses = after.pages_read - before.pages_read;
+
+    buffer_pool_stats_t stats;
+    buffer_pool_get_stats(pool, &stats);
+
+    printf("%-10s scan %.2fs  oltp accesses %10llu  oltp hit ratio %6.2f%%  ring reuses %llu\n",
+           use_ring ? "ring" : "clock", elapsed, (unsigned long long)oltp.accesses,
+           oltp.accesses ? 100.0 * (double)(oltp.accesses - misses) / (double)oltp.accesses : 0.0,
+           (unsigned long long)stats.ring_reuses);
+
+    buffer_pool_destroy(pool);
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t frames     = argc > 1 ? (uint32_t)atoi(argv[1]) : 1024;
+    uint32_t scan_pages = argc > 2 ? (uint32_t)atoi(argv[2]) : 8192;
+    uint32_t passes     = argc > 3 ? (uint32_t)atoi(argv[3]) : 3;
+
+    hot_pages = (uint32_t)(frames * HOT_FRACTION);
+
+    printf("MonoDB buffer benchmark: %u frames, hot set %u pages, scan %u pages x %u passes\n",
+           frames, hot_pages, scan_pages, passes);
+
+    buffer_pool_t*  setup = buffer_pool_create(frames);
+    disk_manager_t* hot   = create_table(setup, "./bench_buffer_hot.db", hot_pages);
+    disk_manager_t* big   = create_table(setup, "./bench_buffer_big.db", scan_pages);
+    buffer_pool_destroy(setup);
+
+    if (!hot || !big) {
+        fprintf(stderr, "Failed to create benchmark tables\n");
+        return 1;
+    }
+
+    run(hot, big, frames, scan_pages, passes, false);
+    run(hot, big, frames, scan_pages, passes, true);
+
+    disk_manager_close(hot);
+    disk_manager_close(big);
+    remove("./bench_buffer_hot.db");
+    remove("./bench_buffer_big.db");
+    return 0;
+}
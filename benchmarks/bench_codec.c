@@ -0,0 +1,169 @@
+/**
+ * @file bench_codec.c
+ * @brief Column codecs: compression, decoding speed and predicates on compressed data
+ *
+ * Several typical integer columns (timestamps, small-range measurements,
+ * status codes in runs, a constant, random identifiers) are split into
+ * blocks of 1024 values and each block encoded with the codec
+ * codec_choose() picks. For each column the benchmark reports the
+ * compressed size, the time to decode every block into a vector, and the
+ * time to evaluate a range predicate, both on the compressed stream with
+ * codec_select() and by decoding first and filtering the vector.
+ *
+ * Usage: bench_codec [values] [passes]
+ */
+
+#include <monodb/core/storage/codec.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BLOCK_VALUES 1024
+#define NUM_COLUMNS  5
+
+static const char* const names[NUM_COLUMNS]  = {"timestamps", "measurements", "status runs",
+                                                "constant", "random ids"};
+static const char* const codecs[CODEC_COUNT] = {"plain", "constant", "rle", "delta", "for"};
+
+/* Keeps decoded values observable */
+static volatile uint64_t sink;
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void make_column(int c, uint64_t* values, uint32_t n) {
+    uint64_t state = 0x9E3779B97F4A7C15ull + (uint64_t)c;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t r = next_random(&state);
+        switch (c) {
+        case 0:
+            values[i] = 1700000000000ull + (uint64_t)i * 250 + r % 16;
+            break;
+        case 1:
+            values[i] = (uint64_t)((int64_t)(r % 4000) - 2000);
+            break;
+        case 2:
+            values[i] = (i / 300 + r % 2 * (r % 97 == 0)) % 5;
+            break;
+        case 3:
+            values[i] = 7;
+            break;
+        default:
+            values[i] = r;
+            break;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t n      = argc > 1 ? (uint32_t)atoi(argv[1]) : 1 << 20;
+    uint32_t passes = argc > 2 ? (uint32_t)atoi(argv[2]) : 20;
+    n               = (n + BLOCK_VALUES - 1) / BLOCK_VALUES * BLOCK_VALUES;
+
+    uint32_t  blocks  = n / BLOCK_VALUES;
+    uint64_t* values  = (uint64_t*)malloc((size_t)n * sizeof(uint64_t));
+    uint8_t*  streams = (uint8_t*)malloc((size_t)blocks * codec_bound(BLOCK_VALUES));
+    size_t*   offsets = (size_t*)malloc(((size_t)blocks + 1) * sizeof(size_t));
+    uint64_t  out[BLOCK_VALUES];
+    uint32_t  sel[BLOCK_VALUES];
+    if (!values || !streams || !offsets) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    const char* unpack = codec_simd_enabled() ? "AVX2" : "scalar";
+    printf("MonoDB codec benchmark: %u values per column, blocks of %d, %u passes, "
+           "%s unpacking\n\n",
+           n, BLOCK_VALUES, passes, unpack);
+    printf("column         codecs            bits/value   decode ns   select ns   "
+           "decode+filter ns   selected\n");
+
+    for (int c = 0; c < NUM_COLUMNS; c++) {
+        bool is_signed = c == 1;
+        make_column(c, values, n);
+
+        /* Encode each block with the codec its sample suggests */
+        uint32_t used[CODEC_COUNT] = {0};
+        offsets[0]                 = 0;
+        for (uint32_t b = 0; b < blocks; b++) {
+            const uint64_t* v    = values + (size_t)b * BLOCK_VALUES;
+            codec_kind_t    kind = codec_choose(v, BLOCK_VALUES, is_signed);
+            offsets[b + 1] = offsets[b] + codec_encode(v, BLOCK_VALUES, is_signed, kind,
+                                                       streams + offsets[b]);
+            used[kind]++;
+        }
+        char mix[64] = "";
+        for (int k = 0; k < CODEC_COUNT; k++) {
+            if (used[k])
+                snprintf(mix + strlen(mix), sizeof(mix) - strlen(mix), "%s%s",
+                         mix[0] ? "+" : "", codecs[k]);
+        }
+
+        /* A range holding roughly a tenth of the values */
+        uint64_t lo = values[n / 2], hi = values[n / 2];
+        for (uint32_t i = n / 2; i < n / 2 + 64; i++) {
+            if (is_signed ? (int64_t)values[i] < (int64_t)lo : values[i] < lo)
+                lo = values[i];
+        }
+        hi = is_signed ? (uint64_t)((int64_t)lo + 400) : lo + (c == 0 ? n * 25ull : 400);
+        if (c == 2 || c == 3)
+            hi = lo;
+
+        double   t_decode = 0, t_select = 0, t_filter = 0;
+        uint64_t check = 0, selected[2] = {0, 0};
+        for (uint32_t pass = 0; pass < passes; pass++) {
+            double start = now_sec();
+            for (uint32_t b = 0; b < blocks; b++) {
+                codec_decode(streams + offsets[b], offsets[b + 1] - offsets[b], out,
+                             BLOCK_VALUES);
+                check += out[b % BLOCK_VALUES];
+            }
+            t_decode += now_sec() - start;
+
+            start = now_sec();
+            for (uint32_t b = 0; b < blocks; b++)
+                selected[0] += codec_select(streams + offsets[b], offsets[b + 1] - offsets[b],
+                                            BLOCK_VALUES, is_signed, lo, hi, sel);
+            t_select += now_sec() - start;
+
+            /* Decode, then filter the vector */
+            start = now_sec();
+            for (uint32_t b = 0; b < blocks; b++) {
+                codec_decode(streams + offsets[b], offsets[b + 1] - offsets[b], out,
+                             BLOCK_VALUES);
+                uint32_t k = 0;
+                for (uint32_t i = 0; i < BLOCK_VALUES; i++) {
+                    sel[k] = i;
+                    k += out[i] - lo <= hi - lo;
+                }
+                selected[1] += k;
+            }
+            t_filter += now_sec() - start;
+        }
+
+        double per = (double)n * passes / 1e9;
+        printf("%-14s %-17s %10.2f   %9.3f   %9.3f   %16.3f   %7.1f%%\n", names[c], mix,
+               8.0 * offsets[blocks] / n, t_decode / per, t_select / per, t_filter / per,
+               100.0 * selected[0] / ((double)n * passes));
+        if (selected[0] != selected[1])
+            printf("  (select disagrees: %llu vs %llu)\n", (unsigned long long)selected[0],
+                   (unsigned long long)selected[1]);
+        sink = check;
+    }
+
+    free(values);
+    free(streams);
+    free(offsets);
+    return 0;
+}
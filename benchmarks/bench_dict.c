@@ -0,0 +1,190 @@
+/**
+ * @file bench_dict.c
+ * @brief Dictionary-encoded string columns versus plain strings
+ *
+ * Rows of (id, status, country, plan, note) are encoded twice: once with
+ * every string stored inline, once with status, country and plan
+ * dictionary-encoded. For each, the benchmark reports the bytes per row
+ * (dictionaries included), a scan filtering status = 'suspended', a
+ * GROUP BY country counting rows, and materializing the three strings of
+ * every row for output. The plain scan compares bytes and groups through
+ * a hash table of strings; the encoded one compares codes and indexes an
+ * array by code.
+ *
+ * Usage: bench_dict [rows] [passes]
+ */
+
+#include <monodb/core/data/record.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_COLUMNS   5
+#define MAX_ROW       128
+#define NUM_COUNTRIES 64
+
+/* Slots of the string hash table of the plain GROUP BY */
+#define GROUP_SLOTS 256
+
+static const char* const statuses[] = {"active", "suspended", "closed", "pending", "trial"};
+static const char* const plans[]    = {"free", "starter", "business", "enterprise"};
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void set_text(record_value_t* v, const char* s) {
+    memset(v, 0, sizeof(*v));
+    v->data = s;
+    v->len  = (uint16_t)strlen(s);
+}
+
+typedef struct {
+    const void* data;
+    uint16_t    len;
+    uint64_t    count;
+} group_t;
+
+/* GROUP BY on the bytes of a column: hash the string, probe, compare */
+static uint32_t group_plain(const record_layout_t* layout, const uint8_t* rows, uint32_t n,
+                            uint16_t col, group_t* groups) {
+    memset(groups, 0, GROUP_SLOTS * sizeof(group_t));
+    uint32_t num_groups = 0;
+    for (uint32_t r = 0; r < n; r++) {
+        uint16_t       len;
+        const uint8_t* s = (const uint8_t*)record_get_bytes(layout, rows + (size_t)r * MAX_ROW,
+                                                           col, &len);
+        uint32_t       h = 2166136261u;
+        for (uint16_t i = 0; i < len; i++)
+            h = (h ^ s[i]) * 16777619u;
+        for (uint32_t i = h % GROUP_SLOTS;; i = (i + 1) % GROUP_SLOTS) {
+            group_t* g = &groups[i];
+            if (!g->data) {
+                g->data = s;
+                g->len  = len;
+                num_groups++;
+            } else if (g->len != len || memcmp(g->data, s, len) != 0) {
+                continue;
+            }
+            g->count++;
+            break;
+        }
+    }
+    return num_groups;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t rows   = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000000;
+    uint32_t passes = argc > 2 ? (uint32_t)atoi(argv[2]) : 5;
+
+    /* Country names of realistic length */
+    static char countries[NUM_COUNTRIES][24];
+    for (int c = 0; c < NUM_COUNTRIES; c++)
+        snprintf(countries[c], sizeof(countries[c]), "country-%02d-%.*s", c, c % 8, "abcdefgh");
+
+    type_id_t    types[NUM_COLUMNS] = {TYPE_INT64, TYPE_TEXT, TYPE_TEXT, TYPE_TEXT, TYPE_TEXT};
+    type_dict_t* dicts[NUM_COLUMNS] = {NULL, type_dict_create(256), type_dict_create(256),
+                                       type_dict_create(256), NULL};
+    record_layout_t* layout[2]      = {record_layout_create(types, NUM_COLUMNS),
+                                       record_layout_create_dict(types, dicts, NUM_COLUMNS)};
+    uint8_t*         data[2]        = {(uint8_t*)malloc((size_t)rows * MAX_ROW),
+                                       (uint8_t*)malloc((size_t)rows * MAX_ROW)};
+    if (!dicts[1] || !dicts[2] || !dicts[3] || !layout[0] || !layout[1] || !data[0] || !data[1]) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("MonoDB dictionary encoding benchmark: %u rows, %u passes\n\n", rows, passes);
+
+    uint64_t bytes[2] = {0, 0};
+    uint64_t state    = 0x9E3779B97F4A7C15ull;
+    for (uint32_t r = 0; r < rows; r++) {
+        record_value_t values[NUM_COLUMNS];
+        char           note[32];
+        uint64_t       x = next_random(&state);
+        memset(&values[0], 0, sizeof(values[0]));
+        values[0].i = r;
+        set_text(&values[1], statuses[x % 5 < 3 ? 0 : (x >> 8) % 5]);
+        set_text(&values[2], countries[(x >> 16) % NUM_COUNTRIES]);
+        set_text(&values[3], plans[(x >> 24) % 4]);
+        snprintf(note, sizeof(note), "note %llu", (unsigned long long)(x % 100000));
+        set_text(&values[4], note);
+        for (int f = 0; f < 2; f++)
+            bytes[f] += record_encode(layout[f], values, data[f] + (size_t)r * MAX_ROW, MAX_ROW);
+    }
+    for (int c = 1; c <= 3; c++)
+        bytes[1] += type_dict_memory(dicts[c]);
+
+    double   t_filter[2] = {0, 0}, t_group[2] = {0, 0}, t_output[2] = {0, 0};
+    uint64_t check[2] = {0, 0};
+    group_t* groups   = (group_t*)malloc(GROUP_SLOTS * sizeof(group_t));
+    uint64_t counts[NUM_COUNTRIES];
+
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        for (int f = 0; f < 2; f++) {
+            const record_layout_t* lay = layout[f];
+            const uint8_t*         d   = data[f];
+
+            /* WHERE status = 'suspended' */
+            record_match_t match;
+            record_match_init(lay, 1, "suspended", 9, &match);
+            double start = now_sec();
+            for (uint32_t r = 0; r < rows; r++)
+                check[f] += record_match(lay, d + (size_t)r * MAX_ROW, &match);
+            t_filter[f] += now_sec() - start;
+
+            /* GROUP BY country */
+            start = now_sec();
+            if (f == 0) {
+                check[f] += group_plain(lay, d, rows, 2, groups);
+            } else {
+                memset(counts, 0, sizeof(counts));
+                for (uint32_t r = 0; r < rows; r++)
+                    counts[record_get_code(lay, d + (size_t)r * MAX_ROW, 2)]++;
+                for (uint32_t c = 0; c < NUM_COUNTRIES; c++)
+                    check[f] += counts[c] > 0;
+            }
+            t_group[f] += now_sec() - start;
+
+            /* Output: materialize the three strings */
+            start = now_sec();
+            for (uint32_t r = 0; r < rows; r++) {
+                for (uint16_t c = 1; c <= 3; c++) {
+                    uint16_t len;
+                    record_get_bytes(lay, d + (size_t)r * MAX_ROW, c, &len);
+                    check[f] += len;
+                }
+            }
+            t_output[f] += now_sec() - start;
+        }
+    }
+
+    double n = (double)rows * passes / 1e9;
+    printf("format       bytes/row   filter ns   group ns   output ns\n");
+    const char* names[2] = {"plain", "dictionary"};
+    for (int f = 0; f < 2; f++)
+        printf("%-10s   %9.1f   %9.2f   %8.2f   %9.2f\n", names[f], (double)bytes[f] / rows,
+               t_filter[f] / n, t_group[f] / n, t_output[f] / n);
+    if (check[0] != check[1])
+        printf("  (formats disagree: %llu vs %llu)\n", (unsigned long long)check[0],
+               (unsigned long long)check[1]);
+
+    for (int f = 0; f < 2; f++) {
+        record_layout_destroy(layout[f]);
+        free(data[f]);
+    }
+    for (int c = 1; c <= 3; c++)
+        type_dict_destroy(dicts[c]);
+    free(groups);
+    return 0;
+}
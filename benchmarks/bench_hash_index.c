@@ -0,0 +1,185 @@
+/**
+ * @file bench_hash_index.c
+ * @brief Point lookups in an extendible hash index versus a B+tree
+ *
+ * Both structures are loaded with the same keys in a random order, then
+ * probed with random point lookups. The B+tree descends from its root to a
+ * leaf on every lookup; the hash index goes straight from its in-memory
+ * directory to the one bucket page that can hold the key. For each the
+ * load rate, size, lookup latency and buffer pool pages read per lookup
+ * are reported, once with both cached and once through a pool too small
+ * to hold either. In the small pool the B+tree's few inner nodes stay
+ * cached, so both miss about once per lookup; the difference left is the
+ * pages each lookup latches and searches.
+ *
+ * Usage: bench_hash_index [records] [lookups] [small pool frames]
+ */
+
+#include <monodb/core/data/btree.h>
+#include <monodb/core/data/hash_index.h>
+#include <monodb/core/storage/buffer.h>
+#include <monodb/core/storage/disk_manager.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POOL_FRAMES 65536
+#define VALUE_SIZE  16
+
+typedef enum { KIND_BTREE, KIND_HASH } kind_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* 8-byte hashed key */
+static void make_key(uint8_t* key, uint64_t id) {
+    uint64_t h = id * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 29;
+    for (int i = 0; i < 8; i++)
+        key[i] = (uint8_t)(h >> (56 - 8 * i));
+}
+
+static bool structure_insert(kind_t kind, void* s, const uint8_t* key, const uint8_t* value) {
+    return kind == KIND_BTREE ? btree_insert((btree_t*)s, key, 8, value, VALUE_SIZE)
+                              : hash_index_insert((hash_index_t*)s, key, 8, value, VALUE_SIZE);
+}
+
+static bool structure_get(kind_t kind, void* s, const uint8_t* key, uint8_t* value) {
+    return kind == KIND_BTREE ? btree_get((btree_t*)s, key, 8, value, VALUE_SIZE, NULL)
+                              : hash_index_get((hash_index_t*)s, key, 8, value, VALUE_SIZE, NULL);
+}
+
+static uint64_t pages_read(buffer_pool_t* pool, uint64_t* misses) {
+    buffer_pool_stats_t stats;
+    buffer_pool_get_stats(pool, &stats);
+    *misses = stats.misses[BUFFER_ACCESS_NORMAL];
+    return stats.hits[BUFFER_ACCESS_NORMAL] + stats.misses[BUFFER_ACCESS_NORMAL];
+}
+
+/* Time random lookups; the first pass warms the pool and is not reported */
+static void measure(const char* name, kind_t kind, void* s, buffer_pool_t* pool, uint64_t records,
+                    uint32_t lookups, uint32_t file_pages, double load) {
+    uint8_t  key[8];
+    uint8_t  value[VALUE_SIZE];
+    uint64_t seed   = 0x9E3779B97F4A7C15ull;
+    uint64_t missed = 0, reads = 0, misses = 0;
+    double   elapsed = 0;
+
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        uint64_t misses_before;
+        uint64_t reads_before = pages_read(pool, &misses_before);
+        double   start        = now_sec();
+        for (uint32_t i = 0; i < lookups; i++) {
+            make_key(key, next_random(&seed) % records);
+            if (!structure_get(kind, s, key, value))
+                missed++;
+        }
+        elapsed = now_sec() - start;
+        reads   = pages_read(pool, &misses) - reads_before;
+        misses -= misses_before;
+    }
+
+    char rate[16] = "-";
+    if (load > 0)
+        snprintf(rate, sizeof(rate), "%.0f", records / load);
+    printf("%-20s %9s   %7.1f   %9.1f   %10.2f   %10.3f\n", name, rate,
+           (double)file_pages * PAGE_SIZE / (1024.0 * 1024.0), elapsed * 1e9 / lookups,
+           (double)reads / lookups, (double)misses / lookups);
+    if (missed > 0)
+        printf("  (%llu lookups missed)\n", (unsigned long long)missed);
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t records = argc > 1 ? (uint64_t)atoll(argv[1]) : 1000000;
+    uint32_t lookups = argc > 2 ? (uint32_t)atoi(argv[2]) : 1000000;
+    uint32_t frames  = argc > 3 ? (uint32_t)atoi(argv[3]) : 1024;
+
+    const char* tree_path = "./bench_hash_index.btree";
+    const char* hash_path = "./bench_hash_index.hash";
+    remove(tree_path);
+    remove(hash_path);
+
+    printf("MonoDB hash index benchmark: %llu records, %u lookups, %d-byte values\n\n",
+           (unsigned long long)records, lookups, VALUE_SIZE);
+
+    buffer_pool_t* pool = buffer_pool_create(POOL_FRAMES);
+    btree_t*       tree = pool ? btree_open(pool, tree_path) : NULL;
+    hash_index_t*  hash = tree ? hash_index_open(pool, hash_path) : NULL;
+    if (!hash) {
+        fprintf(stderr, "Failed to open the index files\n");
+        return 1;
+    }
+
+    /* Load both in the same random order */
+    uint64_t* order = (uint64_t*)malloc(records * sizeof(uint64_t));
+    uint64_t  seed  = 0x2545F4914F6CDD1Dull;
+    if (!order)
+        return 1;
+    for (uint64_t i = 0; i < records; i++)
+        order[i] = i;
+    for (uint64_t i = records - 1; i > 0; i--) {
+        uint64_t j = next_random(&seed) % (i + 1);
+        uint64_t t = order[i];
+        order[i]   = order[j];
+        order[j]   = t;
+    }
+
+    uint8_t key[8];
+    uint8_t value[VALUE_SIZE];
+    double  loads[2];
+    void*   structures[2] = {tree, hash};
+    memset(value, 'v', sizeof(value));
+    for (int k = 0; k < 2; k++) {
+        double start = now_sec();
+        for (uint64_t i = 0; i < records; i++) {
+            make_key(key, order[i]);
+            structure_insert((kind_t)k, structures[k], key, value);
+        }
+        loads[k] = now_sec() - start;
+    }
+    free(order);
+
+    hash_index_stats_t stats;
+    hash_index_get_stats(hash, &stats);
+    uint32_t tree_pages = disk_manager_num_pages(btree_file(tree));
+    uint32_t hash_pages = disk_manager_num_pages(hash_index_file(hash));
+    printf("B+tree height %u; hash directory depth %u, %u buckets, %u overflow pages\n\n",
+           btree_height(tree), stats.global_depth, stats.buckets, stats.overflow_pages);
+
+    printf("structure             inserts/s   size MB   lookup ns   pages/get   misses/get\n");
+    measure("btree (cached)", KIND_BTREE, tree, pool, records, lookups, tree_pages, loads[0]);
+    measure("hash (cached)", KIND_HASH, hash, pool, records, lookups, hash_pages, loads[1]);
+
+    /* Reopen both through a small pool so lookups reach the disk */
+    btree_close(tree);
+    hash_index_close(hash);
+    buffer_pool_destroy(pool);
+    pool = buffer_pool_create(frames);
+    tree = pool ? btree_open(pool, tree_path) : NULL;
+    hash = tree ? hash_index_open(pool, hash_path) : NULL;
+    if (hash) {
+        char name[32];
+        snprintf(name, sizeof(name), "btree (%u frames)", frames);
+        measure(name, KIND_BTREE, tree, pool, records, lookups / 4, tree_pages, 0);
+        snprintf(name, sizeof(name), "hash (%u frames)", frames);
+        measure(name, KIND_HASH, hash, pool, records, lookups / 4, hash_pages, 0);
+    }
+
+    btree_close(tree);
+    hash_index_close(hash);
+    buffer_pool_destroy(pool);
+    remove(tree_path);
+    remove(hash_path);
+    return 0;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file bench_iot.c
+ * @brief Primary-key range scans: heap plus B+tree index versus an index-organized table
+ *
+ * Sensors report readings in time order, so consecutive rows of one sensor
+ * land on different heap pages. A query for one sensor's readings over a
+ * time window walks the primary-key index and then fetches every row from
+ * its own heap page. The index-organized table stores the rows in primary
+ * key order in the tree's leaves, so the same query reads a few
+ * consecutive leaves.
+ *
+ * Usage: bench_iot [sensors] [readings_per_sensor] [queries] [window]
+ */
+
+#include <monodb/core/data/btree.h>
+#include <monodb/core/data/table.h>
+#include <monodb/core/storage/buffer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POOL_FRAMES 512
+
+typedef struct {
+    uint32_t sensor;
+    uint32_t ts;
+    double   value;
+    char     payload[80];
+} reading_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void encode_pk(uint8_t* key, uint32_t sensor, uint32_t ts) {
+    for (int i = 0; i < 4; i++) {
+        key[i]     = (uint8_t)(sensor >> (24 - 8 * i));
+        key[4 + i] = (uint8_t)(ts >> (24 - 8 * i));
+    }
+}
+
+/* Primary key: sensor, then timestamp, both big-endian */
+static bool pk_key(const void* tuple, uint16_t len, void* key, uint16_t* key_len, void* arg) {
+    (void)arg;
+    if (len < sizeof(reading_t))
+        return false;
+    const reading_t* r = (const reading_t*)tuple;
+    encode_pk((uint8_t*)key, r->sensor, r->ts);
+    *key_len = 8;
+    return true;
+}
+
+static bool sum_row(tuple_id_t tid, const void* data, uint16_t len, void* arg) {
+    (void)tid;
+    (void)len;
+    *(double*)arg += ((const reading_t*)data)->value;
+    return true;
+}
+
+static uint64_t page_requests(buffer_pool_t* pool, uint64_t* misses) {
+    buffer_pool_stats_t stats;
+    buffer_pool_get_stats(pool, &stats);
+    *misses = stats.misses[BUFFER_ACCESS_NORMAL];
+    return stats.hits[BUFFER_ACCESS_NORMAL] + stats.misses[BUFFER_ACCESS_NORMAL];
+}
+
+static void load(table_t* table, uint32_t sensors, uint32_t readings) {
+    for (uint32_t ts = 0; ts < readings; ts++) {
+        for (uint32_t s = 0; s < sensors; s++) {
+            reading_t r = {s, ts, (double)(s + ts), {0}};
+            memset(r.payload, 'p', sizeof(r.payload));
+            table_insert(table, &r, sizeof(r), 1, NULL);
+        }
+    }
+}
+
+static void report(const char* name, double elapsed, uint32_t queries, uint64_t requests,
+                   uint64_t misses, double checksum) {
+    printf("%-10s %.3fs  %7.1f pages/query  %7.1f disk reads/query  (checksum %.0f)\n", name,
+           elapsed, (double)requests / queries, (double)misses / queries, checksum);
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t sensors  = argc > 1 ? (uint32_t)atoi(argv[1]) : 64;
+    uint32_t readings = argc > 2 ? (uint32_t)atoi(argv[2]) : 4000;
+    uint32_t queries  = argc > 3 ? (uint32_t)atoi(argv[3]) : 500;
+    uint32_t window   = argc > 4 ? (uint32_t)atoi(argv[4]) : 500;
+    if (window >= readings)
+        window = readings / 2;
+
+    printf("MonoDB index-organized table benchmark: %u sensors x %u readings, %u queries of %u "
+           "readings, %u frames\n",
+           sensors, readings, queries, window, POOL_FRAMES);
+
+    const char* heap_path = "./bench_iot_heap.db";
+    const char* pk_path   = "./bench_iot_heap.db.pk";
+    const char* iot_path  = "./bench_iot_clustered.db";
+    remove(heap_path);
+    remove(pk_path);
+    remove(iot_path);
+
+    buffer_pool_t* pool = buffer_pool_create(POOL_FRAMES);
+    table_t*       heap = pool ? table_open(pool, heap_path) : NULL;
+    btree_t*       pk   = pool ? btree_open(pool, pk_path) : NULL;
+    table_t*       iot  = pool ? table_open_clustered(pool, iot_path, pk_key, NULL) : NULL;
+    if (!heap || !pk || !iot ||
+        !table_add_index(heap, index_create("pk", &btree_index_ops, pk, pk_key, NULL))) {
+        fprintf(stderr, "Failed to create benchmark tables\n");
+        return 1;
+    }
+
+    load(heap, sensors, readings);
+    load(iot, sensors, readings);
+    buffer_flush_all(pool);
+
+    uint64_t requests, misses, base_misses;
+    double   start, checksum;
+
+    /* Heap: walk the primary-key index, then fetch each row from the heap */
+    srand(7);
+    checksum = 0;
+    requests = page_requests(pool, &base_misses);
+    start    = now_sec();
+    for (uint32_t q = 0; q < queries; q++) {
+        uint32_t sensor = (uint32_t)rand() % sensors;
+        uint32_t from   = (uint32_t)rand() % (readings - window);
+        uint8_t  lo[8], hi[8];
+        encode_pk(lo, sensor, from);
+        encode_pk(hi, sensor, from + window);
+
+        btree_scan_t* scan = btree_scan_begin(pk, lo, 8, hi, 8);
+        const void*   key;
+        const void*   value;
+        uint16_t      key_len, value_len;
+        while (btree_scan_next(scan, &key, &key_len, &value, &value_len)) {
+            const uint8_t* t   = (const uint8_t*)key + 8;
+            tuple_id_t     tid = {((page_id_t)t[0] << 24) | ((page_id_t)t[1] << 16) |
+                                      ((page_id_t)t[2] << 8) | t[3],
+                                  (uint16_t)((t[4] << 8) | t[5])};
+            reading_t      r;
+            uint16_t       len;
+            if (heap_fetch(table_heap(heap), tid, &r, sizeof(r), &len))
+                checksum += r.value;
+        }
+        btree_scan_end(scan);
+    }
+    requests = page_requests(pool, &misses) - requests;
+    report("heap+index", now_sec() - start, queries, requests, misses - base_misses, checksum);
+
+    /* Index-organized: read the consecutive leaves holding the range */
+    srand(7);
+    checksum = 0;
+    requests = page_requests(pool, &base_misses);
+    start    = now_sec();
+    for (uint32_t q = 0; q < queries; q++) {
+        uint32_t sensor = (uint32_t)rand() % sensors;
+        uint32_t from   = (uint32_t)rand() % (readings - window);
+        uint8_t  lo[8], hi[8];
+        encode_pk(lo, sensor, from);
+        encode_pk(hi, sensor, from + window);
+        table_range_scan(iot, lo, 8, hi, 8, sum_row, &checksum);
+    }
+    requests = page_requests(pool, &misses) - requests;
+    report("clustered", now_sec() - start, queries, requests, misses - base_misses, checksum);
+
+    table_close(heap);
+    table_close(iot);
+    buffer_pool_destroy(pool);
+    remove(heap_path);
+    remove(pk_path);
+    remove(iot_path);
+    return 0;
+}
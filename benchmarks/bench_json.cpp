@@ -0,0 +1,124 @@
+/**
+ * @file bench_json.cpp
+ * @brief JSON ingest throughput and path extraction from binary documents versus text
+ *
+ * Order documents of about 400 bytes (nested customer and address
+ * objects, an array of line items, tags) are generated as text and parsed
+ * into binary documents, reporting the parse throughput. Two paths are
+ * then extracted from every document: from the binary form, one binary
+ * search per object level and one load per array index, and, as a store
+ * of JSON text would have to, by parsing the text again first.
+ *
+ * Usage: bench_json [documents] [passes]
+ */
+
+#include <monodb/cpp/types/JsonType.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using monodb::JsonPath;
+using monodb::JsonType;
+
+/* Keeps extracted values observable */
+static volatile int64_t sink;
+
+static double now_sec() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static std::string make_document(uint32_t i) {
+    static const char* const cities[]   = {"Oslo", "Lima", "Accra", "Hanoi", "Quito"};
+    static const char* const statuses[] = {"pending", "shipped", "delivered"};
+    char                     buf[256];
+    std::string              doc;
+    snprintf(buf, sizeof(buf),
+             "{\"id\": %u, \"status\": \"%s\", \"customer\": {\"name\": \"customer-%u\", "
+             "\"email\": \"c%u@example.com\", \"address\": {\"city\": \"%s\", \"zip\": \"%05u\", "
+             "\"street\": \"%u Main Street\"}}, \"items\": [",
+             i, statuses[i % 3], i % 50000, i % 50000, cities[i % 5], i * 7 % 100000, i % 900);
+    doc += buf;
+    for (uint32_t k = 0; k < 2 + i % 3; k++) {
+        snprintf(buf, sizeof(buf), "%s{\"sku\": \"SKU-%u\", \"qty\": %u, \"price\": %u.%02u}",
+                 k ? ", " : "", (i + k) * 31 % 10000, 1 + (i + k) % 9, (i + k) % 500, k * 7 % 100);
+        doc += buf;
+    }
+    snprintf(buf, sizeof(buf),
+             "], \"tags\": [\"t%u\", \"t%u\"], \"gift\": %s, "
+             "\"note\": \"line\\nbreak \\\"quoted\\\"\"}",
+             i % 7, i % 11, i % 4 ? "false" : "true");
+    doc += buf;
+    return doc;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t count  = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 100000;
+    uint32_t passes = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 10;
+
+    std::vector<std::string> texts;
+    size_t                   text_bytes = 0;
+    texts.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        texts.push_back(make_document(i));
+        text_bytes += texts.back().size();
+    }
+
+    printf("MonoDB JSON benchmark: %u documents, %.1f MB of text\n\n", count, text_bytes / 1e6);
+
+    /* Ingest: text to binary */
+    std::vector<JsonType> docs;
+    docs.reserve(count);
+    size_t binary_bytes = 0;
+    double start        = now_sec();
+    for (const std::string& text : texts) {
+        auto doc = JsonType::parse(text);
+        if (!doc) {
+            fprintf(stderr, "Failed to parse a document\n");
+            return 1;
+        }
+        binary_bytes += doc->binary().size();
+        docs.push_back(std::move(*doc));
+    }
+    double parse = now_sec() - start;
+    printf("parse: %.1f MB/s, %.2f M documents/s, binary %.1f MB\n", text_bytes / parse / 1e6,
+           count / parse / 1e6, binary_bytes / 1e6);
+
+    auto city = JsonPath::parse("$.customer.address.city");
+    auto qty  = JsonPath::parse("$.items[1].qty");
+    if (!city || !qty) {
+        fprintf(stderr, "Failed to compile the paths\n");
+        return 1;
+    }
+
+    /* Extraction from the binary form */
+    int64_t check = 0;
+    start         = now_sec();
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        for (const JsonType& doc : docs) {
+            check += static_cast<int64_t>(doc.root().find(*city).asString().size());
+            check += doc.root().find(*qty).asInt();
+        }
+    }
+    double binary = now_sec() - start;
+    double lookups = 2.0 * count * passes;
+
+    /* Extraction by reparsing the text, one pass */
+    start = now_sec();
+    for (const std::string& text : texts) {
+        auto doc = JsonType::parse(text);
+        check += static_cast<int64_t>(doc->root().find(*city).asString().size());
+        check += doc->root().find(*qty).asInt();
+    }
+    double reparse = now_sec() - start;
+    sink           = check;
+
+    printf("path extraction: binary %.1f M/s (%.1f ns), reparsing text %.2f M/s (%.1f ns), "
+           "%.0fx\n",
+           lookups / binary / 1e6, binary / lookups * 1e9, 2.0 * count / reparse / 1e6,
+           reparse / (2.0 * count) * 1e9, (reparse / (2.0 * count)) / (binary / lookups));
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file bench_json_index.cpp
+ * @brief JSON containment and path queries through the inverted index versus full scans
+ *
+ * Order documents (nested customer and address objects, an array of line
+ * items, tags) are parsed into binary documents and indexed, once with
+ * the default pending list and once, on a prefix of the documents, merging
+ * every insert into the posting lists, to show what the pending list
+ * saves. The benchmark reports the size of the compressed posting lists,
+ * then runs containment and path queries of varying selectivity both as
+ * index lookups (rechecking candidates when the index asks for it) and as
+ * full scans testing every document.
+ *
+ * Usage: bench_json_index [documents] [repetitions]
+ */
+
+#include <monodb/cpp/types/JsonIndex.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using monodb::JsonIndex;
+using monodb::JsonPath;
+using monodb::JsonType;
+using monodb::JsonValue;
+
+static double now_sec() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static std::string make_document(uint32_t i) {
+    static const char* const cities[]   = {"Oslo", "Lima", "Accra", "Hanoi", "Quito"};
+    static const char* const statuses[] = {"pending", "shipped", "delivered"};
+    char                     buf[256];
+    std::string              doc;
+    snprintf(buf, sizeof(buf),
+             "{\"id\": %u, \"status\": \"%s\", \"customer\": {\"name\": \"customer-%u\", "
+             "\"address\": {\"city\": \"%s\", \"zip\": \"%05u\"}}, \"items\": [",
+             i, statuses[i % 3], i % 50000, cities[i % 5], i * 7 % 1000);
+    doc += buf;
+    for (uint32_t k = 0; k < 2 + i % 3; k++) {
+        snprintf(buf, sizeof(buf), "%s{\"sku\": \"SKU-%u\", \"qty\": %u}", k ? ", " : "",
+                 (i + k) * 31 % 1000, 1 + (i + k) % 9);
+        doc += buf;
+    }
+    snprintf(buf, sizeof(buf), "], \"tags\": [\"t%u\", \"t%u\"], \"gift\": %s}", i % 7, i % 11,
+             i % 4 ? "false" : "true");
+    doc += buf;
+    return doc;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t count = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 200000;
+    uint32_t reps  = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 5;
+
+    std::vector<JsonType> docs;
+    docs.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+        docs.push_back(*JsonType::parse(make_document(i)));
+
+    printf("MonoDB JSON index benchmark: %u documents\n\n", count);
+
+    /* Build: pending list versus a merge per insert */
+    JsonIndex index;
+    double    start = now_sec();
+    for (uint32_t i = 0; i < count; i++)
+        index.insert(i, docs[i].root());
+    index.flush();
+    double   build  = now_sec() - start;
+    uint32_t prefix = count < 5000 ? count : 5000;
+    JsonIndex eager(0);
+    start = now_sec();
+    for (uint32_t i = 0; i < prefix; i++)
+        eager.insert(i, docs[i].root());
+    double eager_build = now_sec() - start;
+
+    monodb::JsonIndexStats stats = index.stats();
+    printf("insert: %.2f us/document with the pending list (%llu merges), %.2f us/document "
+           "merging every insert (first %u documents)\n",
+           build / count * 1e6, static_cast<unsigned long long>(stats.merges),
+           eager_build / prefix * 1e6, prefix);
+    printf("posting lists: %zu keys, %zu ids, %.1f MB compressed, %.2f bytes/id (8 uncompressed)"
+           "\n\n",
+           stats.keys, stats.postings, stats.posting_bytes / 1e6,
+           static_cast<double>(stats.posting_bytes) / stats.postings);
+
+    struct Query {
+        const char* label;
+        const char* path;  /* nullptr for containment */
+        const char* value;
+    };
+    static const Query queries[] = {
+        {"contains one customer", nullptr, R"({"customer": {"name": "customer-123"}})"},
+        {"contains status and city", nullptr,
+         R"({"status": "shipped", "customer": {"address": {"city": "Oslo"}}})"},
+        {"contains tags", nullptr, R"({"tags": ["t3", "t5"], "gift": true})"},
+        {"contains an item", nullptr, R"({"items": [{"sku": "SKU-31", "qty": 2}]})"},
+        {"customer.address.zip =", "customer.address.zip", R"("00700")"},
+        {"items[0].sku =", "items[0].sku", R"("SKU-62")"},
+    };
+
+    printf("query                       matches  candidates  recheck   index us   scan us"
+           "  speedup\n");
+    for (const Query& q : queries) {
+        auto value = JsonType::parse(q.value);
+        auto path  = q.path ? JsonPath::parse(q.path) : JsonPath();
+        if (!value || !path) {
+            fprintf(stderr, "Failed to parse a query\n");
+            return 1;
+        }
+        auto matches = [&](JsonValue doc) {
+            return q.path ? doc.find(*path) == value->root() : doc.contains(value->root());
+        };
+
+        std::vector<uint64_t> ids;
+        size_t                found = 0, candidates = 0;
+        bool                  exact = true;
+        start                       = now_sec();
+        for (uint32_t r = 0; r < reps; r++) {
+            exact = q.path ? index.findEqual(*path, value->root(), ids)
+                           : index.findContaining(value->root(), ids);
+            candidates = ids.size();
+            found      = 0;
+            for (uint64_t id : ids)
+                found += exact || matches(docs[id].root());
+        }
+        double indexed = (now_sec() - start) / reps;
+
+        size_t scanned = 0;
+        start          = now_sec();
+        for (uint32_t r = 0; r < reps; r++) {
+            scanned = 0;
+            for (const JsonType& doc : docs)
+                scanned += matches(doc.root());
+        }
+        double scan = (now_sec() - start) / reps;
+        if (scanned != found) {
+            fprintf(stderr, "Index and scan disagree on %s\n", q.label);
+            return 1;
+        }
+        printf("%-26s  %7zu  %10zu  %7s  %9.1f  %8.1f  %6.0fx\n", q.label, found, candidates,
+               exact ? "no" : "yes", indexed * 1e6, scan * 1e6, scan / indexed);
+    }
+    return 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file bench_keys.c
+ * @brief Key searches through a comparator callback versus inlined normalized compares
+ *
+ * Sorted arrays of three key types are binary searched with random probes:
+ * 64-bit integers, short strings, and composite (integer, string) keys.
+ * Each is searched two ways. The runtime-dispatch path keeps keys in their
+ * native form and calls a type-specific comparator through a function
+ * pointer at every step, as an index built on void* keys and comparator
+ * callbacks would. The specialized path stores the same keys in the
+ * order-preserving encodings of key.h and searches with key_compare_as()
+ * and a constant kind, so the compare inlines into a loop specific to the
+ * key type: an integer compare for fixed-width keys, memcmp for the rest.
+ *
+ * Usage: bench_keys [keys] [lookups]
+ */
+
+#include <monodb/core/data/key.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Longest string of a string or composite key */
+#define NAME_LEN 15
+
+typedef enum { TYPE_U64, TYPE_STRING, TYPE_COMPOSITE, NUM_TYPES } key_type_t;
+
+/**
+ * Composite key in native form
+ */
+typedef struct {
+    uint32_t region;
+    char     name[NAME_LEN + 1];
+} composite_t;
+
+typedef int (*compare_fn)(const void* a, const void* b);
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_string(const void* a, const void* b) {
+    return strcmp((const char*)a, (const char*)b);
+}
+
+static int compare_composite(const void* a, const void* b) {
+    const composite_t* x = (const composite_t*)a;
+    const composite_t* y = (const composite_t*)b;
+    if (x->region != y->region)
+        return x->region < y->region ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+/* Read at run time (volatile), as a registry of comparator callbacks would be */
+static compare_fn volatile comparators[NUM_TYPES] = {compare_u64, compare_string,
+                                                     compare_composite};
+static const size_t native_size[NUM_TYPES] = {sizeof(uint64_t), NAME_LEN + 1, sizeof(composite_t)};
+
+/* Room for one encoded key, close to the native size so both arrays fit the caches alike */
+static const size_t encoded_size[NUM_TYPES] = {8, 20, 20};
+
+/* Native key i of a type; ids map to keys in increasing order */
+static void make_native(key_type_t type, uint64_t id, void* out) {
+    switch (type) {
+    case TYPE_U64:
+        *(uint64_t*)out = id * 7919;
+        break;
+    case TYPE_STRING:
+        snprintf((char*)out, NAME_LEN + 1, "user%011llu", (unsigned long long)id);
+        break;
+    default: {
+        composite_t* c = (composite_t*)out;
+        memset(c, 0, sizeof(*c));
+        c->region = (uint32_t)(id / 1000);
+        snprintf(c->name, sizeof(c->name), "user%06u", (unsigned)(id % 1000));
+        break;
+    }
+    }
+}
+
+/* The same key in its order-preserving encoding */
+static uint16_t make_encoded(key_type_t type, const void* native, uint8_t* out) {
+    switch (type) {
+    case TYPE_U64:
+        return key_put_u64(out, *(const uint64_t*)native);
+    case TYPE_STRING:
+        return key_put_string(out, native, (uint16_t)strlen((const char*)native));
+    default: {
+        const composite_t* c = (const composite_t*)native;
+        uint16_t           n = key_put_u32(out, c->region);
+        return (uint16_t)(n + key_put_string(out + n, c->name, (uint16_t)strlen(c->name)));
+    }
+    }
+}
+
+/*
+ * Both searches halve the range without branching on the compare, so an
+ * inlined compare can become a conditional move
+ */
+
+/* First key not below the probe, comparing through a callback */
+static uint32_t search_dispatch(const uint8_t* keys, size_t size, uint32_t n, const void* probe,
+                                compare_fn compare) {
+    uint32_t base = 0;
+    while (n > 1) {
+        uint32_t half = n / 2;
+        base          = compare(keys + (base + half) * size, probe) < 0 ? base + half : base;
+        n -= half;
+    }
+    return base + (compare(keys + base * size, probe) < 0);
+}
+
+/* First key not below the probe, with the compare specialized for kind */
+static inline uint32_t search_as(key_kind_t kind, const uint8_t* keys, size_t size,
+                                 const uint16_t* lens, uint32_t n, const uint8_t* probe,
+                                 uint16_t probe_len) {
+    uint32_t base = 0;
+    while (n > 1) {
+        uint32_t half  = n / 2;
+        uint32_t mid   = base + half;
+        bool     below = key_compare_as(kind, keys + mid * size, lens[mid], probe, probe_len) < 0;
+        base           = below ? mid : base;
+        n -= half;
+    }
+    return base + (key_compare_as(kind, keys + base * size, lens[base], probe, probe_len) < 0);
+}
+
+static void run(key_type_t type, const char* name, uint32_t count, uint32_t lookups) {
+    size_t    size    = native_size[type];
+    size_t    stride  = encoded_size[type];
+    uint8_t*  native  = (uint8_t*)calloc(count, size);
+    uint8_t*  encoded = (uint8_t*)calloc(count, stride);
+    uint16_t* lens    = (uint16_t*)calloc(count, sizeof(uint16_t));
+    uint32_t* probes  = (uint32_t*)malloc(lookups * sizeof(uint32_t));
+    if (!native || !encoded || !lens || !probes) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    uint64_t seed = 0x2545F4914F6CDD1Dull;
+    for (uint32_t i = 0; i < count; i++) {
+        make_native(type, i, native + i * size);
+        lens[i] = make_encoded(type, native + i * size, encoded + i * stride);
+    }
+    for (uint32_t i = 0; i < lookups; i++)
+        probes[i] = (uint32_t)(next_random(&seed) % count);
+
+    /* Runtime dispatch: the comparator is chosen by the key type at run time */
+    compare_fn compare = comparators[type];
+    uint64_t   misses  = 0;
+    double     start   = now_sec();
+    for (uint32_t i = 0; i < lookups; i++) {
+        const uint8_t* probe = native + probes[i] * size;
+        misses += search_dispatch(native, size, count, probe, compare) != probes[i];
+    }
+    double dispatch = now_sec() - start;
+
+    /* Specialized: each key type gets its own inlined search */
+    start = now_sec();
+    for (uint32_t i = 0; i < lookups; i++) {
+        const uint8_t* probe = encoded + probes[i] * stride;
+        uint16_t       len   = lens[probes[i]];
+        uint32_t       slot;
+        if (type == TYPE_U64)
+            slot = search_as(KEY_KIND_FIXED8, encoded, stride, lens, count, probe, len);
+        else
+            slot = search_as(KEY_KIND_BYTES, encoded, stride, lens, count, probe, len);
+        misses += slot != probes[i];
+    }
+    double specialized = now_sec() - start;
+
+    printf("%-12s %12.1f   %12.1f   %7.2fx\n", name, dispatch * 1e9 / lookups,
+           specialized * 1e9 / lookups, dispatch / specialized);
+    if (misses > 0)
+        printf("  (%llu searches found the wrong key)\n", (unsigned long long)misses);
+
+    free(native);
+    free(encoded);
+    free(lens);
+    free(probes);
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t count   = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+    uint32_t lookups = argc > 2 ? (uint32_t)atoi(argv[2]) : 2000000;
+
+    printf("MonoDB key comparison benchmark: %u keys, %u lookups\n\n", count, lookups);
+    printf("key type      dispatch ns    special ns   speedup\n");
+    run(TYPE_U64, "u64", count, lookups);
+    run(TYPE_STRING, "string", count, lookups);
+    run(TYPE_COMPOSITE, "composite", count, lookups);
+    return 0;
+}
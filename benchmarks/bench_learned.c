@@ -0,0 +1,167 @@
+/**
+ * @file bench_learned.c
+ * @brief Size and lookup latency of a learned index versus a bulk-loaded B+tree
+ *
+ * The keys are timestamps of rows arriving in bursts: the arrival rate
+ * changes every few thousand rows, from several per millisecond to one a
+ * second, the read-mostly sorted column a learned index is meant for. The
+ * same (key, value) entries are bulk loaded into a B+tree, in a buffer pool
+ * large enough to hold it, and into a learned index at several model
+ * errors. Both are then probed with random point lookups. The B+tree
+ * searches one slotted page per level; the learned index evaluates a
+ * segment found through its radix table and binary searches a window of
+ * at most 2 * error + 1 entries. The B+tree's size is its file; the
+ * learned index reports its model (segments and radix table) apart from
+ * its sorted entries, since only the model stands in for the tree's inner
+ * nodes.
+ *
+ * Usage: bench_learned [records] [lookups]
+ */
+
+#include <monodb/core/data/btree.h>
+#include <monodb/core/data/key.h>
+#include <monodb/core/data/learned.h>
+#include <monodb/core/storage/buffer.h>
+#include <monodb/core/storage/disk_manager.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POOL_FRAMES 65536
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Time random lookups of existing keys; the first pass warms caches and is not reported */
+static double measure_btree(btree_t* tree, const uint64_t* keys, uint64_t records,
+                            uint32_t lookups, uint64_t* missed) {
+    uint64_t seed    = 0x9E3779B97F4A7C15ull;
+    double   elapsed = 0;
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        double start = now_sec();
+        for (uint32_t i = 0; i < lookups; i++) {
+            uint64_t id = next_random(&seed) % records;
+            uint8_t  key[8];
+            uint64_t value;
+            key_put_u64(key, keys[id]);
+            if (!btree_get(tree, key, 8, &value, sizeof(value), NULL) || value != id)
+                (*missed)++;
+        }
+        elapsed = now_sec() - start;
+    }
+    return elapsed * 1e9 / lookups;
+}
+
+static double measure_learned(learned_index_t* index, const uint64_t* keys, uint64_t records,
+                              uint32_t lookups, uint64_t* missed) {
+    uint64_t seed    = 0x9E3779B97F4A7C15ull;
+    double   elapsed = 0;
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        double start = now_sec();
+        for (uint32_t i = 0; i < lookups; i++) {
+            uint64_t id = next_random(&seed) % records;
+            uint64_t value;
+            if (!learned_index_get(index, keys[id], &value) || value != id)
+                (*missed)++;
+        }
+        elapsed = now_sec() - start;
+    }
+    return elapsed * 1e9 / lookups;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t records = argc > 1 ? (uint64_t)atoll(argv[1]) : 1000000;
+    uint32_t lookups = argc > 2 ? (uint32_t)atoi(argv[2]) : 1000000;
+
+    const char* tree_path = "./bench_learned.btree";
+    remove(tree_path);
+
+    printf("MonoDB learned index benchmark: %llu records, %u lookups, 8-byte time keys\n\n",
+           (unsigned long long)records, lookups);
+
+    uint64_t*        keys    = (uint64_t*)malloc(records * sizeof(uint64_t));
+    learned_entry_t* entries = (learned_entry_t*)malloc(records * sizeof(learned_entry_t));
+    buffer_pool_t*   pool    = buffer_pool_create(POOL_FRAMES);
+    btree_t*         tree    = pool ? btree_open(pool, tree_path) : NULL;
+    btree_bulk_t*    bulk    = tree ? btree_bulk_begin(tree, BTREE_DEFAULT_FILLFACTOR) : NULL;
+    if (!keys || !entries || !bulk) {
+        fprintf(stderr, "Failed to create the indexes\n");
+        return 1;
+    }
+
+    /* Mean gap in microseconds, redrawn every 4096 rows */
+    static const uint64_t gaps[] = {200, 1000, 20000, 1000000};
+    uint64_t              seed   = 0x2545F4914F6CDD1Dull;
+    uint64_t              now    = 1700000000000000ull;
+    uint64_t              gap    = gaps[0];
+    for (uint64_t i = 0; i < records; i++) {
+        if (i % 4096 == 0)
+            gap = gaps[next_random(&seed) % 4];
+        now += 1 + next_random(&seed) % (2 * gap);
+        keys[i] = now;
+    }
+
+    double start = now_sec();
+    for (uint64_t i = 0; i < records; i++) {
+        uint8_t key[8];
+        key_put_u64(key, keys[i]);
+        if (!btree_bulk_add(bulk, key, 8, &i, sizeof(i))) {
+            fprintf(stderr, "Bulk load failed\n");
+            return 1;
+        }
+    }
+    if (!btree_bulk_finish(bulk)) {
+        fprintf(stderr, "Bulk load failed\n");
+        return 1;
+    }
+    double tree_load = now_sec() - start;
+
+    const double mb     = 1024.0 * 1024.0;
+    uint64_t     missed = 0;
+    double       tree_mb = (double)disk_manager_num_pages(btree_file(tree)) * PAGE_SIZE / mb;
+    printf("structure        load ms    model KB    data MB   segments   lookup ns\n");
+    printf("%-14s %9.1f   %9s   %8.1f   %8s   %9.1f\n", "btree", tree_load * 1e3, "-", tree_mb,
+           "-", measure_btree(tree, keys, records, lookups, &missed));
+
+    static const uint32_t errors[] = {8, 32, 128};
+    for (size_t e = 0; e < sizeof(errors) / sizeof(errors[0]); e++) {
+        learned_index_t* index = learned_index_create(errors[e]);
+        for (uint64_t i = 0; i < records; i++)
+            entries[i] = (learned_entry_t){keys[i], i};
+        start = now_sec();
+        if (!index || !learned_index_load(index, entries, records)) {
+            fprintf(stderr, "Learned index load failed\n");
+            return 1;
+        }
+        double load = now_sec() - start;
+
+        learned_stats_t stats;
+        learned_index_get_stats(index, &stats);
+        char name[32];
+        snprintf(name, sizeof(name), "learned e=%u", errors[e]);
+        printf("%-14s %9.1f   %9.1f   %8.1f   %8u   %9.1f\n", name, load * 1e3,
+               (double)stats.model_memory / 1024.0, (double)stats.data_memory / mb,
+               stats.segments, measure_learned(index, keys, records, lookups, &missed));
+        learned_index_destroy(index);
+    }
+    if (missed > 0)
+        printf("  (%llu lookups missed)\n", (unsigned long long)missed);
+
+    free(keys);
+    free(entries);
+    btree_close(tree);
+    buffer_pool_destroy(pool);
+    remove(tree_path);
+    return 0;
+}
@@ -0,0 +1,247 @@
+/**
+ * @file bench_record.c
+ * @brief Encoding, decoding and single-field access: compact records versus a sequential format
+ *
+ * Rows of a 16-column schema (fixed-width integers and doubles mixed with
+ * short strings) are encoded into a buffer, then read back three ways:
+ * decoding every field, reading one fixed-width field near the end, and
+ * reading the last string. The compact format of record.h reaches any
+ * field through offsets precomputed by its layout. The sequential format,
+ * where each field is a null byte followed by the value (strings with a
+ * length prefix), has to step over every earlier field to find one.
+ *
+ * Usage: bench_record [rows] [passes]
+ */
+
+#include <monodb/core/data/record.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_COLUMNS 16
+#define MAX_ROW     512
+
+/* Distinct rows generated up front and encoded in turn, so encoding is timed alone */
+#define NUM_SOURCES 1024
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Column c: strings every fourth column, the rest alternating integers and doubles */
+static type_id_t column_type(int c) {
+    if (c % 4 == 3)
+        return TYPE_TEXT;
+    return c % 2 == 0 ? TYPE_INT64 : TYPE_FLOAT64;
+}
+
+static void make_row(uint64_t id, record_value_t* values, char strings[NUM_COLUMNS][24]) {
+    for (int c = 0; c < NUM_COLUMNS; c++) {
+        record_value_t* v = &values[c];
+        memset(v, 0, sizeof(*v));
+        v->is_null = (id + c) % 13 == 0;
+        switch (column_type(c)) {
+        case TYPE_INT64:
+            v->i = (int64_t)(id * 31 + c);
+            break;
+        case TYPE_FLOAT64:
+            v->f = (double)id / (c + 1);
+            break;
+        default:
+            v->len  = (uint16_t)snprintf(strings[c], 24, "value-%llu-%d",
+                                         (unsigned long long)(id % 1000), c);
+            v->data = strings[c];
+            break;
+        }
+    }
+}
+
+/* Sequential format: per field a null byte, then the value, strings with a u16 length */
+static uint16_t seq_encode(const record_value_t* values, uint8_t* out) {
+    uint16_t n = 0;
+    for (int c = 0; c < NUM_COLUMNS; c++) {
+        const record_value_t* v = &values[c];
+        out[n++]                = v->is_null;
+        if (v->is_null)
+            continue;
+        switch (column_type(c)) {
+        case TYPE_INT64:
+            memcpy(out + n, &v->i, 8);
+            n += 8;
+            break;
+        case TYPE_FLOAT64:
+            memcpy(out + n, &v->f, 8);
+            n += 8;
+            break;
+        default:
+            memcpy(out + n, &v->len, 2);
+            memcpy(out + n + 2, v->data, v->len);
+            n = (uint16_t)(n + 2 + v->len);
+            break;
+        }
+    }
+    return n;
+}
+
+/* Position of field col of a sequential row, stepping over the fields before it */
+static const uint8_t* seq_field(const uint8_t* rec, int col, bool* is_null) {
+    const uint8_t* p = rec;
+    for (int c = 0;; c++) {
+        bool null = *p++;
+        if (c == col) {
+            *is_null = null;
+            return p;
+        }
+        if (null)
+            continue;
+        if (column_type(c) == TYPE_TEXT) {
+            uint16_t len;
+            memcpy(&len, p, 2);
+            p += 2 + len;
+        } else {
+            p += 8;
+        }
+    }
+}
+
+static void seq_decode(const uint8_t* rec, record_value_t* values) {
+    const uint8_t* p = rec;
+    for (int c = 0; c < NUM_COLUMNS; c++) {
+        record_value_t* v = &values[c];
+        memset(v, 0, sizeof(*v));
+        v->is_null = *p++;
+        if (v->is_null)
+            continue;
+        if (column_type(c) == TYPE_TEXT) {
+            memcpy(&v->len, p, 2);
+            v->data = p + 2;
+            p += 2 + v->len;
+        } else {
+            memcpy(column_type(c) == TYPE_INT64 ? (void*)&v->i : (void*)&v->f, p, 8);
+            p += 8;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t rows   = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+    uint32_t passes = argc > 2 ? (uint32_t)atoi(argv[2]) : 20;
+
+    type_id_t types[NUM_COLUMNS];
+    for (int c = 0; c < NUM_COLUMNS; c++)
+        types[c] = column_type(c);
+    record_layout_t* layout = record_layout_create(types, NUM_COLUMNS);
+    uint8_t*         packed = (uint8_t*)malloc((size_t)rows * MAX_ROW);
+    uint8_t*         seq    = (uint8_t*)malloc((size_t)rows * MAX_ROW);
+    uint16_t*        lens   = (uint16_t*)malloc(rows * sizeof(uint16_t));
+    if (!layout || !packed || !seq || !lens) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("MonoDB record format benchmark: %u rows, %d columns, %u passes\n\n", rows,
+           NUM_COLUMNS, passes);
+
+    static record_value_t sources[NUM_SOURCES][NUM_COLUMNS];
+    static char           strings[NUM_SOURCES][NUM_COLUMNS][24];
+    for (uint32_t r = 0; r < NUM_SOURCES; r++)
+        make_row(r, sources[r], strings[r]);
+
+    record_value_t values[NUM_COLUMNS];
+    double         t_encode[2] = {0, 0}, t_decode[2] = {0, 0};
+    double         t_fixed[2] = {0, 0}, t_last[2] = {0, 0};
+    uint64_t       bytes[2] = {0, 0}, check[2] = {0, 0};
+
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        double start = now_sec();
+        for (uint32_t r = 0; r < rows; r++) {
+            lens[r] = record_encode(layout, sources[r % NUM_SOURCES], packed + (size_t)r * MAX_ROW,
+                                    MAX_ROW);
+            if (pass == 0)
+                bytes[0] += lens[r];
+        }
+        t_encode[0] += now_sec() - start;
+
+        start = now_sec();
+        for (uint32_t r = 0; r < rows; r++) {
+            uint16_t n = seq_encode(sources[r % NUM_SOURCES], seq + (size_t)r * MAX_ROW);
+            if (pass == 0)
+                bytes[1] += n;
+        }
+        t_encode[1] += now_sec() - start;
+
+        /* Decode every field */
+        start = now_sec();
+        for (uint32_t r = 0; r < rows; r++) {
+            record_decode(layout, packed + (size_t)r * MAX_ROW, lens[r], values);
+            check[0] += (uint64_t)values[NUM_COLUMNS - 2].i + values[NUM_COLUMNS - 1].len;
+        }
+        t_decode[0] += now_sec() - start;
+
+        start = now_sec();
+        for (uint32_t r = 0; r < rows; r++) {
+            seq_decode(seq + (size_t)r * MAX_ROW, values);
+            check[1] += (uint64_t)values[NUM_COLUMNS - 2].i + values[NUM_COLUMNS - 1].len;
+        }
+        t_decode[1] += now_sec() - start;
+
+        /* One fixed-width field near the end */
+        start = now_sec();
+        for (uint32_t r = 0; r < rows; r++) {
+            const uint8_t* rec = packed + (size_t)r * MAX_ROW;
+            if (!record_is_null(rec, NUM_COLUMNS - 2))
+                check[0] += (uint64_t)record_get_i64(layout, rec, NUM_COLUMNS - 2);
+        }
+        t_fixed[0] += now_sec() - start;
+
+        start = now_sec();
+        for (uint32_t r = 0; r < rows; r++) {
+            bool           null;
+            const uint8_t* p = seq_field(seq + (size_t)r * MAX_ROW, NUM_COLUMNS - 2, &null);
+            int64_t        v;
+            memcpy(&v, p, 8);
+            if (!null)
+                check[1] += (uint64_t)v;
+        }
+        t_fixed[1] += now_sec() - start;
+
+        /* The last string */
+        start = now_sec();
+        for (uint32_t r = 0; r < rows; r++) {
+            uint16_t len;
+            record_get_bytes(layout, packed + (size_t)r * MAX_ROW, NUM_COLUMNS - 1, &len);
+            check[0] += len;
+        }
+        t_last[0] += now_sec() - start;
+
+        start = now_sec();
+        for (uint32_t r = 0; r < rows; r++) {
+            bool           null;
+            const uint8_t* p = seq_field(seq + (size_t)r * MAX_ROW, NUM_COLUMNS - 1, &null);
+            uint16_t       len = 0;
+            if (!null)
+                memcpy(&len, p, 2);
+            check[1] += len;
+        }
+        t_last[1] += now_sec() - start;
+    }
+
+    double n = (double)rows * passes / 1e9;
+    printf("format       bytes/row   encode ns   decode ns   fixed ns   last str ns\n");
+    printf("compact      %9.1f   %9.1f   %9.1f   %8.1f   %11.1f\n", (double)bytes[0] / rows,
+           t_encode[0] / n, t_decode[0] / n, t_fixed[0] / n, t_last[0] / n);
+    printf("sequential   %9.1f   %9.1f   %9.1f   %8.1f   %11.1f\n", (double)bytes[1] / rows,
+           t_encode[1] / n, t_decode[1] / n, t_fixed[1] / n, t_last[1] / n);
+    if (check[0] != check[1])
+        printf("  (formats disagree: %llu vs %llu)\n", (unsigned long long)check[0],
+               (unsigned long long)check[1]);
+
+    record_layout_destroy(layout);
+    free(packed);
+    free(seq);
+    free(lens);
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file bench_tier.c
+ * @brief Scans of cold data kept in the heap versus tiered into compressed segments
+ *
+ * Sensors report readings in time order and most of them are old. One
+ * table keeps every reading in its heap; the other moves readings older
+ * than a cut-off into a tier segment. The benchmark reports the storage
+ * the cold readings take and times three scans over both tables: a full
+ * aggregate, a filter on recent readings and a filter on an old time
+ * window, where the zone maps of the segment skip most blocks.
+ *
+ * Usage: bench_tier [sensors] [readings_per_sensor] [cold_percent] [repeats]
+ */
+
+#include <monodb/core/data/table.h>
+#include <monodb/core/storage/buffer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POOL_FRAMES 1024
+
+typedef struct {
+    uint32_t sensor;
+    uint32_t ts;
+    double   value;
+    char     payload[80];
+} reading_t;
+
+static const tier_layout_t reading_layout = {sizeof(reading_t),
+                                             4,
+                                             {{0, 4, TIER_COLUMN_UINT},
+                                              {4, 4, TIER_COLUMN_UINT},
+                                              {8, 8, TIER_COLUMN_BYTES},
+                                              {16, 80, TIER_COLUMN_BYTES}}};
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static bool older_than(const void* data, uint16_t len, void* arg) {
+    (void)len;
+    return ((const reading_t*)data)->ts < *(const uint32_t*)arg;
+}
+
+static void load(table_t* table, uint32_t sensors, uint32_t readings) {
+    for (uint32_t ts = 0; ts < readings; ts++) {
+        for (uint32_t s = 0; s < sensors; s++) {
+            reading_t r = {s, ts, (double)(s + ts), {0}};
+            snprintf(r.payload, sizeof(r.payload), "sensor-%u firmware 2.1 ok", s);
+            table_insert(table, &r, sizeof(r), 1, NULL);
+        }
+    }
+}
+
+/* Sum the values of the rows a scan returns; returns the elapsed time */
+static double run_scan(table_t* table, const tier_filter_t* filter, uint32_t repeats,
+                       double* checksum, uint64_t* rows) {
+    double start = now_sec();
+    *checksum    = 0;
+    *rows        = 0;
+    for (uint32_t i = 0; i < repeats; i++) {
+        table_scan_t* scan = table_scan_begin(table, filter);
+        tuple_id_t    tid;
+        const void*   data;
+        uint16_t      len;
+        while (table_scan_next(scan, &tid, &data, &len)) {
+            *checksum += ((const reading_t*)data)->value;
+            (*rows)++;
+        }
+        table_scan_end(scan);
+    }
+    return now_sec() - start;
+}
+
+static void compare(const char* name, table_t* heap, table_t* tiered, const tier_filter_t* filter,
+                    uint32_t repeats) {
+    double   heap_sum, tier_sum;
+    uint64_t heap_rows, tier_rows;
+    double   heap_time = run_scan(heap, filter, repeats, &heap_sum, &heap_rows);
+    double   tier_time = run_scan(tiered, filter, repeats, &tier_sum, &tier_rows);
+    printf("%-14s heap %.3fs  tiered %.3fs  (%5.2fx, %llu rows, checksums %s)\n", name,
+           heap_time, tier_time, heap_time / tier_time, (unsigned long long)(tier_rows / repeats),
+           heap_sum == tier_sum && heap_rows == tier_rows ? "match" : "DIFFER");
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t sensors  = argc > 1 ? (uint32_t)atoi(argv[1]) : 64;
+    uint32_t readings = argc > 2 ? (uint32_t)atoi(argv[2]) : 4000;
+    uint32_t cold_pct = argc > 3 ? (uint32_t)atoi(argv[3]) : 75;
+    uint32_t repeats  = argc > 4 ? (uint32_t)atoi(argv[4]) : 5;
+    uint32_t cutoff   = readings * cold_pct / 100;
+
+    printf("MonoDB tiered storage benchmark: %u sensors x %u readings, %u%% cold, %u frames\n",
+           sensors, readings, cold_pct, POOL_FRAMES);
+
+    const char* heap_path = "./bench_tier_heap.db";
+    const char* tier_path = "./bench_tier_tiered.db";
+    char        seg_path[64], manifest_path[64];
+    snprintf(seg_path, sizeof(seg_path), "%s.tier0", tier_path);
+    snprintf(manifest_path, sizeof(manifest_path), "%s.tiers", tier_path);
+    remove(heap_path);
+    remove(tier_path);
+    remove(seg_path);
+    remove(manifest_path);
+
+    buffer_pool_t* pool   = buffer_pool_create(POOL_FRAMES);
+    table_t*       heap   = pool ? table_open(pool, heap_path) : NULL;
+    table_t*       tiered = pool ? table_open(pool, tier_path) : NULL;
+
+    table_tier_policy_t policy = {reading_layout, older_than, &cutoff, 1, 1000, 2};
+    if (!heap || !tiered || !table_set_tier_policy(heap, &policy) ||
+        !table_set_tier_policy(tiered, &policy)) {
+        fprintf(stderr, "Failed to create benchmark tables\n");
+        return 1;
+    }
+
+    load(heap, sensors, readings);
+    load(tiered, sensors, readings);
+
+    uint64_t moved;
+    double   start = now_sec();
+    if (!table_tier(tiered, &moved)) {
+        fprintf(stderr, "Tiering pass failed\n");
+        return 1;
+    }
+    double tier_time = now_sec() - start;
+    buffer_flush_all(pool);
+
+    tier_segment_stats_t stats;
+    table_get_tier_stats(tiered, &stats);
+    printf("tiering pass   %.3fs, %llu rows: %.1f MB in the heap -> %.1f MB segment (%.1fx)\n",
+           tier_time, (unsigned long long)moved, (double)stats.raw_size / (1 << 20),
+           (double)stats.file_size / (1 << 20), (double)stats.raw_size / (double)stats.file_size);
+
+    tier_filter_t recent = {1, cutoff + (readings - cutoff) / 2, UINT32_MAX};
+    tier_filter_t window = {1, cutoff / 3, cutoff / 3 + 50};
+
+    compare("full scan", heap, tiered, NULL, repeats);
+    compare("recent range", heap, tiered, &recent, repeats);
+    compare("cold window", heap, tiered, &window, repeats);
+
+    table_get_tier_stats(tiered, &stats);
+    printf("segment blocks decoded %llu, skipped %llu\n",
+           (unsigned long long)stats.blocks_read, (unsigned long long)stats.blocks_skipped);
+
+    table_close(heap);
+    table_close(tiered);
+    buffer_pool_destroy(pool);
+    remove(heap_path);
+    remove(tier_path);
+    remove(seg_path);
+    remove(manifest_path);
+    return 0;
+}
@@ -0,0 +1,240 @@
+/**
+ * @file bench_ycsb.c
+ * @brief Multi-threaded B+tree throughput under YCSB-style read/insert mixes
+ *
+ * A tree is loaded with records under hashed keys, then threads run a mix
+ * of point reads and inserts of new records. Reads pick records with the
+ * skewed (Zipfian) popularity YCSB uses, so a few leaves are hot. Each mix
+ * runs at 1, 2, 4, ... threads with two latching schemes: the tree's own
+ * optimistic lock coupling, and a tree-wide reader/writer lock around every
+ * operation, which is how the tree was latched before.
+ *
+ * Usage: bench_ycsb [records] [ops_per_thread] [max_threads]
+ */
+
+#include <math.h>
+#include <monodb/core/common/sync.h>
+#include <monodb/core/data/btree.h>
+#include <monodb/core/storage/buffer.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POOL_FRAMES 8192
+#define VALUE_SIZE  32
+#define ZIPF_THETA  0.99
+
+typedef struct {
+    const char* name;
+    uint32_t    read_pct;
+} workload_t;
+
+static const workload_t workloads[] = {
+    {"read-only", 100},
+    {"95/5 read/insert", 95},
+    {"50/50 read/insert", 50},
+    {"5/95 read/insert", 5},
+};
+
+/**
+ * Zipfian generator over [0, n) (Gray et al., as in YCSB)
+ */
+typedef struct {
+    uint64_t n;
+    double   theta, alpha, zetan, eta;
+} zipf_t;
+
+/**
+ * Shared state of one run
+ */
+typedef struct {
+    btree_t*         tree;
+    const zipf_t*    zipf;
+    bool             coarse;  /* Wrap every operation in the tree-wide lock */
+    sync_rwlock_t    lock;    /* Tree-wide lock of the coarse scheme */
+    uint32_t         read_pct;
+    uint32_t         ops;     /* Operations per thread */
+    _Atomic uint64_t next_id; /* Next record ID to insert */
+} run_t;
+
+typedef struct {
+    run_t*   run;
+    uint64_t seed;
+    uint64_t misses; /* Reads that did not find their record */
+} thread_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void zipf_init(zipf_t* z, uint64_t n, double theta) {
+    double zeta2 = 0;
+    z->n         = n;
+    z->theta     = theta;
+    z->zetan     = 0;
+    for (uint64_t i = 1; i <= n; i++)
+        z->zetan += 1.0 / pow((double)i, theta);
+    for (uint64_t i = 1; i <= 2; i++)
+        zeta2 += 1.0 / pow((double)i, theta);
+    z->alpha = 1.0 / (1.0 - theta);
+    z->eta   = (1.0 - pow(2.0 / (double)n, 1.0 - theta)) / (1.0 - zeta2 / z->zetan);
+}
+
+static uint64_t zipf_next(const zipf_t* z, uint64_t* state) {
+    double u  = (double)(next_random(state) >> 11) / (double)(1ull << 53);
+    double uz = u * z->zetan;
+    if (uz < 1.0)
+        return 0;
+    if (uz < 1.0 + pow(0.5, z->theta))
+        return 1;
+    uint64_t v = (uint64_t)((double)z->n * pow(z->eta * u - z->eta + 1.0, z->alpha));
+    return v < z->n ? v : z->n - 1;
+}
+
+/* Hash record IDs so that popular and new records spread over the whole key space */
+static void encode_key(uint8_t* key, uint64_t id) {
+    uint64_t h = id * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 29;
+    for (int i = 0; i < 8; i++)
+        key[i] = (uint8_t)(h >> (56 - 8 * i));
+}
+
+static void* worker_main(void* arg) {
+    thread_t* thread = (thread_t*)arg;
+    run_t*    run    = thread->run;
+    uint8_t   key[8];
+    uint8_t   value[VALUE_SIZE];
+    memset(value, 'v', sizeof(value));
+
+    for (uint32_t i = 0; i < run->ops; i++) {
+        bool read = next_random(&thread->seed) % 100 < run->read_pct;
+        if (read) {
+            encode_key(key, zipf_next(run->zipf, &thread->seed));
+            if (run->coarse)
+                sync_rwlock_rdlock(&run->lock);
+            if (!btree_get(run->tree, key, sizeof(key), value, sizeof(value), NULL))
+                thread->misses++;
+            if (run->coarse)
+                sync_rwlock_rdunlock(&run->lock);
+        } else {
+            encode_key(key, atomic_fetch_add(&run->next_id, 1));
+            if (run->coarse)
+                sync_rwlock_wrlock(&run->lock);
+            btree_insert(run->tree, key, sizeof(key), value, sizeof(value));
+            if (run->coarse)
+                sync_rwlock_wrunlock(&run->lock);
+        }
+    }
+    return NULL;
+}
+
+static btree_t* load_tree(buffer_pool_t* pool, const char* path, uint64_t records) {
+    remove(path);
+    btree_t* tree = btree_open(pool, path);
+    uint8_t  key[8];
+    uint8_t  value[VALUE_SIZE];
+    memset(value, 'v', sizeof(value));
+    for (uint64_t id = 0; tree && id < records; id++) {
+        encode_key(key, id);
+        btree_insert(tree, key, sizeof(key), value, sizeof(value));
+    }
+    return tree;
+}
+
+/* Run one mix at a thread count; returns operations per second */
+static double run_mix(run_t* run, uint32_t threads, uint64_t* misses) {
+    sync_thread_t* handles = (sync_thread_t*)calloc(threads, sizeof(sync_thread_t));
+    thread_t*      state   = (thread_t*)calloc(threads, sizeof(thread_t));
+    double         start   = now_sec();
+
+    for (uint32_t t = 0; t < threads; t++) {
+        state[t] = (thread_t){run, 0x2545F4914F6CDD1Dull * (t + 1), 0};
+        sync_thread_create(&handles[t], worker_main, &state[t]);
+    }
+    *misses = 0;
+    for (uint32_t t = 0; t < threads; t++) {
+        sync_thread_join(handles[t]);
+        *misses += state[t].misses;
+    }
+
+    double elapsed = now_sec() - start;
+    free(handles);
+    free(state);
+    return (double)threads * run->ops / elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t records     = argc > 1 ? (uint64_t)atoll(argv[1]) : 200000;
+    uint32_t ops         = argc > 2 ? (uint32_t)atoi(argv[2]) : 200000;
+    uint32_t max_threads = argc > 3 ? (uint32_t)atoi(argv[3]) : 8;
+
+    printf("MonoDB YCSB-style B+tree benchmark: %llu records, %u ops per thread, "
+           "Zipfian reads (theta %.2f), %u frames\n",
+           (unsigned long long)records, ops, ZIPF_THETA, POOL_FRAMES);
+
+    zipf_t zipf;
+    zipf_init(&zipf, records, ZIPF_THETA);
+
+    buffer_pool_t* pool = buffer_pool_create(POOL_FRAMES);
+    if (!pool) {
+        fprintf(stderr, "Failed to create buffer pool\n");
+        return 1;
+    }
+
+    const char* path = "./bench_ycsb.db";
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        printf("\n%s\n", workloads[w].name);
+        printf("  threads   optimistic (ops/s)   tree lock (ops/s)   ratio   restarts\n");
+
+        for (uint32_t threads = 1; threads <= max_threads; threads *= 2) {
+            double   rate[2];
+            uint64_t restarts = 0;
+            for (int coarse = 0; coarse < 2; coarse++) {
+                /* Fresh tree per run, so inserts of earlier runs do not change its size */
+                btree_t* tree = load_tree(pool, path, records);
+                if (!tree) {
+                    fprintf(stderr, "Failed to load %s\n", path);
+                    return 1;
+                }
+
+                run_t run = {.tree     = tree,
+                             .zipf     = &zipf,
+                             .coarse   = coarse != 0,
+                             .read_pct = workloads[w].read_pct,
+                             .ops      = ops};
+                sync_rwlock_init(&run.lock);
+                atomic_init(&run.next_id, records);
+
+                btree_stats_t before, after;
+                uint64_t      misses;
+                btree_get_stats(tree, &before);
+                rate[coarse] = run_mix(&run, threads, &misses);
+                btree_get_stats(tree, &after);
+                if (!coarse)
+                    restarts = after.restarts - before.restarts;
+                if (misses > 0)
+                    printf("  (%llu reads missed)\n", (unsigned long long)misses);
+
+                sync_rwlock_destroy(&run.lock);
+                btree_close(tree);
+                remove(path);
+            }
+            printf("  %7u   %18.0f   %17.0f   %5.2fx   %llu\n", threads, rate[0], rate[1],
+                   rate[0] / rate[1], (unsigned long long)restarts);
+        }
+    }
+
+    buffer_pool_destroy(pool);
+    return 0;
+}
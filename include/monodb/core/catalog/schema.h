@@ -0,0 +1,351 @@
+/**
+ * @file schema.h
+ * @brief In-memory catalog of tables and columns, read without locks.
+ *
+ * The catalog is a chain of immutable snapshots. A reader enters the
+ * catalog through its own reader handle, gets the current snapshot and
+ * may look up any table or column in it until it leaves; nothing it sees
+ * changes meanwhile. DDL builds a new snapshot from the current one under
+ * the catalog's mutex and publishes it with one atomic store, so readers
+ * never wait for DDL and DDL never waits for readers.
+ *
+ * Replaced snapshots are reclaimed by epoch. Entering stores the global
+ * epoch in the reader's slot; publishing retires the old snapshot at the
+ * current epoch and advances it. A retired snapshot is freed once every
+ * reader has either left or entered at a later epoch, since such a
+ * reader can only have loaded a newer snapshot. Reclamation runs after
+ * each DDL and in catalog_reclaim(); a reader that stays inside the
+ * catalog only delays it.
+ *
+ * A reader handle belongs to one thread (a session or worker) at a time,
+ * and enter/leave do not nest.
+ *
+ * Adding a column only publishes a new snapshot: the column records the
+ * table version that added it and its default, and rows written before
+ * that version are read with the default (see record_schema_t in
+ * record.h) until they are next updated. The cost of the DDL does not
+ * depend on the size of the table.
+ *
+ * Planner statistics (see analyze.h) are stored per table and published
+ * like DDL, without changing the table's version. They are not logged:
+ * after recovery, ANALYZE builds them again.
+ *
+ * With a WAL attached, every DDL statement is logged as one
+ * WAL_RECORD_SCHEMA record before its snapshot is published, and
+ * catalog_redo() replays those records into an empty catalog. Records
+ * carry transaction ID 0 and identify tables by identifier.
+ */
+
+#pragma once
+
+#include <monodb/core/catalog/type_system.h>
+#include <monodb/core/storage/wal.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Longest table or column name, without the terminator
+ */
+#define CATALOG_NAME_MAX 63
+
+/**
+ * Maximum number of columns of a table
+ */
+#define CATALOG_MAX_COLUMNS 1024
+
+/**
+ * Column of a table definition
+ */
+typedef struct {
+    const char* name;     /* Column name */
+    type_id_t   type;     /* Column type */
+    bool        nullable; /* Whether the column accepts NULL */
+} catalog_column_def_t;
+
+/**
+ * Column of a table in a snapshot
+ *
+ * A default is stored as the value itself: 1 byte for TYPE_BOOL, the
+ * native representation for the other fixed-width types and the bytes
+ * for TYPE_TEXT and TYPE_BYTES.
+ */
+typedef struct {
+    const char* name;         /* Column name */
+    type_id_t   type;         /* Column type */
+    bool        nullable;     /* Whether the column accepts NULL */
+    uint16_t    ordinal;      /* Position in the table, from 0 */
+    uint32_t    since;        /* Table version that added the column, 1 if created with it */
+    const void* default_data; /* Default for rows older than the column, NULL for NULL */
+    uint16_t    default_len;  /* Default length */
+} catalog_column_t;
+
+/**
+ * Value in planner statistics, stored like a column default
+ */
+typedef struct {
+    const void* data; /* Value */
+    uint16_t    len;  /* Its length */
+} catalog_value_t;
+
+/**
+ * Planner statistics of a column, estimated from a sample
+ */
+typedef struct {
+    double                 null_frac;  /* Fraction of rows holding NULL */
+    double                 ndv;        /* Distinct non-NULL values in the table */
+    double                 avg_width;  /* Average length of the non-NULL values */
+    uint16_t               num_mcvs;   /* Most common values */
+    const catalog_value_t* mcvs;       /* Most common values, most frequent first */
+    const double*          mcv_freqs;  /* Fraction of all rows holding each */
+    uint16_t               num_bounds; /* Histogram bounds, 0 or buckets + 1 */
+    const catalog_value_t* bounds;     /* Equi-depth histogram of the other values, ascending */
+    uint16_t               hll_size;   /* HyperLogLog registers */
+    const uint8_t*         hll;        /* HyperLogLog sketch of the sampled values */
+} catalog_column_stats_t;
+
+/**
+ * Planner statistics of a table
+ */
+typedef struct {
+    double                        rows;          /* Estimated live rows */
+    uint32_t                      pages;         /* Pages of the table */
+    uint32_t                      sampled_pages; /* Pages read */
+    uint32_t                      sampled_rows;  /* Rows in the sample */
+    uint64_t                      changes;       /* Row changes counted when taken */
+    uint16_t                      num_columns;   /* Columns, fewer than the table's if some were
+                                                    added since */
+    const catalog_column_stats_t* columns;       /* Statistics of each column */
+} catalog_table_stats_t;
+
+/**
+ * Table in a snapshot
+ */
+typedef struct {
+    uint32_t                     id;          /* Table identifier, never reused */
+    const char*                  name;        /* Table name */
+    uint32_t                     version;     /* Schema version, advanced by DDL on the table */
+    uint16_t                     num_columns; /* Columns */
+    const catalog_column_t*      columns;     /* Columns in ordinal order */
+    const catalog_table_stats_t* stats;       /* Planner statistics, NULL until analyzed */
+} catalog_table_t;
+
+/**
+ * Catalog statistics
+ */
+typedef struct {
+    uint64_t version;   /* Version of the current snapshot */
+    uint64_t epoch;     /* Global epoch */
+    uint32_t readers;   /* Reader handles */
+    uint32_t retired;   /* Replaced snapshots not yet freed */
+    uint64_t reclaimed; /* Replaced snapshots freed */
+} catalog_stats_t;
+
+/**
+ * Catalog context (opaque)
+ */
+typedef struct catalog_t catalog_t;
+
+/**
+ * Reader handle (opaque)
+ */
+typedef struct catalog_reader_t catalog_reader_t;
+
+/**
+ * Immutable catalog snapshot (opaque)
+ */
+typedef struct catalog_snapshot_t catalog_snapshot_t;
+
+/**
+ * Create an empty catalog
+ *
+ * @return Catalog or NULL on error
+ */
+catalog_t* catalog_create(void);
+
+/**
+ * Destroy a catalog; no reader may be inside it
+ *
+ * @param catalog Catalog (may be NULL)
+ */
+void catalog_destroy(catalog_t* catalog);
+
+/**
+ * Register a reader
+ *
+ * @param catalog Catalog
+ * @return Reader handle or NULL on error
+ */
+catalog_reader_t* catalog_reader_open(catalog_t* catalog);
+
+/**
+ * Unregister a reader that is not inside the catalog
+ *
+ * @param reader Reader handle (may be NULL)
+ */
+void catalog_reader_close(catalog_reader_t* reader);
+
+/**
+ * Enter the catalog and get the current snapshot, without locking
+ *
+ * @param reader Reader handle
+ * @return Snapshot, valid until catalog_leave()
+ */
+const catalog_snapshot_t* catalog_enter(catalog_reader_t* reader);
+
+/**
+ * Leave the catalog; the snapshot may then be freed
+ *
+ * @param reader Reader handle
+ */
+void catalog_leave(catalog_reader_t* reader);
+
+/**
+ * Get the version of a snapshot; each DDL publishes the next one
+ *
+ * @param snapshot Snapshot
+ * @return Version, 0 for the empty catalog
+ */
+uint64_t catalog_snapshot_version(const catalog_snapshot_t* snapshot);
+
+/**
+ * Get the number of tables of a snapshot
+ *
+ * @param snapshot Snapshot
+ * @return Number of tables
+ */
+uint32_t catalog_num_tables(const catalog_snapshot_t* snapshot);
+
+/**
+ * Get a table of a snapshot by position, in identifier order
+ *
+ * @param snapshot Snapshot
+ * @param index Position, below catalog_num_tables()
+ * @return Table or NULL
+ */
+const catalog_table_t* catalog_table_at(const catalog_snapshot_t* snapshot, uint32_t index);
+
+/**
+ * Find a table by name
+ *
+ * @param snapshot Snapshot
+ * @param name Table name
+ * @return Table or NULL
+ */
+const catalog_table_t* catalog_find_table(const catalog_snapshot_t* snapshot, const char* name);
+
+/**
+ * Find a table by identifier
+ *
+ * @param snapshot Snapshot
+ * @param id Table identifier
+ * @return Table or NULL
+ */
+const catalog_table_t* catalog_get_table(const catalog_snapshot_t* snapshot, uint32_t id);
+
+/**
+ * Find a column of a table by name
+ *
+ * @param table Table
+ * @param name Column name
+ * @return Column or NULL
+ */
+const catalog_column_t* catalog_find_column(const catalog_table_t* table, const char* name);
+
+/**
+ * Create a table and publish the new snapshot
+ *
+ * @param catalog Catalog
+ * @param name Table name, unique, at most CATALOG_NAME_MAX bytes
+ * @param columns Column definitions, names unique within the table
+ * @param num_columns Number of columns, 1..CATALOG_MAX_COLUMNS
+ * @param id Output: table identifier (may be NULL)
+ * @return true on success, false if a name is taken or invalid, a type unknown, or on error
+ */
+bool catalog_create_table(catalog_t* catalog, const char* name,
+                          const catalog_column_def_t* columns, uint16_t num_columns,
+                          uint32_t* id);
+
+/**
+ * Drop a table and publish the new snapshot
+ *
+ * @param catalog Catalog
+ * @param name Table name
+ * @return true on success, false if there is no such table or on error
+ */
+bool catalog_drop_table(catalog_t* catalog, const char* name);
+
+/**
+ * Rename a table and publish the new snapshot
+ *
+ * @param catalog Catalog
+ * @param name Current name
+ * @param new_name New name, not taken
+ * @return true on success, false if there is no such table, the new name is taken or invalid,
+ *         or on error
+ */
+bool catalog_rename_table(catalog_t* catalog, const char* name, const char* new_name);
+
+/**
+ * Add a column at the end of a table and publish the new snapshot
+ *
+ * Existing rows are not touched; they read the default until rewritten.
+ *
+ * @param catalog Catalog
+ * @param name Table name
+ * @param column Column definition, its name not taken in the table
+ * @param default_data Default value (see catalog_column_t), NULL for NULL
+ * @param default_len Default length, the type's size for fixed-width types
+ * @return true on success, false if there is no such table, the column is invalid or its name
+ *         taken, the table is full, a NOT NULL column has no default, the default does not
+ *         fit the type, or on error
+ */
+bool catalog_add_column(catalog_t* catalog, const char* name, const catalog_column_def_t* column,
+                        const void* default_data, uint16_t default_len);
+
+/**
+ * Store the planner statistics of a table and publish the new snapshot
+ *
+ * @param catalog Catalog
+ * @param name Table name
+ * @param stats Statistics (copied), at most as many columns as the table has
+ * @return true on success, false if there is no such table, the statistics have too many
+ *         columns, or on error
+ */
+bool catalog_set_stats(catalog_t* catalog, const char* name, const catalog_table_stats_t* stats);
+
+/**
+ * Log DDL to a WAL from now on. Records carry transaction ID 0; nothing
+ * else may write to the WAL while DDL runs.
+ *
+ * @param catalog Catalog
+ * @param wal WAL context, or NULL to stop logging
+ */
+void catalog_set_wal(catalog_t* catalog, wal_context_t* wal);
+
+/**
+ * Replay one WAL record into the catalog, during recovery and in log order
+ * from an empty catalog. Records other than WAL_RECORD_SCHEMA are ignored.
+ *
+ * @param catalog Catalog, not logging to a WAL
+ * @param header Record header
+ * @param data Record payload
+ * @return true on success or if the record is ignored, false if it is malformed or does not
+ *         apply to the catalog
+ */
+bool catalog_redo(catalog_t* catalog, const wal_record_header_t* header, const void* data);
+
+/**
+ * Free the replaced snapshots no reader can still hold
+ *
+ * @param catalog Catalog
+ * @return Number of snapshots freed
+ */
+uint32_t catalog_reclaim(catalog_t* catalog);
+
+/**
+ * Get catalog statistics
+ *
+ * @param catalog Catalog
+ * @param stats Output statistics
+ */
+void catalog_get_stats(catalog_t* catalog, catalog_stats_t* stats);
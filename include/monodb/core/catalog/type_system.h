@@ -0,0 +1,195 @@
+/**
+ * @file type_system.h
+ * @brief Column types.
+ *
+ * Every column has one of a small set of types. Fixed-width types have a
+ * size known from the type alone and are stored in native byte order;
+ * variable-length types (text and raw bytes) are stored with a length.
+ *
+ * A string dictionary maps the distinct values of a low-cardinality text
+ * column (a status, a country, a plan) to dense integer codes, in the
+ * order the values were first seen. Rows then store the code, equality
+ * predicates and grouping work on codes, and a value is looked up only to
+ * be output. A dictionary has a fixed capacity: once it is full, further
+ * new values get no code and stay inline, so a column that turns out not
+ * to be low-cardinality degrades to plain strings rather than failing.
+ * Lookups and code-to-value reads take no lock; adding a value takes the
+ * dictionary's mutex.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Column type
+ */
+typedef enum {
+    TYPE_BOOL    = 0, /* 1 byte, 0 or 1 */
+    TYPE_INT32   = 1, /* 4-byte signed integer */
+    TYPE_INT64   = 2, /* 8-byte signed integer */
+    TYPE_FLOAT64 = 3, /* 8-byte IEEE 754 double */
+    TYPE_TEXT    = 4, /* Variable-length UTF-8 string */
+    TYPE_BYTES   = 5  /* Variable-length byte string */
+} type_id_t;
+
+/**
+ * Number of column types
+ */
+#define TYPE_COUNT 6
+
+/**
+ * Get the stored size of a fixed-width type
+ *
+ * @param type Column type
+ * @return Size in bytes, 0 for variable-length or unknown types
+ */
+uint16_t type_fixed_size(type_id_t type);
+
+/**
+ * Check whether a type is stored with a length
+ *
+ * @param type Column type
+ * @return true for TYPE_TEXT and TYPE_BYTES
+ */
+bool type_is_variable(type_id_t type);
+
+/**
+ * Check whether a value is a known type
+ *
+ * @param type Value to check
+ * @return true if type names a column type
+ */
+bool type_is_valid(type_id_t type);
+
+/**
+ * Compare two values of a type, each given as the value itself: 1 byte
+ * for TYPE_BOOL, the native representation for the other fixed-width
+ * types and the bytes for TYPE_TEXT and TYPE_BYTES
+ *
+ * @param type Column type
+ * @param a First value
+ * @param a_len Its length
+ * @param b Second value
+ * @param b_len Its length
+ * @return Negative, zero or positive as a sorts before, with or after b; strings compare
+ *         bytewise, a prefix first
+ */
+int type_compare(type_id_t type, const void* a, uint16_t a_len, const void* b, uint16_t b_len);
+
+/**
+ * Get the SQL name of a type
+ *
+ * @param type Column type
+ * @return Name, e.g. "INT64", or "UNKNOWN"
+ */
+const char* type_name(type_id_t type);
+
+/**
+ * Code of a value that is not in a dictionary
+ */
+#define TYPE_DICT_NONE UINT32_MAX
+
+/**
+ * Largest capacity of a dictionary
+ */
+#define TYPE_DICT_MAX_CODES (1u << 20)
+
+/**
+ * String dictionary (opaque)
+ */
+typedef struct type_dict_t type_dict_t;
+
+/**
+ * Create an empty dictionary
+ *
+ * @param max_codes Capacity, 1..TYPE_DICT_MAX_CODES
+ * @return Dictionary or NULL on error
+ */
+type_dict_t* type_dict_create(uint32_t max_codes);
+
+/**
+ * Destroy a dictionary
+ *
+ * @param dict Dictionary (may be NULL)
+ */
+void type_dict_destroy(type_dict_t* dict);
+
+/**
+ * Get the code of a value, adding it if it is new and there is room
+ *
+ * @param dict Dictionary
+ * @param data Value bytes
+ * @param len Value length
+ * @return Code, or TYPE_DICT_NONE if the value is new and the dictionary full
+ */
+uint32_t type_dict_encode(type_dict_t* dict, const void* data, uint16_t len);
+
+/**
+ * Get the code of a value without adding it
+ *
+ * @param dict Dictionary
+ * @param data Value bytes
+ * @param len Value length
+ * @return Code, or TYPE_DICT_NONE if the value is not in the dictionary
+ */
+uint32_t type_dict_find(const type_dict_t* dict, const void* data, uint16_t len);
+
+/**
+ * Get the value of a code
+ *
+ * @param dict Dictionary
+ * @param code Code
+ * @param len Output: value length
+ * @return Value bytes, valid until the dictionary is destroyed, or NULL for an unknown code
+ */
+const void* type_dict_value(const type_dict_t* dict, uint32_t code, uint16_t* len);
+
+/**
+ * Get the number of values; codes are 0 up to this number
+ *
+ * @param dict Dictionary
+ * @return Number of values
+ */
+uint32_t type_dict_count(const type_dict_t* dict);
+
+/**
+ * Get the capacity of a dictionary
+ *
+ * @param dict Dictionary
+ * @return Largest number of values
+ */
+uint32_t type_dict_capacity(const type_dict_t* dict);
+
+/**
+ * Get the memory held by a dictionary
+ *
+ * @param dict Dictionary
+ * @return Bytes of values and lookup tables
+ */
+size_t type_dict_memory(const type_dict_t* dict);
+
+/**
+ * Write the values of a dictionary, in code order, for storage
+ *
+ * The format is a u32 count followed by each value as a u16 length and
+ * its bytes.
+ *
+ * @param dict Dictionary
+ * @param buf Output buffer (may be NULL to get the size)
+ * @param size Size of buf
+ * @return Bytes needed; nothing is written if this exceeds size
+ */
+size_t type_dict_serialize(const type_dict_t* dict, void* buf, size_t size);
+
+/**
+ * Rebuild a dictionary written by type_dict_serialize(), with the same codes
+ *
+ * @param buf Serialized dictionary
+ * @param len Length of buf
+ * @param max_codes Capacity, at least the number of values stored
+ * @return Dictionary or NULL if buf is malformed or on error
+ */
+type_dict_t* type_dict_deserialize(const void* buf, size_t len, uint32_t max_codes);
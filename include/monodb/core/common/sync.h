@@ -0,0 +1,132 @@
+/**
+ * @file sync.h
+ * @brief Portable synchronization primitives for MonoDB.
+ *
+ * Thin inline wrappers over pthreads on POSIX systems and SRW locks /
+ * condition variables on Windows, so core modules can latch shared
+ * structures without platform conditionals of their own.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef SRWLOCK            sync_mutex_t;
+typedef SRWLOCK            sync_rwlock_t;
+typedef CONDITION_VARIABLE sync_cond_t;
+typedef HANDLE             sync_thread_t;
+
+#define SYNC_MUTEX_INITIALIZER SRWLOCK_INIT
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+typedef pthread_mutex_t  sync_mutex_t;
+typedef pthread_rwlock_t sync_rwlock_t;
+typedef pthread_cond_t   sync_cond_t;
+typedef pthread_t        sync_thread_t;
+
+#define SYNC_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
+
+/**
+ * Thread entry point
+ */
+typedef void* (*sync_thread_fn)(void* arg);
+
+#ifdef _WIN32
+
+static inline void sync_mutex_init(sync_mutex_t* m) { InitializeSRWLock(m); }
+static inline void sync_mutex_destroy(sync_mutex_t* m) { (void)m; }
+static inline void sync_mutex_lock(sync_mutex_t* m) { AcquireSRWLockExclusive(m); }
+static inline void sync_mutex_unlock(sync_mutex_t* m) { ReleaseSRWLockExclusive(m); }
+
+static inline void sync_rwlock_init(sync_rwlock_t* l) { InitializeSRWLock(l); }
+static inline void sync_rwlock_destroy(sync_rwlock_t* l) { (void)l; }
+static inline void sync_rwlock_rdlock(sync_rwlock_t* l) { AcquireSRWLockShared(l); }
+static inline void sync_rwlock_wrlock(sync_rwlock_t* l) { AcquireSRWLockExclusive(l); }
+static inline void sync_rwlock_rdunlock(sync_rwlock_t* l) { ReleaseSRWLockShared(l); }
+static inline void sync_rwlock_wrunlock(sync_rwlock_t* l) { ReleaseSRWLockExclusive(l); }
+
+static inline void sync_cond_init(sync_cond_t* c) { InitializeConditionVariable(c); }
+static inline void sync_cond_destroy(sync_cond_t* c) { (void)c; }
+static inline void sync_cond_wait(sync_cond_t* c, sync_mutex_t* m) {
+    SleepConditionVariableSRW(c, m, INFINITE, 0);
+}
+static inline void sync_cond_broadcast(sync_cond_t* c) { WakeAllConditionVariable(c); }
+
+typedef struct {
+    sync_thread_fn fn;
+    void*          arg;
+} sync_thread_start_t;
+
+static DWORD WINAPI sync_thread_trampoline(LPVOID param) {
+    sync_thread_start_t start = *(sync_thread_start_t*)param;
+    HeapFree(GetProcessHeap(), 0, param);
+    start.fn(start.arg);
+    return 0;
+}
+
+static inline bool sync_thread_create(sync_thread_t* t, sync_thread_fn fn, void* arg) {
+    sync_thread_start_t* start =
+        (sync_thread_start_t*)HeapAlloc(GetProcessHeap(), 0, sizeof(sync_thread_start_t));
+    if (!start)
+        return false;
+    start->fn  = fn;
+    start->arg = arg;
+    *t         = CreateThread(NULL, 0, sync_thread_trampoline, start, 0, NULL);
+    if (*t == NULL) {
+        HeapFree(GetProcessHeap(), 0, start);
+        return false;
+    }
+    return true;
+}
+
+static inline void sync_thread_join(sync_thread_t t) {
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+
+static inline void sync_yield(void) { SwitchToThread(); }
+
+static inline void sync_sleep_ms(unsigned int ms) { Sleep(ms); }
+
+#else
+
+static inline void sync_mutex_init(sync_mutex_t* m) { pthread_mutex_init(m, NULL); }
+static inline void sync_mutex_destroy(sync_mutex_t* m) { pthread_mutex_destroy(m); }
+static inline void sync_mutex_lock(sync_mutex_t* m) { pthread_mutex_lock(m); }
+static inline void sync_mutex_unlock(sync_mutex_t* m) { pthread_mutex_unlock(m); }
+
+static inline void sync_rwlock_init(sync_rwlock_t* l) { pthread_rwlock_init(l, NULL); }
+static inline void sync_rwlock_destroy(sync_rwlock_t* l) { pthread_rwlock_destroy(l); }
+static inline void sync_rwlock_rdlock(sync_rwlock_t* l) { pthread_rwlock_rdlock(l); }
+static inline void sync_rwlock_wrlock(sync_rwlock_t* l) { pthread_rwlock_wrlock(l); }
+static inline void sync_rwlock_rdunlock(sync_rwlock_t* l) { pthread_rwlock_unlock(l); }
+static inline void sync_rwlock_wrunlock(sync_rwlock_t* l) { pthread_rwlock_unlock(l); }
+
+static inline void sync_cond_init(sync_cond_t* c) { pthread_cond_init(c, NULL); }
+static inline void sync_cond_destroy(sync_cond_t* c) { pthread_cond_destroy(c); }
+static inline void sync_cond_wait(sync_cond_t* c, sync_mutex_t* m) { pthread_cond_wait(c, m); }
+static inline void sync_cond_broadcast(sync_cond_t* c) { pthread_cond_broadcast(c); }
+
+static inline bool sync_thread_create(sync_thread_t* t, sync_thread_fn fn, void* arg) {
+    return pthread_create(t, NULL, fn, arg) == 0;
+}
+
+static inline void sync_thread_join(sync_thread_t t) { pthread_join(t, NULL); }
+
+static inline void sync_yield(void) { sched_yield(); }
+
+static inline void sync_sleep_ms(unsigned int ms) {
+    struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        continue;
+}
+
+#endif
@@ -0,0 +1,166 @@
+/**
+ * @file analyze.h
+ * @brief ANALYZE: planner statistics from a block sample of a table.
+ *
+ * ANALYZE reads a fixed number of pages however large the table is. The
+ * pages are chosen uniformly at random (selection sampling over the page
+ * numbers, read in file order), and a reservoir keeps a uniform sample of
+ * the rows on them. The row count is extrapolated from the rows per
+ * sampled page.
+ *
+ * Each column of the sample is sorted to build its statistics:
+ *
+ * - the most common values, those clearly more frequent than average,
+ *   with their frequencies;
+ * - an equi-depth histogram of the remaining values: bounds splitting
+ *   them into buckets holding the same number of sampled rows;
+ * - a HyperLogLog sketch of the sampled values. Its distinct count,
+ *   together with the number of values seen only once, is scaled up to
+ *   the table with the Haas-Stokes estimator when the sample is not the
+ *   whole table.
+ *
+ * Statistics go to the catalog (catalog_set_stats()) and are read by the
+ * estimators below. A table is analyzed again automatically once the rows
+ * changed since the last ANALYZE exceed a threshold plus a fraction of
+ * its rows; see analyze_auto().
+ *
+ * Rows are read as versioned rows of a record schema (record.h).
+ */
+
+#pragma once
+
+#include <monodb/core/catalog/schema.h>
+#include <monodb/core/data/record.h>
+#include <monodb/core/data/table.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Default number of rows kept in the sample, and of pages read
+ */
+#define ANALYZE_DEFAULT_SAMPLE 30000
+
+/**
+ * Default number of histogram buckets and most common values
+ */
+#define ANALYZE_DEFAULT_TARGET 100
+
+/**
+ * HyperLogLog precision: 2^ANALYZE_HLL_PRECISION one-byte registers
+ */
+#define ANALYZE_HLL_PRECISION 10
+
+/**
+ * HyperLogLog register count
+ */
+#define ANALYZE_HLL_SIZE (1u << ANALYZE_HLL_PRECISION)
+
+/**
+ * Default auto-analyze trigger: rows changed beyond the threshold plus this fraction of rows
+ */
+#define ANALYZE_DEFAULT_FRACTION 0.1
+
+/**
+ * Default auto-analyze threshold in rows
+ */
+#define ANALYZE_DEFAULT_THRESHOLD 50
+
+/**
+ * ANALYZE options; zero fields take their defaults
+ */
+typedef struct {
+    uint32_t sample_rows;  /* Rows kept in the sample (ANALYZE_DEFAULT_SAMPLE) */
+    uint32_t sample_pages; /* Pages read (sample_rows) */
+    uint16_t target;       /* Histogram buckets and most common values (ANALYZE_DEFAULT_TARGET) */
+    uint64_t seed;         /* Seed of the page and row choices */
+} analyze_options_t;
+
+/**
+ * Auto-analyze policy; a zero fraction takes ANALYZE_DEFAULT_FRACTION
+ */
+typedef struct {
+    double   fraction;  /* Fraction of the table's rows */
+    uint64_t threshold; /* Rows, added to the fraction */
+} analyze_policy_t;
+
+/**
+ * Add a value to a HyperLogLog sketch
+ *
+ * @param hll ANALYZE_HLL_SIZE registers, zeroed before the first value
+ * @param data Value
+ * @param len Value length
+ */
+void analyze_hll_add(uint8_t* hll, const void* data, uint16_t len);
+
+/**
+ * Merge a HyperLogLog sketch into another, which then counts both sets of values
+ *
+ * @param hll Sketch to merge into
+ * @param other Sketch to merge
+ */
+void analyze_hll_merge(uint8_t* hll, const uint8_t* other);
+
+/**
+ * Estimate the distinct values added to a HyperLogLog sketch
+ *
+ * @param hll Sketch
+ * @return Estimate
+ */
+double analyze_hll_estimate(const uint8_t* hll);
+
+/**
+ * Analyze a heap table and store its statistics in the catalog
+ *
+ * @param table Heap table
+ * @param schema Record schema of the table's rows
+ * @param catalog Catalog
+ * @param name Name of the table in the catalog, with the schema's columns
+ * @param options Options, or NULL for the defaults
+ * @return true on success, false if the table is index-organized, a row is malformed, the
+ *         catalog has no such table, or on error
+ */
+bool analyze_table(table_t* table, const record_schema_t* schema, catalog_t* catalog,
+                   const char* name, const analyze_options_t* options);
+
+/**
+ * Analyze a table if enough of its rows changed since it was last analyzed,
+ * or if it never was
+ *
+ * @param table Heap table
+ * @param schema Record schema of the table's rows
+ * @param catalog Catalog
+ * @param name Name of the table in the catalog
+ * @param policy Trigger, or NULL for the defaults
+ * @param options ANALYZE options, or NULL for the defaults
+ * @param analyzed Output: whether ANALYZE ran (may be NULL)
+ * @return true on success (analyzed or not needed), false on error
+ */
+bool analyze_auto(table_t* table, const record_schema_t* schema, catalog_t* catalog,
+                  const char* name, const analyze_policy_t* policy,
+                  const analyze_options_t* options, bool* analyzed);
+
+/**
+ * Estimate the fraction of rows equal to a value
+ *
+ * @param column Column statistics
+ * @param type Column type
+ * @param data Value, stored like a column default
+ * @param len Value length
+ * @return Selectivity in [0, 1]
+ */
+double analyze_estimate_eq(const catalog_column_stats_t* column, type_id_t type,
+                           const void* data, uint16_t len);
+
+/**
+ * Estimate the fraction of rows in an inclusive range
+ *
+ * @param column Column statistics
+ * @param type Column type
+ * @param lo Smallest value, or NULL for no lower bound
+ * @param lo_len Its length
+ * @param hi Largest value, or NULL for no upper bound
+ * @param hi_len Its length
+ * @return Selectivity in [0, 1]
+ */
+double analyze_estimate_range(const catalog_column_stats_t* column, type_id_t type,
+                              const void* lo, uint16_t lo_len, const void* hi, uint16_t hi_len);
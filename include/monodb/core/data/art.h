@@ -0,0 +1,148 @@
+/**
+ * @file art.h
+ * @brief In-memory adaptive radix tree.
+ *
+ * The tree maps byte-string keys to 64-bit values and lives entirely in
+ * memory, for indexes on tables hot enough that page-based indexes spend
+ * their time in buffer pool lookups and latches. Each inner node consumes
+ * one key byte and comes in four sizes (4, 16, 48 and 256 children), grown
+ * and shrunk as children come and go, so sparse and dense levels both stay
+ * compact. Chains of single-child nodes are collapsed into a prefix stored
+ * in the node below (path compression); the first ART_PREFIX_BYTES bytes
+ * of it are kept in the node and the rest is checked against the key in
+ * the leaf.
+ *
+ * No stored key may be a prefix of another; inserts that would break this
+ * fail. Fixed-length keys, and keys that carry their own length (as the
+ * index entries of art_index_ops do), satisfy it.
+ *
+ * Any number of threads may use a tree at once. Nodes carry optimistic
+ * version latches: readers take no locks and restart if a node they read
+ * changed, writers lock only the one or two nodes they change. Nodes and
+ * leaves that are replaced or removed are freed once every operation that
+ * might still be reading them has finished.
+ *
+ * Nothing is written to disk. A table rebuilds its ART indexes from its
+ * rows when they are created, normally each time the table is opened.
+ */
+
+#pragma once
+
+#include <monodb/core/data/index.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Largest key the tree accepts
+ */
+#define ART_MAX_KEY_SIZE 512
+
+/**
+ * Prefix bytes kept in each inner node
+ */
+#define ART_PREFIX_BYTES 12
+
+/**
+ * Tree statistics
+ */
+typedef struct {
+    uint64_t leaves;   /* Keys stored */
+    uint64_t nodes[4]; /* Inner nodes with room for 4, 16, 48 and 256 children */
+    uint64_t memory;   /* Bytes allocated for nodes and leaves */
+    uint64_t restarts; /* Operations retried after a concurrent change to a node */
+    uint64_t freed;    /* Replaced nodes and removed leaves freed so far */
+} art_stats_t;
+
+/**
+ * Callback receiving the entries of a prefix scan
+ *
+ * @param key Entry key
+ * @param key_len Key length
+ * @param value Entry value
+ * @param arg Caller argument
+ * @return true to continue, false to stop
+ */
+typedef bool (*art_visit_fn)(const void* key, uint16_t key_len, uint64_t value, void* arg);
+
+/**
+ * Adaptive radix tree context
+ */
+typedef struct art_t art_t;
+
+/**
+ * Create an empty tree
+ *
+ * @return Tree or NULL on error
+ */
+art_t* art_create(void);
+
+/**
+ * Destroy a tree and every entry in it
+ *
+ * @param tree Tree (may be NULL); no operation may be running on it
+ */
+void art_destroy(art_t* tree);
+
+/**
+ * Insert a key
+ *
+ * @param tree Tree
+ * @param key Key bytes
+ * @param key_len Key length, 1..ART_MAX_KEY_SIZE
+ * @param value Value
+ * @return true on success, false if the key exists, is a prefix of a stored
+ *         key or has one as its prefix, or on error
+ */
+bool art_insert(art_t* tree, const void* key, uint16_t key_len, uint64_t value);
+
+/**
+ * Look up a key
+ *
+ * @param tree Tree
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param value Output: the key's value (may be NULL)
+ * @return true if the key exists
+ */
+bool art_get(art_t* tree, const void* key, uint16_t key_len, uint64_t* value);
+
+/**
+ * Delete a key
+ *
+ * @param tree Tree
+ * @param key Key bytes
+ * @param key_len Key length
+ * @return true on success, false if the key does not exist
+ */
+bool art_delete(art_t* tree, const void* key, uint16_t key_len);
+
+/**
+ * Visit every entry whose key starts with a prefix, in key order. The
+ * entries are collected from a consistent view of the tree first, so the
+ * callback may change the tree.
+ *
+ * @param tree Tree
+ * @param prefix Prefix bytes (NULL with prefix_len 0 visits every entry)
+ * @param prefix_len Prefix length
+ * @param visit Called for each entry
+ * @param arg Passed to visit
+ * @return true on success, false on error
+ */
+bool art_scan_prefix(art_t* tree, const void* prefix, uint16_t prefix_len, art_visit_fn visit,
+                     void* arg);
+
+/**
+ * Get tree statistics
+ *
+ * @param tree Tree
+ * @param stats Output statistics
+ */
+void art_get_stats(art_t* tree, art_stats_t* stats);
+
+/**
+ * Access method callbacks for using a tree as a secondary index. The state
+ * is an art_t; entries are keyed by the key's length, the key and the tuple
+ * ID, so a key may occur with many tuple IDs. Closing the index destroys
+ * the tree.
+ */
+extern const index_ops_t art_index_ops;
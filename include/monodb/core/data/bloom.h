@@ -0,0 +1,83 @@
+/**
+ * @file bloom.h
+ * @brief Cache-line-blocked Bloom filters.
+ *
+ * A filter answers "is this key possibly present?" from memory, so a lookup
+ * for a key an index does not hold can return without reading a page. The
+ * filter is split into 32-byte blocks, each inside one cache line: a key's
+ * hash picks one block and sets one bit in each of its eight 32-bit lanes.
+ * A probe therefore touches a single cache line and tests all eight bits at
+ * once, with AVX2 or SSE2 where the build has them.
+ *
+ * Filters have no false negatives and a false positive rate set by the bits
+ * they spend per key: about 1.3% at 10 bits and 0.13% at 16. A filter is
+ * sized for a number of keys when it is created; adds beyond that keep it
+ * correct but raise its false positive rate, so bloom_add reports when the
+ * filter has gone past its capacity and its owner should rebuild it.
+ *
+ * Keys cannot be removed. Adds set their bits with atomic ORs, so they may
+ * run concurrently with each other and with probes: bits only ever turn
+ * on, so a probe racing an add sees the key either before or after it.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bloom filter
+ */
+typedef struct bloom_t bloom_t;
+
+/**
+ * Hash a key for a filter
+ *
+ * @param key Key bytes
+ * @param len Key length
+ * @return 64-bit hash
+ */
+uint64_t bloom_hash(const void* key, size_t len);
+
+/**
+ * Create an empty filter
+ *
+ * @param capacity Keys the filter is sized for (at least 1 is used)
+ * @param bits_per_key Filter bits to spend per key
+ * @return Filter or NULL on error
+ */
+bloom_t* bloom_create(uint32_t capacity, uint32_t bits_per_key);
+
+/**
+ * Destroy a filter
+ *
+ * @param filter Filter (may be NULL)
+ */
+void bloom_destroy(bloom_t* filter);
+
+/**
+ * Add a key
+ *
+ * @param filter Filter
+ * @param hash Key hash, from bloom_hash or another hash whose 64 bits are all well mixed
+ * @return true while the filter holds no more keys than it was sized for
+ */
+bool bloom_add(bloom_t* filter, uint64_t hash);
+
+/**
+ * Probe for a key
+ *
+ * @param filter Filter
+ * @param hash Key hash
+ * @return false if the key was never added, true if it may have been
+ */
+bool bloom_may_contain(const bloom_t* filter, uint64_t hash);
+
+/**
+ * Get the bytes a filter occupies
+ *
+ * @param filter Filter
+ * @return Memory used, including its header
+ */
+size_t bloom_memory(const bloom_t* filter);
@@ -0,0 +1,327 @@
+/**
+ * @file btree.h
+ * @brief Page-based B+tree.
+ *
+ * The tree maps byte-string keys to byte-string values. Keys are ordered
+ * by memcmp, shorter keys first on a common prefix, so callers encode
+ * numbers big-endian to get numeric order. Leaves are linked to their right
+ * sibling, which lets range scans walk the leaf level without revisiting
+ * inner nodes.
+ *
+ * Values are stored in the leaves themselves. That makes the tree usable
+ * both as a secondary index (btree_index_ops, key -> tuple ID) and as the
+ * row store of an index-organized table (primary key -> row).
+ *
+ * Nodes store keys compressed: the prefix all keys of a node share is kept
+ * once, and separators in inner nodes are cut to the shortest key that
+ * divides their children. Long keys with common structure (such as
+ * tenant/region/user paths) therefore cost little more than their distinct
+ * parts, and scans return keys whole.
+ *
+ * An empty tree can instead be bulk loaded from keys in ascending order
+ * (btree_bulk_begin()). The loader fills leaves one after the other to a
+ * fill factor and builds each inner level from the separators of the level
+ * below, so every page is written once and the tree ends up compact.
+ *
+ * Any number of threads may use a tree at once. Lookups and scans take no
+ * locks; inserts, updates and deletes lock only the leaf they change.
+ * Splits, and merges of nodes that deletes have left underfull, are
+ * serialized per tree. When a WAL is attached with btree_set_wal(), every
+ * split and merge is logged as full images of the pages it changed, which
+ * btree_redo_apply() writes back after a crash. Inserts and deletes that
+ * stay within one leaf are not logged by the tree.
+ */
+
+#pragma once
+
+#include <monodb/core/data/index.h>
+#include <monodb/core/storage/buffer.h>
+#include <monodb/core/storage/wal.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Largest key the tree accepts
+ */
+#define BTREE_MAX_KEY_SIZE 512
+
+/**
+ * Largest key plus value the tree accepts. A node always has room for at
+ * least three such entries, so a split always succeeds.
+ */
+#define BTREE_MAX_ENTRY_SIZE 2000
+
+/**
+ * Maximum depth of the tree
+ */
+#define BTREE_MAX_HEIGHT 16
+
+/**
+ * Default percentage of a node the bulk loader fills
+ */
+#define BTREE_DEFAULT_FILLFACTOR 90
+
+/**
+ * Smallest accepted bulk load fill factor
+ */
+#define BTREE_MIN_FILLFACTOR 10
+
+/**
+ * B+tree statistics
+ */
+typedef struct {
+    uint64_t leaf_splits;  /* Leaf nodes split */
+    uint64_t inner_splits; /* Inner nodes split (including the root) */
+    uint64_t merges;       /* Nodes merged into their left sibling */
+    uint64_t restarts;     /* Operations retried after a concurrent change to a node they read */
+} btree_stats_t;
+
+/**
+ * B+tree context
+ */
+typedef struct btree_t btree_t;
+
+/**
+ * Range scan context
+ */
+typedef struct btree_scan_t btree_scan_t;
+
+/**
+ * Bulk load context
+ */
+typedef struct btree_bulk_t btree_bulk_t;
+
+/**
+ * State for redoing logged structure changes
+ */
+typedef struct btree_redo_t btree_redo_t;
+
+/**
+ * Open (or create) a B+tree file
+ *
+ * @param pool Buffer pool to cache pages in
+ * @param path Path of the index file
+ * @return Tree or NULL on error
+ */
+btree_t* btree_open(buffer_pool_t* pool, const char* path);
+
+/**
+ * Close a B+tree file
+ *
+ * @param tree Tree to close
+ */
+void btree_close(btree_t* tree);
+
+/**
+ * Log the tree's splits and merges to a WAL from now on. Records carry
+ * transaction ID 0. Trees sharing a WAL serialize their records through a
+ * process-wide lock; nothing else may write to the WAL concurrently.
+ *
+ * @param tree Tree
+ * @param wal WAL context, or NULL to stop logging
+ */
+void btree_set_wal(btree_t* tree, wal_context_t* wal);
+
+/**
+ * Get the buffer pool of a tree
+ */
+buffer_pool_t* btree_pool(const btree_t* tree);
+
+/**
+ * Get the storage file of a tree
+ */
+disk_manager_t* btree_file(const btree_t* tree);
+
+/**
+ * Get the number of levels of a tree (1 for a lone root leaf)
+ */
+uint32_t btree_height(btree_t* tree);
+
+/**
+ * Insert a key
+ *
+ * @param tree Tree
+ * @param key Key bytes
+ * @param key_len Key length, at most BTREE_MAX_KEY_SIZE
+ * @param value Value bytes
+ * @param value_len Value length; key_len + value_len at most BTREE_MAX_ENTRY_SIZE
+ * @return true on success, false if the key exists or on error
+ */
+bool btree_insert(btree_t* tree, const void* key, uint16_t key_len, const void* value,
+                  uint16_t value_len);
+
+/**
+ * Replace the value of an existing key
+ *
+ * @param tree Tree
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param value New value bytes
+ * @param value_len New value length
+ * @return true on success, false if the key does not exist or on error
+ */
+bool btree_update(btree_t* tree, const void* key, uint16_t key_len, const void* value,
+                  uint16_t value_len);
+
+/**
+ * Delete a key
+ *
+ * @param tree Tree
+ * @param key Key bytes
+ * @param key_len Key length
+ * @return true on success, false if the key does not exist
+ */
+bool btree_delete(btree_t* tree, const void* key, uint16_t key_len);
+
+/**
+ * Look up a key
+ *
+ * @param tree Tree
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param buf Destination for the value, may be NULL
+ * @param buf_size Size of buf
+ * @param len Output: value length (may exceed buf_size, in which case the copy is truncated)
+ * @return true if the key exists
+ */
+bool btree_get(btree_t* tree, const void* key, uint16_t key_len, void* buf, uint16_t buf_size,
+               uint16_t* len);
+
+/**
+ * Begin a range scan over [lo, hi)
+ *
+ * @param tree Tree
+ * @param lo Lower bound (inclusive), NULL to start at the smallest key
+ * @param lo_len Lower bound length
+ * @param hi Upper bound (exclusive), NULL to run to the largest key
+ * @param hi_len Upper bound length
+ * @return Scan context or NULL on error
+ */
+btree_scan_t* btree_scan_begin(btree_t* tree, const void* lo, uint16_t lo_len, const void* hi,
+                               uint16_t hi_len);
+
+/**
+ * Return the next entry of a range scan in key order
+ *
+ * @param scan Scan context
+ * @param key Output: pointer to the key, valid until the next call
+ * @param key_len Output: key length
+ * @param value Output: pointer to the value, valid until the next call
+ * @param value_len Output: value length
+ * @return true if an entry was returned, false at the end of the range or on error
+ */
+bool btree_scan_next(btree_scan_t* scan, const void** key, uint16_t* key_len, const void** value,
+                     uint16_t* value_len);
+
+/**
+ * Get the number of leaf pages a scan has read
+ *
+ * @param scan Scan context
+ * @return Leaf page count
+ */
+uint32_t btree_scan_leaves_read(const btree_scan_t* scan);
+
+/**
+ * End a range scan
+ *
+ * @param scan Scan context
+ */
+void btree_scan_end(btree_scan_t* scan);
+
+/**
+ * Begin bulk loading an empty tree. Nothing else may use the tree until
+ * the load is finished or aborted.
+ *
+ * @param tree Tree without entries
+ * @param fillfactor Percentage of each node to fill, BTREE_MIN_FILLFACTOR..100
+ * @return Bulk load context or NULL if the tree is not empty or on error
+ */
+btree_bulk_t* btree_bulk_begin(btree_t* tree, uint32_t fillfactor);
+
+/**
+ * Append an entry to a bulk load. Keys must be added in strictly ascending
+ * order. Full nodes are written as the load goes; when a WAL is attached
+ * they are logged as page images, a few nodes per record.
+ *
+ * @param bulk Bulk load context
+ * @param key Key bytes
+ * @param key_len Key length, at most BTREE_MAX_KEY_SIZE
+ * @param value Value bytes
+ * @param value_len Value length; key_len + value_len at most BTREE_MAX_ENTRY_SIZE
+ * @return true on success, false if the key does not sort after the last one or on error
+ */
+bool btree_bulk_add(btree_bulk_t* bulk, const void* key, uint16_t key_len, const void* value,
+                    uint16_t value_len);
+
+/**
+ * Write the last node of every level and make the new root the tree's root.
+ * The context is freed in every case; on failure the tree stays empty.
+ *
+ * @param bulk Bulk load context
+ * @return true on success, false on error or if an earlier add failed
+ */
+bool btree_bulk_finish(btree_bulk_t* bulk);
+
+/**
+ * Abandon a bulk load, leaving the tree empty. Pages already written stay
+ * allocated but unreachable.
+ *
+ * @param bulk Bulk load context, freed by this call (may be NULL)
+ */
+void btree_bulk_abort(btree_bulk_t* bulk);
+
+/**
+ * Get tree statistics
+ *
+ * @param tree Tree
+ * @param stats Output statistics
+ */
+void btree_get_stats(btree_t* tree, btree_stats_t* stats);
+
+/**
+ * Access method callbacks for using a tree as a secondary index. The state
+ * is a btree_t; entries map key || tuple ID to the entry's INCLUDE payload
+ * (empty unless the index is covering), so a key may occur with many tuple
+ * IDs. Closing the index closes the tree.
+ */
+extern const index_ops_t btree_index_ops;
+
+/**
+ * Encode the entry key btree_index_ops stores for a key and tuple ID, so
+ * index entries can be sorted and bulk loaded
+ *
+ * @param out Output buffer of BTREE_MAX_KEY_SIZE bytes
+ * @param key Index key bytes
+ * @param key_len Index key length
+ * @param tid Tuple ID
+ * @return Entry key length, 0 if the key is too long
+ */
+uint16_t btree_index_key(uint8_t* out, const void* key, uint16_t key_len, tuple_id_t tid);
+
+/**
+ * Begin redoing logged structure changes. Redo writes index files
+ * directly, so it runs before the trees are opened.
+ *
+ * @return Redo state or NULL on error
+ */
+btree_redo_t* btree_redo_begin(void);
+
+/**
+ * Redo one WAL record. Records of other types are ignored. A change spread
+ * over several records is applied when its last record arrives; each page
+ * image is written unless the file already holds a page with the same or a
+ * later LSN.
+ *
+ * @param redo Redo state
+ * @param header Record header
+ * @param data Record payload
+ * @return true on success, false on a malformed record or I/O error
+ */
+bool btree_redo_apply(btree_redo_t* redo, const wal_record_header_t* header, const void* data);
+
+/**
+ * End redo. A change whose last record is missing is discarded.
+ *
+ * @param redo Redo state
+ */
+void btree_redo_end(btree_redo_t* redo);
@@ -0,0 +1,149 @@
+/**
+ * @file hash_index.h
+ * @brief Persistent extendible hash index.
+ *
+ * The index maps byte-string keys to byte-string values, like the B+tree,
+ * but keeps no order: it answers equality lookups only, and answers them
+ * with a single page read. A key's hash selects an entry of the directory,
+ * which the index keeps in memory, and that entry names the bucket page
+ * holding the key.
+ *
+ * Buckets are page-sized. When one fills up it is split in two on the next
+ * bit of the hash; only the entries of that bucket move. The directory
+ * doubles when a bucket that has as many hash bits as the directory itself
+ * splits, by duplicating its entries, so no bucket is touched. Entries that
+ * cannot be told apart by any further bit (many entries of one key, or a
+ * directory at HASH_INDEX_MAX_DEPTH) go to overflow pages chained to the
+ * bucket instead. Buckets never merge; room freed by deletes is reused by
+ * later inserts.
+ *
+ * Buckets also carry in-memory Bloom filters of their entries' hashes
+ * (see bloom.h), so a lookup for a key the index does not hold is usually
+ * answered by one probe of a cache line, without reading the bucket page.
+ * The filters are rebuilt from the pages as lookups read them after the
+ * index is opened. The false positive rate they achieve is the ratio of
+ * filter_false_positives to filter_false_positives + filter_negatives.
+ *
+ * Any number of threads may use an index at once. Lookups, inserts and
+ * deletes share the directory and lock only the bucket they touch; splits,
+ * directory doubling and overflow allocation hold the directory
+ * exclusively. The index is not WAL-logged: its pages reach disk through
+ * the buffer pool, and an index file that was not flushed before a crash
+ * should be rebuilt from its table.
+ */
+
+#pragma once
+
+#include <monodb/core/data/index.h>
+#include <monodb/core/storage/buffer.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Largest key the index accepts
+ */
+#define HASH_INDEX_MAX_KEY_SIZE 512
+
+/**
+ * Largest key plus value the index accepts. A bucket always has room for
+ * at least three such entries.
+ */
+#define HASH_INDEX_MAX_ENTRY_SIZE 2000
+
+/**
+ * Most hash bits the directory uses (it holds 2^depth bucket pointers)
+ */
+#define HASH_INDEX_MAX_DEPTH 20
+
+/**
+ * Hash index statistics
+ */
+typedef struct {
+    uint32_t global_depth;           /* Hash bits the directory uses */
+    uint32_t buckets;                /* Bucket pages */
+    uint32_t overflow_pages;         /* Overflow pages chained to buckets, in use or free */
+    uint64_t splits;                 /* Buckets split since the index was opened */
+    uint64_t doublings;              /* Directory doublings since the index was opened */
+    uint32_t filters;                /* Buckets with a Bloom filter */
+    uint64_t filter_memory;          /* Bytes held by the filters */
+    uint64_t filter_negatives;       /* Lookups a filter answered without reading a page */
+    uint64_t filter_false_positives; /* Lookups a filter let through that found nothing */
+} hash_index_stats_t;
+
+/**
+ * Hash index context
+ */
+typedef struct hash_index_t hash_index_t;
+
+/**
+ * Open (or create) a hash index file
+ *
+ * @param pool Buffer pool to cache pages in
+ * @param path Path of the index file
+ * @return Index or NULL on error
+ */
+hash_index_t* hash_index_open(buffer_pool_t* pool, const char* path);
+
+/**
+ * Close a hash index file
+ *
+ * @param index Index to close
+ */
+void hash_index_close(hash_index_t* index);
+
+/**
+ * Get the storage file of an index
+ */
+disk_manager_t* hash_index_file(const hash_index_t* index);
+
+/**
+ * Insert a key
+ *
+ * @param index Index
+ * @param key Key bytes
+ * @param key_len Key length, at most HASH_INDEX_MAX_KEY_SIZE
+ * @param value Value bytes
+ * @param value_len Value length; key_len + value_len at most HASH_INDEX_MAX_ENTRY_SIZE
+ * @return true on success, false if the key exists or on error
+ */
+bool hash_index_insert(hash_index_t* index, const void* key, uint16_t key_len, const void* value,
+                       uint16_t value_len);
+
+/**
+ * Delete a key
+ *
+ * @param index Index
+ * @param key Key bytes
+ * @param key_len Key length
+ * @return true on success, false if the key does not exist
+ */
+bool hash_index_delete(hash_index_t* index, const void* key, uint16_t key_len);
+
+/**
+ * Look up a key
+ *
+ * @param index Index
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param buf Destination for the value, may be NULL
+ * @param buf_size Size of buf
+ * @param len Output: value length (may exceed buf_size, in which case the copy is truncated)
+ * @return true if the key exists
+ */
+bool hash_index_get(hash_index_t* index, const void* key, uint16_t key_len, void* buf,
+                    uint16_t buf_size, uint16_t* len);
+
+/**
+ * Get index statistics
+ *
+ * @param index Index
+ * @param stats Output statistics
+ */
+void hash_index_get_stats(hash_index_t* index, hash_index_stats_t* stats);
+
+/**
+ * Access method callbacks for using a hash index as a secondary index. The
+ * state is a hash_index_t; entries map a key to a tuple ID, and a key may
+ * occur with many tuple IDs. Closing the index closes the hash index.
+ */
+extern const index_ops_t hash_index_ops;
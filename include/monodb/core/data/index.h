@@ -0,0 +1,304 @@
+/**
+ * @file index.h
+ * @brief Generic secondary index interface.
+ *
+ * Every access method (B+tree, hash, ...) plugs into the table layer through
+ * an index_ops_t table of callbacks. An index does not understand tuples:
+ * a key extractor supplied when the index is attached turns a heap tuple
+ * into the byte string the access method stores, which is also how the
+ * table layer decides whether an update touches an indexed column.
+ *
+ * An index may also cover extra columns (INCLUDE columns): a second
+ * extractor produces a payload stored in each entry beside the key, so
+ * lookups can answer from the index without reading the row. Only access
+ * methods with the covering callbacks accept such an index.
+ *
+ * A partial index holds only the tuples that satisfy its predicate; the
+ * others are treated as having no key, so they cost neither space nor
+ * maintenance. Since the key extractor is arbitrary code, every index is
+ * an expression index. A lookup may use an index when it compares the same
+ * extractor (function and argument) and its conditions include the
+ * index's predicate: a conjunction implies each of its conditions. Logical
+ * implication between different predicates is not attempted.
+ */
+
+#pragma once
+
+#include <monodb/core/storage/heap.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Largest key an index entry may carry
+ */
+#define INDEX_MAX_KEY_SIZE 256
+
+/**
+ * Largest INCLUDE payload an index entry may carry
+ */
+#define INDEX_MAX_INCLUDE_SIZE 256
+
+/**
+ * Extract the index key from a tuple
+ *
+ * @param tuple Tuple payload
+ * @param len Payload length
+ * @param key Output buffer of INDEX_MAX_KEY_SIZE bytes
+ * @param key_len Output: key length
+ * @param arg Extractor argument given when the index was created
+ * @return true on success, false if the tuple has no key (it is then not indexed)
+ */
+typedef bool (*index_key_fn)(const void* tuple, uint16_t len, void* key, uint16_t* key_len,
+                             void* arg);
+
+/**
+ * Decide whether a tuple belongs in a partial index
+ *
+ * @param tuple Tuple payload
+ * @param len Payload length
+ * @param arg Predicate argument
+ * @return true if the tuple satisfies the predicate
+ */
+typedef bool (*index_predicate_fn)(const void* tuple, uint16_t len, void* arg);
+
+/**
+ * Predicate together with its argument; two are the same condition when
+ * both the function and the argument are equal
+ */
+typedef struct {
+    index_predicate_fn fn;  /* Predicate */
+    void*              arg; /* Argument passed to fn */
+} index_predicate_t;
+
+/**
+ * Callback receiving lookup matches
+ *
+ * @param tid Matching tuple address
+ * @param arg Caller argument
+ * @return true to continue, false to stop the lookup
+ */
+typedef bool (*index_visit_fn)(tuple_id_t tid, void* arg);
+
+/**
+ * Callback receiving lookup matches with their INCLUDE payload
+ *
+ * @param tid Matching tuple address
+ * @param payload INCLUDE payload of the entry, valid for the duration of the call
+ * @param payload_len Payload length (0 for indexes without INCLUDE columns)
+ * @param arg Caller argument
+ * @return true to continue, false to stop the lookup
+ */
+typedef bool (*index_cover_fn)(tuple_id_t tid, const void* payload, uint16_t payload_len,
+                               void* arg);
+
+/**
+ * Access method callbacks. The covering callbacks are optional; entries
+ * inserted with a payload are removed by remove() like any other.
+ */
+typedef struct {
+    bool (*insert)(void* state, const void* key, uint16_t key_len, tuple_id_t tid);
+    bool (*remove)(void* state, const void* key, uint16_t key_len, tuple_id_t tid);
+    bool (*lookup)(void* state, const void* key, uint16_t key_len, index_visit_fn visit,
+                   void* arg);
+    void (*close)(void* state);
+    bool (*insert_covering)(void* state, const void* key, uint16_t key_len, tuple_id_t tid,
+                            const void* payload, uint16_t payload_len);
+    bool (*lookup_covering)(void* state, const void* key, uint16_t key_len,
+                            index_cover_fn visit, void* arg);
+} index_ops_t;
+
+/**
+ * Index statistics
+ */
+typedef struct {
+    uint64_t inserts; /* Entries added, the write maintenance paid for the index */
+    uint64_t removes; /* Entries removed */
+    uint64_t lookups; /* Key lookups (index scans) */
+    uint64_t tuples;  /* Matches the lookups returned */
+} index_stats_t;
+
+/**
+ * Index context
+ */
+typedef struct index_t index_t;
+
+/**
+ * Wrap an access method instance as an index
+ *
+ * @param name Index name (copied)
+ * @param ops Access method callbacks
+ * @param state Access method instance, closed with ops->close by index_destroy
+ * @param key_fn Key extractor
+ * @param key_arg Argument passed to key_fn
+ * @return Index or NULL on error
+ */
+index_t* index_create(const char* name, const index_ops_t* ops, void* state, index_key_fn key_fn,
+                      void* key_arg);
+
+/**
+ * Make an index cover INCLUDE columns. Must be called before the index
+ * holds any entries.
+ *
+ * @param index Index
+ * @param include_fn Extracts the INCLUDE payload of a tuple (into a buffer of
+ *                   INDEX_MAX_INCLUDE_SIZE bytes); returning false stores an empty payload
+ * @param include_arg Argument passed to include_fn
+ * @return true on success, false if the access method cannot store payloads
+ */
+bool index_set_include(index_t* index, index_key_fn include_fn, void* include_arg);
+
+/**
+ * Check whether an index covers INCLUDE columns
+ */
+bool index_is_covering(const index_t* index);
+
+/**
+ * Make an index partial: only tuples satisfying the predicate get an
+ * entry. Must be called before the index holds any entries.
+ *
+ * @param index Index
+ * @param where_fn Predicate
+ * @param where_arg Argument passed to where_fn
+ * @return true on success, false on invalid arguments
+ */
+bool index_set_predicate(index_t* index, index_predicate_fn where_fn, void* where_arg);
+
+/**
+ * Check whether an index is partial
+ */
+bool index_is_partial(const index_t* index);
+
+/**
+ * Check whether a predicate is among a conjunction of conditions, and so
+ * implied by it
+ *
+ * @param where Predicate to check
+ * @param conditions Conditions (may be NULL if num_conditions is 0)
+ * @param num_conditions Number of conditions
+ * @return true if some condition has the same function and argument
+ */
+bool index_predicate_implied(index_predicate_t where, const index_predicate_t* conditions,
+                             uint32_t num_conditions);
+
+/**
+ * Check whether an index can answer an equality lookup on an expression
+ * restricted by a conjunction of conditions: the index key must be the
+ * same expression and its predicate, if any, must be implied
+ *
+ * @param index Index
+ * @param expr Key extractor the lookup compares
+ * @param expr_arg Argument of expr
+ * @param conditions Conditions every row sought satisfies (may be NULL if num_conditions is 0)
+ * @param num_conditions Number of conditions
+ * @return true if the index holds an entry for every row the lookup seeks
+ */
+bool index_matches(const index_t* index, index_key_fn expr, void* expr_arg,
+                   const index_predicate_t* conditions, uint32_t num_conditions);
+
+/**
+ * Close the access method and free an index
+ *
+ * @param index Index to destroy
+ */
+void index_destroy(index_t* index);
+
+/**
+ * Get the name of an index
+ */
+const char* index_name(const index_t* index);
+
+/**
+ * Extract the key of a tuple for an index
+ *
+ * @param index Index
+ * @param tuple Tuple payload
+ * @param len Payload length
+ * @param key Output buffer of INDEX_MAX_KEY_SIZE bytes
+ * @param key_len Output: key length
+ * @return true if the tuple has a key for this index (and satisfies its predicate)
+ */
+bool index_extract_key(const index_t* index, const void* tuple, uint16_t len, void* key,
+                       uint16_t* key_len);
+
+/**
+ * Extract the INCLUDE payload of a tuple for an index
+ *
+ * @param index Index
+ * @param tuple Tuple payload
+ * @param len Payload length
+ * @param payload Output buffer of INDEX_MAX_INCLUDE_SIZE bytes
+ * @param payload_len Output: payload length (0 if the index covers no columns)
+ */
+void index_extract_include(const index_t* index, const void* tuple, uint16_t len, void* payload,
+                           uint16_t* payload_len);
+
+/**
+ * Check whether two versions of a tuple have the same entry for an index:
+ * the same key and, for covering indexes, the same INCLUDE payload
+ *
+ * @param index Index
+ * @param old_tuple Old payload
+ * @param old_len Old payload length
+ * @param new_tuple New payload
+ * @param new_len New payload length
+ * @return true if both versions map to the same entry (or neither has one)
+ */
+bool index_key_equal(const index_t* index, const void* old_tuple, uint16_t old_len,
+                     const void* new_tuple, uint16_t new_len);
+
+/**
+ * Add the entry of a tuple
+ *
+ * @param index Index
+ * @param tuple Tuple payload
+ * @param len Payload length
+ * @param tid Tuple address
+ * @return true on success (including tuples without a key), false on error
+ */
+bool index_insert_tuple(index_t* index, const void* tuple, uint16_t len, tuple_id_t tid);
+
+/**
+ * Remove the entry of a tuple
+ *
+ * @param index Index
+ * @param tuple Tuple payload
+ * @param len Payload length
+ * @param tid Tuple address
+ * @return true on success, false on error
+ */
+bool index_remove_tuple(index_t* index, const void* tuple, uint16_t len, tuple_id_t tid);
+
+/**
+ * Find the tuples with a key
+ *
+ * @param index Index
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param visit Called for each match
+ * @param arg Passed to visit
+ * @return true on success, false on error
+ */
+bool index_lookup(index_t* index, const void* key, uint16_t key_len, index_visit_fn visit,
+                  void* arg);
+
+/**
+ * Find the tuples with a key together with their INCLUDE payloads. Access
+ * methods without covering callbacks report empty payloads.
+ *
+ * @param index Index
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param visit Called for each match
+ * @param arg Passed to visit
+ * @return true on success, false on error
+ */
+bool index_lookup_covering(index_t* index, const void* key, uint16_t key_len,
+                           index_cover_fn visit, void* arg);
+
+/**
+ * Get index statistics
+ *
+ * @param index Index
+ * @param stats Output statistics
+ */
+void index_get_stats(index_t* index, index_stats_t* stats);
@@ -0,0 +1,202 @@
+/**
+ * @file key.h
+ * @brief Order-preserving key encodings.
+ *
+ * Every index orders keys as byte strings: by memcmp, shorter first on a
+ * common prefix. No access method calls back into a type-specific
+ * comparator; instead a key extractor writes typed values in an encoding
+ * whose byte order is their natural order, and the indexes compare them
+ * with one inlined memcmp.
+ *
+ * Unsigned integers are stored big-endian; signed integers the same with
+ * the sign bit flipped, so negatives sort below positives. Strings that
+ * are one component of a composite key are escaped (0x00 becomes 0x00
+ * 0xFF) and end with 0x00 0x00, so a shorter string sorts before any longer
+ * string it is a prefix of regardless of the components after it.
+ * Concatenating the encoded components of a composite key gives a key
+ * that compares component by component.
+ *
+ * Code that knows a key's width at compile time can compare with
+ * key_compare_as() and a constant kind: the dispatch folds away and a
+ * fixed-width key compares as one integer load and compare, a short byte
+ * string as a few.
+ *
+ * Everything here is inline; there is no translation unit.
+ */
+
+#pragma once
+
+#include <monodb/core/storage/heap.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Encoded size of a tuple ID
+ */
+#define KEY_TID_SIZE 6
+
+/**
+ * Key kinds key_compare_as() specializes for
+ */
+typedef enum {
+    KEY_KIND_BYTES  = 0, /* Any byte string, composite keys included */
+    KEY_KIND_FIXED4 = 4, /* 4-byte integer encodings */
+    KEY_KIND_FIXED8 = 8  /* 8-byte integer encodings */
+} key_kind_t;
+
+/**
+ * Compare two keys in index order
+ *
+ * @return Negative, zero or positive as a sorts before, with or after b
+ */
+static inline int key_compare(const void* a, uint16_t a_len, const void* b, uint16_t b_len) {
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (cmp != 0)
+        return cmp;
+    return (int)a_len - (int)b_len;
+}
+
+static inline uint16_t key_put_u16(uint8_t* out, uint16_t v) {
+    out[0] = (uint8_t)(v >> 8);
+    out[1] = (uint8_t)v;
+    return 2;
+}
+
+static inline uint16_t key_put_u32(uint8_t* out, uint32_t v) {
+    out[0] = (uint8_t)(v >> 24);
+    out[1] = (uint8_t)(v >> 16);
+    out[2] = (uint8_t)(v >> 8);
+    out[3] = (uint8_t)v;
+    return 4;
+}
+
+static inline uint16_t key_put_u64(uint8_t* out, uint64_t v) {
+    key_put_u32(out, (uint32_t)(v >> 32));
+    key_put_u32(out + 4, (uint32_t)v);
+    return 8;
+}
+
+static inline uint16_t key_put_i32(uint8_t* out, int32_t v) {
+    return key_put_u32(out, (uint32_t)v ^ 0x80000000u);
+}
+
+static inline uint16_t key_put_i64(uint8_t* out, int64_t v) {
+    return key_put_u64(out, (uint64_t)v ^ 0x8000000000000000ull);
+}
+
+static inline uint16_t key_get_u16(const uint8_t* in) { return (uint16_t)((in[0] << 8) | in[1]); }
+
+static inline uint32_t key_get_u32(const uint8_t* in) {
+    return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+}
+
+static inline uint64_t key_get_u64(const uint8_t* in) {
+    return ((uint64_t)key_get_u32(in) << 32) | key_get_u32(in + 4);
+}
+
+static inline int32_t key_get_i32(const uint8_t* in) {
+    return (int32_t)(key_get_u32(in) ^ 0x80000000u);
+}
+
+static inline int64_t key_get_i64(const uint8_t* in) {
+    return (int64_t)(key_get_u64(in) ^ 0x8000000000000000ull);
+}
+
+/**
+ * Encode a tuple ID, big-endian, so entries of one key sort by tuple ID
+ *
+ * @return KEY_TID_SIZE
+ */
+static inline uint16_t key_put_tid(uint8_t* out, tuple_id_t tid) {
+    key_put_u32(out, tid.page_id);
+    key_put_u16(out + 4, tid.slot);
+    return KEY_TID_SIZE;
+}
+
+static inline tuple_id_t key_get_tid(const uint8_t* in) {
+    tuple_id_t tid = {key_get_u32(in), key_get_u16(in + 4)};
+    return tid;
+}
+
+/**
+ * Encode a string as a component of a composite key
+ *
+ * @param out Output of at least 2 * len + 2 bytes
+ * @param data String bytes
+ * @param len String length
+ * @return Bytes written
+ */
+static inline uint16_t key_put_string(uint8_t* out, const void* data, uint16_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint16_t       n = 0;
+    for (uint16_t i = 0; i < len; i++) {
+        out[n++] = p[i];
+        if (p[i] == 0)
+            out[n++] = 0xFF;
+    }
+    out[n++] = 0;
+    out[n++] = 0;
+    return n;
+}
+
+/**
+ * Decode a composite key string component
+ *
+ * @param in Encoded component
+ * @param in_len Bytes available
+ * @param out Output of at least in_len bytes
+ * @param len Output: string length
+ * @return Bytes consumed, 0 if the component is not terminated
+ */
+static inline uint16_t key_get_string(const uint8_t* in, uint16_t in_len, uint8_t* out,
+                                      uint16_t* len) {
+    uint16_t n = 0;
+    for (uint16_t i = 0; i + 1 < in_len; i++) {
+        if (in[i] == 0 && in[i + 1] == 0) {
+            *len = n;
+            return (uint16_t)(i + 2);
+        }
+        out[n++] = in[i];
+        if (in[i] == 0)
+            i++;
+    }
+    return 0;
+}
+
+/**
+ * Compare two keys of a kind in index order. With kind a compile-time
+ * constant only the one comparison remains: fixed-width keys are loaded
+ * and compared as integers, byte strings eight bytes at a time. The order
+ * is key_compare()'s.
+ */
+static inline int key_compare_as(key_kind_t kind, const void* a, uint16_t a_len, const void* b,
+                                 uint16_t b_len) {
+    switch (kind) {
+    case KEY_KIND_FIXED8: {
+        uint64_t x = key_get_u64((const uint8_t*)a), y = key_get_u64((const uint8_t*)b);
+        return (x > y) - (x < y);
+    }
+    case KEY_KIND_FIXED4: {
+        uint32_t x = key_get_u32((const uint8_t*)a), y = key_get_u32((const uint8_t*)b);
+        return (x > y) - (x < y);
+    }
+    default: {
+        /* Short keys: eight bytes per step, each word compared as a big-endian integer */
+        const uint8_t* x   = (const uint8_t*)a;
+        const uint8_t* y   = (const uint8_t*)b;
+        uint16_t       min = a_len < b_len ? a_len : b_len;
+        uint16_t       i   = 0;
+        for (; i + 8 <= min; i += 8) {
+            uint64_t u = key_get_u64(x + i), v = key_get_u64(y + i);
+            if (u != v)
+                return u < v ? -1 : 1;
+        }
+        for (; i < min; i++) {
+            if (x[i] != y[i])
+                return (int)x[i] - (int)y[i];
+        }
+        return (int)a_len - (int)b_len;
+    }
+    }
+}
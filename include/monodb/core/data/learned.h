@@ -0,0 +1,179 @@
+/**
+ * @file learned.h
+ * @brief In-memory learned index over 64-bit keys.
+ *
+ * The index keeps its entries in one sorted array and replaces the inner
+ * nodes of a search tree with a model of where each key sits in it: a
+ * chain of linear segments, each predicting the position of the keys in
+ * its range to within a fixed error. A lookup finds the segment through a
+ * radix table on the top bits of the key and a short binary search,
+ * evaluates the segment's line, and binary searches only the window of
+ * positions the error allows (the last mile). For keys that arrive nearly
+ * in order, such as timestamps of an append-only table, a few segments
+ * cover millions of keys, so the model is a small fraction of the memory
+ * of a B+tree's inner nodes and a lookup touches few cache lines.
+ *
+ * The model is built in one pass over sorted entries (a greedy
+ * shrinking-cone fit), so the index is meant to be bulk loaded. Later
+ * inserts and removals collect in small sorted delta arrays that lookups
+ * consult beside the model; once the deltas reach LEARNED_DELTA_MAX
+ * entries the index is compacted: the deltas are merged into the array
+ * and the model is rebuilt.
+ *
+ * Keys are unsigned 64-bit integers; index keys are the 8-byte big-endian
+ * encodings of key.h (key_put_u64 or key_put_i64). Values are 64-bit and
+ * a key may occur with many values. Any number of threads may use an
+ * index at once: lookups share it, changes and compaction hold it
+ * exclusively. Nothing is written to disk; a table rebuilds its learned
+ * indexes from its rows when they are created.
+ */
+
+#pragma once
+
+#include <monodb/core/data/index.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Position error the model is built for unless another is given
+ */
+#define LEARNED_DEFAULT_ERROR 32
+
+/**
+ * Changed entries held beside the model before it is rebuilt
+ */
+#define LEARNED_DELTA_MAX 4096
+
+/**
+ * Index entry
+ */
+typedef struct {
+    uint64_t key;
+    uint64_t value;
+} learned_entry_t;
+
+/**
+ * Learned index statistics
+ */
+typedef struct {
+    uint64_t entries;      /* Entries, deltas included */
+    uint32_t segments;     /* Linear segments of the model */
+    uint32_t error;        /* Largest position error of the model */
+    uint64_t model_memory; /* Bytes of segments and radix table */
+    uint64_t data_memory;  /* Bytes of the sorted entries and deltas */
+    uint32_t delta;        /* Inserted and removed entries not yet merged */
+    uint64_t rebuilds;     /* Compactions, the bulk load included */
+} learned_stats_t;
+
+/**
+ * Callback receiving the values of a key
+ *
+ * @param value Entry value
+ * @param arg Caller argument
+ * @return true to continue, false to stop
+ */
+typedef bool (*learned_visit_fn)(uint64_t value, void* arg);
+
+/**
+ * Learned index context
+ */
+typedef struct learned_index_t learned_index_t;
+
+/**
+ * Create an empty index
+ *
+ * @param error Position error of the model, at least 1 (LEARNED_DEFAULT_ERROR if 0)
+ * @return Index or NULL on error
+ */
+learned_index_t* learned_index_create(uint32_t error);
+
+/**
+ * Destroy an index
+ *
+ * @param index Index (may be NULL); no operation may be running on it
+ */
+void learned_index_destroy(learned_index_t* index);
+
+/**
+ * Replace the contents of an index with a set of entries and build its model
+ *
+ * @param index Index
+ * @param entries Entries, sorted in place by key and value if not already in order
+ * @param count Number of entries
+ * @return true on success, false on error (the index is then unchanged)
+ */
+bool learned_index_load(learned_index_t* index, learned_entry_t* entries, size_t count);
+
+/**
+ * Insert an entry
+ *
+ * @param index Index
+ * @param key Key
+ * @param value Value
+ * @return true on success, false if the entry exists or on error
+ */
+bool learned_index_insert(learned_index_t* index, uint64_t key, uint64_t value);
+
+/**
+ * Remove an entry
+ *
+ * @param index Index
+ * @param key Key
+ * @param value Value
+ * @return true on success, false if the entry does not exist or on error
+ */
+bool learned_index_remove(learned_index_t* index, uint64_t key, uint64_t value);
+
+/**
+ * Look up the first value of a key
+ *
+ * @param index Index
+ * @param key Key
+ * @param value Output: the smallest value stored with the key (may be NULL)
+ * @return true if the key exists
+ */
+bool learned_index_get(learned_index_t* index, uint64_t key, uint64_t* value);
+
+/**
+ * Visit every value of a key, in value order. The values are collected
+ * first, so the callback may change the index.
+ *
+ * @param index Index
+ * @param key Key
+ * @param visit Called for each value
+ * @param arg Passed to visit
+ * @return true on success, false on error
+ */
+bool learned_index_lookup(learned_index_t* index, uint64_t key, learned_visit_fn visit, void* arg);
+
+/**
+ * Merge the deltas into the sorted entries and rebuild the model
+ *
+ * @param index Index
+ * @return true on success, false on error (the index is then unchanged)
+ */
+bool learned_index_compact(learned_index_t* index);
+
+/**
+ * Get index statistics
+ *
+ * @param index Index
+ * @param stats Output statistics
+ */
+void learned_index_get_stats(learned_index_t* index, learned_stats_t* stats);
+
+/**
+ * Value a secondary index stores for a tuple ID
+ */
+static inline uint64_t learned_tid_value(tuple_id_t tid) {
+    return ((uint64_t)tid.page_id << 16) | tid.slot;
+}
+
+/**
+ * Access method callbacks for using a learned index as a secondary index.
+ * The state is a learned_index_t; keys must be 8 bytes, and the value is
+ * the tuple ID (learned_tid_value()), so a key may occur with many tuple
+ * IDs. Closing the index destroys it.
+ */
+extern const index_ops_t learned_index_ops;
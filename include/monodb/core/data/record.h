@@ -0,0 +1,410 @@
+/**
+ * @file record.h
+ * @brief Compact row format with constant-time field access.
+ *
+ * A record is laid out as:
+ *
+ *     [null bitmap][fixed-width fields][u16 end offsets][variable-length bytes]
+ *
+ * The null bitmap has one bit per column. Fixed-width fields follow in
+ * column order at offsets computed once per layout, so a null field still
+ * occupies its slot. Each variable-length field has one entry in the
+ * offset table: the offset, from the start of the record, just past its
+ * bytes; it starts where the previous one ends. Any field is therefore
+ * reached with one or two loads, without decoding the fields before it.
+ * Fixed-width values are stored in native byte order and may be unaligned.
+ *
+ * A layout is built once per schema. The typed accessors below are
+ * stamped out per type by RECORD_FIXED_ACCESSORS(), so each reads its
+ * field with a single load at the offset the layout precomputed.
+ *
+ * A text or bytes column may be given a string dictionary. Its fixed area
+ * then also holds a u32 code, and the bytes go to the variable-length
+ * area only when the dictionary had no room for the value (the code is
+ * then TYPE_DICT_NONE). Equality predicates compare codes through
+ * record_match(), grouping can index an array by record_get_code(), and
+ * the string is fetched from the dictionary only when the field is read
+ * as bytes for output. The dictionary's scope (one per table, or one per
+ * storage segment) is up to the owner of the layout, which must keep it
+ * alive for as long as the layout.
+ *
+ * A table whose columns may be added after rows were written keeps a
+ * record schema: one layout per version, each extending the previous one
+ * by a column, and the default of every added column. Its rows are
+ * stored as
+ *
+ *     [u16 schema version][record]
+ *
+ * Adding a column creates the next version and rewrites nothing. A row is
+ * read with the layout of its own version, and the columns it predates
+ * take their defaults; it moves to the current version when it is next
+ * encoded, which is what an update does.
+ */
+
+#pragma once
+
+#include <monodb/core/catalog/type_system.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Maximum number of columns of a layout
+ */
+#define RECORD_MAX_COLUMNS 1024
+
+/**
+ * Field positions of a schema
+ */
+typedef struct {
+    uint16_t      num_columns; /* Columns */
+    uint16_t      num_var;     /* Variable-length columns */
+    uint16_t      var_table;   /* Offset of the end offset table */
+    uint16_t      var_data;    /* Offset of the first variable-length byte */
+    type_id_t*    types;       /* Type of each column */
+    uint16_t*     offsets;     /* Fixed-width: byte offset; variable-length: table entry */
+    uint16_t*     codes;       /* Byte offset of a dictionary code, 0 for other columns */
+    type_dict_t** dicts;       /* Dictionary of each column, NULL for most */
+} record_layout_t;
+
+/**
+ * Field value for encoding and decoding
+ */
+typedef struct {
+    bool        is_null; /* Whether the field is NULL; the rest is then ignored */
+    int64_t     i;       /* TYPE_BOOL, TYPE_INT32 and TYPE_INT64 values */
+    double      f;       /* TYPE_FLOAT64 values */
+    const void* data;    /* TYPE_TEXT and TYPE_BYTES bytes */
+    uint16_t    len;     /* Their length */
+} record_value_t;
+
+/**
+ * Size of the schema version in front of a versioned row
+ */
+#define RECORD_VERSION_SIZE 2
+
+/**
+ * Versions of a row layout, see record_schema_create()
+ */
+typedef struct {
+    uint16_t          num_versions; /* Versions; the last one is current */
+    record_layout_t** layouts;      /* Layout of each version, each extending the previous one */
+    record_value_t*   defaults;     /* Default of each column, read from rows that predate it */
+} record_schema_t;
+
+/**
+ * Equality predicate on a text or bytes column, see record_match_init()
+ */
+typedef struct {
+    uint16_t    col;  /* Column */
+    uint32_t    code; /* Code of the value, TYPE_DICT_NONE if it has none */
+    const void* data; /* Value, compared with fields stored inline */
+    uint16_t    len;
+} record_match_t;
+
+/**
+ * Build the layout of a schema
+ *
+ * @param types Column types
+ * @param num_columns Number of columns, 1..RECORD_MAX_COLUMNS
+ * @return Layout or NULL if a type is unknown or on error
+ */
+record_layout_t* record_layout_create(const type_id_t* types, uint16_t num_columns);
+
+/**
+ * Build the layout of a schema whose text or bytes columns may be dictionary-encoded
+ *
+ * @param types Column types
+ * @param dicts Dictionary of each column, NULL for a plain column (the array may be NULL)
+ * @param num_columns Number of columns, 1..RECORD_MAX_COLUMNS
+ * @return Layout or NULL if a type is unknown, a fixed-width column has a dictionary, or on error
+ */
+record_layout_t* record_layout_create_dict(const type_id_t* types, type_dict_t* const* dicts,
+                                           uint16_t num_columns);
+
+/**
+ * Destroy a layout
+ *
+ * @param layout Layout (may be NULL)
+ */
+void record_layout_destroy(record_layout_t* layout);
+
+/**
+ * Get the encoded size of a row
+ *
+ * @param layout Layout
+ * @param values One value per column
+ * @return Size in bytes, 0 if the row exceeds UINT16_MAX bytes. A value of a dictionary
+ *         column that is not yet in its dictionary is counted at full length, so this is
+ *         then an upper bound.
+ */
+uint32_t record_encoded_size(const record_layout_t* layout, const record_value_t* values);
+
+/**
+ * Encode a row, adding new values of dictionary columns to their dictionaries
+ *
+ * @param layout Layout
+ * @param values One value per column
+ * @param buf Output buffer
+ * @param size Size of buf
+ * @return Record length, 0 if buf is too small or the row too long
+ */
+uint16_t record_encode(const record_layout_t* layout, const record_value_t* values, void* buf,
+                       uint16_t size);
+
+/**
+ * Decode every field of a record
+ *
+ * @param layout Layout the record was encoded with
+ * @param rec Record
+ * @param len Record length
+ * @param values Output, one per column; bytes point into rec or a dictionary, and i holds
+ *               the code of a dictionary column
+ * @return true on success, false if the record is malformed
+ */
+bool record_decode(const record_layout_t* layout, const void* rec, uint16_t len,
+                   record_value_t* values);
+
+/**
+ * Check that a record is well formed, so the accessors may be used on it
+ *
+ * @param layout Layout the record was encoded with
+ * @param rec Record
+ * @param len Record length
+ * @return true if the fixed area fits, the end offsets are in order and in bounds, and
+ *         dictionary codes are known
+ */
+bool record_validate(const record_layout_t* layout, const void* rec, uint16_t len);
+
+/**
+ * Check whether a field is NULL
+ */
+static inline bool record_is_null(const void* rec, uint16_t col) {
+    return (((const uint8_t*)rec)[col >> 3] >> (col & 7)) & 1;
+}
+
+/**
+ * Get the dictionary code of a field of a validated record
+ *
+ * @param layout Layout
+ * @param rec Record
+ * @param col Dictionary column
+ * @return Code, TYPE_DICT_NONE if the field is NULL or stored inline
+ */
+static inline uint32_t record_get_code(const record_layout_t* layout, const void* rec,
+                                       uint16_t col) {
+    uint32_t code;
+    memcpy(&code, (const uint8_t*)rec + layout->codes[col], sizeof(code));
+    return code;
+}
+
+/**
+ * Get a variable-length field of a validated record
+ *
+ * @param layout Layout
+ * @param rec Record
+ * @param col Column of TYPE_TEXT or TYPE_BYTES
+ * @param len Output: field length
+ * @return Field bytes, inside rec or the column's dictionary
+ */
+static inline const void* record_get_bytes(const record_layout_t* layout, const void* rec,
+                                           uint16_t col, uint16_t* len) {
+    if (layout->codes[col]) {
+        uint32_t code = record_get_code(layout, rec, col);
+        if (code != TYPE_DICT_NONE)
+            return type_dict_value(layout->dicts[col], code, len);
+    }
+    const uint8_t* base  = (const uint8_t*)rec;
+    uint16_t       entry = layout->offsets[col];
+    uint16_t       end, start = layout->var_data;
+    memcpy(&end, base + layout->var_table + 2 * entry, sizeof(end));
+    if (entry > 0)
+        memcpy(&start, base + layout->var_table + 2 * (entry - 1), sizeof(start));
+    *len = (uint16_t)(end - start);
+    return base + start;
+}
+
+/**
+ * Define record_get_<suffix>() and record_set_<suffix>() for a fixed-width
+ * column type stored as ctype. The setter overwrites the field in place
+ * and clears its null bit.
+ */
+#define RECORD_FIXED_ACCESSORS(suffix, ctype)                                                  \
+    static inline ctype record_get_##suffix(const record_layout_t* layout, const void* rec,   \
+                                            uint16_t col) {                                   \
+        ctype v;                                                                              \
+        memcpy(&v, (const uint8_t*)rec + layout->offsets[col], sizeof(v));                    \
+        return v;                                                                             \
+    }                                                                                         \
+    static inline void record_set_##suffix(const record_layout_t* layout, void* rec,          \
+                                           uint16_t col, ctype v) {                           \
+        memcpy((uint8_t*)rec + layout->offsets[col], &v, sizeof(v));                          \
+        ((uint8_t*)rec)[col >> 3] &= (uint8_t) ~(1u << (col & 7));                            \
+    }
+
+RECORD_FIXED_ACCESSORS(bool, uint8_t)
+RECORD_FIXED_ACCESSORS(i32, int32_t)
+RECORD_FIXED_ACCESSORS(i64, int64_t)
+RECORD_FIXED_ACCESSORS(f64, double)
+
+/**
+ * Prepare an equality predicate on a text or bytes column
+ *
+ * On a dictionary column the value is looked up once here, so rows are
+ * then matched by comparing codes. A value the dictionary does not hold
+ * can only equal fields stored inline; rows encoded after this call with
+ * the value newly added to the dictionary are not matched.
+ *
+ * @param layout Layout
+ * @param col Column of TYPE_TEXT or TYPE_BYTES
+ * @param data Value to match, which must outlive the predicate
+ * @param len Value length
+ * @param match Output: predicate
+ */
+void record_match_init(const record_layout_t* layout, uint16_t col, const void* data,
+                       uint16_t len, record_match_t* match);
+
+/**
+ * Evaluate an equality predicate on a validated record
+ *
+ * @param layout Layout
+ * @param rec Record
+ * @param match Predicate
+ * @return true if the field is not NULL and equals the value
+ */
+static inline bool record_match(const record_layout_t* layout, const void* rec,
+                                const record_match_t* match) {
+    uint16_t col = match->col;
+    if (record_is_null(rec, col))
+        return false;
+    if (layout->codes[col]) {
+        uint32_t code = record_get_code(layout, rec, col);
+        if (code != TYPE_DICT_NONE)
+            return code == match->code;
+    }
+    uint16_t    len;
+    const void* data = record_get_bytes(layout, rec, col, &len);
+    return len == match->len && memcmp(data, match->data, len) == 0;
+}
+
+/**
+ * Build a record schema at version 0
+ *
+ * @param types Column types
+ * @param dicts Dictionary of each column, NULL for a plain column (the array may be NULL)
+ * @param num_columns Number of columns, 1..RECORD_MAX_COLUMNS
+ * @return Schema or NULL if a type is unknown, a fixed-width column has a dictionary, or on
+ *         error
+ */
+record_schema_t* record_schema_create(const type_id_t* types, type_dict_t* const* dicts,
+                                      uint16_t num_columns);
+
+/**
+ * Build the next version of a record schema, with one more column
+ *
+ * The schema passed in is left as it is, so rows can be read through it
+ * until every reader has moved to the new one. The cost depends on the
+ * number of columns and versions, not on the rows.
+ *
+ * @param schema Current schema
+ * @param type Type of the new column
+ * @param dict Its dictionary, or NULL
+ * @param default_data Default for existing rows, NULL for NULL: 1 byte for TYPE_BOOL, the
+ *                     native representation for the other fixed-width types, the bytes for
+ *                     TYPE_TEXT and TYPE_BYTES (copied)
+ * @param default_len Default length, the type's size for fixed-width types
+ * @return New schema or NULL if the column or default is invalid, the layout full, or on error
+ */
+record_schema_t* record_schema_add_column(const record_schema_t* schema, type_id_t type,
+                                          type_dict_t* dict, const void* default_data,
+                                          uint16_t default_len);
+
+/**
+ * Destroy a record schema
+ *
+ * @param schema Schema (may be NULL)
+ */
+void record_schema_destroy(record_schema_t* schema);
+
+/**
+ * Get the current layout of a record schema
+ */
+static inline const record_layout_t* record_schema_current(const record_schema_t* schema) {
+    return schema->layouts[schema->num_versions - 1];
+}
+
+/**
+ * Get the schema version of a versioned row
+ *
+ * @param row Row, at least RECORD_VERSION_SIZE bytes
+ * @return Version
+ */
+static inline uint16_t record_schema_version(const void* row) {
+    uint16_t version;
+    memcpy(&version, row, sizeof(version));
+    return version;
+}
+
+/**
+ * Find the layout a versioned row was encoded with
+ *
+ * Columns from the layout's num_columns on are not in the row; they read
+ * as schema->defaults.
+ *
+ * @param schema Schema
+ * @param row Row
+ * @param len Row length
+ * @param rec Output: the record inside the row
+ * @param rec_len Output: its length
+ * @return Layout, or NULL if the row is too short or of an unknown version
+ */
+static inline const record_layout_t* record_schema_layout(const record_schema_t* schema,
+                                                          const void* row, uint16_t len,
+                                                          const void** rec, uint16_t* rec_len) {
+    if (len < RECORD_VERSION_SIZE)
+        return NULL;
+    uint16_t version = record_schema_version(row);
+    if (version >= schema->num_versions)
+        return NULL;
+    *rec     = (const uint8_t*)row + RECORD_VERSION_SIZE;
+    *rec_len = (uint16_t)(len - RECORD_VERSION_SIZE);
+    return schema->layouts[version];
+}
+
+/**
+ * Encode a row at the current version
+ *
+ * @param schema Schema
+ * @param values One value per column of the current version
+ * @param buf Output buffer
+ * @param size Size of buf
+ * @return Row length, 0 if buf is too small or the row too long
+ */
+uint16_t record_schema_encode(const record_schema_t* schema, const record_value_t* values,
+                              void* buf, uint16_t size);
+
+/**
+ * Decode every field of a versioned row, of any version
+ *
+ * @param schema Schema
+ * @param row Row
+ * @param len Row length
+ * @param values Output, one per column of the current version; columns the row predates get
+ *               their defaults
+ * @return true on success, false if the row is malformed or of an unknown version
+ */
+bool record_schema_decode(const record_schema_t* schema, const void* row, uint16_t len,
+                          record_value_t* values);
+
+/**
+ * Rewrite a versioned row at the current version
+ *
+ * @param schema Schema
+ * @param row Row
+ * @param len Row length
+ * @param buf Output buffer, not overlapping row
+ * @param size Size of buf
+ * @return Row length, 0 if the row is malformed, buf too small or the row too long
+ */
+uint16_t record_schema_upgrade(const record_schema_t* schema, const void* row, uint16_t len,
+                               void* buf, uint16_t size);
@@ -0,0 +1,106 @@
+/**
+ * @file sort.h
+ * @brief External merge sort of key/value records.
+ *
+ * Records are collected in memory buffers. Whenever a buffer fills up it is
+ * sorted and written to a run file, by a worker thread when the sort has
+ * any, while the caller goes on filling the next buffer. Once every record
+ * has been added the runs, and the records still in memory, are merged in a
+ * single pass and returned in order.
+ *
+ * Records are ordered the way B+tree keys are: by key with memcmp, shorter
+ * keys first on a common prefix, then by value. Sorted output can therefore
+ * be fed straight into btree_bulk_add().
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Smallest memory budget per sort buffer
+ */
+#define SORT_MIN_MEMORY (256 * 1024)
+
+/**
+ * Maximum number of worker threads
+ */
+#define SORT_MAX_WORKERS 16
+
+/**
+ * Sort statistics
+ */
+typedef struct {
+    uint64_t records;       /* Records added */
+    uint32_t runs;          /* Run files written */
+    uint64_t spilled_bytes; /* Bytes written to run files */
+} sort_stats_t;
+
+/**
+ * Sort context
+ */
+typedef struct sort_t sort_t;
+
+/**
+ * Begin a sort
+ *
+ * @param run_prefix Path prefix of the run files (prefix.run0, prefix.run1, ...)
+ * @param memory Memory to use for buffered records, split over the buffers
+ * @param workers Threads sorting and writing full buffers, 0..SORT_MAX_WORKERS
+ *                (0 sorts and writes them on the calling thread)
+ * @return Sort context or NULL on error
+ */
+sort_t* sort_begin(const char* run_prefix, size_t memory, uint32_t workers);
+
+/**
+ * Add a record
+ *
+ * @param sort Sort context, not yet finished
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param value Value bytes
+ * @param value_len Value length
+ * @return true on success, false on error (the sort cannot be finished)
+ */
+bool sort_add(sort_t* sort, const void* key, uint16_t key_len, const void* value,
+              uint16_t value_len);
+
+/**
+ * Stop adding records and prepare to return them in order
+ *
+ * @param sort Sort context
+ * @return true on success, false if a run could not be written or read
+ */
+bool sort_finish(sort_t* sort);
+
+/**
+ * Return the next record in order
+ *
+ * @param sort Finished sort context
+ * @param key Output: key, valid until the next call
+ * @param key_len Output: key length
+ * @param value Output: value, valid until the next call
+ * @param value_len Output: value length
+ * @return true if a record was returned, false at the end or on a read error
+ */
+bool sort_next(sort_t* sort, const void** key, uint16_t* key_len, const void** value,
+               uint16_t* value_len);
+
+/**
+ * Check whether a sort failed to write or read one of its runs
+ */
+bool sort_failed(const sort_t* sort);
+
+/**
+ * Get sort statistics
+ */
+void sort_get_stats(const sort_t* sort, sort_stats_t* stats);
+
+/**
+ * End a sort, waiting for its workers and removing its run files
+ *
+ * @param sort Sort context (may be NULL)
+ */
+void sort_end(sort_t* sort);
@@ -0,0 +1,675 @@
+/**
+ * @file table.h
+ * @brief Tables: a heap plus the secondary indexes kept in step with it.
+ *
+ * The table layer applies every row change to the heap and then to each
+ * attached index. Index entries point at the root of a row's HOT chain, so
+ * an update that leaves every index key unchanged is performed as a
+ * heap-only update and writes no index entries at all.
+ *
+ * A table can instead be index-organized (clustered): its rows are stored
+ * in the leaves of a B+tree on the primary key and its secondary indexes
+ * map keys to primary keys rather than tuple IDs. Primary-key range scans
+ * then read consecutive leaves only, and rows that move between leaves on
+ * a split need no secondary index maintenance. Clustered rows carry no
+ * transaction header; the xid arguments are only recorded by heap tables.
+ *
+ * A heap table with a tiering policy moves its cold rows into immutable
+ * tier segments (see tier.h), either on demand or from a background
+ * thread. Table scans return the hot heap rows followed by the rows of
+ * every segment. Tiered rows are read-only and leave the table's indexes,
+ * so only scans reach them.
+ *
+ * Index-only lookups answer from an index's keys and INCLUDE payloads
+ * alone. They consult the heap's visibility map, which vacuum maintains,
+ * and read a row only when its page is not all-visible, to check that the
+ * row is live.
+ *
+ * Queries given as an expression, a key and a list of conditions are
+ * planned by table_select(): it picks an index on the same expression
+ * whose predicate (for partial indexes) is among the conditions, and falls
+ * back to a full scan otherwise. It also keeps statistics per query shape
+ * (expression and conditions), which table_index_advice() weighs, together
+ * with the usage counters of every index, to propose indexes to create or
+ * drop.
+ *
+ * Indexes are normally created while no rows change. A B+tree index of a
+ * heap table can instead be built concurrently: writers carry on while it
+ * is bulk loaded and record their changes in a side log, and they are only
+ * held up by the brief lock under which the rest of the log is merged and
+ * the index attached.
+ */
+
+#pragma once
+
+#include <monodb/core/data/btree.h>
+#include <monodb/core/data/index.h>
+#include <monodb/core/storage/heap.h>
+#include <monodb/core/storage/tier.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Maximum number of indexes on a table
+ */
+#define TABLE_MAX_INDEXES 16
+
+/**
+ * Query shapes a table keeps statistics for; further shapes are not tracked
+ */
+#define TABLE_MAX_QUERY_SHAPES 32
+
+/**
+ * Conditions of a tracked query shape; queries with more are not tracked
+ */
+#define TABLE_SHAPE_MAX_CONDITIONS 4
+
+/**
+ * Access method of a secondary index
+ */
+typedef enum {
+    TABLE_INDEX_BTREE   = 0, /* Persistent B+tree: ordered, range scans */
+    TABLE_INDEX_HASH    = 1, /* Persistent extendible hash: equality lookups in one page read */
+    TABLE_INDEX_ART     = 2, /* In-memory adaptive radix tree, rebuilt from the rows on creation */
+    TABLE_INDEX_LEARNED = 3  /* In-memory learned index over 8-byte keys, built from the rows */
+} table_index_method_t;
+
+/**
+ * Definition of a secondary index
+ */
+typedef struct {
+    const char*          name;        /* Index name */
+    table_index_method_t method;      /* Access method */
+    index_key_fn         key_fn;      /* Extracts the indexed key of a row */
+    void*                key_arg;     /* Argument passed to key_fn */
+    index_key_fn         include_fn;  /* Extracts the INCLUDE columns, or NULL (B+tree only) */
+    void*                include_arg; /* Argument passed to include_fn */
+    index_predicate_fn   where_fn;    /* Rows the index holds (partial index), or NULL for all */
+    void*                where_arg;   /* Argument passed to where_fn */
+} table_index_def_t;
+
+/**
+ * How a lookup found its rows
+ */
+typedef enum {
+    TABLE_PLAN_INDEX_ONLY_SCAN = 0, /* Index entries, reading rows only on changed pages */
+    TABLE_PLAN_INDEX_SCAN      = 1, /* Index entries, then the rows they point at */
+    TABLE_PLAN_SEQ_SCAN        = 2  /* Every row of the table */
+} table_plan_t;
+
+/**
+ * What a lookup did, for EXPLAIN output
+ */
+typedef struct {
+    table_plan_t plan;            /* Access path taken */
+    const char*  index;           /* Index used, NULL for sequential scans */
+    bool         covering;        /* Whether the index stores INCLUDE columns */
+    bool         partial;         /* Whether the index is partial */
+    uint64_t     rows;            /* Rows returned */
+    uint64_t     heap_fetches;    /* Rows checked in the heap, their page not being all-visible */
+    uint64_t     fetches_avoided; /* Rows returned from the index alone */
+} table_explain_t;
+
+/**
+ * Equality query for table_select(): rows whose expression value equals a
+ * key and that satisfy every condition
+ */
+typedef struct {
+    index_key_fn             expr;           /* Expression, as an index key extractor */
+    void*                    expr_arg;       /* Argument passed to expr */
+    const void*              key;            /* Value sought */
+    uint16_t                 key_len;        /* Value length */
+    const index_predicate_t* conditions;     /* Further conditions, all of which must hold */
+    uint32_t                 num_conditions; /* Number of conditions */
+    const char*              expr_name;      /* Expression text for index advice (kept), or NULL */
+} table_query_t;
+
+/**
+ * Statistics of one query shape: the queries of table_select() on the same
+ * expression with the same conditions, in any order
+ */
+typedef struct {
+    index_key_fn      expr;                                   /* Expression */
+    void*             expr_arg;                               /* Argument passed to expr */
+    const char*       expr_name;                              /* Expression text, or NULL */
+    index_predicate_t conditions[TABLE_SHAPE_MAX_CONDITIONS]; /* Conditions */
+    uint32_t          num_conditions;                         /* Number of conditions */
+    uint64_t          calls;                                  /* Queries run */
+    uint64_t          index_scans;                            /* Queries an index served */
+    uint64_t          rows;                                   /* Rows returned */
+    uint64_t          examined;                               /* Rows read to find them */
+} table_shape_stats_t;
+
+/**
+ * Kind of index advice
+ */
+typedef enum {
+    TABLE_ADVICE_CREATE = 0, /* An index on a query shape's expression would pay for itself */
+    TABLE_ADVICE_DROP   = 1  /* An index costs more to maintain than its lookups save */
+} table_advice_kind_t;
+
+/**
+ * One proposal of table_index_advice(). Costs are in the planner's units,
+ * one row read by a sequential scan being 1, summed over the workload seen.
+ */
+typedef struct {
+    table_advice_kind_t kind;
+    const char*         index;     /* Index to drop; NULL for creations */
+    index_key_fn        expr;      /* Expression to index; NULL for drops */
+    void*               expr_arg;  /* Argument passed to expr */
+    const char*         expr_name; /* Expression text, or NULL */
+    uint64_t            queries;   /* Queries the index would serve, or served */
+    double              saved;     /* Query cost the index saves */
+    double              upkeep;    /* Cost of maintaining its entries */
+    double              benefit;   /* Estimated gain of following the advice */
+} table_advice_t;
+
+/**
+ * Table statistics
+ */
+typedef struct {
+    uint64_t inserts;         /* Rows inserted */
+    uint64_t updates;         /* Rows updated */
+    uint64_t hot_updates;     /* Updates that left the indexes untouched */
+    uint64_t deletes;         /* Rows deleted */
+    uint64_t index_inserts;   /* Index entries added */
+    uint64_t index_removes;   /* Index entries removed */
+    uint64_t index_loaded;    /* Index entries written by sorted index builds */
+    uint64_t heap_fetches;    /* Rows index-only lookups had to check in the heap */
+    uint64_t fetches_avoided; /* Rows index-only lookups returned without reading the heap */
+    uint64_t side_log_merged; /* Side log entries merged by concurrent index builds */
+    uint64_t tier_passes;     /* Tiering passes run */
+    uint64_t tiered_rows;     /* Rows moved into tier segments */
+    uint32_t segments;        /* Tier segments of the table */
+} table_stats_t;
+
+/**
+ * Predicate deciding whether a row is cold enough to be tiered
+ *
+ * @param data Row payload
+ * @param len Payload length
+ * @param arg Caller argument
+ * @return true if the row should move to a tier segment
+ */
+typedef bool (*table_cold_fn)(const void* data, uint16_t len, void* arg);
+
+/**
+ * Tiering policy of a heap table
+ */
+typedef struct {
+    tier_layout_t layout;      /* Row layout; rows of any other length stay in the heap */
+    table_cold_fn is_cold;     /* Selects the rows to move */
+    void*         cold_arg;    /* Argument passed to is_cold */
+    uint32_t      min_rows;    /* Fewest cold rows worth writing a segment for */
+    uint32_t      interval_ms; /* Pause between background passes */
+    uint32_t      xid;         /* Transaction recorded as deleting the moved heap rows */
+} table_tier_policy_t;
+
+/**
+ * Callback receiving rows found through an index
+ *
+ * @param tid Row address (HOT chain root); INVALID_TUPLE_ID for index-organized tables
+ * @param data Row payload, valid for the duration of the call
+ * @param len Payload length
+ * @param arg Caller argument
+ * @return true to continue, false to stop
+ */
+typedef bool (*table_visit_fn)(tuple_id_t tid, const void* data, uint16_t len, void* arg);
+
+/**
+ * Table context
+ */
+typedef struct table_t table_t;
+
+/**
+ * Table scan context
+ */
+typedef struct table_scan_t table_scan_t;
+
+/**
+ * Open (or create) a table stored in a heap file
+ *
+ * @param pool Buffer pool to cache pages in
+ * @param path Path of the heap file
+ * @return Table or NULL on error
+ */
+table_t* table_open(buffer_pool_t* pool, const char* path);
+
+/**
+ * Open (or create) an index-organized table
+ *
+ * @param pool Buffer pool to cache pages in
+ * @param path Path of the primary B+tree file
+ * @param pk_fn Extracts the primary key of a row (byte-comparable, unique)
+ * @param pk_arg Argument passed to pk_fn
+ * @return Table or NULL on error
+ */
+table_t* table_open_clustered(buffer_pool_t* pool, const char* path, index_key_fn pk_fn,
+                              void* pk_arg);
+
+/**
+ * Check whether a table is index-organized
+ */
+bool table_is_clustered(const table_t* table);
+
+/**
+ * Close a table and destroy its indexes
+ *
+ * @param table Table to close
+ */
+void table_close(table_t* table);
+
+/**
+ * Get the heap of a table (NULL for index-organized tables)
+ */
+heap_t* table_heap(const table_t* table);
+
+/**
+ * Attach an index and build its entries for the rows already stored. Only
+ * heap tables accept arbitrary access methods; see table_create_index().
+ *
+ * Indexes must be attached before the table is used concurrently.
+ *
+ * @param table Table
+ * @param index Index; the table takes ownership, also on failure
+ * @return true on success, false on error
+ */
+bool table_add_index(table_t* table, index_t* index);
+
+/**
+ * Create a B+tree secondary index stored next to the table (path.name) and
+ * build it. On an index-organized table its entries hold primary keys.
+ *
+ * The entries of the rows already stored are sorted (an external sort,
+ * spilling runs next to the index file) and loaded bottom-up, filling nodes
+ * to the table's index fill factor. An index file kept from an earlier
+ * session, after the table is reopened, is attached as it is without a
+ * rebuild; the table must not have changed while the index was detached.
+ *
+ * @param table Table
+ * @param name Index name
+ * @param key_fn Extracts the indexed key of a row
+ * @param key_arg Argument passed to key_fn
+ * @return true on success, false on error
+ */
+bool table_create_index(table_t* table, const char* name, index_key_fn key_fn, void* key_arg);
+
+/**
+ * Create a secondary index with a chosen access method and build it. B+tree
+ * indexes are created as by table_create_index(). Hash indexes are stored
+ * next to the table (path.name) and reattached after a reopen like B+tree
+ * indexes; ART indexes live in memory only and are rebuilt from the rows
+ * each time they are created, normally after the table is opened.
+ * Index-organized tables accept B+tree indexes only.
+ *
+ * @param table Table
+ * @param name Index name
+ * @param method Access method
+ * @param key_fn Extracts the indexed key of a row
+ * @param key_arg Argument passed to key_fn
+ * @return true on success, false for an unsupported method or on error
+ */
+bool table_create_index_using(table_t* table, const char* name, table_index_method_t method,
+                              index_key_fn key_fn, void* key_arg);
+
+/**
+ * Create a secondary index from a definition and build it, as
+ * table_create_index_using() does. INCLUDE columns are stored in each
+ * entry of a B+tree index on a heap table, for index-only lookups; other
+ * methods and index-organized tables reject them. A partial index holds
+ * entries only for the rows satisfying its predicate, with any method.
+ *
+ * @param table Table
+ * @param def Index definition
+ * @return true on success, false for an unsupported definition or on error
+ */
+bool table_create_index_def(table_t* table, const table_index_def_t* def);
+
+/**
+ * Create a B+tree index on a heap table without stopping row changes.
+ * Writers are blocked only twice, briefly: while the build registers and
+ * while it attaches the index. In between, the rows are scanned and the
+ * sorted entries bulk loaded as by table_create_index_def(), while every
+ * concurrent insert, update and delete appends the entries it adds or
+ * removes to an in-memory side log. The log is merged into the tree in
+ * rounds until little is left; the last of it is merged under the lock at
+ * the switch, after which the index is maintained like any other. Only
+ * one concurrent build may run per table at a time.
+ *
+ * @param table Heap table
+ * @param def Index definition; the method must be TABLE_INDEX_BTREE
+ * @return true on success, false if the definition is unsupported, the
+ *         index file is not empty, another build is running, or on error
+ */
+bool table_create_index_concurrently(table_t* table, const table_index_def_t* def);
+
+/**
+ * Find an attached index of a heap table by name
+ *
+ * @param table Table
+ * @param name Index name
+ * @return Index or NULL if not found
+ */
+index_t* table_find_index(table_t* table, const char* name);
+
+/**
+ * Set how full B+tree index builds pack their nodes (BTREE_DEFAULT_FILLFACTOR
+ * by default). Space left free absorbs later inserts without splits.
+ *
+ * @param table Table
+ * @param fillfactor Percentage of each node to fill, clamped to BTREE_MIN_FILLFACTOR..100
+ */
+void table_set_index_fillfactor(table_t* table, uint32_t fillfactor);
+
+/**
+ * Enable or disable heap-only updates (enabled by default)
+ *
+ * @param table Table
+ * @param enabled Whether updates that keep every index key may be heap-only
+ */
+void table_set_hot_updates(table_t* table, bool enabled);
+
+/**
+ * Insert a row
+ *
+ * @param table Table
+ * @param data Row payload
+ * @param len Payload length
+ * @param xid Inserting transaction
+ * @param tid If not NULL, the row address is stored here
+ * @return true on success, false on error
+ */
+bool table_insert(table_t* table, const void* data, uint16_t len, uint32_t xid, tuple_id_t* tid);
+
+/**
+ * Update a row of a heap table
+ *
+ * @param table Table
+ * @param tid Row address
+ * @param data New row payload
+ * @param len New payload length
+ * @param xid Updating transaction
+ * @param new_tid If not NULL, the row's address after the update is stored here
+ *                (unchanged for heap-only updates)
+ * @return true on success, false if the row does not exist or on error
+ */
+bool table_update(table_t* table, tuple_id_t tid, const void* data, uint16_t len, uint32_t xid,
+                  tuple_id_t* new_tid);
+
+/**
+ * Delete a row of a heap table
+ *
+ * @param table Table
+ * @param tid Row address
+ * @param xid Deleting transaction
+ * @return true on success, false if the row does not exist or on error
+ */
+bool table_delete(table_t* table, tuple_id_t tid, uint32_t xid);
+
+/**
+ * Fetch a row of an index-organized table by primary key
+ *
+ * @param table Table
+ * @param pk Primary key
+ * @param pk_len Primary key length
+ * @param buf Destination buffer
+ * @param buf_size Size of buf
+ * @param len Output: row length (may exceed buf_size, in which case the copy is truncated)
+ * @return true if the row exists
+ */
+bool table_fetch_key(table_t* table, const void* pk, uint16_t pk_len, void* buf,
+                     uint16_t buf_size, uint16_t* len);
+
+/**
+ * Update a row of an index-organized table. The new row may change the
+ * primary key, which moves it within the tree.
+ *
+ * @param table Table
+ * @param pk Primary key of the row
+ * @param pk_len Primary key length
+ * @param data New row payload
+ * @param len New payload length
+ * @param xid Updating transaction
+ * @return true on success, false if the row does not exist, the new key is taken or on error
+ */
+bool table_update_key(table_t* table, const void* pk, uint16_t pk_len, const void* data,
+                      uint16_t len, uint32_t xid);
+
+/**
+ * Delete a row of an index-organized table
+ *
+ * @param table Table
+ * @param pk Primary key of the row
+ * @param pk_len Primary key length
+ * @param xid Deleting transaction
+ * @return true on success, false if the row does not exist or on error
+ */
+bool table_delete_key(table_t* table, const void* pk, uint16_t pk_len, uint32_t xid);
+
+/**
+ * Visit the rows of an index-organized table with lo <= primary key < hi,
+ * in key order
+ *
+ * @param table Table
+ * @param lo Lower bound, NULL for none
+ * @param lo_len Lower bound length
+ * @param hi Upper bound, NULL for none
+ * @param hi_len Upper bound length
+ * @param visit Called for each row (tid is INVALID_TUPLE_ID)
+ * @param arg Passed to visit
+ * @return true on success, false on error or for heap tables
+ */
+bool table_range_scan(table_t* table, const void* lo, uint16_t lo_len, const void* hi,
+                      uint16_t hi_len, table_visit_fn visit, void* arg);
+
+/**
+ * Find the live rows with a key through an index of either table layout
+ *
+ * @param table Table
+ * @param name Index name
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param visit Called for each matching row
+ * @param arg Passed to visit
+ * @return true on success, false if there is no such index or on error
+ */
+bool table_lookup(table_t* table, const char* name, const void* key, uint16_t key_len,
+                  table_visit_fn visit, void* arg);
+
+/**
+ * Find the live rows with a key through an index of a heap table
+ *
+ * @param table Table
+ * @param index Index of the table
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param visit Called for each live matching row
+ * @param arg Passed to visit
+ * @return true on success, false on error
+ */
+bool table_index_lookup(table_t* table, index_t* index, const void* key, uint16_t key_len,
+                        table_visit_fn visit, void* arg);
+
+/**
+ * Find the live rows with a key through an index of a heap table without
+ * reading them: each match is returned with the entry's INCLUDE payload.
+ * Rows on all-visible pages are returned from the index alone; others are
+ * checked in the heap first, and skipped if they are no longer live.
+ *
+ * @param table Table
+ * @param name Index name
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param visit Called for each match with its INCLUDE payload (empty for indexes without one)
+ * @param arg Passed to visit
+ * @param explain If not NULL, receives what the lookup did
+ * @return true on success, false if there is no such index or on error
+ */
+bool table_index_only_lookup(table_t* table, const char* name, const void* key, uint16_t key_len,
+                             table_visit_fn visit, void* arg, table_explain_t* explain);
+
+/**
+ * Find the rows a query asks for. An index on the query's expression
+ * serves it if its predicate is one of the query's conditions; of several,
+ * a partial index is preferred as the smaller. Without one, or once the
+ * table has tier segments, every row is scanned, tiered rows included.
+ * The conditions are checked on every row returned either way.
+ *
+ * @param table Table
+ * @param query Query
+ * @param visit Called for each matching row
+ * @param arg Passed to visit
+ * @param explain If not NULL, receives the plan chosen and the rows returned
+ * @return true on success, false on error
+ */
+bool table_select(table_t* table, const table_query_t* query, table_visit_fn visit, void* arg,
+                  table_explain_t* explain);
+
+/**
+ * Format the EXPLAIN line of a lookup, e.g.
+ * "Index Only Scan using by_id (rows=10 heap_fetches=2 heap_fetches_avoided=8)",
+ * "Index Scan using active_by_email (partial) (rows=1)" or "Seq Scan (rows=3)"
+ *
+ * @param explain Lookup report
+ * @param buf Output buffer
+ * @param size Size of buf
+ * @return Length of the full line, as snprintf
+ */
+int table_explain_format(const table_explain_t* explain, char* buf, size_t size);
+
+/**
+ * Get the statistics of the query shapes table_select() has run
+ *
+ * @param table Table
+ * @param shapes Output array
+ * @param max Capacity of shapes
+ * @return Number of shapes written
+ */
+uint32_t table_get_query_shapes(table_t* table, table_shape_stats_t* shapes, uint32_t max);
+
+/**
+ * Propose indexes to create or drop, most beneficial first (SHOW INDEX
+ * ADVICE). Each query shape that was answered by full scans is planned
+ * again against a hypothetical index on its expression: the scans it
+ * would have saved, less the cost of maintaining the index through the
+ * row changes seen, is the benefit of creating it. An index whose lookups
+ * saved less than its maintenance cost, unused indexes included, is
+ * proposed for dropping. Only heap table indexes count their use; a table
+ * with tier segments gets no proposals to create one.
+ *
+ * @param table Table
+ * @param advice Output array
+ * @param max Capacity of advice
+ * @return Number of proposals written
+ */
+uint32_t table_index_advice(table_t* table, table_advice_t* advice, uint32_t max);
+
+/**
+ * Format one line of index advice, e.g.
+ * "CREATE INDEX ON lower(email) (queries=40 saved=39960 upkeep=800 benefit=39160)" or
+ * "DROP INDEX by_counter (queries=0 saved=0 upkeep=1600 benefit=1600)"
+ *
+ * @param advice Proposal
+ * @param buf Output buffer
+ * @param size Size of buf
+ * @return Length of the full line, as snprintf
+ */
+int table_advice_format(const table_advice_t* advice, char* buf, size_t size);
+
+/**
+ * Vacuum a heap table: prune its pages and mark the all-visible ones in
+ * the visibility map, so index-only lookups can skip them
+ *
+ * @param table Table
+ * @param stats If not NULL, receives the result of the pass
+ * @return true on success, false on error or for index-organized tables
+ */
+bool table_vacuum(table_t* table, heap_vacuum_stats_t* stats);
+
+/**
+ * Get table statistics
+ *
+ * @param table Table
+ * @param stats Output statistics
+ */
+void table_get_stats(table_t* table, table_stats_t* stats);
+
+/**
+ * Set the tiering policy of a heap table. The layout must match the
+ * segments the table already has. Must not be called while a tiering pass
+ * may run.
+ *
+ * @param table Heap table
+ * @param policy Policy (copied)
+ * @return true on success, false for index-organized tables or an invalid policy
+ */
+bool table_set_tier_policy(table_t* table, const table_tier_policy_t* policy);
+
+/**
+ * Run one tiering pass: copy the cold heap rows into a new segment, publish
+ * it and delete the rows from the heap and its indexes. Scans, updates and
+ * deletes wait while the pass runs. No segment is written if fewer than
+ * policy.min_rows rows are cold.
+ *
+ * @param table Table with a tiering policy
+ * @param moved If not NULL, the number of rows moved is stored here
+ * @return true on success (including passes that move nothing), false on error
+ */
+bool table_tier(table_t* table, uint64_t* moved);
+
+/**
+ * Start a background thread running a tiering pass every policy.interval_ms
+ *
+ * @param table Table with a tiering policy
+ * @return true on success, false on error or if the thread is already running
+ */
+bool table_start_tiering(table_t* table);
+
+/**
+ * Stop the background tiering thread, waiting for a running pass to end
+ *
+ * @param table Table
+ */
+void table_stop_tiering(table_t* table);
+
+/**
+ * Get the combined statistics of a table's tier segments
+ *
+ * @param table Table
+ * @param stats Output statistics, summed over all segments
+ * @return true on success, false if a segment cannot be read
+ */
+bool table_get_tier_stats(table_t* table, tier_segment_stats_t* stats);
+
+/**
+ * Begin a scan over every row of a heap table: the heap first, then each
+ * tier segment. Tiering passes wait until the scan ends, so the thread
+ * holding a scan must not run one itself.
+ *
+ * @param table Heap table
+ * @param filter Optional range filter on a column of the tiering layout
+ *               (requires a tiering policy); segment blocks the filter rules
+ *               out are skipped without being decoded, and heap rows of
+ *               another length never match
+ * @return Scan context or NULL on error
+ */
+table_scan_t* table_scan_begin(table_t* table, const tier_filter_t* filter);
+
+/**
+ * Return the next row of a table scan
+ *
+ * @param scan Scan context
+ * @param tid If not NULL, the row address is stored here (INVALID_TUPLE_ID for tiered rows)
+ * @param data Output: pointer to the payload, valid until the next call
+ * @param len Output: payload length
+ * @return true if a row was returned, false at the end of the scan or on error
+ */
+bool table_scan_next(table_scan_t* scan, tuple_id_t* tid, const void** data, uint16_t* len);
+
+/**
+ * End a table scan
+ *
+ * @param scan Scan context
+ */
+void table_scan_end(table_scan_t* scan);
@@ -0,0 +1,249 @@
+/**
+ * @file buffer.h
+ * @brief Shared buffer pool for MonoDB storage files.
+ *
+ * The buffer pool caches pages of any number of storage files in a fixed
+ * set of frames. Replacement uses a clock sweep over per-frame usage
+ * counts. Large sequential operations (full scans, vacuum, bulk loads)
+ * can instead recycle a small private ring of frames through a buffer
+ * access strategy, so a single pass over a big table does not evict the
+ * hot working set. Frames used by a ring remain in the shared page table
+ * and are visible to every other backend reading the same pages.
+ */
+
+#pragma once
+
+#include <monodb/core/storage/disk_manager.h>
+#include <monodb/core/storage/page.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Index of a frame in the buffer pool
+ */
+typedef int32_t buffer_id_t;
+
+#define INVALID_BUFFER ((buffer_id_t)-1)
+
+/**
+ * Maximum usage count a frame can accumulate under the clock sweep
+ */
+#define BUFFER_MAX_USAGE_COUNT 5
+
+/**
+ * Buffer access types
+ */
+typedef enum {
+    BUFFER_ACCESS_NORMAL    = 0, /* Random access through the shared replacement policy */
+    BUFFER_ACCESS_BULKREAD  = 1, /* Large sequential scan */
+    BUFFER_ACCESS_BULKWRITE = 2, /* Bulk load or table rewrite */
+    BUFFER_ACCESS_VACUUM    = 3, /* Vacuum / pruning pass */
+    BUFFER_ACCESS_COUNT
+} buffer_access_type_t;
+
+/**
+ * Content latch modes
+ */
+typedef enum {
+    BUFFER_LOCK_SHARE     = 0,
+    BUFFER_LOCK_EXCLUSIVE = 1
+} buffer_lock_mode_t;
+
+/**
+ * Buffer pool statistics
+ */
+typedef struct {
+    uint64_t hits[BUFFER_ACCESS_COUNT];   /* Requests satisfied from the pool, per access type */
+    uint64_t misses[BUFFER_ACCESS_COUNT]; /* Requests that needed a disk read, per access type */
+    uint64_t evictions;                   /* Valid pages replaced */
+    uint64_t dirty_writes;                /* Dirty pages written back on eviction or flush */
+    uint64_t ring_reuses;                 /* Victims taken from a strategy ring */
+} buffer_pool_stats_t;
+
+/**
+ * Buffer pool context
+ */
+typedef struct buffer_pool_t buffer_pool_t;
+
+/**
+ * Buffer access strategy (private ring of frames)
+ */
+typedef struct buffer_strategy_t buffer_strategy_t;
+
+/**
+ * Create a buffer pool
+ *
+ * @param num_frames Number of PAGE_SIZE frames to allocate
+ * @return Buffer pool or NULL on error
+ */
+buffer_pool_t* buffer_pool_create(uint32_t num_frames);
+
+/**
+ * Flush all dirty pages and free the buffer pool
+ *
+ * @param pool Buffer pool to destroy
+ */
+void buffer_pool_destroy(buffer_pool_t* pool);
+
+/**
+ * Get the number of frames in the pool
+ *
+ * @param pool Buffer pool
+ * @return Frame count
+ */
+uint32_t buffer_pool_size(const buffer_pool_t* pool);
+
+/**
+ * Create an access strategy for a large sequential operation
+ *
+ * The ring size defaults to 256kB for bulk reads and vacuum and 16MB for
+ * bulk writes, capped at 1/8 of the pool.
+ *
+ * @param pool Buffer pool
+ * @param type Access type; BUFFER_ACCESS_NORMAL returns NULL (no strategy)
+ * @return Strategy or NULL
+ */
+buffer_strategy_t* buffer_strategy_create(buffer_pool_t* pool, buffer_access_type_t type);
+
+/**
+ * Create an access strategy with an explicit ring size
+ *
+ * @param pool Buffer pool
+ * @param type Access type
+ * @param ring_size Number of frames in the ring
+ * @return Strategy or NULL
+ */
+buffer_strategy_t* buffer_strategy_create_sized(buffer_pool_t* pool, buffer_access_type_t type,
+                                                uint32_t ring_size);
+
+/**
+ * Free an access strategy. Frames in the ring stay in the pool.
+ *
+ * @param strategy Strategy to free (may be NULL)
+ */
+void buffer_strategy_free(buffer_strategy_t* strategy);
+
+/**
+ * Get the number of frames in a strategy ring
+ *
+ * @param strategy Strategy
+ * @return Ring size
+ */
+uint32_t buffer_strategy_ring_size(const buffer_strategy_t* strategy);
+
+/**
+ * Read a page into the pool and pin it
+ *
+ * @param pool Buffer pool
+ * @param file Storage file the page belongs to
+ * @param page_id Page to read
+ * @param strategy Access strategy, or NULL for the shared replacement policy
+ * @return Pinned buffer or INVALID_BUFFER on error
+ */
+buffer_id_t buffer_read(buffer_pool_t* pool, disk_manager_t* file, page_id_t page_id,
+                        buffer_strategy_t* strategy);
+
+/**
+ * Extend a file by one page and pin the new (zeroed) page
+ *
+ * @param pool Buffer pool
+ * @param file Storage file to extend
+ * @param strategy Access strategy, or NULL
+ * @param page_id Output: number of the new page
+ * @return Pinned buffer or INVALID_BUFFER on error
+ */
+buffer_id_t buffer_extend(buffer_pool_t* pool, disk_manager_t* file, buffer_strategy_t* strategy,
+                          page_id_t* page_id);
+
+/**
+ * Unpin a buffer
+ *
+ * @param pool Buffer pool
+ * @param buf Buffer to release
+ */
+void buffer_release(buffer_pool_t* pool, buffer_id_t buf);
+
+/**
+ * Get the page contents of a pinned buffer
+ *
+ * @param pool Buffer pool
+ * @param buf Pinned buffer
+ * @return Pointer to PAGE_SIZE bytes
+ */
+void* buffer_page(buffer_pool_t* pool, buffer_id_t buf);
+
+/**
+ * Get the page number held by a pinned buffer
+ *
+ * @param pool Buffer pool
+ * @param buf Pinned buffer
+ * @return Page number
+ */
+page_id_t buffer_page_id(buffer_pool_t* pool, buffer_id_t buf);
+
+/**
+ * Mark a pinned, exclusively latched buffer as modified
+ *
+ * @param pool Buffer pool
+ * @param buf Buffer
+ */
+void buffer_mark_dirty(buffer_pool_t* pool, buffer_id_t buf);
+
+/**
+ * Acquire the content latch of a pinned buffer
+ *
+ * @param pool Buffer pool
+ * @param buf Pinned buffer
+ * @param mode Latch mode
+ */
+void buffer_lock(buffer_pool_t* pool, buffer_id_t buf, buffer_lock_mode_t mode);
+
+/**
+ * Release the content latch of a pinned buffer
+ *
+ * @param pool Buffer pool
+ * @param buf Pinned buffer
+ * @param mode Mode the latch was acquired in
+ */
+void buffer_unlock(buffer_pool_t* pool, buffer_id_t buf, buffer_lock_mode_t mode);
+
+/**
+ * Write all dirty pages of a file back to disk
+ *
+ * @param pool Buffer pool
+ * @param file Storage file
+ * @return true on success, false on failure
+ */
+bool buffer_flush_file(buffer_pool_t* pool, disk_manager_t* file);
+
+/**
+ * Flush and forget all pages of a file. No page of the file may be pinned.
+ *
+ * @param pool Buffer pool
+ * @param file Storage file
+ * @return true on success, false on failure
+ */
+bool buffer_drop_file(buffer_pool_t* pool, disk_manager_t* file);
+
+/**
+ * Write all dirty pages back to disk
+ *
+ * @param pool Buffer pool
+ * @return true on success, false on failure
+ */
+bool buffer_flush_all(buffer_pool_t* pool);
+
+/**
+ * Get buffer pool statistics
+ *
+ * @param pool Buffer pool
+ * @param stats Output statistics
+ */
+void buffer_pool_get_stats(buffer_pool_t* pool, buffer_pool_stats_t* stats);
+
+/**
+ * Reset buffer pool statistics
+ *
+ * @param pool Buffer pool
+ */
+void buffer_pool_reset_stats(buffer_pool_t* pool);
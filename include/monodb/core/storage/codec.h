@@ -0,0 +1,152 @@
+/**
+ * @file codec.h
+ * @brief Lightweight compression codecs for columns of integers.
+ *
+ * A codec stream holds one column of 64-bit values (narrower integers are
+ * widened first, signed ones sign-extended) as:
+ *
+ *     [u8 kind][u8 bit width][u16 0][u32 count][u64 base][payload]
+ *
+ * - CODEC_CONSTANT: every value equals base; no payload.
+ * - CODEC_FOR: frame of reference. base is the smallest value and each
+ *   value is stored as its offset from it, bit-packed at the width.
+ * - CODEC_DELTA: base is the first value; the payload is the smallest
+ *   difference between neighbours (u64) followed by every later
+ *   difference's offset from it, bit-packed at the width.
+ * - CODEC_RLE: the payload is a u32 run count, each run's value (u64) and
+ *   each run's end position (u32).
+ * - CODEC_PLAIN: the values as they are.
+ *
+ * Bit-packed payloads are followed by 8 bytes of padding, so unpacking
+ * may load 8 bytes at any value's position. Unpacking is done four
+ * values at a time with AVX2 gathers on x86-64 CPUs that have it, checked
+ * at run time (codec_simd_enabled()). Range predicates
+ * are evaluated on the stream itself: against packed offsets for FOR,
+ * per run for RLE and once for CONSTANT, without materializing values.
+ *
+ * Values are stored in native byte order. Signedness only matters for
+ * ordering: choosing the frame of reference and evaluating ranges.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Size of the stream header
+ */
+#define CODEC_HEADER_SIZE 16
+
+/**
+ * Values codec_choose() looks at, at most
+ */
+#define CODEC_SAMPLE_SIZE 256
+
+/**
+ * Codec of a stream
+ */
+typedef enum {
+    CODEC_PLAIN    = 0, /* Values as they are */
+    CODEC_CONSTANT = 1, /* One value repeated */
+    CODEC_RLE      = 2, /* Runs of equal values */
+    CODEC_DELTA    = 3, /* Bit-packed differences between neighbours */
+    CODEC_FOR      = 4  /* Bit-packed offsets from the smallest value */
+} codec_kind_t;
+
+/**
+ * Number of codecs
+ */
+#define CODEC_COUNT 5
+
+/**
+ * Get the largest stream codec_encode() can produce
+ *
+ * @param n Number of values
+ * @return Size in bytes
+ */
+size_t codec_bound(uint32_t n);
+
+/**
+ * Pick the codec likely to give the smallest stream, from a sample
+ *
+ * Up to CODEC_SAMPLE_SIZE values are examined in short runs spread over
+ * the column, so runs and neighbour differences are visible.
+ *
+ * @param values Values
+ * @param n Number of values
+ * @param is_signed Whether values compare as int64_t
+ * @return Codec
+ */
+codec_kind_t codec_choose(const uint64_t* values, uint32_t n, bool is_signed);
+
+/**
+ * Encode values with a codec
+ *
+ * The codec's parameters are computed from all values. If the codec
+ * cannot represent them (a CONSTANT column with differing values, a
+ * range too wide to pack) or would be larger than CODEC_PLAIN, the
+ * values are stored plain instead.
+ *
+ * @param values Values
+ * @param n Number of values
+ * @param is_signed Whether values compare as int64_t
+ * @param kind Codec to use
+ * @param out Output, at least codec_bound(n) bytes
+ * @return Stream length
+ */
+size_t codec_encode(const uint64_t* values, uint32_t n, bool is_signed, codec_kind_t kind,
+                    void* out);
+
+/**
+ * Get the codec of a stream
+ *
+ * @param in Stream
+ * @param len Stream length
+ * @return Codec, or CODEC_COUNT if the header is malformed
+ */
+codec_kind_t codec_stream_kind(const void* in, size_t len);
+
+/**
+ * Decode a stream
+ *
+ * @param in Stream
+ * @param len Stream length
+ * @param out Output values
+ * @param n Number of values the stream must hold
+ * @return Bytes of the stream, 0 if it is malformed or holds another count
+ */
+size_t codec_decode(const void* in, size_t len, uint64_t* out, uint32_t n);
+
+/**
+ * Find the values in an inclusive range without decoding the stream
+ *
+ * Equality is the range [v, v]; v < x is [v + 1, max] and so on.
+ *
+ * @param in Stream
+ * @param len Stream length
+ * @param n Number of values the stream must hold
+ * @param is_signed Whether values compare as int64_t
+ * @param lo Smallest accepted value
+ * @param hi Largest accepted value
+ * @param sel Output: positions of the values in range, ascending; room for n
+ * @return Number of positions, or UINT32_MAX if the stream is malformed
+ */
+uint32_t codec_select(const void* in, size_t len, uint32_t n, bool is_signed, uint64_t lo,
+                      uint64_t hi, uint32_t* sel);
+
+/**
+ * Whether decoding and predicates use the AVX2 kernels: by default, when
+ * the CPU has AVX2
+ */
+bool codec_simd_enabled(void);
+
+/**
+ * Turn the AVX2 kernels on or off, to compare them with the scalar code;
+ * not to be called while other threads use the codecs
+ *
+ * @param enabled Whether to use them; they stay off on CPUs without AVX2
+ * @return Whether they are now used
+ */
+bool codec_set_simd(bool enabled);
@@ -0,0 +1,103 @@
+/**
+ * @file disk_manager.h
+ * @brief Page-granular file I/O for MonoDB storage files.
+ *
+ * A disk manager owns one storage file and exposes it as an array of
+ * PAGE_SIZE pages. All caching is done by the buffer pool; the disk
+ * manager performs direct reads and writes.
+ */
+
+#pragma once
+
+#include <monodb/core/storage/page.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * I/O statistics for a storage file
+ */
+typedef struct {
+    uint64_t pages_read;    /* Number of page reads issued */
+    uint64_t pages_written; /* Number of page writes issued */
+    uint64_t syncs;         /* Number of fsync calls */
+} disk_manager_stats_t;
+
+/**
+ * Disk manager context
+ */
+typedef struct disk_manager_t disk_manager_t;
+
+/**
+ * Open (or create) a storage file
+ *
+ * @param path Path of the file
+ * @return Disk manager or NULL on error
+ */
+disk_manager_t* disk_manager_open(const char* path);
+
+/**
+ * Close a storage file
+ *
+ * @param dm Disk manager to close
+ */
+void disk_manager_close(disk_manager_t* dm);
+
+/**
+ * Get the process-unique identifier of a storage file
+ *
+ * @param dm Disk manager
+ * @return File identifier
+ */
+uint32_t disk_manager_file_id(const disk_manager_t* dm);
+
+/**
+ * Read a page from disk
+ *
+ * @param dm Disk manager
+ * @param page_id Page to read
+ * @param buf Destination buffer of PAGE_SIZE bytes
+ * @return true on success, false on failure
+ */
+bool disk_manager_read_page(disk_manager_t* dm, page_id_t page_id, void* buf);
+
+/**
+ * Write a page to disk
+ *
+ * @param dm Disk manager
+ * @param page_id Page to write
+ * @param buf Source buffer of PAGE_SIZE bytes
+ * @return true on success, false on failure
+ */
+bool disk_manager_write_page(disk_manager_t* dm, page_id_t page_id, const void* buf);
+
+/**
+ * Extend the file by one zeroed page
+ *
+ * @param dm Disk manager
+ * @return Number of the new page, or INVALID_PAGE_ID on error
+ */
+page_id_t disk_manager_allocate_page(disk_manager_t* dm);
+
+/**
+ * Get the number of pages in the file
+ *
+ * @param dm Disk manager
+ * @return Page count
+ */
+uint32_t disk_manager_num_pages(disk_manager_t* dm);
+
+/**
+ * Force file contents to stable storage
+ *
+ * @param dm Disk manager
+ * @return true on success, false on failure
+ */
+bool disk_manager_sync(disk_manager_t* dm);
+
+/**
+ * Get I/O statistics
+ *
+ * @param dm Disk manager
+ * @param stats Output statistics
+ */
+void disk_manager_get_stats(disk_manager_t* dm, disk_manager_stats_t* stats);
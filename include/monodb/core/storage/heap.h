@@ -0,0 +1,324 @@
+/**
+ * @file heap.h
+ * @brief Heap files: unordered tuple storage on slotted pages.
+ *
+ * A heap stores tuples in insertion order on slotted pages cached by the
+ * buffer pool. Tuples are addressed by a tuple ID (page, slot) that stays
+ * stable for the lifetime of the tuple. Sequential scans of large heaps
+ * read through a bulk-read buffer ring and join synchronized scans of the
+ * same file, so concurrent scans share their I/O.
+ *
+ * Updates that do not change any indexed column and fit on the same page
+ * are heap-only (HOT): the new version is chained to the old one within
+ * the page and needs no new index entries, because index lookups reach it
+ * by following the chain from the root tuple the index points at. Chains
+ * are pruned opportunistically when their page runs low on space.
+ *
+ * A visibility map keeps one bit per page, set by vacuum when every tuple
+ * on the page is visible to all transactions and cleared by any change to
+ * the page. Index-only scans use it to skip the heap for such pages. The
+ * map is kept in memory and saved next to the heap file (path.vm) when the
+ * heap is closed; opening the heap consumes the file, so after a crash the
+ * map starts out empty rather than stale.
+ */
+
+#pragma once
+
+#include <monodb/core/storage/buffer.h>
+#include <monodb/core/storage/page.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Tuple identifier (physical address of a tuple)
+ */
+typedef struct {
+    page_id_t page_id; /* Heap page */
+    uint16_t  slot;    /* Line pointer on the page */
+} tuple_id_t;
+
+#define INVALID_TUPLE_ID ((tuple_id_t){INVALID_PAGE_ID, 0})
+
+/**
+ * Heap tuple flags
+ */
+#define HEAP_TUPLE_HOT_UPDATED 0x0001 /* Newer version is a heap-only tuple on the same page */
+#define HEAP_TUPLE_HEAP_ONLY   0x0002 /* No index entry points directly at this tuple */
+
+/**
+ * Header stored in front of every heap tuple
+ */
+typedef struct {
+    uint32_t   xmin;     /* Inserting transaction */
+    uint32_t   xmax;     /* Deleting or updating transaction, 0 while the tuple is live */
+    tuple_id_t next;     /* Newer version after an update, INVALID_TUPLE_ID otherwise */
+    uint16_t   flags;    /* HEAP_TUPLE_* flags */
+    uint16_t   reserved; /* Padding, must be zero */
+} heap_tuple_header_t;
+
+/**
+ * Heap page flags (page_header_t.flags)
+ */
+#define HEAP_PAGE_PRUNABLE 0x0001 /* Page holds superseded versions that pruning may remove */
+
+/**
+ * Pages whose free space drops below this are pruned opportunistically on access
+ */
+#define HEAP_PRUNE_FREE_THRESHOLD (PAGE_SIZE / 20)
+
+/**
+ * Default percentage of a page that inserts may fill. The rest is kept free
+ * so that later updates of the page's rows can stay heap-only.
+ */
+#define HEAP_DEFAULT_FILLFACTOR 90
+
+/**
+ * Smallest accepted fill factor
+ */
+#define HEAP_MIN_FILLFACTOR 10
+
+/**
+ * Heap statistics
+ */
+typedef struct {
+    uint64_t hot_updates;     /* Updates chained within the same page */
+    uint64_t cold_updates;    /* Updates that placed the new version as a new root tuple */
+    uint64_t prunes;          /* Page pruning passes */
+    uint64_t pruned_versions; /* Dead versions whose storage pruning reclaimed */
+} heap_stats_t;
+
+/**
+ * Result of a vacuum pass
+ */
+typedef struct {
+    uint32_t pages;           /* Pages examined */
+    uint32_t all_visible;     /* Pages marked all-visible, including ones already marked */
+    uint32_t pruned_versions; /* Dead versions reclaimed */
+} heap_vacuum_stats_t;
+
+/**
+ * Largest tuple payload a heap page can hold
+ */
+#define HEAP_MAX_TUPLE_SIZE (PAGE_MAX_ITEM_SIZE - sizeof(heap_tuple_header_t))
+
+/**
+ * A heap counts as large, and scans of it use a ring and synchronized
+ * scanning by default, once it exceeds 1/HEAP_LARGE_TABLE_DIVISOR of the pool
+ */
+#define HEAP_LARGE_TABLE_DIVISOR 4
+
+/**
+ * Sequential scan options
+ */
+typedef enum {
+    HEAP_SCAN_DEFAULT     = 0x0, /* Ring and synchronized scan only for large heaps */
+    HEAP_SCAN_SYNC        = 0x1, /* Always take part in synchronized scanning */
+    HEAP_SCAN_NO_SYNC     = 0x2, /* Never take part in synchronized scanning; start at page 0 */
+    HEAP_SCAN_BULKREAD    = 0x4, /* Always read through a bulk-read ring */
+    HEAP_SCAN_NO_BULKREAD = 0x8, /* Always use the shared replacement policy */
+    HEAP_SCAN_PLAIN       = HEAP_SCAN_NO_SYNC | HEAP_SCAN_NO_BULKREAD
+} heap_scan_flags_t;
+
+/**
+ * Heap context
+ */
+typedef struct heap_t heap_t;
+
+/**
+ * Sequential scan context
+ */
+typedef struct heap_scan_t heap_scan_t;
+
+/**
+ * Open (or create) a heap file
+ *
+ * @param pool Buffer pool to cache pages in
+ * @param path Path of the heap file
+ * @return Heap or NULL on error
+ */
+heap_t* heap_open(buffer_pool_t* pool, const char* path);
+
+/**
+ * Flush and close a heap file
+ *
+ * @param heap Heap to close
+ */
+void heap_close(heap_t* heap);
+
+/**
+ * Get the buffer pool of a heap
+ */
+buffer_pool_t* heap_pool(const heap_t* heap);
+
+/**
+ * Get the storage file of a heap
+ */
+disk_manager_t* heap_file(const heap_t* heap);
+
+/**
+ * Get the number of pages in a heap
+ *
+ * @param heap Heap
+ * @return Page count
+ */
+uint32_t heap_num_pages(const heap_t* heap);
+
+/**
+ * Insert a tuple
+ *
+ * @param heap Heap
+ * @param data Tuple payload
+ * @param len Payload length, at most HEAP_MAX_TUPLE_SIZE
+ * @param xid Inserting transaction
+ * @param tid Output: address of the new tuple
+ * @return true on success, false on failure
+ */
+bool heap_insert(heap_t* heap, const void* data, uint16_t len, uint32_t xid, tuple_id_t* tid);
+
+/**
+ * Copy the live version of a tuple out of the heap
+ *
+ * If tid is the root of a HOT chain, the chain is followed to the live version.
+ *
+ * @param heap Heap
+ * @param tid Tuple (or HOT chain root) to fetch
+ * @param buf Destination buffer
+ * @param buf_size Size of buf
+ * @param len Output: payload length (may exceed buf_size, in which case the copy is truncated)
+ * @return true if the tuple exists and is live
+ */
+bool heap_fetch(heap_t* heap, tuple_id_t tid, void* buf, uint16_t buf_size, uint16_t* len);
+
+/**
+ * Update a tuple
+ *
+ * The update is heap-only when allow_hot is set and the new version fits on
+ * the page of the old one (after pruning if necessary). Otherwise the new
+ * version is stored as a new root tuple, which the caller must index.
+ *
+ * Until the transaction layer provides snapshots, a concurrent sequential
+ * scan may observe both versions of a non-HOT update.
+ *
+ * @param heap Heap
+ * @param tid Tuple (or HOT chain root) to update
+ * @param data New tuple payload
+ * @param len New payload length
+ * @param xid Updating transaction
+ * @param allow_hot Whether the caller permits a heap-only update (no indexed column changed)
+ * @param new_tid If not NULL, the address of the new version is stored here
+ * @param hot If not NULL, set to whether the update was heap-only
+ * @return true on success, false if the tuple does not exist or on error
+ */
+bool heap_update(heap_t* heap, tuple_id_t tid, const void* data, uint16_t len, uint32_t xid,
+                 bool allow_hot, tuple_id_t* new_tid, bool* hot);
+
+/**
+ * Delete a tuple
+ *
+ * @param heap Heap
+ * @param tid Tuple (or HOT chain root) to delete
+ * @param xid Deleting transaction
+ * @return true on success, false if the tuple does not exist or is already deleted
+ */
+bool heap_delete(heap_t* heap, tuple_id_t tid, uint32_t xid);
+
+/**
+ * Set the fill factor used by inserts and by updates that leave their page
+ *
+ * @param heap Heap
+ * @param fillfactor Percentage of a page inserts may fill, HEAP_MIN_FILLFACTOR..100
+ */
+void heap_set_fillfactor(heap_t* heap, uint32_t fillfactor);
+
+/**
+ * Set the pruning horizon. Versions deleted or superseded by a transaction
+ * older than xid are invisible to everyone and may be pruned. Defaults to
+ * UINT32_MAX: with no long-running snapshots every superseded version is dead.
+ *
+ * @param heap Heap
+ * @param xid Oldest transaction that may still see old versions
+ */
+void heap_set_prune_horizon(heap_t* heap, uint32_t xid);
+
+/**
+ * Prune HOT chains on a page and defragment it
+ *
+ * @param heap Heap
+ * @param page_id Page to prune
+ * @return Number of dead versions reclaimed
+ */
+uint32_t heap_prune_page(heap_t* heap, page_id_t page_id);
+
+/**
+ * Vacuum a heap: prune every page and mark the pages whose tuples are all
+ * live and inserted before the prune horizon as all-visible
+ *
+ * @param heap Heap
+ * @param stats If not NULL, receives the result of the pass
+ * @return true on success, false on error
+ */
+bool heap_vacuum(heap_t* heap, heap_vacuum_stats_t* stats);
+
+/**
+ * Check whether a page is marked all-visible in the visibility map
+ *
+ * @param heap Heap
+ * @param page_id Page
+ * @return true if every tuple on the page is visible to all transactions
+ */
+bool heap_page_all_visible(heap_t* heap, page_id_t page_id);
+
+/**
+ * Get heap statistics
+ *
+ * @param heap Heap
+ * @param stats Output statistics
+ */
+void heap_get_stats(heap_t* heap, heap_stats_t* stats);
+
+/**
+ * Begin a sequential scan over all live tuples
+ *
+ * @param heap Heap
+ * @param flags Combination of heap_scan_flags_t
+ * @return Scan context or NULL on error
+ */
+heap_scan_t* heap_scan_begin(heap_t* heap, uint32_t flags);
+
+/**
+ * Begin a scan over the live tuples of chosen pages only, read in the
+ * order given through a bulk-read ring. Block sampling (ANALYZE) reads
+ * its sample this way. Pages past the end of the heap are skipped.
+ *
+ * @param heap Heap
+ * @param pages Pages to read (copied)
+ * @param num_pages Number of pages
+ * @return Scan context, to be used with heap_scan_next() and heap_scan_end(), or NULL on error
+ */
+heap_scan_t* heap_scan_begin_pages(heap_t* heap, const page_id_t* pages, uint32_t num_pages);
+
+/**
+ * Return the next live tuple of a scan
+ *
+ * @param scan Scan context
+ * @param tid If not NULL, the tuple address (HOT chain root for updated tuples) is stored here
+ * @param data Output: pointer to the payload, valid until the next call
+ * @param len Output: payload length
+ * @return true if a tuple was returned, false at the end of the scan or on error
+ */
+bool heap_scan_next(heap_scan_t* scan, tuple_id_t* tid, const void** data, uint16_t* len);
+
+/**
+ * Get the page a scan started at
+ *
+ * @param scan Scan context
+ * @return Start page
+ */
+page_id_t heap_scan_start_page(const heap_scan_t* scan);
+
+/**
+ * End a sequential scan
+ *
+ * @param scan Scan context
+ */
+void heap_scan_end(heap_scan_t* scan);
@@ -0,0 +1,242 @@
+/**
+ * @file page.h
+ * @brief On-disk page layout shared by all MonoDB storage files.
+ *
+ * Every file managed by the disk manager is an array of fixed-size pages.
+ * Each page starts with a common header; the remainder is interpreted by
+ * the access method that owns the page.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Size of a page in bytes
+ */
+#define PAGE_SIZE 8192
+
+/**
+ * Page number within a storage file
+ */
+typedef uint32_t page_id_t;
+
+#define INVALID_PAGE_ID ((page_id_t)0xFFFFFFFF)
+
+/**
+ * Page types
+ */
+typedef enum {
+    PAGE_TYPE_FREE  = 0, /* Never initialized / zeroed page */
+    PAGE_TYPE_HEAP  = 1, /* Table heap page */
+    PAGE_TYPE_META  = 2, /* File metadata page */
+    PAGE_TYPE_BTREE = 3, /* B+tree node */
+    PAGE_TYPE_HASH  = 4  /* Hash index bucket or overflow page */
+} page_type_t;
+
+/**
+ * Common page header
+ */
+typedef struct {
+    uint64_t  lsn;       /* WAL position of the last change (segment << 32 | offset) */
+    uint32_t  checksum;  /* Checksum of the page, computed on write-out */
+    page_id_t page_id;   /* Page number, for detecting misdirected I/O */
+    uint16_t  type;      /* page_type_t */
+    uint16_t  flags;     /* Access-method specific flags */
+    uint16_t  lower;     /* Offset to start of free space */
+    uint16_t  upper;     /* Offset to end of free space */
+    uint16_t  special;   /* Offset to access-method special space */
+    uint16_t  reserved;  /* Padding, must be zero */
+} page_header_t;
+
+/**
+ * Line pointer states
+ */
+typedef enum {
+    SLOT_UNUSED   = 0, /* Free for reuse */
+    SLOT_NORMAL   = 1, /* Points at a live item */
+    SLOT_DEAD     = 2, /* Item removed, storage may be reclaimed */
+    SLOT_REDIRECT = 3  /* No storage; offset holds the slot number to follow */
+} page_slot_state_t;
+
+/**
+ * Line pointer in the slot array following the page header. The two high
+ * bits of length hold the page_slot_state_t.
+ */
+typedef struct {
+    uint16_t offset; /* Offset of the item from the start of the page */
+    uint16_t length; /* Item length (low 14 bits) and state (high 2 bits) */
+} page_slot_t;
+
+#define PAGE_SLOT_LENGTH_MASK 0x3FFF
+#define PAGE_SLOT_STATE_SHIFT 14
+
+/**
+ * Largest item that fits on an otherwise empty page with no special space
+ */
+#define PAGE_MAX_ITEM_SIZE (PAGE_SIZE - sizeof(page_header_t) - sizeof(page_slot_t))
+
+/**
+ * Initialize an empty page
+ *
+ * @param page Page buffer of PAGE_SIZE bytes
+ * @param page_id Page number
+ * @param type Page type
+ * @param special_size Bytes reserved at the end of the page for the access method
+ */
+void page_init(void* page, page_id_t page_id, page_type_t type, uint16_t special_size);
+
+/**
+ * Check whether a page has never been initialized (all zeroes)
+ *
+ * @param page Page buffer
+ * @return true if the page is new
+ */
+bool page_is_new(const void* page);
+
+/**
+ * Compute the checksum of a page, excluding the checksum field itself
+ *
+ * @param page Page buffer
+ * @return Page checksum
+ */
+uint32_t page_compute_checksum(const void* page);
+
+/**
+ * Store a fresh checksum in the page header
+ *
+ * @param page Page buffer
+ */
+void page_set_checksum(void* page);
+
+/**
+ * Validate a page read from disk
+ *
+ * @param page Page buffer
+ * @param page_id Page number the page was read from
+ * @return true if the page is new or its checksum and page number match
+ */
+bool page_verify(const void* page, page_id_t page_id);
+
+/**
+ * Get the number of line pointers on a slotted page
+ *
+ * @param page Page buffer
+ * @return Number of slots, including unused ones
+ */
+uint16_t page_num_slots(const void* page);
+
+/**
+ * Get the contiguous free space of a slotted page
+ *
+ * @param page Page buffer
+ * @return Bytes available for a new item, accounting for a new line pointer
+ */
+uint16_t page_free_space(const void* page);
+
+/**
+ * Add an item to a slotted page, reusing an unused line pointer if possible
+ *
+ * @param page Page buffer
+ * @param item Item data
+ * @param len Item length
+ * @return Slot number, or -1 if the item does not fit
+ */
+int page_add_item(void* page, const void* item, uint16_t len);
+
+/**
+ * Get the state of a line pointer
+ *
+ * @param page Page buffer
+ * @param slot Slot number
+ * @return Slot state; SLOT_UNUSED for out-of-range slots
+ */
+page_slot_state_t page_slot_state(const void* page, uint16_t slot);
+
+/**
+ * Get an item on a slotted page
+ *
+ * @param page Page buffer
+ * @param slot Slot number
+ * @param len If not NULL, the item length is stored here
+ * @return Pointer to the item, or NULL if the slot does not hold a live item
+ */
+void* page_get_item(void* page, uint16_t slot, uint16_t* len);
+
+/**
+ * Mark a line pointer dead so it no longer yields an item
+ *
+ * @param page Page buffer
+ * @param slot Slot number
+ */
+void page_set_slot_dead(void* page, uint16_t slot);
+
+/**
+ * Turn a line pointer into a redirect to another slot on the same page
+ *
+ * @param page Page buffer
+ * @param slot Slot to redirect
+ * @param target Slot the redirect points to
+ */
+void page_set_slot_redirect(void* page, uint16_t slot, uint16_t target);
+
+/**
+ * Get the target of a redirect line pointer
+ *
+ * @param page Page buffer
+ * @param slot Redirect slot
+ * @return Target slot number
+ */
+uint16_t page_get_redirect(const void* page, uint16_t slot);
+
+/**
+ * Mark a line pointer unused so page_add_item() can recycle it
+ *
+ * @param page Page buffer
+ * @param slot Slot number
+ */
+void page_set_slot_unused(void* page, uint16_t slot);
+
+/**
+ * Defragment item storage so all free space is contiguous. Slot numbers are
+ * preserved; storage of dead, unused and redirect slots is reclaimed.
+ *
+ * @param page Page buffer
+ */
+void page_compact(void* page);
+
+/**
+ * Insert an item at a given position of an ordered slotted page. Line
+ * pointers from the position onwards move up by one, so slot numbers are
+ * positions rather than stable addresses.
+ *
+ * @param page Page buffer
+ * @param slot Position, at most page_num_slots()
+ * @param item Item data
+ * @param len Item length
+ * @return true on success, false if the item does not fit in the contiguous free space
+ */
+bool page_insert_item_at(void* page, uint16_t slot, const void* item, uint16_t len);
+
+/**
+ * Remove the item at a given position of an ordered slotted page. Later
+ * line pointers move down by one; the item storage is reclaimed by the next
+ * page_compact().
+ *
+ * @param page Page buffer
+ * @param slot Position of the item
+ */
+void page_remove_item_at(void* page, uint16_t slot);
+
+/**
+ * Get the page header
+ */
+static inline page_header_t* page_header(void* page) { return (page_header_t*)page; }
+
+/**
+ * Get a pointer to the special space of a page
+ */
+static inline void* page_special(void* page) {
+    return (char*)page + ((page_header_t*)page)->special;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file sync_scan.h
+ * @brief Synchronized (cooperative) sequential scans.
+ *
+ * When several sequential scans of the same large table run at once, each
+ * would otherwise drive its own I/O stream over the whole file. The scan
+ * coordinator remembers, per file, the page most recently read by any
+ * scan. A new scan starts at that page instead of page zero, wraps around
+ * at the end of the file and stops where it began, so concurrent scans
+ * travel together and share the pages brought in by the leader.
+ */
+
+#pragma once
+
+#include <monodb/core/storage/page.h>
+#include <stdint.h>
+
+/**
+ * Number of pages a scan advances between location reports
+ */
+#define SYNC_SCAN_REPORT_INTERVAL 16
+
+/**
+ * Number of files whose scan position is remembered (LRU)
+ */
+#define SYNC_SCAN_MAX_FILES 32
+
+/**
+ * Get the page a new scan of a file should start at
+ *
+ * @param file_id Storage file identifier
+ * @param num_pages Number of pages the scan will cover
+ * @return Start page; 0 if no scan of the file is known
+ */
+page_id_t sync_scan_get_location(uint32_t file_id, uint32_t num_pages);
+
+/**
+ * Report the current position of a scan
+ *
+ * Callers report every page; only every SYNC_SCAN_REPORT_INTERVAL-th report
+ * touches the shared table.
+ *
+ * @param file_id Storage file identifier
+ * @param page_id Page the scan just read
+ */
+void sync_scan_report_location(uint32_t file_id, page_id_t page_id);
+
+/**
+ * Forget the scan position of a file, e.g. when it is dropped or truncated
+ *
+ * @param file_id Storage file identifier
+ */
+void sync_scan_forget(uint32_t file_id);
@@ -0,0 +1,245 @@
+/**
+ * @file tier.h
+ * @brief Immutable, compressed, columnar segment files for cold rows.
+ *
+ * Rows that are no longer updated can be moved out of the heap into a tier
+ * segment: a read-only file holding the rows in blocks of TIER_BLOCK_ROWS.
+ * Within a block every column is stored on its own. Integer columns are
+ * compressed with the codec (codec.h) a sample of the block's values
+ * favours: constant, run-length, delta or frame of reference. Byte columns
+ * are split into byte planes (byte 0 of every value, then byte 1, ...) and
+ * each plane run-length compressed, so padding and shared prefixes
+ * collapse to a few runs.
+ *
+ * The block directory at the end of the file records, per block and
+ * integer column, the smallest and largest value (a zone map). Scans with a
+ * range filter skip blocks whose zone map excludes the range without
+ * decoding them. In the other blocks the filter is evaluated on the
+ * compressed column first, and the block is decoded only if some row
+ * passes. Segments are memory-mapped on first access rather than read
+ * through the buffer pool, since they are never modified.
+ *
+ * Segments have no notion of row types beyond the fixed-width layout the
+ * writer is given; rows must all have the layout's size.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Rows per segment block
+ */
+#define TIER_BLOCK_ROWS 1024
+
+/**
+ * Maximum number of columns in a layout
+ */
+#define TIER_MAX_COLUMNS 32
+
+/**
+ * Column value types
+ */
+typedef enum {
+    TIER_COLUMN_BYTES = 0, /* Opaque bytes; no zone map */
+    TIER_COLUMN_UINT  = 1, /* Unsigned integer of 1, 2, 4 or 8 bytes, native byte order */
+    TIER_COLUMN_INT   = 2  /* Signed integer of 1, 2, 4 or 8 bytes, native byte order */
+} tier_column_type_t;
+
+/**
+ * Column of a fixed-width row
+ */
+typedef struct {
+    uint16_t offset; /* Byte offset within the row */
+    uint16_t size;   /* Width in bytes */
+    uint16_t type;   /* tier_column_type_t */
+} tier_column_t;
+
+/**
+ * Fixed-width row layout
+ */
+typedef struct {
+    uint16_t      row_size;                  /* Row length in bytes */
+    uint16_t      num_columns;               /* Number of columns */
+    tier_column_t columns[TIER_MAX_COLUMNS]; /* Columns; together they should cover the row */
+} tier_layout_t;
+
+/**
+ * Inclusive range filter on an integer column. Signed columns compare the
+ * bounds as int64_t.
+ */
+typedef struct {
+    uint16_t column; /* Column index within the layout */
+    uint64_t lo;     /* Smallest accepted value */
+    uint64_t hi;     /* Largest accepted value */
+} tier_filter_t;
+
+/**
+ * Segment statistics
+ */
+typedef struct {
+    uint64_t rows;           /* Rows stored */
+    uint32_t blocks;         /* Blocks stored */
+    uint64_t file_size;      /* Size of the segment file in bytes */
+    uint64_t raw_size;       /* Uncompressed size of the rows in bytes */
+    uint64_t blocks_read;    /* Blocks decoded by scans */
+    uint64_t blocks_skipped; /* Blocks skipped by zone maps or the compressed filter column */
+} tier_segment_stats_t;
+
+/**
+ * Segment writer context
+ */
+typedef struct tier_writer_t tier_writer_t;
+
+/**
+ * Read-only segment context
+ */
+typedef struct tier_segment_t tier_segment_t;
+
+/**
+ * Segment scan context
+ */
+typedef struct tier_scan_t tier_scan_t;
+
+/**
+ * Check that a layout is usable: columns lie within the row and integer
+ * columns have a supported width
+ *
+ * @param layout Layout to check
+ * @return true if the layout is valid
+ */
+bool tier_layout_valid(const tier_layout_t* layout);
+
+/**
+ * Check that a filter refers to an integer column of a layout
+ *
+ * @param layout Row layout
+ * @param filter Filter to check
+ * @return true if the filter is valid
+ */
+bool tier_filter_valid(const tier_layout_t* layout, const tier_filter_t* filter);
+
+/**
+ * Check whether a row passes a filter
+ *
+ * @param layout Row layout
+ * @param row Row bytes (layout->row_size long)
+ * @param filter Valid filter
+ * @return true if the filtered column lies within the range
+ */
+bool tier_row_matches(const tier_layout_t* layout, const void* row, const tier_filter_t* filter);
+
+/**
+ * Start writing a segment. The data goes to a temporary file that only
+ * takes the final name once tier_writer_finish() has made it durable.
+ *
+ * @param path Path of the segment file
+ * @param layout Row layout
+ * @return Writer or NULL on error
+ */
+tier_writer_t* tier_writer_create(const char* path, const tier_layout_t* layout);
+
+/**
+ * Append a row to a segment
+ *
+ * @param writer Writer
+ * @param row Row bytes (layout->row_size long)
+ * @return true on success, false on error
+ */
+bool tier_writer_append(tier_writer_t* writer, const void* row);
+
+/**
+ * Get the number of rows appended so far
+ */
+uint64_t tier_writer_rows(const tier_writer_t* writer);
+
+/**
+ * Write the block directory, sync the file and move it to its final name.
+ * The writer is freed in every case.
+ *
+ * @param writer Writer
+ * @return true on success, false on error (the partial file is removed)
+ */
+bool tier_writer_finish(tier_writer_t* writer);
+
+/**
+ * Discard a segment being written
+ *
+ * @param writer Writer, freed by this call
+ */
+void tier_writer_abort(tier_writer_t* writer);
+
+/**
+ * Open a segment. The file is mapped and validated on first access.
+ *
+ * @param path Path of the segment file
+ * @return Segment or NULL on error
+ */
+tier_segment_t* tier_segment_open(const char* path);
+
+/**
+ * Close a segment and unmap its file
+ *
+ * @param segment Segment to close
+ */
+void tier_segment_close(tier_segment_t* segment);
+
+/**
+ * Get the path of a segment
+ */
+const char* tier_segment_path(const tier_segment_t* segment);
+
+/**
+ * Get the row layout of a segment, mapping it if needed
+ *
+ * @param segment Segment
+ * @return Layout or NULL if the file cannot be mapped or is invalid
+ */
+const tier_layout_t* tier_segment_layout(tier_segment_t* segment);
+
+/**
+ * Get segment statistics, mapping the segment if needed
+ *
+ * @param segment Segment
+ * @param stats Output statistics
+ * @return true on success, false if the file cannot be mapped or is invalid
+ */
+bool tier_segment_get_stats(tier_segment_t* segment, tier_segment_stats_t* stats);
+
+/**
+ * Decode one integer column of one block into a vector
+ *
+ * @param segment Segment
+ * @param block Block index, below the block count in the segment's statistics
+ * @param column Integer column
+ * @param values Output, room for TIER_BLOCK_ROWS values; signed columns are sign-extended
+ * @return Rows decoded, 0 on error or for a byte column
+ */
+uint32_t tier_segment_read_column(tier_segment_t* segment, uint32_t block, uint16_t column,
+                                  uint64_t* values);
+
+/**
+ * Begin a scan over the rows of a segment, in the order they were written
+ *
+ * @param segment Segment
+ * @param filter Optional range filter (NULL for all rows)
+ * @return Scan context or NULL on error
+ */
+tier_scan_t* tier_scan_begin(tier_segment_t* segment, const tier_filter_t* filter);
+
+/**
+ * Return the next row of a scan that passes its filter
+ *
+ * @param scan Scan context
+ * @param row Output: pointer to the row, valid until the next call
+ * @return true if a row was returned, false at the end of the segment or on error
+ */
+bool tier_scan_next(tier_scan_t* scan, const void** row);
+
+/**
+ * End a segment scan
+ *
+ * @param scan Scan context
+ */
+void tier_scan_end(tier_scan_t* scan);
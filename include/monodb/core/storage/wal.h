@@ -23,7 +23,8 @@ typedef enum {
     WAL_RECORD_UPDATE = 5,     /* Row update */
     WAL_RECORD_DELETE = 6,     /* Row deletion */
     WAL_RECORD_NEWPAGE = 7,    /* New page allocation */
-    WAL_RECORD_SCHEMA = 8      /* Schema change */
+    WAL_RECORD_SCHEMA = 8,     /* Schema change */
+    WAL_RECORD_BTREE = 9       /* B+tree structure change (page images, xid 0) */
 } wal_record_type_t;
 
 /**
@@ -111,7 +112,7 @@ typedef bool (*record_handler_t)(void* db_instance,
  * Recovery handler structure for different record types
  */
 typedef struct {
-    record_handler_t handlers[WAL_RECORD_SCHEMA + 1];  /* Array of handlers indexed by record type */
+    record_handler_t handlers[WAL_RECORD_BTREE + 1];  /* Array of handlers indexed by record type */
 } wal_recovery_handlers_t;
 
 /**
@@ -155,6 +156,14 @@ void* wal_begin_record(wal_context_t* ctx, wal_record_type_t type, uint32_t xid,
  */
 bool wal_end_record(wal_context_t* ctx, wal_location_t* location);
 
+/**
+ * Get the location of the most recently written record
+ *
+ * @param ctx WAL context
+ * @return Location, {0,0} if nothing has been written yet
+ */
+wal_location_t wal_last_location(const wal_context_t* ctx);
+
 /**
  * Force all WAL records to stable storage
  *
@@ -0,0 +1,171 @@
+/**
+ * @file JsonIndex.hpp
+ * @brief Inverted index of path/value pairs over JSON documents (GIN-style)
+ *
+ * Every scalar of a document yields one key: the object keys on the path
+ * to it, a marker for each array crossed (positions are not kept), and
+ * the scalar's binary form. Every document also has the empty key. A key
+ * maps to a posting list, the sorted ids of the documents holding it,
+ * cut into blocks of kJsonPostingBlock ids compressed with the column
+ * codecs (codec.h; sorted ids usually pack as DELTA). The first and last
+ * id of every block are kept apart, so an intersection skips the blocks
+ * that cannot hold a candidate without decoding them. Lists of a few ids
+ * keep them raw, as a codec header would outweigh them.
+ *
+ * Inserts and removals go to a pending list first: per key, the ids
+ * added and removed since the last merge. Lookups read it together with
+ * the posting lists. Once it outgrows its limit, all its changes are
+ * merged at once, so a posting list is re-encoded once per merge instead
+ * of once per document.
+ *
+ * A containment query (JsonValue::contains()) intersects the lists of
+ * the keys of its scalars, smallest first. The candidates are exactly
+ * the matching documents when the query has a scalar, no empty object or
+ * array, and no array holding objects or arrays. Otherwise keys may have
+ * matched in different elements of an array, or the query says nothing
+ * the keys capture, and every candidate must be rechecked against its
+ * document. `path = value` looks up the single key of a scalar, exact
+ * when the path has no array index.
+ *
+ * Numbers are keyed by their binary form, so 1 and 1.0 are different
+ * values, as for JsonValue equality. The index is not thread-safe.
+ */
+
+#pragma once
+
+#include <monodb/cpp/types/JsonType.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace monodb {
+
+/**
+ * Document ids per compressed posting list block
+ */
+inline constexpr uint32_t kJsonPostingBlock = 128;
+
+/**
+ * Default size of the pending list before it is merged, in bytes
+ */
+inline constexpr size_t kJsonPendingLimit = 4u << 20;
+
+/**
+ * Index statistics
+ */
+struct JsonIndexStats {
+    size_t   keys;          /* Keys with a posting list */
+    size_t   postings;      /* Ids in posting lists */
+    size_t   posting_bytes; /* Compressed blocks and their bounds */
+    size_t   pending_ids;   /* Ids added or removed in the pending list */
+    size_t   pending_bytes; /* Estimated size of the pending list */
+    uint64_t merges;        /* Pending list merges so far */
+};
+
+/**
+ * Inverted index of the path/value pairs of JSON documents
+ */
+class JsonIndex {
+   public:
+    /**
+     * Create an empty index
+     *
+     * @param pending_limit Pending list size that triggers a merge, in bytes; 0 merges every change
+     */
+    explicit JsonIndex(size_t pending_limit = kJsonPendingLimit);
+
+    /**
+     * Index a document
+     *
+     * @param id Document id, such as a packed tuple id; not already indexed
+     * @param doc Document
+     */
+    void insert(uint64_t id, JsonValue doc);
+
+    /**
+     * Unindex a document; an update is a removal of the old version and an
+     * insert of the new one
+     *
+     * @param id Document id
+     * @param doc The document as it was indexed
+     */
+    void remove(uint64_t id, JsonValue doc);
+
+    /**
+     * Merge the pending list into the posting lists
+     */
+    void flush();
+
+    /**
+     * Find the documents that may contain a value
+     *
+     * @param query Value to look for
+     * @param ids Output: candidate ids, ascending
+     * @return true if every candidate contains the query, false if they must be rechecked
+     */
+    bool findContaining(JsonValue query, std::vector<uint64_t>& ids) const;
+
+    /**
+     * Find the documents whose value at a path may equal a value
+     *
+     * @param path Path from the document root
+     * @param value Value
+     * @param ids Output: candidate ids, ascending
+     * @return true if every candidate matches, false if they must be rechecked
+     */
+    bool findEqual(const JsonPath& path, JsonValue value, std::vector<uint64_t>& ids) const;
+
+    JsonIndexStats stats() const;
+
+   private:
+    struct Block {
+        uint64_t first;  /* Smallest id */
+        uint64_t last;   /* Largest id */
+        uint32_t offset; /* Codec stream in PostingList::data */
+        uint32_t count;  /* Ids */
+    };
+
+    struct PostingList {
+        std::vector<Block>   blocks;
+        std::vector<uint8_t> data;
+        size_t               count = 0;
+    };
+
+    struct Op {
+        uint64_t id;
+        bool     add; /* Insert, or removal */
+    };
+
+    /* Changes to one key's posting list, latest last */
+    struct Pending {
+        std::vector<Op> ops;
+        bool            sorted = true; /* Whether ops are ascending, one per id */
+    };
+
+    struct Term;
+    class Cursor;
+
+    static void append(PostingList& list, const uint64_t* ids, size_t n);
+    static void decode(const PostingList& list, std::vector<uint64_t>& ids);
+    static void normalize(Pending& pending);
+    static void merge(const std::vector<uint64_t>& ids, const Pending& pending,
+                      std::vector<uint64_t>& out);
+    static void collectKeys(JsonValue value, std::string& path, std::vector<std::string>& keys,
+                            bool* exact);
+    static void filter(const Term& term, std::vector<uint64_t>& ids);
+
+    void change(uint64_t id, JsonValue doc, bool add);
+    void lookup(std::vector<std::string>& keys, std::vector<uint64_t>& ids) const;
+
+    std::unordered_map<std::string, PostingList>     lists_;
+    mutable std::unordered_map<std::string, Pending> pending_; /* Normalized by lookups */
+    size_t                                           pending_limit_;
+    size_t                                           pending_ids_   = 0;
+    size_t                                           pending_bytes_ = 0;
+    uint64_t                                         merges_        = 0;
+};
+
+}  // namespace monodb
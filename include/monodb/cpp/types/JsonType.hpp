@@ -0,0 +1,317 @@
+/**
+ * @file JsonType.hpp
+ * @brief JSON documents in a binary format with indexed key lookup
+ *
+ * A document is parsed once into a tree of values read in place, without
+ * parsing. Every value starts with a one-byte kind (JsonKind):
+ *
+ *   null, false, true   [kind]
+ *   integer, double     [kind][8-byte value]
+ *   string              [kind][u32 length][bytes]
+ *   array               [kind][u32 count][u32 size][u32 offset x count][elements]
+ *   object              [kind][u32 count][u32 size][entry x count][key bytes][values]
+ *
+ * An object entry is {u32 key offset, u32 key length, u32 value offset};
+ * offsets are relative to the start of the container, and entries are
+ * sorted by key length, then key bytes. Looking up a key is a binary
+ * search over the entries and an array element is one load, so a path
+ * costs a search per level. Duplicate keys keep the last value, so equal
+ * documents have equal bytes. Integers that fit 64 bits are stored as
+ * integers, other numbers as doubles. Numbers and lengths are stored
+ * unaligned, in native byte order.
+ *
+ * Text is parsed in two stages, after simdjson. Stage one classifies the
+ * input 64 bytes at a time with vector compares (AVX2 or SSE2 when built
+ * for them, scalar otherwise) into bit masks of quotes, backslashes,
+ * structural characters and whitespace. It then drops escaped quotes and
+ * everything inside strings with carry and prefix-XOR arithmetic, and
+ * lists the positions of structural characters, opening quotes and the
+ * first character of every number and literal. Stage two walks those
+ * positions only, checking the grammar and building the document.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace monodb {
+
+/**
+ * Kind of a JSON value, stored as the first byte of its binary form
+ */
+enum class JsonKind : uint8_t {
+    Null   = 0,
+    False  = 1,
+    True   = 2,
+    Int    = 3,
+    Double = 4,
+    String = 5,
+    Array  = 6,
+    Object = 7,
+};
+
+/**
+ * Deepest nesting of arrays and objects accepted by the parser
+ */
+inline constexpr uint32_t kJsonMaxDepth = 1024;
+
+namespace json_detail {
+
+/* Bytes before the entries of an array or object: kind, count, size */
+inline constexpr uint32_t kHeader = 9;
+
+/* Bytes of an object entry */
+inline constexpr uint32_t kEntry = 12;
+
+inline uint32_t load32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+}  // namespace json_detail
+
+class JsonPath;
+
+/**
+ * Read-only view of a value in a binary document, valid as long as the
+ * document. A default-constructed view is invalid and stands for a missing
+ * value; lookups on it return invalid views.
+ */
+class JsonValue {
+   public:
+    JsonValue() = default;
+    explicit JsonValue(const uint8_t* data) : data_(data) {}
+
+    bool     valid() const { return data_ != nullptr; }
+    explicit operator bool() const { return valid(); }
+    JsonKind kind() const { return static_cast<JsonKind>(data_[0]); }
+
+    bool isNull() const { return valid() && kind() == JsonKind::Null; }
+    bool isBool() const {
+        return valid() && (kind() == JsonKind::False || kind() == JsonKind::True);
+    }
+    bool isNumber() const {
+        return valid() && (kind() == JsonKind::Int || kind() == JsonKind::Double);
+    }
+    bool isString() const { return valid() && kind() == JsonKind::String; }
+    bool isArray() const { return valid() && kind() == JsonKind::Array; }
+    bool isObject() const { return valid() && kind() == JsonKind::Object; }
+
+    /**
+     * @return true for a true value, false otherwise
+     */
+    bool asBool() const { return valid() && kind() == JsonKind::True; }
+
+    /**
+     * @return The integer, a double truncated toward zero, or 0 for other kinds
+     */
+    int64_t asInt() const;
+
+    /**
+     * @return The number, or 0 for other kinds
+     */
+    double asDouble() const;
+
+    /**
+     * @return The unescaped string, or an empty view for other kinds
+     */
+    std::string_view asString() const {
+        if (!isString())
+            return {};
+        return {reinterpret_cast<const char*>(data_ + 5), json_detail::load32(data_ + 1)};
+    }
+
+    /**
+     * @return Number of elements or members, 0 for scalars
+     */
+    uint32_t size() const {
+        return isArray() || isObject() ? json_detail::load32(data_ + 1) : 0;
+    }
+
+    /**
+     * Array element
+     *
+     * @param index Element index
+     * @return The element, or an invalid view if out of range or not an array
+     */
+    JsonValue at(uint32_t index) const {
+        if (!isArray() || index >= json_detail::load32(data_ + 1))
+            return {};
+        return JsonValue(data_ + json_detail::load32(data_ + json_detail::kHeader + 4 * index));
+    }
+
+    /**
+     * Object member, by binary search over the sorted keys
+     *
+     * @param key Unescaped key
+     * @return The member's value, or an invalid view if absent or not an object
+     */
+    JsonValue find(std::string_view key) const {
+        using json_detail::load32;
+        if (!isObject())
+            return {};
+        uint32_t lo = 0, hi = load32(data_ + 1);
+        while (lo < hi) {
+            uint32_t       mid   = lo + (hi - lo) / 2;
+            const uint8_t* entry = data_ + json_detail::kHeader + json_detail::kEntry * mid;
+            uint32_t       len   = load32(entry + 4);
+            int            cmp   = len < key.size() ? -1 : len > key.size() ? 1 : 0;
+            if (cmp == 0 && len)
+                cmp = std::memcmp(data_ + load32(entry), key.data(), len);
+            if (cmp == 0)
+                return JsonValue(data_ + load32(entry + 8));
+            if (cmp < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return {};
+    }
+
+    /**
+     * Value at a path below this one
+     *
+     * @param path Compiled path
+     * @return The value, or an invalid view if a step does not match
+     */
+    JsonValue find(const JsonPath& path) const;
+
+    /**
+     * Key of an object member, in key order
+     *
+     * @param index Member index, below size()
+     * @return The key, or an empty view if out of range or not an object
+     */
+    std::string_view keyAt(uint32_t index) const;
+
+    /**
+     * Value of an object member in key order, or an array element
+     *
+     * @param index Member or element index, below size()
+     * @return The value, or an invalid view if out of range or a scalar
+     */
+    JsonValue valueAt(uint32_t index) const;
+
+    /**
+     * @return The binary form of this value, empty for an invalid view
+     */
+    std::span<const uint8_t> binary() const;
+
+    /**
+     * @return Compact JSON text of the value, "" for an invalid view
+     */
+    std::string toString() const;
+
+    /**
+     * Equality of the binary forms: keys are sorted and deduplicated, so
+     * this is JSON equality, except that an integer never equals a double
+     */
+    bool operator==(const JsonValue& other) const;
+
+    /**
+     * Containment, as jsonb @> in PostgreSQL: a scalar contains an equal
+     * scalar, an object contains an object whose every member it has with
+     * a contained value, and an array contains an array whose every element
+     * is contained in one of its own. Kinds must match.
+     *
+     * @param other Value to look for
+     * @return true if this value contains it, false otherwise or if either view is invalid
+     */
+    bool contains(const JsonValue& other) const;
+
+   private:
+    const uint8_t* data_ = nullptr;
+};
+
+/**
+ * Compiled path of object keys and array indexes
+ */
+class JsonPath {
+   public:
+    JsonPath() = default;
+
+    /**
+     * Compile a path such as $.a.b[2]["key with spaces"]; the leading $ is optional,
+     * as is the dot before the first key
+     *
+     * @param text Path text
+     * @return The path, or nothing if malformed
+     */
+    static std::optional<JsonPath> parse(std::string_view text);
+
+    /**
+     * Append an object key
+     */
+    JsonPath& key(std::string_view name);
+
+    /**
+     * Append an array index
+     */
+    JsonPath& index(uint32_t position);
+
+    size_t size() const { return steps_.size(); }
+    bool   empty() const { return steps_.empty(); }
+
+   private:
+    friend class JsonIndex;
+    friend class JsonValue;
+
+    struct Step {
+        std::string key;
+        uint32_t    index;
+        bool        is_index;
+    };
+
+    std::vector<Step> steps_;
+};
+
+/**
+ * A JSON document owning its binary form
+ */
+class JsonType {
+   public:
+    /**
+     * Create a null document
+     */
+    JsonType();
+
+    /**
+     * Parse JSON text (RFC 8259) into a document
+     *
+     * @param text Text, UTF-8
+     * @param error_offset Output: byte offset of the first error on failure (may be nullptr)
+     * @return The document, or nothing if the text is not valid JSON, nests deeper than
+     *         kJsonMaxDepth, or does not fit 32-bit offsets
+     */
+    static std::optional<JsonType> parse(std::string_view text, size_t* error_offset = nullptr);
+
+    /**
+     * Adopt a binary document, checking every length, offset and key order
+     *
+     * @param bytes Binary form, as returned by binary()
+     * @return The document, or nothing if malformed
+     */
+    static std::optional<JsonType> fromBinary(std::span<const uint8_t> bytes);
+
+    JsonValue                root() const { return JsonValue(bytes_.data()); }
+    std::span<const uint8_t> binary() const { return bytes_; }
+    std::string              toString() const { return root().toString(); }
+
+    bool operator==(const JsonType& other) const { return bytes_ == other.bytes_; }
+
+   private:
+    explicit JsonType(std::vector<uint8_t> bytes) : bytes_(std::move(bytes)) {}
+
+    std::vector<uint8_t> bytes_;
+};
+
+}  // namespace monodb
@@ -0,0 +1,845 @@
+/**
+ * @file schema.c
+ * @brief Implementation of the snapshot catalog
+ *
+ * A snapshot is an array of table entries in identifier order plus a hash
+ * table from names to positions. Table entries are immutable and shared
+ * by every snapshot that contains them, so DDL copies only the array of
+ * entry pointers and builds the one entry it changes; entries count their
+ * snapshots and are freed with the last one. All of this bookkeeping runs
+ * under the catalog mutex, which readers never take.
+ *
+ * Why reclamation is safe: a reader stores the epoch it read before it
+ * loads the snapshot pointer, and DDL swaps the pointer before it
+ * advances the epoch, all with sequentially consistent atomics. A reader
+ * whose slot shows a later epoch than a retired snapshot's therefore
+ * loaded the pointer after the swap, and a reader whose slot store the
+ * reclaimer does not yet see will load the pointer after the reclaimer's
+ * scan, so after the swap too.
+ *
+ * DDL is logged before its snapshot is published, so a statement that
+ * could not be logged has no effect.
+ */
+
+#include <monodb/core/catalog/schema.h>
+#include <monodb/core/common/sync.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Planner statistics, shared by the table entries that carry them. The
+ * column statistics, their values and sketches follow the structure in
+ * the same allocation.
+ */
+typedef struct {
+    uint32_t              refs; /* Entries holding them, changed under the catalog mutex */
+    catalog_table_stats_t stats;
+} stats_entry_t;
+
+/**
+ * Immutable table, shared by the snapshots that contain it. The columns
+ * and all names follow the structure in the same allocation.
+ */
+typedef struct {
+    uint32_t        refs;  /* Snapshots holding the entry; changed under the catalog mutex */
+    stats_entry_t*  stats; /* Planner statistics, or NULL */
+    catalog_table_t table;
+} table_entry_t;
+
+/* Operations of a WAL_RECORD_SCHEMA record */
+typedef enum {
+    SCHEMA_OP_CREATE     = 1,
+    SCHEMA_OP_DROP       = 2,
+    SCHEMA_OP_RENAME     = 3,
+    SCHEMA_OP_ADD_COLUMN = 4
+} schema_op_t;
+
+/* Flags of a logged column */
+#define COLUMN_NULLABLE    0x01
+#define COLUMN_HAS_DEFAULT 0x02
+
+/**
+ * Header of a WAL_RECORD_SCHEMA payload. It is followed by a table name
+ * with its terminator (the name created, the new name of a rename, the
+ * current name otherwise) and count columns, each
+ * [u8 type][u8 flags][u16 default length][name, terminated][default].
+ */
+typedef struct {
+    uint8_t  op;       /* schema_op_t */
+    uint8_t  reserved; /* 0 */
+    uint16_t count;    /* Columns that follow: all of a new table, or the one added */
+    uint32_t table;    /* Table identifier */
+} schema_wal_header_t;
+
+struct catalog_snapshot_t {
+    uint64_t            version;
+    uint32_t            num_tables;
+    table_entry_t**     entries; /* In identifier order */
+    uint32_t*           names;   /* Hash slots: position + 1 of the table, 0 if empty */
+    uint32_t            mask;    /* Slots - 1 */
+    uint64_t            retired; /* Epoch at which the snapshot was replaced */
+    catalog_snapshot_t* next;    /* Next retired snapshot */
+};
+
+/**
+ * Reader slot. Padded so that slots written by different threads do not
+ * share a cache line.
+ */
+struct catalog_reader_t {
+    _Atomic uint64_t epoch; /* Epoch at entry, 0 while outside the catalog */
+    catalog_t*       catalog;
+    uint32_t         index; /* Position in the catalog's reader array */
+    uint8_t          padding[128 - sizeof(uint64_t) - sizeof(void*) - sizeof(uint32_t)];
+};
+
+struct catalog_t {
+    _Atomic(catalog_snapshot_t*) current;
+    _Atomic uint64_t             epoch; /* From 1, so 0 marks a reader outside */
+    sync_mutex_t                 lock;  /* Serializes DDL, reclamation and reader registration */
+    uint32_t                     next_id;
+    wal_context_t*               wal; /* Log for DDL, NULL if not logged */
+    catalog_reader_t**           readers;
+    uint32_t                     num_readers;
+    uint32_t                     cap_readers;
+    catalog_snapshot_t*          retired; /* Replaced snapshots, newest first */
+    uint32_t                     num_retired;
+    uint64_t                     reclaimed;
+};
+
+/* 32-bit FNV-1a */
+static uint32_t name_hash(const char* name) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++)
+        h = (h ^ *p) * 16777619u;
+    return h;
+}
+
+static bool name_valid(const char* name) {
+    return name && name[0] && strlen(name) <= CATALOG_NAME_MAX;
+}
+
+/* Check a column's name, type and default */
+static bool column_valid(const catalog_column_t* column) {
+    if (!name_valid(column->name) || !type_is_valid(column->type))
+        return false;
+    return !column->default_data || type_is_variable(column->type) ||
+           column->default_len == type_fixed_size(column->type);
+}
+
+/* Check the columns of a new table */
+static bool columns_valid(const catalog_column_t* columns, uint16_t num_columns) {
+    if (num_columns == 0 || num_columns > CATALOG_MAX_COLUMNS)
+        return false;
+    for (uint16_t i = 0; i < num_columns; i++) {
+        if (!column_valid(&columns[i]))
+            return false;
+        for (uint16_t j = 0; j < i; j++) {
+            if (strcmp(columns[i].name, columns[j].name) == 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+/* Build a table entry; names and defaults are copied and ordinals assigned */
+static table_entry_t* entry_create(uint32_t id, const char* name, uint32_t version,
+                                   const catalog_column_t* columns, uint16_t num_columns) {
+    size_t size = sizeof(table_entry_t) + num_columns * sizeof(catalog_column_t) +
+                  strlen(name) + 1;
+    for (uint16_t i = 0; i < num_columns; i++)
+        size += strlen(columns[i].name) + 1 +
+                (columns[i].default_data ? columns[i].default_len : 0);
+
+    table_entry_t* entry = (table_entry_t*)malloc(size);
+    if (!entry)
+        return NULL;
+
+    catalog_column_t* copy   = (catalog_column_t*)(entry + 1);
+    char*             bytes  = (char*)(copy + num_columns);
+    entry->refs              = 0;
+    entry->stats             = NULL;
+    entry->table.stats       = NULL;
+    entry->table.id          = id;
+    entry->table.version     = version;
+    entry->table.num_columns = num_columns;
+    entry->table.columns     = copy;
+    entry->table.name        = bytes;
+    strcpy(bytes, name);
+    bytes += strlen(name) + 1;
+    for (uint16_t i = 0; i < num_columns; i++) {
+        copy[i]         = columns[i];
+        copy[i].ordinal = i;
+        copy[i].name    = bytes;
+        strcpy(bytes, columns[i].name);
+        bytes += strlen(columns[i].name) + 1;
+        if (columns[i].default_data) {
+            memcpy(bytes, columns[i].default_data, columns[i].default_len);
+            copy[i].default_data = bytes;
+            bytes += columns[i].default_len;
+        }
+    }
+    return entry;
+}
+
+/* Attach statistics to a new entry */
+static void entry_set_stats(table_entry_t* entry, stats_entry_t* stats) {
+    entry->stats       = stats;
+    entry->table.stats = stats ? &stats->stats : NULL;
+    if (stats)
+        stats->refs++;
+}
+
+static void entry_free(table_entry_t* entry) {
+    if (entry && entry->stats && --entry->stats->refs == 0)
+        free(entry->stats);
+    free(entry);
+}
+
+/* Copy a list of values, their bytes going to *bytes */
+static const catalog_value_t* values_copy(catalog_value_t* out, const catalog_value_t* values,
+                                          uint16_t count, uint8_t** bytes) {
+    for (uint16_t i = 0; i < count; i++) {
+        out[i].len  = values[i].len;
+        out[i].data = *bytes;
+        if (values[i].len)
+            memcpy(*bytes, values[i].data, values[i].len);
+        *bytes += values[i].len;
+    }
+    return out;
+}
+
+/* Copy planner statistics into one allocation */
+static stats_entry_t* stats_copy(const catalog_table_stats_t* stats) {
+    size_t fixed = sizeof(stats_entry_t) + stats->num_columns * sizeof(catalog_column_stats_t);
+    size_t bytes = 0;
+    for (uint16_t c = 0; c < stats->num_columns; c++) {
+        const catalog_column_stats_t* column = &stats->columns[c];
+        fixed += (column->num_mcvs + column->num_bounds) * sizeof(catalog_value_t) +
+                 column->num_mcvs * sizeof(double);
+        bytes += column->hll_size;
+        for (uint16_t i = 0; i < column->num_mcvs; i++)
+            bytes += column->mcvs[i].len;
+        for (uint16_t i = 0; i < column->num_bounds; i++)
+            bytes += column->bounds[i].len;
+    }
+
+    stats_entry_t* entry = (stats_entry_t*)malloc(fixed + bytes);
+    if (!entry)
+        return NULL;
+
+    /* Column statistics, then value lists and frequencies, then bytes */
+    catalog_column_stats_t* columns = (catalog_column_stats_t*)(entry + 1);
+    catalog_value_t*        values  = (catalog_value_t*)(columns + stats->num_columns);
+    uint8_t*                out     = (uint8_t*)entry + fixed;
+    entry->refs                     = 0;
+    entry->stats                    = *stats;
+    entry->stats.columns            = columns;
+    for (uint16_t c = 0; c < stats->num_columns; c++) {
+        const catalog_column_stats_t* column = &stats->columns[c];
+        columns[c]                           = *column;
+        columns[c].mcvs = values_copy(values, column->mcvs, column->num_mcvs, &out);
+        values += column->num_mcvs;
+        columns[c].bounds = values_copy(values, column->bounds, column->num_bounds, &out);
+        values += column->num_bounds;
+    }
+    double* freqs = (double*)values;
+    for (uint16_t c = 0; c < stats->num_columns; c++) {
+        const catalog_column_stats_t* column = &stats->columns[c];
+        if (column->num_mcvs)
+            memcpy(freqs, column->mcv_freqs, column->num_mcvs * sizeof(double));
+        columns[c].mcv_freqs = freqs;
+        freqs += column->num_mcvs;
+        if (column->hll_size)
+            memcpy(out, column->hll, column->hll_size);
+        columns[c].hll = out;
+        out += column->hll_size;
+    }
+    return entry;
+}
+
+/* Build a snapshot over entries, taking a reference on each */
+static catalog_snapshot_t* snapshot_create(uint64_t version, table_entry_t* const* entries,
+                                           uint32_t num_tables) {
+    uint32_t slots = 4;
+    while (slots < 2 * num_tables)
+        slots <<= 1;
+
+    catalog_snapshot_t* snapshot = (catalog_snapshot_t*)calloc(1, sizeof(catalog_snapshot_t));
+    if (!snapshot)
+        return NULL;
+    snapshot->entries = (table_entry_t**)malloc((num_tables ? num_tables : 1) *
+                                                sizeof(table_entry_t*));
+    snapshot->names   = (uint32_t*)calloc(slots, sizeof(uint32_t));
+    if (!snapshot->entries || !snapshot->names) {
+        free(snapshot->entries);
+        free(snapshot->names);
+        free(snapshot);
+        return NULL;
+    }
+
+    snapshot->version    = version;
+    snapshot->num_tables = num_tables;
+    snapshot->mask       = slots - 1;
+    for (uint32_t i = 0; i < num_tables; i++) {
+        snapshot->entries[i] = entries[i];
+        entries[i]->refs++;
+        uint32_t s = name_hash(entries[i]->table.name) & snapshot->mask;
+        while (snapshot->names[s])
+            s = (s + 1) & snapshot->mask;
+        snapshot->names[s] = i + 1;
+    }
+    return snapshot;
+}
+
+static void snapshot_free(catalog_snapshot_t* snapshot) {
+    for (uint32_t i = 0; i < snapshot->num_tables; i++) {
+        if (--snapshot->entries[i]->refs == 0)
+            entry_free(snapshot->entries[i]);
+    }
+    free(snapshot->entries);
+    free(snapshot->names);
+    free(snapshot);
+}
+
+/* Free the retired snapshots no reader can hold; the catalog mutex is held */
+static uint32_t reclaim_locked(catalog_t* catalog) {
+    uint64_t oldest = UINT64_MAX;
+    for (uint32_t i = 0; i < catalog->num_readers; i++) {
+        uint64_t e = atomic_load(&catalog->readers[i]->epoch);
+        if (e != 0 && e < oldest)
+            oldest = e;
+    }
+
+    uint32_t             freed = 0;
+    catalog_snapshot_t** link  = &catalog->retired;
+    while (*link) {
+        catalog_snapshot_t* snapshot = *link;
+        if (snapshot->retired < oldest) {
+            *link = snapshot->next;
+            snapshot_free(snapshot);
+            freed++;
+        } else {
+            link = &snapshot->next;
+        }
+    }
+    catalog->num_retired -= freed;
+    catalog->reclaimed += freed;
+    return freed;
+}
+
+/* Make a snapshot current and retire the one it replaces; the catalog mutex is held */
+static void publish_locked(catalog_t* catalog, catalog_snapshot_t* snapshot) {
+    catalog_snapshot_t* old = atomic_load(&catalog->current);
+    atomic_store(&catalog->current, snapshot);
+    old->retired     = atomic_load(&catalog->epoch);
+    old->next        = catalog->retired;
+    catalog->retired = old;
+    catalog->num_retired++;
+    atomic_fetch_add(&catalog->epoch, 1);
+    reclaim_locked(catalog);
+}
+
+/*
+ * Build the next snapshot: the current one with the entry at position
+ * index replaced (NULL removes it) or, with index == num_tables, with
+ * entry appended. The catalog mutex is held; on failure the entry is
+ * freed and NULL returned.
+ */
+static catalog_snapshot_t* build_locked(catalog_t* catalog, uint32_t index, table_entry_t* entry) {
+    const catalog_snapshot_t* current = atomic_load(&catalog->current);
+    uint32_t                  n       = current->num_tables;
+    table_entry_t**           entries =
+        (table_entry_t**)malloc((n + 1) * sizeof(table_entry_t*));
+    if (!entries) {
+        entry_free(entry);
+        return NULL;
+    }
+
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (i != index)
+            entries[m++] = current->entries[i];
+        else if (entry)
+            entries[m++] = entry;
+    }
+    if (index == n)
+        entries[m++] = entry;
+
+    catalog_snapshot_t* snapshot = snapshot_create(current->version + 1, entries, m);
+    free(entries);
+    if (!snapshot)
+        entry_free(entry);
+    return snapshot;
+}
+
+/* Build and publish the next snapshot, as build_locked() builds it */
+static bool replace_locked(catalog_t* catalog, uint32_t index, table_entry_t* entry) {
+    catalog_snapshot_t* snapshot = build_locked(catalog, index, entry);
+    if (!snapshot)
+        return false;
+    publish_locked(catalog, snapshot);
+    return true;
+}
+
+/* Position of a table in a snapshot, or num_tables */
+static uint32_t find_index(const catalog_snapshot_t* snapshot, const char* name) {
+    for (uint32_t s = name_hash(name) & snapshot->mask; snapshot->names[s];
+         s = (s + 1) & snapshot->mask) {
+        uint32_t i = snapshot->names[s] - 1;
+        if (strcmp(snapshot->entries[i]->table.name, name) == 0)
+            return i;
+    }
+    return snapshot->num_tables;
+}
+
+/* Position of a table in a snapshot by identifier, or num_tables */
+static uint32_t find_id(const catalog_snapshot_t* snapshot, uint32_t id) {
+    uint32_t lo = 0, hi = snapshot->num_tables;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t at  = snapshot->entries[mid]->table.id;
+        if (at == id)
+            return mid;
+        if (at < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return snapshot->num_tables;
+}
+
+/* Log a DDL statement if the catalog has a WAL; the catalog mutex is held */
+static bool log_locked(catalog_t* catalog, schema_op_t op, uint32_t table, const char* name,
+                       const catalog_column_t* columns, uint16_t count) {
+    if (!catalog->wal)
+        return true;
+
+    size_t size = sizeof(schema_wal_header_t) + strlen(name) + 1;
+    for (uint16_t i = 0; i < count; i++)
+        size += 4 + strlen(columns[i].name) + 1 +
+                (columns[i].default_data ? columns[i].default_len : 0);
+    if (size > UINT16_MAX)
+        return false;
+
+    uint8_t* data =
+        (uint8_t*)wal_begin_record(catalog->wal, WAL_RECORD_SCHEMA, 0, (uint16_t)size);
+    if (!data)
+        return false;
+
+    schema_wal_header_t header = {(uint8_t)op, 0, count, table};
+    memcpy(data, &header, sizeof(header));
+    data += sizeof(header);
+    strcpy((char*)data, name);
+    data += strlen(name) + 1;
+    for (uint16_t i = 0; i < count; i++) {
+        const catalog_column_t* column = &columns[i];
+        uint16_t                len    = column->default_data ? column->default_len : 0;
+        data[0]                        = (uint8_t)column->type;
+        data[1] = (uint8_t)((column->nullable ? COLUMN_NULLABLE : 0) |
+                            (column->default_data ? COLUMN_HAS_DEFAULT : 0));
+        memcpy(data + 2, &len, sizeof(len));
+        strcpy((char*)data + 4, column->name);
+        data += 4 + strlen(column->name) + 1;
+        if (len)
+            memcpy(data, column->default_data, len);
+        data += len;
+    }
+    return wal_end_record(catalog->wal, NULL);
+}
+
+/*
+ * Log a DDL statement and publish the snapshot built for it (NULL if that
+ * failed). Publishing cannot fail, so the log never holds a statement the
+ * catalog did not apply; on failure the snapshot is freed.
+ */
+static bool commit_locked(catalog_t* catalog, catalog_snapshot_t* snapshot, schema_op_t op,
+                          uint32_t table, const char* name, const catalog_column_t* columns,
+                          uint16_t count) {
+    if (!snapshot)
+        return false;
+    if (!log_locked(catalog, op, table, name, columns, count)) {
+        snapshot_free(snapshot);
+        return false;
+    }
+    publish_locked(catalog, snapshot);
+    return true;
+}
+
+/*
+ * The DDL statements, on validated arguments with the catalog mutex held:
+ * each builds the changed table and the next snapshot, then logs the
+ * statement and publishes the snapshot.
+ */
+
+static bool create_locked(catalog_t* catalog, uint32_t id, const char* name,
+                          const catalog_column_t* columns, uint16_t num_columns) {
+    const catalog_snapshot_t* current = atomic_load(&catalog->current);
+    if (id < catalog->next_id || find_index(current, name) < current->num_tables)
+        return false;
+
+    table_entry_t*      entry    = entry_create(id, name, 1, columns, num_columns);
+    catalog_snapshot_t* snapshot = entry ? build_locked(catalog, current->num_tables, entry)
+                                         : NULL;
+    if (!commit_locked(catalog, snapshot, SCHEMA_OP_CREATE, id, name, columns, num_columns))
+        return false;
+    catalog->next_id = id + 1;
+    return true;
+}
+
+static bool drop_locked(catalog_t* catalog, uint32_t index) {
+    const catalog_table_t* table = &atomic_load(&catalog->current)->entries[index]->table;
+    return commit_locked(catalog, build_locked(catalog, index, NULL), SCHEMA_OP_DROP, table->id,
+                         table->name, NULL, 0);
+}
+
+static bool rename_locked(catalog_t* catalog, uint32_t index, const char* new_name) {
+    const catalog_snapshot_t* current = atomic_load(&catalog->current);
+    const catalog_table_t*    table   = &current->entries[index]->table;
+    if (find_index(current, new_name) < current->num_tables)
+        return false;
+
+    table_entry_t* entry =
+        entry_create(table->id, new_name, table->version + 1, table->columns, table->num_columns);
+    if (!entry)
+        return false;
+    entry_set_stats(entry, current->entries[index]->stats);
+    return commit_locked(catalog, build_locked(catalog, index, entry), SCHEMA_OP_RENAME, table->id,
+                         new_name, NULL, 0);
+}
+
+static bool add_column_locked(catalog_t* catalog, uint32_t index, const catalog_column_t* column) {
+    table_entry_t*         old   = atomic_load(&catalog->current)->entries[index];
+    const catalog_table_t* table = &old->table;
+    if (table->num_columns >= CATALOG_MAX_COLUMNS || catalog_find_column(table, column->name))
+        return false;
+
+    catalog_column_t* columns =
+        (catalog_column_t*)malloc((table->num_columns + 1) * sizeof(catalog_column_t));
+    if (!columns)
+        return false;
+    memcpy(columns, table->columns, table->num_columns * sizeof(catalog_column_t));
+    columns[table->num_columns]       = *column;
+    columns[table->num_columns].since = table->version + 1;
+
+    table_entry_t* entry = entry_create(table->id, table->name, table->version + 1, columns,
+                                        (uint16_t)(table->num_columns + 1));
+    if (entry)
+        entry_set_stats(entry, old->stats);
+    catalog_snapshot_t* snapshot = entry ? build_locked(catalog, index, entry) : NULL;
+    bool                ok       = commit_locked(catalog, snapshot, SCHEMA_OP_ADD_COLUMN,
+                                                 table->id, table->name,
+                                                 &columns[table->num_columns], 1);
+    free(columns);
+    return ok;
+}
+
+catalog_t* catalog_create(void) {
+    catalog_t* catalog = (catalog_t*)calloc(1, sizeof(catalog_t));
+    if (!catalog)
+        return NULL;
+
+    catalog_snapshot_t* empty = snapshot_create(0, NULL, 0);
+    if (!empty) {
+        free(catalog);
+        return NULL;
+    }
+    atomic_init(&catalog->current, empty);
+    atomic_init(&catalog->epoch, 1);
+    sync_mutex_init(&catalog->lock);
+    catalog->next_id = 1;
+    return catalog;
+}
+
+void catalog_destroy(catalog_t* catalog) {
+    if (!catalog)
+        return;
+
+    while (catalog->retired) {
+        catalog_snapshot_t* next = catalog->retired->next;
+        snapshot_free(catalog->retired);
+        catalog->retired = next;
+    }
+    snapshot_free(atomic_load(&catalog->current));
+    for (uint32_t i = 0; i < catalog->num_readers; i++)
+        free(catalog->readers[i]);
+    free(catalog->readers);
+    sync_mutex_destroy(&catalog->lock);
+    free(catalog);
+}
+
+catalog_reader_t* catalog_reader_open(catalog_t* catalog) {
+    if (!catalog)
+        return NULL;
+
+    catalog_reader_t* reader = (catalog_reader_t*)calloc(1, sizeof(catalog_reader_t));
+    if (!reader)
+        return NULL;
+    atomic_init(&reader->epoch, 0);
+    reader->catalog = catalog;
+
+    sync_mutex_lock(&catalog->lock);
+    if (catalog->num_readers == catalog->cap_readers) {
+        uint32_t           cap     = catalog->cap_readers ? catalog->cap_readers * 2 : 16;
+        catalog_reader_t** readers = (catalog_reader_t**)realloc(
+            catalog->readers, cap * sizeof(catalog_reader_t*));
+        if (!readers) {
+            sync_mutex_unlock(&catalog->lock);
+            free(reader);
+            return NULL;
+        }
+        catalog->readers     = readers;
+        catalog->cap_readers = cap;
+    }
+    reader->index                          = catalog->num_readers;
+    catalog->readers[catalog->num_readers++] = reader;
+    sync_mutex_unlock(&catalog->lock);
+    return reader;
+}
+
+void catalog_reader_close(catalog_reader_t* reader) {
+    if (!reader)
+        return;
+
+    catalog_t* catalog = reader->catalog;
+    sync_mutex_lock(&catalog->lock);
+    catalog_reader_t* last          = catalog->readers[--catalog->num_readers];
+    catalog->readers[reader->index] = last;
+    last->index                     = reader->index;
+    sync_mutex_unlock(&catalog->lock);
+    free(reader);
+}
+
+const catalog_snapshot_t* catalog_enter(catalog_reader_t* reader) {
+    catalog_t* catalog = reader->catalog;
+    atomic_store(&reader->epoch, atomic_load(&catalog->epoch));
+    return atomic_load(&catalog->current);
+}
+
+void catalog_leave(catalog_reader_t* reader) {
+    atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+}
+
+uint64_t catalog_snapshot_version(const catalog_snapshot_t* snapshot) {
+    return snapshot->version;
+}
+
+uint32_t catalog_num_tables(const catalog_snapshot_t* snapshot) { return snapshot->num_tables; }
+
+const catalog_table_t* catalog_table_at(const catalog_snapshot_t* snapshot, uint32_t index) {
+    return index < snapshot->num_tables ? &snapshot->entries[index]->table : NULL;
+}
+
+const catalog_table_t* catalog_find_table(const catalog_snapshot_t* snapshot, const char* name) {
+    if (!name)
+        return NULL;
+    uint32_t i = find_index(snapshot, name);
+    return i < snapshot->num_tables ? &snapshot->entries[i]->table : NULL;
+}
+
+const catalog_table_t* catalog_get_table(const catalog_snapshot_t* snapshot, uint32_t id) {
+    uint32_t i = find_id(snapshot, id);
+    return i < snapshot->num_tables ? &snapshot->entries[i]->table : NULL;
+}
+
+const catalog_column_t* catalog_find_column(const catalog_table_t* table, const char* name) {
+    if (!table || !name)
+        return NULL;
+    for (uint16_t i = 0; i < table->num_columns; i++) {
+        if (table->columns[i].name[0] == name[0] && strcmp(table->columns[i].name, name) == 0)
+            return &table->columns[i];
+    }
+    return NULL;
+}
+
+bool catalog_create_table(catalog_t* catalog, const char* name,
+                          const catalog_column_def_t* columns, uint16_t num_columns,
+                          uint32_t* id) {
+    if (!catalog || !name_valid(name) || !columns || num_columns == 0 ||
+        num_columns > CATALOG_MAX_COLUMNS)
+        return false;
+
+    catalog_column_t* defs = (catalog_column_t*)calloc(num_columns, sizeof(catalog_column_t));
+    if (!defs)
+        return false;
+    for (uint16_t i = 0; i < num_columns; i++) {
+        defs[i].name     = columns[i].name;
+        defs[i].type     = columns[i].type;
+        defs[i].nullable = columns[i].nullable;
+        defs[i].since    = 1;
+    }
+
+    bool ok = false;
+    if (columns_valid(defs, num_columns)) {
+        sync_mutex_lock(&catalog->lock);
+        uint32_t next = catalog->next_id;
+        ok            = create_locked(catalog, next, name, defs, num_columns);
+        sync_mutex_unlock(&catalog->lock);
+        if (ok && id)
+            *id = next;
+    }
+    free(defs);
+    return ok;
+}
+
+bool catalog_drop_table(catalog_t* catalog, const char* name) {
+    if (!catalog || !name)
+        return false;
+
+    sync_mutex_lock(&catalog->lock);
+    const catalog_snapshot_t* current = atomic_load(&catalog->current);
+    uint32_t                  index   = find_index(current, name);
+    bool                      ok      = index < current->num_tables && drop_locked(catalog, index);
+    sync_mutex_unlock(&catalog->lock);
+    return ok;
+}
+
+bool catalog_rename_table(catalog_t* catalog, const char* name, const char* new_name) {
+    if (!catalog || !name || !name_valid(new_name))
+        return false;
+
+    sync_mutex_lock(&catalog->lock);
+    const catalog_snapshot_t* current = atomic_load(&catalog->current);
+    uint32_t                  index   = find_index(current, name);
+    bool ok = index < current->num_tables && rename_locked(catalog, index, new_name);
+    sync_mutex_unlock(&catalog->lock);
+    return ok;
+}
+
+bool catalog_add_column(catalog_t* catalog, const char* name, const catalog_column_def_t* column,
+                        const void* default_data, uint16_t default_len) {
+    if (!catalog || !name || !column)
+        return false;
+
+    catalog_column_t def = {column->name, column->type, column->nullable, 0, 0,
+                            default_data, default_len};
+    if (!column_valid(&def) || (!column->nullable && !default_data))
+        return false;
+
+    sync_mutex_lock(&catalog->lock);
+    const catalog_snapshot_t* current = atomic_load(&catalog->current);
+    uint32_t                  index   = find_index(current, name);
+    bool ok = index < current->num_tables && add_column_locked(catalog, index, &def);
+    sync_mutex_unlock(&catalog->lock);
+    return ok;
+}
+
+bool catalog_set_stats(catalog_t* catalog, const char* name, const catalog_table_stats_t* stats) {
+    if (!catalog || !name || !stats)
+        return false;
+
+    sync_mutex_lock(&catalog->lock);
+    const catalog_snapshot_t* current = atomic_load(&catalog->current);
+    uint32_t                  index   = find_index(current, name);
+    const catalog_table_t*    table   = index < current->num_tables
+                                            ? &current->entries[index]->table
+                                            : NULL;
+    bool           ok    = table && stats->num_columns <= table->num_columns;
+    table_entry_t* entry = ok ? entry_create(table->id, table->name, table->version,
+                                             table->columns, table->num_columns)
+                              : NULL;
+    stats_entry_t* copy  = entry ? stats_copy(stats) : NULL;
+    if (copy) {
+        entry_set_stats(entry, copy);
+        ok = replace_locked(catalog, index, entry);
+    } else {
+        entry_free(entry);
+        ok = false;
+    }
+    sync_mutex_unlock(&catalog->lock);
+    return ok;
+}
+
+void catalog_set_wal(catalog_t* catalog, wal_context_t* wal) {
+    sync_mutex_lock(&catalog->lock);
+    catalog->wal = wal;
+    sync_mutex_unlock(&catalog->lock);
+}
+
+bool catalog_redo(catalog_t* catalog, const wal_record_header_t* header, const void* data) {
+    if (header->type != WAL_RECORD_SCHEMA)
+        return true;
+
+    schema_wal_header_t h;
+    const uint8_t*      p   = (const uint8_t*)data;
+    const uint8_t*      end = p + header->data_len;
+    if (header->data_len < sizeof(h))
+        return false;
+    memcpy(&h, p, sizeof(h));
+    p += sizeof(h);
+
+    const uint8_t* nul = (const uint8_t*)memchr(p, 0, (size_t)(end - p));
+    if (!nul || h.count > CATALOG_MAX_COLUMNS)
+        return false;
+    const char* name = (const char*)p;
+    p                = nul + 1;
+
+    /* Columns point into the record; the entry built from them copies them */
+    catalog_column_t* columns =
+        (catalog_column_t*)calloc(h.count ? h.count : 1, sizeof(catalog_column_t));
+    bool ok = columns != NULL;
+    for (uint16_t i = 0; ok && i < h.count; i++) {
+        ok = end - p >= 4 && (nul = (const uint8_t*)memchr(p + 4, 0, (size_t)(end - p - 4)));
+        if (!ok)
+            break;
+        uint8_t  flags = p[1];
+        uint16_t len;
+        memcpy(&len, p + 2, sizeof(len));
+        columns[i].type     = (type_id_t)p[0];
+        columns[i].nullable = (flags & COLUMN_NULLABLE) != 0;
+        columns[i].since    = 1;
+        columns[i].name     = (const char*)p + 4;
+        p                   = nul + 1;
+        if (flags & COLUMN_HAS_DEFAULT) {
+            ok                      = end - p >= len;
+            columns[i].default_data = p;
+            columns[i].default_len  = len;
+            p += ok ? len : 0;
+        }
+    }
+    ok = ok && p == end;
+
+    sync_mutex_lock(&catalog->lock);
+    const catalog_snapshot_t* current = atomic_load(&catalog->current);
+    uint32_t                  index   = find_id(current, h.table);
+    bool                      found   = index < current->num_tables;
+    switch (ok ? h.op : 0) {
+    case SCHEMA_OP_CREATE:
+        ok = name_valid(name) && columns_valid(columns, h.count) &&
+             create_locked(catalog, h.table, name, columns, h.count);
+        break;
+    case SCHEMA_OP_DROP:
+        ok = found && drop_locked(catalog, index);
+        break;
+    case SCHEMA_OP_RENAME:
+        ok = found && name_valid(name) && rename_locked(catalog, index, name);
+        break;
+    case SCHEMA_OP_ADD_COLUMN:
+        ok = found && h.count == 1 && column_valid(columns) &&
+             add_column_locked(catalog, index, columns);
+        break;
+    default:
+        ok = false;
+        break;
+    }
+    sync_mutex_unlock(&catalog->lock);
+    free(columns);
+    return ok;
+}
+
+uint32_t catalog_reclaim(catalog_t* catalog) {
+    sync_mutex_lock(&catalog->lock);
+    uint32_t freed = reclaim_locked(catalog);
+    sync_mutex_unlock(&catalog->lock);
+    return freed;
+}
+
+void catalog_get_stats(catalog_t* catalog, catalog_stats_t* stats) {
+    sync_mutex_lock(&catalog->lock);
+    stats->version   = atomic_load(&catalog->current)->version;
+    stats->epoch     = atomic_load(&catalog->epoch);
+    stats->readers   = catalog->num_readers;
+    stats->retired   = catalog->num_retired;
+    stats->reclaimed = catalog->reclaimed;
+    sync_mutex_unlock(&catalog->lock);
+}
@@ -0,0 +1,305 @@
+/**
+ * @file type_system.c
+ * @brief Implementation of the column types and string dictionaries
+ *
+ * A dictionary keeps its values in an append-only arena of chunks and
+ * describes them in pages of entries allocated as codes are handed out,
+ * so neither ever moves. Values are found through an open-addressing
+ * table of codes sized for the capacity up front. A new value is copied
+ * and its entry filled before its slot and the count are published with
+ * release stores, which is what lets lookups and value reads run without
+ * the mutex.
+ */
+
+#include <monodb/core/catalog/type_system.h>
+#include <monodb/core/common/sync.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Stored size of each type, 0 for variable-length ones */
+static const uint16_t fixed_sizes[TYPE_COUNT] = {1, 4, 8, 8, 0, 0};
+
+static const char* const names[TYPE_COUNT] = {"BOOL", "INT32", "INT64", "FLOAT64", "TEXT",
+                                              "BYTES"};
+
+bool type_is_valid(type_id_t type) { return (unsigned)type < TYPE_COUNT; }
+
+uint16_t type_fixed_size(type_id_t type) { return type_is_valid(type) ? fixed_sizes[type] : 0; }
+
+bool type_is_variable(type_id_t type) { return type == TYPE_TEXT || type == TYPE_BYTES; }
+
+const char* type_name(type_id_t type) { return type_is_valid(type) ? names[type] : "UNKNOWN"; }
+
+int type_compare(type_id_t type, const void* a, uint16_t a_len, const void* b, uint16_t b_len) {
+    switch (type) {
+    case TYPE_BOOL:
+        return (*(const uint8_t*)a != 0) - (*(const uint8_t*)b != 0);
+    case TYPE_INT32: {
+        int32_t x, y;
+        memcpy(&x, a, sizeof(x));
+        memcpy(&y, b, sizeof(y));
+        return (x > y) - (x < y);
+    }
+    case TYPE_INT64: {
+        int64_t x, y;
+        memcpy(&x, a, sizeof(x));
+        memcpy(&y, b, sizeof(y));
+        return (x > y) - (x < y);
+    }
+    case TYPE_FLOAT64: {
+        double x, y;
+        memcpy(&x, a, sizeof(x));
+        memcpy(&y, b, sizeof(y));
+        return (x > y) - (x < y);
+    }
+    default: {
+        uint16_t n = a_len < b_len ? a_len : b_len;
+        int      c = n ? memcmp(a, b, n) : 0;
+        return c ? c : (a_len > b_len) - (a_len < b_len);
+    }
+    }
+}
+
+/* Entries per entry page */
+#define DICT_PAGE_ENTRIES 1024
+
+/* Smallest arena chunk */
+#define DICT_CHUNK_SIZE 16384
+
+typedef struct {
+    const uint8_t* data;
+    uint32_t       hash;
+    uint16_t       len;
+} dict_entry_t;
+
+typedef struct dict_chunk {
+    struct dict_chunk* next;
+    size_t             size;
+    size_t             used;
+    uint8_t            data[];
+} dict_chunk_t;
+
+struct type_dict_t {
+    sync_mutex_t      lock;      /* Serializes additions */
+    uint32_t          capacity;
+    uint32_t          mask;      /* Slots - 1 */
+    _Atomic uint32_t* slots;     /* Code + 1 of each slot, 0 if empty */
+    dict_entry_t**    pages;     /* Entry pages, allocated as codes are handed out */
+    dict_chunk_t*     chunks;    /* Value arena, newest first */
+    size_t            memory;
+    _Atomic uint32_t  count;
+};
+
+/* 64-bit FNV-1a folded to 32 bits */
+static uint32_t dict_hash(const void* data, uint16_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t       h = 0xCBF29CE484222325ull;
+    for (uint16_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001B3ull;
+    }
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static const dict_entry_t* dict_entry(const type_dict_t* dict, uint32_t code) {
+    return &dict->pages[code / DICT_PAGE_ENTRIES][code % DICT_PAGE_ENTRIES];
+}
+
+/* Slot holding the value, or the empty slot where it would go */
+static uint32_t dict_probe(const type_dict_t* dict, const void* data, uint16_t len, uint32_t hash,
+                           uint32_t* code) {
+    for (uint32_t i = hash & dict->mask;; i = (i + 1) & dict->mask) {
+        uint32_t slot = atomic_load_explicit(&dict->slots[i], memory_order_acquire);
+        if (slot == 0) {
+            *code = TYPE_DICT_NONE;
+            return i;
+        }
+        const dict_entry_t* e = dict_entry(dict, slot - 1);
+        if (e->hash == hash && e->len == len && memcmp(e->data, data, len) == 0) {
+            *code = slot - 1;
+            return i;
+        }
+    }
+}
+
+/* Copy a value into the arena */
+static const uint8_t* dict_store(type_dict_t* dict, const void* data, uint16_t len) {
+    dict_chunk_t* chunk = dict->chunks;
+    if (!chunk || chunk->size - chunk->used < len) {
+        size_t size = len > DICT_CHUNK_SIZE ? len : DICT_CHUNK_SIZE;
+        chunk       = (dict_chunk_t*)malloc(sizeof(dict_chunk_t) + size);
+        if (!chunk)
+            return NULL;
+        chunk->next  = dict->chunks;
+        chunk->size  = size;
+        chunk->used  = 0;
+        dict->chunks = chunk;
+        dict->memory += sizeof(dict_chunk_t) + size;
+    }
+    uint8_t* out = chunk->data + chunk->used;
+    if (len > 0)
+        memcpy(out, data, len);
+    chunk->used += len;
+    return out;
+}
+
+type_dict_t* type_dict_create(uint32_t max_codes) {
+    if (max_codes == 0 || max_codes > TYPE_DICT_MAX_CODES)
+        return NULL;
+
+    /* At most half full, so probes stay short */
+    uint32_t num_slots = 2;
+    while (num_slots < 2 * max_codes)
+        num_slots <<= 1;
+    uint32_t num_pages = (max_codes + DICT_PAGE_ENTRIES - 1) / DICT_PAGE_ENTRIES;
+
+    type_dict_t* dict = (type_dict_t*)calloc(1, sizeof(type_dict_t));
+    if (!dict)
+        return NULL;
+    dict->slots = (_Atomic uint32_t*)calloc(num_slots, sizeof(uint32_t));
+    dict->pages = (dict_entry_t**)calloc(num_pages, sizeof(dict_entry_t*));
+    if (!dict->slots || !dict->pages) {
+        free(dict->slots);
+        free(dict->pages);
+        free(dict);
+        return NULL;
+    }
+    sync_mutex_init(&dict->lock);
+    dict->capacity = max_codes;
+    dict->mask     = num_slots - 1;
+    dict->memory   = sizeof(type_dict_t) + num_slots * sizeof(uint32_t) +
+                   num_pages * sizeof(dict_entry_t*);
+    atomic_init(&dict->count, 0);
+    return dict;
+}
+
+void type_dict_destroy(type_dict_t* dict) {
+    if (!dict)
+        return;
+    for (uint32_t p = 0; p * DICT_PAGE_ENTRIES < dict->capacity; p++)
+        free(dict->pages[p]);
+    while (dict->chunks) {
+        dict_chunk_t* next = dict->chunks->next;
+        free(dict->chunks);
+        dict->chunks = next;
+    }
+    sync_mutex_destroy(&dict->lock);
+    free((void*)dict->slots);
+    free(dict->pages);
+    free(dict);
+}
+
+uint32_t type_dict_find(const type_dict_t* dict, const void* data, uint16_t len) {
+    uint32_t code;
+    dict_probe(dict, data, len, dict_hash(data, len), &code);
+    return code;
+}
+
+uint32_t type_dict_encode(type_dict_t* dict, const void* data, uint16_t len) {
+    uint32_t hash = dict_hash(data, len);
+    uint32_t code;
+    dict_probe(dict, data, len, hash, &code);
+    if (code != TYPE_DICT_NONE ||
+        atomic_load_explicit(&dict->count, memory_order_acquire) >= dict->capacity)
+        return code;
+
+    sync_mutex_lock(&dict->lock);
+
+    /* Probe again: another thread may have added the value meanwhile */
+    uint32_t slot  = dict_probe(dict, data, len, hash, &code);
+    uint32_t count = atomic_load_explicit(&dict->count, memory_order_relaxed);
+    if (code == TYPE_DICT_NONE && count < dict->capacity) {
+        dict_entry_t** page = &dict->pages[count / DICT_PAGE_ENTRIES];
+        if (!*page) {
+            *page = (dict_entry_t*)malloc(DICT_PAGE_ENTRIES * sizeof(dict_entry_t));
+            if (*page)
+                dict->memory += DICT_PAGE_ENTRIES * sizeof(dict_entry_t);
+        }
+        const uint8_t* copy = *page ? dict_store(dict, data, len) : NULL;
+        if (copy) {
+            dict_entry_t* e = &(*page)[count % DICT_PAGE_ENTRIES];
+            e->data         = copy;
+            e->hash         = hash;
+            e->len          = len;
+            code            = count;
+            atomic_store_explicit(&dict->slots[slot], code + 1, memory_order_release);
+            atomic_store_explicit(&dict->count, count + 1, memory_order_release);
+        }
+    }
+
+    sync_mutex_unlock(&dict->lock);
+    return code;
+}
+
+const void* type_dict_value(const type_dict_t* dict, uint32_t code, uint16_t* len) {
+    if (code >= atomic_load_explicit(&dict->count, memory_order_acquire))
+        return NULL;
+    const dict_entry_t* e = dict_entry(dict, code);
+    *len                  = e->len;
+    return e->data;
+}
+
+uint32_t type_dict_count(const type_dict_t* dict) {
+    return atomic_load_explicit(&dict->count, memory_order_acquire);
+}
+
+uint32_t type_dict_capacity(const type_dict_t* dict) { return dict->capacity; }
+
+size_t type_dict_memory(const type_dict_t* dict) {
+    sync_mutex_lock((sync_mutex_t*)&dict->lock);
+    size_t memory = dict->memory;
+    sync_mutex_unlock((sync_mutex_t*)&dict->lock);
+    return memory;
+}
+
+size_t type_dict_serialize(const type_dict_t* dict, void* buf, size_t size) {
+    uint32_t count  = type_dict_count(dict);
+    size_t   needed = sizeof(uint32_t);
+    for (uint32_t c = 0; c < count; c++)
+        needed += sizeof(uint16_t) + dict_entry(dict, c)->len;
+    if (!buf || needed > size)
+        return needed;
+
+    uint8_t* out = (uint8_t*)buf;
+    memcpy(out, &count, sizeof(count));
+    out += sizeof(count);
+    for (uint32_t c = 0; c < count; c++) {
+        const dict_entry_t* e = dict_entry(dict, c);
+        memcpy(out, &e->len, sizeof(e->len));
+        memcpy(out + sizeof(e->len), e->data, e->len);
+        out += sizeof(e->len) + e->len;
+    }
+    return needed;
+}
+
+type_dict_t* type_dict_deserialize(const void* buf, size_t len, uint32_t max_codes) {
+    const uint8_t* in = (const uint8_t*)buf;
+    uint32_t       count;
+    if (!buf || len < sizeof(count))
+        return NULL;
+    memcpy(&count, in, sizeof(count));
+    if (count > max_codes)
+        return NULL;
+
+    type_dict_t* dict = type_dict_create(max_codes);
+    if (!dict)
+        return NULL;
+    size_t pos = sizeof(count);
+    for (uint32_t c = 0; c < count; c++) {
+        uint16_t vlen;
+        if (len - pos < sizeof(vlen))
+            break;
+        memcpy(&vlen, in + pos, sizeof(vlen));
+        pos += sizeof(vlen);
+        /* Values are distinct, so each gets the next code */
+        if (len - pos < vlen || type_dict_encode(dict, in + pos, vlen) != c)
+            break;
+        pos += vlen;
+    }
+    if (type_dict_count(dict) != count || pos != len) {
+        type_dict_destroy(dict);
+        return NULL;
+    }
+    return dict;
+}
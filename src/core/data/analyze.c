@@ -0,0 +1,761 @@
+/**
+ * @file analyze.c
+ * @brief Implementation of ANALYZE
+ *
+ * Sampling runs in two stages. Stage one picks the pages with selection
+ * sampling (Knuth's Algorithm S), which yields them in ascending order, so
+ * stage two reads the file forward through a bulk-read ring. Stage two
+ * visits every live row of those pages: each row feeds the row count and
+ * the HyperLogLog sketch of every column, and a reservoir keeps copies of
+ * sample_rows of them. Once the reservoir is full, Li's Algorithm L draws
+ * how many rows to skip before the next one that replaces a random slot,
+ * so the rows in between cost no random numbers.
+ *
+ * The statistics of a column come from its values in the reservoir,
+ * sorted. Every value has an integer key that orders like it: the value
+ * itself for fixed-width types, for strings their first eight bytes past
+ * the prefix all of them share. A radix sort orders the keys and strings
+ * that tie on them are then ordered by full comparison. Runs of equal values give
+ * the distinct values of the sample, those seen once and the most common
+ * values; the histogram is cut from the values left.
+ *
+ * The sketches cover many more rows than the reservoir, every row of the
+ * sampled pages, so their estimate is a lower bound on the distinct values
+ * of the table, and the distinct values themselves once every page was
+ * read. Otherwise the reservoir is scaled up with Haas and Stokes' Duj1
+ * estimator, n*d / (n - f1 + f1*n/N) for n sampled values of which d are
+ * distinct and f1 seen once, out of N, and the larger figure is kept.
+ */
+
+#include <math.h>
+#include <monodb/core/data/analyze.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Seed used when none is given, so that ANALYZE of an unchanged table is repeatable */
+#define DEFAULT_SEED 0x9E3779B97F4A7C15ull
+
+/* A value is a most common value if it is this much more frequent than the average one */
+#define MCV_MIN_RATIO 1.25
+
+/* Selectivity of a range over values no histogram describes */
+#define DEFAULT_RANGE_SEL (1.0 / 3.0)
+
+/* Row copied into the reservoir */
+typedef struct {
+    uint8_t* data;
+    uint16_t len;
+    uint16_t cap;
+} sample_row_t;
+
+/* Non-NULL value of a column in the reservoir */
+typedef struct {
+    uint64_t    key;  /* Orders like the value; strings: eight bytes, see sort_values() */
+    uint64_t    raw;  /* Fixed-width values: the value as stored, in the first bytes */
+    const void* data; /* Variable-length values: bytes */
+    uint16_t    len;  /* Stored length */
+} sample_value_t;
+
+/* Run of equal values in a sorted column */
+typedef struct {
+    uint32_t start;
+    uint32_t count;
+} value_run_t;
+
+/* Sample of a table and the scratch space its columns are analyzed in */
+typedef struct {
+    uint16_t                num_columns;
+    uint16_t                target;
+    sample_row_t*           rows;     /* Reservoir */
+    uint32_t                num_rows; /* Rows in the reservoir */
+    uint32_t                capacity; /* Reservoir size */
+    uint64_t                seen;     /* Live rows on the sampled pages */
+    uint64_t                next;     /* Row that next goes into the full reservoir */
+    double                  weight;   /* Algorithm L's W */
+    record_value_t*         decoded;  /* Fields of one row */
+    uint8_t*                hll;      /* Sketch of each column */
+    sample_value_t*         values;   /* Non-NULL values, capacity per column */
+    uint32_t*               counts;   /* Non-NULL values of each column */
+    sample_value_t*         scratch;  /* Radix sort buffer, capacity values */
+    uint32_t                digits[8][256]; /* Radix sort counts */
+    value_run_t*            runs;     /* Runs of equal values of one column */
+    uint32_t*               rest;     /* Values of one column that are not most common */
+    catalog_value_t*        mcvs;     /* target per column */
+    double*                 freqs;    /* target per column */
+    catalog_value_t*        bounds;   /* target + 1 per column */
+    sample_value_t*         kept;     /* Values behind mcvs and bounds, 2 * target + 1 per column */
+    catalog_column_stats_t* columns;
+} sample_t;
+
+/* splitmix64 */
+static uint64_t next_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z          = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z          = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/* Uniform double in [0, 1) */
+static double random_unit(uint64_t* state) {
+    return (double)(next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Uniform double in (0, 1), for logarithms */
+static double random_open(uint64_t* state) {
+    return ((double)(next_random(state) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+/* Algorithm L: advance to the next row that replaces a slot of the full reservoir */
+static void reservoir_skip(sample_t* sample, uint64_t* random) {
+    sample->weight *= exp(log(random_open(random)) / sample->capacity);
+    double skip = floor(log(random_open(random)) / log(1 - sample->weight));
+    sample->next += skip < 1e18 ? (uint64_t)skip + 1 : UINT64_MAX / 2;
+}
+
+/* Word-at-a-time multiplicative hash with a final avalanche, so register index and rank are
+   independent */
+static uint64_t hash_value(const void* data, uint16_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t       h = 0xCBF29CE484222325ull ^ len;
+    while (len) {
+        uint64_t word = 0;
+        uint16_t n    = len < sizeof(word) ? len : sizeof(word);
+        memcpy(&word, p, n);
+        h = (h ^ word) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+        p += n;
+        len -= n;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+void analyze_hll_add(uint8_t* hll, const void* data, uint16_t len) {
+    uint64_t h    = hash_value(data, len);
+    uint32_t slot = (uint32_t)(h >> (64 - ANALYZE_HLL_PRECISION));
+    uint64_t rest = h << ANALYZE_HLL_PRECISION;
+
+    /* Rank: position of the first set bit of the remaining hash bits */
+#if defined(__GNUC__)
+    uint8_t rank = rest ? (uint8_t)(__builtin_clzll(rest) + 1) : 64 - ANALYZE_HLL_PRECISION + 1;
+#else
+    uint8_t rank = 1;
+    while (rank <= 64 - ANALYZE_HLL_PRECISION && !(rest & (1ull << 63))) {
+        rest <<= 1;
+        rank++;
+    }
+#endif
+    if (rank > hll[slot])
+        hll[slot] = rank;
+}
+
+void analyze_hll_merge(uint8_t* hll, const uint8_t* other) {
+    for (uint32_t i = 0; i < ANALYZE_HLL_SIZE; i++) {
+        if (other[i] > hll[i])
+            hll[i] = other[i];
+    }
+}
+
+double analyze_hll_estimate(const uint8_t* hll) {
+    double   m     = ANALYZE_HLL_SIZE;
+    double   sum   = 0;
+    uint32_t zeros = 0;
+    for (uint32_t i = 0; i < ANALYZE_HLL_SIZE; i++) {
+        sum += 1.0 / (double)(1ull << hll[i]);
+        zeros += hll[i] == 0;
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+
+    /* Linear counting is more accurate while many registers are still empty */
+    if (estimate <= 2.5 * m && zeros)
+        estimate = m * log(m / zeros);
+    return estimate;
+}
+
+/* Value of a column as stored in the statistics, with its sort key */
+static void value_set(sample_value_t* out, type_id_t type, const record_value_t* value) {
+    out->key  = 0;
+    out->raw  = 0;
+    out->data = NULL;
+    switch (type) {
+    case TYPE_BOOL: {
+        uint8_t b = value->i != 0;
+        memcpy(&out->raw, &b, sizeof(b));
+        out->key = b;
+        out->len = sizeof(b);
+        break;
+    }
+    case TYPE_INT32: {
+        int32_t v = (int32_t)value->i;
+        memcpy(&out->raw, &v, sizeof(v));
+        out->key = (uint64_t)(int64_t)v ^ (1ull << 63);
+        out->len = sizeof(v);
+        break;
+    }
+    case TYPE_INT64:
+        memcpy(&out->raw, &value->i, sizeof(value->i));
+        out->key = (uint64_t)value->i ^ (1ull << 63);
+        out->len = sizeof(value->i);
+        break;
+    case TYPE_FLOAT64: {
+        double f = value->f == 0 ? 0.0 : value->f; /* -0.0 equals 0.0 */
+        memcpy(&out->raw, &f, sizeof(f));
+        out->key = out->raw >> 63 ? ~out->raw : out->raw | 1ull << 63;
+        out->len = sizeof(f);
+        break;
+    }
+    default:
+        out->data = value->data;
+        out->len  = value->len;
+        break;
+    }
+}
+
+/* Stored bytes of a value */
+static const void* value_data(const sample_value_t* value) {
+    return value->data ? value->data : (const void*)&value->raw;
+}
+
+static int compare_bytes(const void* a, const void* b) {
+    const sample_value_t* x = (const sample_value_t*)a;
+    const sample_value_t* y = (const sample_value_t*)b;
+    uint16_t              n = x->len < y->len ? x->len : y->len;
+    int                   c = n ? memcmp(x->data, y->data, n) : 0;
+    return c ? c : (x->len > y->len) - (x->len < y->len);
+}
+
+/* LSD radix sort by key, a byte a pass, skipping the bytes all keys share */
+static void radix_sort(sample_value_t* values, sample_value_t* scratch, uint32_t count,
+                       uint32_t counts[8][256]) {
+    if (count < 2)
+        return;
+    memset(counts, 0, 8 * sizeof(counts[0]));
+    for (uint32_t i = 0; i < count; i++) {
+        for (int b = 0; b < 8; b++)
+            counts[b][values[i].key >> (8 * b) & 0xFF]++;
+    }
+
+    sample_value_t* from = values;
+    sample_value_t* to   = scratch;
+    for (int b = 0; b < 8; b++) {
+        uint32_t* slots = counts[b];
+        if (slots[values[0].key >> (8 * b) & 0xFF] == count)
+            continue;
+        uint32_t offset = 0;
+        for (int d = 0; d < 256; d++) {
+            uint32_t n = slots[d];
+            slots[d]   = offset;
+            offset += n;
+        }
+        for (uint32_t i = 0; i < count; i++)
+            to[slots[from[i].key >> (8 * b) & 0xFF]++] = from[i];
+        sample_value_t* swap = from;
+        from                 = to;
+        to                   = swap;
+    }
+    if (from != values)
+        memcpy(values, from, count * sizeof(sample_value_t));
+}
+
+/* Key of a string: its eight bytes from an offset, big-endian, zero-padded */
+static uint64_t string_key(const sample_value_t* value, uint16_t offset) {
+    const uint8_t* bytes = (const uint8_t*)value->data;
+    uint64_t       key   = 0;
+    for (uint16_t i = offset; i < offset + 8; i++)
+        key = key << 8 | (i < value->len ? bytes[i] : 0);
+    return key;
+}
+
+/*
+ * Sort a column's values: by key, then strings whose keys tie by their
+ * bytes. String keys start past the prefix every value shares, which would
+ * otherwise make the keys of values such as "customer-17" all tie.
+ */
+static void sort_values(sample_t* sample, sample_value_t* values, uint32_t count,
+                        bool variable) {
+    if (variable && count) {
+        uint16_t prefix = values[0].len;
+        for (uint32_t i = 1; i < count && prefix; i++) {
+            const uint8_t* a = (const uint8_t*)values[0].data;
+            const uint8_t* b = (const uint8_t*)values[i].data;
+            uint16_t       n = values[i].len < prefix ? values[i].len : prefix;
+            for (prefix = 0; prefix < n && a[prefix] == b[prefix]; prefix++)
+                ;
+        }
+        for (uint32_t i = 0; i < count; i++)
+            values[i].key = string_key(&values[i], prefix);
+    }
+    radix_sort(values, sample->scratch, count, sample->digits);
+    for (uint32_t i = 0; variable && i < count;) {
+        uint32_t end = i + 1;
+        while (end < count && values[end].key == values[i].key)
+            end++;
+        if (end - i > 1)
+            qsort(values + i, end - i, sizeof(sample_value_t), compare_bytes);
+        i = end;
+    }
+}
+
+/* Whether two neighbouring sorted values are equal */
+static bool values_equal(const sample_value_t* a, const sample_value_t* b, bool variable) {
+    return a->key == b->key && (!variable || compare_bytes(a, b) == 0);
+}
+
+/* Most frequent runs first, ties in value order */
+static int compare_counts(const void* a, const void* b) {
+    const value_run_t* x = (const value_run_t*)a;
+    const value_run_t* y = (const value_run_t*)b;
+    if (x->count != y->count)
+        return x->count > y->count ? -1 : 1;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+static int compare_starts(const void* a, const void* b) {
+    uint32_t x = ((const value_run_t*)a)->start;
+    uint32_t y = ((const value_run_t*)b)->start;
+    return (x > y) - (x < y);
+}
+
+/* Stage one: choose pages uniformly at random, in ascending order */
+static page_id_t* choose_pages(uint32_t total, uint32_t wanted, uint64_t* random,
+                               uint32_t* chosen) {
+    if (wanted > total)
+        wanted = total;
+    page_id_t* pages = (page_id_t*)malloc((wanted ? wanted : 1) * sizeof(page_id_t));
+    if (!pages)
+        return NULL;
+
+    /* Each page is taken with probability (pages still wanted) / (pages left) */
+    uint32_t n = 0;
+    for (uint32_t p = 0; p < total && n < wanted; p++) {
+        if ((double)(total - p) * random_unit(random) < (double)(wanted - n))
+            pages[n++] = p;
+    }
+    *chosen = n;
+    return pages;
+}
+
+static void sample_free(sample_t* sample) {
+    if (sample->rows) {
+        for (uint32_t i = 0; i < sample->capacity; i++)
+            free(sample->rows[i].data);
+    }
+    free(sample->rows);
+    free(sample->decoded);
+    free(sample->hll);
+    free(sample->values);
+    free(sample->counts);
+    free(sample->scratch);
+    free(sample->runs);
+    free(sample->rest);
+    free(sample->mcvs);
+    free(sample->freqs);
+    free(sample->bounds);
+    free(sample->kept);
+    free(sample->columns);
+}
+
+static bool sample_init(sample_t* sample, uint16_t num_columns, uint32_t capacity,
+                        uint16_t target) {
+    memset(sample, 0, sizeof(*sample));
+    size_t n             = num_columns ? num_columns : 1;
+    sample->num_columns  = num_columns;
+    sample->target       = target;
+    sample->capacity     = capacity;
+    sample->rows         = (sample_row_t*)calloc(capacity, sizeof(sample_row_t));
+    sample->decoded      = (record_value_t*)malloc(n * sizeof(record_value_t));
+    sample->hll          = (uint8_t*)calloc(n, ANALYZE_HLL_SIZE);
+    sample->values       = (sample_value_t*)malloc(n * capacity * sizeof(sample_value_t));
+    sample->counts       = (uint32_t*)calloc(n, sizeof(uint32_t));
+    sample->scratch      = (sample_value_t*)malloc(capacity * sizeof(sample_value_t));
+    sample->runs         = (value_run_t*)malloc(capacity * sizeof(value_run_t));
+    sample->rest         = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    sample->mcvs         = (catalog_value_t*)malloc(n * target * sizeof(catalog_value_t));
+    sample->freqs        = (double*)malloc(n * target * sizeof(double));
+    sample->bounds       = (catalog_value_t*)malloc(n * (target + 1u) * sizeof(catalog_value_t));
+    sample->kept         = (sample_value_t*)malloc(n * (2u * target + 1) * sizeof(sample_value_t));
+    sample->columns      = (catalog_column_stats_t*)calloc(n, sizeof(catalog_column_stats_t));
+    if (sample->rows && sample->decoded && sample->hll && sample->values && sample->counts &&
+        sample->scratch && sample->runs &&
+        sample->rest && sample->mcvs && sample->freqs && sample->bounds && sample->kept &&
+        sample->columns)
+        return true;
+    sample_free(sample);
+    return false;
+}
+
+/* Stage two: read the chosen pages, sketching every row and keeping a reservoir of them */
+static bool sample_pages(sample_t* sample, heap_t* heap, const record_schema_t* schema,
+                         const page_id_t* pages, uint32_t num_pages, uint64_t* random) {
+    const record_layout_t* layout = record_schema_current(schema);
+    heap_scan_t*           scan   = heap_scan_begin_pages(heap, pages, num_pages);
+    if (!scan)
+        return false;
+
+    const void* data;
+    uint16_t    len;
+    bool        ok = true;
+    while (ok && heap_scan_next(scan, NULL, &data, &len)) {
+        ok = record_schema_decode(schema, data, len, sample->decoded);
+        if (!ok)
+            break;
+        for (uint16_t c = 0; c < sample->num_columns; c++) {
+            sample_value_t value;
+            if (sample->decoded[c].is_null)
+                continue;
+            value_set(&value, layout->types[c], &sample->decoded[c]);
+            analyze_hll_add(sample->hll + (size_t)c * ANALYZE_HLL_SIZE, value_data(&value),
+                            value.len);
+        }
+
+        /* The first rows fill the reservoir, later ones replace a slot at chosen rows */
+        uint64_t index = sample->seen++;
+        uint64_t slot  = index;
+        if (index >= sample->capacity) {
+            if (index != sample->next)
+                continue;
+            slot = next_random(random) % sample->capacity;
+            reservoir_skip(sample, random);
+        } else if (index == sample->capacity - 1) {
+            sample->next   = index;
+            sample->weight = 1;
+            reservoir_skip(sample, random);
+        }
+        sample_row_t* row = &sample->rows[slot];
+        if (row->cap < len) {
+            uint8_t* grown = (uint8_t*)realloc(row->data, len);
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            row->data = grown;
+            row->cap  = len;
+        }
+        memcpy(row->data, data, len);
+        row->len = len;
+        if (slot == sample->num_rows)
+            sample->num_rows++;
+    }
+    heap_scan_end(scan);
+    return ok;
+}
+
+/* Decode the reservoir once into the values of each column */
+static bool sample_gather(sample_t* sample, const record_schema_t* schema) {
+    const record_layout_t* layout = record_schema_current(schema);
+    for (uint32_t r = 0; r < sample->num_rows; r++) {
+        const sample_row_t* row = &sample->rows[r];
+        if (!record_schema_decode(schema, row->data, row->len, sample->decoded))
+            return false;
+        for (uint16_t c = 0; c < sample->num_columns; c++) {
+            sample_value_t* values = sample->values + (size_t)c * sample->capacity;
+            if (!sample->decoded[c].is_null)
+                value_set(&values[sample->counts[c]++], layout->types[c], &sample->decoded[c]);
+        }
+    }
+    return true;
+}
+
+/* Statistics of one column of the reservoir */
+static void analyze_column(sample_t* sample, const record_schema_t* schema, uint16_t col,
+                           double rows, bool whole) {
+    const record_layout_t*  layout   = record_schema_current(schema);
+    type_id_t               type     = layout->types[col];
+    uint16_t                target   = sample->target;
+    catalog_column_stats_t* out      = &sample->columns[col];
+    sample_value_t*         values   = sample->values + (size_t)col * sample->capacity;
+    uint32_t                count    = sample->counts[col];
+    value_run_t*            runs     = sample->runs;
+    sample_value_t*         kept     = sample->kept + (size_t)col * (2u * target + 1);
+    catalog_value_t*        mcvs     = sample->mcvs + (size_t)col * target;
+    double*                 freqs    = sample->freqs + (size_t)col * target;
+    catalog_value_t*        bounds   = sample->bounds + (size_t)col * (target + 1u);
+    bool                    variable = type_is_variable(type);
+
+    sort_values(sample, values, count, variable);
+
+    /* Runs of equal values */
+    uint32_t num_runs = 0;
+    uint32_t f1       = 0;
+    double   width    = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        width += values[i].len;
+        if (i == 0 || !values_equal(&values[i - 1], &values[i], variable))
+            runs[num_runs++] = (value_run_t){i, 0};
+        runs[num_runs - 1].count++;
+    }
+    for (uint32_t r = 0; r < num_runs; r++)
+        f1 += runs[r].count == 1;
+
+    out->null_frac = sample->num_rows ? (double)(sample->num_rows - count) / sample->num_rows : 0;
+    out->avg_width = count ? width / count : 0;
+    out->hll       = sample->hll + (size_t)col * ANALYZE_HLL_SIZE;
+    out->hll_size  = ANALYZE_HLL_SIZE;
+
+    /* Distinct values */
+    bool   complete = whole && sample->seen == sample->num_rows;
+    double nonnull  = rows * (1 - out->null_frac);
+    double sketch   = analyze_hll_estimate(out->hll);
+    double ndv      = num_runs;
+    if (!complete && whole) {
+        ndv = sketch;
+    } else if (!complete && count) {
+        double n = count;
+        double N = nonnull > n ? nonnull : n;
+        ndv      = n * num_runs / (n - f1 + f1 * n / N);
+        if (sketch > ndv)
+            ndv = sketch;
+    }
+    if (ndv > nonnull)
+        ndv = nonnull;
+    if (ndv < num_runs)
+        ndv = num_runs;
+    out->ndv = ndv;
+
+    /*
+     * Most common values: every value when the sample seems to hold them all,
+     * else those clearly more frequent than the average value
+     */
+    bool     all        = num_runs <= target && (f1 == 0 || complete);
+    double   average    = num_runs ? (double)count / num_runs : 0;
+    uint32_t candidates = 0;
+    for (uint32_t r = 0; r < num_runs; r++) {
+        if (all || (runs[r].count >= 2 && runs[r].count > MCV_MIN_RATIO * average))
+            runs[candidates++] = runs[r];
+    }
+    qsort(runs, candidates, sizeof(value_run_t), compare_counts);
+    uint16_t k = 0;
+    while (k < target && k < candidates) {
+        kept[k]  = values[runs[k].start];
+        mcvs[k]  = (catalog_value_t){value_data(&kept[k]), kept[k].len};
+        freqs[k] = (double)runs[k].count / sample->num_rows;
+        k++;
+    }
+    out->num_mcvs  = k;
+    out->mcvs      = mcvs;
+    out->mcv_freqs = freqs;
+
+    /* Equi-depth histogram of the other values, in value order */
+    qsort(runs, k, sizeof(value_run_t), compare_starts);
+    uint32_t m = 0;
+    uint32_t r = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (r < k && i >= runs[r].start + runs[r].count)
+            r++;
+        if (r < k && i >= runs[r].start)
+            continue;
+        sample->rest[m++] = i;
+    }
+    out->num_bounds = 0;
+    out->bounds     = bounds;
+    if (num_runs - k >= 2) {
+        uint32_t buckets = m - 1 < target ? m - 1 : target;
+        for (uint32_t b = 0; b <= buckets; b++) {
+            uint32_t index = sample->rest[(uint64_t)b * (m - 1) / buckets];
+            kept[k + b]    = values[index];
+            bounds[b]      = (catalog_value_t){value_data(&kept[k + b]), kept[k + b].len};
+        }
+        out->num_bounds = (uint16_t)(buckets + 1);
+    }
+}
+
+bool analyze_table(table_t* table, const record_schema_t* schema, catalog_t* catalog,
+                   const char* name, const analyze_options_t* options) {
+    if (!table || !schema || !catalog || !name || table_is_clustered(table))
+        return false;
+
+    analyze_options_t opts = options ? *options : (analyze_options_t){0};
+    if (!opts.sample_rows)
+        opts.sample_rows = ANALYZE_DEFAULT_SAMPLE;
+    if (!opts.sample_pages)
+        opts.sample_pages = opts.sample_rows;
+    if (!opts.target)
+        opts.target = ANALYZE_DEFAULT_TARGET;
+    uint64_t random = opts.seed ? opts.seed : DEFAULT_SEED;
+
+    /* Changes made while ANALYZE runs count toward the next one */
+    table_stats_t counters;
+    table_get_stats(table, &counters);
+
+    heap_t*    heap  = table_heap(table);
+    uint32_t   total = heap_num_pages(heap);
+    uint32_t   num_pages;
+    page_id_t* pages = choose_pages(total, opts.sample_pages, &random, &num_pages);
+    if (!pages)
+        return false;
+
+    sample_t sample;
+    uint16_t num_columns = record_schema_current(schema)->num_columns;
+    if (!sample_init(&sample, num_columns, opts.sample_rows, opts.target)) {
+        free(pages);
+        return false;
+    }
+    bool ok = sample_pages(&sample, heap, schema, pages, num_pages, &random);
+    free(pages);
+
+    double rows  = num_pages ? (double)sample.seen * total / num_pages : 0;
+    bool   whole = num_pages == total;
+    ok = ok && sample_gather(&sample, schema);
+    for (uint16_t c = 0; ok && c < num_columns; c++)
+        analyze_column(&sample, schema, c, rows, whole);
+
+    if (ok) {
+        catalog_table_stats_t stats = {
+            .rows          = rows,
+            .pages         = total,
+            .sampled_pages = num_pages,
+            .sampled_rows  = sample.num_rows,
+            .changes       = counters.inserts + counters.updates + counters.deletes,
+            .num_columns   = num_columns,
+            .columns       = sample.columns,
+        };
+        ok = catalog_set_stats(catalog, name, &stats);
+    }
+    sample_free(&sample);
+    return ok;
+}
+
+bool analyze_auto(table_t* table, const record_schema_t* schema, catalog_t* catalog,
+                  const char* name, const analyze_policy_t* policy,
+                  const analyze_options_t* options, bool* analyzed) {
+    if (analyzed)
+        *analyzed = false;
+    if (!table || !catalog || !name)
+        return false;
+
+    double   fraction  = policy && policy->fraction > 0 ? policy->fraction
+                                                        : ANALYZE_DEFAULT_FRACTION;
+    uint64_t threshold = policy ? policy->threshold : ANALYZE_DEFAULT_THRESHOLD;
+
+    table_stats_t counters;
+    table_get_stats(table, &counters);
+    uint64_t changes = counters.inserts + counters.updates + counters.deletes;
+
+    catalog_reader_t* reader = catalog_reader_open(catalog);
+    if (!reader)
+        return false;
+    const catalog_table_t* entry = catalog_find_table(catalog_enter(reader), name);
+    bool                   found = entry != NULL;
+    bool                   due   = true;
+    if (entry && entry->stats) {
+        const catalog_table_stats_t* stats = entry->stats;
+        due = changes - stats->changes > threshold + fraction * stats->rows;
+    }
+    catalog_leave(reader);
+    catalog_reader_close(reader);
+
+    if (!found)
+        return false;
+    if (!due)
+        return true;
+    if (!analyze_table(table, schema, catalog, name, options))
+        return false;
+    if (analyzed)
+        *analyzed = true;
+    return true;
+}
+
+/* Fraction of the rows that are neither NULL nor one of the most common values */
+static double rest_fraction(const catalog_column_stats_t* column) {
+    double rest = 1 - column->null_frac;
+    for (uint16_t i = 0; i < column->num_mcvs; i++)
+        rest -= column->mcv_freqs[i];
+    return rest > 0 ? rest : 0;
+}
+
+static double clamp_selectivity(double sel) { return sel < 0 ? 0 : sel > 1 ? 1 : sel; }
+
+/* Numeric value of a fixed-width value, for interpolating within a bucket */
+static double value_number(type_id_t type, const void* data) {
+    switch (type) {
+    case TYPE_BOOL:
+        return *(const uint8_t*)data;
+    case TYPE_INT32: {
+        int32_t v;
+        memcpy(&v, data, sizeof(v));
+        return v;
+    }
+    case TYPE_INT64: {
+        int64_t v;
+        memcpy(&v, data, sizeof(v));
+        return (double)v;
+    }
+    default: {
+        double v;
+        memcpy(&v, data, sizeof(v));
+        return v;
+    }
+    }
+}
+
+double analyze_estimate_eq(const catalog_column_stats_t* column, type_id_t type,
+                           const void* data, uint16_t len) {
+    if (!column || !data)
+        return 0;
+    for (uint16_t i = 0; i < column->num_mcvs; i++) {
+        if (type_compare(type, column->mcvs[i].data, column->mcvs[i].len, data, len) == 0)
+            return column->mcv_freqs[i];
+    }
+
+    /* Otherwise one of the other distinct values, all taken as equally frequent */
+    double others = column->ndv - column->num_mcvs;
+    return clamp_selectivity(rest_fraction(column) / (others > 1 ? others : 1));
+}
+
+/* Fraction of the histogram's values below a value, interpolating within its bucket */
+static double histogram_below(const catalog_column_stats_t* column, type_id_t type,
+                              const void* data, uint16_t len) {
+    const catalog_value_t* bounds = column->bounds;
+    uint16_t               last   = column->num_bounds - 1;
+    if (type_compare(type, data, len, bounds[0].data, bounds[0].len) < 0)
+        return 0;
+    if (type_compare(type, data, len, bounds[last].data, bounds[last].len) >= 0)
+        return 1;
+
+    /* Bucket [bounds[lo], bounds[hi]) holding the value */
+    uint16_t lo = 0;
+    uint16_t hi = last;
+    while (hi - lo > 1) {
+        uint16_t mid = (uint16_t)((lo + hi) / 2);
+        if (type_compare(type, bounds[mid].data, bounds[mid].len, data, len) <= 0)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    double within = 0.5;
+    if (!type_is_variable(type)) {
+        double a = value_number(type, bounds[lo].data);
+        double b = value_number(type, bounds[hi].data);
+        if (b > a)
+            within = (value_number(type, data) - a) / (b - a);
+    }
+    return (lo + within) / last;
+}
+
+double analyze_estimate_range(const catalog_column_stats_t* column, type_id_t type,
+                              const void* lo, uint16_t lo_len, const void* hi, uint16_t hi_len) {
+    if (!column)
+        return 0;
+
+    double sel = 0;
+    for (uint16_t i = 0; i < column->num_mcvs; i++) {
+        const catalog_value_t* mcv = &column->mcvs[i];
+        if ((!lo || type_compare(type, mcv->data, mcv->len, lo, lo_len) >= 0) &&
+            (!hi || type_compare(type, mcv->data, mcv->len, hi, hi_len) <= 0))
+            sel += column->mcv_freqs[i];
+    }
+
+    double rest = rest_fraction(column);
+    if (column->num_bounds >= 2) {
+        double below = lo ? histogram_below(column, type, lo, lo_len) : 0;
+        double upto  = hi ? histogram_below(column, type, hi, hi_len) : 1;
+        sel += upto > below ? rest * (upto - below) : 0;
+    } else {
+        sel += lo || hi ? rest * DEFAULT_RANGE_SEL : rest;
+    }
+    return clamp_selectivity(sel);
+}
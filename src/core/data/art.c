@@ -0,0 +1,1104 @@
+/**
+ * @file art.c
+ * @brief Implementation of the adaptive radix tree
+ *
+ * The root is a 256-child node that is never replaced, so every other node
+ * has a parent whose child pointer can be swapped. Child pointers tag
+ * leaves with their low bit; a leaf holds its whole key, which a lookup
+ * compares once it arrives there, so prefix bytes beyond ART_PREFIX_BYTES
+ * are skipped on the way down (inserts that must know them read them from
+ * any leaf below the node).
+ *
+ * Synchronization follows optimistic lock coupling: a reader notes a node's
+ * version, reads it, and checks the version is unchanged before following
+ * the child it found. A writer upgrades the versions it read to locks;
+ * adding or removing a child locks the one node, while replacing a node by
+ * a bigger or smaller copy, or splitting its prefix, locks its parent as
+ * well and marks the replaced node obsolete.
+ *
+ * Obsolete nodes and removed leaves are retired to epoch-based garbage
+ * lists. Every operation registers in the current epoch; the epoch only
+ * advances once no operation registered two epochs back is still running,
+ * and then the garbage retired two epochs back is freed.
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/data/art.h>
+#include <monodb/core/data/key.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define ART_SSE2 1
+#endif
+
+/* Node version word: obsolete and locked bits below a change counter */
+#define LATCH_OBSOLETE 0x1u
+#define LATCH_LOCKED   0x2u
+#define LATCH_STEP     0x4u
+
+/* Spins on a locked node before yielding */
+#define LATCH_SPINS 64
+
+/* Retirements between attempts to advance the reclamation epoch */
+#define RECLAIM_BATCH 64
+
+/* Index entries: big-endian key length, key, big-endian tuple ID */
+#define ENTRY_LEN_SIZE 2
+
+typedef enum { NODE4 = 0, NODE16 = 1, NODE48 = 2, NODE256 = 3 } node_type_t;
+
+/**
+ * Header of every inner node
+ */
+typedef struct {
+    _Atomic uint64_t latch;      /* Version word, see LATCH_* */
+    uint8_t          type;       /* node_type_t */
+    uint8_t          reserved;   /* Padding, zero */
+    uint16_t         count;      /* Children */
+    uint32_t         prefix_len; /* Compressed path length, of which the first bytes are stored */
+    uint8_t          prefix[ART_PREFIX_BYTES];
+} art_node_t;
+
+/* Child reference: a node, or a leaf with the low bit set; 0 for none */
+typedef uintptr_t art_ref_t;
+
+typedef struct {
+    art_node_t hdr;
+    uint8_t    keys[4]; /* Sorted */
+    art_ref_t  children[4];
+} node4_t;
+
+typedef struct {
+    art_node_t hdr;
+    uint8_t    keys[16]; /* Sorted */
+    art_ref_t  children[16];
+} node16_t;
+
+typedef struct {
+    art_node_t hdr;
+    uint8_t    slots[256]; /* 1 + index into children per key byte, 0 for none */
+    art_ref_t  children[48];
+} node48_t;
+
+typedef struct {
+    art_node_t hdr;
+    art_ref_t  children[256];
+} node256_t;
+
+typedef struct {
+    uint64_t value;
+    uint16_t key_len;
+    uint8_t  key[];
+} art_leaf_t;
+
+/**
+ * References retired in one epoch
+ */
+typedef struct {
+    art_ref_t* items;
+    size_t     count;
+    size_t     capacity;
+} garbage_t;
+
+struct art_t {
+    art_node_t*      root;
+    _Atomic uint64_t epoch;
+    _Atomic uint64_t active[3]; /* Operations running, by epoch they registered in (mod 3) */
+    sync_mutex_t     garbage_lock;
+    garbage_t        garbage[3]; /* Retired references, by epoch (mod 3) */
+    uint32_t         retired;    /* Retirements since the last attempt to advance */
+    _Atomic uint64_t leaves;
+    _Atomic uint64_t nodes[4];
+    _Atomic uint64_t memory;
+    _Atomic uint64_t restarts;
+    _Atomic uint64_t freed;
+};
+
+typedef enum { OP_DONE, OP_NOT_DONE, OP_RESTART, OP_ERROR } op_result_t;
+
+/**
+ * Leaves collected by a prefix scan
+ */
+typedef struct {
+    const art_leaf_t** items;
+    size_t             count;
+    size_t             capacity;
+} leaf_list_t;
+
+static const uint16_t node_capacity[4] = {4, 16, 48, 256};
+static const size_t   node_size[4]     = {sizeof(node4_t), sizeof(node16_t), sizeof(node48_t),
+                                          sizeof(node256_t)};
+
+static inline bool is_leaf(art_ref_t ref) { return (ref & 1) != 0; }
+
+static inline art_leaf_t* as_leaf(art_ref_t ref) { return (art_leaf_t*)(ref & ~(art_ref_t)1); }
+
+static inline art_node_t* as_node(art_ref_t ref) { return (art_node_t*)ref; }
+
+static inline art_ref_t leaf_ref(art_leaf_t* leaf) { return (art_ref_t)leaf | 1; }
+
+static inline art_ref_t node_ref(art_node_t* node) { return (art_ref_t)node; }
+
+static inline uint32_t min_u32(uint32_t a, uint32_t b) { return a < b ? a : b; }
+
+/* Read a node's version, waiting while it is locked; false if it is obsolete */
+static bool latch_read(art_node_t* node, uint64_t* version) {
+    uint64_t v = atomic_load_explicit(&node->latch, memory_order_acquire);
+    for (uint32_t spins = 0; v & LATCH_LOCKED; spins++) {
+        if (spins >= LATCH_SPINS)
+            sync_yield();
+        v = atomic_load_explicit(&node->latch, memory_order_acquire);
+    }
+    if (v & LATCH_OBSOLETE)
+        return false;
+    *version = v;
+    return true;
+}
+
+/* Check that a node has not changed since latch_read() */
+static inline bool latch_validate(art_node_t* node, uint64_t version) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&node->latch, memory_order_relaxed) == version;
+}
+
+/* Lock a node only if it is still at the version an optimistic read noted */
+static inline bool latch_upgrade(art_node_t* node, uint64_t version) {
+    return atomic_compare_exchange_strong(&node->latch, &version, version | LATCH_LOCKED);
+}
+
+static inline void latch_unlock(art_node_t* node) {
+    atomic_fetch_add_explicit(&node->latch, LATCH_STEP - LATCH_LOCKED, memory_order_release);
+}
+
+static inline void latch_unlock_obsolete(art_node_t* node) {
+    atomic_fetch_add_explicit(&node->latch, LATCH_STEP - LATCH_LOCKED + LATCH_OBSOLETE,
+                              memory_order_release);
+}
+
+/* Register an operation in the current epoch */
+static uint64_t epoch_enter(art_t* tree) {
+    for (;;) {
+        uint64_t epoch = atomic_load(&tree->epoch);
+        atomic_fetch_add(&tree->active[epoch % 3], 1);
+        if (atomic_load(&tree->epoch) == epoch)
+            return epoch;
+        atomic_fetch_sub(&tree->active[epoch % 3], 1);
+    }
+}
+
+static void epoch_exit(art_t* tree, uint64_t epoch) {
+    atomic_fetch_sub_explicit(&tree->active[epoch % 3], 1, memory_order_release);
+}
+
+static size_t ref_size(art_ref_t ref) {
+    return is_leaf(ref) ? sizeof(art_leaf_t) + as_leaf(ref)->key_len
+                        : node_size[as_node(ref)->type];
+}
+
+/* Take a node or leaf out of the statistics once the tree no longer holds it */
+static void ref_unaccount(art_t* tree, art_ref_t ref) {
+    atomic_fetch_sub_explicit(&tree->memory, ref_size(ref), memory_order_relaxed);
+    if (is_leaf(ref))
+        atomic_fetch_sub_explicit(&tree->leaves, 1, memory_order_relaxed);
+    else
+        atomic_fetch_sub_explicit(&tree->nodes[as_node(ref)->type], 1, memory_order_relaxed);
+}
+
+static void ref_release(art_ref_t ref) {
+    if (is_leaf(ref))
+        free(as_leaf(ref));
+    else
+        free(as_node(ref));
+}
+
+/* Free a node or leaf that no operation can reach */
+static void ref_free(art_t* tree, art_ref_t ref) {
+    ref_unaccount(tree, ref);
+    ref_release(ref);
+}
+
+static void garbage_free(art_t* tree, garbage_t* garbage) {
+    for (size_t i = 0; i < garbage->count; i++)
+        ref_release(garbage->items[i]);
+    atomic_fetch_add_explicit(&tree->freed, garbage->count, memory_order_relaxed);
+    garbage->count = 0;
+}
+
+/*
+ * Advance the epoch if no operation registered two epochs back is still
+ * running; the garbage retired then can no longer be reached. Called with
+ * the garbage lock held.
+ */
+static void epoch_advance(art_t* tree) {
+    uint64_t epoch = atomic_load(&tree->epoch);
+    if (atomic_load(&tree->active[(epoch + 2) % 3]) != 0)
+        return;
+    atomic_store(&tree->epoch, epoch + 1);
+    garbage_free(tree, &tree->garbage[(epoch + 1) % 3]);
+}
+
+/* Free a node or leaf once no running operation can still be reading it */
+static void retire(art_t* tree, art_ref_t ref) {
+    ref_unaccount(tree, ref);
+    sync_mutex_lock(&tree->garbage_lock);
+    garbage_t* garbage = &tree->garbage[atomic_load(&tree->epoch) % 3];
+    if (garbage->count == garbage->capacity) {
+        size_t     capacity = garbage->capacity ? 2 * garbage->capacity : RECLAIM_BATCH;
+        art_ref_t* items    = (art_ref_t*)realloc(garbage->items, capacity * sizeof(art_ref_t));
+        if (items) {
+            garbage->items    = items;
+            garbage->capacity = capacity;
+        }
+    }
+    /* Without room the reference is leaked rather than freed too early */
+    if (garbage->count < garbage->capacity)
+        garbage->items[garbage->count++] = ref;
+    if (++tree->retired >= RECLAIM_BATCH) {
+        tree->retired = 0;
+        epoch_advance(tree);
+    }
+    sync_mutex_unlock(&tree->garbage_lock);
+}
+
+static art_node_t* node_alloc(art_t* tree, node_type_t type) {
+    art_node_t* node = (art_node_t*)calloc(1, node_size[type]);
+    if (!node)
+        return NULL;
+    node->type = (uint8_t)type;
+    atomic_fetch_add_explicit(&tree->nodes[type], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&tree->memory, node_size[type], memory_order_relaxed);
+    return node;
+}
+
+static art_leaf_t* leaf_alloc(art_t* tree, const uint8_t* key, uint16_t key_len, uint64_t value) {
+    art_leaf_t* leaf = (art_leaf_t*)malloc(sizeof(art_leaf_t) + key_len);
+    if (!leaf)
+        return NULL;
+    leaf->value   = value;
+    leaf->key_len = key_len;
+    memcpy(leaf->key, key, key_len);
+    atomic_fetch_add_explicit(&tree->leaves, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&tree->memory, sizeof(art_leaf_t) + key_len, memory_order_relaxed);
+    return leaf;
+}
+
+/* Child for a key byte, 0 if there is none. Counts are clamped, since optimistic readers may
+ * see a node mid-change. */
+static art_ref_t find_child(const art_node_t* node, uint8_t byte) {
+    switch (node->type) {
+    case NODE4: {
+        const node4_t* n     = (const node4_t*)node;
+        uint32_t       count = min_u32(node->count, 4);
+        for (uint32_t i = 0; i < count; i++) {
+            if (n->keys[i] == byte)
+                return n->children[i];
+        }
+        return 0;
+    }
+    case NODE16: {
+        const node16_t* n     = (const node16_t*)node;
+        uint32_t        count = min_u32(node->count, 16);
+#ifdef ART_SSE2
+        __m128i  match = _mm_cmpeq_epi8(_mm_set1_epi8((char)byte),
+                                        _mm_loadu_si128((const __m128i*)n->keys));
+        uint32_t mask  = (uint32_t)_mm_movemask_epi8(match) & ((1u << count) - 1);
+        return mask ? n->children[__builtin_ctz(mask)] : 0;
+#else
+        for (uint32_t i = 0; i < count; i++) {
+            if (n->keys[i] == byte)
+                return n->children[i];
+        }
+        return 0;
+#endif
+    }
+    case NODE48: {
+        const node48_t* n    = (const node48_t*)node;
+        uint8_t         slot = n->slots[byte];
+        return slot > 0 && slot <= 48 ? n->children[slot - 1] : 0;
+    }
+    default:
+        return ((const node256_t*)node)->children[byte];
+    }
+}
+
+/* Child number i in key order, for i below the node's count or, for the larger nodes, 256;
+ * 0 where there is none */
+static art_ref_t child_at(const art_node_t* node, uint32_t i, uint8_t* byte) {
+    switch (node->type) {
+    case NODE4:
+        *byte = ((const node4_t*)node)->keys[i];
+        return ((const node4_t*)node)->children[i];
+    case NODE16:
+        *byte = ((const node16_t*)node)->keys[i];
+        return ((const node16_t*)node)->children[i];
+    default:
+        *byte = (uint8_t)i;
+        return find_child(node, (uint8_t)i);
+    }
+}
+
+/* Number of positions child_at() walks */
+static uint32_t child_positions(const art_node_t* node) {
+    return node->type <= NODE16 ? min_u32(node->count, node_capacity[node->type]) : 256;
+}
+
+/* Key bytes of a node with sorted keys (4 or 16 children) */
+static inline uint8_t* sorted_keys(art_node_t* node) {
+    return node->type == NODE4 ? ((node4_t*)node)->keys : ((node16_t*)node)->keys;
+}
+
+static inline art_ref_t* sorted_children(art_node_t* node) {
+    return node->type == NODE4 ? ((node4_t*)node)->children : ((node16_t*)node)->children;
+}
+
+/* Add a child to a locked node with room for it */
+static void node_add(art_node_t* node, uint8_t byte, art_ref_t child) {
+    switch (node->type) {
+    case NODE4:
+    case NODE16: {
+        uint8_t*   keys     = sorted_keys(node);
+        art_ref_t* children = sorted_children(node);
+        uint32_t   pos      = node->count;
+        /* Shift element by element so concurrent readers never see a torn pointer */
+        while (pos > 0 && keys[pos - 1] > byte) {
+            keys[pos]     = keys[pos - 1];
+            children[pos] = children[pos - 1];
+            pos--;
+        }
+        keys[pos]     = byte;
+        children[pos] = child;
+        break;
+    }
+    case NODE48: {
+        node48_t* n    = (node48_t*)node;
+        uint32_t  slot = 0;
+        while (n->children[slot] != 0)
+            slot++;
+        n->children[slot] = child;
+        n->slots[byte]    = (uint8_t)(slot + 1);
+        break;
+    }
+    default:
+        ((node256_t*)node)->children[byte] = child;
+        break;
+    }
+    node->count++;
+}
+
+/* Replace the child of a key byte in a locked node */
+static void node_change(art_node_t* node, uint8_t byte, art_ref_t child) {
+    switch (node->type) {
+    case NODE4:
+    case NODE16: {
+        uint8_t*   keys     = sorted_keys(node);
+        art_ref_t* children = sorted_children(node);
+        for (uint32_t i = 0; i < node->count; i++) {
+            if (keys[i] == byte)
+                children[i] = child;
+        }
+        break;
+    }
+    case NODE48: {
+        node48_t* n                     = (node48_t*)node;
+        n->children[n->slots[byte] - 1] = child;
+        break;
+    }
+    default:
+        ((node256_t*)node)->children[byte] = child;
+        break;
+    }
+}
+
+/* Remove the child of a key byte from a locked node */
+static void node_remove(art_node_t* node, uint8_t byte) {
+    switch (node->type) {
+    case NODE4:
+    case NODE16: {
+        uint8_t*   keys     = sorted_keys(node);
+        art_ref_t* children = sorted_children(node);
+        uint32_t   pos      = 0;
+        while (pos < node->count && keys[pos] != byte)
+            pos++;
+        for (; pos + 1 < node->count; pos++) {
+            keys[pos]     = keys[pos + 1];
+            children[pos] = children[pos + 1];
+        }
+        break;
+    }
+    case NODE48: {
+        node48_t* n                     = (node48_t*)node;
+        n->children[n->slots[byte] - 1] = 0;
+        n->slots[byte]                  = 0;
+        break;
+    }
+    default:
+        ((node256_t*)node)->children[byte] = 0;
+        break;
+    }
+    node->count--;
+}
+
+/* Fill a new node with the prefix and children of a locked one, leaving out one key byte
+ * (skip < 0 keeps every child) */
+static void node_copy(art_node_t* dst, const art_node_t* src, int skip) {
+    dst->prefix_len = src->prefix_len;
+    memcpy(dst->prefix, src->prefix, ART_PREFIX_BYTES);
+
+    uint32_t positions = child_positions(src);
+    for (uint32_t i = 0; i < positions; i++) {
+        uint8_t   byte;
+        art_ref_t child = child_at(src, i, &byte);
+        if (child && byte != skip)
+            node_add(dst, byte, child);
+    }
+}
+
+/* Any leaf below a node, read optimistically; NULL if the subtree changed meanwhile */
+static const art_leaf_t* any_leaf(art_node_t* node) {
+    for (;;) {
+        uint64_t version;
+        if (!latch_read(node, &version))
+            return NULL;
+
+        art_ref_t child     = 0;
+        uint32_t  positions = child_positions(node);
+        for (uint32_t i = 0; i < positions && !child; i++) {
+            uint8_t byte;
+            child = child_at(node, i, &byte);
+        }
+        if (!child || !latch_validate(node, version))
+            return NULL;
+        if (is_leaf(child))
+            return as_leaf(child);
+        node = as_node(child);
+    }
+}
+
+/*
+ * Byte i of a node's compressed path starting at depth: stored in the node
+ * or, past the stored bytes, taken from a leaf below it. Returns -1 if no
+ * consistent leaf could be read.
+ */
+static int prefix_byte(art_node_t* node, const art_leaf_t** leaf, uint32_t depth, uint32_t i) {
+    if (i < ART_PREFIX_BYTES)
+        return node->prefix[i];
+    if (!*leaf)
+        *leaf = any_leaf(node);
+    if (!*leaf || depth + i >= (*leaf)->key_len)
+        return -1;
+    return (*leaf)->key[depth + i];
+}
+
+/*
+ * Split a node's compressed path where the key leaves it: a new node with
+ * the common part takes the node's place, holding the node (with the rest
+ * of its path) and the new leaf.
+ */
+static op_result_t split_prefix(art_t* tree, art_node_t* parent, uint64_t parent_version,
+                                uint8_t parent_byte, art_node_t* node, uint64_t version,
+                                const art_leaf_t* any, uint32_t depth, uint32_t mismatch,
+                                const uint8_t* key, uint16_t key_len, art_leaf_t* leaf) {
+    /* The key ending inside the path would make it a prefix of every key below */
+    if (depth + mismatch >= key_len)
+        return OP_NOT_DONE;
+
+    uint8_t  head[ART_PREFIX_BYTES], tail[ART_PREFIX_BYTES];
+    uint32_t tail_len = node->prefix_len - mismatch - 1;
+    int      branch   = prefix_byte(node, &any, depth, mismatch);
+    for (uint32_t i = 0; i < min_u32(mismatch, ART_PREFIX_BYTES); i++)
+        head[i] = (uint8_t)node->prefix[i];
+    for (uint32_t i = 0; branch >= 0 && i < min_u32(tail_len, ART_PREFIX_BYTES); i++) {
+        int b = prefix_byte(node, &any, depth, mismatch + 1 + i);
+        if (b < 0)
+            branch = -1;
+        tail[i] = (uint8_t)b;
+    }
+    if (branch < 0)
+        return OP_RESTART;
+
+    art_node_t* split = node_alloc(tree, NODE4);
+    if (!split)
+        return OP_ERROR;
+    if (!latch_upgrade(parent, parent_version)) {
+        ref_free(tree, node_ref(split));
+        return OP_RESTART;
+    }
+    if (!latch_upgrade(node, version)) {
+        latch_unlock(parent);
+        ref_free(tree, node_ref(split));
+        return OP_RESTART;
+    }
+
+    split->prefix_len = mismatch;
+    memcpy(split->prefix, head, min_u32(mismatch, ART_PREFIX_BYTES));
+    node_add(split, key[depth + mismatch], leaf_ref(leaf));
+    node_add(split, (uint8_t)branch, node_ref(node));
+
+    node->prefix_len = tail_len;
+    memcpy(node->prefix, tail, min_u32(tail_len, ART_PREFIX_BYTES));
+    node_change(parent, parent_byte, node_ref(split));
+
+    latch_unlock(node);
+    latch_unlock(parent);
+    return OP_DONE;
+}
+
+static op_result_t insert_attempt(art_t* tree, const uint8_t* key, uint16_t key_len,
+                                  art_leaf_t* leaf) {
+    art_node_t* parent         = NULL;
+    uint64_t    parent_version = 0;
+    uint8_t     parent_byte    = 0;
+    art_node_t* node           = tree->root;
+    uint64_t    version;
+    uint32_t    depth = 0;
+
+    if (!latch_read(node, &version))
+        return OP_RESTART;
+
+    for (;;) {
+        /* Follow the compressed path as far as the key matches it */
+        uint32_t prefix_len = node->prefix_len;
+        if (prefix_len > 0) {
+            const art_leaf_t* any = NULL;
+            uint32_t          i   = 0;
+            for (; i < prefix_len; i++) {
+                int b = prefix_byte(node, &any, depth, i);
+                if (b < 0)
+                    return OP_RESTART;
+                if (depth + i >= key_len || key[depth + i] != b)
+                    break;
+            }
+            if (!latch_validate(node, version))
+                return OP_RESTART;
+            if (i < prefix_len)
+                return split_prefix(tree, parent, parent_version, parent_byte, node, version, any,
+                                    depth, i, key, key_len, leaf);
+            depth += prefix_len;
+        }
+        if (depth >= key_len)
+            return latch_validate(node, version) ? OP_NOT_DONE : OP_RESTART;
+
+        art_ref_t next = find_child(node, key[depth]);
+        if (!latch_validate(node, version))
+            return OP_RESTART;
+
+        if (!next && node->count < node_capacity[node->type]) {
+            if (!latch_upgrade(node, version))
+                return OP_RESTART;
+            node_add(node, key[depth], leaf_ref(leaf));
+            latch_unlock(node);
+            return OP_DONE;
+        }
+
+        if (!next) {
+            /* Full: replace the node by a copy of the next size up */
+            art_node_t* grown = node_alloc(tree, (node_type_t)(node->type + 1));
+            if (!grown)
+                return OP_ERROR;
+            if (!latch_upgrade(parent, parent_version)) {
+                ref_free(tree, node_ref(grown));
+                return OP_RESTART;
+            }
+            if (!latch_upgrade(node, version)) {
+                latch_unlock(parent);
+                ref_free(tree, node_ref(grown));
+                return OP_RESTART;
+            }
+            node_copy(grown, node, -1);
+            node_add(grown, key[depth], leaf_ref(leaf));
+            node_change(parent, parent_byte, node_ref(grown));
+            latch_unlock_obsolete(node);
+            latch_unlock(parent);
+            retire(tree, node_ref(node));
+            return OP_DONE;
+        }
+
+        if (is_leaf(next)) {
+            /* Both keys go below a new node holding the path they share past this byte */
+            const art_leaf_t* other = as_leaf(next);
+            uint32_t          end   = depth + 1;
+            while (end < key_len && end < other->key_len && key[end] == other->key[end])
+                end++;
+            if (end >= key_len || end >= other->key_len)
+                return OP_NOT_DONE;
+
+            art_node_t* split = node_alloc(tree, NODE4);
+            if (!split)
+                return OP_ERROR;
+            split->prefix_len = end - depth - 1;
+            memcpy(split->prefix, key + depth + 1, min_u32(split->prefix_len, ART_PREFIX_BYTES));
+            node_add(split, key[end], leaf_ref(leaf));
+            node_add(split, other->key[end], next);
+
+            if (!latch_upgrade(node, version)) {
+                ref_free(tree, node_ref(split));
+                return OP_RESTART;
+            }
+            node_change(node, key[depth], node_ref(split));
+            latch_unlock(node);
+            return OP_DONE;
+        }
+
+        parent         = node;
+        parent_version = version;
+        parent_byte    = key[depth];
+        node           = as_node(next);
+        depth++;
+        if (!latch_read(node, &version))
+            return OP_RESTART;
+    }
+}
+
+/*
+ * Remove a node's last-but-one child: the node gives way to its remaining
+ * child, which takes over the node's path and the byte leading to it.
+ */
+static op_result_t collapse_node(art_t* tree, art_node_t* parent, uint64_t parent_version,
+                                 uint8_t parent_byte, art_node_t* node, uint64_t version,
+                                 uint8_t byte) {
+    if (!latch_upgrade(parent, parent_version))
+        return OP_RESTART;
+    if (!latch_upgrade(node, version)) {
+        latch_unlock(parent);
+        return OP_RESTART;
+    }
+
+    node4_t*  n         = (node4_t*)node;
+    uint32_t  keep      = n->keys[0] == byte ? 1 : 0;
+    art_ref_t remaining = n->children[keep];
+
+    if (!is_leaf(remaining)) {
+        art_node_t* child = as_node(remaining);
+        uint64_t    child_version;
+        if (!latch_read(child, &child_version) || !latch_upgrade(child, child_version)) {
+            latch_unlock(node);
+            latch_unlock(parent);
+            return OP_RESTART;
+        }
+
+        /* Path: the node's, then the byte to the child, then the child's own */
+        uint8_t  prefix[ART_PREFIX_BYTES];
+        uint32_t len = min_u32(node->prefix_len, ART_PREFIX_BYTES);
+        memcpy(prefix, node->prefix, len);
+        if (len < ART_PREFIX_BYTES)
+            prefix[len++] = n->keys[keep];
+        uint32_t from_child = min_u32(ART_PREFIX_BYTES - len, child->prefix_len);
+        memcpy(prefix + len, child->prefix, from_child);
+
+        child->prefix_len += node->prefix_len + 1;
+        memcpy(child->prefix, prefix, len + from_child);
+        latch_unlock(child);
+    }
+
+    node_change(parent, parent_byte, remaining);
+    latch_unlock_obsolete(node);
+    latch_unlock(parent);
+    retire(tree, node_ref(node));
+    return OP_DONE;
+}
+
+/* Remove a child, replacing the node by a copy of the next size down */
+static op_result_t shrink_node(art_t* tree, art_node_t* parent, uint64_t parent_version,
+                               uint8_t parent_byte, art_node_t* node, uint64_t version,
+                               uint8_t byte) {
+    art_node_t* shrunk = node_alloc(tree, (node_type_t)(node->type - 1));
+    if (!shrunk)
+        return OP_ERROR;
+    if (!latch_upgrade(parent, parent_version)) {
+        ref_free(tree, node_ref(shrunk));
+        return OP_RESTART;
+    }
+    if (!latch_upgrade(node, version)) {
+        latch_unlock(parent);
+        ref_free(tree, node_ref(shrunk));
+        return OP_RESTART;
+    }
+
+    node_copy(shrunk, node, byte);
+    node_change(parent, parent_byte, node_ref(shrunk));
+    latch_unlock_obsolete(node);
+    latch_unlock(parent);
+    retire(tree, node_ref(node));
+    return OP_DONE;
+}
+
+/* Whether a node with one child fewer belongs in the next size down */
+static bool should_shrink(const art_node_t* node) {
+    switch (node->type) {
+    case NODE16:
+        return node->count - 1 <= 3;
+    case NODE48:
+        return node->count - 1 <= 12;
+    case NODE256:
+        return node->count - 1 <= 37;
+    default:
+        return false;
+    }
+}
+
+static op_result_t delete_attempt(art_t* tree, const uint8_t* key, uint16_t key_len) {
+    art_node_t* parent         = NULL;
+    uint64_t    parent_version = 0;
+    uint8_t     parent_byte    = 0;
+    art_node_t* node           = tree->root;
+    uint64_t    version;
+    uint32_t    depth = 0;
+
+    if (!latch_read(node, &version))
+        return OP_RESTART;
+
+    for (;;) {
+        uint32_t stored = min_u32(node->prefix_len, ART_PREFIX_BYTES);
+        for (uint32_t i = 0; i < stored; i++) {
+            if (depth + i >= key_len || key[depth + i] != node->prefix[i])
+                return latch_validate(node, version) ? OP_NOT_DONE : OP_RESTART;
+        }
+        depth += node->prefix_len;
+        if (depth >= key_len)
+            return latch_validate(node, version) ? OP_NOT_DONE : OP_RESTART;
+
+        uint8_t   byte = key[depth];
+        art_ref_t next = find_child(node, byte);
+        if (!latch_validate(node, version))
+            return OP_RESTART;
+        if (!next)
+            return OP_NOT_DONE;
+
+        if (is_leaf(next)) {
+            const art_leaf_t* leaf = as_leaf(next);
+            if (leaf->key_len != key_len || memcmp(leaf->key, key, key_len) != 0)
+                return OP_NOT_DONE;
+
+            op_result_t result;
+            if (parent && node->type == NODE4 && node->count == 2) {
+                result = collapse_node(tree, parent, parent_version, parent_byte, node, version,
+                                       byte);
+            } else if (parent && should_shrink(node)) {
+                result = shrink_node(tree, parent, parent_version, parent_byte, node, version,
+                                     byte);
+            } else {
+                result = latch_upgrade(node, version) ? OP_DONE : OP_RESTART;
+                if (result == OP_DONE) {
+                    node_remove(node, byte);
+                    latch_unlock(node);
+                }
+            }
+            if (result == OP_DONE)
+                retire(tree, next);
+            return result;
+        }
+
+        parent         = node;
+        parent_version = version;
+        parent_byte    = byte;
+        node           = as_node(next);
+        depth++;
+        if (!latch_read(node, &version))
+            return OP_RESTART;
+    }
+}
+
+static op_result_t get_attempt(art_t* tree, const uint8_t* key, uint16_t key_len,
+                               uint64_t* value) {
+    art_node_t* node = tree->root;
+    uint64_t    version;
+    uint32_t    depth = 0;
+
+    if (!latch_read(node, &version))
+        return OP_RESTART;
+
+    for (;;) {
+        /* Only the stored part of the path is checked; the leaf compares the whole key */
+        uint32_t stored = min_u32(node->prefix_len, ART_PREFIX_BYTES);
+        for (uint32_t i = 0; i < stored; i++) {
+            if (depth + i >= key_len || key[depth + i] != node->prefix[i])
+                return latch_validate(node, version) ? OP_NOT_DONE : OP_RESTART;
+        }
+        depth += node->prefix_len;
+        if (depth >= key_len)
+            return latch_validate(node, version) ? OP_NOT_DONE : OP_RESTART;
+
+        art_ref_t next = find_child(node, key[depth]);
+        if (!latch_validate(node, version))
+            return OP_RESTART;
+        if (!next)
+            return OP_NOT_DONE;
+
+        if (is_leaf(next)) {
+            const art_leaf_t* leaf = as_leaf(next);
+            if (leaf->key_len != key_len || memcmp(leaf->key, key, key_len) != 0)
+                return OP_NOT_DONE;
+            if (value)
+                *value = leaf->value;
+            return OP_DONE;
+        }
+
+        node = as_node(next);
+        depth++;
+        if (!latch_read(node, &version))
+            return OP_RESTART;
+    }
+}
+
+static bool leaf_list_add(leaf_list_t* list, const art_leaf_t* leaf) {
+    if (list->count == list->capacity) {
+        size_t             capacity = list->capacity ? 2 * list->capacity : 64;
+        const art_leaf_t** items =
+            (const art_leaf_t**)realloc((void*)list->items, capacity * sizeof(art_leaf_t*));
+        if (!items)
+            return false;
+        list->items    = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = leaf;
+    return true;
+}
+
+/* Collect every leaf below a node in key order */
+static op_result_t collect_leaves(art_node_t* node, uint64_t version, leaf_list_t* list) {
+    uint32_t positions = child_positions(node);
+    for (uint32_t i = 0; i < positions; i++) {
+        uint8_t   byte;
+        art_ref_t child = child_at(node, i, &byte);
+        if (!latch_validate(node, version))
+            return OP_RESTART;
+        if (!child)
+            continue;
+
+        if (is_leaf(child)) {
+            if (!leaf_list_add(list, as_leaf(child)))
+                return OP_ERROR;
+            continue;
+        }
+
+        uint64_t child_version;
+        if (!latch_read(as_node(child), &child_version))
+            return OP_RESTART;
+        op_result_t result = collect_leaves(as_node(child), child_version, list);
+        if (result != OP_DONE)
+            return result;
+    }
+    return latch_validate(node, version) ? OP_DONE : OP_RESTART;
+}
+
+static op_result_t scan_attempt(art_t* tree, const uint8_t* prefix, uint16_t prefix_len,
+                                leaf_list_t* list) {
+    art_node_t* node = tree->root;
+    uint64_t    version;
+    uint32_t    depth = 0;
+
+    if (!latch_read(node, &version))
+        return OP_RESTART;
+
+    for (;;) {
+        /* Leaves are checked against the whole prefix, so unstored path bytes may be skipped */
+        uint32_t stored = min_u32(node->prefix_len, ART_PREFIX_BYTES);
+        for (uint32_t i = 0; i < stored && depth + i < prefix_len; i++) {
+            if (prefix[depth + i] != node->prefix[i])
+                return latch_validate(node, version) ? OP_DONE : OP_RESTART;
+        }
+        if (depth + node->prefix_len >= prefix_len)
+            return collect_leaves(node, version, list);
+        depth += node->prefix_len;
+
+        art_ref_t next = find_child(node, prefix[depth]);
+        if (!latch_validate(node, version))
+            return OP_RESTART;
+        if (!next)
+            return OP_DONE;
+        if (is_leaf(next))
+            return leaf_list_add(list, as_leaf(next)) ? OP_DONE : OP_ERROR;
+
+        node = as_node(next);
+        depth++;
+        if (!latch_read(node, &version))
+            return OP_RESTART;
+    }
+}
+
+art_t* art_create(void) {
+    art_t* tree = (art_t*)calloc(1, sizeof(art_t));
+    if (!tree)
+        return NULL;
+
+    tree->root = node_alloc(tree, NODE256);
+    if (!tree->root) {
+        free(tree);
+        return NULL;
+    }
+    sync_mutex_init(&tree->garbage_lock);
+    return tree;
+}
+
+static void free_subtree(art_t* tree, art_ref_t ref) {
+    if (!is_leaf(ref)) {
+        art_node_t* node      = as_node(ref);
+        uint32_t    positions = child_positions(node);
+        for (uint32_t i = 0; i < positions; i++) {
+            uint8_t   byte;
+            art_ref_t child = child_at(node, i, &byte);
+            if (child)
+                free_subtree(tree, child);
+        }
+    }
+    ref_free(tree, ref);
+}
+
+void art_destroy(art_t* tree) {
+    if (!tree)
+        return;
+
+    free_subtree(tree, node_ref(tree->root));
+    for (int i = 0; i < 3; i++) {
+        garbage_free(tree, &tree->garbage[i]);
+        free(tree->garbage[i].items);
+    }
+    sync_mutex_destroy(&tree->garbage_lock);
+    free(tree);
+}
+
+bool art_insert(art_t* tree, const void* key, uint16_t key_len, uint64_t value) {
+    if (!tree || !key || key_len == 0 || key_len > ART_MAX_KEY_SIZE)
+        return false;
+
+    art_leaf_t* leaf = leaf_alloc(tree, (const uint8_t*)key, key_len, value);
+    if (!leaf)
+        return false;
+
+    uint64_t    epoch = epoch_enter(tree);
+    op_result_t result;
+    while ((result = insert_attempt(tree, (const uint8_t*)key, key_len, leaf)) == OP_RESTART)
+        atomic_fetch_add_explicit(&tree->restarts, 1, memory_order_relaxed);
+    epoch_exit(tree, epoch);
+
+    if (result != OP_DONE)
+        ref_free(tree, leaf_ref(leaf));
+    return result == OP_DONE;
+}
+
+bool art_get(art_t* tree, const void* key, uint16_t key_len, uint64_t* value) {
+    if (!tree || !key || key_len == 0)
+        return false;
+
+    uint64_t    epoch = epoch_enter(tree);
+    op_result_t result;
+    while ((result = get_attempt(tree, (const uint8_t*)key, key_len, value)) == OP_RESTART)
+        atomic_fetch_add_explicit(&tree->restarts, 1, memory_order_relaxed);
+    epoch_exit(tree, epoch);
+    return result == OP_DONE;
+}
+
+bool art_delete(art_t* tree, const void* key, uint16_t key_len) {
+    if (!tree || !key || key_len == 0)
+        return false;
+
+    uint64_t    epoch = epoch_enter(tree);
+    op_result_t result;
+    while ((result = delete_attempt(tree, (const uint8_t*)key, key_len)) == OP_RESTART)
+        atomic_fetch_add_explicit(&tree->restarts, 1, memory_order_relaxed);
+    epoch_exit(tree, epoch);
+    return result == OP_DONE;
+}
+
+bool art_scan_prefix(art_t* tree, const void* prefix, uint16_t prefix_len, art_visit_fn visit,
+                     void* arg) {
+    if (!tree || (!prefix && prefix_len > 0) || !visit)
+        return false;
+
+    leaf_list_t list  = {NULL, 0, 0};
+    uint64_t    epoch = epoch_enter(tree);
+    op_result_t result;
+    for (;;) {
+        list.count = 0;
+        result     = scan_attempt(tree, (const uint8_t*)prefix, prefix_len, &list);
+        if (result != OP_RESTART)
+            break;
+        atomic_fetch_add_explicit(&tree->restarts, 1, memory_order_relaxed);
+    }
+
+    /* Collected leaves stay allocated until this operation leaves its epoch */
+    for (size_t i = 0; result == OP_DONE && i < list.count; i++) {
+        const art_leaf_t* leaf = list.items[i];
+        if (leaf->key_len < prefix_len ||
+            (prefix_len > 0 && memcmp(leaf->key, prefix, prefix_len) != 0))
+            continue;
+        if (!visit(leaf->key, leaf->key_len, leaf->value, arg))
+            break;
+    }
+    epoch_exit(tree, epoch);
+
+    free((void*)list.items);
+    return result == OP_DONE;
+}
+
+void art_get_stats(art_t* tree, art_stats_t* stats) {
+    if (!tree || !stats)
+        return;
+
+    stats->leaves = atomic_load_explicit(&tree->leaves, memory_order_relaxed);
+    for (int i = 0; i < 4; i++)
+        stats->nodes[i] = atomic_load_explicit(&tree->nodes[i], memory_order_relaxed);
+    stats->memory   = atomic_load_explicit(&tree->memory, memory_order_relaxed);
+    stats->restarts = atomic_load_explicit(&tree->restarts, memory_order_relaxed);
+    stats->freed    = atomic_load_explicit(&tree->freed, memory_order_relaxed);
+}
+
+/* Secondary index entries: big-endian key length, key, big-endian tuple ID */
+static uint16_t make_entry_key(uint8_t* out, const void* key, uint16_t key_len, tuple_id_t tid,
+                               bool with_tid) {
+    key_put_u16(out, key_len);
+    memcpy(out + ENTRY_LEN_SIZE, key, key_len);
+    if (!with_tid)
+        return (uint16_t)(ENTRY_LEN_SIZE + key_len);
+    return (uint16_t)(ENTRY_LEN_SIZE + key_len + key_put_tid(out + ENTRY_LEN_SIZE + key_len, tid));
+}
+
+static bool art_index_insert(void* state, const void* key, uint16_t key_len, tuple_id_t tid) {
+    uint8_t entry[ART_MAX_KEY_SIZE];
+    if ((!key && key_len > 0) || key_len > ART_MAX_KEY_SIZE - ENTRY_LEN_SIZE - KEY_TID_SIZE)
+        return false;
+    return art_insert((art_t*)state, entry, make_entry_key(entry, key, key_len, tid, true), 0);
+}
+
+static bool art_index_remove(void* state, const void* key, uint16_t key_len, tuple_id_t tid) {
+    uint8_t entry[ART_MAX_KEY_SIZE];
+    if ((!key && key_len > 0) || key_len > ART_MAX_KEY_SIZE - ENTRY_LEN_SIZE - KEY_TID_SIZE)
+        return false;
+    return art_delete((art_t*)state, entry, make_entry_key(entry, key, key_len, tid, true));
+}
+
+/**
+ * Lookup state of art_index_ops
+ */
+typedef struct {
+    index_visit_fn visit;
+    void*          arg;
+} index_lookup_t;
+
+static bool visit_entry(const void* key, uint16_t key_len, uint64_t value, void* arg) {
+    index_lookup_t* lookup = (index_lookup_t*)arg;
+    (void)value;
+
+    return lookup->visit(key_get_tid((const uint8_t*)key + key_len - KEY_TID_SIZE), lookup->arg);
+}
+
+static bool art_index_lookup(void* state, const void* key, uint16_t key_len,
+                             index_visit_fn visit, void* arg) {
+    uint8_t        prefix[ART_MAX_KEY_SIZE];
+    index_lookup_t lookup = {visit, arg};
+    if ((!key && key_len > 0) || key_len > ART_MAX_KEY_SIZE - ENTRY_LEN_SIZE - KEY_TID_SIZE)
+        return false;
+
+    /* The length in front keeps longer keys sharing these bytes out of the scan */
+    uint16_t len = make_entry_key(prefix, key, key_len, INVALID_TUPLE_ID, false);
+    return art_scan_prefix((art_t*)state, prefix, len, visit_entry, &lookup);
+}
+
+static void art_index_close(void* state) { art_destroy((art_t*)state); }
+
+const index_ops_t art_index_ops = {art_index_insert, art_index_remove, art_index_lookup,
+                                   art_index_close,  NULL,             NULL};
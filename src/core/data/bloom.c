@@ -0,0 +1,151 @@
+/**
+ * @file bloom.c
+ * @brief Implementation of cache-line-blocked Bloom filters
+ *
+ * The layout is a split block filter: the upper 32 bits of a hash choose
+ * the block (by multiply and shift rather than modulo), and the lower 32
+ * bits, multiplied by a different odd constant per lane, give the bit set
+ * in each lane from the top five bits of the product. Blocks are aligned
+ * to 64 bytes so no block spans two cache lines.
+ *
+ * The AVX2, SSE2 and scalar probes compute the same bits; the vector ones
+ * only differ in how many lanes they test at once. Lanes are atomic: adds
+ * OR their bits in and probes copy a block out with relaxed loads, so the
+ * two can race without a data race.
+ */
+
+#include <monodb/core/data/bloom.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BLOOM_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define BLOOM_SSE2 1
+#endif
+
+/* Lanes per block, one bit set in each */
+#define BLOOM_LANES 8
+
+/* Bits per block */
+#define BLOOM_BLOCK_BITS (BLOOM_LANES * 32)
+
+/* Alignment of the block array */
+#define BLOOM_ALIGN 64
+
+/**
+ * One block: eight 32-bit lanes, 32 bytes
+ */
+typedef struct {
+    _Atomic uint32_t lanes[BLOOM_LANES];
+} bloom_block_t;
+
+struct bloom_t {
+    bloom_block_t*   blocks;     /* BLOOM_ALIGN-aligned, inside this allocation */
+    uint32_t         num_blocks;
+    uint32_t         capacity;   /* Keys the filter was sized for */
+    _Atomic uint64_t count;      /* Keys added */
+};
+
+/* Odd multipliers, one per lane */
+static const uint32_t lane_salt[BLOOM_LANES] = {0x47B6137Bu, 0x44974D91u, 0x8824AD5Bu,
+                                                0xA2B7289Du, 0x705495C7u, 0x2DF1424Bu,
+                                                0x9EFC4947u, 0x5C6BFB31u};
+
+uint64_t bloom_hash(const void* key, size_t len) {
+    const uint8_t* p = (const uint8_t*)key;
+    uint64_t       h = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001B3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+bloom_t* bloom_create(uint32_t capacity, uint32_t bits_per_key) {
+    if (capacity == 0)
+        capacity = 1;
+    if (bits_per_key == 0)
+        bits_per_key = 1;
+
+    uint64_t bits   = (uint64_t)capacity * bits_per_key;
+    uint64_t blocks = (bits + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+    if (blocks > UINT32_MAX / sizeof(bloom_block_t))
+        return NULL;
+
+    size_t   size   = sizeof(bloom_t) + BLOOM_ALIGN + (size_t)blocks * sizeof(bloom_block_t);
+    bloom_t* filter = (bloom_t*)malloc(size);
+    if (!filter)
+        return NULL;
+
+    uintptr_t start    = ((uintptr_t)(filter + 1) + BLOOM_ALIGN - 1) & ~(uintptr_t)(BLOOM_ALIGN - 1);
+    filter->blocks     = (bloom_block_t*)start;
+    filter->num_blocks = (uint32_t)blocks;
+    filter->capacity   = capacity;
+    atomic_init(&filter->count, 0);
+    memset(filter->blocks, 0, (size_t)blocks * sizeof(bloom_block_t));
+    return filter;
+}
+
+void bloom_destroy(bloom_t* filter) { free(filter); }
+
+/* Block a hash selects */
+static const bloom_block_t* block_of(const bloom_t* filter, uint64_t hash) {
+    return &filter->blocks[((hash >> 32) * filter->num_blocks) >> 32];
+}
+
+bool bloom_add(bloom_t* filter, uint64_t hash) {
+    bloom_block_t* block = (bloom_block_t*)block_of(filter, hash);
+    for (int i = 0; i < BLOOM_LANES; i++) {
+        atomic_fetch_or_explicit(&block->lanes[i], 1u << (((uint32_t)hash * lane_salt[i]) >> 27),
+                                 memory_order_relaxed);
+    }
+    return atomic_fetch_add_explicit(&filter->count, 1, memory_order_relaxed) <
+           filter->capacity;
+}
+
+bool bloom_may_contain(const bloom_t* filter, uint64_t hash) {
+    const bloom_block_t* block = block_of(filter, hash);
+
+    /* Plain copies of the lanes for the vector compare; one cache line either way */
+    _Alignas(32) uint32_t lanes[BLOOM_LANES];
+    for (int i = 0; i < BLOOM_LANES; i++)
+        lanes[i] = atomic_load_explicit(&block->lanes[i], memory_order_relaxed);
+
+#if defined(BLOOM_AVX2)
+    __m256i salt = _mm256_loadu_si256((const __m256i*)lane_salt);
+    __m256i bits = _mm256_mullo_epi32(_mm256_set1_epi32((int)(uint32_t)hash), salt);
+    __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), _mm256_srli_epi32(bits, 27));
+    return _mm256_testc_si256(_mm256_load_si256((const __m256i*)lanes), mask);
+#else
+    uint32_t mask[BLOOM_LANES];
+    for (int i = 0; i < BLOOM_LANES; i++)
+        mask[i] = 1u << (((uint32_t)hash * lane_salt[i]) >> 27);
+#if defined(BLOOM_SSE2)
+    __m128i lo = _mm_loadu_si128((const __m128i*)mask);
+    __m128i hi = _mm_loadu_si128((const __m128i*)(mask + 4));
+    __m128i eq = _mm_and_si128(
+        _mm_cmpeq_epi32(_mm_and_si128(_mm_load_si128((const __m128i*)lanes), lo), lo),
+        _mm_cmpeq_epi32(_mm_and_si128(_mm_load_si128((const __m128i*)(lanes + 4)), hi), hi));
+    return _mm_movemask_epi8(eq) == 0xFFFF;
+#else
+    for (int i = 0; i < BLOOM_LANES; i++) {
+        if ((lanes[i] & mask[i]) == 0)
+            return false;
+    }
+    return true;
+#endif
+#endif
+}
+
+size_t bloom_memory(const bloom_t* filter) {
+    return sizeof(bloom_t) + BLOOM_ALIGN + (size_t)filter->num_blocks * sizeof(bloom_block_t);
+}
@@ -0,0 +1,2088 @@
+/**
+ * @file btree.c
+ * @brief Implementation of the page-based B+tree
+ *
+ * Nodes are latched with optimistic lock coupling. Every node carries a
+ * version word in its special space. Readers never lock: they note a node's
+ * version, read it, and check the version is unchanged before trusting what
+ * they read (including the child they are about to visit); on a mismatch
+ * the operation restarts from the root. Writers lock only the nodes they
+ * change: inserts and deletes lock a single leaf, while splits and merges
+ * (structure changes) are serialized per tree and lock the nodes they touch
+ * from the bottom up.
+ *
+ * Keys are stored compressed. A node keeps the prefix all of its keys share
+ * once, in its special space, and its entries hold only the rest of each
+ * key. Leaf splits push up the shortest separator that still divides the
+ * two leaves rather than a whole key, so inner nodes fan out further.
+ * Alongside the prefix every node keeps a dense array of key heads: the
+ * first four bytes of each stored key, in slot order, as integers that
+ * order like the bytes. Searches narrow the slot range on the heads, with
+ * SIMD compares over the last few, and compare full keys only where the
+ * heads tie.
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/data/btree.h>
+#include <monodb/core/data/key.h>
+#include <monodb/core/storage/disk_manager.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define BTREE_SSE2 1
+#endif
+
+#define BTREE_MAGIC     0x42545232 /* "BTR2": nodes with prefixes and key heads */
+#define BTREE_META_PAGE 0
+
+/* Node latch word: obsolete flag, locked flag, then the version counter */
+#define LATCH_OBSOLETE 0x1u
+#define LATCH_LOCKED   0x2u
+#define LATCH_STEP     0x4u
+
+/* Spins on a locked node before yielding the processor */
+#define LATCH_SPINS 64
+
+/* Bytes of a node available to entries, their slots and heads, and the prefix */
+#define NODE_CAPACITY (PAGE_SIZE - sizeof(page_header_t) - sizeof(btree_opaque_t))
+
+/* Most entries a node can hold: empty keys and values, with their slots and heads */
+#define NODE_MAX_ENTRIES \
+    (NODE_CAPACITY / (sizeof(uint16_t) + sizeof(page_slot_t) + sizeof(uint32_t)))
+
+/* The latch is the last word of a node, so rebuilds can copy everything before it */
+#define NODE_LATCH_OFFSET (PAGE_SIZE - sizeof(btree_opaque_t) + offsetof(btree_opaque_t, latch))
+
+/* Heads a node has room for beyond its entries when it is built */
+#define HEAD_SLACK 8
+
+/* Heads a search compares with SIMD instead of bisecting them */
+#define HEAD_WINDOW 16
+
+/* A node is underfull below a quarter; siblings only merge below three quarters */
+#define MERGE_THRESHOLD (NODE_CAPACITY / 4)
+#define MERGE_LIMIT     (NODE_CAPACITY * 3 / 4)
+
+/* Largest inner node entry: key length, separator and child */
+#define INNER_ENTRY_MAX (sizeof(uint16_t) + BTREE_MAX_KEY_SIZE + sizeof(page_id_t))
+
+/* Pages one structure change can lock: three per level, plus a new root and the meta page */
+#define SMO_MAX_PAGES (BTREE_MAX_HEIGHT * 3 + 2)
+
+/* Nodes a bulk load writes before logging and releasing them together */
+#define BULK_BATCH 8
+
+/* WAL record flag: more records of the same structure change follow */
+#define WAL_BTREE_CONTINUED 0x1
+
+/* Payload limit of one WAL record (the record length field is 16 bits) */
+#define WAL_BTREE_MAX_DATA 60000
+
+/**
+ * Contents of the meta page
+ */
+typedef struct {
+    uint32_t  magic;  /* BTREE_MAGIC */
+    page_id_t root;   /* Root node */
+    uint32_t  height; /* Number of levels */
+} btree_meta_t;
+
+/**
+ * End of the special space of every node. The rest of the special space
+ * holds the key heads (head_cap of them), then the prefix, padded to four
+ * bytes.
+ */
+typedef struct {
+    page_id_t        right;      /* Right sibling on the same level, INVALID_PAGE_ID if rightmost */
+    uint16_t         level;      /* 0 for leaves */
+    uint16_t         flags;      /* Reserved */
+    uint16_t         prefix_len; /* Length of the prefix the node's keys share */
+    uint16_t         head_cap;   /* Heads the node has room for */
+    uint32_t         reserved;   /* Padding, zero */
+    _Atomic uint64_t latch;      /* Optimistic latch, see LATCH_* */
+} btree_opaque_t;
+
+/**
+ * Prefix and key heads of a node
+ */
+typedef struct {
+    uint16_t count;      /* Entries */
+    uint16_t head_cap;   /* Heads there is room for */
+    uint16_t prefix_len; /* Prefix length */
+    uint8_t* prefix;     /* Prefix of every key but the (empty) first key of an inner node */
+    uint8_t* heads;      /* Key heads, one int32_t per entry */
+} node_layout_t;
+
+/**
+ * Tree structure
+ */
+struct btree_t {
+    buffer_pool_t*    pool;              /* Buffer pool caching the nodes */
+    disk_manager_t*   file;              /* Index file */
+    char*             path;              /* Index file path, named in WAL records */
+    wal_context_t*    wal;               /* Log for structure changes, NULL if not logged */
+    sync_mutex_t      smo_lock;          /* Serializes splits and merges */
+    _Atomic page_id_t root;              /* Root node (copy of the meta page) */
+    _Atomic uint32_t  height;            /* Number of levels (copy of the meta page) */
+    _Atomic uint64_t  structure_version; /* Bumped by every split and merge */
+
+    /* Statistics */
+    _Atomic uint64_t leaf_splits;
+    _Atomic uint64_t inner_splits;
+    _Atomic uint64_t merges;
+    _Atomic uint64_t restarts;
+};
+
+/**
+ * Range scan structure
+ */
+struct btree_scan_t {
+    btree_t* tree;                    /* Tree being scanned */
+    bool     has_hi;                  /* Scan has an upper bound */
+    uint16_t hi_len;                  /* Upper bound length */
+    uint8_t  hi[BTREE_MAX_KEY_SIZE];  /* Upper bound (exclusive) */
+    bool     has_pos;                 /* pos holds a key to resume from */
+    bool     has_last;                /* pos is the last key returned, not the lower bound */
+    uint16_t pos_len;                 /* Length of pos */
+    uint8_t  pos[BTREE_MAX_KEY_SIZE]; /* Lower bound, then last key returned */
+    uint64_t version;                 /* Structure version when page_copy was taken */
+    uint16_t next_slot;               /* Next entry to return from page_copy */
+    bool     done;                    /* Scan has ended */
+    uint32_t leaves_read;             /* Leaf pages copied */
+    uint8_t  page_copy[PAGE_SIZE];    /* Current leaf */
+};
+
+/**
+ * Inner nodes visited on the way to a leaf, root first
+ */
+typedef struct {
+    uint32_t  depth;                   /* Inner nodes recorded */
+    page_id_t pages[BTREE_MAX_HEIGHT]; /* Node page numbers */
+    uint16_t  slots[BTREE_MAX_HEIGHT]; /* Slot of the child followed in each node */
+} btree_path_t;
+
+/**
+ * Pages locked by a structure change. They stay locked until the change
+ * has been logged, then are unlocked together.
+ */
+typedef struct {
+    btree_t*    tree;
+    uint32_t    count;
+    buffer_id_t bufs[SMO_MAX_PAGES];
+    bool        retired[SMO_MAX_PAGES]; /* Node left the tree; mark it obsolete */
+} smo_t;
+
+/**
+ * Entry of a node being built. Its key is the concatenation of two parts,
+ * so entries can be gathered from nodes without expanding their prefixes.
+ */
+typedef struct {
+    const uint8_t* prefix;     /* First part of the key */
+    uint16_t       prefix_len; /* Length of the first part */
+    const uint8_t* suffix;     /* Rest of the key */
+    uint16_t       suffix_len; /* Length of the rest */
+    const uint8_t* value;      /* Value */
+    uint16_t       value_len;  /* Value length */
+} node_item_t;
+
+/**
+ * Level of a bulk load: the node being filled, whose entries are kept with
+ * full keys until it is written
+ */
+typedef struct {
+    buffer_id_t buf;                           /* Node being filled (pinned) or INVALID_BUFFER */
+    page_id_t   page_id;                       /* Page of that node */
+    uint16_t    count;                         /* Entries gathered */
+    uint32_t    bytes;                         /* item_size() of the entries with whole keys */
+    uint32_t    nodes;                         /* Nodes written on this level */
+    uint16_t    sep_len;                       /* Length of sep */
+    uint8_t     sep[BTREE_MAX_KEY_SIZE];       /* Key dividing the node from its left sibling */
+    uint8_t*    entries;                       /* Full-key entries, back to back */
+    uint32_t    used;                          /* Bytes of entries */
+    uint32_t    capacity;                      /* Bytes allocated for entries */
+    uint32_t    offsets[NODE_MAX_ENTRIES + 1]; /* Start of each entry */
+} bulk_level_t;
+
+/**
+ * Bulk load structure
+ */
+struct btree_bulk_t {
+    btree_t*           tree;                     /* Tree being loaded */
+    buffer_strategy_t* strategy;                 /* Ring for the new pages */
+    uint32_t           limit;                    /* Bytes of a node the fill factor allows */
+    uint32_t           height;                   /* Levels started */
+    page_id_t          root;                     /* Root, once the top level is written */
+    bool               failed;                   /* An add failed; the load cannot finish */
+    smo_t              batch;                    /* Written nodes not yet logged */
+    bulk_level_t       levels[BTREE_MAX_HEIGHT]; /* Leaves first */
+};
+
+/**
+ * Header of a WAL_RECORD_BTREE payload, followed by the index file path
+ * and the page images
+ */
+typedef struct {
+    uint64_t lsn;       /* LSN stamped on every page of the change */
+    uint16_t flags;     /* WAL_BTREE_CONTINUED */
+    uint16_t path_len;  /* Length of the index file path */
+    uint16_t num_pages; /* Page images in this record */
+    uint16_t reserved;  /* Padding, zero */
+} btree_wal_header_t;
+
+/**
+ * Page image in a WAL record. The free space between the slot array and
+ * the entries is left out.
+ */
+typedef struct {
+    page_id_t page_id;     /* Page number */
+    uint16_t  hole_offset; /* Start of the omitted range */
+    uint16_t  hole_length; /* Length of the omitted range */
+} btree_wal_page_t;
+
+/**
+ * Redo state
+ */
+struct btree_redo_t {
+    uint8_t* data;     /* Payloads of the structure change being collected */
+    size_t   len;      /* Bytes used */
+    size_t   capacity; /* Bytes allocated */
+};
+
+/* Serializes WAL records of all trees; the log itself has no locking */
+static sync_mutex_t wal_lock = SYNC_MUTEX_INITIALIZER;
+
+/* Entries are stored as key length, key, value */
+static inline uint16_t entry_key_len(const uint8_t* entry) {
+    uint16_t len;
+    memcpy(&len, entry, sizeof(len));
+    return len;
+}
+
+static inline const uint8_t* entry_key(const uint8_t* entry) { return entry + sizeof(uint16_t); }
+
+static inline const uint8_t* entry_value(const uint8_t* entry) {
+    return entry + sizeof(uint16_t) + entry_key_len(entry);
+}
+
+static inline uint16_t entry_value_len(const uint8_t* entry, uint16_t entry_len) {
+    return (uint16_t)(entry_len - sizeof(uint16_t) - entry_key_len(entry));
+}
+
+static uint16_t make_entry(uint8_t* entry, const void* key, uint16_t key_len, const void* value,
+                           uint16_t value_len) {
+    memcpy(entry, &key_len, sizeof(key_len));
+    if (key_len > 0)
+        memcpy(entry + sizeof(uint16_t), key, key_len);
+    if (value_len > 0)
+        memcpy(entry + sizeof(uint16_t) + key_len, value, value_len);
+    return (uint16_t)(sizeof(uint16_t) + key_len + value_len);
+}
+
+/* The special space sits at a fixed offset, so it is found without trusting the header */
+static inline btree_opaque_t* node_opaque(void* page) {
+    return (btree_opaque_t*)((char*)page + PAGE_SIZE - sizeof(btree_opaque_t));
+}
+
+static inline _Atomic uint64_t* node_latch(void* page) { return &node_opaque(page)->latch; }
+
+/*
+ * Number of entries. Optimistic readers may see a node mid-change, so a
+ * header that cannot be right reads as an empty node; validation then fails.
+ */
+static inline uint16_t node_count(const void* page) {
+    uint16_t lower = ((const page_header_t*)page)->lower;
+    if (lower < sizeof(page_header_t) || lower > PAGE_SIZE - sizeof(btree_opaque_t))
+        return 0;
+    return (uint16_t)((lower - sizeof(page_header_t)) / sizeof(page_slot_t));
+}
+
+/* Entry at a slot below node_count(), or NULL if it does not lie within the node */
+static inline const uint8_t* node_entry(const void* page, uint16_t slot, uint16_t* len) {
+    page_slot_t s;
+    memcpy(&s, (const uint8_t*)page + sizeof(page_header_t) + (size_t)slot * sizeof(page_slot_t),
+           sizeof(s));
+
+    uint16_t length = s.length & PAGE_SLOT_LENGTH_MASK;
+    if (length < sizeof(uint16_t) || s.offset < sizeof(page_header_t) ||
+        (uint32_t)s.offset + length > PAGE_SIZE - sizeof(btree_opaque_t))
+        return NULL;
+
+    const uint8_t* entry = (const uint8_t*)page + s.offset;
+    if (sizeof(uint16_t) + (uint32_t)entry_key_len(entry) > length)
+        return NULL;
+    if (len)
+        *len = length;
+    return entry;
+}
+
+/* Child stored at a slot of a locked (or copied) inner node */
+static inline page_id_t inner_child(const void* page, uint16_t slot) {
+    page_id_t child;
+    memcpy(&child, entry_value(node_entry(page, slot, NULL)), sizeof(child));
+    return child;
+}
+
+/* Size of the special space of a node with a prefix and room for head_cap heads */
+static inline uint16_t node_special_size(uint16_t prefix_len, uint16_t head_cap) {
+    return (uint16_t)(sizeof(btree_opaque_t) + ((prefix_len + 3u) & ~3u) +
+                      (uint32_t)head_cap * sizeof(int32_t));
+}
+
+/* Locate the prefix and heads of a node; false if its special space cannot be right */
+static bool node_layout(const void* page, node_layout_t* layout) {
+    const btree_opaque_t* opaque =
+        (const btree_opaque_t*)((const char*)page + PAGE_SIZE - sizeof(btree_opaque_t));
+    layout->count      = node_count(page);
+    layout->head_cap   = opaque->head_cap;
+    layout->prefix_len = opaque->prefix_len;
+    bool ok = layout->prefix_len <= BTREE_MAX_KEY_SIZE && layout->head_cap <= NODE_MAX_ENTRIES &&
+              layout->count <= layout->head_cap;
+    if (!ok) {
+        /* Read as an empty node, like node_count() does */
+        layout->count      = 0;
+        layout->head_cap   = 0;
+        layout->prefix_len = 0;
+    }
+
+    uint8_t* special = (uint8_t*)page + PAGE_SIZE -
+                       node_special_size(layout->prefix_len, layout->head_cap);
+    layout->heads  = special;
+    layout->prefix = special + (size_t)layout->head_cap * sizeof(int32_t);
+    return ok;
+}
+
+/*
+ * Head of a stored key: its first four bytes big-endian, zero padded, with
+ * the sign bit flipped so that signed compares order heads like the bytes
+ */
+static inline int32_t key_head(const uint8_t* key, uint16_t len) {
+    uint32_t head = 0;
+    for (uint16_t i = 0; i < 4; i++)
+        head = (head << 8) | (i < len ? key[i] : 0u);
+    return (int32_t)(head ^ 0x80000000u);
+}
+
+static inline int32_t head_at(const uint8_t* heads, uint16_t slot) {
+    int32_t head;
+    memcpy(&head, heads + (size_t)slot * sizeof(int32_t), sizeof(head));
+    return head;
+}
+
+static inline void set_head(uint8_t* heads, uint16_t slot, int32_t head) {
+    memcpy(heads + (size_t)slot * sizeof(int32_t), &head, sizeof(head));
+}
+
+/* Number of n heads below head, or not above it with or_equal */
+static uint16_t heads_count(const uint8_t* heads, uint16_t n, int32_t head, bool or_equal) {
+    uint16_t count = 0;
+    uint16_t i     = 0;
+#ifdef BTREE_SSE2
+    static const uint8_t bits[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+    __m128i              key      = _mm_set1_epi32(head);
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(heads + (size_t)i * sizeof(int32_t)));
+        if (or_equal) {
+            int above = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, key)));
+            count     = (uint16_t)(count + 4 - bits[above]);
+        } else {
+            int below = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, key)));
+            count     = (uint16_t)(count + bits[below]);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        int32_t h = head_at(heads, i);
+        count     = (uint16_t)(count + (or_equal ? h <= head : h < head));
+    }
+    return count;
+}
+
+/*
+ * First slot in [lo, hi) whose head is >= head, or > head with or_equal.
+ * Heads are in slot order, so bisection narrows the range to a window
+ * that is then counted with SIMD compares.
+ */
+static uint16_t heads_search(const uint8_t* heads, uint16_t lo, uint16_t hi, int32_t head,
+                             bool or_equal) {
+    while (hi - lo > HEAD_WINDOW) {
+        uint16_t mid = (uint16_t)((lo + hi) / 2);
+        int32_t  h   = head_at(heads, mid);
+        if (or_equal ? h <= head : h < head)
+            lo = (uint16_t)(mid + 1);
+        else
+            hi = mid;
+    }
+    return (uint16_t)(lo + heads_count(heads + (size_t)lo * sizeof(int32_t),
+                                       (uint16_t)(hi - lo), head, or_equal));
+}
+
+/* Bytes taken by the entries of a locked node, their slots and heads, and the prefix */
+static uint32_t node_used(const void* page) {
+    node_layout_t layout;
+    node_layout(page, &layout);
+    uint32_t used =
+        layout.prefix_len + (uint32_t)layout.count * (sizeof(page_slot_t) + sizeof(int32_t));
+    for (uint16_t i = 0; i < layout.count; i++) {
+        uint16_t len = 0;
+        node_entry(page, i, &len);
+        used += len;
+    }
+    return used;
+}
+
+/*
+ * First slot from first on whose key is >= key, or > key with upper set;
+ * sets *found on an exact match. A key outside the node prefix sorts
+ * before or after every entry. Otherwise the heads narrow the range, and
+ * only entries whose head equals the key's are compared in full.
+ * Returns false if the node turned out to be inconsistent.
+ */
+static bool node_search(const void* page, const void* key, uint16_t key_len, uint16_t first,
+                        bool upper, uint16_t* slot, bool* found) {
+    node_layout_t layout;
+    if (found)
+        *found = false;
+    if (!node_layout(page, &layout) || first > layout.count)
+        return false;
+
+    const uint8_t* k   = (const uint8_t*)key;
+    uint16_t       n   = key_len < layout.prefix_len ? key_len : layout.prefix_len;
+    int            cmp = n > 0 ? memcmp(k, layout.prefix, n) : 0;
+    if (cmp == 0 && key_len < layout.prefix_len)
+        cmp = -1;
+    if (cmp != 0) {
+        *slot = cmp < 0 ? first : layout.count;
+        return true;
+    }
+
+    const uint8_t* suffix     = k + layout.prefix_len;
+    uint16_t       suffix_len = (uint16_t)(key_len - layout.prefix_len);
+    int32_t        head       = key_head(suffix, suffix_len);
+    uint16_t       lo         = heads_search(layout.heads, first, layout.count, head, false);
+    uint16_t       hi         = heads_search(layout.heads, lo, layout.count, head, true);
+
+    while (lo < hi) {
+        uint16_t       mid   = (uint16_t)((lo + hi) / 2);
+        const uint8_t* entry = node_entry(page, mid, NULL);
+        if (!entry)
+            return false;
+        cmp = key_compare(entry_key(entry), entry_key_len(entry), suffix, suffix_len);
+        if (upper ? cmp <= 0 : cmp < 0)
+            lo = (uint16_t)(mid + 1);
+        else
+            hi = mid;
+    }
+
+    if (found && !upper && lo < layout.count) {
+        const uint8_t* entry = node_entry(page, lo, NULL);
+        if (!entry)
+            return false;
+        *found = key_compare(entry_key(entry), entry_key_len(entry), suffix, suffix_len) == 0;
+    }
+    *slot = lo;
+    return true;
+}
+
+/* First slot whose key is >= key (leaves); sets *found on an exact match */
+static inline bool leaf_lower_bound(const void* page, const void* key, uint16_t key_len,
+                                    uint16_t* slot, bool* found) {
+    return node_search(page, key, key_len, 0, false, slot, found);
+}
+
+/* First slot whose key is > key; slot 0 of an inner node is minus infinity */
+static inline bool upper_bound(const void* page, const void* key, uint16_t key_len,
+                               uint16_t first, uint16_t* slot) {
+    return node_search(page, key, key_len, first, true, slot, NULL);
+}
+
+/* Child of an inner node covering key and its slot; NULL key means the leftmost child */
+static bool inner_search(const void* page, const void* key, uint16_t key_len, uint16_t* slot,
+                         page_id_t* child) {
+    uint16_t s = 0;
+    if (node_count(page) == 0)
+        return false;
+    if (key) {
+        if (!upper_bound(page, key, key_len, 1, &s))
+            return false;
+        s--;
+    }
+
+    uint16_t       len;
+    const uint8_t* entry = node_entry(page, s, &len);
+    if (!entry || entry_value_len(entry, len) != sizeof(page_id_t))
+        return false;
+    memcpy(child, entry_value(entry), sizeof(*child));
+    *slot = s;
+    return true;
+}
+
+/* Wait for a node to be unlocked and note its version; false if it has left the tree */
+static bool latch_read(void* page, uint64_t* version) {
+    _Atomic uint64_t* latch = node_latch(page);
+    uint64_t          v     = atomic_load_explicit(latch, memory_order_acquire);
+
+    for (uint32_t spins = 0; v & LATCH_LOCKED; spins++) {
+        if (spins >= LATCH_SPINS)
+            sync_yield();
+        v = atomic_load_explicit(latch, memory_order_acquire);
+    }
+    if (v & LATCH_OBSOLETE)
+        return false;
+    *version = v;
+    return true;
+}
+
+/* Check that a node has not changed since latch_read() */
+static inline bool latch_validate(void* page, uint64_t version) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(node_latch(page), memory_order_relaxed) == version;
+}
+
+/*
+ * Lock a pinned node for writing. Every holder of a latch also holds the
+ * buffer's content lock exclusively, so once that is taken the latch is free.
+ */
+static void latch_lock(btree_t* tree, buffer_id_t buf) {
+    buffer_lock(tree->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+    atomic_fetch_or(node_latch(buffer_page(tree->pool, buf)), LATCH_LOCKED);
+    atomic_thread_fence(memory_order_release);
+}
+
+/* Unlock a node, bumping its version if it was changed */
+static void latch_unlock(btree_t* tree, buffer_id_t buf, bool changed) {
+    _Atomic uint64_t* latch = node_latch(buffer_page(tree->pool, buf));
+    if (changed) {
+        buffer_mark_dirty(tree->pool, buf);
+        atomic_fetch_add_explicit(latch, LATCH_STEP - LATCH_LOCKED, memory_order_release);
+    } else {
+        atomic_fetch_and_explicit(latch, ~(uint64_t)LATCH_LOCKED, memory_order_release);
+    }
+    buffer_unlock(tree->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+}
+
+/* Lock a node only if it is still at the version an optimistic read noted */
+static bool latch_upgrade(btree_t* tree, buffer_id_t buf, uint64_t version) {
+    latch_lock(tree, buf);
+    uint64_t v = atomic_load(node_latch(buffer_page(tree->pool, buf)));
+    if ((v & ~(uint64_t)LATCH_LOCKED) == version)
+        return true;
+    latch_unlock(tree, buf, false);
+    return false;
+}
+
+/*
+ * Walk from the root to the leaf covering key without locking. A child is
+ * only visited once the parent's version confirms the child pointer was read
+ * from a consistent node. Inner nodes on the way are recorded in path when it
+ * is not NULL. Returns the pinned leaf and the version it was read at.
+ */
+static buffer_id_t descend(btree_t* tree, const void* key, uint16_t key_len, btree_path_t* path,
+                           uint64_t* version) {
+    for (;;) {
+        page_id_t   page_id = atomic_load(&tree->root);
+        buffer_id_t buf     = buffer_read(tree->pool, tree->file, page_id, NULL);
+        if (buf < 0)
+            return INVALID_BUFFER;
+
+        void*    page  = buffer_page(tree->pool, buf);
+        uint64_t v     = 0;
+        uint32_t depth = 0;
+        bool     ok    = latch_read(page, &v) && atomic_load(&tree->root) == page_id;
+
+        while (ok && node_opaque(page)->level > 0) {
+            uint16_t  slot;
+            page_id_t child;
+            ok = depth < BTREE_MAX_HEIGHT && inner_search(page, key, key_len, &slot, &child) &&
+                 latch_validate(page, v);
+            if (!ok)
+                break;
+
+            if (path) {
+                path->pages[depth] = page_id;
+                path->slots[depth] = slot;
+            }
+            depth++;
+
+            buffer_id_t child_buf = buffer_read(tree->pool, tree->file, child, NULL);
+            if (child_buf < 0) {
+                buffer_release(tree->pool, buf);
+                return INVALID_BUFFER;
+            }
+
+            void*    child_page = buffer_page(tree->pool, child_buf);
+            uint64_t child_v    = 0;
+            ok = latch_read(child_page, &child_v) && latch_validate(page, v);
+            buffer_release(tree->pool, buf);
+            buf     = child_buf;
+            page    = child_page;
+            page_id = child;
+            v       = child_v;
+        }
+
+        if (ok && latch_validate(page, v)) {
+            if (path)
+                path->depth = depth;
+            *version = v;
+            return buf;
+        }
+        buffer_release(tree->pool, buf);
+        atomic_fetch_add(&tree->restarts, 1);
+    }
+}
+
+static inline uint16_t item_key_len(const node_item_t* item) {
+    return (uint16_t)(item->prefix_len + item->suffix_len);
+}
+
+static inline uint8_t item_key_byte(const node_item_t* item, uint16_t i) {
+    return i < item->prefix_len ? item->prefix[i] : item->suffix[i - item->prefix_len];
+}
+
+static inline uint32_t item_size(const node_item_t* item) {
+    return sizeof(uint16_t) + item_key_len(item) + item->value_len + sizeof(page_slot_t) +
+           sizeof(int32_t);
+}
+
+/* Copy len bytes of an item's key, starting at byte from */
+static void item_copy_key(const node_item_t* item, uint16_t from, uint16_t len, uint8_t* out) {
+    for (; len > 0 && from < item->prefix_len; len--)
+        *out++ = item->prefix[from++];
+    if (len > 0)
+        memcpy(out, item->suffix + (from - item->prefix_len), len);
+}
+
+/* Item of an entry in full-key form (key length, key, value) */
+static node_item_t full_item(const uint8_t* entry, uint16_t entry_len) {
+    return (node_item_t){NULL,
+                         0,
+                         entry_key(entry),
+                         entry_key_len(entry),
+                         entry_value(entry),
+                         entry_value_len(entry, entry_len)};
+}
+
+/*
+ * Gather the entries of a locked node as items, in slot order. No entry
+ * goes to items[gap], which is left for the caller to fill.
+ */
+static uint16_t node_items(const void* page, node_item_t* items, uint16_t gap) {
+    node_layout_t layout;
+    node_layout(page, &layout);
+    bool inner = node_opaque((void*)page)->level > 0;
+
+    for (uint16_t i = 0, n = 0; i < layout.count; i++, n++) {
+        if (n == gap)
+            n++;
+        uint16_t       len   = 0;
+        const uint8_t* entry = node_entry(page, i, &len);
+        /* The first key of an inner node is empty and does not take the prefix */
+        items[n] = (node_item_t){layout.prefix,
+                                 inner && i == 0 ? 0 : layout.prefix_len,
+                                 entry_key(entry),
+                                 entry_key_len(entry),
+                                 entry_value(entry),
+                                 entry_value_len(entry, len)};
+    }
+    return layout.count;
+}
+
+/*
+ * Build a node from items in a scratch (or new) page. The prefix is what
+ * the first and last keys share, leaving out the empty first key of an
+ * inner node; every key that sorts between them shares it too. Returns
+ * false if the items do not fit.
+ */
+static bool node_build(void* page, page_id_t page_id, uint16_t level, page_id_t right,
+                       const node_item_t* items, uint16_t count) {
+    uint16_t first      = level > 0 ? 1 : 0;
+    uint16_t prefix_len = 0;
+    if (count > first) {
+        const node_item_t* lo  = &items[first];
+        const node_item_t* hi  = &items[count - 1];
+        uint16_t           max = item_key_len(lo) < item_key_len(hi) ? item_key_len(lo)
+                                                                      : item_key_len(hi);
+        while (prefix_len < max && item_key_byte(lo, prefix_len) == item_key_byte(hi, prefix_len))
+            prefix_len++;
+    }
+
+    /* Room for more heads than entries, so that inserts rarely rebuild the node */
+    uint32_t head_cap = (uint32_t)count + HEAD_SLACK + count / 4;
+    if (head_cap > NODE_MAX_ENTRIES)
+        head_cap = NODE_MAX_ENTRIES;
+    if (count > head_cap)
+        return false;
+
+    page_init(page, page_id, PAGE_TYPE_BTREE, node_special_size(prefix_len, (uint16_t)head_cap));
+    btree_opaque_t* opaque = node_opaque(page);
+    atomic_init(&opaque->latch, 0);
+    opaque->right      = right;
+    opaque->level      = level;
+    opaque->flags      = 0;
+    opaque->prefix_len = prefix_len;
+    opaque->head_cap   = (uint16_t)head_cap;
+    opaque->reserved   = 0;
+
+    node_layout_t layout;
+    node_layout(page, &layout);
+    if (prefix_len > 0)
+        item_copy_key(&items[first], 0, prefix_len, layout.prefix);
+
+    uint8_t entry[sizeof(uint16_t) + BTREE_MAX_ENTRY_SIZE];
+    for (uint16_t i = 0; i < count; i++) {
+        const node_item_t* item    = &items[i];
+        uint16_t           from    = i < first ? 0 : prefix_len;
+        uint16_t           key_len = (uint16_t)(item_key_len(item) - from);
+        uint16_t           len     = (uint16_t)(sizeof(uint16_t) + key_len + item->value_len);
+
+        memcpy(entry, &key_len, sizeof(key_len));
+        item_copy_key(item, from, key_len, entry + sizeof(uint16_t));
+        if (item->value_len > 0)
+            memcpy(entry + sizeof(uint16_t) + key_len, item->value, item->value_len);
+        if (!page_insert_item_at(page, i, entry, len))
+            return false;
+        set_head(layout.heads, i, key_head(entry + sizeof(uint16_t), key_len));
+    }
+    return true;
+}
+
+/*
+ * Replace a locked node with one built in a scratch page. Initializing the
+ * node in place would reset its latch under optimistic readers, so all but
+ * the latch is copied; the node keeps its LSN.
+ */
+static void node_install(void* page, void* scratch) {
+    page_header(scratch)->lsn = page_header(page)->lsn;
+    memcpy(page, scratch, NODE_LATCH_OFFSET);
+}
+
+/* Insert an item, compacting the node first if its free space is fragmented */
+static bool insert_item(void* page, uint16_t slot, const void* item, uint16_t len) {
+    if (page_insert_item_at(page, slot, item, len))
+        return true;
+    page_compact(page);
+    return page_insert_item_at(page, slot, item, len);
+}
+
+/* Insert an entry already stripped of the node prefix, keeping its head in slot order */
+static bool node_insert_stored(void* page, uint16_t slot, const uint8_t* entry, uint16_t len) {
+    node_layout_t layout;
+    node_layout(page, &layout);
+    if (layout.count >= layout.head_cap || !insert_item(page, slot, entry, len))
+        return false;
+
+    memmove(layout.heads + (size_t)(slot + 1) * sizeof(int32_t),
+            layout.heads + (size_t)slot * sizeof(int32_t),
+            (size_t)(layout.count - slot) * sizeof(int32_t));
+    set_head(layout.heads, slot, key_head(entry_key(entry), entry_key_len(entry)));
+    return true;
+}
+
+/* Remove the entry at a slot of a locked node, with its head */
+static void node_remove(void* page, uint16_t slot) {
+    node_layout_t layout;
+    node_layout(page, &layout);
+    page_remove_item_at(page, slot);
+    memmove(layout.heads + (size_t)slot * sizeof(int32_t),
+            layout.heads + (size_t)(slot + 1) * sizeof(int32_t),
+            (size_t)(layout.count - slot - 1) * sizeof(int32_t));
+}
+
+/*
+ * Insert a full-key entry at a slot of a locked node. The entry is stored
+ * without the node prefix. A key that does not share the prefix, or a
+ * node out of room for heads, has the node rebuilt around the entry.
+ * Returns false if the entry does not fit.
+ */
+static bool node_put(void* page, uint16_t slot, const uint8_t* entry, uint16_t entry_len) {
+    node_layout_t layout;
+    node_layout(page, &layout);
+
+    uint16_t key_len = entry_key_len(entry);
+    if (layout.count < layout.head_cap && key_len >= layout.prefix_len &&
+        memcmp(entry_key(entry), layout.prefix, layout.prefix_len) == 0) {
+        uint8_t  stored[sizeof(uint16_t) + BTREE_MAX_ENTRY_SIZE];
+        uint16_t len = make_entry(stored, entry_key(entry) + layout.prefix_len,
+                                  (uint16_t)(key_len - layout.prefix_len), entry_value(entry),
+                                  entry_value_len(entry, entry_len));
+        return node_insert_stored(page, slot, stored, len);
+    }
+
+    node_item_t     items[NODE_MAX_ENTRIES + 1];
+    uint8_t         scratch[PAGE_SIZE];
+    btree_opaque_t* opaque = node_opaque(page);
+    uint16_t        count  = node_items(page, items, slot);
+    items[slot]            = full_item(entry, entry_len);
+    if (!node_build(scratch, page_header(page)->page_id, opaque->level, opaque->right, items,
+                    (uint16_t)(count + 1)))
+        return false;
+    node_install(page, scratch);
+    return true;
+}
+
+/*
+ * Insert or replace an entry in a locked leaf. Sets *full, leaving the
+ * leaf's entries as they were, when the entry does not fit.
+ */
+static bool put_entry(void* page, const void* key, uint16_t key_len, const uint8_t* entry,
+                      uint16_t entry_len, bool replace, bool* full) {
+    uint16_t slot  = 0;
+    bool     found = false;
+    leaf_lower_bound(page, key, key_len, &slot, &found);
+    *full = false;
+    if (found != replace)
+        return false;
+
+    uint8_t  old[sizeof(uint16_t) + BTREE_MAX_ENTRY_SIZE];
+    uint16_t old_len = 0;
+    if (found) {
+        const uint8_t* existing = node_entry(page, slot, &old_len);
+        memcpy(old, existing, old_len);
+        node_remove(page, slot);
+    }
+    if (node_put(page, slot, entry, entry_len))
+        return true;
+
+    if (found)
+        node_insert_stored(page, slot, old, old_len);
+    *full = true;
+    return false;
+}
+
+/* Add a locked page to a structure change */
+static void smo_add(smo_t* smo, buffer_id_t buf) {
+    smo->retired[smo->count] = false;
+    smo->bufs[smo->count++]  = buf;
+}
+
+/* Pin and lock a node for a structure change, unless the change holds it already */
+static buffer_id_t smo_lock_node(smo_t* smo, page_id_t page_id) {
+    btree_t* tree = smo->tree;
+    for (uint32_t i = 0; i < smo->count; i++) {
+        if (buffer_page_id(tree->pool, smo->bufs[i]) == page_id)
+            return smo->bufs[i];
+    }
+    if (smo->count >= SMO_MAX_PAGES)
+        return INVALID_BUFFER;
+
+    buffer_id_t buf = buffer_read(tree->pool, tree->file, page_id, NULL);
+    if (buf < 0)
+        return INVALID_BUFFER;
+    latch_lock(tree, buf);
+    smo_add(smo, buf);
+    return buf;
+}
+
+/* Mark a node of a structure change as removed from the tree */
+static void smo_retire(smo_t* smo, buffer_id_t buf) {
+    for (uint32_t i = 0; i < smo->count; i++) {
+        if (smo->bufs[i] == buf)
+            smo->retired[i] = true;
+    }
+}
+
+/* Point the meta page, then new descents, at a new root */
+static bool smo_set_root(smo_t* smo, page_id_t root, uint32_t height) {
+    btree_t*    tree = smo->tree;
+    buffer_id_t buf  = buffer_read(tree->pool, tree->file, BTREE_META_PAGE, NULL);
+    if (buf < 0)
+        return false;
+
+    buffer_lock(tree->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+    smo_add(smo, buf);
+    btree_meta_t meta = {BTREE_MAGIC, root, height};
+    memcpy((char*)buffer_page(tree->pool, buf) + sizeof(page_header_t), &meta, sizeof(meta));
+
+    atomic_store(&tree->root, root);
+    atomic_store(&tree->height, height);
+    return true;
+}
+
+/* Part of a page a WAL image leaves out: the free space of a node, nothing otherwise */
+static void page_hole(void* page, uint16_t* offset, uint16_t* length) {
+    const page_header_t* hdr = page_header(page);
+    *offset                  = 0;
+    *length                  = 0;
+    if (hdr->type == PAGE_TYPE_BTREE && hdr->lower >= sizeof(page_header_t) &&
+        hdr->lower <= hdr->upper && hdr->upper <= PAGE_SIZE) {
+        *offset = hdr->lower;
+        *length = (uint16_t)(hdr->upper - hdr->lower);
+    }
+}
+
+/*
+ * Log full images of the pages of a structure change, all stamped with one
+ * LSN. A change too large for one record continues in the next ones; redo
+ * only applies it once the last record is seen.
+ */
+static bool smo_log(smo_t* smo) {
+    btree_t* tree = smo->tree;
+    if (!tree->wal)
+        return true;
+
+    uint16_t path_len = (uint16_t)strlen(tree->path);
+    sync_mutex_lock(&wal_lock);
+
+    wal_location_t last = wal_last_location(tree->wal);
+    uint64_t       lsn  = (((uint64_t)last.segment << 32) | last.offset) + 1;
+    bool           ok   = true;
+
+    for (uint32_t next = 0; ok && next < smo->count;) {
+        uint32_t size = sizeof(btree_wal_header_t) + path_len;
+        uint32_t end  = next;
+        while (end < smo->count) {
+            uint16_t hole_offset, hole_length;
+            page_hole(buffer_page(tree->pool, smo->bufs[end]), &hole_offset, &hole_length);
+            uint32_t image = sizeof(btree_wal_page_t) + PAGE_SIZE - hole_length;
+            if (end > next && size + image > WAL_BTREE_MAX_DATA)
+                break;
+            size += image;
+            end++;
+        }
+
+        uint8_t* data = (uint8_t*)wal_begin_record(tree->wal, WAL_RECORD_BTREE, 0, (uint16_t)size);
+        if (!data) {
+            ok = false;
+            break;
+        }
+
+        btree_wal_header_t header = {lsn, end < smo->count ? WAL_BTREE_CONTINUED : 0, path_len,
+                                     (uint16_t)(end - next), 0};
+        memcpy(data, &header, sizeof(header));
+        memcpy(data + sizeof(header), tree->path, path_len);
+        data += sizeof(header) + path_len;
+
+        for (; next < end; next++) {
+            void*            page = buffer_page(tree->pool, smo->bufs[next]);
+            btree_wal_page_t image;
+            page_header(page)->lsn = lsn;
+            image.page_id          = buffer_page_id(tree->pool, smo->bufs[next]);
+            page_hole(page, &image.hole_offset, &image.hole_length);
+
+            uint16_t tail = (uint16_t)(image.hole_offset + image.hole_length);
+            memcpy(data, &image, sizeof(image));
+            data += sizeof(image);
+            memcpy(data, page, image.hole_offset);
+            memcpy(data + image.hole_offset, (char*)page + tail, PAGE_SIZE - tail);
+
+            /* The image must not come back locked */
+            if (page_header(page)->type == PAGE_TYPE_BTREE) {
+                uint8_t* latch = data + NODE_LATCH_OFFSET - image.hole_length;
+                uint64_t v;
+                memcpy(&v, latch, sizeof(v));
+                v &= ~(uint64_t)LATCH_LOCKED;
+                memcpy(latch, &v, sizeof(v));
+            }
+            data += PAGE_SIZE - image.hole_length;
+        }
+        ok = wal_end_record(tree->wal, NULL);
+    }
+
+    sync_mutex_unlock(&wal_lock);
+    return ok;
+}
+
+/*
+ * End a structure change: log its pages if anything changed, then unlock
+ * and release them. Retired nodes are marked obsolete so optimistic readers
+ * that reached them restart; their pages are never reused.
+ */
+static bool smo_finish(smo_t* smo, bool changed) {
+    btree_t* tree = smo->tree;
+    bool     ok   = !changed || smo_log(smo);
+
+    for (uint32_t i = 0; i < smo->count; i++) {
+        buffer_id_t buf  = smo->bufs[i];
+        void*       page = buffer_page(tree->pool, buf);
+        if (page_header(page)->type == PAGE_TYPE_BTREE) {
+            if (smo->retired[i])
+                atomic_fetch_or(node_latch(page), LATCH_OBSOLETE);
+            latch_unlock(tree, buf, changed);
+        } else {
+            if (changed)
+                buffer_mark_dirty(tree->pool, buf);
+            buffer_unlock(tree->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+        }
+        buffer_release(tree->pool, buf);
+    }
+    smo->count = 0;
+    return ok;
+}
+
+/* Shortest key that sorts after left and not after right (suffix truncation) */
+static uint16_t shortest_separator(const node_item_t* left, const node_item_t* right,
+                                   uint8_t* sep) {
+    uint16_t left_len  = item_key_len(left);
+    uint16_t right_len = item_key_len(right);
+    uint16_t common    = 0;
+    while (common < left_len && common < right_len &&
+           item_key_byte(left, common) == item_key_byte(right, common))
+        common++;
+
+    /* The first byte where right differs from left, or its first byte past the end of left */
+    uint16_t len = common < right_len ? (uint16_t)(common + 1) : right_len;
+    item_copy_key(right, 0, len, sep);
+    return len;
+}
+
+/* Build both halves of a node split before item split */
+static bool split_build(node_item_t* items, uint16_t count, uint16_t split, uint16_t level,
+                        page_id_t page_id, page_id_t right, uint8_t* left_page,
+                        uint8_t* right_page) {
+    if (!node_build(left_page, page_id, level, INVALID_PAGE_ID, items, split))
+        return false;
+
+    /* The first key of an inner node is never compared: store it empty */
+    node_item_t first = items[split];
+    if (level > 0) {
+        items[split].prefix_len = 0;
+        items[split].suffix_len = 0;
+    }
+    bool ok = node_build(right_page, INVALID_PAGE_ID, level, right, &items[split],
+                         (uint16_t)(count - split));
+    items[split] = first;
+    return ok;
+}
+
+/*
+ * Split a full locked node while inserting entry at slot. The left half
+ * stays in place, the right half moves to a new right sibling, which joins
+ * the change locked. The separator is stored in sep: for leaves the
+ * shortest key between the halves, for inner nodes the first key of the
+ * right node.
+ */
+static bool split_node(smo_t* smo, buffer_id_t buf, uint16_t slot, const uint8_t* entry,
+                       uint16_t entry_len, uint8_t* sep, uint16_t* sep_len, page_id_t* right_id) {
+    btree_t*        tree   = smo->tree;
+    void*           page   = buffer_page(tree->pool, buf);
+    btree_opaque_t* opaque = node_opaque(page);
+    uint16_t        level  = opaque->level;
+    node_item_t     items[NODE_MAX_ENTRIES + 1];
+    uint8_t         left[PAGE_SIZE];
+    uint8_t         right[PAGE_SIZE];
+    uint32_t        total = 0;
+
+    if (smo->count >= SMO_MAX_PAGES)
+        return false;
+
+    uint16_t count = (uint16_t)(node_items(page, items, slot) + 1);
+    items[slot]    = full_item(entry, entry_len);
+    for (uint16_t n = 0; n < count; n++)
+        total += item_size(&items[n]);
+
+    /*
+     * Split by bytes, keeping at least one entry on each side. Entries grow
+     * when a half gets a shorter prefix than the node had, which happens
+     * when the new key does not share it; it then sorts first or last, and
+     * splitting right next to it keeps the other half's prefix.
+     */
+    uint16_t balanced = 0;
+    uint32_t bytes    = 0;
+    while (balanced < count - 1 && bytes + item_size(&items[balanced]) <= total / 2)
+        bytes += item_size(&items[balanced++]);
+    if (balanced == 0)
+        balanced = 1;
+
+    uint16_t candidates[] = {balanced, slot, (uint16_t)(slot + 1)};
+    uint16_t split        = 0;
+    for (size_t c = 0; c < sizeof(candidates) / sizeof(candidates[0]) && split == 0; c++) {
+        if (candidates[c] > 0 && candidates[c] < count &&
+            split_build(items, count, candidates[c], level, buffer_page_id(tree->pool, buf),
+                        opaque->right, left, right))
+            split = candidates[c];
+    }
+    if (split == 0)
+        return false;
+
+    if (level == 0) {
+        *sep_len = shortest_separator(&items[split - 1], &items[split], sep);
+    } else {
+        *sep_len = item_key_len(&items[split]);
+        item_copy_key(&items[split], 0, *sep_len, sep);
+    }
+
+    buffer_id_t right_buf = buffer_extend(tree->pool, tree->file, NULL, right_id);
+    if (right_buf < 0)
+        return false;
+
+    /* The new node is unreachable until the change is done, but joins it locked */
+    page_header(right)->page_id = *right_id;
+    memcpy(buffer_page(tree->pool, right_buf), right, PAGE_SIZE);
+    latch_lock(tree, right_buf);
+    smo_add(smo, right_buf);
+
+    node_opaque(left)->right = *right_id;
+    node_install(page, left);
+
+    atomic_fetch_add(&tree->structure_version, 1);
+    atomic_fetch_add(level == 0 ? &tree->leaf_splits : &tree->inner_splits, 1);
+    return true;
+}
+
+/* Grow the tree by one level after the root split */
+static bool new_root(smo_t* smo, const uint8_t* sep, uint16_t sep_len, page_id_t right_id) {
+    btree_t*    tree     = smo->tree;
+    page_id_t   old_root = atomic_load(&tree->root);
+    uint32_t    height   = atomic_load(&tree->height);
+    page_id_t   root_id;
+    buffer_id_t buf = buffer_extend(tree->pool, tree->file, NULL, &root_id);
+    if (buf < 0)
+        return false;
+
+    node_item_t items[] = {
+        {NULL, 0, NULL, 0, (const uint8_t*)&old_root, sizeof(page_id_t)},
+        {NULL, 0, sep, sep_len, (const uint8_t*)&right_id, sizeof(page_id_t)},
+    };
+    node_build(buffer_page(tree->pool, buf), root_id, (uint16_t)height, INVALID_PAGE_ID, items, 2);
+    latch_lock(tree, buf);
+    smo_add(smo, buf);
+
+    return smo_set_root(smo, root_id, height + 1);
+}
+
+/*
+ * Insert or replace an entry whose leaf is full. Runs as a structure change:
+ * the leaf splits, and each parent that cannot absorb the new separator
+ * splits in turn.
+ */
+static bool split_insert(btree_t* tree, const void* key, uint16_t key_len, const uint8_t* entry,
+                         uint16_t entry_len, bool replace) {
+    sync_mutex_lock(&tree->smo_lock);
+
+    btree_path_t path;
+    uint64_t     version;
+    buffer_id_t  buf;
+    for (;;) {
+        buf = descend(tree, key, key_len, &path, &version);
+        if (buf < 0) {
+            sync_mutex_unlock(&tree->smo_lock);
+            return false;
+        }
+        if (latch_upgrade(tree, buf, version))
+            break;
+        buffer_release(tree->pool, buf);
+        atomic_fetch_add(&tree->restarts, 1);
+    }
+
+    /* The leaf may have changed since it was found full */
+    void* page = buffer_page(tree->pool, buf);
+    bool  full;
+    bool  ok = put_entry(page, key, key_len, entry, entry_len, replace, &full);
+    if (ok || !full) {
+        latch_unlock(tree, buf, ok);
+        buffer_release(tree->pool, buf);
+        sync_mutex_unlock(&tree->smo_lock);
+        return ok;
+    }
+
+    smo_t smo = {tree, 0, {0}, {0}};
+    smo_add(&smo, buf);
+
+    uint16_t slot;
+    leaf_lower_bound(page, key, key_len, &slot, NULL);
+    if (replace)
+        node_remove(page, slot);
+
+    /* Push separators up until a node absorbs one without splitting */
+    uint8_t        sep[BTREE_MAX_KEY_SIZE];
+    uint8_t        parent_entry[INNER_ENTRY_MAX];
+    uint16_t       sep_len;
+    page_id_t      right_id;
+    const uint8_t* cur     = entry;
+    uint16_t       cur_len = entry_len;
+    uint32_t       depth   = path.depth;
+    for (;;) {
+        ok = split_node(&smo, buf, slot, cur, cur_len, sep, &sep_len, &right_id);
+        if (!ok)
+            break;
+        if (depth == 0) {
+            ok = new_root(&smo, sep, sep_len, right_id);
+            break;
+        }
+
+        depth--;
+        buf = smo_lock_node(&smo, path.pages[depth]);
+        if (buf < 0) {
+            ok = false;
+            break;
+        }
+        cur_len = make_entry(parent_entry, sep, sep_len, &right_id, sizeof(page_id_t));
+        cur     = parent_entry;
+        slot    = (uint16_t)(path.slots[depth] + 1);
+        if (node_put(buffer_page(tree->pool, buf), slot, cur, cur_len))
+            break;
+    }
+
+    ok = smo_finish(&smo, true) && ok;
+    sync_mutex_unlock(&tree->smo_lock);
+    return ok;
+}
+
+/*
+ * Merge child left + 1 of a locked parent into child left, if the two fit
+ * comfortably in one node. The right child leaves the tree.
+ */
+static bool merge_children(smo_t* smo, buffer_id_t parent, uint16_t left) {
+    btree_t* tree        = smo->tree;
+    void*    parent_page = buffer_page(tree->pool, parent);
+
+    buffer_id_t left_buf  = smo_lock_node(smo, inner_child(parent_page, left));
+    buffer_id_t right_buf = left_buf >= 0
+                                ? smo_lock_node(smo, inner_child(parent_page, (uint16_t)(left + 1)))
+                                : INVALID_BUFFER;
+    if (right_buf < 0)
+        return false;
+
+    void*       left_page  = buffer_page(tree->pool, left_buf);
+    void*       right_page = buffer_page(tree->pool, right_buf);
+    uint16_t    level      = node_opaque(left_page)->level;
+    node_item_t items[NODE_MAX_ENTRIES];
+    uint8_t     scratch[PAGE_SIZE];
+    if ((uint32_t)node_count(left_page) + node_count(right_page) > NODE_MAX_ENTRIES)
+        return false;
+
+    uint16_t count = node_items(left_page, items, UINT16_MAX);
+    uint16_t pos   = count;
+    count          = (uint16_t)(count + node_items(right_page, &items[pos], UINT16_MAX));
+    if (level > 0) {
+        /* Inner nodes take the separator down as the key of the right node's first child */
+        node_layout_t  parent_layout;
+        const uint8_t* sep = node_entry(parent_page, (uint16_t)(left + 1), NULL);
+        node_layout(parent_page, &parent_layout);
+        items[pos].prefix     = parent_layout.prefix;
+        items[pos].prefix_len = parent_layout.prefix_len;
+        items[pos].suffix     = entry_key(sep);
+        items[pos].suffix_len = entry_key_len(sep);
+    }
+
+    if (!node_build(scratch, buffer_page_id(tree->pool, left_buf), level,
+                    node_opaque(right_page)->right, items, count) ||
+        node_used(scratch) > MERGE_LIMIT)
+        return false;
+    node_install(left_page, scratch);
+
+    node_remove(parent_page, (uint16_t)(left + 1));
+    smo_retire(smo, right_buf);
+
+    atomic_fetch_add(&tree->structure_version, 1);
+    atomic_fetch_add(&tree->merges, 1);
+    return true;
+}
+
+/*
+ * Merge the leaf covering key with a sibling under the same parent, then
+ * keep merging up the tree while parents become underfull. A root left
+ * with a single child is replaced by that child.
+ */
+static void merge_leaf(btree_t* tree, const void* key, uint16_t key_len) {
+    sync_mutex_lock(&tree->smo_lock);
+
+    /* Inner nodes only change under smo_lock, so the path stays valid */
+    btree_path_t path;
+    uint64_t     version;
+    buffer_id_t  leaf = descend(tree, key, key_len, &path, &version);
+    if (leaf < 0) {
+        sync_mutex_unlock(&tree->smo_lock);
+        return;
+    }
+    buffer_release(tree->pool, leaf);
+
+    smo_t smo     = {tree, 0, {0}, {0}};
+    bool  changed = false;
+    for (uint32_t depth = path.depth; depth > 0; depth--) {
+        buffer_id_t parent = smo_lock_node(&smo, path.pages[depth - 1]);
+        if (parent < 0)
+            break;
+
+        void*    page  = buffer_page(tree->pool, parent);
+        uint16_t count = node_count(page);
+        uint16_t slot  = path.slots[depth - 1];
+        if (count < 2 || !merge_children(&smo, parent, slot + 1 < count ? slot : slot - 1))
+            break;
+        changed = true;
+
+        if (depth == 1) {
+            if (node_count(page) == 1) {
+                smo_retire(&smo, parent);
+                smo_set_root(&smo, inner_child(page, 0), atomic_load(&tree->height) - 1);
+            }
+            break;
+        }
+        if (node_used(page) >= MERGE_THRESHOLD)
+            break;
+    }
+
+    smo_finish(&smo, changed);
+    sync_mutex_unlock(&tree->smo_lock);
+}
+
+btree_t* btree_open(buffer_pool_t* pool, const char* path) {
+    if (!pool || !path)
+        return NULL;
+
+    btree_t* tree = (btree_t*)calloc(1, sizeof(btree_t));
+    if (!tree)
+        return NULL;
+
+    tree->pool = pool;
+    tree->path = (char*)malloc(strlen(path) + 1);
+    tree->file = tree->path ? disk_manager_open(path) : NULL;
+    if (!tree->file) {
+        free(tree->path);
+        free(tree);
+        return NULL;
+    }
+    strcpy(tree->path, path);
+    sync_mutex_init(&tree->smo_lock);
+
+    bool ok = true;
+    if (disk_manager_num_pages(tree->file) == 0) {
+        /* New tree: meta page plus an empty root leaf */
+        page_id_t   meta_id, root_id;
+        buffer_id_t meta = buffer_extend(pool, tree->file, NULL, &meta_id);
+        buffer_id_t root = meta >= 0 ? buffer_extend(pool, tree->file, NULL, &root_id) : -1;
+        ok               = root >= 0 && meta_id == BTREE_META_PAGE;
+        if (ok) {
+            void*        page = buffer_page(pool, meta);
+            btree_meta_t m    = {BTREE_MAGIC, root_id, 1};
+            page_init(page, meta_id, PAGE_TYPE_META, 0);
+            memcpy((char*)page + sizeof(page_header_t), &m, sizeof(m));
+            node_build(buffer_page(pool, root), root_id, 0, INVALID_PAGE_ID, NULL, 0);
+            buffer_mark_dirty(pool, meta);
+            buffer_mark_dirty(pool, root);
+            atomic_init(&tree->root, root_id);
+            atomic_init(&tree->height, 1);
+        }
+        if (meta >= 0)
+            buffer_release(pool, meta);
+        if (root >= 0)
+            buffer_release(pool, root);
+    } else {
+        buffer_id_t buf = buffer_read(pool, tree->file, BTREE_META_PAGE, NULL);
+        ok              = buf >= 0;
+        if (ok) {
+            btree_meta_t meta;
+            memcpy(&meta, (char*)buffer_page(pool, buf) + sizeof(page_header_t), sizeof(meta));
+            buffer_release(pool, buf);
+            ok = meta.magic == BTREE_MAGIC;
+            atomic_init(&tree->root, meta.root);
+            atomic_init(&tree->height, meta.height);
+        }
+    }
+
+    if (!ok) {
+        btree_close(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+void btree_close(btree_t* tree) {
+    if (!tree)
+        return;
+
+    buffer_drop_file(tree->pool, tree->file);
+    disk_manager_close(tree->file);
+    sync_mutex_destroy(&tree->smo_lock);
+    free(tree->path);
+    free(tree);
+}
+
+void btree_set_wal(btree_t* tree, wal_context_t* wal) { tree->wal = wal; }
+
+buffer_pool_t* btree_pool(const btree_t* tree) { return tree->pool; }
+
+disk_manager_t* btree_file(const btree_t* tree) { return tree->file; }
+
+uint32_t btree_height(btree_t* tree) { return atomic_load(&tree->height); }
+
+/*
+ * Insert or replace an entry. The common case locks only the leaf; a full
+ * leaf falls back to a structure change.
+ */
+static bool insert_entry(btree_t* tree, const void* key, uint16_t key_len, const uint8_t* entry,
+                         uint16_t entry_len, bool replace) {
+    for (;;) {
+        uint64_t    version;
+        buffer_id_t buf = descend(tree, key, key_len, NULL, &version);
+        if (buf < 0)
+            return false;
+        if (!latch_upgrade(tree, buf, version)) {
+            buffer_release(tree->pool, buf);
+            atomic_fetch_add(&tree->restarts, 1);
+            continue;
+        }
+
+        bool full;
+        bool ok = put_entry(buffer_page(tree->pool, buf), key, key_len, entry, entry_len, replace,
+                            &full);
+        latch_unlock(tree, buf, ok || full);
+        buffer_release(tree->pool, buf);
+        if (full)
+            return split_insert(tree, key, key_len, entry, entry_len, replace);
+        return ok;
+    }
+}
+
+bool btree_insert(btree_t* tree, const void* key, uint16_t key_len, const void* value,
+                  uint16_t value_len) {
+    if (!tree || (!key && key_len > 0) || key_len > BTREE_MAX_KEY_SIZE ||
+        (uint32_t)key_len + value_len > BTREE_MAX_ENTRY_SIZE)
+        return false;
+
+    uint8_t  entry[sizeof(uint16_t) + BTREE_MAX_ENTRY_SIZE];
+    uint16_t entry_len = make_entry(entry, key, key_len, value, value_len);
+    return insert_entry(tree, key, key_len, entry, entry_len, false);
+}
+
+bool btree_update(btree_t* tree, const void* key, uint16_t key_len, const void* value,
+                  uint16_t value_len) {
+    if (!tree || (!key && key_len > 0) || key_len > BTREE_MAX_KEY_SIZE ||
+        (uint32_t)key_len + value_len > BTREE_MAX_ENTRY_SIZE)
+        return false;
+
+    uint8_t  entry[sizeof(uint16_t) + BTREE_MAX_ENTRY_SIZE];
+    uint16_t entry_len = make_entry(entry, key, key_len, value, value_len);
+    return insert_entry(tree, key, key_len, entry, entry_len, true);
+}
+
+bool btree_delete(btree_t* tree, const void* key, uint16_t key_len) {
+    if (!tree || (!key && key_len > 0))
+        return false;
+
+    for (;;) {
+        uint64_t    version;
+        buffer_id_t buf = descend(tree, key, key_len, NULL, &version);
+        if (buf < 0)
+            return false;
+        if (!latch_upgrade(tree, buf, version)) {
+            buffer_release(tree->pool, buf);
+            atomic_fetch_add(&tree->restarts, 1);
+            continue;
+        }
+
+        void*    page = buffer_page(tree->pool, buf);
+        uint16_t slot;
+        bool     found;
+        leaf_lower_bound(page, key, key_len, &slot, &found);
+        if (found)
+            node_remove(page, slot);
+        bool underfull = found && node_used(page) < MERGE_THRESHOLD;
+        latch_unlock(tree, buf, found);
+        buffer_release(tree->pool, buf);
+
+        if (underfull && atomic_load(&tree->height) > 1)
+            merge_leaf(tree, key, key_len);
+        return found;
+    }
+}
+
+bool btree_get(btree_t* tree, const void* key, uint16_t key_len, void* buf, uint16_t buf_size,
+               uint16_t* len) {
+    if (!tree || (!key && key_len > 0))
+        return false;
+
+    for (;;) {
+        uint64_t    version;
+        buffer_id_t leaf = descend(tree, key, key_len, NULL, &version);
+        if (leaf < 0)
+            return false;
+
+        /* Copy out optimistically; the copy is only trusted once the leaf validates */
+        void*    page      = buffer_page(tree->pool, leaf);
+        uint16_t slot      = 0;
+        uint16_t value_len = 0;
+        bool     found     = false;
+        bool     ok        = leaf_lower_bound(page, key, key_len, &slot, &found);
+        if (ok && found) {
+            uint16_t       entry_len;
+            const uint8_t* entry = node_entry(page, slot, &entry_len);
+            ok                   = entry != NULL;
+            if (ok) {
+                value_len = entry_value_len(entry, entry_len);
+                if (buf)
+                    memcpy(buf, entry_value(entry), value_len < buf_size ? value_len : buf_size);
+            }
+        }
+        ok = ok && latch_validate(page, version);
+        buffer_release(tree->pool, leaf);
+
+        if (ok) {
+            if (found && len)
+                *len = value_len;
+            return found;
+        }
+        atomic_fetch_add(&tree->restarts, 1);
+    }
+}
+
+/*
+ * Copy the leaf holding the successor of the last key returned (or the lower
+ * bound) into the scan. If no split or merge happened since the previous
+ * copy its right link is still valid; otherwise, or if the right sibling has
+ * since been merged away, descend again from the root.
+ */
+static bool load_leaf(btree_scan_t* scan, page_id_t right) {
+    btree_t*    tree   = scan->tree;
+    const void* lo     = scan->has_pos ? scan->pos : NULL;
+    uint16_t    lo_len = scan->pos_len;
+
+    for (;;) {
+        uint64_t    structure = atomic_load(&tree->structure_version);
+        uint64_t    version   = 0;
+        buffer_id_t buf;
+        if (right != INVALID_PAGE_ID && structure == scan->version) {
+            buf = buffer_read(tree->pool, tree->file, right, NULL);
+            if (buf < 0)
+                return false;
+            if (!latch_read(buffer_page(tree->pool, buf), &version)) {
+                buffer_release(tree->pool, buf);
+                right = INVALID_PAGE_ID;
+                continue;
+            }
+        } else {
+            buf = descend(tree, lo, lo_len, NULL, &version);
+            if (buf < 0)
+                return false;
+        }
+
+        void* page = buffer_page(tree->pool, buf);
+        memcpy(scan->page_copy, page, PAGE_SIZE);
+        bool ok = latch_validate(page, version);
+        buffer_release(tree->pool, buf);
+        if (ok) {
+            scan->version = structure;
+            break;
+        }
+        atomic_fetch_add(&tree->restarts, 1);
+    }
+
+    scan->leaves_read++;
+    scan->next_slot = 0;
+    if (lo) {
+        if (scan->has_last)
+            upper_bound(scan->page_copy, lo, lo_len, 0, &scan->next_slot);
+        else
+            leaf_lower_bound(scan->page_copy, lo, lo_len, &scan->next_slot, NULL);
+    }
+    return true;
+}
+
+btree_scan_t* btree_scan_begin(btree_t* tree, const void* lo, uint16_t lo_len, const void* hi,
+                               uint16_t hi_len) {
+    if (!tree || lo_len > BTREE_MAX_KEY_SIZE || hi_len > BTREE_MAX_KEY_SIZE)
+        return NULL;
+
+    btree_scan_t* scan = (btree_scan_t*)calloc(1, sizeof(btree_scan_t));
+    if (!scan)
+        return NULL;
+
+    scan->tree = tree;
+    if (hi) {
+        scan->has_hi = true;
+        scan->hi_len = hi_len;
+        memcpy(scan->hi, hi, hi_len);
+    }
+
+    if (lo) {
+        scan->has_pos = true;
+        scan->pos_len = lo_len;
+        memcpy(scan->pos, lo, lo_len);
+    }
+
+    if (!load_leaf(scan, INVALID_PAGE_ID)) {
+        free(scan);
+        return NULL;
+    }
+    return scan;
+}
+
+bool btree_scan_next(btree_scan_t* scan, const void** key, uint16_t* key_len, const void** value,
+                     uint16_t* value_len) {
+    if (!scan)
+        return false;
+
+    while (!scan->done) {
+        void* page = scan->page_copy;
+        if (scan->next_slot < node_count(page)) {
+            node_layout_t  layout;
+            uint16_t       entry_len = 0;
+            const uint8_t* entry = node_entry(page, scan->next_slot++, &entry_len);
+            node_layout(page, &layout);
+
+            /* Keys are returned whole: the node prefix, then the stored part */
+            uint16_t klen = (uint16_t)(layout.prefix_len + entry_key_len(entry));
+            memcpy(scan->pos, layout.prefix, layout.prefix_len);
+            memcpy(scan->pos + layout.prefix_len, entry_key(entry), entry_key_len(entry));
+            if (scan->has_hi && key_compare(scan->pos, klen, scan->hi, scan->hi_len) >= 0)
+                break;
+
+            scan->has_pos  = true;
+            scan->has_last = true;
+            scan->pos_len  = klen;
+
+            *key       = scan->pos;
+            *key_len   = klen;
+            *value     = entry_value(entry);
+            *value_len = entry_value_len(entry, entry_len);
+            return true;
+        }
+
+        /* Move to the right sibling, skipping empty leaves */
+        page_id_t right = node_opaque(page)->right;
+        if (right == INVALID_PAGE_ID)
+            break;
+        if (!load_leaf(scan, right))
+            break;
+    }
+
+    scan->done = true;
+    return false;
+}
+
+uint32_t btree_scan_leaves_read(const btree_scan_t* scan) { return scan->leaves_read; }
+
+void btree_scan_end(btree_scan_t* scan) { free(scan); }
+
+/* Entry i of the node a bulk load level is filling */
+static node_item_t bulk_item(const bulk_level_t* level, uint16_t i) {
+    uint32_t end = i + 1 < level->count ? level->offsets[i + 1] : level->used;
+    return full_item(level->entries + level->offsets[i], (uint16_t)(end - level->offsets[i]));
+}
+
+static bool bulk_append(bulk_level_t* level, const uint8_t* entry, uint16_t len) {
+    if (level->used + len > level->capacity) {
+        uint32_t capacity = level->capacity ? level->capacity * 2 : PAGE_SIZE * 2;
+        while (capacity < level->used + len)
+            capacity *= 2;
+        uint8_t* entries = (uint8_t*)realloc(level->entries, capacity);
+        if (!entries)
+            return false;
+        level->entries  = entries;
+        level->capacity = capacity;
+    }
+
+    node_item_t item = full_item(entry, len);
+    memcpy(level->entries + level->used, entry, len);
+    level->offsets[level->count++] = level->used;
+    level->used += len;
+    level->bytes += item_size(&item);
+    return true;
+}
+
+static bool bulk_add_entry(btree_bulk_t* bulk, uint16_t l, const uint8_t* entry, uint16_t len);
+
+/*
+ * Write the node a level has gathered and pass its downlink to the level
+ * above. Unless it is the last node of its level, the next node's page is
+ * allocated first so the node can link to it. The last node of the
+ * topmost level is the root.
+ */
+static bool bulk_emit(btree_bulk_t* bulk, uint16_t l, bool last) {
+    btree_t*      tree  = bulk->tree;
+    bulk_level_t* level = &bulk->levels[l];
+
+    if (level->buf == INVALID_BUFFER) {
+        level->buf = buffer_extend(tree->pool, tree->file, bulk->strategy, &level->page_id);
+        if (level->buf < 0) {
+            level->buf = INVALID_BUFFER;
+            return false;
+        }
+    }
+    page_id_t   next_id  = INVALID_PAGE_ID;
+    buffer_id_t next_buf = INVALID_BUFFER;
+    if (!last) {
+        next_buf = buffer_extend(tree->pool, tree->file, bulk->strategy, &next_id);
+        if (next_buf < 0)
+            return false;
+    }
+
+    node_item_t items[NODE_MAX_ENTRIES];
+    for (uint16_t i = 0; i < level->count; i++)
+        items[i] = bulk_item(level, i);
+    if (!node_build(buffer_page(tree->pool, level->buf), level->page_id, l, next_id, items,
+                    level->count)) {
+        if (next_buf >= 0)
+            buffer_release(tree->pool, next_buf);
+        return false;
+    }
+
+    /* The node is unreachable until the root is set; it joins the batch locked */
+    latch_lock(tree, level->buf);
+    smo_add(&bulk->batch, level->buf);
+    page_id_t child = level->page_id;
+    bool      root  = last && level->nodes == 0;
+
+    level->buf     = next_buf;
+    level->page_id = next_id;
+    level->count   = 0;
+    level->bytes   = 0;
+    level->used    = 0;
+    level->nodes++;
+    if (bulk->batch.count >= BULK_BATCH && !smo_finish(&bulk->batch, true))
+        return false;
+
+    if (root) {
+        bulk->root = child;
+        return true;
+    }
+    if (l + 1 >= BTREE_MAX_HEIGHT)
+        return false;
+    if (l + 1u >= bulk->height)
+        bulk->height = l + 2u;
+
+    uint8_t  downlink[INNER_ENTRY_MAX];
+    uint16_t downlink_len = make_entry(downlink, level->sep, level->sep_len, &child, sizeof(child));
+    return bulk_add_entry(bulk, (uint16_t)(l + 1), downlink, downlink_len);
+}
+
+/*
+ * Add a full-key entry to a level, writing the node it fills first if the
+ * entry would take that past the fill factor. The estimate strips the
+ * prefix the node would have: what its first key shares with the new one,
+ * since keys arrive in order.
+ */
+static bool bulk_add_entry(btree_bulk_t* bulk, uint16_t l, const uint8_t* entry, uint16_t len) {
+    bulk_level_t* level = &bulk->levels[l];
+    uint16_t      first = l > 0 ? 1 : 0;
+    node_item_t   item  = full_item(entry, len);
+
+    if (level->count > first) {
+        node_item_t lo     = bulk_item(level, first);
+        uint16_t    max    = item_key_len(&lo) < item_key_len(&item) ? item_key_len(&lo)
+                                                                     : item_key_len(&item);
+        uint32_t    prefix = 0;
+        while (prefix < max && item_key_byte(&lo, (uint16_t)prefix) ==
+                                   item_key_byte(&item, (uint16_t)prefix))
+            prefix++;
+
+        uint32_t n    = level->count + 1u;
+        uint32_t size = level->bytes + item_size(&item) - prefix * (n - first) +
+                        ((prefix + 3u) & ~3u) + (HEAD_SLACK + n / 4) * sizeof(int32_t);
+        if (n > NODE_MAX_ENTRIES || size > bulk->limit) {
+            /* A leaf's right sibling is divided from it by the shortest key that can */
+            uint8_t  sep[BTREE_MAX_KEY_SIZE];
+            uint16_t sep_len = 0;
+            if (l == 0) {
+                node_item_t prev = bulk_item(level, (uint16_t)(level->count - 1));
+                sep_len          = shortest_separator(&prev, &item, sep);
+            }
+            if (!bulk_emit(bulk, l, false))
+                return false;
+            if (l == 0) {
+                memcpy(level->sep, sep, sep_len);
+                level->sep_len = sep_len;
+            }
+        }
+    }
+
+    /* The first key of an inner node is its separator; the node stores it empty */
+    if (l > 0 && level->count == 0) {
+        uint8_t  empty[INNER_ENTRY_MAX];
+        uint16_t key_len = entry_key_len(entry);
+        memcpy(level->sep, entry_key(entry), key_len);
+        level->sep_len = key_len;
+        uint16_t empty_len =
+            make_entry(empty, NULL, 0, entry_value(entry), entry_value_len(entry, len));
+        return bulk_append(level, empty, empty_len);
+    }
+    return bulk_append(level, entry, len);
+}
+
+static void bulk_free(btree_bulk_t* bulk) {
+    for (uint32_t l = 0; l < BTREE_MAX_HEIGHT; l++) {
+        if (bulk->levels[l].buf != INVALID_BUFFER)
+            buffer_release(bulk->tree->pool, bulk->levels[l].buf);
+        free(bulk->levels[l].entries);
+    }
+    smo_finish(&bulk->batch, true);
+    buffer_strategy_free(bulk->strategy);
+    free(bulk);
+}
+
+btree_bulk_t* btree_bulk_begin(btree_t* tree, uint32_t fillfactor) {
+    if (!tree || fillfactor < BTREE_MIN_FILLFACTOR || fillfactor > 100 ||
+        atomic_load(&tree->height) != 1)
+        return NULL;
+
+    buffer_id_t buf = buffer_read(tree->pool, tree->file, atomic_load(&tree->root), NULL);
+    if (buf < 0)
+        return NULL;
+    uint16_t count = node_count(buffer_page(tree->pool, buf));
+    buffer_release(tree->pool, buf);
+    if (count > 0)
+        return NULL;
+
+    btree_bulk_t* bulk = (btree_bulk_t*)calloc(1, sizeof(btree_bulk_t));
+    if (!bulk)
+        return NULL;
+    bulk->tree       = tree;
+    bulk->strategy   = buffer_strategy_create(tree->pool, BUFFER_ACCESS_BULKWRITE);
+    bulk->limit      = (uint32_t)(NODE_CAPACITY * fillfactor / 100);
+    bulk->height     = 1;
+    bulk->root       = INVALID_PAGE_ID;
+    bulk->batch.tree = tree;
+    for (uint32_t l = 0; l < BTREE_MAX_HEIGHT; l++)
+        bulk->levels[l].buf = INVALID_BUFFER;
+    return bulk;
+}
+
+bool btree_bulk_add(btree_bulk_t* bulk, const void* key, uint16_t key_len, const void* value,
+                    uint16_t value_len) {
+    if (!bulk || bulk->failed || (!key && key_len > 0) || key_len > BTREE_MAX_KEY_SIZE ||
+        (uint32_t)key_len + value_len > BTREE_MAX_ENTRY_SIZE)
+        return false;
+
+    bulk_level_t* leaves = &bulk->levels[0];
+    if (leaves->count > 0) {
+        /* Leaf entries are gathered whole, so the last key is the suffix */
+        node_item_t last = bulk_item(leaves, (uint16_t)(leaves->count - 1));
+        if (key_compare(last.suffix, last.suffix_len, key, key_len) >= 0)
+            return false;
+    }
+
+    uint8_t  entry[sizeof(uint16_t) + BTREE_MAX_ENTRY_SIZE];
+    uint16_t entry_len = make_entry(entry, key, key_len, value, value_len);
+    if (!bulk_add_entry(bulk, 0, entry, entry_len)) {
+        bulk->failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool btree_bulk_finish(btree_bulk_t* bulk) {
+    if (!bulk)
+        return false;
+
+    btree_t* tree = bulk->tree;
+    bool     ok   = !bulk->failed;
+    for (uint32_t l = 0; ok && l < bulk->height; l++)
+        ok = bulk_emit(bulk, (uint16_t)l, true);
+    ok = ok && bulk->root != INVALID_PAGE_ID &&
+         smo_set_root(&bulk->batch, bulk->root, bulk->height);
+    if (ok) {
+        ok = smo_finish(&bulk->batch, true);
+        atomic_fetch_add(&tree->structure_version, 1);
+    }
+    bulk_free(bulk);
+    return ok;
+}
+
+void btree_bulk_abort(btree_bulk_t* bulk) {
+    if (bulk)
+        bulk_free(bulk);
+}
+
+void btree_get_stats(btree_t* tree, btree_stats_t* stats) {
+    stats->leaf_splits  = atomic_load(&tree->leaf_splits);
+    stats->inner_splits = atomic_load(&tree->inner_splits);
+    stats->merges       = atomic_load(&tree->merges);
+    stats->restarts     = atomic_load(&tree->restarts);
+}
+
+btree_redo_t* btree_redo_begin(void) { return (btree_redo_t*)calloc(1, sizeof(btree_redo_t)); }
+
+/* Write a logged image unless the file already holds that change or a later one */
+static bool redo_page(disk_manager_t* file, page_id_t page_id, uint8_t* image, uint64_t lsn) {
+    while (disk_manager_num_pages(file) <= page_id) {
+        if (disk_manager_allocate_page(file) == INVALID_PAGE_ID)
+            return false;
+    }
+
+    /* A torn or missing page fails verification and is simply overwritten */
+    uint8_t current[PAGE_SIZE];
+    if (disk_manager_read_page(file, page_id, current) && !page_is_new(current) &&
+        page_verify(current, page_id) && page_header(current)->lsn >= lsn)
+        return true;
+
+    page_header(image)->lsn = lsn;
+    page_set_checksum(image);
+    return disk_manager_write_page(file, page_id, image);
+}
+
+/* Apply the collected records of one structure change */
+static bool redo_change(btree_redo_t* redo) {
+    disk_manager_t* file = NULL;
+    bool            ok   = true;
+    uint8_t         image[PAGE_SIZE];
+
+    for (size_t pos = 0; ok && pos < redo->len;) {
+        uint16_t len;
+        memcpy(&len, redo->data + pos, sizeof(len));
+        const uint8_t*     data = redo->data + pos + sizeof(len);
+        const uint8_t*     end  = data + len;
+        btree_wal_header_t header;
+        memcpy(&header, data, sizeof(header));
+        pos += sizeof(len) + len;
+        data += sizeof(header);
+
+        if (!file) {
+            char path[1024];
+            if (header.path_len >= sizeof(path))
+                return false;
+            memcpy(path, data, header.path_len);
+            path[header.path_len] = '\0';
+            file                  = disk_manager_open(path);
+            if (!file)
+                return false;
+        }
+        data += header.path_len;
+
+        for (uint16_t i = 0; ok && i < header.num_pages; i++) {
+            btree_wal_page_t page;
+            ok = data + sizeof(page) <= end;
+            if (!ok)
+                break;
+            memcpy(&page, data, sizeof(page));
+            data += sizeof(page);
+
+            uint32_t stored = PAGE_SIZE - (uint32_t)page.hole_length;
+            ok = (uint32_t)page.hole_offset + page.hole_length <= PAGE_SIZE && data + stored <= end;
+            if (!ok)
+                break;
+
+            memcpy(image, data, page.hole_offset);
+            memset(image + page.hole_offset, 0, page.hole_length);
+            memcpy(image + page.hole_offset + page.hole_length, data + page.hole_offset,
+                   stored - page.hole_offset);
+            data += stored;
+            ok = redo_page(file, page.page_id, image, header.lsn);
+        }
+    }
+
+    if (file) {
+        ok = disk_manager_sync(file) && ok;
+        disk_manager_close(file);
+    }
+    return ok;
+}
+
+bool btree_redo_apply(btree_redo_t* redo, const wal_record_header_t* header, const void* data) {
+    if (!redo || !header)
+        return false;
+    if (header->type != WAL_RECORD_BTREE)
+        return true;
+
+    btree_wal_header_t payload;
+    if (!data || header->data_len < sizeof(payload))
+        return false;
+    memcpy(&payload, data, sizeof(payload));
+    if (sizeof(payload) + (uint32_t)payload.path_len > header->data_len)
+        return false;
+
+    /* Collect the records of a change; it is applied once its last record arrives */
+    size_t need = redo->len + sizeof(uint16_t) + header->data_len;
+    if (need > redo->capacity) {
+        size_t   capacity = need * 2;
+        uint8_t* grown    = (uint8_t*)realloc(redo->data, capacity);
+        if (!grown)
+            return false;
+        redo->data     = grown;
+        redo->capacity = capacity;
+    }
+    memcpy(redo->data + redo->len, &header->data_len, sizeof(uint16_t));
+    memcpy(redo->data + redo->len + sizeof(uint16_t), data, header->data_len);
+    redo->len = need;
+
+    if (payload.flags & WAL_BTREE_CONTINUED)
+        return true;
+
+    bool ok   = redo_change(redo);
+    redo->len = 0;
+    return ok;
+}
+
+void btree_redo_end(btree_redo_t* redo) {
+    if (!redo)
+        return;
+    /* A change whose last record is missing was never completed; it is dropped */
+    free(redo->data);
+    free(redo);
+}
+
+/* Secondary index entries: key followed by the big-endian tuple ID */
+static uint16_t make_tid_key(uint8_t* out, const void* key, uint16_t key_len, tuple_id_t tid) {
+    memcpy(out, key, key_len);
+    return (uint16_t)(key_len + key_put_tid(out + key_len, tid));
+}
+
+static bool btree_index_insert_covering(void* state, const void* key, uint16_t key_len,
+                                        tuple_id_t tid, const void* payload,
+                                        uint16_t payload_len) {
+    uint8_t entry_key[BTREE_MAX_KEY_SIZE];
+    if (key_len > BTREE_MAX_KEY_SIZE - KEY_TID_SIZE)
+        return false;
+    return btree_insert((btree_t*)state, entry_key, make_tid_key(entry_key, key, key_len, tid),
+                        payload, payload_len);
+}
+
+static bool btree_index_insert(void* state, const void* key, uint16_t key_len, tuple_id_t tid) {
+    return btree_index_insert_covering(state, key, key_len, tid, NULL, 0);
+}
+
+static bool btree_index_remove(void* state, const void* key, uint16_t key_len, tuple_id_t tid) {
+    uint8_t entry_key[BTREE_MAX_KEY_SIZE];
+    if (key_len > BTREE_MAX_KEY_SIZE - KEY_TID_SIZE)
+        return false;
+    return btree_delete((btree_t*)state, entry_key, make_tid_key(entry_key, key, key_len, tid));
+}
+
+static bool btree_index_lookup_covering(void* state, const void* key, uint16_t key_len,
+                                        index_cover_fn visit, void* arg) {
+    btree_scan_t* scan = btree_scan_begin((btree_t*)state, key, key_len, NULL, 0);
+    if (!scan)
+        return false;
+
+    const void* entry_key;
+    const void* value;
+    uint16_t    entry_len, value_len;
+    while (btree_scan_next(scan, &entry_key, &entry_len, &value, &value_len)) {
+        /* Entries of the key are contiguous; longer keys sharing the prefix are skipped */
+        if (entry_len < key_len || memcmp(entry_key, key, key_len) != 0)
+            break;
+        if (entry_len != key_len + KEY_TID_SIZE)
+            continue;
+
+        if (!visit(key_get_tid((const uint8_t*)entry_key + key_len), value, value_len, arg))
+            break;
+    }
+
+    btree_scan_end(scan);
+    return true;
+}
+
+/**
+ * Adapter passing covering lookup matches to a plain visitor
+ */
+typedef struct {
+    index_visit_fn visit;
+    void*          arg;
+} plain_visit_t;
+
+static bool visit_plain(tuple_id_t tid, const void* payload, uint16_t payload_len, void* arg) {
+    plain_visit_t* plain = (plain_visit_t*)arg;
+    (void)payload;
+    (void)payload_len;
+    return plain->visit(tid, plain->arg);
+}
+
+static bool btree_index_lookup(void* state, const void* key, uint16_t key_len,
+                               index_visit_fn visit, void* arg) {
+    plain_visit_t plain = {visit, arg};
+    return btree_index_lookup_covering(state, key, key_len, visit_plain, &plain);
+}
+
+uint16_t btree_index_key(uint8_t* out, const void* key, uint16_t key_len, tuple_id_t tid) {
+    if (!out || (!key && key_len > 0) || key_len > BTREE_MAX_KEY_SIZE - KEY_TID_SIZE)
+        return 0;
+    return make_tid_key(out, key, key_len, tid);
+}
+
+static void btree_index_close(void* state) { btree_close((btree_t*)state); }
+
+const index_ops_t btree_index_ops = {btree_index_insert,          btree_index_remove,
+                                     btree_index_lookup,          btree_index_close,
+                                     btree_index_insert_covering, btree_index_lookup_covering};
@@ -0,0 +1,1099 @@
+/**
+ * @file hash_index.c
+ * @brief Implementation of the extendible hash index
+ *
+ * Page 0 of the file is the meta page: global depth, page counts, the head
+ * of the list of free overflow pages, and the IDs of the directory pages.
+ * Directory pages hold the bucket page ID of every directory entry, in
+ * order; the index reads them into memory on open and writes back the
+ * entries it changes.
+ *
+ * Bucket and overflow pages are slotted pages whose items are entries of
+ * [u32 hash][u16 key length][key][value], in hash order, so a lookup
+ * binary searches the page on the hash and compares keys only where the
+ * hashes tie. The special space links a page to the next of its chain and
+ * records the bucket's local depth: the number of low hash bits all of its
+ * entries share. A bucket with local depth d is named by every directory
+ * entry whose low d bits are its own, so splitting it rewrites every other
+ * one of those entries to name the new bucket.
+ *
+ * Each bucket may have a Bloom filter of the hashes of its entries, kept
+ * in memory and indexed by the bucket's page ID. A split builds the filters
+ * of both halves from the entries it moves; a bucket without one (after
+ * opening the file, or once inserts outgrow the filter) gets it from the
+ * next lookup that reads its page. Inserts add to the filter while they
+ * hold the bucket's first page exclusively, before the entry is written, so
+ * a lookup that trusts a negative answer never misses a committed entry.
+ * Filters replaced under the shared directory lock may still be probed, so
+ * they are freed at the next split or on close, when no lookup is running.
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/data/bloom.h>
+#include <monodb/core/data/hash_index.h>
+#include <monodb/core/data/key.h>
+#include <monodb/core/storage/disk_manager.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HASH_MAGIC     0x48534831 /* "HSH1" */
+#define HASH_META_PAGE 0
+
+/* Entry header: hash and key length */
+#define ENTRY_HEADER 6
+
+/* Bucket filters: bits per entry, and entries a new filter has room for beyond its first */
+#define FILTER_BITS_PER_KEY 10
+#define FILTER_MIN_KEYS     64
+
+/**
+ * Contents of the meta page, followed by the directory page IDs
+ */
+typedef struct {
+    uint32_t  magic;          /* HASH_MAGIC */
+    uint32_t  global_depth;   /* Hash bits the directory uses */
+    uint32_t  buckets;        /* Bucket pages */
+    uint32_t  overflow_pages; /* Overflow pages, in use or free */
+    page_id_t free_head;      /* First free overflow page, INVALID_PAGE_ID if none */
+    uint32_t  dir_pages;      /* Directory pages */
+} hash_meta_t;
+
+/* Directory entries per directory page */
+#define DIR_PER_PAGE ((uint32_t)((PAGE_SIZE - sizeof(page_header_t)) / sizeof(page_id_t)))
+
+/* Directory pages the meta page can list */
+#define META_MAX_DIR_PAGES \
+    ((uint32_t)((PAGE_SIZE - sizeof(page_header_t) - sizeof(hash_meta_t)) / sizeof(page_id_t)))
+
+_Static_assert(((1u << HASH_INDEX_MAX_DEPTH) + DIR_PER_PAGE - 1) / DIR_PER_PAGE <=
+                   META_MAX_DIR_PAGES,
+               "the meta page must list every directory page of a full directory");
+
+/**
+ * Special space of bucket and overflow pages
+ */
+typedef struct {
+    page_id_t overflow; /* Next page of the chain (or free list), INVALID_PAGE_ID at the end */
+    uint16_t  depth;    /* Local depth, on the first page of a bucket */
+    uint16_t  garbage;  /* Bytes of deleted entries not yet compacted away */
+} hash_bucket_t;
+
+struct hash_index_t {
+    buffer_pool_t*  pool;
+    disk_manager_t* file;
+    sync_rwlock_t   lock; /* Shared by lookups and entry changes, exclusive for structure */
+    hash_meta_t     meta;
+    page_id_t       dir_pages[META_MAX_DIR_PAGES];
+    page_id_t*      dir; /* 2^global_depth bucket page IDs */
+    uint64_t        splits;
+    uint64_t        doublings;
+
+    /* Bucket filters, indexed by page ID; the array only grows under the exclusive lock */
+    _Atomic(bloom_t*)* filters;
+    uint32_t           filter_slots;
+    sync_mutex_t       retired_lock;
+    bloom_t**          retired; /* Replaced filters lookups may still be probing */
+    uint32_t           num_retired;
+    uint32_t           retired_cap;
+    _Atomic uint64_t   filter_negatives;
+    _Atomic uint64_t   filter_false_positives;
+};
+
+/**
+ * Entry to look for: a key, and for index entries the value as well
+ */
+typedef struct {
+    uint32_t    hash;
+    const void* key;
+    uint16_t    key_len;
+    const void* value; /* NULL to match any value */
+    uint16_t    value_len;
+} probe_t;
+
+typedef enum { INSERT_DONE, INSERT_EXISTS, INSERT_FULL, INSERT_ERROR } insert_result_t;
+
+/**
+ * Entry collected from a chain being split
+ */
+typedef struct {
+    uint32_t hash;
+    uint32_t offset; /* Offset in the collection arena */
+    uint16_t len;
+} split_item_t;
+
+/* 64-bit FNV-1a with a final avalanche, so low bits depend on every key byte */
+static uint32_t hash_bytes(const void* key, uint16_t len) {
+    const uint8_t* p = (const uint8_t*)key;
+    uint64_t       h = 0xCBF29CE484222325ull;
+    for (uint16_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001B3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+/* Filter hash of an entry hash: every bit mixed, as the directory has used the low ones */
+static uint64_t filter_hash(uint32_t hash) {
+    uint64_t h = hash;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint32_t entry_hash(const uint8_t* entry) {
+    uint32_t hash;
+    memcpy(&hash, entry, sizeof(hash));
+    return hash;
+}
+
+static uint16_t entry_key_len(const uint8_t* entry) {
+    uint16_t len;
+    memcpy(&len, entry + 4, sizeof(len));
+    return len;
+}
+
+static uint16_t make_entry(uint8_t* out, const probe_t* probe, const void* value,
+                           uint16_t value_len) {
+    memcpy(out, &probe->hash, 4);
+    memcpy(out + 4, &probe->key_len, 2);
+    memcpy(out + ENTRY_HEADER, probe->key, probe->key_len);
+    if (value_len > 0)
+        memcpy(out + ENTRY_HEADER + probe->key_len, value, value_len);
+    return (uint16_t)(ENTRY_HEADER + probe->key_len + value_len);
+}
+
+static hash_bucket_t* bucket_special(void* page) { return (hash_bucket_t*)page_special(page); }
+
+/* Directory index of a hash */
+static uint32_t dir_slot(const hash_index_t* index, uint32_t hash) {
+    return hash & ((1u << index->meta.global_depth) - 1);
+}
+
+/* First slot of a page whose hash is not below hash */
+static uint16_t lower_bound(void* page, uint32_t hash) {
+    uint16_t lo = 0, hi = page_num_slots(page);
+    while (lo < hi) {
+        uint16_t mid = (uint16_t)((lo + hi) / 2);
+        uint16_t len;
+        if (entry_hash((const uint8_t*)page_get_item(page, mid, &len)) < hash)
+            lo = (uint16_t)(mid + 1);
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Slot of the entry a probe matches, -1 if the page has none */
+static int find_entry(void* page, const probe_t* probe) {
+    uint16_t count = page_num_slots(page);
+    for (uint16_t slot = lower_bound(page, probe->hash); slot < count; slot++) {
+        uint16_t       len;
+        const uint8_t* entry = (const uint8_t*)page_get_item(page, slot, &len);
+        if (entry_hash(entry) != probe->hash)
+            break;
+        uint16_t key_len = entry_key_len(entry);
+        if (key_len != probe->key_len || memcmp(entry + ENTRY_HEADER, probe->key, key_len) != 0)
+            continue;
+        if (!probe->value || (len - ENTRY_HEADER - key_len == probe->value_len &&
+                              memcmp(entry + ENTRY_HEADER + key_len, probe->value,
+                                     probe->value_len) == 0))
+            return slot;
+    }
+    return -1;
+}
+
+/* Whether an entry fits, counting the room compaction would give back */
+static bool bucket_fits(void* page, uint16_t len) {
+    const page_header_t* hdr  = page_header(page);
+    int                  free = (int)hdr->upper - (int)hdr->lower - (int)sizeof(page_slot_t);
+    return free + bucket_special(page)->garbage >= (int)len;
+}
+
+/* Add an entry at its hash position, compacting first if deletes left the room in holes */
+static void bucket_put(void* page, const uint8_t* entry, uint16_t len) {
+    hash_bucket_t* bucket = bucket_special(page);
+    if (page_free_space(page) < len && bucket->garbage > 0) {
+        page_compact(page);
+        bucket->garbage = 0;
+    }
+    page_insert_item_at(page, lower_bound(page, entry_hash(entry)), entry, len);
+}
+
+static void bucket_init(void* page, page_id_t page_id, uint16_t depth) {
+    page_init(page, page_id, PAGE_TYPE_HASH, sizeof(hash_bucket_t));
+    hash_bucket_t* bucket = bucket_special(page);
+    bucket->overflow      = INVALID_PAGE_ID;
+    bucket->depth         = depth;
+    bucket->garbage       = 0;
+}
+
+/* Read and lock a bucket or overflow page */
+static buffer_id_t page_acquire(hash_index_t* index, page_id_t page_id, buffer_lock_mode_t mode) {
+    buffer_id_t buf = buffer_read(index->pool, index->file, page_id, NULL);
+    if (buf >= 0)
+        buffer_lock(index->pool, buf, mode);
+    return buf;
+}
+
+static void page_release(hash_index_t* index, buffer_id_t buf, buffer_lock_mode_t mode,
+                         bool dirty) {
+    if (dirty)
+        buffer_mark_dirty(index->pool, buf);
+    buffer_unlock(index->pool, buf, mode);
+    buffer_release(index->pool, buf);
+}
+
+/*
+ * Allocate a page, from the free overflow pages if there are any, and
+ * return it pinned and locked exclusively. Called with the directory held
+ * exclusively.
+ */
+static buffer_id_t page_alloc(hash_index_t* index, page_id_t* page_id) {
+    buffer_id_t buf;
+    if (index->meta.free_head != INVALID_PAGE_ID) {
+        buf = page_acquire(index, index->meta.free_head, BUFFER_LOCK_EXCLUSIVE);
+        if (buf < 0)
+            return -1;
+        *page_id              = index->meta.free_head;
+        index->meta.free_head = bucket_special(buffer_page(index->pool, buf))->overflow;
+        index->meta.overflow_pages--;
+        return buf;
+    }
+
+    buf = buffer_extend(index->pool, index->file, NULL, page_id);
+    if (buf >= 0)
+        buffer_lock(index->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+    return buf;
+}
+
+/* Filter of a bucket, NULL if it has none */
+static bloom_t* filter_of(hash_index_t* index, page_id_t page_id) {
+    return page_id < index->filter_slots
+               ? atomic_load_explicit(&index->filters[page_id], memory_order_acquire)
+               : NULL;
+}
+
+/* Make room for the filter of a page. Called with the directory held exclusively, or on open. */
+static bool filter_reserve(hash_index_t* index, page_id_t page_id) {
+    if (page_id < index->filter_slots)
+        return true;
+    uint32_t slots = index->filter_slots ? index->filter_slots : 64;
+    while (slots <= page_id)
+        slots *= 2;
+    _Atomic(bloom_t*)* filters =
+        (_Atomic(bloom_t*)*)realloc(index->filters, slots * sizeof(_Atomic(bloom_t*)));
+    if (!filters)
+        return false;
+    for (uint32_t i = index->filter_slots; i < slots; i++)
+        atomic_init(&filters[i], NULL);
+    index->filters      = filters;
+    index->filter_slots = slots;
+    return true;
+}
+
+/* Filter for a bucket of count entries, with room for the inserts it takes before splitting */
+static bloom_t* filter_create(uint32_t count) {
+    return bloom_create(2 * count + FILTER_MIN_KEYS, FILTER_BITS_PER_KEY);
+}
+
+/* Replace a bucket's filter, freeing the old one. Called with the directory held exclusively. */
+static void filter_set(hash_index_t* index, page_id_t page_id, bloom_t* filter) {
+    if (!filter_reserve(index, page_id)) {
+        bloom_destroy(filter);
+        return;
+    }
+    bloom_destroy(atomic_exchange(&index->filters[page_id], filter));
+}
+
+/* Free the retired filters. Called with the directory held exclusively. */
+static void filter_reclaim(hash_index_t* index) {
+    for (uint32_t i = 0; i < index->num_retired; i++)
+        bloom_destroy(index->retired[i]);
+    index->num_retired = 0;
+}
+
+/*
+ * Add an entry hash to its bucket's filter. Called with the bucket's first
+ * page locked exclusively. A filter that outgrows its size is dropped, to be
+ * rebuilt for the bucket as it is then by the next lookup.
+ */
+static void filter_add(hash_index_t* index, page_id_t page_id, uint32_t hash) {
+    bloom_t* filter = filter_of(index, page_id);
+    if (!filter || bloom_add(filter, filter_hash(hash)))
+        return;
+
+    sync_mutex_lock(&index->retired_lock);
+    if (index->num_retired == index->retired_cap) {
+        uint32_t  cap     = index->retired_cap ? 2 * index->retired_cap : 16;
+        bloom_t** retired = (bloom_t**)realloc(index->retired, cap * sizeof(bloom_t*));
+        if (retired) {
+            index->retired     = retired;
+            index->retired_cap = cap;
+        }
+    }
+    if (index->num_retired < index->retired_cap) {
+        index->retired[index->num_retired++] = filter;
+        atomic_store_explicit(&index->filters[page_id], NULL, memory_order_release);
+    }
+    sync_mutex_unlock(&index->retired_lock);
+}
+
+/*
+ * Build the filter of a bucket that is a single page from that page, which
+ * the caller holds locked. Returns the bucket's filter, or NULL if it has
+ * overflow pages or memory ran out.
+ */
+static bloom_t* filter_build(hash_index_t* index, page_id_t page_id, void* page) {
+    if (page_id >= index->filter_slots || bucket_special(page)->overflow != INVALID_PAGE_ID)
+        return NULL;
+
+    uint16_t count  = page_num_slots(page);
+    bloom_t* filter = filter_create(count);
+    if (!filter)
+        return NULL;
+    for (uint16_t slot = 0; slot < count; slot++) {
+        uint16_t len;
+        bloom_add(filter, filter_hash(entry_hash((const uint8_t*)page_get_item(page, slot, &len))));
+    }
+
+    /* Another lookup may have built it first */
+    bloom_t* built = NULL;
+    if (!atomic_compare_exchange_strong(&index->filters[page_id], &built, filter)) {
+        bloom_destroy(filter);
+        return built;
+    }
+    return filter;
+}
+
+/* Probe a bucket's filter; false means the bucket holds no entry with the hash */
+static bool filter_check(hash_index_t* index, const bloom_t* filter, uint32_t hash) {
+    if (bloom_may_contain(filter, filter_hash(hash)))
+        return true;
+    atomic_fetch_add_explicit(&index->filter_negatives, 1, memory_order_relaxed);
+    return false;
+}
+
+/* Write the meta page from the in-memory copy */
+static bool meta_store(hash_index_t* index) {
+    buffer_id_t buf = page_acquire(index, HASH_META_PAGE, BUFFER_LOCK_EXCLUSIVE);
+    if (buf < 0)
+        return false;
+    char* data = (char*)buffer_page(index->pool, buf) + sizeof(page_header_t);
+    memcpy(data, &index->meta, sizeof(hash_meta_t));
+    memcpy(data + sizeof(hash_meta_t), index->dir_pages,
+           index->meta.dir_pages * sizeof(page_id_t));
+    page_release(index, buf, BUFFER_LOCK_EXCLUSIVE, true);
+    return true;
+}
+
+/* Write directory entries from, from + step, ... to their directory pages */
+static bool dir_store(hash_index_t* index, uint32_t from, uint32_t step) {
+    uint32_t    size    = 1u << index->meta.global_depth;
+    uint32_t    current = UINT32_MAX;
+    buffer_id_t buf     = -1;
+    page_id_t*  entries = NULL;
+
+    for (uint32_t i = from; i < size; i += step) {
+        if (i / DIR_PER_PAGE != current) {
+            if (buf >= 0)
+                page_release(index, buf, BUFFER_LOCK_EXCLUSIVE, true);
+            current = i / DIR_PER_PAGE;
+            buf     = page_acquire(index, index->dir_pages[current], BUFFER_LOCK_EXCLUSIVE);
+            if (buf < 0)
+                return false;
+            entries = (page_id_t*)((char*)buffer_page(index->pool, buf) + sizeof(page_header_t));
+        }
+        entries[i % DIR_PER_PAGE] = index->dir[i];
+    }
+
+    if (buf >= 0)
+        page_release(index, buf, BUFFER_LOCK_EXCLUSIVE, true);
+    return true;
+}
+
+/* Double the directory: the new upper half repeats the lower half, so no bucket changes */
+static bool dir_double(hash_index_t* index) {
+    uint32_t   size = 1u << index->meta.global_depth;
+    page_id_t* dir  = (page_id_t*)realloc(index->dir, 2 * (size_t)size * sizeof(page_id_t));
+    if (!dir)
+        return false;
+    index->dir = dir;
+    memcpy(dir + size, dir, size * sizeof(page_id_t));
+
+    uint32_t needed = (2 * size + DIR_PER_PAGE - 1) / DIR_PER_PAGE;
+    while (index->meta.dir_pages < needed) {
+        page_id_t   page_id;
+        buffer_id_t buf = page_alloc(index, &page_id);
+        if (buf < 0)
+            return false;
+        page_init(buffer_page(index->pool, buf), page_id, PAGE_TYPE_META, 0);
+        page_release(index, buf, BUFFER_LOCK_EXCLUSIVE, true);
+        index->dir_pages[index->meta.dir_pages++] = page_id;
+    }
+
+    index->meta.global_depth++;
+    index->doublings++;
+    return dir_store(index, size, 1) && meta_store(index);
+}
+
+/*
+ * Insert an entry into a bucket. The caller holds the bucket's first page
+ * locked exclusively; overflow pages are locked as the chain is walked. The
+ * whole chain is checked for a matching entry before anything is added.
+ */
+static insert_result_t chain_insert(hash_index_t* index, buffer_id_t first, const probe_t* probe,
+                                    const uint8_t* entry, uint16_t entry_len) {
+    insert_result_t result = INSERT_FULL;
+    buffer_id_t     target = -1;
+    buffer_id_t     buf    = first;
+    for (;;) {
+        void* page = buffer_page(index->pool, buf);
+        if (find_entry(page, probe) >= 0)
+            result = INSERT_EXISTS;
+        else if (target < 0 && bucket_fits(page, entry_len))
+            target = buf;
+
+        page_id_t next = bucket_special(page)->overflow;
+        if (buf != first && buf != target)
+            page_release(index, buf, BUFFER_LOCK_EXCLUSIVE, false);
+        if (result == INSERT_EXISTS || next == INVALID_PAGE_ID)
+            break;
+        buf = page_acquire(index, next, BUFFER_LOCK_EXCLUSIVE);
+        if (buf < 0) {
+            result = INSERT_ERROR;
+            break;
+        }
+    }
+
+    if (result == INSERT_FULL && target >= 0) {
+        bucket_put(buffer_page(index->pool, target), entry, entry_len);
+        buffer_mark_dirty(index->pool, target);
+        result = INSERT_DONE;
+    }
+    if (target >= 0 && target != first)
+        page_release(index, target, BUFFER_LOCK_EXCLUSIVE, result == INSERT_DONE);
+    return result;
+}
+
+/* Whether any entry of a chain has a hash other than the probe's, so a split can separate them */
+static bool chain_separable(hash_index_t* index, buffer_id_t first, uint32_t hash) {
+    buffer_id_t buf       = first;
+    bool        separable = false;
+    while (!separable) {
+        void*    page  = buffer_page(index->pool, buf);
+        uint16_t count = page_num_slots(page);
+        for (uint16_t slot = 0; slot < count && !separable; slot++) {
+            uint16_t len;
+            separable = entry_hash((const uint8_t*)page_get_item(page, slot, &len)) != hash;
+        }
+
+        page_id_t next = bucket_special(page)->overflow;
+        if (buf != first)
+            page_release(index, buf, BUFFER_LOCK_EXCLUSIVE, false);
+        if (next == INVALID_PAGE_ID)
+            break;
+        buf = page_acquire(index, next, BUFFER_LOCK_EXCLUSIVE);
+        if (buf < 0)
+            break;
+    }
+    return separable;
+}
+
+/* Append an overflow page to the end of a chain and put the entry there */
+static bool chain_extend(hash_index_t* index, buffer_id_t first, const uint8_t* entry,
+                         uint16_t entry_len) {
+    buffer_id_t tail = first;
+    page_id_t   next;
+    while ((next = bucket_special(buffer_page(index->pool, tail))->overflow) != INVALID_PAGE_ID) {
+        buffer_id_t buf = page_acquire(index, next, BUFFER_LOCK_EXCLUSIVE);
+        if (tail != first)
+            page_release(index, tail, BUFFER_LOCK_EXCLUSIVE, false);
+        if (buf < 0)
+            return false;
+        tail = buf;
+    }
+
+    page_id_t   page_id;
+    buffer_id_t buf = page_alloc(index, &page_id);
+    if (buf >= 0) {
+        void* page = buffer_page(index->pool, buf);
+        bucket_init(page, page_id, 0);
+        bucket_put(page, entry, entry_len);
+        page_release(index, buf, BUFFER_LOCK_EXCLUSIVE, true);
+        bucket_special(buffer_page(index->pool, tail))->overflow = page_id;
+        buffer_mark_dirty(index->pool, tail);
+        index->meta.overflow_pages++;
+    }
+    if (tail != first)
+        page_release(index, tail, BUFFER_LOCK_EXCLUSIVE, buf >= 0);
+    return buf >= 0 && meta_store(index);
+}
+
+/**
+ * Pages an entry list is written to: the chain of one half of a split
+ */
+typedef struct {
+    buffer_id_t first;  /* First page, owned by the split */
+    buffer_id_t tail;   /* Page being filled */
+    page_id_t*  spare;  /* Overflow pages of the old chain, to reuse */
+    uint32_t*   spares; /* Number of spare pages left */
+} chain_writer_t;
+
+static bool writer_add(hash_index_t* index, chain_writer_t* writer, const uint8_t* entry,
+                       uint16_t len) {
+    void* page = buffer_page(index->pool, writer->tail);
+    if (!bucket_fits(page, len)) {
+        page_id_t   page_id;
+        buffer_id_t buf;
+        if (*writer->spares > 0) {
+            page_id = writer->spare[--*writer->spares];
+            buf     = page_acquire(index, page_id, BUFFER_LOCK_EXCLUSIVE);
+        } else {
+            buf = page_alloc(index, &page_id);
+            if (buf >= 0)
+                index->meta.overflow_pages++;
+        }
+        if (buf < 0)
+            return false;
+
+        bucket_special(page)->overflow = page_id;
+        if (writer->tail != writer->first)
+            page_release(index, writer->tail, BUFFER_LOCK_EXCLUSIVE, true);
+        writer->tail = buf;
+        page         = buffer_page(index->pool, buf);
+        bucket_init(page, page_id, 0);
+    }
+    bucket_put(page, entry, len);
+    return true;
+}
+
+static int compare_items(const void* a, const void* b) {
+    uint32_t x = ((const split_item_t*)a)->hash;
+    uint32_t y = ((const split_item_t*)b)->hash;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Split a bucket of local depth depth on hash bit depth, doubling the
+ * directory first if the bucket already uses every bit it has. The entries
+ * of the whole chain are collected and written back to two chains, reusing
+ * the old overflow pages; overflow pages left over go to the free list.
+ */
+static bool bucket_split(hash_index_t* index, buffer_id_t first, uint32_t hash, uint16_t depth) {
+    if (depth == index->meta.global_depth && !dir_double(index))
+        return false;
+
+    uint8_t*      arena  = NULL;
+    split_item_t* items  = NULL;
+    page_id_t*    spare  = NULL;
+    size_t        used   = 0, arena_size = 0;
+    uint32_t      count  = 0, item_cap = 0, spares = 0, spare_cap = 0;
+    page_id_t     low_id = buffer_page_id(index->pool, first);
+    buffer_id_t   buf    = first;
+    bool          ok     = true;
+
+    /* Collect every entry of the chain, and the IDs of its overflow pages */
+    while (ok) {
+        void*    page  = buffer_page(index->pool, buf);
+        uint16_t slots = page_num_slots(page);
+        if (used + PAGE_SIZE > arena_size) {
+            arena_size  = arena_size ? 2 * arena_size : 2 * (size_t)PAGE_SIZE;
+            uint8_t* a  = (uint8_t*)realloc(arena, arena_size);
+            ok          = a != NULL;
+            arena       = a ? a : arena;
+        }
+        if (ok && count + slots > item_cap) {
+            item_cap         = 2 * (count + slots);
+            split_item_t* it = (split_item_t*)realloc(items, item_cap * sizeof(split_item_t));
+            ok               = it != NULL;
+            items            = it ? it : items;
+        }
+        for (uint16_t slot = 0; ok && slot < slots; slot++) {
+            uint16_t       len;
+            const uint8_t* entry = (const uint8_t*)page_get_item(page, slot, &len);
+            memcpy(arena + used, entry, len);
+            items[count++] = (split_item_t){entry_hash(entry), (uint32_t)used, len};
+            used += len;
+        }
+
+        page_id_t next = bucket_special(page)->overflow;
+        if (buf != first)
+            page_release(index, buf, BUFFER_LOCK_EXCLUSIVE, false);
+        if (!ok || next == INVALID_PAGE_ID)
+            break;
+        if (spares == spare_cap) {
+            spare_cap     = spare_cap ? 2 * spare_cap : 8;
+            page_id_t* sp = (page_id_t*)realloc(spare, spare_cap * sizeof(page_id_t));
+            ok            = sp != NULL;
+            spare         = sp ? sp : spare;
+        }
+        if (ok) {
+            spare[spares++] = next;
+            buf             = page_acquire(index, next, BUFFER_LOCK_EXCLUSIVE);
+            ok              = buf >= 0;
+        }
+    }
+
+    buffer_id_t high    = -1;
+    page_id_t   high_id = INVALID_PAGE_ID;
+    if (ok) {
+        high = page_alloc(index, &high_id);
+        ok   = high >= 0;
+    }
+    if (!ok) {
+        free(arena);
+        free(items);
+        free(spare);
+        return false;
+    }
+
+    /* Rewrite both halves in hash order; the spare list is used from its end */
+    for (uint32_t i = 0, j = spares; i < j / 2; i++) {
+        page_id_t t      = spare[i];
+        spare[i]         = spare[j - 1 - i];
+        spare[j - 1 - i] = t;
+    }
+    qsort(items, count, sizeof(split_item_t), compare_items);
+    bucket_init(buffer_page(index->pool, first), low_id, (uint16_t)(depth + 1));
+    bucket_init(buffer_page(index->pool, high), high_id, (uint16_t)(depth + 1));
+
+    chain_writer_t halves[2] = {{first, first, spare, &spares}, {high, high, spare, &spares}};
+    uint32_t       moved     = 0;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        chain_writer_t* half = &halves[(items[i].hash >> depth) & 1];
+        ok                   = writer_add(index, half, arena + items[i].offset, items[i].len);
+        moved += (items[i].hash >> depth) & 1;
+    }
+
+    /* Both halves get filters of the entries they now hold */
+    bloom_t* filters[2] = {filter_create(count - moved), filter_create(moved)};
+    for (uint32_t i = 0; i < count; i++) {
+        bloom_t* filter = filters[(items[i].hash >> depth) & 1];
+        if (filter)
+            bloom_add(filter, filter_hash(items[i].hash));
+    }
+    filter_set(index, low_id, filters[0]);
+    filter_set(index, high_id, filters[1]);
+    filter_reclaim(index);
+    for (int h = 0; h < 2; h++) {
+        if (halves[h].tail != halves[h].first)
+            page_release(index, halves[h].tail, BUFFER_LOCK_EXCLUSIVE, true);
+    }
+    buffer_mark_dirty(index->pool, first);
+    page_release(index, high, BUFFER_LOCK_EXCLUSIVE, true);
+
+    /* Overflow pages no longer needed become free */
+    while (ok && spares > 0) {
+        page_id_t   free_id = spare[--spares];
+        buffer_id_t f       = page_acquire(index, free_id, BUFFER_LOCK_EXCLUSIVE);
+        ok                  = f >= 0;
+        if (ok) {
+            void* page = buffer_page(index->pool, f);
+            bucket_init(page, free_id, 0);
+            bucket_special(page)->overflow = index->meta.free_head;
+            index->meta.free_head          = free_id;
+            page_release(index, f, BUFFER_LOCK_EXCLUSIVE, true);
+        }
+    }
+    free(arena);
+    free(items);
+    free(spare);
+
+    /* Directory entries with the new bit set now name the new bucket */
+    uint32_t low = hash & ((1u << depth) - 1);
+    for (uint32_t i = low | (1u << depth); i < (1u << index->meta.global_depth);
+         i += 2u << depth)
+        index->dir[i] = high_id;
+
+    index->meta.buckets++;
+    index->splits++;
+    return ok && dir_store(index, low | (1u << depth), 2u << depth) && meta_store(index);
+}
+
+/*
+ * Insert an entry. The common case shares the directory and locks only the
+ * bucket; a full bucket takes the directory exclusively and splits it, or
+ * chains an overflow page when no split could make room.
+ */
+static bool insert_entry(hash_index_t* index, const probe_t* probe, const void* value,
+                         uint16_t value_len) {
+    uint8_t  entry[ENTRY_HEADER + HASH_INDEX_MAX_ENTRY_SIZE];
+    uint16_t entry_len = make_entry(entry, probe, value, value_len);
+
+    sync_rwlock_rdlock(&index->lock);
+    page_id_t       page_id = index->dir[dir_slot(index, probe->hash)];
+    buffer_id_t     buf     = page_acquire(index, page_id, BUFFER_LOCK_EXCLUSIVE);
+    insert_result_t result  = INSERT_ERROR;
+    if (buf >= 0) {
+        filter_add(index, page_id, probe->hash);
+        result = chain_insert(index, buf, probe, entry, entry_len);
+    }
+    if (buf >= 0)
+        page_release(index, buf, BUFFER_LOCK_EXCLUSIVE, result == INSERT_DONE);
+    sync_rwlock_rdunlock(&index->lock);
+    if (result != INSERT_FULL)
+        return result == INSERT_DONE;
+
+    sync_rwlock_wrlock(&index->lock);
+    while (result == INSERT_FULL) {
+        page_id = index->dir[dir_slot(index, probe->hash)];
+        buf     = page_acquire(index, page_id, BUFFER_LOCK_EXCLUSIVE);
+        if (buf < 0) {
+            result = INSERT_ERROR;
+            break;
+        }
+
+        filter_add(index, page_id, probe->hash);
+        result = chain_insert(index, buf, probe, entry, entry_len);
+        if (result == INSERT_FULL) {
+            uint16_t depth = bucket_special(buffer_page(index->pool, buf))->depth;
+            if (depth < HASH_INDEX_MAX_DEPTH && chain_separable(index, buf, probe->hash)) {
+                if (!bucket_split(index, buf, probe->hash, depth))
+                    result = INSERT_ERROR;
+            } else {
+                result = chain_extend(index, buf, entry, entry_len) ? INSERT_DONE : INSERT_ERROR;
+            }
+        }
+        page_release(index, buf, BUFFER_LOCK_EXCLUSIVE, result == INSERT_DONE);
+    }
+    sync_rwlock_wrunlock(&index->lock);
+    return result == INSERT_DONE;
+}
+
+/* Delete the entry a probe matches */
+static bool delete_entry(hash_index_t* index, const probe_t* probe) {
+    bool found = false;
+
+    sync_rwlock_rdlock(&index->lock);
+    buffer_id_t first =
+        page_acquire(index, index->dir[dir_slot(index, probe->hash)], BUFFER_LOCK_EXCLUSIVE);
+    buffer_id_t buf = first;
+    while (buf >= 0) {
+        void* page = buffer_page(index->pool, buf);
+        int   slot = find_entry(page, probe);
+        if (slot >= 0) {
+            uint16_t len;
+            page_get_item(page, (uint16_t)slot, &len);
+            page_remove_item_at(page, (uint16_t)slot);
+            bucket_special(page)->garbage = (uint16_t)(bucket_special(page)->garbage + len);
+            found                         = true;
+        }
+
+        page_id_t next = bucket_special(page)->overflow;
+        if (buf != first)
+            page_release(index, buf, BUFFER_LOCK_EXCLUSIVE, slot >= 0);
+        if (found || next == INVALID_PAGE_ID)
+            break;
+        buf = page_acquire(index, next, BUFFER_LOCK_EXCLUSIVE);
+    }
+    if (first >= 0)
+        page_release(index, first, BUFFER_LOCK_EXCLUSIVE, found && buf == first);
+    sync_rwlock_rdunlock(&index->lock);
+    return found;
+}
+
+static bool valid_entry(const void* key, uint16_t key_len, const void* value, uint16_t value_len) {
+    return (key || key_len == 0) && (value || value_len == 0) &&
+           key_len <= HASH_INDEX_MAX_KEY_SIZE &&
+           (uint32_t)key_len + value_len <= HASH_INDEX_MAX_ENTRY_SIZE;
+}
+
+hash_index_t* hash_index_open(buffer_pool_t* pool, const char* path) {
+    if (!pool || !path)
+        return NULL;
+
+    hash_index_t* index = (hash_index_t*)calloc(1, sizeof(hash_index_t));
+    if (!index)
+        return NULL;
+
+    index->pool = pool;
+    index->file = disk_manager_open(path);
+    if (!index->file) {
+        free(index);
+        return NULL;
+    }
+    sync_rwlock_init(&index->lock);
+    sync_mutex_init(&index->retired_lock);
+
+    bool ok = true;
+    if (disk_manager_num_pages(index->file) == 0) {
+        /* New index: meta page, one directory page and a single bucket of depth 0 */
+        page_id_t   meta_id, dir_id, bucket_id;
+        buffer_id_t meta   = buffer_extend(pool, index->file, NULL, &meta_id);
+        buffer_id_t dir    = meta >= 0 ? buffer_extend(pool, index->file, NULL, &dir_id) : -1;
+        buffer_id_t bucket = dir >= 0 ? buffer_extend(pool, index->file, NULL, &bucket_id) : -1;
+        index->dir         = (page_id_t*)malloc(sizeof(page_id_t));
+        ok                 = bucket >= 0 && index->dir && meta_id == HASH_META_PAGE;
+        if (ok) {
+            index->meta         = (hash_meta_t){HASH_MAGIC, 0, 1, 0, INVALID_PAGE_ID, 1};
+            index->dir_pages[0] = dir_id;
+            index->dir[0]       = bucket_id;
+            page_init(buffer_page(pool, meta), meta_id, PAGE_TYPE_META, 0);
+            page_init(buffer_page(pool, dir), dir_id, PAGE_TYPE_META, 0);
+            bucket_init(buffer_page(pool, bucket), bucket_id, 0);
+            buffer_mark_dirty(pool, dir);
+            buffer_mark_dirty(pool, bucket);
+        }
+        if (meta >= 0) {
+            buffer_mark_dirty(pool, meta);
+            buffer_release(pool, meta);
+        }
+        if (dir >= 0)
+            buffer_release(pool, dir);
+        if (bucket >= 0)
+            buffer_release(pool, bucket);
+        ok = ok && meta_store(index) && dir_store(index, 0, 1);
+    } else {
+        buffer_id_t buf = buffer_read(pool, index->file, HASH_META_PAGE, NULL);
+        ok              = buf >= 0;
+        if (ok) {
+            const char* data = (const char*)buffer_page(pool, buf) + sizeof(page_header_t);
+            memcpy(&index->meta, data, sizeof(hash_meta_t));
+            ok = index->meta.magic == HASH_MAGIC &&
+                 index->meta.global_depth <= HASH_INDEX_MAX_DEPTH &&
+                 index->meta.dir_pages <= META_MAX_DIR_PAGES;
+            if (ok)
+                memcpy(index->dir_pages, data + sizeof(hash_meta_t),
+                       index->meta.dir_pages * sizeof(page_id_t));
+            buffer_release(pool, buf);
+        }
+
+        uint32_t size = ok ? 1u << index->meta.global_depth : 0;
+        index->dir    = ok ? (page_id_t*)malloc(size * sizeof(page_id_t)) : NULL;
+        ok            = ok && index->dir;
+        for (uint32_t p = 0; ok && p * DIR_PER_PAGE < size; p++) {
+            buf = buffer_read(pool, index->file, index->dir_pages[p], NULL);
+            ok  = buf >= 0;
+            if (ok) {
+                uint32_t n = size - p * DIR_PER_PAGE < DIR_PER_PAGE ? size - p * DIR_PER_PAGE
+                                                                    : DIR_PER_PAGE;
+                memcpy(index->dir + p * DIR_PER_PAGE,
+                       (const char*)buffer_page(pool, buf) + sizeof(page_header_t),
+                       n * sizeof(page_id_t));
+                buffer_release(pool, buf);
+            }
+        }
+    }
+
+    /* Bucket filters are built as lookups read the buckets */
+    ok = ok && filter_reserve(index, disk_manager_num_pages(index->file));
+    if (!ok) {
+        hash_index_close(index);
+        return NULL;
+    }
+    return index;
+}
+
+void hash_index_close(hash_index_t* index) {
+    if (!index)
+        return;
+
+    buffer_drop_file(index->pool, index->file);
+    disk_manager_close(index->file);
+    sync_rwlock_destroy(&index->lock);
+    for (uint32_t i = 0; i < index->filter_slots; i++)
+        bloom_destroy(atomic_load(&index->filters[i]));
+    filter_reclaim(index);
+    sync_mutex_destroy(&index->retired_lock);
+    free(index->filters);
+    free(index->retired);
+    free(index->dir);
+    free(index);
+}
+
+disk_manager_t* hash_index_file(const hash_index_t* index) { return index->file; }
+
+bool hash_index_insert(hash_index_t* index, const void* key, uint16_t key_len, const void* value,
+                       uint16_t value_len) {
+    if (!index || !valid_entry(key, key_len, value, value_len))
+        return false;
+
+    /* The key alone must be new, whatever its value */
+    probe_t probe = {hash_bytes(key, key_len), key, key_len, NULL, 0};
+    return insert_entry(index, &probe, value, value_len);
+}
+
+bool hash_index_delete(hash_index_t* index, const void* key, uint16_t key_len) {
+    if (!index || (!key && key_len > 0))
+        return false;
+
+    probe_t probe = {hash_bytes(key, key_len), key, key_len, NULL, 0};
+    return delete_entry(index, &probe);
+}
+
+bool hash_index_get(hash_index_t* index, const void* key, uint16_t key_len, void* buf,
+                    uint16_t buf_size, uint16_t* len) {
+    if (!index || (!key && key_len > 0))
+        return false;
+
+    probe_t probe = {hash_bytes(key, key_len), key, key_len, NULL, 0};
+    bool    found = false;
+
+    sync_rwlock_rdlock(&index->lock);
+    page_id_t bucket  = index->dir[dir_slot(index, probe.hash)];
+    bloom_t*  filter  = filter_of(index, bucket);
+    bool      maybe   = filter && filter_check(index, filter, probe.hash);
+    page_id_t page_id = filter && !maybe ? INVALID_PAGE_ID : bucket;
+    while (!found && page_id != INVALID_PAGE_ID) {
+        buffer_id_t page_buf = page_acquire(index, page_id, BUFFER_LOCK_SHARE);
+        if (page_buf < 0)
+            break;
+
+        void* page = buffer_page(index->pool, page_buf);
+        int   slot = find_entry(page, &probe);
+        if (!filter && page_id == bucket)
+            filter_build(index, bucket, page);
+        if (slot >= 0) {
+            uint16_t       entry_len;
+            const uint8_t* entry = (const uint8_t*)page_get_item(page, (uint16_t)slot, &entry_len);
+            uint16_t       value_len = (uint16_t)(entry_len - ENTRY_HEADER - key_len);
+            if (buf)
+                memcpy(buf, entry + ENTRY_HEADER + key_len,
+                       value_len < buf_size ? value_len : buf_size);
+            if (len)
+                *len = value_len;
+            found = true;
+        }
+        page_id = bucket_special(page)->overflow;
+        page_release(index, page_buf, BUFFER_LOCK_SHARE, false);
+    }
+    if (maybe && !found)
+        atomic_fetch_add_explicit(&index->filter_false_positives, 1, memory_order_relaxed);
+    sync_rwlock_rdunlock(&index->lock);
+    return found;
+}
+
+void hash_index_get_stats(hash_index_t* index, hash_index_stats_t* stats) {
+    if (!index || !stats)
+        return;
+
+    sync_rwlock_rdlock(&index->lock);
+    stats->global_depth   = index->meta.global_depth;
+    stats->buckets        = index->meta.buckets;
+    stats->overflow_pages = index->meta.overflow_pages;
+    stats->splits         = index->splits;
+    stats->doublings      = index->doublings;
+    stats->filters        = 0;
+    stats->filter_memory  = 0;
+    for (uint32_t i = 0; i < index->filter_slots; i++) {
+        const bloom_t* filter = atomic_load_explicit(&index->filters[i], memory_order_acquire);
+        if (filter) {
+            stats->filters++;
+            stats->filter_memory += bloom_memory(filter);
+        }
+    }
+    stats->filter_negatives = atomic_load_explicit(&index->filter_negatives, memory_order_relaxed);
+    stats->filter_false_positives =
+        atomic_load_explicit(&index->filter_false_positives, memory_order_relaxed);
+    sync_rwlock_rdunlock(&index->lock);
+}
+
+/* Secondary index entries: the key, with the big-endian tuple ID as value */
+static bool hash_index_ops_insert(void* state, const void* key, uint16_t key_len,
+                                  tuple_id_t tid) {
+    uint8_t value[KEY_TID_SIZE];
+    if (!valid_entry(key, key_len, NULL, 0) ||
+        key_len > HASH_INDEX_MAX_ENTRY_SIZE - KEY_TID_SIZE)
+        return false;
+    key_put_tid(value, tid);
+
+    /* A key may repeat with other tuple IDs; only the same key and tuple ID is a duplicate */
+    probe_t probe = {hash_bytes(key, key_len), key, key_len, value, KEY_TID_SIZE};
+    return insert_entry((hash_index_t*)state, &probe, value, KEY_TID_SIZE);
+}
+
+static bool hash_index_ops_remove(void* state, const void* key, uint16_t key_len,
+                                  tuple_id_t tid) {
+    uint8_t value[KEY_TID_SIZE];
+    if (!key && key_len > 0)
+        return false;
+    key_put_tid(value, tid);
+
+    probe_t probe = {hash_bytes(key, key_len), key, key_len, value, KEY_TID_SIZE};
+    return delete_entry((hash_index_t*)state, &probe);
+}
+
+/*
+ * Visit the tuple IDs of a key. They are collected under the locks and
+ * visited after, so a visitor may change the index.
+ */
+static bool hash_index_ops_lookup(void* state, const void* key, uint16_t key_len,
+                                  index_visit_fn visit, void* arg) {
+    hash_index_t* index = (hash_index_t*)state;
+    if (!key && key_len > 0)
+        return false;
+
+    probe_t     probe = {hash_bytes(key, key_len), key, key_len, NULL, 0};
+    tuple_id_t  local[16];
+    tuple_id_t* tids  = local;
+    uint32_t    count = 0, capacity = 16;
+    bool        ok    = true;
+
+    sync_rwlock_rdlock(&index->lock);
+    page_id_t bucket  = index->dir[dir_slot(index, probe.hash)];
+    bloom_t*  filter  = filter_of(index, bucket);
+    bool      maybe   = filter && filter_check(index, filter, probe.hash);
+    page_id_t page_id = filter && !maybe ? INVALID_PAGE_ID : bucket;
+    while (ok && page_id != INVALID_PAGE_ID) {
+        buffer_id_t buf = page_acquire(index, page_id, BUFFER_LOCK_SHARE);
+        if (buf < 0) {
+            ok = false;
+            break;
+        }
+
+        void*    page  = buffer_page(index->pool, buf);
+        uint16_t slots = page_num_slots(page);
+        if (!filter && page_id == bucket)
+            filter_build(index, bucket, page);
+        for (uint16_t slot = lower_bound(page, probe.hash); ok && slot < slots; slot++) {
+            uint16_t       len;
+            const uint8_t* entry = (const uint8_t*)page_get_item(page, slot, &len);
+            if (entry_hash(entry) != probe.hash)
+                break;
+            if (entry_key_len(entry) != key_len || len != ENTRY_HEADER + key_len + KEY_TID_SIZE ||
+                memcmp(entry + ENTRY_HEADER, key, key_len) != 0)
+                continue;
+
+            if (count == capacity) {
+                tuple_id_t* grown = (tuple_id_t*)malloc(2 * capacity * sizeof(tuple_id_t));
+                ok                = grown != NULL;
+                if (!ok)
+                    break;
+                memcpy(grown, tids, count * sizeof(tuple_id_t));
+                if (tids != local)
+                    free(tids);
+                tids = grown;
+                capacity *= 2;
+            }
+            tids[count++] = key_get_tid(entry + ENTRY_HEADER + key_len);
+        }
+        page_id = bucket_special(page)->overflow;
+        page_release(index, buf, BUFFER_LOCK_SHARE, false);
+    }
+    if (maybe && ok && count == 0)
+        atomic_fetch_add_explicit(&index->filter_false_positives, 1, memory_order_relaxed);
+    sync_rwlock_rdunlock(&index->lock);
+
+    for (uint32_t i = 0; ok && i < count; i++) {
+        if (!visit(tids[i], arg))
+            break;
+    }
+    if (tids != local)
+        free(tids);
+    return ok;
+}
+
+static void hash_index_ops_close(void* state) { hash_index_close((hash_index_t*)state); }
+
+const index_ops_t hash_index_ops = {hash_index_ops_insert, hash_index_ops_remove,
+                                    hash_index_ops_lookup, hash_index_ops_close,
+                                    NULL,                  NULL};
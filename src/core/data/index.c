@@ -0,0 +1,240 @@
+/**
+ * @file index.c
+ * @brief Implementation of the generic index interface
+ */
+
+#include <monodb/core/data/index.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_NAME_LEN 64
+
+/**
+ * Index structure
+ */
+struct index_t {
+    char               name[INDEX_NAME_LEN]; /* Index name */
+    const index_ops_t* ops;                  /* Access method callbacks */
+    void*              state;                /* Access method instance */
+    index_key_fn       key_fn;               /* Key extractor */
+    void*              key_arg;              /* Key extractor argument */
+    index_key_fn       include_fn;           /* INCLUDE payload extractor, or NULL */
+    void*              include_arg;          /* Payload extractor argument */
+    index_predicate_t  where;                /* Predicate of a partial index, fn NULL if none */
+
+    /* Statistics */
+    _Atomic uint64_t inserts;
+    _Atomic uint64_t removes;
+    _Atomic uint64_t lookups;
+    _Atomic uint64_t tuples;
+};
+
+index_t* index_create(const char* name, const index_ops_t* ops, void* state, index_key_fn key_fn,
+                      void* key_arg) {
+    if (!name || !ops || !ops->insert || !ops->remove || !ops->lookup || !key_fn)
+        return NULL;
+
+    index_t* index = (index_t*)calloc(1, sizeof(index_t));
+    if (!index)
+        return NULL;
+
+    strncpy(index->name, name, INDEX_NAME_LEN - 1);
+    index->ops     = ops;
+    index->state   = state;
+    index->key_fn  = key_fn;
+    index->key_arg = key_arg;
+
+    return index;
+}
+
+void index_destroy(index_t* index) {
+    if (!index)
+        return;
+
+    if (index->ops->close)
+        index->ops->close(index->state);
+    free(index);
+}
+
+const char* index_name(const index_t* index) { return index->name; }
+
+bool index_set_include(index_t* index, index_key_fn include_fn, void* include_arg) {
+    if (!index || !include_fn || !index->ops->insert_covering || !index->ops->lookup_covering)
+        return false;
+
+    index->include_fn  = include_fn;
+    index->include_arg = include_arg;
+    return true;
+}
+
+bool index_is_covering(const index_t* index) { return index->include_fn != NULL; }
+
+bool index_set_predicate(index_t* index, index_predicate_fn where_fn, void* where_arg) {
+    if (!index || !where_fn)
+        return false;
+
+    index->where = (index_predicate_t){where_fn, where_arg};
+    return true;
+}
+
+bool index_is_partial(const index_t* index) { return index->where.fn != NULL; }
+
+bool index_predicate_implied(index_predicate_t where, const index_predicate_t* conditions,
+                             uint32_t num_conditions) {
+    for (uint32_t i = 0; i < num_conditions; i++) {
+        if (conditions[i].fn == where.fn && conditions[i].arg == where.arg)
+            return true;
+    }
+    return false;
+}
+
+bool index_matches(const index_t* index, index_key_fn expr, void* expr_arg,
+                   const index_predicate_t* conditions, uint32_t num_conditions) {
+    if (!index || index->key_fn != expr || index->key_arg != expr_arg)
+        return false;
+    return !index->where.fn || index_predicate_implied(index->where, conditions, num_conditions);
+}
+
+bool index_extract_key(const index_t* index, const void* tuple, uint16_t len, void* key,
+                       uint16_t* key_len) {
+    /* Tuples outside a partial index have no key, so they are never indexed */
+    if (index->where.fn && !index->where.fn(tuple, len, index->where.arg))
+        return false;
+    return index->key_fn(tuple, len, key, key_len, index->key_arg);
+}
+
+void index_extract_include(const index_t* index, const void* tuple, uint16_t len, void* payload,
+                           uint16_t* payload_len) {
+    *payload_len = 0;
+    if (index->include_fn &&
+        !index->include_fn(tuple, len, payload, payload_len, index->include_arg))
+        *payload_len = 0;
+}
+
+bool index_key_equal(const index_t* index, const void* old_tuple, uint16_t old_len,
+                     const void* new_tuple, uint16_t new_len) {
+    uint8_t  old_key[INDEX_MAX_KEY_SIZE];
+    uint8_t  new_key[INDEX_MAX_KEY_SIZE];
+    uint16_t old_key_len = 0;
+    uint16_t new_key_len = 0;
+
+    bool has_old = index_extract_key(index, old_tuple, old_len, old_key, &old_key_len);
+    bool has_new = index_extract_key(index, new_tuple, new_len, new_key, &new_key_len);
+
+    if (has_old != has_new)
+        return false;
+    if (!has_old)
+        return true;
+    if (old_key_len != new_key_len || memcmp(old_key, new_key, old_key_len) != 0)
+        return false;
+    if (!index->include_fn)
+        return true;
+
+    /* A changed INCLUDE column makes the stored payload stale, like a changed key */
+    index_extract_include(index, old_tuple, old_len, old_key, &old_key_len);
+    index_extract_include(index, new_tuple, new_len, new_key, &new_key_len);
+    return old_key_len == new_key_len && memcmp(old_key, new_key, old_key_len) == 0;
+}
+
+bool index_insert_tuple(index_t* index, const void* tuple, uint16_t len, tuple_id_t tid) {
+    uint8_t  key[INDEX_MAX_KEY_SIZE];
+    uint16_t key_len;
+
+    if (!index_extract_key(index, tuple, len, key, &key_len))
+        return true;
+
+    atomic_fetch_add(&index->inserts, 1);
+    if (!index->include_fn)
+        return index->ops->insert(index->state, key, key_len, tid);
+
+    uint8_t  payload[INDEX_MAX_INCLUDE_SIZE];
+    uint16_t payload_len;
+    index_extract_include(index, tuple, len, payload, &payload_len);
+    return index->ops->insert_covering(index->state, key, key_len, tid, payload, payload_len);
+}
+
+bool index_remove_tuple(index_t* index, const void* tuple, uint16_t len, tuple_id_t tid) {
+    uint8_t  key[INDEX_MAX_KEY_SIZE];
+    uint16_t key_len;
+
+    if (!index_extract_key(index, tuple, len, key, &key_len))
+        return true;
+
+    atomic_fetch_add(&index->removes, 1);
+    return index->ops->remove(index->state, key, key_len, tid);
+}
+
+/**
+ * Adapter counting the matches of a lookup
+ */
+typedef struct {
+    index_visit_fn visit;
+    index_cover_fn cover;
+    void*          arg;
+    uint64_t       tuples;
+} count_adapter_t;
+
+static bool visit_counted(tuple_id_t tid, void* arg) {
+    count_adapter_t* adapter = (count_adapter_t*)arg;
+    adapter->tuples++;
+    return adapter->visit(tid, adapter->arg);
+}
+
+static bool visit_counted_covering(tuple_id_t tid, const void* payload, uint16_t payload_len,
+                                   void* arg) {
+    count_adapter_t* adapter = (count_adapter_t*)arg;
+    adapter->tuples++;
+    return adapter->cover(tid, payload, payload_len, adapter->arg);
+}
+
+bool index_lookup(index_t* index, const void* key, uint16_t key_len, index_visit_fn visit,
+                  void* arg) {
+    if (!index || (!key && key_len > 0) || !visit)
+        return false;
+
+    count_adapter_t counter = {visit, NULL, arg, 0};
+    atomic_fetch_add(&index->lookups, 1);
+    bool ok = index->ops->lookup(index->state, key, key_len, visit_counted, &counter);
+    atomic_fetch_add(&index->tuples, counter.tuples);
+    return ok;
+}
+
+/**
+ * Adapter passing plain lookup matches on with an empty payload
+ */
+typedef struct {
+    index_cover_fn visit;
+    void*          arg;
+} cover_adapter_t;
+
+static bool visit_uncovered(tuple_id_t tid, void* arg) {
+    cover_adapter_t* adapter = (cover_adapter_t*)arg;
+    return adapter->visit(tid, NULL, 0, adapter->arg);
+}
+
+bool index_lookup_covering(index_t* index, const void* key, uint16_t key_len,
+                           index_cover_fn visit, void* arg) {
+    if (!index || (!key && key_len > 0) || !visit)
+        return false;
+
+    count_adapter_t counter = {NULL, visit, arg, 0};
+    bool            ok;
+    atomic_fetch_add(&index->lookups, 1);
+    if (index->ops->lookup_covering) {
+        ok = index->ops->lookup_covering(index->state, key, key_len, visit_counted_covering,
+                                         &counter);
+    } else {
+        cover_adapter_t adapter = {visit_counted_covering, &counter};
+        ok = index->ops->lookup(index->state, key, key_len, visit_uncovered, &adapter);
+    }
+    atomic_fetch_add(&index->tuples, counter.tuples);
+    return ok;
+}
+
+void index_get_stats(index_t* index, index_stats_t* stats) {
+    stats->inserts = atomic_load(&index->inserts);
+    stats->removes = atomic_load(&index->removes);
+    stats->lookups = atomic_load(&index->lookups);
+    stats->tuples  = atomic_load(&index->tuples);
+}
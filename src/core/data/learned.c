@@ -0,0 +1,548 @@
+/**
+ * @file learned.c
+ * @brief Implementation of the learned index
+ *
+ * The model is fit to the first position of each distinct key with a
+ * shrinking cone: a segment starts at a key, and the range of slopes that
+ * keeps every key seen since within the error of its position narrows with
+ * each key added; the key that would empty the range starts the next
+ * segment. Any slope left in the range is valid, and the middle one is
+ * kept. Since a key's lower bound always lies between the first positions
+ * of the keys on either side of it, a lookup clamps the prediction to its
+ * segment and widens the window to the whole segment in the rare case a
+ * run of duplicates pushes the bound outside it.
+ *
+ * The radix table maps the top bits of key - min_key to the segments whose
+ * first key falls below the start of each radix bucket, so locating a
+ * segment costs one table load and a binary search over the few segments
+ * of one bucket.
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/data/key.h>
+#include <monodb/core/data/learned.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Radix table size bounds, in bits */
+#define RADIX_MIN_BITS 4
+#define RADIX_MAX_BITS 20
+
+/**
+ * Linear segment of the model
+ */
+typedef struct {
+    uint64_t first; /* First key of the segment */
+    double   slope; /* Positions per key unit */
+    size_t   start; /* Position of the first key */
+} segment_t;
+
+/**
+ * Model of a sorted entry array
+ */
+typedef struct {
+    segment_t* segments;
+    uint32_t   num_segments;
+    uint32_t*  radix; /* radix_size + 1 segment indexes */
+    uint32_t   radix_size;
+    uint32_t   shift;   /* Bits of key - min_key below the radix bits */
+    uint64_t   min_key; /* Key of the first entry */
+} model_t;
+
+struct learned_index_t {
+    sync_rwlock_t    lock; /* Shared by lookups, exclusive for changes */
+    uint32_t         error;
+    learned_entry_t* entries; /* Sorted by key, then value */
+    size_t           count;
+    model_t          model;
+
+    /* Changes not yet merged, each sorted by key, then value */
+    learned_entry_t* inserted;
+    uint32_t         num_inserted;
+    learned_entry_t* removed; /* Entries of the array that no longer exist */
+    uint32_t         num_removed;
+
+    uint64_t rebuilds;
+};
+
+static int compare_entry(const learned_entry_t* a, uint64_t key, uint64_t value) {
+    if (a->key != key)
+        return a->key < key ? -1 : 1;
+    return (a->value > value) - (a->value < value);
+}
+
+static int compare_entries(const void* a, const void* b) {
+    const learned_entry_t* y = (const learned_entry_t*)b;
+    return compare_entry((const learned_entry_t*)a, y->key, y->value);
+}
+
+/* First position in [lo, hi) whose entry is not below (key, value) */
+static size_t entry_lower_bound(const learned_entry_t* entries, size_t lo, size_t hi, uint64_t key,
+                                uint64_t value) {
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare_entry(&entries[mid], key, value) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Whether a sorted delta array holds an entry; pos receives where it is or would go */
+static bool delta_find(const learned_entry_t* delta, uint32_t n, uint64_t key, uint64_t value,
+                       uint32_t* pos) {
+    size_t at = entry_lower_bound(delta, 0, n, key, value);
+    *pos      = (uint32_t)at;
+    return at < n && compare_entry(&delta[at], key, value) == 0;
+}
+
+static void delta_insert(learned_entry_t* delta, uint32_t* n, uint32_t pos, uint64_t key,
+                         uint64_t value) {
+    memmove(delta + pos + 1, delta + pos, (*n - pos) * sizeof(learned_entry_t));
+    delta[pos] = (learned_entry_t){key, value};
+    (*n)++;
+}
+
+static void delta_erase(learned_entry_t* delta, uint32_t* n, uint32_t pos) {
+    memmove(delta + pos, delta + pos + 1, (*n - pos - 1) * sizeof(learned_entry_t));
+    (*n)--;
+}
+
+static void model_free(model_t* model) {
+    free(model->segments);
+    free(model->radix);
+    memset(model, 0, sizeof(*model));
+}
+
+/* Radix bucket of a key at or above min_key */
+static uint32_t radix_bucket(const model_t* model, uint64_t key) {
+    uint64_t bucket = (key - model->min_key) >> model->shift;
+    return bucket < model->radix_size ? (uint32_t)bucket : model->radix_size - 1;
+}
+
+/* Fit the segments of a sorted entry array and index them by radix */
+static bool model_build(model_t* model, const learned_entry_t* entries, size_t count,
+                        uint32_t error) {
+    memset(model, 0, sizeof(*model));
+    if (count == 0)
+        return true;
+
+    uint32_t capacity = 16;
+    model->segments   = (segment_t*)malloc(capacity * sizeof(segment_t));
+    if (!model->segments)
+        return false;
+
+    for (size_t i = 0; i < count;) {
+        double lo = 0, hi = INFINITY;
+        size_t j  = i + 1;
+        for (; j < count; j++) {
+            if (entries[j].key == entries[j - 1].key)
+                continue;
+            double dx      = (double)(entries[j].key - entries[i].key);
+            double dy      = (double)(j - i);
+            double next_lo = (dy - error) / dx > lo ? (dy - error) / dx : lo;
+            double next_hi = (dy + error) / dx < hi ? (dy + error) / dx : hi;
+            if (next_lo > next_hi)
+                break;
+            lo = next_lo;
+            hi = next_hi;
+        }
+
+        if (model->num_segments == capacity) {
+            capacity *= 2;
+            segment_t* grown = (segment_t*)realloc(model->segments, capacity * sizeof(segment_t));
+            if (!grown) {
+                model_free(model);
+                return false;
+            }
+            model->segments = grown;
+        }
+        model->segments[model->num_segments++] =
+            (segment_t){entries[i].key, isinf(hi) ? 0.0 : (lo + hi) / 2, i};
+        i = j;
+    }
+
+    /* Enough radix buckets for about two per segment */
+    uint32_t bits = RADIX_MIN_BITS;
+    while (bits < RADIX_MAX_BITS && (1u << bits) < 2 * model->num_segments)
+        bits++;
+    uint64_t range     = entries[count - 1].key - entries[0].key;
+    uint32_t span      = 0;
+    while (span < 64 && (range >> span) != 0)
+        span++;
+    model->min_key    = entries[0].key;
+    model->shift      = span > bits ? span - bits : 0;
+    model->radix_size = 1u << bits;
+    model->radix      = (uint32_t*)malloc((model->radix_size + 1) * sizeof(uint32_t));
+    if (!model->radix) {
+        model_free(model);
+        return false;
+    }
+
+    uint32_t s = 0;
+    for (uint32_t b = 0; b <= model->radix_size; b++) {
+        while (s + 1 < model->num_segments &&
+               (b == model->radix_size || radix_bucket(model, model->segments[s + 1].first) < b))
+            s++;
+        model->radix[b] = s;
+    }
+    return true;
+}
+
+/* Position of the first array entry whose key is not below key */
+static size_t key_lower_bound(const learned_index_t* index, uint64_t key) {
+    const model_t* model = &index->model;
+    if (index->count == 0 || key <= model->min_key)
+        return 0;
+
+    /* Last segment whose first key is not above key, among those of its radix bucket */
+    uint32_t b  = radix_bucket(model, key);
+    uint32_t lo = model->radix[b], hi = model->radix[b + 1];
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (model->segments[mid].first <= key)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    const segment_t* seg = &model->segments[lo];
+    size_t           end = lo + 1 < model->num_segments ? model->segments[lo + 1].start
+                                                        : index->count;
+
+    /* Predict, clamp to the segment, and search the window the error allows */
+    double predicted = (double)seg->start + seg->slope * (double)(key - seg->first);
+    size_t pos       = predicted >= (double)end ? end : (size_t)predicted;
+    size_t first     = pos > seg->start + index->error ? pos - index->error : seg->start;
+    size_t last      = pos + index->error + 1 < end ? pos + index->error + 1 : end;
+    if (first > seg->start && index->entries[first - 1].key >= key)
+        first = seg->start;
+    if (last < end && index->entries[last - 1].key < key)
+        last = end;
+    return entry_lower_bound(index->entries, first, last, key, 0);
+}
+
+/* Whether the array holds an entry that has not been removed */
+static bool base_contains(const learned_index_t* index, uint64_t key, uint64_t value) {
+    size_t   pos = entry_lower_bound(index->entries, key_lower_bound(index, key), index->count,
+                                     key, value);
+    uint32_t at;
+    return pos < index->count && compare_entry(&index->entries[pos], key, value) == 0 &&
+           !delta_find(index->removed, index->num_removed, key, value, &at);
+}
+
+/* Merge the deltas into a new array and model, replacing the old ones. Called exclusively. */
+static bool compact_locked(learned_index_t* index) {
+    size_t           count   = index->count - index->num_removed + index->num_inserted;
+    learned_entry_t* entries = (learned_entry_t*)malloc((count ? count : 1) *
+                                                        sizeof(learned_entry_t));
+    if (!entries)
+        return false;
+
+    size_t   n = 0, i = 0;
+    uint32_t a = 0, r = 0;
+    while (i < index->count || a < index->num_inserted) {
+        const learned_entry_t* base = i < index->count ? &index->entries[i] : NULL;
+        const learned_entry_t* ins  = a < index->num_inserted ? &index->inserted[a] : NULL;
+        if (base && (!ins || compare_entries(base, ins) < 0)) {
+            i++;
+            if (r < index->num_removed && compare_entries(base, &index->removed[r]) == 0)
+                r++;
+            else
+                entries[n++] = *base;
+        } else {
+            entries[n++] = *ins;
+            a++;
+        }
+    }
+
+    model_t model;
+    if (!model_build(&model, entries, n, index->error)) {
+        free(entries);
+        return false;
+    }
+    free(index->entries);
+    model_free(&index->model);
+    index->entries      = entries;
+    index->count        = n;
+    index->model        = model;
+    index->num_inserted = 0;
+    index->num_removed  = 0;
+    index->rebuilds++;
+    return true;
+}
+
+/* Compact once the deltas are full; a failed compaction leaves them full and the change fails */
+static bool delta_room(learned_index_t* index) {
+    if (index->num_inserted + index->num_removed < LEARNED_DELTA_MAX)
+        return true;
+    return compact_locked(index);
+}
+
+learned_index_t* learned_index_create(uint32_t error) {
+    learned_index_t* index = (learned_index_t*)calloc(1, sizeof(learned_index_t));
+    if (!index)
+        return NULL;
+
+    index->error    = error ? error : LEARNED_DEFAULT_ERROR;
+    index->inserted = (learned_entry_t*)malloc(LEARNED_DELTA_MAX * sizeof(learned_entry_t));
+    index->removed  = (learned_entry_t*)malloc(LEARNED_DELTA_MAX * sizeof(learned_entry_t));
+    if (!index->inserted || !index->removed) {
+        free(index->inserted);
+        free(index->removed);
+        free(index);
+        return NULL;
+    }
+    sync_rwlock_init(&index->lock);
+    return index;
+}
+
+void learned_index_destroy(learned_index_t* index) {
+    if (!index)
+        return;
+
+    sync_rwlock_destroy(&index->lock);
+    model_free(&index->model);
+    free(index->entries);
+    free(index->inserted);
+    free(index->removed);
+    free(index);
+}
+
+bool learned_index_load(learned_index_t* index, learned_entry_t* entries, size_t count) {
+    if (!index || (!entries && count > 0))
+        return false;
+
+    /* Rows of an append-only table usually arrive in order already */
+    for (size_t i = 1; i < count; i++) {
+        if (compare_entries(&entries[i - 1], &entries[i]) > 0) {
+            qsort(entries, count, sizeof(learned_entry_t), compare_entries);
+            break;
+        }
+    }
+
+    learned_entry_t* copy = (learned_entry_t*)malloc((count ? count : 1) *
+                                                     sizeof(learned_entry_t));
+    if (!copy)
+        return false;
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (n == 0 || compare_entries(&copy[n - 1], &entries[i]) != 0)
+            copy[n++] = entries[i];
+    }
+
+    model_t model;
+    if (!model_build(&model, copy, n, index->error)) {
+        free(copy);
+        return false;
+    }
+
+    sync_rwlock_wrlock(&index->lock);
+    free(index->entries);
+    model_free(&index->model);
+    index->entries      = copy;
+    index->count        = n;
+    index->model        = model;
+    index->num_inserted = 0;
+    index->num_removed  = 0;
+    index->rebuilds++;
+    sync_rwlock_wrunlock(&index->lock);
+    return true;
+}
+
+bool learned_index_insert(learned_index_t* index, uint64_t key, uint64_t value) {
+    if (!index)
+        return false;
+
+    sync_rwlock_wrlock(&index->lock);
+    uint32_t pos;
+    bool     ok = !delta_find(index->inserted, index->num_inserted, key, value, &pos) &&
+              !base_contains(index, key, value);
+    if (ok && delta_find(index->removed, index->num_removed, key, value, &pos)) {
+        /* The entry comes back: it is in the array again */
+        delta_erase(index->removed, &index->num_removed, pos);
+    } else if (ok) {
+        ok = delta_room(index);
+        if (ok) {
+            delta_find(index->inserted, index->num_inserted, key, value, &pos);
+            delta_insert(index->inserted, &index->num_inserted, pos, key, value);
+        }
+    }
+    sync_rwlock_wrunlock(&index->lock);
+    return ok;
+}
+
+bool learned_index_remove(learned_index_t* index, uint64_t key, uint64_t value) {
+    if (!index)
+        return false;
+
+    sync_rwlock_wrlock(&index->lock);
+    uint32_t pos;
+    bool     ok = true;
+    if (delta_find(index->inserted, index->num_inserted, key, value, &pos)) {
+        delta_erase(index->inserted, &index->num_inserted, pos);
+    } else {
+        ok = base_contains(index, key, value) && delta_room(index);
+        if (ok) {
+            delta_find(index->removed, index->num_removed, key, value, &pos);
+            delta_insert(index->removed, &index->num_removed, pos, key, value);
+        }
+    }
+    sync_rwlock_wrunlock(&index->lock);
+    return ok;
+}
+
+bool learned_index_get(learned_index_t* index, uint64_t key, uint64_t* value) {
+    if (!index)
+        return false;
+
+    sync_rwlock_rdlock(&index->lock);
+    bool     found = false;
+    uint64_t best  = 0;
+    for (size_t i = key_lower_bound(index, key); i < index->count && index->entries[i].key == key;
+         i++) {
+        uint32_t at;
+        if (index->num_removed == 0 ||
+            !delta_find(index->removed, index->num_removed, key, index->entries[i].value, &at)) {
+            best  = index->entries[i].value;
+            found = true;
+            break;
+        }
+    }
+    uint32_t pos;
+    delta_find(index->inserted, index->num_inserted, key, 0, &pos);
+    if (pos < index->num_inserted && index->inserted[pos].key == key &&
+        (!found || index->inserted[pos].value < best)) {
+        best  = index->inserted[pos].value;
+        found = true;
+    }
+    sync_rwlock_rdunlock(&index->lock);
+
+    if (found && value)
+        *value = best;
+    return found;
+}
+
+bool learned_index_lookup(learned_index_t* index, uint64_t key, learned_visit_fn visit, void* arg) {
+    if (!index || !visit)
+        return false;
+
+    uint64_t  local[16];
+    uint64_t* values = local;
+    size_t    count = 0, capacity = 16;
+    bool      ok    = true;
+
+    sync_rwlock_rdlock(&index->lock);
+    size_t   i = key_lower_bound(index, key);
+    uint32_t a;
+    delta_find(index->inserted, index->num_inserted, key, 0, &a);
+    for (;;) {
+        bool base = i < index->count && index->entries[i].key == key;
+        bool ins  = a < index->num_inserted && index->inserted[a].key == key;
+        if (!base && !ins)
+            break;
+
+        /* Merge the array's values with the inserted ones, in value order */
+        uint64_t value;
+        if (base && (!ins || index->entries[i].value < index->inserted[a].value)) {
+            value = index->entries[i++].value;
+            uint32_t at;
+            if (index->num_removed > 0 &&
+                delta_find(index->removed, index->num_removed, key, value, &at))
+                continue;
+        } else {
+            value = index->inserted[a++].value;
+        }
+
+        if (count == capacity) {
+            uint64_t* grown = (uint64_t*)malloc(2 * capacity * sizeof(uint64_t));
+            ok              = grown != NULL;
+            if (!ok)
+                break;
+            memcpy(grown, values, count * sizeof(uint64_t));
+            if (values != local)
+                free(values);
+            values = grown;
+            capacity *= 2;
+        }
+        values[count++] = value;
+    }
+    sync_rwlock_rdunlock(&index->lock);
+
+    for (size_t v = 0; ok && v < count; v++) {
+        if (!visit(values[v], arg))
+            break;
+    }
+    if (values != local)
+        free(values);
+    return ok;
+}
+
+bool learned_index_compact(learned_index_t* index) {
+    if (!index)
+        return false;
+
+    sync_rwlock_wrlock(&index->lock);
+    bool ok = compact_locked(index);
+    sync_rwlock_wrunlock(&index->lock);
+    return ok;
+}
+
+void learned_index_get_stats(learned_index_t* index, learned_stats_t* stats) {
+    if (!index || !stats)
+        return;
+
+    sync_rwlock_rdlock(&index->lock);
+    const model_t* model = &index->model;
+    stats->entries       = index->count - index->num_removed + index->num_inserted;
+    stats->segments      = model->num_segments;
+    stats->error         = index->error;
+    stats->model_memory  = (uint64_t)model->num_segments * sizeof(segment_t) +
+                          (model->radix ? (uint64_t)(model->radix_size + 1) * sizeof(uint32_t)
+                                        : 0);
+    stats->data_memory = ((uint64_t)index->count + 2 * LEARNED_DELTA_MAX) * sizeof(learned_entry_t);
+    stats->delta       = index->num_inserted + index->num_removed;
+    stats->rebuilds    = index->rebuilds;
+    sync_rwlock_rdunlock(&index->lock);
+}
+
+static bool learned_ops_insert(void* state, const void* key, uint16_t key_len, tuple_id_t tid) {
+    return key && key_len == 8 &&
+           learned_index_insert((learned_index_t*)state, key_get_u64((const uint8_t*)key),
+                                learned_tid_value(tid));
+}
+
+static bool learned_ops_remove(void* state, const void* key, uint16_t key_len, tuple_id_t tid) {
+    return key && key_len == 8 &&
+           learned_index_remove((learned_index_t*)state, key_get_u64((const uint8_t*)key),
+                                learned_tid_value(tid));
+}
+
+/**
+ * Tuple ID visitor of a secondary index lookup
+ */
+typedef struct {
+    index_visit_fn visit;
+    void*          arg;
+} tid_lookup_t;
+
+static bool visit_tid(uint64_t value, void* arg) {
+    tid_lookup_t* lookup = (tid_lookup_t*)arg;
+    tuple_id_t    tid    = {(page_id_t)(value >> 16), (uint16_t)value};
+    return lookup->visit(tid, lookup->arg);
+}
+
+static bool learned_ops_lookup(void* state, const void* key, uint16_t key_len,
+                               index_visit_fn visit, void* arg) {
+    if (!key || key_len != 8)
+        return false;
+    tid_lookup_t lookup = {visit, arg};
+    return learned_index_lookup((learned_index_t*)state, key_get_u64((const uint8_t*)key),
+                                visit_tid, &lookup);
+}
+
+static void learned_ops_close(void* state) { learned_index_destroy((learned_index_t*)state); }
+
+const index_ops_t learned_index_ops = {learned_ops_insert, learned_ops_remove, learned_ops_lookup,
+                                       learned_ops_close,  NULL,               NULL};
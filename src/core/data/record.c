@@ -0,0 +1,384 @@
+/**
+ * @file record.c
+ * @brief Implementation of the compact row format
+ *
+ * A layout and its arrays are one allocation. Encoding writes the bitmap
+ * and fixed area in place, then appends each variable-length field and
+ * records where it ends; decoding and the accessors only read the
+ * positions back. A dictionary column's value is encoded first, since
+ * whether it got a code decides whether its bytes take space in the row.
+ *
+ * A record schema is likewise one allocation holding its layout pointers,
+ * the defaults and their bytes; each version's layout is built from a
+ * prefix of the current column list, so adding a column rebuilds every
+ * layout of the new schema and leaves the old schema to its readers.
+ */
+
+#include <monodb/core/data/record.h>
+#include <stdlib.h>
+
+record_layout_t* record_layout_create(const type_id_t* types, uint16_t num_columns) {
+    return record_layout_create_dict(types, NULL, num_columns);
+}
+
+record_layout_t* record_layout_create_dict(const type_id_t* types, type_dict_t* const* dicts,
+                                           uint16_t num_columns) {
+    if (!types || num_columns == 0 || num_columns > RECORD_MAX_COLUMNS)
+        return NULL;
+    for (uint16_t i = 0; i < num_columns; i++) {
+        if (!type_is_valid(types[i]) || (dicts && dicts[i] && !type_is_variable(types[i])))
+            return NULL;
+    }
+
+    size_t           size   = sizeof(record_layout_t) + num_columns * sizeof(type_dict_t*) +
+                            num_columns * sizeof(type_id_t) + 2 * num_columns * sizeof(uint16_t);
+    record_layout_t* layout = (record_layout_t*)malloc(size);
+    if (!layout)
+        return NULL;
+
+    layout->num_columns = num_columns;
+    layout->dicts       = (type_dict_t**)(layout + 1);
+    layout->types       = (type_id_t*)(layout->dicts + num_columns);
+    layout->offsets     = (uint16_t*)(layout->types + num_columns);
+    layout->codes       = layout->offsets + num_columns;
+    memcpy(layout->types, types, num_columns * sizeof(type_id_t));
+
+    /* Fixed-width fields and codes first, after the bitmap; variable-length fields number
+     * their entries */
+    uint32_t offset  = (num_columns + 7u) / 8;
+    uint16_t num_var = 0;
+    for (uint16_t i = 0; i < num_columns; i++) {
+        layout->dicts[i] = dicts ? dicts[i] : NULL;
+        layout->codes[i] = 0;
+        if (layout->dicts[i]) {
+            layout->codes[i] = (uint16_t)offset;
+            offset += sizeof(uint32_t);
+        }
+        if (type_is_variable(types[i])) {
+            layout->offsets[i] = num_var++;
+        } else {
+            layout->offsets[i] = (uint16_t)offset;
+            offset += type_fixed_size(types[i]);
+        }
+    }
+    layout->num_var   = num_var;
+    layout->var_table = (uint16_t)offset;
+    layout->var_data  = (uint16_t)(offset + 2u * num_var);
+    return layout;
+}
+
+void record_layout_destroy(record_layout_t* layout) { free(layout); }
+
+uint32_t record_encoded_size(const record_layout_t* layout, const record_value_t* values) {
+    uint32_t size = layout->var_data;
+    for (uint16_t i = 0; i < layout->num_columns; i++) {
+        const record_value_t* v = &values[i];
+        if (!type_is_variable(layout->types[i]) || v->is_null)
+            continue;
+        const type_dict_t* dict = layout->dicts[i];
+        if (!dict || type_dict_find(dict, v->data, v->len) == TYPE_DICT_NONE)
+            size += v->len;
+    }
+    return size <= UINT16_MAX ? size : 0;
+}
+
+uint16_t record_encode(const record_layout_t* layout, const record_value_t* values, void* buf,
+                       uint16_t size) {
+    /* Codes first: the row's size depends on which values got one */
+    uint32_t codes[RECORD_MAX_COLUMNS];
+    uint32_t total = layout->var_data;
+    for (uint16_t i = 0; i < layout->num_columns; i++) {
+        const record_value_t* v = &values[i];
+        if (!type_is_variable(layout->types[i]) || v->is_null) {
+            codes[i] = TYPE_DICT_NONE;
+            continue;
+        }
+        codes[i] = layout->dicts[i] ? type_dict_encode(layout->dicts[i], v->data, v->len)
+                                    : TYPE_DICT_NONE;
+        if (codes[i] == TYPE_DICT_NONE)
+            total += v->len;
+    }
+    if (total > size)
+        return 0;
+
+    uint8_t* out = (uint8_t*)buf;
+    memset(out, 0, layout->var_table);
+
+    uint16_t end = layout->var_data;
+    for (uint16_t i = 0; i < layout->num_columns; i++) {
+        const record_value_t* v      = &values[i];
+        uint8_t*              field  = out + layout->offsets[i];
+        bool                  isnull = v->is_null;
+        if (isnull)
+            out[i >> 3] |= (uint8_t)(1u << (i & 7));
+        if (layout->codes[i])
+            memcpy(out + layout->codes[i], &codes[i], sizeof(codes[i]));
+
+        switch (layout->types[i]) {
+        case TYPE_BOOL:
+            *field = (uint8_t)(!isnull && v->i != 0);
+            break;
+        case TYPE_INT32: {
+            int32_t x = isnull ? 0 : (int32_t)v->i;
+            memcpy(field, &x, sizeof(x));
+            break;
+        }
+        case TYPE_INT64: {
+            int64_t x = isnull ? 0 : v->i;
+            memcpy(field, &x, sizeof(x));
+            break;
+        }
+        case TYPE_FLOAT64: {
+            double x = isnull ? 0 : v->f;
+            memcpy(field, &x, sizeof(x));
+            break;
+        }
+        default:
+            /* Variable-length: append the bytes unless coded, and record where they end */
+            if (codes[i] == TYPE_DICT_NONE && !isnull && v->len > 0) {
+                memcpy(out + end, v->data, v->len);
+                end = (uint16_t)(end + v->len);
+            }
+            memcpy(out + layout->var_table + 2 * layout->offsets[i], &end, sizeof(end));
+            break;
+        }
+    }
+    return end;
+}
+
+bool record_validate(const record_layout_t* layout, const void* rec, uint16_t len) {
+    if (!rec || len < layout->var_data)
+        return false;
+
+    const uint8_t* base = (const uint8_t*)rec;
+    uint16_t       prev = layout->var_data;
+    for (uint16_t e = 0; e < layout->num_var; e++) {
+        uint16_t end;
+        memcpy(&end, base + layout->var_table + 2 * e, sizeof(end));
+        if (end < prev || end > len)
+            return false;
+        prev = end;
+    }
+    for (uint16_t i = 0; i < layout->num_columns; i++) {
+        if (!layout->codes[i])
+            continue;
+        uint32_t code = record_get_code(layout, rec, i);
+        if (code != TYPE_DICT_NONE && code >= type_dict_count(layout->dicts[i]))
+            return false;
+    }
+    return true;
+}
+
+bool record_decode(const record_layout_t* layout, const void* rec, uint16_t len,
+                   record_value_t* values) {
+    if (!record_validate(layout, rec, len))
+        return false;
+
+    for (uint16_t i = 0; i < layout->num_columns; i++) {
+        record_value_t* v = &values[i];
+        memset(v, 0, sizeof(*v));
+        v->is_null = record_is_null(rec, i);
+
+        switch (layout->types[i]) {
+        case TYPE_BOOL:
+            v->i = record_get_bool(layout, rec, i);
+            break;
+        case TYPE_INT32:
+            v->i = record_get_i32(layout, rec, i);
+            break;
+        case TYPE_INT64:
+            v->i = record_get_i64(layout, rec, i);
+            break;
+        case TYPE_FLOAT64:
+            v->f = record_get_f64(layout, rec, i);
+            break;
+        default:
+            if (layout->codes[i])
+                v->i = record_get_code(layout, rec, i);
+            v->data = record_get_bytes(layout, rec, i, &v->len);
+            break;
+        }
+    }
+    return true;
+}
+
+void record_match_init(const record_layout_t* layout, uint16_t col, const void* data,
+                       uint16_t len, record_match_t* match) {
+    match->col  = col;
+    match->code = layout->dicts[col] ? type_dict_find(layout->dicts[col], data, len)
+                                     : TYPE_DICT_NONE;
+    match->data = data;
+    match->len  = len;
+}
+
+/* Allocate a schema with room for its layouts, defaults and default bytes */
+static record_schema_t* schema_alloc(uint16_t num_versions, uint16_t num_columns,
+                                     size_t default_bytes) {
+    size_t size = sizeof(record_schema_t) + num_versions * sizeof(record_layout_t*) +
+                  num_columns * sizeof(record_value_t) + default_bytes;
+    record_schema_t* schema = (record_schema_t*)calloc(1, size);
+    if (!schema)
+        return NULL;
+    schema->num_versions = num_versions;
+    schema->defaults     = (record_value_t*)(schema + 1);
+    schema->layouts      = (record_layout_t**)(schema->defaults + num_columns);
+    return schema;
+}
+
+/* Build the layout of each version; widths[v] is the number of columns of version v */
+static bool schema_build(record_schema_t* schema, const type_id_t* types,
+                         type_dict_t* const* dicts, const uint16_t* widths) {
+    for (uint16_t v = 0; v < schema->num_versions; v++) {
+        schema->layouts[v] = record_layout_create_dict(types, dicts, widths[v]);
+        if (!schema->layouts[v])
+            return false;
+    }
+    return true;
+}
+
+record_schema_t* record_schema_create(const type_id_t* types, type_dict_t* const* dicts,
+                                      uint16_t num_columns) {
+    record_schema_t* schema = schema_alloc(1, num_columns, 0);
+    if (!schema)
+        return NULL;
+    for (uint16_t i = 0; i < num_columns; i++)
+        schema->defaults[i].is_null = true;
+    if (!schema_build(schema, types, dicts, &num_columns)) {
+        record_schema_destroy(schema);
+        return NULL;
+    }
+    return schema;
+}
+
+record_schema_t* record_schema_add_column(const record_schema_t* schema, type_id_t type,
+                                          type_dict_t* dict, const void* default_data,
+                                          uint16_t default_len) {
+    const record_layout_t* current = record_schema_current(schema);
+    uint16_t               n       = current->num_columns;
+    if (!type_is_valid(type) || (dict && !type_is_variable(type)) ||
+        (default_data && !type_is_variable(type) && default_len != type_fixed_size(type)) ||
+        n >= RECORD_MAX_COLUMNS || schema->num_versions == UINT16_MAX)
+        return NULL;
+
+    /* Column list and version widths of the new schema */
+    type_id_t*    types  = (type_id_t*)malloc((n + 1u) * sizeof(type_id_t));
+    type_dict_t** dicts  = (type_dict_t**)malloc((n + 1u) * sizeof(type_dict_t*));
+    uint16_t*     widths = (uint16_t*)malloc((schema->num_versions + 1u) * sizeof(uint16_t));
+    size_t        bytes  = default_data ? default_len : 0;
+    for (uint16_t i = 0; i < n; i++) {
+        if (type_is_variable(current->types[i]) && !schema->defaults[i].is_null)
+            bytes += schema->defaults[i].len;
+    }
+    record_schema_t* next =
+        types && dicts && widths ? schema_alloc(schema->num_versions + 1, n + 1, bytes) : NULL;
+    if (!next) {
+        free(types);
+        free(dicts);
+        free(widths);
+        return NULL;
+    }
+
+    memcpy(types, current->types, n * sizeof(type_id_t));
+    memcpy(dicts, current->dicts, n * sizeof(type_dict_t*));
+    types[n] = type;
+    dicts[n] = dict;
+    for (uint16_t v = 0; v < schema->num_versions; v++)
+        widths[v] = schema->layouts[v]->num_columns;
+    widths[schema->num_versions] = (uint16_t)(n + 1);
+
+    /* Defaults, with the bytes of variable-length ones after them */
+    uint8_t* out = (uint8_t*)(next->layouts + next->num_versions);
+    memcpy(next->defaults, schema->defaults, n * sizeof(record_value_t));
+    record_value_t* def = &next->defaults[n];
+    def->is_null        = !default_data;
+    if (default_data) {
+        switch (type) {
+        case TYPE_BOOL:
+            def->i = *(const uint8_t*)default_data != 0;
+            break;
+        case TYPE_INT32: {
+            int32_t x;
+            memcpy(&x, default_data, sizeof(x));
+            def->i = x;
+            break;
+        }
+        case TYPE_INT64:
+            memcpy(&def->i, default_data, sizeof(def->i));
+            break;
+        case TYPE_FLOAT64:
+            memcpy(&def->f, default_data, sizeof(def->f));
+            break;
+        default:
+            def->i    = dict ? TYPE_DICT_NONE : 0;
+            def->data = default_data;
+            def->len  = default_len;
+            break;
+        }
+    }
+    for (uint16_t i = 0; i <= n; i++) {
+        record_value_t* d = &next->defaults[i];
+        if (!type_is_variable(types[i]) || d->is_null)
+            continue;
+        if (d->len)
+            memcpy(out, d->data, d->len);
+        d->data = out;
+        out += d->len;
+    }
+
+    bool ok = schema_build(next, types, dicts, widths);
+    free(types);
+    free(dicts);
+    free(widths);
+    if (!ok) {
+        record_schema_destroy(next);
+        return NULL;
+    }
+    return next;
+}
+
+void record_schema_destroy(record_schema_t* schema) {
+    if (!schema)
+        return;
+    for (uint16_t v = 0; v < schema->num_versions; v++)
+        record_layout_destroy(schema->layouts[v]);
+    free(schema);
+}
+
+uint16_t record_schema_encode(const record_schema_t* schema, const record_value_t* values,
+                              void* buf, uint16_t size) {
+    if (size < RECORD_VERSION_SIZE)
+        return 0;
+    uint16_t version = (uint16_t)(schema->num_versions - 1);
+    uint16_t len     = record_encode(record_schema_current(schema), values,
+                                     (uint8_t*)buf + RECORD_VERSION_SIZE,
+                                     (uint16_t)(size - RECORD_VERSION_SIZE));
+    if (len == 0)
+        return 0;
+    memcpy(buf, &version, sizeof(version));
+    return (uint16_t)(len + RECORD_VERSION_SIZE);
+}
+
+bool record_schema_decode(const record_schema_t* schema, const void* row, uint16_t len,
+                          record_value_t* values) {
+    const void*            rec;
+    uint16_t               rec_len;
+    const record_layout_t* layout = record_schema_layout(schema, row, len, &rec, &rec_len);
+    if (!layout || !record_decode(layout, rec, rec_len, values))
+        return false;
+
+    uint16_t n = record_schema_current(schema)->num_columns;
+    for (uint16_t i = layout->num_columns; i < n; i++)
+        values[i] = schema->defaults[i];
+    return true;
+}
+
+uint16_t record_schema_upgrade(const record_schema_t* schema, const void* row, uint16_t len,
+                               void* buf, uint16_t size) {
+    record_value_t* values = (record_value_t*)malloc(record_schema_current(schema)->num_columns *
+                                                     sizeof(record_value_t));
+    uint16_t        out    = 0;
+    if (values && record_schema_decode(schema, row, len, values))
+        out = record_schema_encode(schema, values, buf, size);
+    free(values);
+    return out;
+}
@@ -0,0 +1,525 @@
+/**
+ * @file sort.c
+ * @brief Implementation of the external merge sort
+ *
+ * Each buffer is one allocation: records grow from the front, as
+ * [u16 key_len][u16 value_len][key][value], and items pointing at them
+ * grow from the back, like the slots of a page. An item also holds the
+ * record's abbreviated key: its first eight key bytes as an integer that
+ * orders like the bytes. Sorting a buffer sorts only its items, with a
+ * radix sort on the abbreviated keys into the free middle of the buffer,
+ * which is kept as large as the items; records whose abbreviated keys tie
+ * are then ordered by full comparison. A run file is the records written
+ * out in item order.
+ *
+ * Buffers are filled in turn. With N workers there are N + 1 buffers, so
+ * the caller keeps filling one while up to N are being sorted and written.
+ * When the caller comes back round to a buffer that is still being
+ * written, it waits for that worker, which is the oldest.
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/data/key.h>
+#include <monodb/core/data/sort.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS
+#pragma warning(disable:4996)   // disable deprecated function warnings
+#endif
+
+/* Record header: key length and value length */
+#define RECORD_HEADER 4
+
+/* Stdio buffer per run file while writing or merging */
+#define RUN_IO_BUFFER (64 * 1024)
+
+/* Marks that no source record is waiting to be replaced */
+#define NO_SOURCE UINT32_MAX
+
+/* Below this many items a buffer is sorted by comparison only */
+#define RADIX_MIN_ITEMS 64
+
+/**
+ * Sort item: abbreviated key and the record it stands for
+ */
+typedef struct {
+    uint64_t       head;   /* First eight key bytes, big-endian, zero padded */
+    const uint8_t* record; /* Record in the buffer */
+} sort_item_t;
+
+/**
+ * Record buffer
+ */
+typedef struct {
+    sort_t*       sort;    /* Owning sort */
+    uint8_t*      data;    /* Records from the front, items from the back */
+    size_t        used;    /* Bytes of records */
+    uint32_t      count;   /* Records held */
+    sort_item_t*  sorted;  /* Items in order, once sorted */
+    uint32_t      run;     /* Run being written from the buffer */
+    bool          busy;    /* Handed to a worker thread */
+    bool          ok;      /* Whether the last run was written */
+    uint64_t      written; /* Bytes written by the last run */
+    sync_thread_t thread;  /* Worker writing the buffer */
+} sort_buffer_t;
+
+/**
+ * Merge input: a run file or the records left in memory
+ */
+typedef struct {
+    FILE*              file;     /* Run file, NULL for the in-memory buffer */
+    const sort_item_t* items;    /* Sorted items of the in-memory buffer */
+    uint32_t           next;     /* Next item to return */
+    uint32_t           count;    /* Items in the in-memory buffer */
+    uint8_t*           record;   /* Record read from the run file */
+    size_t             capacity; /* Allocated size of record */
+    const uint8_t*     current;  /* Current record, NULL once exhausted */
+    uint64_t           head;     /* Abbreviated key of the current record */
+} sort_source_t;
+
+/**
+ * Sort structure
+ */
+struct sort_t {
+    char*          prefix;      /* Run file path prefix */
+    size_t         buffer_size; /* Bytes per buffer */
+    uint32_t       num_buffers; /* Workers + 1 */
+    sort_buffer_t* buffers;     /* Record buffers */
+    uint32_t       fill;        /* Buffer being filled */
+    uint32_t       runs;        /* Run files started */
+    uint64_t       records;     /* Records added */
+    uint64_t       spilled;     /* Bytes written to finished runs */
+    bool           finished;    /* sort_finish() was called */
+    bool           failed;      /* A run could not be written or read */
+    sort_source_t* sources;     /* Merge inputs */
+    uint32_t       num_sources; /* Number of merge inputs */
+    uint32_t*      heap;        /* Min-heap of sources by current record */
+    uint32_t       heap_size;   /* Sources in the heap */
+    uint32_t       pending;     /* Source whose record was returned last */
+};
+
+static uint16_t read_u16(const uint8_t* p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static size_t record_size(const uint8_t* record) {
+    return RECORD_HEADER + (size_t)read_u16(record) + read_u16(record + 2);
+}
+
+/* Key order of the B+tree (memcmp, shorter first), then the same on values */
+static int compare_records(const uint8_t* a, const uint8_t* b) {
+    uint16_t a_key = read_u16(a), b_key = read_u16(b);
+    int      cmp   = key_compare(a + RECORD_HEADER, a_key, b + RECORD_HEADER, b_key);
+    if (cmp != 0)
+        return cmp;
+    return key_compare(a + RECORD_HEADER + a_key, read_u16(a + 2), b + RECORD_HEADER + b_key,
+                       read_u16(b + 2));
+}
+
+/* Abbreviated key of a record */
+static uint64_t record_head(const uint8_t* record) {
+    uint16_t key_len = read_u16(record);
+    uint64_t head    = 0;
+    for (uint16_t i = 0; i < 8; i++)
+        head = (head << 8) | (i < key_len ? record[RECORD_HEADER + i] : 0u);
+    return head;
+}
+
+/* Full order of two items; abbreviated keys decide unless they tie */
+static int compare_items(const void* a, const void* b) {
+    const sort_item_t* x = (const sort_item_t*)a;
+    const sort_item_t* y = (const sort_item_t*)b;
+    if (x->head != y->head)
+        return x->head < y->head ? -1 : 1;
+    return compare_records(x->record, y->record);
+}
+
+/* Items of a buffer, which end at the end of its data */
+static sort_item_t* buffer_items(const sort_t* sort, const sort_buffer_t* buffer) {
+    return (sort_item_t*)(buffer->data + sort->buffer_size) - buffer->count;
+}
+
+/*
+ * Sort the items of a buffer. An LSD radix sort on the abbreviated keys
+ * moves the items between their own place and the free middle of the
+ * buffer, skipping bytes every key shares; runs of equal abbreviated keys
+ * are then sorted by full comparison.
+ */
+static void sort_buffer(sort_t* sort, sort_buffer_t* buffer) {
+    sort_item_t* items = buffer_items(sort, buffer);
+    uint32_t     n     = buffer->count;
+    if (n < RADIX_MIN_ITEMS) {
+        qsort(items, n, sizeof(*items), compare_items);
+        buffer->sorted = items;
+        return;
+    }
+
+    size_t       middle  = (buffer->used + sizeof(sort_item_t) - 1) / sizeof(sort_item_t);
+    sort_item_t* scratch = (sort_item_t*)(buffer->data + middle * sizeof(sort_item_t));
+    uint32_t     counts[256];
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        memset(counts, 0, sizeof(counts));
+        for (uint32_t i = 0; i < n; i++)
+            counts[(items[i].head >> shift) & 0xFF]++;
+        if (counts[(items[0].head >> shift) & 0xFF] == n)
+            continue;
+
+        uint32_t offset = 0;
+        for (uint32_t d = 0; d < 256; d++) {
+            uint32_t c = counts[d];
+            counts[d]  = offset;
+            offset += c;
+        }
+        for (uint32_t i = 0; i < n; i++)
+            scratch[counts[(items[i].head >> shift) & 0xFF]++] = items[i];
+
+        sort_item_t* tmp = items;
+        items            = scratch;
+        scratch          = tmp;
+    }
+
+    for (uint32_t start = 0; start < n;) {
+        uint32_t end = start + 1;
+        while (end < n && items[end].head == items[start].head)
+            end++;
+        if (end - start > 1)
+            qsort(items + start, end - start, sizeof(*items), compare_items);
+        start = end;
+    }
+    buffer->sorted = items;
+}
+
+static void run_path(const sort_t* sort, uint32_t run, char* path, size_t size) {
+    snprintf(path, size, "%s.run%u", sort->prefix, run);
+}
+
+/* Sort a buffer and write it out as its run; runs on a worker or the caller */
+static void* write_run(void* arg) {
+    sort_buffer_t* buffer = (sort_buffer_t*)arg;
+    sort_t*        sort   = buffer->sort;
+    size_t         len    = strlen(sort->prefix) + 16;
+    char*          path   = (char*)malloc(len);
+
+    sort_buffer(sort, buffer);
+
+    buffer->ok      = false;
+    buffer->written = 0;
+    if (!path)
+        return NULL;
+    run_path(sort, buffer->run, path, len);
+    FILE* file = fopen(path, "wb");
+    free(path);
+    if (!file)
+        return NULL;
+    setvbuf(file, NULL, _IOFBF, RUN_IO_BUFFER);
+
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < buffer->count; i++) {
+        const uint8_t* record = buffer->sorted[i].record;
+        size_t         size   = record_size(record);
+        ok                    = fwrite(record, 1, size, file) == size;
+        buffer->written += size;
+    }
+    buffer->ok = fclose(file) == 0 && ok;
+    return NULL;
+}
+
+/* Wait for the worker of a buffer and empty it */
+static void collect(sort_t* sort, sort_buffer_t* buffer) {
+    if (buffer->busy) {
+        sync_thread_join(buffer->thread);
+        buffer->busy = false;
+        if (!buffer->ok)
+            sort->failed = true;
+        sort->spilled += buffer->written;
+    }
+    buffer->used  = 0;
+    buffer->count = 0;
+}
+
+/* Write the buffer being filled to a new run and move on to the next buffer */
+static bool spill(sort_t* sort) {
+    sort_buffer_t* buffer = &sort->buffers[sort->fill];
+    buffer->run           = sort->runs++;
+
+    if (sort->num_buffers > 1 && sync_thread_create(&buffer->thread, write_run, buffer)) {
+        buffer->busy = true;
+    } else {
+        write_run(buffer);
+        if (!buffer->ok)
+            sort->failed = true;
+        sort->spilled += buffer->written;
+        buffer->used  = 0;
+        buffer->count = 0;
+    }
+
+    sort->fill = (sort->fill + 1) % sort->num_buffers;
+    collect(sort, &sort->buffers[sort->fill]);
+    return !sort->failed;
+}
+
+sort_t* sort_begin(const char* run_prefix, size_t memory, uint32_t workers) {
+    if (!run_prefix)
+        return NULL;
+    if (workers > SORT_MAX_WORKERS)
+        workers = SORT_MAX_WORKERS;
+
+    sort_t* sort = (sort_t*)calloc(1, sizeof(sort_t));
+    if (!sort)
+        return NULL;
+    sort->num_buffers = workers + 1;
+    sort->buffer_size = memory / sort->num_buffers;
+    if (sort->buffer_size < SORT_MIN_MEMORY)
+        sort->buffer_size = SORT_MIN_MEMORY;
+    sort->buffer_size -= sort->buffer_size % sizeof(sort_item_t);
+    sort->pending = NO_SOURCE;
+
+    sort->prefix  = (char*)malloc(strlen(run_prefix) + 1);
+    sort->buffers = (sort_buffer_t*)calloc(sort->num_buffers, sizeof(sort_buffer_t));
+    if (!sort->prefix || !sort->buffers) {
+        sort_end(sort);
+        return NULL;
+    }
+    strcpy(sort->prefix, run_prefix);
+    for (uint32_t i = 0; i < sort->num_buffers; i++) {
+        sort->buffers[i].sort = sort;
+        sort->buffers[i].data = (uint8_t*)malloc(sort->buffer_size);
+        if (!sort->buffers[i].data) {
+            sort_end(sort);
+            return NULL;
+        }
+    }
+    return sort;
+}
+
+bool sort_add(sort_t* sort, const void* key, uint16_t key_len, const void* value,
+              uint16_t value_len) {
+    if (!sort || sort->finished || sort->failed)
+        return false;
+
+    /* Leave the middle of the buffer as large as the items, for the radix sort */
+    size_t         size   = RECORD_HEADER + (size_t)key_len + value_len;
+    sort_buffer_t* buffer = &sort->buffers[sort->fill];
+    size_t         need   = buffer->used + size + (buffer->count + 2) * 2 * sizeof(sort_item_t);
+    if (need > sort->buffer_size && !spill(sort))
+        return false;
+
+    buffer          = &sort->buffers[sort->fill];
+    uint8_t* record = buffer->data + buffer->used;
+    memcpy(record, &key_len, sizeof(key_len));
+    memcpy(record + 2, &value_len, sizeof(value_len));
+    if (key_len)
+        memcpy(record + RECORD_HEADER, key, key_len);
+    if (value_len)
+        memcpy(record + RECORD_HEADER + key_len, value, value_len);
+    buffer->used += size;
+    buffer->count++;
+    sort_item_t* item = buffer_items(sort, buffer);
+    item->head        = record_head(record);
+    item->record      = record;
+    sort->records++;
+    return true;
+}
+
+/* Load the next record of a merge input */
+static bool source_advance(sort_t* sort, sort_source_t* source) {
+    if (!source->file) {
+        if (source->next < source->count) {
+            source->current = source->items[source->next].record;
+            source->head    = source->items[source->next++].head;
+        } else {
+            source->current = NULL;
+        }
+        return true;
+    }
+
+    uint8_t header[RECORD_HEADER];
+    if (fread(header, 1, RECORD_HEADER, source->file) != RECORD_HEADER) {
+        source->current = NULL;
+        if (ferror(source->file) || !feof(source->file))
+            sort->failed = true;
+        return !sort->failed;
+    }
+
+    size_t size = record_size(header);
+    if (size > source->capacity) {
+        uint8_t* record = (uint8_t*)realloc(source->record, size);
+        if (!record) {
+            sort->failed = true;
+            return false;
+        }
+        source->record   = record;
+        source->capacity = size;
+    }
+    memcpy(source->record, header, RECORD_HEADER);
+    if (fread(source->record + RECORD_HEADER, 1, size - RECORD_HEADER, source->file) !=
+        size - RECORD_HEADER) {
+        source->current = NULL;
+        sort->failed    = true;
+        return false;
+    }
+    source->current = source->record;
+    source->head    = record_head(source->record);
+    return true;
+}
+
+static bool heap_less(const sort_t* sort, uint32_t a, uint32_t b) {
+    const sort_source_t* x = &sort->sources[a];
+    const sort_source_t* y = &sort->sources[b];
+    if (x->head != y->head)
+        return x->head < y->head;
+    return compare_records(x->current, y->current) < 0;
+}
+
+static void heap_sift_down(sort_t* sort, uint32_t pos) {
+    for (;;) {
+        uint32_t smallest = pos;
+        uint32_t left     = 2 * pos + 1;
+        uint32_t right    = left + 1;
+        if (left < sort->heap_size && heap_less(sort, sort->heap[left], sort->heap[smallest]))
+            smallest = left;
+        if (right < sort->heap_size && heap_less(sort, sort->heap[right], sort->heap[smallest]))
+            smallest = right;
+        if (smallest == pos)
+            return;
+        uint32_t tmp         = sort->heap[pos];
+        sort->heap[pos]      = sort->heap[smallest];
+        sort->heap[smallest] = tmp;
+        pos                  = smallest;
+    }
+}
+
+bool sort_finish(sort_t* sort) {
+    if (!sort || sort->finished)
+        return false;
+    sort->finished = true;
+
+    for (uint32_t i = 0; i < sort->num_buffers; i++)
+        if (i != sort->fill)
+            collect(sort, &sort->buffers[i]);
+    if (sort->failed)
+        return false;
+
+    /* The records still in memory are sorted in place and merged without spilling */
+    sort_buffer_t* last = &sort->buffers[sort->fill];
+    sort_buffer(sort, last);
+
+    sort->sources = (sort_source_t*)calloc(sort->runs + 1, sizeof(sort_source_t));
+    sort->heap    = (uint32_t*)calloc(sort->runs + 1, sizeof(uint32_t));
+    size_t len    = strlen(sort->prefix) + 16;
+    char*  path   = (char*)malloc(len);
+    if (!sort->sources || !sort->heap || !path) {
+        free(path);
+        sort->failed = true;
+        return false;
+    }
+
+    for (uint32_t run = 0; run < sort->runs; run++) {
+        sort_source_t* source = &sort->sources[sort->num_sources++];
+        run_path(sort, run, path, len);
+        source->file = fopen(path, "rb");
+        if (!source->file) {
+            sort->failed = true;
+            break;
+        }
+        setvbuf(source->file, NULL, _IOFBF, RUN_IO_BUFFER);
+    }
+    free(path);
+    if (sort->failed)
+        return false;
+
+    sort_source_t* memory = &sort->sources[sort->num_sources++];
+    memory->items         = last->sorted;
+    memory->count         = last->count;
+
+    for (uint32_t i = 0; i < sort->num_sources; i++) {
+        if (!source_advance(sort, &sort->sources[i]))
+            return false;
+        if (sort->sources[i].current)
+            sort->heap[sort->heap_size++] = i;
+    }
+    for (uint32_t i = sort->heap_size / 2; i-- > 0;)
+        heap_sift_down(sort, i);
+    return true;
+}
+
+bool sort_next(sort_t* sort, const void** key, uint16_t* key_len, const void** value,
+               uint16_t* value_len) {
+    if (!sort || !sort->finished || sort->failed || !sort->heap)
+        return false;
+
+    /* Replace the record returned last only now, so it stayed valid until this call */
+    if (sort->pending != NO_SOURCE) {
+        sort_source_t* source = &sort->sources[sort->pending];
+        sort->pending         = NO_SOURCE;
+        if (!source_advance(sort, source))
+            return false;
+        if (!source->current)
+            sort->heap[0] = sort->heap[--sort->heap_size];
+        if (sort->heap_size > 0)
+            heap_sift_down(sort, 0);
+    }
+    if (sort->heap_size == 0)
+        return false;
+
+    sort->pending          = sort->heap[0];
+    const uint8_t* record  = sort->sources[sort->pending].current;
+    *key_len               = read_u16(record);
+    *value_len             = read_u16(record + 2);
+    *key                   = record + RECORD_HEADER;
+    *value                 = record + RECORD_HEADER + *key_len;
+    return true;
+}
+
+bool sort_failed(const sort_t* sort) {
+    return !sort || sort->failed;
+}
+
+void sort_get_stats(const sort_t* sort, sort_stats_t* stats) {
+    if (!stats)
+        return;
+    memset(stats, 0, sizeof(*stats));
+    if (!sort)
+        return;
+    stats->records       = sort->records;
+    stats->runs          = sort->runs;
+    stats->spilled_bytes = sort->spilled;
+}
+
+void sort_end(sort_t* sort) {
+    if (!sort)
+        return;
+
+    if (sort->buffers) {
+        for (uint32_t i = 0; i < sort->num_buffers; i++) {
+            collect(sort, &sort->buffers[i]);
+            free(sort->buffers[i].data);
+        }
+    }
+    for (uint32_t i = 0; i < sort->num_sources; i++) {
+        if (sort->sources[i].file)
+            fclose(sort->sources[i].file);
+        free(sort->sources[i].record);
+    }
+
+    if (sort->prefix && sort->runs > 0) {
+        size_t len  = strlen(sort->prefix) + 16;
+        char*  path = (char*)malloc(len);
+        for (uint32_t run = 0; path && run < sort->runs; run++) {
+            run_path(sort, run, path, len);
+            remove(path);
+        }
+        free(path);
+    }
+
+    free(sort->sources);
+    free(sort->heap);
+    free(sort->buffers);
+    free(sort->prefix);
+    free(sort);
+}
@@ -0,0 +1,1956 @@
+/**
+ * @file table.c
+ * @brief Implementation of tables and index maintenance
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/data/art.h>
+#include <monodb/core/data/hash_index.h>
+#include <monodb/core/data/key.h>
+#include <monodb/core/data/learned.h>
+#include <monodb/core/data/sort.h>
+#include <monodb/core/data/table.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Platform-specific includes */
+#ifdef _WIN32
+#include <io.h>
+#define fsync_compat(f) _commit(_fileno(f))
+#else
+#include <unistd.h>
+#define fsync_compat(f) fsync(fileno(f))
+#endif
+
+#define TABLE_INDEX_NAME_LEN 64
+
+/* Memory an index build may sort entries in, and the threads writing its sorted runs */
+#define TABLE_BUILD_SORT_MEMORY  (64u * 1024 * 1024)
+#define TABLE_BUILD_SORT_WORKERS 2
+
+/* Longest sleep of the tiering thread between checks for a stop request */
+#define TABLE_TIER_SLICE_MS 10
+
+/* Side log a concurrent index build may leave to merge under the exclusive lock at the switch */
+#define TABLE_BUILD_SWITCH_LOG (64u * 1024)
+
+/*
+ * Planner cost units: reading one row in a sequential scan costs 1. An
+ * index lookup pays for a descent and a random fetch per match, and each
+ * index entry written or removed costs about as much as a fetch.
+ */
+#define COST_SEQ_ROW     1.0
+#define COST_INDEX_PROBE 4.0
+#define COST_INDEX_ROW   4.0
+#define COST_INDEX_WRITE 4.0
+
+/* Side log record kinds */
+#define SIDE_LOG_INSERT 1
+#define SIDE_LOG_REMOVE 2
+
+/**
+ * Tier segment of a heap table, stored in path.tier<id>. The ids of the
+ * published segments are listed in path.tiers.
+ */
+typedef struct {
+    uint32_t        id;      /* Segment file number */
+    tier_segment_t* segment; /* Open segment */
+} tier_entry_t;
+
+/**
+ * Secondary index of an index-organized table. Entries map the secondary
+ * key followed by the primary key to the secondary key length, so equal
+ * secondary keys stay unique and the primary key can be split off again.
+ */
+typedef struct {
+    char         name[TABLE_INDEX_NAME_LEN]; /* Index name */
+    btree_t*     tree;                       /* Entries */
+    index_key_fn      key_fn;                /* Secondary key extractor */
+    void*             key_arg;               /* Extractor argument */
+    index_predicate_t where;                 /* Predicate of a partial index, fn NULL if none */
+} secondary_t;
+
+/**
+ * B+tree index being built by table_create_index_concurrently(). Row
+ * changes made meanwhile append the entries they add and remove to the
+ * side log, which is merged into the tree once the bulk load is done.
+ * Records are an operation byte, the tuple ID, the key and payload
+ * lengths, then the key and payload bytes.
+ */
+typedef struct {
+    index_t*     index;   /* Index under construction, not yet attached */
+    btree_t*     tree;    /* Its entries */
+    sync_mutex_t lock;    /* Protects the side log */
+    uint8_t*     log;     /* Side log records */
+    size_t       log_len; /* Bytes used */
+    size_t       log_cap; /* Bytes allocated */
+    bool         failed;  /* A record could not be logged; the build must fail */
+} index_build_t;
+
+/**
+ * Table structure
+ */
+struct table_t {
+    char*       path;                       /* Path of the heap or primary tree file */
+    heap_t*     heap;                       /* Row storage of a heap table */
+    index_t*    indexes[TABLE_MAX_INDEXES]; /* Attached indexes of a heap table */
+    uint32_t    num_indexes;                /* Number of attached indexes */
+    atomic_bool hot_enabled;                /* Heap-only updates permitted */
+    uint32_t    index_fillfactor;           /* Node fill of B+tree index builds */
+
+    /* Concurrent index builds of heap tables */
+    sync_rwlock_t  index_lock;   /* Shared: row changes; exclusive: build start and switch */
+    atomic_bool    index_queued; /* A build waits for index_lock exclusively */
+    index_build_t* build;        /* Build in progress, or NULL */
+
+    /* Index-organized tables */
+    btree_t*     primary;                        /* Rows keyed by primary key */
+    index_key_fn pk_fn;                          /* Primary key extractor */
+    void*        pk_arg;                         /* Extractor argument */
+    secondary_t  secondaries[TABLE_MAX_INDEXES]; /* Secondary indexes */
+    uint32_t     num_secondaries;                /* Number of secondary indexes */
+
+    /* Tiering of heap tables */
+    sync_rwlock_t       tier_lock;    /* Shared: scans, updates, deletes; exclusive: passes */
+    table_tier_policy_t policy;       /* Tiering policy */
+    bool                has_policy;   /* Whether a policy is set */
+    tier_entry_t*       segments;     /* Published segments, oldest first */
+    _Atomic uint32_t    num_segments; /* Number of published segments */
+    uint32_t            cap_segments; /* Capacity of segments */
+    uint32_t            next_segment; /* Id of the next segment file */
+    sync_thread_t       tier_thread;  /* Background tiering thread */
+    bool                tier_running; /* Whether tier_thread runs */
+    atomic_bool         tier_stop;    /* Asks tier_thread to exit */
+
+    /* Workload seen by table_select(), for index advice */
+    sync_mutex_t        shapes_lock;                    /* Protects shapes */
+    table_shape_stats_t shapes[TABLE_MAX_QUERY_SHAPES]; /* Query shapes, in order of first use */
+    uint32_t            num_shapes;                     /* Number of shapes */
+    _Atomic uint64_t    scan_rows;                      /* Rows the last complete full scan read */
+
+    /* Statistics */
+    _Atomic uint64_t inserts;
+    _Atomic uint64_t updates;
+    _Atomic uint64_t hot_updates;
+    _Atomic uint64_t deletes;
+    _Atomic uint64_t index_inserts;
+    _Atomic uint64_t index_removes;
+    _Atomic uint64_t index_loaded;
+    _Atomic uint64_t heap_fetches;
+    _Atomic uint64_t fetches_avoided;
+    _Atomic uint64_t side_log_merged;
+    _Atomic uint64_t tier_passes;
+    _Atomic uint64_t tiered_rows;
+};
+
+/**
+ * Table scan structure
+ */
+struct table_scan_t {
+    table_t*      table;      /* Table being scanned */
+    heap_scan_t*  heap_scan;  /* Scan of the hot rows, NULL once exhausted */
+    tier_scan_t*  tier_scan;  /* Scan of the current segment */
+    uint32_t      segment;    /* Next segment to scan */
+    uint16_t      row_size;   /* Row length of the current segment */
+    tier_filter_t filter;     /* Range filter */
+    bool          has_filter; /* Whether the filter applies */
+};
+
+/**
+ * State of an index lookup that resolves entries to live rows
+ */
+typedef struct {
+    table_t*       table;
+    index_t*       index;
+    const void*    key;
+    uint16_t       key_len;
+    table_visit_fn visit;
+    void*          arg;
+    uint8_t        row[HEAP_MAX_TUPLE_SIZE];
+} lookup_state_t;
+
+/* Path of a file next to the table's own: path + suffix, or path.tier<id> */
+static bool sibling_path(const table_t* table, const char* suffix, uint32_t id, char* buf,
+                         size_t size) {
+    int n = suffix ? snprintf(buf, size, "%s%s", table->path, suffix)
+                   : snprintf(buf, size, "%s.tier%u", table->path, id);
+    return n > 0 && (size_t)n < size;
+}
+
+/* Make room for one more segment entry */
+static bool reserve_segment(table_t* table) {
+    if (atomic_load(&table->num_segments) < table->cap_segments)
+        return true;
+
+    uint32_t      cap      = table->cap_segments ? table->cap_segments * 2 : 8;
+    tier_entry_t* segments = (tier_entry_t*)realloc(table->segments, cap * sizeof(tier_entry_t));
+    if (!segments)
+        return false;
+    table->segments     = segments;
+    table->cap_segments = cap;
+    return true;
+}
+
+/* Open the segments listed in the table's manifest, if it has one */
+static bool load_segments(table_t* table) {
+    char path[1024];
+    if (!sibling_path(table, ".tiers", 0, path, sizeof(path)))
+        return false;
+
+    FILE* manifest = fopen(path, "r");
+    if (!manifest)
+        return true;
+
+    unsigned int id;
+    bool         ok = true;
+    while (ok && fscanf(manifest, "%u", &id) == 1) {
+        tier_segment_t* segment = NULL;
+        ok = sibling_path(table, NULL, id, path, sizeof(path)) && reserve_segment(table) &&
+             (segment = tier_segment_open(path)) != NULL;
+        if (!ok)
+            break;
+
+        uint32_t n          = atomic_load(&table->num_segments);
+        table->segments[n]  = (tier_entry_t){id, segment};
+        table->next_segment = id >= table->next_segment ? id + 1 : table->next_segment;
+        atomic_store(&table->num_segments, n + 1);
+    }
+    fclose(manifest);
+    return ok;
+}
+
+/* Durably replace the manifest with the current segment list */
+static bool write_manifest(table_t* table) {
+    char path[1024], tmp[1024];
+    if (!sibling_path(table, ".tiers", 0, path, sizeof(path)) ||
+        !sibling_path(table, ".tiers.tmp", 0, tmp, sizeof(tmp)))
+        return false;
+
+    FILE* manifest = fopen(tmp, "w");
+    if (!manifest)
+        return false;
+
+    bool     ok = true;
+    uint32_t n  = atomic_load(&table->num_segments);
+    for (uint32_t i = 0; ok && i < n; i++)
+        ok = fprintf(manifest, "%u\n", table->segments[i].id) > 0;
+    ok = ok && fflush(manifest) == 0 && fsync_compat(manifest) == 0;
+    ok = fclose(manifest) == 0 && ok;
+
+#ifdef _WIN32
+    /* rename() does not replace existing files on Windows */
+    if (ok)
+        remove(path);
+#endif
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok)
+        remove(tmp);
+    return ok;
+}
+
+/* Allocate a table and remember where its files live */
+static table_t* table_alloc(const char* path) {
+    if (!path)
+        return NULL;
+
+    table_t* table = (table_t*)calloc(1, sizeof(table_t));
+    if (!table)
+        return NULL;
+
+    table->path = (char*)malloc(strlen(path) + 1);
+    if (!table->path) {
+        free(table);
+        return NULL;
+    }
+    strcpy(table->path, path);
+    atomic_init(&table->hot_enabled, true);
+    table->index_fillfactor = BTREE_DEFAULT_FILLFACTOR;
+    atomic_init(&table->num_segments, 0);
+    atomic_init(&table->tier_stop, false);
+    sync_rwlock_init(&table->tier_lock);
+    sync_rwlock_init(&table->index_lock);
+    atomic_init(&table->index_queued, false);
+    sync_mutex_init(&table->shapes_lock);
+
+    return table;
+}
+
+table_t* table_open(buffer_pool_t* pool, const char* path) {
+    table_t* table = table_alloc(path);
+    if (!table)
+        return NULL;
+
+    table->heap = heap_open(pool, path);
+    if (!table->heap || !load_segments(table)) {
+        table_close(table);
+        return NULL;
+    }
+
+    return table;
+}
+
+table_t* table_open_clustered(buffer_pool_t* pool, const char* path, index_key_fn pk_fn,
+                              void* pk_arg) {
+    if (!pk_fn)
+        return NULL;
+
+    table_t* table = table_alloc(path);
+    if (!table)
+        return NULL;
+
+    table->pk_fn   = pk_fn;
+    table->pk_arg  = pk_arg;
+    table->primary = btree_open(pool, path);
+    if (!table->primary) {
+        table_close(table);
+        return NULL;
+    }
+
+    return table;
+}
+
+bool table_is_clustered(const table_t* table) { return table->primary != NULL; }
+
+void table_close(table_t* table) {
+    if (!table)
+        return;
+
+    table_stop_tiering(table);
+    for (uint32_t i = 0; i < atomic_load(&table->num_segments); i++)
+        tier_segment_close(table->segments[i].segment);
+    free(table->segments);
+    sync_rwlock_destroy(&table->tier_lock);
+    sync_rwlock_destroy(&table->index_lock);
+    sync_mutex_destroy(&table->shapes_lock);
+
+    for (uint32_t i = 0; i < table->num_indexes; i++)
+        index_destroy(table->indexes[i]);
+    for (uint32_t i = 0; i < table->num_secondaries; i++)
+        btree_close(table->secondaries[i].tree);
+    heap_close(table->heap);
+    btree_close(table->primary);
+    free(table->path);
+    free(table);
+}
+
+heap_t* table_heap(const table_t* table) { return table->heap; }
+
+/*
+ * Take the index lock shared for a row change or a read of the index
+ * list. A build waiting for it exclusively goes first: with writers
+ * overlapping all the time, the lock would otherwise never be free.
+ */
+static void index_lock_shared(table_t* table) {
+    while (atomic_load(&table->index_queued))
+        sync_yield();
+    sync_rwlock_rdlock(&table->index_lock);
+}
+
+/* Take the index lock exclusively, holding new row changes back until it is granted */
+static void index_lock_exclusive(table_t* table) {
+    atomic_store(&table->index_queued, true);
+    sync_rwlock_wrlock(&table->index_lock);
+    atomic_store(&table->index_queued, false);
+}
+
+/* Attached index by name; the caller holds the index lock or is the only user of the list */
+static index_t* find_index(const table_t* table, const char* name) {
+    for (uint32_t i = 0; i < table->num_indexes; i++) {
+        if (strcmp(index_name(table->indexes[i]), name) == 0)
+            return table->indexes[i];
+    }
+    return NULL;
+}
+
+/* Name already used by an index of either kind, or by the index being built */
+static bool index_name_taken(const table_t* table, const char* name) {
+    for (uint32_t i = 0; i < table->num_secondaries; i++) {
+        if (strcmp(table->secondaries[i].name, name) == 0)
+            return true;
+    }
+    if (table->build && strcmp(index_name(table->build->index), name) == 0)
+        return true;
+    return find_index(table, name) != NULL;
+}
+
+/* Append a built index to a heap table if there is room; indexes[] grows nowhere else */
+static bool attach_index(table_t* table, index_t* index) {
+    if (table->num_indexes >= TABLE_MAX_INDEXES)
+        return false;
+    table->indexes[table->num_indexes++] = index;
+    return true;
+}
+
+bool table_add_index(table_t* table, index_t* index) {
+    if (!table || !index)
+        return false;
+    if (table->primary || table->num_indexes >= TABLE_MAX_INDEXES ||
+        index_name_taken(table, index_name(index))) {
+        index_destroy(index);
+        return false;
+    }
+
+    /* Index the rows already present; the scan reports HOT chain roots */
+    heap_scan_t* scan = heap_scan_begin(table->heap, HEAP_SCAN_DEFAULT);
+    if (!scan) {
+        index_destroy(index);
+        return false;
+    }
+
+    tuple_id_t  tid;
+    const void* data;
+    uint16_t    len;
+    bool        ok = true;
+    while (ok && heap_scan_next(scan, &tid, &data, &len))
+        ok = index_insert_tuple(index, data, len, tid);
+    heap_scan_end(scan);
+
+    if (!ok || !attach_index(table, index)) {
+        index_destroy(index);
+        return false;
+    }
+    return true;
+}
+
+index_t* table_find_index(table_t* table, const char* name) {
+    if (!table || !name)
+        return NULL;
+
+    /* A concurrent build may be appending to the list */
+    index_lock_shared(table);
+    index_t* index = find_index(table, name);
+    sync_rwlock_rdunlock(&table->index_lock);
+    return index;
+}
+
+/* Secondary key of a row; rows outside a partial index have none */
+static bool secondary_key(const secondary_t* sec, const void* row, uint16_t len, void* key,
+                          uint16_t* key_len) {
+    if (sec->where.fn && !sec->where.fn(row, len, sec->where.arg))
+        return false;
+    return sec->key_fn(row, len, key, key_len, sec->key_arg);
+}
+
+/*
+ * Secondary entry of an index-organized table: secondary key, then primary
+ * key; the value is the secondary key length. Returns false if the row has
+ * no secondary key or the combined key is too long.
+ */
+static bool secondary_entry(const secondary_t* sec, const void* row, uint16_t len,
+                            const void* pk, uint16_t pk_len, uint8_t* key, uint16_t* key_len,
+                            uint16_t* sec_len) {
+    if (!secondary_key(sec, row, len, key, sec_len) ||
+        (uint32_t)*sec_len + pk_len > BTREE_MAX_KEY_SIZE)
+        return false;
+    memcpy(key + *sec_len, pk, pk_len);
+    *key_len = (uint16_t)(*sec_len + pk_len);
+    return true;
+}
+
+static bool secondary_insert(table_t* table, const secondary_t* sec, const void* row,
+                             uint16_t len, const void* pk, uint16_t pk_len) {
+    uint8_t  key[BTREE_MAX_KEY_SIZE + INDEX_MAX_KEY_SIZE];
+    uint16_t key_len, sec_len;
+    if (!secondary_entry(sec, row, len, pk, pk_len, key, &key_len, &sec_len))
+        return true;
+
+    atomic_fetch_add(&table->index_inserts, 1);
+    return btree_insert(sec->tree, key, key_len, &sec_len, sizeof(sec_len));
+}
+
+static bool secondary_remove(table_t* table, const secondary_t* sec, const void* row,
+                             uint16_t len, const void* pk, uint16_t pk_len) {
+    uint8_t  key[BTREE_MAX_KEY_SIZE + INDEX_MAX_KEY_SIZE];
+    uint16_t key_len, sec_len;
+    if (!secondary_entry(sec, row, len, pk, pk_len, key, &key_len, &sec_len))
+        return true;
+
+    atomic_fetch_add(&table->index_removes, 1);
+    return btree_delete(sec->tree, key, key_len);
+}
+
+/* Add the entry of every row of a heap table to the sort of an index build */
+static bool gather_heap_entries(table_t* table, const index_t* index, sort_t* sort) {
+    heap_scan_t* scan = heap_scan_begin(table->heap, HEAP_SCAN_DEFAULT);
+    if (!scan)
+        return false;
+
+    tuple_id_t  tid;
+    const void* data;
+    uint16_t    len;
+    bool        ok = true;
+    while (ok && heap_scan_next(scan, &tid, &data, &len)) {
+        uint8_t  key[INDEX_MAX_KEY_SIZE];
+        uint8_t  entry[BTREE_MAX_KEY_SIZE];
+        uint8_t  payload[INDEX_MAX_INCLUDE_SIZE];
+        uint16_t key_len, payload_len;
+        if (!index_extract_key(index, data, len, key, &key_len))
+            continue;
+        index_extract_include(index, data, len, payload, &payload_len);
+        uint16_t entry_len = btree_index_key(entry, key, key_len, tid);
+        ok = entry_len > 0 && sort_add(sort, entry, entry_len, payload, payload_len);
+    }
+    heap_scan_end(scan);
+    return ok;
+}
+
+/* Add the secondary entry of every row of an index-organized table to a sort */
+static bool gather_secondary_entries(table_t* table, const secondary_t* sec, sort_t* sort) {
+    btree_scan_t* scan = btree_scan_begin(table->primary, NULL, 0, NULL, 0);
+    if (!scan)
+        return false;
+
+    const void* pk;
+    const void* row;
+    uint16_t    pk_len, len;
+    bool        ok = true;
+    while (ok && btree_scan_next(scan, &pk, &pk_len, &row, &len)) {
+        uint8_t  key[BTREE_MAX_KEY_SIZE + INDEX_MAX_KEY_SIZE];
+        uint16_t key_len, sec_len;
+        if (secondary_entry(sec, row, len, pk, pk_len, key, &key_len, &sec_len))
+            ok = sort_add(sort, key, key_len, &sec_len, sizeof(sec_len));
+    }
+    btree_scan_end(scan);
+    return ok;
+}
+
+/* Load the sorted entries of an index build into its empty tree; the bulk load ends either way */
+static bool load_sorted(table_t* table, sort_t* sort, btree_bulk_t* bulk) {
+    const void* key;
+    const void* value;
+    uint16_t    key_len, value_len;
+    uint64_t    entries = 0;
+    bool        ok      = sort_finish(sort);
+
+    while (ok && sort_next(sort, &key, &key_len, &value, &value_len)) {
+        ok = btree_bulk_add(bulk, key, key_len, value, value_len);
+        entries++;
+    }
+    if (!ok || sort_failed(sort)) {
+        btree_bulk_abort(bulk);
+        return false;
+    }
+    if (!btree_bulk_finish(bulk))
+        return false;
+
+    atomic_fetch_add(&table->index_loaded, entries);
+    return true;
+}
+
+/* Insert the secondary entry of every row, for trees that cannot be bulk loaded */
+static bool insert_secondary_entries(table_t* table, const secondary_t* sec) {
+    btree_scan_t* scan = btree_scan_begin(table->primary, NULL, 0, NULL, 0);
+    bool          ok   = scan != NULL;
+    const void*   pk;
+    const void*   row;
+    uint16_t      pk_len, len;
+    while (ok && btree_scan_next(scan, &pk, &pk_len, &row, &len))
+        ok = secondary_insert(table, sec, row, len, pk, pk_len);
+    btree_scan_end(scan);
+    return ok;
+}
+
+/* Whether an index file was left by an earlier session; its index is reattached as it is */
+static bool index_file_stored(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+    bool stored = fgetc(file) != EOF;
+    fclose(file);
+    return stored;
+}
+
+/*
+ * Build a new B+tree index by sorting the entries of the rows already
+ * stored and loading the tree bottom-up, rather than inserting entry by
+ * entry. An index file left by an earlier session is attached without a
+ * rebuild, and a failed build removes the file it created.
+ */
+static bool create_btree_index(table_t* table, const table_index_def_t* def) {
+    const char*  name    = def->name;
+    index_key_fn key_fn  = def->key_fn;
+    void*        key_arg = def->key_arg;
+
+    char path[1024];
+    if (snprintf(path, sizeof(path), "%s.%s", table->path, name) >= (int)sizeof(path))
+        return false;
+
+    buffer_pool_t* pool   = table->heap ? heap_pool(table->heap) : btree_pool(table->primary);
+    bool           stored = index_file_stored(path);
+
+    btree_t* tree = btree_open(pool, path);
+    if (!tree)
+        return false;
+
+    /* Sorted runs go next to the index file and are removed when the sort ends */
+    btree_bulk_t* bulk = stored ? NULL : btree_bulk_begin(tree, table->index_fillfactor);
+    sort_t* sort = bulk ? sort_begin(path, TABLE_BUILD_SORT_MEMORY, TABLE_BUILD_SORT_WORKERS)
+                        : NULL;
+    if (bulk && !sort) {
+        btree_bulk_abort(bulk);
+        bulk = NULL;
+    }
+
+    if (table->heap) {
+        index_t* index = index_create(name, &btree_index_ops, tree, key_fn, key_arg);
+        if (!index ||
+            (def->include_fn && !index_set_include(index, def->include_fn, def->include_arg)) ||
+            (def->where_fn && !index_set_predicate(index, def->where_fn, def->where_arg))) {
+            btree_bulk_abort(bulk);
+            sort_end(sort);
+            if (index)
+                index_destroy(index);
+            else
+                btree_close(tree);
+            if (!stored)
+                remove(path);
+            return false;
+        }
+
+        bool ok;
+        if (stored) {
+            ok = attach_index(table, index);
+        } else if (!sort) {
+            ok = table_add_index(table, index);
+            index = NULL;
+        } else {
+            ok = gather_heap_entries(table, index, sort);
+            if (ok)
+                ok = load_sorted(table, sort, bulk);
+            else
+                btree_bulk_abort(bulk);
+            sort_end(sort);
+            ok = ok && attach_index(table, index);
+        }
+        if (!ok) {
+            if (index)
+                index_destroy(index);
+            if (!stored)
+                remove(path);
+        }
+        return ok;
+    }
+
+    secondary_t* sec = &table->secondaries[table->num_secondaries];
+    strcpy(sec->name, name);
+    sec->tree    = tree;
+    sec->key_fn  = key_fn;
+    sec->key_arg = key_arg;
+    sec->where   = (index_predicate_t){def->where_fn, def->where_arg};
+
+    /* A stored index was kept up to date by the session that built it */
+    bool ok = true;
+    if (!stored && sort) {
+        ok = gather_secondary_entries(table, sec, sort);
+        if (ok)
+            ok = load_sorted(table, sort, bulk);
+        else
+            btree_bulk_abort(bulk);
+        sort_end(sort);
+    } else if (!stored) {
+        ok = insert_secondary_entries(table, sec);
+    }
+
+    if (!ok) {
+        btree_close(tree);
+        if (!stored)
+            remove(path);
+        return false;
+    }
+
+    table->num_secondaries++;
+    return true;
+}
+
+/*
+ * Build a learned index from the keys of the rows already stored. The model
+ * is fit once over all of them, rather than growing through the delta of
+ * row-by-row inserts.
+ */
+static bool create_learned_index(table_t* table, const table_index_def_t* def) {
+    learned_index_t* learned = learned_index_create(0);
+    if (!learned)
+        return false;
+    index_t* index = index_create(def->name, &learned_index_ops, learned, def->key_fn,
+                                  def->key_arg);
+    if (!index) {
+        learned_index_destroy(learned);
+        return false;
+    }
+    if (def->where_fn && !index_set_predicate(index, def->where_fn, def->where_arg)) {
+        index_destroy(index);
+        return false;
+    }
+
+    heap_scan_t*     scan    = heap_scan_begin(table->heap, HEAP_SCAN_DEFAULT);
+    learned_entry_t* entries = NULL;
+    size_t           count = 0, capacity = 0;
+    bool             ok    = scan != NULL;
+    tuple_id_t       tid;
+    const void*      data;
+    uint16_t         len;
+    while (ok && heap_scan_next(scan, &tid, &data, &len)) {
+        uint8_t  key[INDEX_MAX_KEY_SIZE];
+        uint16_t key_len;
+        if (!index_extract_key(index, data, len, key, &key_len))
+            continue;
+        if (key_len != 8) {
+            ok = false;
+            break;
+        }
+        if (count == capacity) {
+            capacity               = capacity ? capacity * 2 : 1024;
+            learned_entry_t* grown = (learned_entry_t*)realloc(entries,
+                                                               capacity * sizeof(learned_entry_t));
+            ok = grown != NULL;
+            if (!ok)
+                break;
+            entries = grown;
+        }
+        entries[count++] = (learned_entry_t){key_get_u64(key), learned_tid_value(tid)};
+    }
+    heap_scan_end(scan);
+
+    if (ok)
+        ok = learned_index_load(learned, entries, count);
+    free(entries);
+    if (!ok || !attach_index(table, index)) {
+        index_destroy(index);
+        return false;
+    }
+
+    atomic_fetch_add(&table->index_loaded, count);
+    return true;
+}
+
+bool table_create_index_def(table_t* table, const table_index_def_t* def) {
+    if (!table || !def || !def->name || !def->key_fn ||
+        strlen(def->name) >= TABLE_INDEX_NAME_LEN || index_name_taken(table, def->name))
+        return false;
+    if ((table->heap ? table->num_indexes : table->num_secondaries) >= TABLE_MAX_INDEXES)
+        return false;
+
+    /* Secondary entries of index-organized tables hold primary keys, not payloads */
+    if (def->method == TABLE_INDEX_BTREE && !(def->include_fn && table->primary))
+        return create_btree_index(table, def);
+    if (!table->heap || def->include_fn)
+        return false;
+    if (def->method == TABLE_INDEX_LEARNED)
+        return create_learned_index(table, def);
+
+    /* Hash index files are reattached or removed on failure like B+tree ones */
+    const index_ops_t* ops;
+    void*              state;
+    char               path[1024] = "";
+    bool               stored     = false;
+    if (def->method == TABLE_INDEX_HASH) {
+        if (snprintf(path, sizeof(path), "%s.%s", table->path, def->name) >= (int)sizeof(path))
+            return false;
+        stored = index_file_stored(path);
+        ops    = &hash_index_ops;
+        state  = hash_index_open(heap_pool(table->heap), path);
+    } else if (def->method == TABLE_INDEX_ART) {
+        ops   = &art_index_ops;
+        state = art_create();
+    } else {
+        return false;
+    }
+
+    index_t* index = state ? index_create(def->name, ops, state, def->key_fn, def->key_arg) : NULL;
+    bool     ok    = index != NULL;
+    if (state && !index)
+        ops->close(state);
+    if (ok && def->where_fn && !index_set_predicate(index, def->where_fn, def->where_arg)) {
+        index_destroy(index);
+        ok = false;
+    }
+    if (ok && stored) {
+        ok = attach_index(table, index);
+        if (!ok)
+            index_destroy(index);
+    } else if (ok) {
+        ok = table_add_index(table, index);
+    }
+    if (!ok && !stored && path[0])
+        remove(path);
+    return ok;
+}
+
+bool table_create_index(table_t* table, const char* name, index_key_fn key_fn, void* key_arg) {
+    table_index_def_t def = {name, TABLE_INDEX_BTREE, key_fn, key_arg, NULL, NULL, NULL, NULL};
+    return table_create_index_def(table, &def);
+}
+
+bool table_create_index_using(table_t* table, const char* name, table_index_method_t method,
+                              index_key_fn key_fn, void* key_arg) {
+    table_index_def_t def = {name, method, key_fn, key_arg, NULL, NULL, NULL, NULL};
+    return table_create_index_def(table, &def);
+}
+
+/* Record an entry change for the index being built; the caller holds the index lock shared */
+static void side_log(table_t* table, uint8_t op, const void* tuple, uint16_t len, tuple_id_t tid) {
+    index_build_t* build = table->build;
+    if (!build)
+        return;
+
+    uint8_t  key[INDEX_MAX_KEY_SIZE];
+    uint8_t  payload[INDEX_MAX_INCLUDE_SIZE];
+    uint16_t key_len, payload_len = 0;
+    if (!index_extract_key(build->index, tuple, len, key, &key_len))
+        return;
+    if (op == SIDE_LOG_INSERT)
+        index_extract_include(build->index, tuple, len, payload, &payload_len);
+
+    size_t size = 1 + sizeof(tid) + 2 * sizeof(uint16_t) + key_len + payload_len;
+    sync_mutex_lock(&build->lock);
+    if (build->log_len + size > build->log_cap) {
+        size_t   cap  = build->log_cap ? build->log_cap * 2 : TABLE_BUILD_SWITCH_LOG;
+        uint8_t* grow = (uint8_t*)realloc(build->log, cap);
+        if (!grow) {
+            build->failed = true;
+            sync_mutex_unlock(&build->lock);
+            return;
+        }
+        build->log     = grow;
+        build->log_cap = cap;
+    }
+
+    uint8_t* rec = build->log + build->log_len;
+    rec[0]       = op;
+    memcpy(rec + 1, &tid, sizeof(tid));
+    memcpy(rec + 1 + sizeof(tid), &key_len, sizeof(key_len));
+    memcpy(rec + 3 + sizeof(tid), &payload_len, sizeof(payload_len));
+    memcpy(rec + 5 + sizeof(tid), key, key_len);
+    memcpy(rec + 5 + sizeof(tid) + key_len, payload, payload_len);
+    build->log_len += size;
+    sync_mutex_unlock(&build->lock);
+}
+
+/* Detach the side log recorded so far; the caller frees it */
+static uint8_t* side_log_take(index_build_t* build, size_t* len) {
+    sync_mutex_lock(&build->lock);
+    uint8_t* log   = build->log;
+    *len           = build->log_len;
+    build->log     = NULL;
+    build->log_len = 0;
+    build->log_cap = 0;
+    sync_mutex_unlock(&build->lock);
+    return log;
+}
+
+/*
+ * Apply side log records to the tree of a build, in order. The table scan
+ * may or may not have seen each change, so an insertion is applied only if
+ * the entry is missing and a removal only if it is present.
+ */
+static bool side_log_merge(table_t* table, index_build_t* build, const uint8_t* log,
+                           size_t len) {
+    uint64_t merged = 0;
+    size_t   pos    = 0;
+    while (pos < len) {
+        const uint8_t* rec = log + pos;
+        tuple_id_t     tid;
+        uint16_t       key_len, payload_len;
+        memcpy(&tid, rec + 1, sizeof(tid));
+        memcpy(&key_len, rec + 1 + sizeof(tid), sizeof(key_len));
+        memcpy(&payload_len, rec + 3 + sizeof(tid), sizeof(payload_len));
+        const uint8_t* key = rec + 5 + sizeof(tid);
+        pos += 5 + sizeof(tid) + key_len + payload_len;
+
+        uint8_t  entry[BTREE_MAX_KEY_SIZE];
+        uint16_t entry_len = btree_index_key(entry, key, key_len, tid);
+        if (entry_len == 0)
+            return false;
+
+        bool present = btree_get(build->tree, entry, entry_len, NULL, 0, NULL);
+        if (rec[0] == SIDE_LOG_INSERT && !present &&
+            !btree_insert(build->tree, entry, entry_len, key + key_len, payload_len))
+            return false;
+        if (rec[0] == SIDE_LOG_REMOVE && present && !btree_delete(build->tree, entry, entry_len))
+            return false;
+        merged++;
+    }
+
+    atomic_fetch_add(&table->side_log_merged, merged);
+    return true;
+}
+
+bool table_create_index_concurrently(table_t* table, const table_index_def_t* def) {
+    if (!table || !table->heap || !def || !def->name || !def->key_fn ||
+        def->method != TABLE_INDEX_BTREE || strlen(def->name) >= TABLE_INDEX_NAME_LEN)
+        return false;
+
+    char path[1024];
+    if (snprintf(path, sizeof(path), "%s.%s", table->path, def->name) >= (int)sizeof(path))
+        return false;
+
+    btree_t* tree = btree_open(heap_pool(table->heap), path);
+    if (!tree)
+        return false;
+
+    /* Only an empty index file can be bulk loaded */
+    btree_bulk_t* bulk = btree_bulk_begin(tree, table->index_fillfactor);
+    sort_t*  sort = bulk ? sort_begin(path, TABLE_BUILD_SORT_MEMORY, TABLE_BUILD_SORT_WORKERS)
+                         : NULL;
+    index_t* index =
+        sort ? index_create(def->name, &btree_index_ops, tree, def->key_fn, def->key_arg) : NULL;
+    if (!index ||
+        (def->include_fn && !index_set_include(index, def->include_fn, def->include_arg)) ||
+        (def->where_fn && !index_set_predicate(index, def->where_fn, def->where_arg))) {
+        btree_bulk_abort(bulk);
+        sort_end(sort);
+        if (index)
+            index_destroy(index);
+        else
+            btree_close(tree);
+        return false;
+    }
+
+    index_build_t build;
+    memset(&build, 0, sizeof(build));
+    build.index = index;
+    build.tree  = tree;
+    sync_mutex_init(&build.lock);
+
+    /* From here on every row change is logged; none is half done while the lock is held */
+    index_lock_exclusive(table);
+    bool ok = !table->build && !index_name_taken(table, def->name) &&
+              table->num_indexes < TABLE_MAX_INDEXES;
+    if (ok)
+        table->build = &build;
+    sync_rwlock_wrunlock(&table->index_lock);
+
+    /* Snapshot the rows and bulk load their entries while writers carry on */
+    if (ok)
+        ok = gather_heap_entries(table, index, sort);
+    if (ok)
+        ok = load_sorted(table, sort, bulk);
+    else
+        btree_bulk_abort(bulk);
+    sort_end(sort);
+
+    /*
+     * Catch up with the side log in rounds, until what is left is small
+     * enough to merge at the switch or writers log faster than it shrinks
+     */
+    size_t len, last = SIZE_MAX;
+    while (ok) {
+        uint8_t* log = side_log_take(&build, &len);
+        ok           = side_log_merge(table, &build, log, len);
+        free(log);
+        if (len <= TABLE_BUILD_SWITCH_LOG || len >= last)
+            break;
+        last = len;
+    }
+
+    index_lock_exclusive(table);
+    if (ok) {
+        uint8_t* log = side_log_take(&build, &len);
+        ok = !build.failed && side_log_merge(table, &build, log, len) &&
+             attach_index(table, index);
+        free(log);
+    }
+    if (table->build == &build)
+        table->build = NULL;
+    sync_rwlock_wrunlock(&table->index_lock);
+
+    free(build.log);
+    sync_mutex_destroy(&build.lock);
+    if (!ok)
+        index_destroy(index);
+    return ok;
+}
+
+void table_set_index_fillfactor(table_t* table, uint32_t fillfactor) {
+    if (fillfactor < BTREE_MIN_FILLFACTOR)
+        fillfactor = BTREE_MIN_FILLFACTOR;
+    if (fillfactor > 100)
+        fillfactor = 100;
+    table->index_fillfactor = fillfactor;
+}
+
+void table_set_hot_updates(table_t* table, bool enabled) {
+    atomic_store(&table->hot_enabled, enabled);
+}
+
+/* Insert into an index-organized table */
+static bool clustered_insert(table_t* table, const void* data, uint16_t len) {
+    uint8_t  pk[INDEX_MAX_KEY_SIZE];
+    uint16_t pk_len;
+    if (!table->pk_fn(data, len, pk, &pk_len, table->pk_arg) ||
+        !btree_insert(table->primary, pk, pk_len, data, len))
+        return false;
+
+    for (uint32_t i = 0; i < table->num_secondaries; i++) {
+        if (!secondary_insert(table, &table->secondaries[i], data, len, pk, pk_len))
+            return false;
+    }
+
+    atomic_fetch_add(&table->inserts, 1);
+    return true;
+}
+
+bool table_insert(table_t* table, const void* data, uint16_t len, uint32_t xid, tuple_id_t* tid) {
+    if (!table)
+        return false;
+
+    if (table->primary) {
+        if (tid)
+            *tid = INVALID_TUPLE_ID;
+        return clustered_insert(table, data, len);
+    }
+
+    index_lock_shared(table);
+    tuple_id_t new_tid;
+    bool       ok = heap_insert(table->heap, data, len, xid, &new_tid);
+    for (uint32_t i = 0; ok && i < table->num_indexes; i++)
+        ok = index_insert_tuple(table->indexes[i], data, len, new_tid);
+    if (ok) {
+        side_log(table, SIDE_LOG_INSERT, data, len, new_tid);
+        atomic_fetch_add(&table->inserts, 1);
+        atomic_fetch_add(&table->index_inserts, table->num_indexes);
+    }
+    sync_rwlock_rdunlock(&table->index_lock);
+
+    if (ok && tid)
+        *tid = new_tid;
+    return ok;
+}
+
+/* Update a heap row; the caller holds the tier and index locks shared */
+static bool update_row(table_t* table, tuple_id_t tid, const void* data, uint16_t len,
+                       uint32_t xid, tuple_id_t* new_tid) {
+    uint8_t  old[HEAP_MAX_TUPLE_SIZE];
+    uint16_t old_len;
+    if (!heap_fetch(table->heap, tid, old, sizeof(old), &old_len))
+        return false;
+
+    /* The update may be heap-only if no index would see a different key */
+    bool allow_hot = atomic_load(&table->hot_enabled);
+    for (uint32_t i = 0; allow_hot && i < table->num_indexes; i++)
+        allow_hot = index_key_equal(table->indexes[i], old, old_len, data, len);
+    if (allow_hot && table->build)
+        allow_hot = index_key_equal(table->build->index, old, old_len, data, len);
+
+    tuple_id_t placed;
+    bool       hot;
+    if (!heap_update(table->heap, tid, data, len, xid, allow_hot, &placed, &hot))
+        return false;
+
+    atomic_fetch_add(&table->updates, 1);
+
+    if (hot) {
+        /* Index entries keep pointing at the chain root, which reaches the new version */
+        atomic_fetch_add(&table->hot_updates, 1);
+        if (new_tid)
+            *new_tid = tid;
+        return true;
+    }
+
+    /*
+     * The row moved: repoint every index. Without snapshots nothing can still
+     * need the old entries, so they are removed rather than left for vacuum.
+     */
+    for (uint32_t i = 0; i < table->num_indexes; i++) {
+        if (!index_remove_tuple(table->indexes[i], old, old_len, tid) ||
+            !index_insert_tuple(table->indexes[i], data, len, placed))
+            return false;
+    }
+    side_log(table, SIDE_LOG_REMOVE, old, old_len, tid);
+    side_log(table, SIDE_LOG_INSERT, data, len, placed);
+
+    atomic_fetch_add(&table->index_removes, table->num_indexes);
+    atomic_fetch_add(&table->index_inserts, table->num_indexes);
+    if (new_tid)
+        *new_tid = placed;
+    return true;
+}
+
+bool table_update(table_t* table, tuple_id_t tid, const void* data, uint16_t len, uint32_t xid,
+                  tuple_id_t* new_tid) {
+    if (!table || !table->heap)
+        return false;
+
+    /* Rows must not change while a tiering pass copies them */
+    sync_rwlock_rdlock(&table->tier_lock);
+    index_lock_shared(table);
+    bool ok = update_row(table, tid, data, len, xid, new_tid);
+    sync_rwlock_rdunlock(&table->index_lock);
+    sync_rwlock_rdunlock(&table->tier_lock);
+    return ok;
+}
+
+/* Delete a heap row and its index entries; the caller holds the tier and index locks shared */
+static bool delete_row(table_t* table, tuple_id_t tid, uint32_t xid) {
+    uint8_t  old[HEAP_MAX_TUPLE_SIZE];
+    uint16_t old_len;
+    if (!heap_fetch(table->heap, tid, old, sizeof(old), &old_len) ||
+        !heap_delete(table->heap, tid, xid))
+        return false;
+
+    for (uint32_t i = 0; i < table->num_indexes; i++) {
+        if (!index_remove_tuple(table->indexes[i], old, old_len, tid))
+            return false;
+    }
+    side_log(table, SIDE_LOG_REMOVE, old, old_len, tid);
+
+    atomic_fetch_add(&table->deletes, 1);
+    atomic_fetch_add(&table->index_removes, table->num_indexes);
+    return true;
+}
+
+bool table_delete(table_t* table, tuple_id_t tid, uint32_t xid) {
+    if (!table || !table->heap)
+        return false;
+
+    sync_rwlock_rdlock(&table->tier_lock);
+    index_lock_shared(table);
+    bool ok = delete_row(table, tid, xid);
+    sync_rwlock_rdunlock(&table->index_lock);
+    sync_rwlock_rdunlock(&table->tier_lock);
+    return ok;
+}
+
+/* Resolve one index entry to the live row and pass it on if its key still matches */
+static bool visit_entry(tuple_id_t tid, void* arg) {
+    lookup_state_t* state = (lookup_state_t*)arg;
+    uint16_t        len;
+
+    if (!heap_fetch(state->table->heap, tid, state->row, sizeof(state->row), &len))
+        return true;
+
+    uint8_t  key[INDEX_MAX_KEY_SIZE];
+    uint16_t key_len;
+    if (!index_extract_key(state->index, state->row, len, key, &key_len) ||
+        key_len != state->key_len || memcmp(key, state->key, key_len) != 0)
+        return true;
+
+    return state->visit(tid, state->row, len, state->arg);
+}
+
+bool table_index_lookup(table_t* table, index_t* index, const void* key, uint16_t key_len,
+                        table_visit_fn visit, void* arg) {
+    if (!table || !table->heap || !index || !visit)
+        return false;
+
+    lookup_state_t* state = (lookup_state_t*)malloc(sizeof(lookup_state_t));
+    if (!state)
+        return false;
+
+    state->table   = table;
+    state->index   = index;
+    state->key     = key;
+    state->key_len = key_len;
+    state->visit   = visit;
+    state->arg     = arg;
+
+    bool ok = index_lookup(index, key, key_len, visit_entry, state);
+    free(state);
+    return ok;
+}
+
+bool table_fetch_key(table_t* table, const void* pk, uint16_t pk_len, void* buf,
+                     uint16_t buf_size, uint16_t* len) {
+    if (!table || !table->primary)
+        return false;
+    return btree_get(table->primary, pk, pk_len, buf, buf_size, len);
+}
+
+bool table_update_key(table_t* table, const void* pk, uint16_t pk_len, const void* data,
+                      uint16_t len, uint32_t xid) {
+    (void)xid;
+    if (!table || !table->primary)
+        return false;
+
+    uint8_t  old[BTREE_MAX_ENTRY_SIZE];
+    uint16_t old_len;
+    if (!btree_get(table->primary, pk, pk_len, old, sizeof(old), &old_len))
+        return false;
+
+    uint8_t  new_pk[INDEX_MAX_KEY_SIZE];
+    uint16_t new_pk_len;
+    if (!table->pk_fn(data, len, new_pk, &new_pk_len, table->pk_arg))
+        return false;
+
+    bool same_pk = new_pk_len == pk_len && memcmp(new_pk, pk, pk_len) == 0;
+    if (same_pk) {
+        if (!btree_update(table->primary, pk, pk_len, data, len))
+            return false;
+    } else {
+        /* The row moves to its new key; refuse to overwrite another row */
+        if (btree_get(table->primary, new_pk, new_pk_len, NULL, 0, NULL) ||
+            !btree_delete(table->primary, pk, pk_len) ||
+            !btree_insert(table->primary, new_pk, new_pk_len, data, len))
+            return false;
+    }
+
+    /* Secondary entries only change if their key or the primary key did */
+    for (uint32_t i = 0; i < table->num_secondaries; i++) {
+        secondary_t* sec = &table->secondaries[i];
+        uint8_t      old_key[INDEX_MAX_KEY_SIZE], new_key[INDEX_MAX_KEY_SIZE];
+        uint16_t     old_key_len = 0, new_key_len = 0;
+        bool         has_old = secondary_key(sec, old, old_len, old_key, &old_key_len);
+        bool         has_new = secondary_key(sec, data, len, new_key, &new_key_len);
+        if (same_pk && has_old == has_new &&
+            (!has_old ||
+             (old_key_len == new_key_len && memcmp(old_key, new_key, old_key_len) == 0)))
+            continue;
+
+        if (!secondary_remove(table, sec, old, old_len, pk, pk_len) ||
+            !secondary_insert(table, sec, data, len, new_pk, new_pk_len))
+            return false;
+    }
+
+    atomic_fetch_add(&table->updates, 1);
+    return true;
+}
+
+bool table_delete_key(table_t* table, const void* pk, uint16_t pk_len, uint32_t xid) {
+    (void)xid;
+    if (!table || !table->primary)
+        return false;
+
+    uint8_t  old[BTREE_MAX_ENTRY_SIZE];
+    uint16_t old_len;
+    if (!btree_get(table->primary, pk, pk_len, old, sizeof(old), &old_len) ||
+        !btree_delete(table->primary, pk, pk_len))
+        return false;
+
+    for (uint32_t i = 0; i < table->num_secondaries; i++) {
+        if (!secondary_remove(table, &table->secondaries[i], old, old_len, pk, pk_len))
+            return false;
+    }
+
+    atomic_fetch_add(&table->deletes, 1);
+    return true;
+}
+
+bool table_range_scan(table_t* table, const void* lo, uint16_t lo_len, const void* hi,
+                      uint16_t hi_len, table_visit_fn visit, void* arg) {
+    if (!table || !table->primary || !visit)
+        return false;
+
+    btree_scan_t* scan = btree_scan_begin(table->primary, lo, lo_len, hi, hi_len);
+    if (!scan)
+        return false;
+
+    const void* pk;
+    const void* row;
+    uint16_t    pk_len, len;
+    while (btree_scan_next(scan, &pk, &pk_len, &row, &len)) {
+        if (!visit(INVALID_TUPLE_ID, row, len, arg))
+            break;
+    }
+    btree_scan_end(scan);
+    return true;
+}
+
+/* Resolve the entries of a secondary key of an index-organized table */
+static bool secondary_lookup(table_t* table, const secondary_t* sec, const void* key,
+                             uint16_t key_len, table_visit_fn visit, void* arg) {
+    btree_scan_t* scan = btree_scan_begin(sec->tree, key, key_len, NULL, 0);
+    if (!scan)
+        return false;
+
+    uint8_t*    row = (uint8_t*)malloc(BTREE_MAX_ENTRY_SIZE);
+    const void* entry;
+    const void* value;
+    uint16_t    entry_len, value_len, sec_len;
+    while (row && btree_scan_next(scan, &entry, &entry_len, &value, &value_len)) {
+        if (entry_len < key_len || memcmp(entry, key, key_len) != 0)
+            break;
+
+        /* Longer secondary keys sharing the prefix are not matches */
+        memcpy(&sec_len, value, sizeof(sec_len));
+        if (sec_len != key_len)
+            continue;
+
+        const uint8_t* pk     = (const uint8_t*)entry + sec_len;
+        uint16_t       pk_len = (uint16_t)(entry_len - sec_len);
+        uint16_t       len;
+        if (btree_get(table->primary, pk, pk_len, row, BTREE_MAX_ENTRY_SIZE, &len) &&
+            !visit(INVALID_TUPLE_ID, row, len, arg))
+            break;
+    }
+
+    btree_scan_end(scan);
+    free(row);
+    return row != NULL;
+}
+
+bool table_lookup(table_t* table, const char* name, const void* key, uint16_t key_len,
+                  table_visit_fn visit, void* arg) {
+    if (!table || !name || !visit)
+        return false;
+
+    for (uint32_t i = 0; i < table->num_secondaries; i++) {
+        if (strcmp(table->secondaries[i].name, name) == 0)
+            return secondary_lookup(table, &table->secondaries[i], key, key_len, visit, arg);
+    }
+
+    index_t* index = table_find_index(table, name);
+    return index && table_index_lookup(table, index, key, key_len, visit, arg);
+}
+
+/**
+ * State of an index-only lookup
+ */
+typedef struct {
+    table_t*         table;
+    table_visit_fn   visit;
+    void*            arg;
+    table_explain_t* explain;
+} index_only_state_t;
+
+/* Return an entry from the index, checking the row in the heap unless its page is all-visible */
+static bool visit_covered(tuple_id_t tid, const void* payload, uint16_t payload_len, void* arg) {
+    index_only_state_t* state = (index_only_state_t*)arg;
+    heap_t*             heap  = state->table->heap;
+
+    if (heap_page_all_visible(heap, tid.page_id)) {
+        state->explain->fetches_avoided++;
+    } else {
+        state->explain->heap_fetches++;
+        if (!heap_fetch(heap, tid, NULL, 0, NULL))
+            return true;
+    }
+
+    state->explain->rows++;
+    return state->visit(tid, payload, payload_len, state->arg);
+}
+
+bool table_index_only_lookup(table_t* table, const char* name, const void* key, uint16_t key_len,
+                             table_visit_fn visit, void* arg, table_explain_t* explain) {
+    if (!table || !table->heap || !name || !visit)
+        return false;
+
+    index_t* index = table_find_index(table, name);
+    if (!index)
+        return false;
+
+    table_explain_t    report = {TABLE_PLAN_INDEX_ONLY_SCAN, index_name(index),
+                                 index_is_covering(index), index_is_partial(index), 0, 0, 0};
+    index_only_state_t state  = {table, visit, arg, &report};
+    bool               ok     = index_lookup_covering(index, key, key_len, visit_covered, &state);
+
+    atomic_fetch_add(&table->heap_fetches, report.heap_fetches);
+    atomic_fetch_add(&table->fetches_avoided, report.fetches_avoided);
+    if (explain)
+        *explain = report;
+    return ok;
+}
+
+/**
+ * State of a planned query
+ */
+typedef struct {
+    const table_query_t* query;
+    bool                 check_key; /* Whether rows still need the expression compared */
+    table_visit_fn       visit;
+    void*                arg;
+    table_explain_t*     explain;
+    uint64_t             examined; /* Rows read */
+    bool                 stopped;  /* Whether visit ended the query early */
+} select_state_t;
+
+/* Pass on the rows that satisfy the query */
+static bool visit_selected(tuple_id_t tid, const void* data, uint16_t len, void* arg) {
+    select_state_t*      state = (select_state_t*)arg;
+    const table_query_t* query = state->query;
+
+    state->examined++;
+    if (state->check_key) {
+        uint8_t  key[INDEX_MAX_KEY_SIZE];
+        uint16_t key_len;
+        if (!query->expr(data, len, key, &key_len, query->expr_arg) ||
+            key_len != query->key_len || memcmp(key, query->key, key_len) != 0)
+            return true;
+    }
+    for (uint32_t i = 0; i < query->num_conditions; i++) {
+        if (!query->conditions[i].fn(data, len, query->conditions[i].arg))
+            return true;
+    }
+
+    state->explain->rows++;
+    state->stopped = !state->visit(tid, data, len, state->arg);
+    return !state->stopped;
+}
+
+/* Whether a query has the conditions of a shape, in any order */
+static bool same_conditions(const table_shape_stats_t* shape, const table_query_t* query) {
+    if (shape->num_conditions != query->num_conditions)
+        return false;
+    for (uint32_t i = 0; i < query->num_conditions; i++) {
+        if (!index_predicate_implied(query->conditions[i], shape->conditions,
+                                     shape->num_conditions))
+            return false;
+    }
+    return true;
+}
+
+/* Add a query to the statistics of its shape */
+static void record_shape(table_t* table, const table_query_t* query, bool indexed, uint64_t rows,
+                         uint64_t examined) {
+    if (query->num_conditions > TABLE_SHAPE_MAX_CONDITIONS)
+        return;
+
+    sync_mutex_lock(&table->shapes_lock);
+    table_shape_stats_t* shape = NULL;
+    for (uint32_t i = 0; i < table->num_shapes && !shape; i++) {
+        table_shape_stats_t* s = &table->shapes[i];
+        if (s->expr == query->expr && s->expr_arg == query->expr_arg && same_conditions(s, query))
+            shape = s;
+    }
+    if (!shape && table->num_shapes < TABLE_MAX_QUERY_SHAPES) {
+        shape = &table->shapes[table->num_shapes++];
+        memset(shape, 0, sizeof(*shape));
+        shape->expr     = query->expr;
+        shape->expr_arg = query->expr_arg;
+        for (uint32_t i = 0; i < query->num_conditions; i++)
+            shape->conditions[i] = query->conditions[i];
+        shape->num_conditions = query->num_conditions;
+    }
+    if (shape) {
+        if (!shape->expr_name)
+            shape->expr_name = query->expr_name;
+        shape->calls++;
+        shape->index_scans += indexed;
+        shape->rows += rows;
+        shape->examined += examined;
+    }
+    sync_mutex_unlock(&table->shapes_lock);
+}
+
+/* Name of the index a query should use, or NULL if none can serve it */
+static const char* choose_index(table_t* table, const table_query_t* query, bool* partial) {
+    const char* best = NULL;
+    *partial         = false;
+
+    index_lock_shared(table);
+    for (uint32_t i = 0; i < table->num_indexes; i++) {
+        index_t* index = table->indexes[i];
+        if (!index_matches(index, query->expr, query->expr_arg, query->conditions,
+                           query->num_conditions) ||
+            (best && (*partial || !index_is_partial(index))))
+            continue;
+        best     = index_name(index);
+        *partial = index_is_partial(index);
+    }
+    sync_rwlock_rdunlock(&table->index_lock);
+
+    for (uint32_t i = 0; i < table->num_secondaries; i++) {
+        const secondary_t* sec = &table->secondaries[i];
+        if (sec->key_fn != query->expr || sec->key_arg != query->expr_arg ||
+            (sec->where.fn &&
+             !index_predicate_implied(sec->where, query->conditions, query->num_conditions)) ||
+            (best && (*partial || !sec->where.fn)))
+            continue;
+        best     = sec->name;
+        *partial = sec->where.fn != NULL;
+    }
+    return best;
+}
+
+bool table_select(table_t* table, const table_query_t* query, table_visit_fn visit, void* arg,
+                  table_explain_t* explain) {
+    if (!table || !query || !query->expr || (!query->key && query->key_len > 0) ||
+        (!query->conditions && query->num_conditions > 0) || !visit)
+        return false;
+    for (uint32_t i = 0; i < query->num_conditions; i++) {
+        if (!query->conditions[i].fn)
+            return false;
+    }
+
+    table_explain_t report = {TABLE_PLAN_SEQ_SCAN, NULL, false, false, 0, 0, 0};
+    select_state_t  state  = {query, false, visit, arg, &report, 0, false};
+    bool            ok;
+
+    /* Tiered rows have left the indexes, so only a full scan returns them all */
+    if (atomic_load(&table->num_segments) == 0)
+        report.index = choose_index(table, query, &report.partial);
+    if (report.index) {
+        report.plan = TABLE_PLAN_INDEX_SCAN;
+        ok = table_lookup(table, report.index, query->key, query->key_len, visit_selected, &state);
+    } else if (table->primary) {
+        state.check_key = true;
+        ok = table_range_scan(table, NULL, 0, NULL, 0, visit_selected, &state);
+    } else {
+        state.check_key    = true;
+        table_scan_t* scan = table_scan_begin(table, NULL);
+        tuple_id_t    tid;
+        const void*   data;
+        uint16_t      len;
+        bool          more = true;
+        ok                 = scan != NULL;
+        while (ok && more && table_scan_next(scan, &tid, &data, &len))
+            more = visit_selected(tid, data, len, &state);
+        table_scan_end(scan);
+    }
+
+    /* A complete full scan counted every row: the planner's estimate of the table size */
+    if (ok && !report.index && !state.stopped)
+        atomic_store(&table->scan_rows, state.examined);
+    if (ok)
+        record_shape(table, query, report.index != NULL, report.rows, state.examined);
+    if (explain)
+        *explain = report;
+    return ok;
+}
+
+int table_explain_format(const table_explain_t* explain, char* buf, size_t size) {
+    if (!explain)
+        return -1;
+
+    const char* index = explain->index ? explain->index : "?";
+    const char* kind  = explain->partial ? " (partial)" : "";
+    switch (explain->plan) {
+    case TABLE_PLAN_INDEX_ONLY_SCAN:
+        return snprintf(buf, size,
+                        "Index Only Scan using %s%s%s (rows=%llu heap_fetches=%llu "
+                        "heap_fetches_avoided=%llu)",
+                        index, explain->covering ? " (covering)" : "", kind,
+                        (unsigned long long)explain->rows,
+                        (unsigned long long)explain->heap_fetches,
+                        (unsigned long long)explain->fetches_avoided);
+    case TABLE_PLAN_INDEX_SCAN:
+        return snprintf(buf, size, "Index Scan using %s%s (rows=%llu)", index, kind,
+                        (unsigned long long)explain->rows);
+    default:
+        return snprintf(buf, size, "Seq Scan (rows=%llu)", (unsigned long long)explain->rows);
+    }
+}
+
+uint32_t table_get_query_shapes(table_t* table, table_shape_stats_t* shapes, uint32_t max) {
+    if (!table || !shapes)
+        return 0;
+
+    sync_mutex_lock(&table->shapes_lock);
+    uint32_t count = table->num_shapes < max ? table->num_shapes : max;
+    memcpy(shapes, table->shapes, count * sizeof(table_shape_stats_t));
+    sync_mutex_unlock(&table->shapes_lock);
+    return count;
+}
+
+/* Rows the planner assumes: those of the last complete full scan, else those inserted and kept */
+static double estimate_rows(table_t* table) {
+    uint64_t scanned = atomic_load(&table->scan_rows);
+    if (scanned > 0)
+        return (double)scanned;
+    uint64_t inserts = atomic_load(&table->inserts);
+    uint64_t deletes = atomic_load(&table->deletes);
+    return inserts > deletes ? (double)(inserts - deletes) : 0;
+}
+
+static double seq_scan_cost(double rows) { return rows * COST_SEQ_ROW; }
+
+static double index_scan_cost(double matches) {
+    return COST_INDEX_PROBE + matches * COST_INDEX_ROW;
+}
+
+static int compare_advice(const void* a, const void* b) {
+    double x = ((const table_advice_t*)a)->benefit, y = ((const table_advice_t*)b)->benefit;
+    return (x < y) - (x > y);
+}
+
+uint32_t table_index_advice(table_t* table, table_advice_t* advice, uint32_t max) {
+    if (!table || !advice)
+        return 0;
+
+    table_advice_t      found[TABLE_MAX_QUERY_SHAPES + TABLE_MAX_INDEXES];
+    table_shape_stats_t shapes[TABLE_MAX_QUERY_SHAPES];
+    uint32_t            num_shapes = table_get_query_shapes(table, shapes, TABLE_MAX_QUERY_SHAPES);
+    uint32_t            count      = 0;
+    double              rows       = estimate_rows(table);
+    bool                tiered     = atomic_load(&table->num_segments) > 0;
+
+    /*
+     * Every entry a new index would have written for the row changes seen.
+     * updates is bumped before hot_updates, so reading hot_updates first keeps
+     * it from passing updates; the clamp guards the difference all the same.
+     */
+    uint64_t hot     = atomic_load(&table->hot_updates);
+    uint64_t updates = atomic_load(&table->updates);
+    uint64_t writes  = atomic_load(&table->inserts) + atomic_load(&table->deletes) +
+                      2 * (updates > hot ? updates - hot : 0);
+    double   upkeep  = (double)writes * COST_INDEX_WRITE;
+
+    /* Hypothetical indexes: replan the full scans of each expression as index scans */
+    for (uint32_t i = 0; i < num_shapes; i++) {
+        const table_shape_stats_t* shape = &shapes[i];
+        table_query_t query = {shape->expr, shape->expr_arg, NULL, 0, shape->conditions,
+                               shape->num_conditions, shape->expr_name};
+        bool          partial;
+        uint64_t      scans = shape->calls - shape->index_scans;
+        if (scans == 0 || tiered || choose_index(table, &query, &partial))
+            continue;
+
+        double matches = (double)shape->rows / (double)shape->calls;
+        double saved   = (double)scans * (seq_scan_cost(rows) - index_scan_cost(matches));
+        if (saved <= 0)
+            continue;
+
+        table_advice_t* a = NULL;
+        for (uint32_t j = 0; j < count && !a; j++) {
+            if (found[j].expr == shape->expr && found[j].expr_arg == shape->expr_arg)
+                a = &found[j];
+        }
+        if (!a) {
+            a = &found[count++];
+            *a = (table_advice_t){TABLE_ADVICE_CREATE, NULL, shape->expr, shape->expr_arg,
+                                  shape->expr_name, 0, 0, upkeep, 0};
+        }
+        if (!a->expr_name)
+            a->expr_name = shape->expr_name;
+        a->queries += scans;
+        a->saved += saved;
+    }
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        found[i].benefit = found[i].saved - found[i].upkeep;
+        if (found[i].benefit > 0)
+            found[kept++] = found[i];
+    }
+    count = kept;
+
+    /* Existing indexes: what their lookups saved over full scans against what they cost */
+    index_lock_shared(table);
+    for (uint32_t i = 0; i < table->num_indexes; i++) {
+        index_stats_t stats;
+        index_get_stats(table->indexes[i], &stats);
+        double saved = (double)stats.lookups * (seq_scan_cost(rows) - COST_INDEX_PROBE) -
+                       (double)stats.tuples * COST_INDEX_ROW;
+        double cost  = (double)(stats.inserts + stats.removes) * COST_INDEX_WRITE;
+        if (saved < 0)
+            saved = 0;
+        if (stats.lookups > 0 && saved >= cost)
+            continue;
+        found[count++] = (table_advice_t){TABLE_ADVICE_DROP, index_name(table->indexes[i]),
+                                          NULL, NULL, NULL, stats.lookups, saved, cost,
+                                          cost - saved};
+    }
+    sync_rwlock_rdunlock(&table->index_lock);
+
+    qsort(found, count, sizeof(table_advice_t), compare_advice);
+    if (count > max)
+        count = max;
+    memcpy(advice, found, count * sizeof(table_advice_t));
+    return count;
+}
+
+int table_advice_format(const table_advice_t* advice, char* buf, size_t size) {
+    if (!advice)
+        return -1;
+
+    char target[96];
+    if (advice->kind == TABLE_ADVICE_CREATE)
+        snprintf(target, sizeof(target), "CREATE INDEX ON %s",
+                 advice->expr_name ? advice->expr_name : "?");
+    else
+        snprintf(target, sizeof(target), "DROP INDEX %s", advice->index ? advice->index : "?");
+    return snprintf(buf, size, "%s (queries=%llu saved=%.0f upkeep=%.0f benefit=%.0f)", target,
+                    (unsigned long long)advice->queries, advice->saved, advice->upkeep,
+                    advice->benefit);
+}
+
+bool table_vacuum(table_t* table, heap_vacuum_stats_t* stats) {
+    if (!table || !table->heap)
+        return false;
+    return heap_vacuum(table->heap, stats);
+}
+
+void table_get_stats(table_t* table, table_stats_t* stats) {
+    stats->inserts         = atomic_load(&table->inserts);
+    stats->updates         = atomic_load(&table->updates);
+    stats->hot_updates     = atomic_load(&table->hot_updates);
+    stats->deletes         = atomic_load(&table->deletes);
+    stats->index_inserts   = atomic_load(&table->index_inserts);
+    stats->index_removes   = atomic_load(&table->index_removes);
+    stats->index_loaded    = atomic_load(&table->index_loaded);
+    stats->heap_fetches    = atomic_load(&table->heap_fetches);
+    stats->fetches_avoided = atomic_load(&table->fetches_avoided);
+    stats->side_log_merged = atomic_load(&table->side_log_merged);
+    stats->tier_passes     = atomic_load(&table->tier_passes);
+    stats->tiered_rows     = atomic_load(&table->tiered_rows);
+    stats->segments        = atomic_load(&table->num_segments);
+}
+
+static bool layout_equal(const tier_layout_t* a, const tier_layout_t* b) {
+    if (a->row_size != b->row_size || a->num_columns != b->num_columns)
+        return false;
+    for (uint16_t i = 0; i < a->num_columns; i++) {
+        if (a->columns[i].offset != b->columns[i].offset ||
+            a->columns[i].size != b->columns[i].size || a->columns[i].type != b->columns[i].type)
+            return false;
+    }
+    return true;
+}
+
+bool table_set_tier_policy(table_t* table, const table_tier_policy_t* policy) {
+    if (!table || !table->heap || !policy || !policy->is_cold ||
+        !tier_layout_valid(&policy->layout))
+        return false;
+
+    /* Filters are evaluated against every segment with the policy's layout */
+    for (uint32_t i = 0; i < atomic_load(&table->num_segments); i++) {
+        const tier_layout_t* layout = tier_segment_layout(table->segments[i].segment);
+        if (!layout || !layout_equal(layout, &policy->layout))
+            return false;
+    }
+
+    table->policy     = *policy;
+    table->has_policy = true;
+    return true;
+}
+
+/* Publish a finished segment file; on failure the file is removed */
+static bool publish_segment(table_t* table, uint32_t id, const char* path) {
+    tier_segment_t* segment   = tier_segment_open(path);
+    bool            published = false;
+    if (segment && reserve_segment(table)) {
+        uint32_t n         = atomic_load(&table->num_segments);
+        table->segments[n] = (tier_entry_t){id, segment};
+        atomic_store(&table->num_segments, n + 1);
+
+        published = write_manifest(table);
+        if (!published)
+            atomic_store(&table->num_segments, n);
+    }
+
+    if (!published) {
+        tier_segment_close(segment);
+        remove(path);
+        return false;
+    }
+
+    table->next_segment = id + 1;
+    return true;
+}
+
+/* Move the cold rows into a new segment; the caller holds the tier lock exclusively */
+static bool tier_pass(table_t* table, uint64_t* moved) {
+    const table_tier_policy_t* policy = &table->policy;
+
+    uint32_t id = table->next_segment;
+    char     path[1024];
+    if (!sibling_path(table, NULL, id, path, sizeof(path)))
+        return false;
+
+    /* Scan from the first page so time-ordered rows keep their order and zone maps stay tight */
+    tier_writer_t* writer = tier_writer_create(path, &policy->layout);
+    heap_scan_t*   scan   = writer ? heap_scan_begin(table->heap, HEAP_SCAN_NO_SYNC) : NULL;
+    if (!scan) {
+        tier_writer_abort(writer);
+        return false;
+    }
+
+    tuple_id_t* tids = NULL;
+    size_t      num = 0, cap = 0;
+    tuple_id_t  tid;
+    const void* data;
+    uint16_t    len;
+    bool        ok = true;
+    while (ok && heap_scan_next(scan, &tid, &data, &len)) {
+        if (len != policy->layout.row_size || !policy->is_cold(data, len, policy->cold_arg))
+            continue;
+
+        if (num == cap) {
+            cap              = cap ? cap * 2 : 1024;
+            tuple_id_t* grow = (tuple_id_t*)realloc(tids, cap * sizeof(tuple_id_t));
+            if (!grow) {
+                ok = false;
+                break;
+            }
+            tids = grow;
+        }
+        tids[num++] = tid;
+        ok          = tier_writer_append(writer, data);
+    }
+    heap_scan_end(scan);
+
+    if (!ok || num == 0 || num < policy->min_rows) {
+        tier_writer_abort(writer);
+        free(tids);
+        return ok;
+    }
+
+    /* The rows only leave the heap once the segment holding them is durable and listed */
+    if (!tier_writer_finish(writer) || !publish_segment(table, id, path)) {
+        free(tids);
+        return false;
+    }
+
+    index_lock_shared(table);
+    for (size_t i = 0; ok && i < num; i++)
+        ok = delete_row(table, tids[i], policy->xid);
+    sync_rwlock_rdunlock(&table->index_lock);
+    free(tids);
+
+    atomic_fetch_add(&table->tiered_rows, num);
+    if (moved)
+        *moved = num;
+    return ok;
+}
+
+bool table_tier(table_t* table, uint64_t* moved) {
+    if (moved)
+        *moved = 0;
+    if (!table || !table->has_policy)
+        return false;
+
+    sync_rwlock_wrlock(&table->tier_lock);
+    bool ok = tier_pass(table, moved);
+    sync_rwlock_wrunlock(&table->tier_lock);
+
+    atomic_fetch_add(&table->tier_passes, 1);
+    return ok;
+}
+
+/* Background tiering loop */
+static void* tier_worker(void* arg) {
+    table_t* table = (table_t*)arg;
+
+    while (!atomic_load(&table->tier_stop)) {
+        table_tier(table, NULL);
+
+        /* Sleep in short slices so a stop request is noticed promptly */
+        uint32_t waited = 0;
+        while (waited < table->policy.interval_ms && !atomic_load(&table->tier_stop)) {
+            uint32_t slice = table->policy.interval_ms - waited;
+            slice          = slice < TABLE_TIER_SLICE_MS ? slice : TABLE_TIER_SLICE_MS;
+            sync_sleep_ms(slice);
+            waited += slice;
+        }
+    }
+    return NULL;
+}
+
+bool table_start_tiering(table_t* table) {
+    if (!table || !table->has_policy || table->tier_running)
+        return false;
+
+    atomic_store(&table->tier_stop, false);
+    if (!sync_thread_create(&table->tier_thread, tier_worker, table))
+        return false;
+
+    table->tier_running = true;
+    return true;
+}
+
+void table_stop_tiering(table_t* table) {
+    if (!table || !table->tier_running)
+        return;
+
+    atomic_store(&table->tier_stop, true);
+    sync_thread_join(table->tier_thread);
+    table->tier_running = false;
+}
+
+bool table_get_tier_stats(table_t* table, tier_segment_stats_t* stats) {
+    if (!table || !stats)
+        return false;
+
+    memset(stats, 0, sizeof(*stats));
+    sync_rwlock_rdlock(&table->tier_lock);
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < atomic_load(&table->num_segments); i++) {
+        tier_segment_stats_t segment;
+        ok = tier_segment_get_stats(table->segments[i].segment, &segment);
+        if (!ok)
+            break;
+        stats->rows += segment.rows;
+        stats->blocks += segment.blocks;
+        stats->file_size += segment.file_size;
+        stats->raw_size += segment.raw_size;
+        stats->blocks_read += segment.blocks_read;
+        stats->blocks_skipped += segment.blocks_skipped;
+    }
+    sync_rwlock_rdunlock(&table->tier_lock);
+    return ok;
+}
+
+table_scan_t* table_scan_begin(table_t* table, const tier_filter_t* filter) {
+    if (!table || !table->heap ||
+        (filter && (!table->has_policy || !tier_filter_valid(&table->policy.layout, filter))))
+        return NULL;
+
+    table_scan_t* scan = (table_scan_t*)calloc(1, sizeof(table_scan_t));
+    if (!scan)
+        return NULL;
+
+    scan->table = table;
+    if (filter) {
+        scan->filter     = *filter;
+        scan->has_filter = true;
+    }
+
+    /* Held until the scan ends so no pass moves rows from under it */
+    sync_rwlock_rdlock(&table->tier_lock);
+    scan->heap_scan = heap_scan_begin(table->heap, HEAP_SCAN_DEFAULT);
+    if (!scan->heap_scan) {
+        sync_rwlock_rdunlock(&table->tier_lock);
+        free(scan);
+        return NULL;
+    }
+
+    return scan;
+}
+
+bool table_scan_next(table_scan_t* scan, tuple_id_t* tid, const void** data, uint16_t* len) {
+    if (!scan || !data || !len)
+        return false;
+
+    table_t* table = scan->table;
+
+    /* Hot rows first */
+    if (scan->heap_scan) {
+        tuple_id_t t;
+        while (heap_scan_next(scan->heap_scan, &t, data, len)) {
+            if (scan->has_filter &&
+                (*len != table->policy.layout.row_size ||
+                 !tier_row_matches(&table->policy.layout, *data, &scan->filter)))
+                continue;
+            if (tid)
+                *tid = t;
+            return true;
+        }
+        heap_scan_end(scan->heap_scan);
+        scan->heap_scan = NULL;
+    }
+
+    /* Then each segment in turn */
+    for (;;) {
+        if (scan->tier_scan) {
+            if (tier_scan_next(scan->tier_scan, data)) {
+                if (tid)
+                    *tid = INVALID_TUPLE_ID;
+                *len = scan->row_size;
+                return true;
+            }
+            tier_scan_end(scan->tier_scan);
+            scan->tier_scan = NULL;
+        }
+
+        if (scan->segment >= atomic_load(&table->num_segments))
+            return false;
+
+        tier_segment_t*      segment = table->segments[scan->segment++].segment;
+        const tier_layout_t* layout  = tier_segment_layout(segment);
+        scan->tier_scan = layout ? tier_scan_begin(segment, scan->has_filter ? &scan->filter : NULL)
+                                 : NULL;
+        if (!scan->tier_scan)
+            return false;
+        scan->row_size = layout->row_size;
+    }
+}
+
+void table_scan_end(table_scan_t* scan) {
+    if (!scan)
+        return;
+
+    heap_scan_end(scan->heap_scan);
+    tier_scan_end(scan->tier_scan);
+    sync_rwlock_rdunlock(&scan->table->tier_lock);
+    free(scan);
+}
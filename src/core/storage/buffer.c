@@ -0,0 +1,602 @@
+/**
+ * @file buffer.c
+ * @brief Implementation of the shared buffer pool and access strategies
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/storage/buffer.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Frame state flags */
+#define BUF_TAG_VALID      0x01 /* Frame is assigned to a (file, page) tag */
+#define BUF_VALID          0x02 /* Frame contents are valid */
+#define BUF_DIRTY          0x04 /* Frame contents differ from disk */
+#define BUF_IO_IN_PROGRESS 0x08 /* A read or write-back is running without the pool lock */
+#define BUF_JUST_DIRTIED   0x10 /* Dirtied since the running write-back took its copy */
+
+/* Default ring sizes, in bytes, mirroring PostgreSQL's choices */
+#define RING_BYTES_BULKREAD  (256 * 1024)
+#define RING_BYTES_VACUUM    (256 * 1024)
+#define RING_BYTES_BULKWRITE (16 * 1024 * 1024)
+
+/**
+ * Per-frame descriptor
+ */
+typedef struct {
+    disk_manager_t*           file;         /* File the page belongs to */
+    uint32_t                  file_id;      /* Cached disk_manager_file_id(file) */
+    page_id_t                 page_id;      /* Page number within the file */
+    uint32_t                  refcount;     /* Number of pins */
+    uint8_t                   usage_count;  /* Clock sweep usage count */
+    uint8_t                   flags;        /* BUF_* flags */
+    int32_t                   hash_next;    /* Next frame in the page table chain */
+    int32_t                   free_next;    /* Next frame on the free list */
+    struct buffer_strategy_t* ring;         /* Strategy whose ring holds the frame, or NULL */
+    uint32_t                  ring_slot;    /* Slot of the frame in that ring */
+    sync_rwlock_t             content_lock; /* Latch protecting page contents */
+} buffer_desc_t;
+
+/**
+ * Buffer pool structure
+ */
+struct buffer_pool_t {
+    uint32_t       num_frames;   /* Number of frames */
+    uint8_t*       frames;       /* num_frames * PAGE_SIZE bytes of page data */
+    buffer_desc_t* descs;        /* Frame descriptors */
+
+    int32_t*       buckets;      /* Page table: tag hash -> first frame in chain */
+    uint32_t       bucket_mask;  /* Number of buckets - 1 */
+
+    int32_t        free_list;    /* Frames never used or invalidated */
+    uint32_t       clock_hand;   /* Next frame to inspect in the clock sweep */
+
+    sync_mutex_t   lock;         /* Protects page table, descriptors and statistics */
+    sync_cond_t    io_done;      /* Signalled whenever an I/O completes */
+
+    buffer_pool_stats_t stats;
+};
+
+/**
+ * Buffer access strategy structure
+ */
+struct buffer_strategy_t {
+    buffer_pool_t*       pool;      /* Owning pool */
+    buffer_access_type_t type;      /* Access type, used for statistics */
+    uint32_t             ring_size; /* Number of ring slots */
+    uint32_t             current;   /* Slot most recently handed out */
+    buffer_id_t          ring[];    /* Frames owned by the ring, INVALID_BUFFER if unfilled */
+};
+
+/* Hash a (file, page) tag into the page table */
+static inline uint32_t tag_hash(uint32_t file_id, page_id_t page_id) {
+    uint64_t h = ((uint64_t)file_id << 32) | page_id;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+/* Find the frame holding a tag; caller holds pool->lock */
+static buffer_id_t table_lookup(buffer_pool_t* pool, uint32_t file_id, page_id_t page_id) {
+    int32_t id = pool->buckets[tag_hash(file_id, page_id) & pool->bucket_mask];
+    while (id >= 0) {
+        buffer_desc_t* desc = &pool->descs[id];
+        if (desc->file_id == file_id && desc->page_id == page_id)
+            return id;
+        id = desc->hash_next;
+    }
+    return INVALID_BUFFER;
+}
+
+/* Insert a frame into the page table under its current tag */
+static void table_insert(buffer_pool_t* pool, buffer_id_t id) {
+    buffer_desc_t* desc   = &pool->descs[id];
+    uint32_t       bucket = tag_hash(desc->file_id, desc->page_id) & pool->bucket_mask;
+    desc->hash_next       = pool->buckets[bucket];
+    pool->buckets[bucket] = id;
+}
+
+/* Remove a frame from the page table */
+static void table_remove(buffer_pool_t* pool, buffer_id_t id) {
+    buffer_desc_t* desc   = &pool->descs[id];
+    uint32_t       bucket = tag_hash(desc->file_id, desc->page_id) & pool->bucket_mask;
+    int32_t*       link   = &pool->buckets[bucket];
+    while (*link >= 0) {
+        if (*link == id) {
+            *link = desc->hash_next;
+            break;
+        }
+        link = &pool->descs[*link].hash_next;
+    }
+    desc->hash_next = INVALID_BUFFER;
+}
+
+/* Bump the usage count of a frame on access */
+static inline void note_access(buffer_desc_t* desc, const buffer_strategy_t* strategy) {
+    if (!strategy) {
+        if (desc->usage_count < BUFFER_MAX_USAGE_COUNT)
+            desc->usage_count++;
+    } else if (desc->usage_count == 0) {
+        /* Ring accesses never promote a page past the point of easy reuse */
+        desc->usage_count = 1;
+    }
+}
+
+/* Run the clock sweep until an unpinned frame with zero usage count is found */
+static buffer_id_t clock_sweep(buffer_pool_t* pool) {
+    while (pool->free_list >= 0) {
+        buffer_id_t id  = pool->free_list;
+        pool->free_list = pool->descs[id].free_next;
+        if (pool->descs[id].refcount == 0 && !(pool->descs[id].flags & BUF_TAG_VALID))
+            return id;
+    }
+
+    /* Each frame can need up to BUFFER_MAX_USAGE_COUNT passes to age out */
+    uint64_t tries = (uint64_t)pool->num_frames * (BUFFER_MAX_USAGE_COUNT + 1);
+    while (tries-- > 0) {
+        buffer_id_t    id   = (buffer_id_t)pool->clock_hand;
+        buffer_desc_t* desc = &pool->descs[id];
+        pool->clock_hand    = (pool->clock_hand + 1) % pool->num_frames;
+
+        if (desc->refcount != 0 || (desc->flags & BUF_IO_IN_PROGRESS))
+            continue;
+        if (desc->usage_count == 0)
+            return id;
+        desc->usage_count--;
+    }
+
+    return INVALID_BUFFER; /* Every frame is pinned */
+}
+
+/* Take a frame out of the ring holding it, if any; caller holds pool->lock */
+static void ring_forget(buffer_pool_t* pool, buffer_id_t id) {
+    buffer_desc_t* desc = &pool->descs[id];
+    if (desc->ring) {
+        desc->ring->ring[desc->ring_slot] = INVALID_BUFFER;
+        desc->ring                        = NULL;
+    }
+}
+
+/* Pick a victim frame, preferring the strategy ring when one is given */
+static buffer_id_t get_victim(buffer_pool_t* pool, buffer_strategy_t* strategy) {
+    if (!strategy)
+        return clock_sweep(pool);
+
+    strategy->current = (strategy->current + 1) % strategy->ring_size;
+    buffer_id_t id    = strategy->ring[strategy->current];
+
+    /*
+     * Reuse the ring slot if nobody else is using that frame. A usage count
+     * above one means another backend touched the page through the normal
+     * policy since we loaded it, so leave it to the shared clock instead.
+     */
+    if (id >= 0) {
+        buffer_desc_t* desc = &pool->descs[id];
+        if (desc->refcount == 0 && desc->usage_count <= 1 && !(desc->flags & BUF_IO_IN_PROGRESS)) {
+            pool->stats.ring_reuses++;
+            return id;
+        }
+    }
+
+    /* A frame belongs to at most one ring slot */
+    id = clock_sweep(pool);
+    if (id >= 0) {
+        if (strategy->ring[strategy->current] >= 0)
+            ring_forget(pool, strategy->ring[strategy->current]);
+        ring_forget(pool, id);
+        strategy->ring[strategy->current] = id;
+        pool->descs[id].ring              = strategy;
+        pool->descs[id].ring_slot         = strategy->current;
+    }
+    return id;
+}
+
+/*
+ * Write a pinned, dirty frame back to disk. Called with pool->lock held;
+ * the lock is released during the write and re-acquired before returning.
+ * The frame stays dirty if it was dirtied again after the copy was taken.
+ */
+static bool write_back(buffer_pool_t* pool, buffer_id_t id) {
+    buffer_desc_t* desc = &pool->descs[id];
+    uint8_t        copy[PAGE_SIZE];
+
+    desc->flags |= BUF_IO_IN_PROGRESS;
+    desc->flags &= (uint8_t)~BUF_JUST_DIRTIED;
+    sync_mutex_unlock(&pool->lock);
+
+    /* Checksum a private copy so concurrent share-latched readers never see it change */
+    sync_rwlock_rdlock(&desc->content_lock);
+    memcpy(copy, pool->frames + (size_t)id * PAGE_SIZE, PAGE_SIZE);
+    sync_rwlock_rdunlock(&desc->content_lock);
+
+    page_set_checksum(copy);
+    bool ok = disk_manager_write_page(desc->file, desc->page_id, copy);
+
+    sync_mutex_lock(&pool->lock);
+    desc->flags &= (uint8_t)~BUF_IO_IN_PROGRESS;
+    if (ok) {
+        if (!(desc->flags & BUF_JUST_DIRTIED))
+            desc->flags &= (uint8_t)~BUF_DIRTY;
+        pool->stats.dirty_writes++;
+    }
+    sync_cond_broadcast(&pool->io_done);
+
+    return ok;
+}
+
+/* Return a frame to the free list after a failed load or a dropped file */
+static void invalidate_frame(buffer_pool_t* pool, buffer_id_t id) {
+    buffer_desc_t* desc = &pool->descs[id];
+    if (desc->flags & BUF_TAG_VALID)
+        table_remove(pool, id);
+    ring_forget(pool, id);
+    desc->flags       = 0;
+    desc->usage_count = 0;
+    desc->file        = NULL;
+    desc->file_id     = 0;
+    desc->page_id     = INVALID_PAGE_ID;
+    desc->free_next   = pool->free_list;
+    pool->free_list   = id;
+}
+
+/* Shared implementation of buffer_read and buffer_extend */
+static buffer_id_t pin_page(buffer_pool_t* pool, disk_manager_t* file, page_id_t page_id,
+                            buffer_strategy_t* strategy, bool read_from_disk) {
+    uint32_t             file_id = disk_manager_file_id(file);
+    buffer_access_type_t type    = strategy ? strategy->type : BUFFER_ACCESS_NORMAL;
+
+    sync_mutex_lock(&pool->lock);
+
+    for (;;) {
+        buffer_id_t id = table_lookup(pool, file_id, page_id);
+        if (id >= 0) {
+            buffer_desc_t* desc = &pool->descs[id];
+            desc->refcount++;
+            note_access(desc, strategy);
+
+            while (desc->flags & BUF_IO_IN_PROGRESS)
+                sync_cond_wait(&pool->io_done, &pool->lock);
+
+            if (!(desc->flags & BUF_VALID)) {
+                /* The loading backend failed; give up as it did */
+                desc->refcount--;
+                sync_mutex_unlock(&pool->lock);
+                return INVALID_BUFFER;
+            }
+
+            pool->stats.hits[type]++;
+            sync_mutex_unlock(&pool->lock);
+            return id;
+        }
+
+        id = get_victim(pool, strategy);
+        if (id < 0) {
+            sync_mutex_unlock(&pool->lock);
+            return INVALID_BUFFER;
+        }
+
+        buffer_desc_t* desc = &pool->descs[id];
+        desc->refcount      = 1;
+
+        if (desc->flags & BUF_DIRTY) {
+            if (!write_back(pool, id)) {
+                desc->refcount--;
+                sync_mutex_unlock(&pool->lock);
+                return INVALID_BUFFER;
+            }
+
+            /*
+             * Someone may have pinned the old page or loaded the page we want
+             * while the lock was released; start over in either case.
+             */
+            if (desc->refcount != 1 || (desc->flags & BUF_DIRTY)) {
+                desc->refcount--;
+                continue;
+            }
+            if (table_lookup(pool, file_id, page_id) >= 0) {
+                desc->refcount--;
+                continue;
+            }
+        }
+
+        if (desc->flags & BUF_TAG_VALID) {
+            table_remove(pool, id);
+            if (desc->flags & BUF_VALID)
+                pool->stats.evictions++;
+        }
+
+        desc->file        = file;
+        desc->file_id     = file_id;
+        desc->page_id     = page_id;
+        desc->usage_count = 1;
+        desc->flags       = BUF_TAG_VALID | BUF_IO_IN_PROGRESS;
+        table_insert(pool, id);
+
+        if (read_from_disk)
+            pool->stats.misses[type]++;
+        sync_mutex_unlock(&pool->lock);
+
+        void* frame = pool->frames + (size_t)id * PAGE_SIZE;
+        bool  ok    = true;
+        if (read_from_disk) {
+            ok = disk_manager_read_page(file, page_id, frame) && page_verify(frame, page_id);
+        } else {
+            memset(frame, 0, PAGE_SIZE);
+        }
+
+        sync_mutex_lock(&pool->lock);
+        desc->flags &= (uint8_t)~BUF_IO_IN_PROGRESS;
+        if (ok) {
+            desc->flags |= BUF_VALID;
+        } else {
+            desc->refcount--;
+            if (desc->refcount == 0) {
+                invalidate_frame(pool, id);
+            } else {
+                /* Waiters will see the frame is not valid; drop its tag now */
+                table_remove(pool, id);
+                desc->flags &= (uint8_t)~BUF_TAG_VALID;
+            }
+            id = INVALID_BUFFER;
+        }
+        sync_cond_broadcast(&pool->io_done);
+        sync_mutex_unlock(&pool->lock);
+
+        return id;
+    }
+}
+
+buffer_pool_t* buffer_pool_create(uint32_t num_frames) {
+    if (num_frames == 0)
+        return NULL;
+
+    buffer_pool_t* pool = (buffer_pool_t*)calloc(1, sizeof(buffer_pool_t));
+    if (!pool)
+        return NULL;
+
+    uint32_t num_buckets = 1;
+    while (num_buckets < num_frames * 2)
+        num_buckets <<= 1;
+
+    pool->num_frames  = num_frames;
+    pool->bucket_mask = num_buckets - 1;
+    pool->frames      = (uint8_t*)malloc((size_t)num_frames * PAGE_SIZE);
+    pool->descs       = (buffer_desc_t*)calloc(num_frames, sizeof(buffer_desc_t));
+    pool->buckets     = (int32_t*)malloc(sizeof(int32_t) * num_buckets);
+
+    if (!pool->frames || !pool->descs || !pool->buckets) {
+        free(pool->frames);
+        free(pool->descs);
+        free(pool->buckets);
+        free(pool);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < num_buckets; i++)
+        pool->buckets[i] = INVALID_BUFFER;
+
+    /* Chain every frame onto the free list in order */
+    for (uint32_t i = 0; i < num_frames; i++) {
+        buffer_desc_t* desc = &pool->descs[i];
+        desc->page_id       = INVALID_PAGE_ID;
+        desc->hash_next     = INVALID_BUFFER;
+        desc->free_next     = (i + 1 < num_frames) ? (int32_t)(i + 1) : INVALID_BUFFER;
+        sync_rwlock_init(&desc->content_lock);
+    }
+    pool->free_list = 0;
+
+    sync_mutex_init(&pool->lock);
+    sync_cond_init(&pool->io_done);
+
+    return pool;
+}
+
+void buffer_pool_destroy(buffer_pool_t* pool) {
+    if (!pool)
+        return;
+
+    buffer_flush_all(pool);
+
+    for (uint32_t i = 0; i < pool->num_frames; i++)
+        sync_rwlock_destroy(&pool->descs[i].content_lock);
+
+    sync_cond_destroy(&pool->io_done);
+    sync_mutex_destroy(&pool->lock);
+    free(pool->frames);
+    free(pool->descs);
+    free(pool->buckets);
+    free(pool);
+}
+
+uint32_t buffer_pool_size(const buffer_pool_t* pool) { return pool->num_frames; }
+
+buffer_strategy_t* buffer_strategy_create(buffer_pool_t* pool, buffer_access_type_t type) {
+    uint32_t ring_bytes;
+    switch (type) {
+        case BUFFER_ACCESS_BULKREAD:
+            ring_bytes = RING_BYTES_BULKREAD;
+            break;
+        case BUFFER_ACCESS_BULKWRITE:
+            ring_bytes = RING_BYTES_BULKWRITE;
+            break;
+        case BUFFER_ACCESS_VACUUM:
+            ring_bytes = RING_BYTES_VACUUM;
+            break;
+        default:
+            return NULL;
+    }
+
+    /* Never let a ring take more than 1/8 of the pool */
+    uint32_t ring_size = ring_bytes / PAGE_SIZE;
+    if (ring_size > pool->num_frames / 8)
+        ring_size = pool->num_frames / 8;
+
+    return buffer_strategy_create_sized(pool, type, ring_size);
+}
+
+buffer_strategy_t* buffer_strategy_create_sized(buffer_pool_t* pool, buffer_access_type_t type,
+                                                uint32_t ring_size) {
+    if (!pool || type == BUFFER_ACCESS_NORMAL || type >= BUFFER_ACCESS_COUNT)
+        return NULL;
+    if (ring_size == 0)
+        ring_size = 1;
+
+    buffer_strategy_t* strategy =
+        (buffer_strategy_t*)malloc(sizeof(buffer_strategy_t) + sizeof(buffer_id_t) * ring_size);
+    if (!strategy)
+        return NULL;
+
+    strategy->pool      = pool;
+    strategy->type      = type;
+    strategy->ring_size = ring_size;
+    strategy->current   = ring_size - 1;
+    for (uint32_t i = 0; i < ring_size; i++)
+        strategy->ring[i] = INVALID_BUFFER;
+
+    return strategy;
+}
+
+void buffer_strategy_free(buffer_strategy_t* strategy) {
+    if (!strategy)
+        return;
+
+    buffer_pool_t* pool = strategy->pool;
+    sync_mutex_lock(&pool->lock);
+    for (uint32_t i = 0; i < strategy->ring_size; i++) {
+        if (strategy->ring[i] >= 0)
+            pool->descs[strategy->ring[i]].ring = NULL;
+    }
+    sync_mutex_unlock(&pool->lock);
+    free(strategy);
+}
+
+uint32_t buffer_strategy_ring_size(const buffer_strategy_t* strategy) {
+    return strategy ? strategy->ring_size : 0;
+}
+
+buffer_id_t buffer_read(buffer_pool_t* pool, disk_manager_t* file, page_id_t page_id,
+                        buffer_strategy_t* strategy) {
+    if (!pool || !file || page_id == INVALID_PAGE_ID)
+        return INVALID_BUFFER;
+    return pin_page(pool, file, page_id, strategy, true);
+}
+
+buffer_id_t buffer_extend(buffer_pool_t* pool, disk_manager_t* file, buffer_strategy_t* strategy,
+                          page_id_t* page_id) {
+    if (!pool || !file)
+        return INVALID_BUFFER;
+
+    page_id_t new_page = disk_manager_allocate_page(file);
+    if (new_page == INVALID_PAGE_ID)
+        return INVALID_BUFFER;
+
+    buffer_id_t buf = pin_page(pool, file, new_page, strategy, false);
+    if (buf >= 0 && page_id)
+        *page_id = new_page;
+    return buf;
+}
+
+void buffer_release(buffer_pool_t* pool, buffer_id_t buf) {
+    sync_mutex_lock(&pool->lock);
+    if (pool->descs[buf].refcount > 0)
+        pool->descs[buf].refcount--;
+    sync_mutex_unlock(&pool->lock);
+}
+
+void* buffer_page(buffer_pool_t* pool, buffer_id_t buf) {
+    return pool->frames + (size_t)buf * PAGE_SIZE;
+}
+
+page_id_t buffer_page_id(buffer_pool_t* pool, buffer_id_t buf) { return pool->descs[buf].page_id; }
+
+void buffer_mark_dirty(buffer_pool_t* pool, buffer_id_t buf) {
+    sync_mutex_lock(&pool->lock);
+    pool->descs[buf].flags |= BUF_DIRTY | BUF_JUST_DIRTIED;
+    sync_mutex_unlock(&pool->lock);
+}
+
+void buffer_lock(buffer_pool_t* pool, buffer_id_t buf, buffer_lock_mode_t mode) {
+    if (mode == BUFFER_LOCK_EXCLUSIVE)
+        sync_rwlock_wrlock(&pool->descs[buf].content_lock);
+    else
+        sync_rwlock_rdlock(&pool->descs[buf].content_lock);
+}
+
+void buffer_unlock(buffer_pool_t* pool, buffer_id_t buf, buffer_lock_mode_t mode) {
+    if (mode == BUFFER_LOCK_EXCLUSIVE)
+        sync_rwlock_wrunlock(&pool->descs[buf].content_lock);
+    else
+        sync_rwlock_rdunlock(&pool->descs[buf].content_lock);
+}
+
+/* Flush every dirty frame matching file (or all frames when file is NULL) */
+static bool flush_frames(buffer_pool_t* pool, disk_manager_t* file) {
+    bool ok = true;
+
+    sync_mutex_lock(&pool->lock);
+    for (uint32_t i = 0; i < pool->num_frames; i++) {
+        buffer_desc_t* desc = &pool->descs[i];
+        if (file && desc->file != file)
+            continue;
+
+        while (desc->flags & BUF_IO_IN_PROGRESS)
+            sync_cond_wait(&pool->io_done, &pool->lock);
+
+        if ((desc->flags & (BUF_VALID | BUF_DIRTY)) != (BUF_VALID | BUF_DIRTY))
+            continue;
+
+        desc->refcount++;
+        if (!write_back(pool, (buffer_id_t)i))
+            ok = false;
+        desc->refcount--;
+    }
+    sync_mutex_unlock(&pool->lock);
+
+    return ok;
+}
+
+bool buffer_flush_file(buffer_pool_t* pool, disk_manager_t* file) {
+    if (!pool || !file)
+        return false;
+    return flush_frames(pool, file);
+}
+
+bool buffer_drop_file(buffer_pool_t* pool, disk_manager_t* file) {
+    if (!buffer_flush_file(pool, file))
+        return false;
+
+    bool ok = true;
+    sync_mutex_lock(&pool->lock);
+    for (uint32_t i = 0; i < pool->num_frames; i++) {
+        buffer_desc_t* desc = &pool->descs[i];
+        if (desc->file != file || !(desc->flags & BUF_TAG_VALID))
+            continue;
+        if (desc->refcount != 0 || (desc->flags & BUF_DIRTY)) {
+            ok = false;
+            continue;
+        }
+        invalidate_frame(pool, (buffer_id_t)i);
+    }
+    sync_mutex_unlock(&pool->lock);
+
+    return ok;
+}
+
+bool buffer_flush_all(buffer_pool_t* pool) {
+    if (!pool)
+        return false;
+    return flush_frames(pool, NULL);
+}
+
+void buffer_pool_get_stats(buffer_pool_t* pool, buffer_pool_stats_t* stats) {
+    sync_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    sync_mutex_unlock(&pool->lock);
+}
+
+void buffer_pool_reset_stats(buffer_pool_t* pool) {
+    sync_mutex_lock(&pool->lock);
+    memset(&pool->stats, 0, sizeof(pool->stats));
+    sync_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,604 @@
+/**
+ * @file codec.c
+ * @brief Implementation of the column codecs
+ *
+ * Bit-packed values are read by loading the 8 bytes at the value's first
+ * byte and shifting by its bit position within that byte, which needs no
+ * branches for values up to 56 bits wide; wider ranges are stored plain.
+ * The AVX2 kernels do the same for four values at once, loading them with
+ * a gather. They are compiled for AVX2 whatever the build flags and are
+ * picked at run time when the CPU has it, so a portable build still uses
+ * them. Predicates and delta decoding unpack a chunk at a time into a
+ * buffer on the stack.
+ */
+
+#include <monodb/core/storage/codec.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define CODEC_AVX2 1
+#define CODEC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/* Widest bit-packed value: its bits must fit in 8 bytes loaded from its first byte */
+#define CODEC_MAX_WIDTH 56
+
+/* Padding after a bit-packed payload */
+#define CODEC_PADDING 8
+
+/* Values unpacked at a time by predicates and delta decoding */
+#define CODEC_CHUNK 256
+
+#if defined(CODEC_AVX2)
+/* Whether the AVX2 kernels run; -1 until the CPU has been checked */
+static atomic_int use_avx2 = -1;
+
+static bool cpu_has_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+
+static bool avx2_enabled(void) {
+    int on = atomic_load_explicit(&use_avx2, memory_order_relaxed);
+    if (on < 0) {
+        int unknown = -1;
+        on          = cpu_has_avx2();
+        if (!atomic_compare_exchange_strong(&use_avx2, &unknown, on))
+            on = unknown;
+    }
+    return on;
+}
+#endif
+
+/* Stream header */
+typedef struct {
+    uint8_t  kind;
+    uint8_t  width;
+    uint16_t reserved;
+    uint32_t count;
+    uint64_t base;
+} codec_header_t;
+
+/* Order two values by the column's signedness */
+static bool value_less(bool is_signed, uint64_t a, uint64_t b) {
+    return is_signed ? (int64_t)a < (int64_t)b : a < b;
+}
+
+/* Bits needed for values 0..range */
+static uint32_t bit_width(uint64_t range) {
+    uint32_t w = 0;
+    while (w < 64 && (range >> w) != 0)
+        w++;
+    return w;
+}
+
+static size_t packed_size(uint32_t n, uint32_t width) {
+    return width == 0 ? 0 : ((uint64_t)n * width + 7) / 8 + CODEC_PADDING;
+}
+
+/* Bit-pack n values at the given width; out must be zeroed */
+static void pack(const uint64_t* values, uint32_t n, uint32_t width, uint64_t base,
+                 uint8_t* out) {
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t bit = (uint64_t)i * width;
+        uint64_t word;
+        memcpy(&word, out + bit / 8, sizeof(word));
+        word |= (values[i] - base) << (bit % 8);
+        memcpy(out + bit / 8, &word, sizeof(word));
+    }
+}
+
+#if defined(CODEC_AVX2)
+/* unpack() for the first n / 4 * 4 values */
+CODEC_TARGET_AVX2 static void unpack_avx2(const uint8_t* in, uint32_t first, uint32_t n,
+                                          uint32_t width, uint64_t mask, uint64_t base,
+                                          uint64_t* out) {
+    __m256i vbit  = _mm256_setr_epi64x((long long)((uint64_t)first * width),
+                                       (long long)((uint64_t)(first + 1) * width),
+                                       (long long)((uint64_t)(first + 2) * width),
+                                       (long long)((uint64_t)(first + 3) * width));
+    __m256i vstep = _mm256_set1_epi64x((long long)(4ull * width));
+    __m256i vmask = _mm256_set1_epi64x((long long)mask);
+    __m256i vbase = _mm256_set1_epi64x((long long)base);
+    __m256i seven = _mm256_set1_epi64x(7);
+    for (uint32_t i = 0; i + 4 <= n; i += 4) {
+        __m256i words = _mm256_i64gather_epi64((const long long*)in, _mm256_srli_epi64(vbit, 3),
+                                               1);
+        __m256i v     = _mm256_srlv_epi64(words, _mm256_and_si256(vbit, seven));
+        v             = _mm256_add_epi64(_mm256_and_si256(v, vmask), vbase);
+        _mm256_storeu_si256((__m256i*)(out + i), v);
+        vbit = _mm256_add_epi64(vbit, vstep);
+    }
+}
+#endif
+
+/* Unpack values first..first + n - 1 and add base */
+static void unpack(const uint8_t* in, uint32_t first, uint32_t n, uint32_t width, uint64_t base,
+                   uint64_t* out) {
+    if (width == 0) {
+        for (uint32_t i = 0; i < n; i++)
+            out[i] = base;
+        return;
+    }
+
+    uint64_t mask = (1ull << width) - 1;
+    uint32_t i    = 0;
+#if defined(CODEC_AVX2)
+    if (avx2_enabled()) {
+        unpack_avx2(in, first, n, width, mask, base, out);
+        i = n & ~3u;
+    }
+#endif
+    for (; i < n; i++) {
+        uint64_t bit = (uint64_t)(first + i) * width;
+        uint64_t word;
+        memcpy(&word, in + bit / 8, sizeof(word));
+        out[i] = ((word >> (bit % 8)) & mask) + base;
+    }
+}
+
+/* Value range of a column in its order */
+static void value_range(const uint64_t* values, uint32_t n, bool is_signed, uint64_t* min,
+                        uint64_t* max) {
+    *min = *max = values[0];
+    for (uint32_t i = 1; i < n; i++) {
+        if (value_less(is_signed, values[i], *min))
+            *min = values[i];
+        if (value_less(is_signed, *max, values[i]))
+            *max = values[i];
+    }
+}
+
+/* Range of the differences between neighbours, as signed values */
+static void delta_range(const uint64_t* values, uint32_t n, uint64_t* min, uint64_t* max) {
+    *min = *max = values[1] - values[0];
+    for (uint32_t i = 2; i < n; i++) {
+        uint64_t d = values[i] - values[i - 1];
+        if ((int64_t)d < (int64_t)*min)
+            *min = d;
+        if ((int64_t)*max < (int64_t)d)
+            *max = d;
+    }
+}
+
+size_t codec_bound(uint32_t n) { return CODEC_HEADER_SIZE + (size_t)n * 8 + 2 * CODEC_PADDING; }
+
+codec_kind_t codec_choose(const uint64_t* values, uint32_t n, bool is_signed) {
+    if (n <= 1)
+        return CODEC_CONSTANT;
+
+    /* Windows of 16 neighbours spread evenly, or every value of a short column */
+    uint64_t sample[CODEC_SAMPLE_SIZE];
+    uint32_t windows = n <= CODEC_SAMPLE_SIZE ? 1 : CODEC_SAMPLE_SIZE / 16;
+    uint32_t span    = n <= CODEC_SAMPLE_SIZE ? n : 16;
+    uint32_t m = 0, changes = 0;
+    uint64_t dmin = 0, dmax = 0;
+    bool     has_delta = false;
+    for (uint32_t w = 0; w < windows; w++) {
+        uint32_t start = windows == 1 ? 0 : (uint32_t)((uint64_t)w * (n - span) / (windows - 1));
+        for (uint32_t i = 0; i < span; i++) {
+            uint64_t v  = values[start + i];
+            sample[m++] = v;
+            if (i == 0)
+                continue;
+            changes += v != values[start + i - 1];
+            uint64_t d = v - values[start + i - 1];
+            if (!has_delta || (int64_t)d < (int64_t)dmin)
+                dmin = d;
+            if (!has_delta || (int64_t)dmax < (int64_t)d)
+                dmax = d;
+            has_delta = true;
+        }
+    }
+
+    uint64_t min, max;
+    value_range(sample, m, is_signed, &min, &max);
+    if (min == max)
+        return CODEC_CONSTANT;
+
+    /* Estimated payload bytes of each codec over the whole column; runs are estimated from
+     * how often neighbours in the sample differ */
+    uint32_t     for_width   = bit_width(max - min);
+    uint32_t     delta_width = bit_width(dmax - dmin);
+    double       runs        = 1 + (double)changes * (n - 1) / (m - windows);
+    double       cost[CODEC_COUNT];
+    cost[CODEC_PLAIN]    = 8.0 * n;
+    cost[CODEC_CONSTANT] = 1e300;
+    cost[CODEC_RLE]      = 4 + 12.0 * runs;
+    cost[CODEC_DELTA]    = delta_width > CODEC_MAX_WIDTH ? 1e300 : 8 + (double)n * delta_width / 8;
+    cost[CODEC_FOR]      = for_width > CODEC_MAX_WIDTH ? 1e300 : (double)n * for_width / 8;
+
+    /* Ties go to the codec that is cheaper to decode */
+    static const codec_kind_t order[] = {CODEC_FOR, CODEC_DELTA, CODEC_RLE, CODEC_PLAIN};
+    codec_kind_t              best    = order[0];
+    for (int i = 1; i < 4; i++) {
+        if (cost[order[i]] < cost[best])
+            best = order[i];
+    }
+    return best;
+}
+
+size_t codec_encode(const uint64_t* values, uint32_t n, bool is_signed, codec_kind_t kind,
+                    void* out) {
+    codec_header_t header;
+    uint8_t*       payload = (uint8_t*)out + CODEC_HEADER_SIZE;
+    size_t         size    = 0;
+    memset(&header, 0, sizeof(header));
+    header.count = n;
+
+    uint64_t min = 0, max = 0;
+    if (n > 0)
+        value_range(values, n, is_signed, &min, &max);
+    if (min == max)
+        kind = CODEC_CONSTANT;
+    else if (kind == CODEC_CONSTANT)
+        kind = CODEC_FOR;
+
+    switch (kind) {
+    case CODEC_CONSTANT:
+        header.base = min;
+        break;
+    case CODEC_FOR: {
+        uint32_t width = bit_width(max - min);
+        if (width > CODEC_MAX_WIDTH) {
+            kind = CODEC_PLAIN;
+            break;
+        }
+        header.width = (uint8_t)width;
+        header.base  = min;
+        size         = packed_size(n, width);
+        memset(payload, 0, size);
+        pack(values, n, width, min, payload);
+        break;
+    }
+    case CODEC_DELTA: {
+        uint64_t dmin, dmax;
+        delta_range(values, n, &dmin, &dmax);
+        uint32_t width = bit_width(dmax - dmin);
+        if (width > CODEC_MAX_WIDTH) {
+            kind = CODEC_PLAIN;
+            break;
+        }
+        header.width = (uint8_t)width;
+        header.base  = values[0];
+        memcpy(payload, &dmin, sizeof(dmin));
+        size = sizeof(dmin) + packed_size(n - 1, width);
+        memset(payload + sizeof(dmin), 0, size - sizeof(dmin));
+
+        /* Pack the differences a chunk at a time */
+        uint64_t deltas[CODEC_CHUNK];
+        uint8_t* packed = payload + sizeof(dmin);
+        for (uint32_t i = 1; i < n;) {
+            uint32_t k = n - i < CODEC_CHUNK ? n - i : CODEC_CHUNK;
+            for (uint32_t j = 0; j < k; j++)
+                deltas[j] = values[i + j] - values[i + j - 1] - dmin;
+            for (uint32_t j = 0; j < k; j++) {
+                uint64_t bit = (uint64_t)(i - 1 + j) * width;
+                uint64_t word;
+                memcpy(&word, packed + bit / 8, sizeof(word));
+                word |= deltas[j] << (bit % 8);
+                memcpy(packed + bit / 8, &word, sizeof(word));
+            }
+            i += k;
+        }
+        break;
+    }
+    case CODEC_RLE: {
+        uint32_t runs = 1;
+        for (uint32_t i = 1; i < n; i++)
+            runs += values[i] != values[i - 1];
+        if (4 + (size_t)runs * 12 >= (size_t)n * 8) {
+            kind = CODEC_PLAIN;
+            break;
+        }
+        uint8_t* run_values = payload + sizeof(uint32_t);
+        uint8_t* run_ends   = run_values + (size_t)runs * sizeof(uint64_t);
+        uint32_t r          = 0;
+        memcpy(payload, &runs, sizeof(runs));
+        for (uint32_t i = 1; i <= n; i++) {
+            if (i < n && values[i] == values[i - 1])
+                continue;
+            memcpy(run_values + (size_t)r * sizeof(uint64_t), &values[i - 1], sizeof(uint64_t));
+            memcpy(run_ends + (size_t)r * sizeof(uint32_t), &i, sizeof(uint32_t));
+            r++;
+        }
+        size = sizeof(uint32_t) + (size_t)runs * 12;
+        break;
+    }
+    default:
+        kind = CODEC_PLAIN;
+        break;
+    }
+
+    if (kind == CODEC_PLAIN) {
+        header.width = 64;
+        size         = (size_t)n * sizeof(uint64_t);
+        if (n > 0)
+            memcpy(payload, values, size);
+    }
+    header.kind = (uint8_t)kind;
+    memcpy(out, &header, sizeof(header));
+    return CODEC_HEADER_SIZE + size;
+}
+
+/* Parse a stream header and find the stream's length; false if malformed */
+static bool parse(const void* in, size_t len, uint32_t n, codec_header_t* header, size_t* size) {
+    if (!in || len < CODEC_HEADER_SIZE)
+        return false;
+    memcpy(header, in, sizeof(*header));
+    if (header->count != n || header->reserved != 0)
+        return false;
+
+    const uint8_t* payload = (const uint8_t*)in + CODEC_HEADER_SIZE;
+    size_t         avail   = len - CODEC_HEADER_SIZE;
+    switch (header->kind) {
+    case CODEC_PLAIN:
+        *size = (size_t)n * sizeof(uint64_t);
+        break;
+    case CODEC_CONSTANT:
+        *size = 0;
+        break;
+    case CODEC_FOR:
+        if (header->width > CODEC_MAX_WIDTH)
+            return false;
+        *size = packed_size(n, header->width);
+        break;
+    case CODEC_DELTA:
+        if (header->width > CODEC_MAX_WIDTH || n == 0)
+            return false;
+        *size = sizeof(uint64_t) + packed_size(n - 1, header->width);
+        break;
+    case CODEC_RLE: {
+        uint32_t runs;
+        if (avail < sizeof(runs))
+            return false;
+        memcpy(&runs, payload, sizeof(runs));
+        if (runs == 0 || runs > n)
+            return false;
+        *size = sizeof(runs) + (size_t)runs * 12;
+        if (*size > avail)
+            return false;
+
+        /* Run ends must rise to n */
+        uint32_t prev = 0, end = 0;
+        for (uint32_t r = 0; r < runs; r++) {
+            memcpy(&end, payload + sizeof(runs) + (size_t)runs * 8 + (size_t)r * 4, sizeof(end));
+            if (end <= prev || end > n)
+                return false;
+            prev = end;
+        }
+        if (end != n)
+            return false;
+        break;
+    }
+    default:
+        return false;
+    }
+    return *size <= avail;
+}
+
+codec_kind_t codec_stream_kind(const void* in, size_t len) {
+    if (!in || len < CODEC_HEADER_SIZE || ((const uint8_t*)in)[0] >= CODEC_COUNT)
+        return CODEC_COUNT;
+    return (codec_kind_t)((const uint8_t*)in)[0];
+}
+
+/* Decode values first..first + k - 1 of a delta stream, given the value before first */
+static void delta_chunk(const uint8_t* payload, uint32_t width, uint32_t first, uint32_t k,
+                        uint64_t prev, uint64_t* out) {
+    uint64_t dmin;
+    memcpy(&dmin, payload, sizeof(dmin));
+    unpack(payload + sizeof(dmin), first - 1, k, width, dmin, out);
+    for (uint32_t j = 0; j < k; j++) {
+        prev += out[j];
+        out[j] = prev;
+    }
+}
+
+size_t codec_decode(const void* in, size_t len, uint64_t* out, uint32_t n) {
+    codec_header_t header;
+    size_t         size;
+    if (!parse(in, len, n, &header, &size))
+        return 0;
+
+    const uint8_t* payload = (const uint8_t*)in + CODEC_HEADER_SIZE;
+    switch (header.kind) {
+    case CODEC_PLAIN:
+        memcpy(out, payload, size);
+        break;
+    case CODEC_CONSTANT:
+        for (uint32_t i = 0; i < n; i++)
+            out[i] = header.base;
+        break;
+    case CODEC_FOR:
+        unpack(payload, 0, n, header.width, header.base, out);
+        break;
+    case CODEC_DELTA:
+        out[0] = header.base;
+        if (n > 1)
+            delta_chunk(payload, header.width, 1, n - 1, header.base, out + 1);
+        break;
+    case CODEC_RLE: {
+        uint32_t runs, start = 0;
+        memcpy(&runs, payload, sizeof(runs));
+        for (uint32_t r = 0; r < runs; r++) {
+            uint64_t value;
+            uint32_t end;
+            memcpy(&value, payload + sizeof(runs) + (size_t)r * 8, sizeof(value));
+            memcpy(&end, payload + sizeof(runs) + (size_t)runs * 8 + (size_t)r * 4, sizeof(end));
+            for (uint32_t i = start; i < end; i++)
+                out[i] = value;
+            start = end;
+        }
+        break;
+    }
+    }
+    return CODEC_HEADER_SIZE + size;
+}
+
+#if defined(CODEC_AVX2)
+/* select_packed() for the first n / 4 * 4 offsets; returns the number of positions */
+CODEC_TARGET_AVX2 static uint32_t select_packed_avx2(const uint8_t* in, uint32_t n, uint32_t width,
+                                                     uint64_t mask, uint64_t lo, uint64_t hi,
+                                                     uint32_t* sel) {
+    /* Positions and number of the set bits of each 4-bit match mask */
+    static const uint32_t positions[16][4] = {
+        {0, 0, 0, 0}, {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0}, {2, 0, 0, 0}, {0, 2, 0, 0},
+        {1, 2, 0, 0}, {0, 1, 2, 0}, {3, 0, 0, 0}, {0, 3, 0, 0}, {1, 3, 0, 0}, {0, 1, 3, 0},
+        {2, 3, 0, 0}, {0, 2, 3, 0}, {1, 2, 3, 0}, {0, 1, 2, 3}};
+    static const uint8_t  matches[16]      = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+    uint32_t              count            = 0;
+    __m256i vbit  = _mm256_setr_epi64x(0, (long long)width, (long long)(2ull * width),
+                                       (long long)(3ull * width));
+    __m256i vstep = _mm256_set1_epi64x((long long)(4ull * width));
+    __m256i vmask = _mm256_set1_epi64x((long long)mask);
+    __m256i vlo   = _mm256_set1_epi64x((long long)lo - 1);
+    __m256i vhi   = _mm256_set1_epi64x((long long)hi + 1);
+    __m256i seven = _mm256_set1_epi64x(7);
+    for (uint32_t i = 0; i + 4 <= n; i += 4) {
+        __m256i words = _mm256_i64gather_epi64((const long long*)in, _mm256_srli_epi64(vbit, 3),
+                                               1);
+        __m256i v     = _mm256_srlv_epi64(words, _mm256_and_si256(vbit, seven));
+        v             = _mm256_and_si256(v, vmask);
+        __m256i match = _mm256_and_si256(_mm256_cmpgt_epi64(v, vlo), _mm256_cmpgt_epi64(vhi, v));
+        int     m     = _mm256_movemask_pd(_mm256_castsi256_pd(match));
+        __m128i pos   = _mm_add_epi32(_mm_set1_epi32((int)i),
+                                      _mm_loadu_si128((const __m128i*)positions[m]));
+        _mm_storeu_si128((__m128i*)(sel + count), pos);
+        count += matches[m];
+        vbit = _mm256_add_epi64(vbit, vstep);
+    }
+    return count;
+}
+#endif
+
+/*
+ * Append the positions of the packed offsets in [lo, hi], which must be
+ * below 2^56, without materializing the values; returns the new count
+ */
+static uint32_t select_packed(const uint8_t* in, uint32_t n, uint32_t width, uint64_t lo,
+                              uint64_t hi, uint32_t* sel) {
+    uint64_t mask  = (1ull << width) - 1;
+    uint32_t count = 0, i = 0;
+#if defined(CODEC_AVX2)
+    if (avx2_enabled()) {
+        count = select_packed_avx2(in, n, width, mask, lo, hi, sel);
+        i     = n & ~3u;
+    }
+#endif
+    for (; i < n; i++) {
+        uint64_t bit = (uint64_t)i * width;
+        uint64_t word;
+        memcpy(&word, in + bit / 8, sizeof(word));
+        sel[count] = i;
+        count += ((word >> (bit % 8)) & mask) - lo <= hi - lo;
+    }
+    return count;
+}
+
+/* Append the positions first.. of values v with v - lo <= span; returns the new count */
+static uint32_t select_chunk(const uint64_t* values, uint32_t k, uint32_t first, uint64_t lo,
+                             uint64_t span, uint32_t* sel, uint32_t count) {
+    for (uint32_t j = 0; j < k; j++) {
+        sel[count] = first + j;
+        count += values[j] - lo <= span;
+    }
+    return count;
+}
+
+uint32_t codec_select(const void* in, size_t len, uint32_t n, bool is_signed, uint64_t lo,
+                      uint64_t hi, uint32_t* sel) {
+    codec_header_t header;
+    size_t         size;
+    if (!parse(in, len, n, &header, &size))
+        return UINT32_MAX;
+    if (value_less(is_signed, hi, lo))
+        return 0;
+
+    /* Values in range are those whose distance above lo is at most span, in any order */
+    const uint8_t* payload = (const uint8_t*)in + CODEC_HEADER_SIZE;
+    uint64_t       span    = hi - lo;
+    uint64_t       chunk[CODEC_CHUNK];
+    uint32_t       count   = 0;
+    switch (header.kind) {
+    case CODEC_CONSTANT:
+        if (header.base - lo > span)
+            return 0;
+        for (uint32_t i = 0; i < n; i++)
+            sel[i] = i;
+        return n;
+    case CODEC_PLAIN:
+        for (uint32_t i = 0; i < n; i++) {
+            uint64_t v;
+            memcpy(&v, payload + (size_t)i * 8, sizeof(v));
+            sel[count] = i;
+            count += v - lo <= span;
+        }
+        return count;
+    case CODEC_FOR: {
+        /* Compare offsets from the base: clip the range to the offsets the width can hold */
+        uint64_t mask = header.width == 0 ? 0 : (1ull << header.width) - 1;
+        if (value_less(is_signed, hi, header.base))
+            return 0;
+        uint64_t olo = value_less(is_signed, lo, header.base) ? 0 : lo - header.base;
+        uint64_t ohi = hi - header.base < mask ? hi - header.base : mask;
+        if (olo > mask)
+            return 0;
+        if (header.width == 0) {
+            for (uint32_t i = 0; i < n; i++)
+                sel[i] = i;
+            return n;
+        }
+        return select_packed(payload, n, header.width, olo, ohi, sel);
+    }
+    case CODEC_DELTA: {
+        uint64_t prev = header.base;
+        count         = select_chunk(&prev, 1, 0, lo, span, sel, 0);
+        for (uint32_t i = 1; i < n; i += CODEC_CHUNK) {
+            uint32_t k = n - i < CODEC_CHUNK ? n - i : CODEC_CHUNK;
+            delta_chunk(payload, header.width, i, k, prev, chunk);
+            prev  = chunk[k - 1];
+            count = select_chunk(chunk, k, i, lo, span, sel, count);
+        }
+        return count;
+    }
+    case CODEC_RLE: {
+        uint32_t runs, start = 0;
+        memcpy(&runs, payload, sizeof(runs));
+        for (uint32_t r = 0; r < runs; r++) {
+            uint64_t value;
+            uint32_t end;
+            memcpy(&value, payload + sizeof(runs) + (size_t)r * 8, sizeof(value));
+            memcpy(&end, payload + sizeof(runs) + (size_t)runs * 8 + (size_t)r * 4, sizeof(end));
+            if (value - lo <= span) {
+                for (uint32_t i = start; i < end; i++)
+                    sel[count++] = i;
+            }
+            start = end;
+        }
+        return count;
+    }
+    }
+    return UINT32_MAX;
+}
+
+bool codec_set_simd(bool enabled) {
+#if defined(CODEC_AVX2)
+    int on = enabled && cpu_has_avx2();
+    atomic_store_explicit(&use_avx2, on, memory_order_relaxed);
+    return on;
+#else
+    (void)enabled;
+    return false;
+#endif
+}
+
+bool codec_simd_enabled(void) {
+#if defined(CODEC_AVX2)
+    return avx2_enabled();
+#else
+    return false;
+#endif
+}
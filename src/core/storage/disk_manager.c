@@ -0,0 +1,200 @@
+/**
+ * @file disk_manager.c
+ * @brief Implementation of page-granular file I/O
+ */
+
+#include <fcntl.h>
+#include <monodb/core/common/sync.h>
+#include <monodb/core/storage/disk_manager.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS
+#pragma warning(disable:4996)   // disable deprecated function warnings
+#endif
+
+/* Platform-specific includes */
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#define open_compat _open
+#define close_compat _close
+#define fsync_compat _commit
+#define OPEN_FLAGS (O_CREAT | O_RDWR | O_BINARY)
+typedef __int64 ssize_t;
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#define open_compat open
+#define close_compat close
+#define fsync_compat fsync
+#define OPEN_FLAGS (O_CREAT | O_RDWR)
+#endif
+
+/**
+ * Disk manager structure
+ */
+struct disk_manager_t {
+    int              fd;             /* File descriptor */
+    char             path[256];      /* Path of the storage file */
+    uint32_t         file_id;        /* Process-unique file identifier */
+    _Atomic uint32_t num_pages;      /* Current file length in pages */
+    sync_mutex_t     extend_lock;    /* Serializes file extension */
+#ifdef _WIN32
+    sync_mutex_t     io_lock;        /* Serializes seek + read/write pairs */
+#endif
+
+    /* Statistics */
+    _Atomic uint64_t pages_read;
+    _Atomic uint64_t pages_written;
+    _Atomic uint64_t syncs;
+};
+
+static _Atomic uint32_t next_file_id = 1;
+
+/* Positioned read of exactly len bytes */
+static bool read_at(disk_manager_t* dm, void* buf, size_t len, uint64_t offset) {
+#ifdef _WIN32
+    sync_mutex_lock(&dm->io_lock);
+    bool ok = _lseeki64(dm->fd, (__int64)offset, SEEK_SET) >= 0 &&
+              _read(dm->fd, buf, (unsigned int)len) == (int)len;
+    sync_mutex_unlock(&dm->io_lock);
+    return ok;
+#else
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(dm->fd, (char*)buf + done, len - done, (off_t)(offset + done));
+        if (n <= 0)
+            return false;
+        done += (size_t)n;
+    }
+    return true;
+#endif
+}
+
+/* Positioned write of exactly len bytes */
+static bool write_at(disk_manager_t* dm, const void* buf, size_t len, uint64_t offset) {
+#ifdef _WIN32
+    sync_mutex_lock(&dm->io_lock);
+    bool ok = _lseeki64(dm->fd, (__int64)offset, SEEK_SET) >= 0 &&
+              _write(dm->fd, buf, (unsigned int)len) == (int)len;
+    sync_mutex_unlock(&dm->io_lock);
+    return ok;
+#else
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pwrite(dm->fd, (const char*)buf + done, len - done, (off_t)(offset + done));
+        if (n <= 0)
+            return false;
+        done += (size_t)n;
+    }
+    return true;
+#endif
+}
+
+disk_manager_t* disk_manager_open(const char* path) {
+    if (!path || strlen(path) >= sizeof(((disk_manager_t*)0)->path))
+        return NULL;
+
+    disk_manager_t* dm = (disk_manager_t*)calloc(1, sizeof(disk_manager_t));
+    if (!dm)
+        return NULL;
+
+    strcpy(dm->path, path);
+    dm->fd = open_compat(path, OPEN_FLAGS, 0644);
+    if (dm->fd < 0) {
+        free(dm);
+        return NULL;
+    }
+
+    /* Derive the page count from the file length; a torn trailing page is ignored */
+    struct stat st;
+    if (fstat(dm->fd, &st) != 0) {
+        close_compat(dm->fd);
+        free(dm);
+        return NULL;
+    }
+
+    atomic_init(&dm->num_pages, (uint32_t)((uint64_t)st.st_size / PAGE_SIZE));
+    dm->file_id = atomic_fetch_add(&next_file_id, 1);
+    sync_mutex_init(&dm->extend_lock);
+#ifdef _WIN32
+    sync_mutex_init(&dm->io_lock);
+#endif
+
+    return dm;
+}
+
+void disk_manager_close(disk_manager_t* dm) {
+    if (!dm)
+        return;
+
+    disk_manager_sync(dm);
+    close_compat(dm->fd);
+    sync_mutex_destroy(&dm->extend_lock);
+#ifdef _WIN32
+    sync_mutex_destroy(&dm->io_lock);
+#endif
+    free(dm);
+}
+
+uint32_t disk_manager_file_id(const disk_manager_t* dm) { return dm->file_id; }
+
+bool disk_manager_read_page(disk_manager_t* dm, page_id_t page_id, void* buf) {
+    if (!dm || page_id >= atomic_load(&dm->num_pages))
+        return false;
+
+    atomic_fetch_add(&dm->pages_read, 1);
+    return read_at(dm, buf, PAGE_SIZE, (uint64_t)page_id * PAGE_SIZE);
+}
+
+bool disk_manager_write_page(disk_manager_t* dm, page_id_t page_id, const void* buf) {
+    if (!dm || page_id >= atomic_load(&dm->num_pages))
+        return false;
+
+    atomic_fetch_add(&dm->pages_written, 1);
+    return write_at(dm, buf, PAGE_SIZE, (uint64_t)page_id * PAGE_SIZE);
+}
+
+page_id_t disk_manager_allocate_page(disk_manager_t* dm) {
+    static const uint8_t zero_page[PAGE_SIZE];
+
+    if (!dm)
+        return INVALID_PAGE_ID;
+
+    sync_mutex_lock(&dm->extend_lock);
+
+    page_id_t page_id = atomic_load(&dm->num_pages);
+    if (page_id == INVALID_PAGE_ID ||
+        !write_at(dm, zero_page, PAGE_SIZE, (uint64_t)page_id * PAGE_SIZE)) {
+        sync_mutex_unlock(&dm->extend_lock);
+        return INVALID_PAGE_ID;
+    }
+
+    /* Publish the new length only once the page exists on disk */
+    atomic_store(&dm->num_pages, page_id + 1);
+    sync_mutex_unlock(&dm->extend_lock);
+
+    return page_id;
+}
+
+uint32_t disk_manager_num_pages(disk_manager_t* dm) {
+    return dm ? atomic_load(&dm->num_pages) : 0;
+}
+
+bool disk_manager_sync(disk_manager_t* dm) {
+    if (!dm)
+        return false;
+
+    atomic_fetch_add(&dm->syncs, 1);
+    return fsync_compat(dm->fd) == 0;
+}
+
+void disk_manager_get_stats(disk_manager_t* dm, disk_manager_stats_t* stats) {
+    stats->pages_read    = atomic_load(&dm->pages_read);
+    stats->pages_written = atomic_load(&dm->pages_written);
+    stats->syncs         = atomic_load(&dm->syncs);
+}
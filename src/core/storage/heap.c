@@ -0,0 +1,785 @@
+/**
+ * @file heap.c
+ * @brief Implementation of heap files and sequential scans
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/storage/heap.h>
+#include <monodb/core/storage/sync_scan.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Visibility map file: magic, page count, then one bit per page */
+#define VM_MAGIC 0x314D5648u /* "HVM1" */
+
+/**
+ * Heap structure
+ */
+struct heap_t {
+    buffer_pool_t*    pool;          /* Buffer pool caching the heap */
+    disk_manager_t*   file;          /* Heap file */
+    _Atomic page_id_t target_page;   /* Page most likely to have room for an insert */
+    _Atomic uint32_t  prune_horizon; /* Versions deleted before this xid are dead to all */
+    _Atomic uint32_t  reserve;       /* Bytes inserts leave free on a page (fill factor) */
+
+    /* Visibility map: one all-visible bit per page */
+    sync_rwlock_t     vm_lock;  /* Shared: testing and changing bits; exclusive: growing */
+    _Atomic uint64_t* vm;       /* Bitmap words */
+    uint32_t          vm_words; /* Words allocated */
+    char*             vm_path;  /* Where the map is saved on close */
+
+    /* Statistics */
+    _Atomic uint64_t hot_updates;
+    _Atomic uint64_t cold_updates;
+    _Atomic uint64_t prunes;
+    _Atomic uint64_t pruned_versions;
+};
+
+/**
+ * Sequential scan structure
+ */
+struct heap_scan_t {
+    heap_t*            heap;         /* Heap being scanned */
+    buffer_strategy_t* strategy;     /* Bulk-read ring, or NULL */
+    bool               sync;         /* Taking part in synchronized scanning */
+    uint32_t           num_pages;    /* Pages covered by the scan */
+    page_id_t*         pages;        /* Pages of a sample scan, in reading order; NULL otherwise */
+    page_id_t          start_page;   /* First page read */
+    page_id_t          current_page; /* Page currently held in page_copy */
+    uint32_t           pages_done;   /* Pages fully consumed */
+    uint16_t           next_slot;    /* Next slot to inspect on current_page */
+    bool               page_loaded;  /* page_copy holds current_page */
+    uint8_t            page_copy[PAGE_SIZE];
+};
+
+/* A page that was allocated but not yet formatted holds no tuples */
+static inline bool is_heap_page(const void* page) {
+    return ((const page_header_t*)page)->type == PAGE_TYPE_HEAP;
+}
+
+/* Return the tuple stored in a slot (live or not), or NULL */
+static inline heap_tuple_header_t* slot_tuple(void* page, uint16_t slot, uint16_t* len) {
+    uint16_t             item_len;
+    heap_tuple_header_t* tuple = (heap_tuple_header_t*)page_get_item(page, slot, &item_len);
+    if (tuple && len)
+        *len = (uint16_t)(item_len - sizeof(heap_tuple_header_t));
+    return tuple;
+}
+
+/*
+ * Follow a HOT chain from its root (or any member) to the live version.
+ * Returns the live tuple and its slot, or NULL if the chain has no live
+ * member on this page.
+ */
+static heap_tuple_header_t* chain_live_tuple(void* page, page_id_t page_id, uint16_t slot,
+                                             uint16_t* live_slot, uint16_t* len) {
+    uint16_t num_slots = page_num_slots(page);
+
+    if (page_slot_state(page, slot) == SLOT_REDIRECT)
+        slot = page_get_redirect(page, slot);
+
+    /* A chain can be no longer than the number of slots on the page */
+    for (uint16_t steps = 0; steps < num_slots; steps++) {
+        heap_tuple_header_t* tuple = slot_tuple(page, slot, len);
+        if (!tuple)
+            return NULL;
+        if (tuple->xmax == 0) {
+            if (live_slot)
+                *live_slot = slot;
+            return tuple;
+        }
+        if (!(tuple->flags & HEAP_TUPLE_HOT_UPDATED) || tuple->next.page_id != page_id)
+            return NULL;
+        slot = tuple->next.slot;
+    }
+
+    return NULL;
+}
+
+/* Clear a page's all-visible bit; called with the page latched exclusively */
+static void vm_clear(heap_t* heap, page_id_t page_id) {
+    sync_rwlock_rdlock(&heap->vm_lock);
+    if (page_id / 64 < heap->vm_words)
+        atomic_fetch_and(&heap->vm[page_id / 64], ~(1ull << (page_id % 64)));
+    sync_rwlock_rdunlock(&heap->vm_lock);
+}
+
+/* Set a page's all-visible bit, growing the map if needed; called with the page latched */
+static bool vm_set(heap_t* heap, page_id_t page_id) {
+    uint32_t word = page_id / 64;
+    for (;;) {
+        sync_rwlock_rdlock(&heap->vm_lock);
+        bool fits = word < heap->vm_words;
+        if (fits)
+            atomic_fetch_or(&heap->vm[word], 1ull << (page_id % 64));
+        sync_rwlock_rdunlock(&heap->vm_lock);
+        if (fits)
+            return true;
+
+        sync_rwlock_wrlock(&heap->vm_lock);
+        if (word >= heap->vm_words) {
+            uint32_t words = heap->vm_words * 2 > word + 1 ? heap->vm_words * 2 : word + 1;
+            _Atomic uint64_t* vm =
+                (_Atomic uint64_t*)realloc((void*)heap->vm, words * sizeof(uint64_t));
+            if (!vm) {
+                sync_rwlock_wrunlock(&heap->vm_lock);
+                return false;
+            }
+            for (uint32_t i = heap->vm_words; i < words; i++)
+                atomic_init(&vm[i], 0);
+            heap->vm       = vm;
+            heap->vm_words = words;
+        }
+        sync_rwlock_wrunlock(&heap->vm_lock);
+    }
+}
+
+/* Load the map saved when the heap was last closed, then remove the file */
+static void vm_load(heap_t* heap) {
+    FILE* f = fopen(heap->vm_path, "rb");
+    if (!f)
+        return;
+
+    uint32_t header[2];
+    uint32_t num_pages = disk_manager_num_pages(heap->file);
+    uint32_t words     = (num_pages + 63) / 64;
+    if (fread(header, sizeof(header), 1, f) == 1 && header[0] == VM_MAGIC &&
+        header[1] == num_pages && words > 0) {
+        uint64_t* bits = (uint64_t*)malloc(words * sizeof(uint64_t));
+        if (bits && fread(bits, sizeof(uint64_t), words, f) == words) {
+            heap->vm = (_Atomic uint64_t*)malloc(words * sizeof(uint64_t));
+            if (heap->vm) {
+                for (uint32_t i = 0; i < words; i++)
+                    atomic_init(&heap->vm[i], bits[i]);
+                heap->vm_words = words;
+            }
+        }
+        free(bits);
+    }
+    fclose(f);
+
+    /* Changes made from now on are only known in memory until the next close */
+    remove(heap->vm_path);
+}
+
+/* Save the map for the next open; a heap with no all-visible pages needs no file */
+static void vm_save(heap_t* heap) {
+    uint32_t num_pages = disk_manager_num_pages(heap->file);
+    uint32_t words     = (num_pages + 63) / 64;
+    bool     any       = false;
+    for (uint32_t i = 0; i < heap->vm_words && !any; i++)
+        any = atomic_load(&heap->vm[i]) != 0;
+    if (!any)
+        return;
+
+    FILE* f = fopen(heap->vm_path, "wb");
+    if (!f)
+        return;
+
+    uint32_t header[2] = {VM_MAGIC, num_pages};
+    bool     ok        = fwrite(header, sizeof(header), 1, f) == 1;
+    for (uint32_t i = 0; ok && i < words; i++) {
+        uint64_t bits = i < heap->vm_words ? atomic_load(&heap->vm[i]) : 0;
+        ok            = fwrite(&bits, sizeof(bits), 1, f) == 1;
+    }
+    if (fclose(f) != 0 || !ok)
+        remove(heap->vm_path);
+}
+
+/* Build a tuple (header + payload) in item; returns the item length */
+static uint16_t form_tuple(uint8_t* item, const void* data, uint16_t len, uint32_t xid,
+                           uint16_t flags) {
+    heap_tuple_header_t* tuple = (heap_tuple_header_t*)item;
+    memset(tuple, 0, sizeof(*tuple));
+    tuple->xmin  = xid;
+    tuple->next  = INVALID_TUPLE_ID;
+    tuple->flags = flags;
+    if (len > 0)
+        memcpy(item + sizeof(*tuple), data, len);
+    return (uint16_t)(sizeof(*tuple) + len);
+}
+
+/*
+ * Prune a page held with an exclusive latch. For every chain, versions that
+ * are dead to all transactions are removed: the root line pointer becomes a
+ * redirect to the first surviving version (or dead if none survive) and
+ * dead heap-only members are freed. Returns the number of versions removed.
+ */
+static uint32_t prune_page(heap_t* heap, void* page, page_id_t page_id) {
+    uint32_t horizon   = atomic_load(&heap->prune_horizon);
+    uint16_t num_slots = page_num_slots(page);
+    uint32_t pruned    = 0;
+    uint16_t chain[PAGE_SIZE / sizeof(page_slot_t)];
+
+    for (uint16_t root = 0; root < num_slots; root++) {
+        page_slot_state_t state = page_slot_state(page, root);
+        uint16_t          first = root;
+
+        if (state == SLOT_REDIRECT) {
+            first = page_get_redirect(page, root);
+        } else if (state == SLOT_NORMAL) {
+            /* Heap-only tuples are reached from their root, never on their own */
+            if (slot_tuple(page, root, NULL)->flags & HEAP_TUPLE_HEAP_ONLY)
+                continue;
+        } else {
+            continue;
+        }
+
+        /* Collect the chain and find the first version that is not dead */
+        uint16_t length    = 0;
+        int      survivor  = -1;
+        uint16_t slot      = first;
+        while (length < num_slots) {
+            heap_tuple_header_t* tuple = slot_tuple(page, slot, NULL);
+            if (!tuple)
+                break;
+            chain[length++] = slot;
+
+            bool dead = tuple->xmax != 0 && tuple->xmax < horizon;
+            if (!dead) {
+                survivor = length - 1;
+                break;
+            }
+            if (!(tuple->flags & HEAP_TUPLE_HOT_UPDATED) || tuple->next.page_id != page_id)
+                break;
+            slot = tuple->next.slot;
+        }
+
+        if (survivor == 0 && state == SLOT_NORMAL)
+            continue; /* Root version itself is still needed */
+
+        /* Free every dead member; the root line pointer stays for the indexes */
+        uint16_t dead_count = survivor < 0 ? length : (uint16_t)survivor;
+        for (uint16_t i = 0; i < dead_count; i++) {
+            if (chain[i] != root)
+                page_set_slot_unused(page, chain[i]);
+            pruned++;
+        }
+
+        if (survivor < 0)
+            page_set_slot_dead(page, root);
+        else if (chain[survivor] != root)
+            page_set_slot_redirect(page, root, chain[survivor]);
+    }
+
+    page_compact(page);
+    page_header(page)->flags &= (uint16_t)~HEAP_PAGE_PRUNABLE;
+
+    atomic_fetch_add(&heap->prunes, 1);
+    atomic_fetch_add(&heap->pruned_versions, pruned);
+    return pruned;
+}
+
+/* Prune a pinned page if it has prunable versions and is running out of space */
+static void prune_if_needed(heap_t* heap, buffer_id_t buf) {
+    void* page = buffer_page(heap->pool, buf);
+
+    buffer_lock(heap->pool, buf, BUFFER_LOCK_SHARE);
+    bool wanted = is_heap_page(page) && (page_header(page)->flags & HEAP_PAGE_PRUNABLE) &&
+                  page_free_space(page) < HEAP_PRUNE_FREE_THRESHOLD;
+    buffer_unlock(heap->pool, buf, BUFFER_LOCK_SHARE);
+
+    if (!wanted)
+        return;
+
+    buffer_lock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+    /* Re-check: somebody else may have pruned while we waited */
+    if (page_header(page)->flags & HEAP_PAGE_PRUNABLE) {
+        prune_page(heap, page, buffer_page_id(heap->pool, buf));
+        buffer_mark_dirty(heap->pool, buf);
+    }
+    buffer_unlock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+}
+
+heap_t* heap_open(buffer_pool_t* pool, const char* path) {
+    if (!pool || !path)
+        return NULL;
+
+    heap_t* heap = (heap_t*)calloc(1, sizeof(heap_t));
+    if (!heap)
+        return NULL;
+
+    heap->pool    = pool;
+    heap->vm_path = (char*)malloc(strlen(path) + 4);
+    heap->file    = heap->vm_path ? disk_manager_open(path) : NULL;
+    if (!heap->file) {
+        free(heap->vm_path);
+        free(heap);
+        return NULL;
+    }
+    sprintf(heap->vm_path, "%s.vm", path);
+    sync_rwlock_init(&heap->vm_lock);
+    vm_load(heap);
+
+    uint32_t num_pages = disk_manager_num_pages(heap->file);
+    atomic_init(&heap->target_page, num_pages > 0 ? num_pages - 1 : INVALID_PAGE_ID);
+    atomic_init(&heap->prune_horizon, UINT32_MAX);
+    heap_set_fillfactor(heap, HEAP_DEFAULT_FILLFACTOR);
+
+    return heap;
+}
+
+void heap_close(heap_t* heap) {
+    if (!heap)
+        return;
+
+    buffer_drop_file(heap->pool, heap->file);
+    sync_scan_forget(disk_manager_file_id(heap->file));
+    vm_save(heap);
+    disk_manager_close(heap->file);
+    sync_rwlock_destroy(&heap->vm_lock);
+    free((void*)heap->vm);
+    free(heap->vm_path);
+    free(heap);
+}
+
+buffer_pool_t* heap_pool(const heap_t* heap) { return heap->pool; }
+
+disk_manager_t* heap_file(const heap_t* heap) { return heap->file; }
+
+uint32_t heap_num_pages(const heap_t* heap) { return disk_manager_num_pages(heap->file); }
+
+/* Store a prepared tuple on the target page or a new page */
+static bool insert_item(heap_t* heap, const uint8_t* item, uint16_t item_len, tuple_id_t* tid) {
+    /* Try the current target page first, leaving the fill factor reserve free */
+    uint32_t  reserve = atomic_load(&heap->reserve);
+    page_id_t target  = atomic_load(&heap->target_page);
+    if (target != INVALID_PAGE_ID) {
+        buffer_id_t buf = buffer_read(heap->pool, heap->file, target, NULL);
+        if (buf >= 0) {
+            prune_if_needed(heap, buf);
+
+            buffer_lock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+            void* page = buffer_page(heap->pool, buf);
+            int   slot = -1;
+            if (is_heap_page(page) && page_free_space(page) >= item_len + reserve)
+                slot = page_add_item(page, item, item_len);
+            if (slot >= 0) {
+                vm_clear(heap, target);
+                buffer_mark_dirty(heap->pool, buf);
+            }
+            buffer_unlock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+            buffer_release(heap->pool, buf);
+
+            if (slot >= 0) {
+                if (tid)
+                    *tid = (tuple_id_t){target, (uint16_t)slot};
+                return true;
+            }
+        }
+    }
+
+    /* No room: extend the heap with a fresh page */
+    page_id_t   page_id;
+    buffer_id_t buf = buffer_extend(heap->pool, heap->file, NULL, &page_id);
+    if (buf < 0)
+        return false;
+
+    buffer_lock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+    void* page = buffer_page(heap->pool, buf);
+    page_init(page, page_id, PAGE_TYPE_HEAP, 0);
+    int slot = page_add_item(page, item, item_len);
+    buffer_mark_dirty(heap->pool, buf);
+    buffer_unlock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+    buffer_release(heap->pool, buf);
+
+    if (slot < 0)
+        return false;
+
+    atomic_store(&heap->target_page, page_id);
+    if (tid)
+        *tid = (tuple_id_t){page_id, (uint16_t)slot};
+    return true;
+}
+
+bool heap_insert(heap_t* heap, const void* data, uint16_t len, uint32_t xid, tuple_id_t* tid) {
+    if (!heap || (len > 0 && !data) || len > HEAP_MAX_TUPLE_SIZE)
+        return false;
+
+    /* Assemble header and payload so the page sees a single item */
+    uint8_t  item[PAGE_SIZE];
+    uint16_t item_len = form_tuple(item, data, len, xid, 0);
+
+    return insert_item(heap, item, item_len, tid);
+}
+
+bool heap_fetch(heap_t* heap, tuple_id_t tid, void* buf, uint16_t buf_size, uint16_t* len) {
+    if (!heap || tid.page_id >= heap_num_pages(heap))
+        return false;
+
+    buffer_id_t b = buffer_read(heap->pool, heap->file, tid.page_id, NULL);
+    if (b < 0)
+        return false;
+
+    prune_if_needed(heap, b);
+
+    buffer_lock(heap->pool, b, BUFFER_LOCK_SHARE);
+    void*                page = buffer_page(heap->pool, b);
+    uint16_t             data_len;
+    heap_tuple_header_t* tuple =
+        is_heap_page(page) ? chain_live_tuple(page, tid.page_id, tid.slot, NULL, &data_len) : NULL;
+    if (tuple) {
+        if (buf)
+            memcpy(buf, tuple + 1, data_len < buf_size ? data_len : buf_size);
+        if (len)
+            *len = data_len;
+    }
+    buffer_unlock(heap->pool, b, BUFFER_LOCK_SHARE);
+    buffer_release(heap->pool, b);
+
+    return tuple != NULL;
+}
+
+bool heap_update(heap_t* heap, tuple_id_t tid, const void* data, uint16_t len, uint32_t xid,
+                 bool allow_hot, tuple_id_t* new_tid, bool* hot) {
+    if (!heap || (len > 0 && !data) || len > HEAP_MAX_TUPLE_SIZE ||
+        tid.page_id >= heap_num_pages(heap))
+        return false;
+
+    uint8_t  item[PAGE_SIZE];
+    uint16_t item_len = form_tuple(item, data, len, xid, allow_hot ? HEAP_TUPLE_HEAP_ONLY : 0);
+
+    buffer_id_t buf = buffer_read(heap->pool, heap->file, tid.page_id, NULL);
+    if (buf < 0)
+        return false;
+
+    if (allow_hot) {
+        buffer_lock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+        void*                page = buffer_page(heap->pool, buf);
+        uint16_t             old_slot;
+        heap_tuple_header_t* old =
+            is_heap_page(page) ? chain_live_tuple(page, tid.page_id, tid.slot, &old_slot, NULL)
+                               : NULL;
+        if (!old) {
+            buffer_unlock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+            buffer_release(heap->pool, buf);
+            return false;
+        }
+
+        /* Make room by pruning before giving up on a heap-only update */
+        int slot = page_add_item(page, item, item_len);
+        if (slot < 0 && (page_header(page)->flags & HEAP_PAGE_PRUNABLE)) {
+            prune_page(heap, page, tid.page_id);
+            old  = slot_tuple(page, old_slot, NULL);
+            slot = page_add_item(page, item, item_len);
+        }
+
+        if (slot >= 0) {
+            old->xmax  = xid;
+            old->next  = (tuple_id_t){tid.page_id, (uint16_t)slot};
+            old->flags |= HEAP_TUPLE_HOT_UPDATED;
+            page_header(page)->flags |= HEAP_PAGE_PRUNABLE;
+            vm_clear(heap, tid.page_id);
+            buffer_mark_dirty(heap->pool, buf);
+            buffer_unlock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+            buffer_release(heap->pool, buf);
+
+            atomic_fetch_add(&heap->hot_updates, 1);
+            if (new_tid)
+                *new_tid = (tuple_id_t){tid.page_id, (uint16_t)slot};
+            if (hot)
+                *hot = true;
+            return true;
+        }
+
+        buffer_unlock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+
+        /* Fall back to a regular update: the new version must be indexed */
+        ((heap_tuple_header_t*)item)->flags = 0;
+    }
+
+    /* Place the new version first, then stamp the old one as superseded */
+    tuple_id_t placed;
+    if (!insert_item(heap, item, item_len, &placed)) {
+        buffer_release(heap->pool, buf);
+        return false;
+    }
+
+    buffer_lock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+    void*                page = buffer_page(heap->pool, buf);
+    heap_tuple_header_t* old =
+        is_heap_page(page) ? chain_live_tuple(page, tid.page_id, tid.slot, NULL, NULL) : NULL;
+    if (old) {
+        old->xmax = xid;
+        old->next = placed;
+        page_header(page)->flags |= HEAP_PAGE_PRUNABLE;
+        vm_clear(heap, tid.page_id);
+        buffer_mark_dirty(heap->pool, buf);
+    }
+    buffer_unlock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+    buffer_release(heap->pool, buf);
+
+    if (!old) {
+        /* Lost a race with a concurrent update or delete; retract our version */
+        heap_delete(heap, placed, xid);
+        return false;
+    }
+
+    atomic_fetch_add(&heap->cold_updates, 1);
+    if (new_tid)
+        *new_tid = placed;
+    if (hot)
+        *hot = false;
+    return true;
+}
+
+bool heap_delete(heap_t* heap, tuple_id_t tid, uint32_t xid) {
+    if (!heap || tid.page_id >= heap_num_pages(heap))
+        return false;
+
+    buffer_id_t b = buffer_read(heap->pool, heap->file, tid.page_id, NULL);
+    if (b < 0)
+        return false;
+
+    buffer_lock(heap->pool, b, BUFFER_LOCK_EXCLUSIVE);
+    void*                page = buffer_page(heap->pool, b);
+    heap_tuple_header_t* tuple =
+        is_heap_page(page) ? chain_live_tuple(page, tid.page_id, tid.slot, NULL, NULL) : NULL;
+    if (tuple) {
+        tuple->xmax = xid;
+        page_header(page)->flags |= HEAP_PAGE_PRUNABLE;
+        vm_clear(heap, tid.page_id);
+        buffer_mark_dirty(heap->pool, b);
+    }
+    buffer_unlock(heap->pool, b, BUFFER_LOCK_EXCLUSIVE);
+    buffer_release(heap->pool, b);
+
+    return tuple != NULL;
+}
+
+void heap_set_fillfactor(heap_t* heap, uint32_t fillfactor) {
+    if (fillfactor < HEAP_MIN_FILLFACTOR)
+        fillfactor = HEAP_MIN_FILLFACTOR;
+    if (fillfactor > 100)
+        fillfactor = 100;
+    atomic_store(&heap->reserve, (uint32_t)(PAGE_SIZE - sizeof(page_header_t)) *
+                                     (100 - fillfactor) / 100);
+}
+
+void heap_set_prune_horizon(heap_t* heap, uint32_t xid) { atomic_store(&heap->prune_horizon, xid); }
+
+uint32_t heap_prune_page(heap_t* heap, page_id_t page_id) {
+    if (!heap || page_id >= heap_num_pages(heap))
+        return 0;
+
+    buffer_id_t buf = buffer_read(heap->pool, heap->file, page_id, NULL);
+    if (buf < 0)
+        return 0;
+
+    uint32_t pruned = 0;
+    buffer_lock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+    void* page = buffer_page(heap->pool, buf);
+    if (is_heap_page(page)) {
+        pruned = prune_page(heap, page, page_id);
+        buffer_mark_dirty(heap->pool, buf);
+    }
+    buffer_unlock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+    buffer_release(heap->pool, buf);
+
+    return pruned;
+}
+
+/* Whether every tuple on a latched page is live and visible to all transactions */
+static bool page_all_visible(const heap_t* heap, void* page) {
+    uint32_t horizon   = atomic_load(&heap->prune_horizon);
+    uint16_t num_slots = page_num_slots(page);
+
+    /* Redirects and dead line pointers hold no tuple; every stored version must be current */
+    for (uint16_t slot = 0; slot < num_slots; slot++) {
+        if (page_slot_state(page, slot) != SLOT_NORMAL)
+            continue;
+        heap_tuple_header_t* tuple = slot_tuple(page, slot, NULL);
+        if (tuple->xmax != 0 || tuple->xmin >= horizon)
+            return false;
+    }
+    return true;
+}
+
+bool heap_vacuum(heap_t* heap, heap_vacuum_stats_t* stats) {
+    if (!heap)
+        return false;
+
+    heap_vacuum_stats_t result    = {0, 0, 0};
+    uint32_t            num_pages = heap_num_pages(heap);
+    buffer_strategy_t*  ring      = buffer_strategy_create(heap->pool, BUFFER_ACCESS_VACUUM);
+    bool                ok        = true;
+
+    for (page_id_t page_id = 0; ok && page_id < num_pages; page_id++) {
+        buffer_id_t buf = buffer_read(heap->pool, heap->file, page_id, ring);
+        if (buf < 0) {
+            ok = false;
+            break;
+        }
+
+        buffer_lock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+        void* page = buffer_page(heap->pool, buf);
+        if (is_heap_page(page)) {
+            if (page_header(page)->flags & HEAP_PAGE_PRUNABLE) {
+                result.pruned_versions += prune_page(heap, page, page_id);
+                buffer_mark_dirty(heap->pool, buf);
+            }
+            /* Changes clear the bit under the same latch, so it cannot be set stale */
+            if (page_all_visible(heap, page)) {
+                ok = vm_set(heap, page_id);
+                result.all_visible++;
+            }
+        }
+        buffer_unlock(heap->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+        buffer_release(heap->pool, buf);
+        result.pages++;
+    }
+
+    buffer_strategy_free(ring);
+    if (stats)
+        *stats = result;
+    return ok;
+}
+
+bool heap_page_all_visible(heap_t* heap, page_id_t page_id) {
+    if (!heap)
+        return false;
+
+    sync_rwlock_rdlock(&heap->vm_lock);
+    bool visible = page_id / 64 < heap->vm_words &&
+                   (atomic_load(&heap->vm[page_id / 64]) >> (page_id % 64)) & 1;
+    sync_rwlock_rdunlock(&heap->vm_lock);
+    return visible;
+}
+
+void heap_get_stats(heap_t* heap, heap_stats_t* stats) {
+    stats->hot_updates     = atomic_load(&heap->hot_updates);
+    stats->cold_updates    = atomic_load(&heap->cold_updates);
+    stats->prunes          = atomic_load(&heap->prunes);
+    stats->pruned_versions = atomic_load(&heap->pruned_versions);
+}
+
+heap_scan_t* heap_scan_begin(heap_t* heap, uint32_t flags) {
+    if (!heap)
+        return NULL;
+
+    heap_scan_t* scan = (heap_scan_t*)calloc(1, sizeof(heap_scan_t));
+    if (!scan)
+        return NULL;
+
+    scan->heap      = heap;
+    scan->num_pages = heap_num_pages(heap);
+
+    /* Large heaps get a ring and join other scans unless told otherwise */
+    bool large = scan->num_pages > buffer_pool_size(heap->pool) / HEAP_LARGE_TABLE_DIVISOR;
+    bool ring  = !(flags & HEAP_SCAN_NO_BULKREAD) && (large || (flags & HEAP_SCAN_BULKREAD));
+    scan->sync = !(flags & HEAP_SCAN_NO_SYNC) && (large || (flags & HEAP_SCAN_SYNC));
+
+    if (ring)
+        scan->strategy = buffer_strategy_create(heap->pool, BUFFER_ACCESS_BULKREAD);
+
+    scan->start_page = 0;
+    if (scan->sync && scan->num_pages > 0) {
+        uint32_t file_id = disk_manager_file_id(heap->file);
+        scan->start_page = sync_scan_get_location(file_id, scan->num_pages);
+    }
+    scan->current_page = scan->start_page;
+
+    return scan;
+}
+
+heap_scan_t* heap_scan_begin_pages(heap_t* heap, const page_id_t* pages, uint32_t num_pages) {
+    if (!heap || (!pages && num_pages > 0))
+        return NULL;
+
+    heap_scan_t* scan = (heap_scan_t*)calloc(1, sizeof(heap_scan_t));
+    if (!scan)
+        return NULL;
+    scan->pages = (page_id_t*)malloc((num_pages ? num_pages : 1) * sizeof(page_id_t));
+    if (!scan->pages) {
+        free(scan);
+        return NULL;
+    }
+
+    /* Pages past the end of the heap are skipped up front */
+    uint32_t heap_pages = heap_num_pages(heap);
+    for (uint32_t i = 0; i < num_pages; i++) {
+        if (pages[i] < heap_pages)
+            scan->pages[scan->num_pages++] = pages[i];
+    }
+    scan->heap         = heap;
+    scan->strategy     = buffer_strategy_create(heap->pool, BUFFER_ACCESS_BULKREAD);
+    scan->start_page   = scan->num_pages ? scan->pages[0] : 0;
+    scan->current_page = scan->start_page;
+    return scan;
+}
+
+/* Copy the next page of the scan into page_copy */
+static bool load_page(heap_scan_t* scan) {
+    heap_t*     heap = scan->heap;
+    buffer_id_t buf  = buffer_read(heap->pool, heap->file, scan->current_page, scan->strategy);
+    if (buf < 0)
+        return false;
+
+    buffer_lock(heap->pool, buf, BUFFER_LOCK_SHARE);
+    memcpy(scan->page_copy, buffer_page(heap->pool, buf), PAGE_SIZE);
+    buffer_unlock(heap->pool, buf, BUFFER_LOCK_SHARE);
+    buffer_release(heap->pool, buf);
+
+    if (scan->sync)
+        sync_scan_report_location(disk_manager_file_id(heap->file), scan->current_page);
+
+    scan->page_loaded = true;
+    scan->next_slot   = 0;
+    return true;
+}
+
+bool heap_scan_next(heap_scan_t* scan, tuple_id_t* tid, const void** data, uint16_t* len) {
+    if (!scan)
+        return false;
+
+    while (scan->pages_done < scan->num_pages) {
+        if (!scan->page_loaded && !load_page(scan))
+            return false;
+
+        void* page = scan->page_copy;
+        if (is_heap_page(page)) {
+            uint16_t num_slots = page_num_slots(page);
+            while (scan->next_slot < num_slots) {
+                uint16_t             slot = scan->next_slot++;
+                uint16_t             data_len;
+                heap_tuple_header_t* tuple = slot_tuple(page, slot, NULL);
+
+                /* Visit each chain once, from its root, and report the root's address */
+                if (tuple && (tuple->flags & HEAP_TUPLE_HEAP_ONLY))
+                    continue;
+                tuple = chain_live_tuple(page, scan->current_page, slot, NULL, &data_len);
+                if (!tuple)
+                    continue;
+
+                if (tid)
+                    *tid = (tuple_id_t){scan->current_page, slot};
+                *data = tuple + 1;
+                *len  = data_len;
+                return true;
+            }
+        }
+
+        /* Advance, wrapping around to the pages before the start point */
+        scan->page_loaded = false;
+        scan->pages_done++;
+        if (scan->pages)
+            scan->current_page = scan->pages[scan->pages_done % scan->num_pages];
+        else
+            scan->current_page = (scan->current_page + 1) % scan->num_pages;
+    }
+
+    return false;
+}
+
+page_id_t heap_scan_start_page(const heap_scan_t* scan) { return scan->start_page; }
+
+void heap_scan_end(heap_scan_t* scan) {
+    if (!scan)
+        return;
+
+    buffer_strategy_free(scan->strategy);
+    free(scan->pages);
+    free(scan);
+}
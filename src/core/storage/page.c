@@ -0,0 +1,234 @@
+/**
+ * @file page.c
+ * @brief Implementation of the common page layout
+ */
+
+#include <monodb/core/storage/page.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Initialize the header of an empty page */
+void page_init(void* page, page_id_t page_id, page_type_t type, uint16_t special_size) {
+    memset(page, 0, PAGE_SIZE);
+
+    page_header_t* hdr = (page_header_t*)page;
+    hdr->page_id       = page_id;
+    hdr->type          = (uint16_t)type;
+    hdr->lower         = sizeof(page_header_t);
+    hdr->upper         = (uint16_t)(PAGE_SIZE - special_size);
+    hdr->special       = (uint16_t)(PAGE_SIZE - special_size);
+}
+
+/* A page that was allocated but never written reads back as zeroes */
+bool page_is_new(const void* page) {
+    const uint64_t* words = (const uint64_t*)page;
+    for (size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); i++) {
+        if (words[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+/* FNV-1a over the page, skipping the checksum field */
+uint32_t page_compute_checksum(const void* page) {
+    const uint8_t* buf  = (const uint8_t*)page;
+    const size_t   skip = offsetof(page_header_t, checksum);
+    uint32_t       hash = 2166136261u;
+
+    for (size_t i = 0; i < PAGE_SIZE; i++) {
+        if (i >= skip && i < skip + sizeof(uint32_t))
+            continue;
+        hash ^= buf[i];
+        hash *= 16777619u;
+    }
+
+    /* Zero is reserved for "no checksum" */
+    return hash == 0 ? 1 : hash;
+}
+
+void page_set_checksum(void* page) {
+    ((page_header_t*)page)->checksum = page_compute_checksum(page);
+}
+
+bool page_verify(const void* page, page_id_t page_id) {
+    if (page_is_new(page))
+        return true;
+
+    const page_header_t* hdr = (const page_header_t*)page;
+    if (hdr->page_id != page_id)
+        return false;
+
+    return hdr->checksum == 0 || hdr->checksum == page_compute_checksum(page);
+}
+
+/* Line pointer array immediately follows the header */
+static inline page_slot_t* page_slots(const void* page) {
+    return (page_slot_t*)((char*)page + sizeof(page_header_t));
+}
+
+static inline page_slot_state_t slot_state(const page_slot_t* slot) {
+    return (page_slot_state_t)(slot->length >> PAGE_SLOT_STATE_SHIFT);
+}
+
+static inline void slot_set(page_slot_t* slot, uint16_t offset, uint16_t len,
+                            page_slot_state_t state) {
+    slot->offset = offset;
+    slot->length = (uint16_t)((len & PAGE_SLOT_LENGTH_MASK) | (state << PAGE_SLOT_STATE_SHIFT));
+}
+
+uint16_t page_num_slots(const void* page) {
+    const page_header_t* hdr = (const page_header_t*)page;
+    return (uint16_t)((hdr->lower - sizeof(page_header_t)) / sizeof(page_slot_t));
+}
+
+uint16_t page_free_space(const void* page) {
+    const page_header_t* hdr   = (const page_header_t*)page;
+    int                  space = (int)hdr->upper - (int)hdr->lower - (int)sizeof(page_slot_t);
+    return space > 0 ? (uint16_t)space : 0;
+}
+
+int page_add_item(void* page, const void* item, uint16_t len) {
+    page_header_t* hdr   = (page_header_t*)page;
+    page_slot_t*   slots = page_slots(page);
+    uint16_t       count = page_num_slots(page);
+
+    /* Look for a recyclable line pointer first */
+    int slot = -1;
+    for (uint16_t i = 0; i < count; i++) {
+        if (slot_state(&slots[i]) == SLOT_UNUSED) {
+            slot = i;
+            break;
+        }
+    }
+
+    uint16_t needed = (uint16_t)(len + (slot < 0 ? sizeof(page_slot_t) : 0));
+    if ((int)hdr->upper - (int)hdr->lower < (int)needed)
+        return -1;
+
+    if (slot < 0) {
+        slot = count;
+        hdr->lower += sizeof(page_slot_t);
+    }
+
+    hdr->upper -= len;
+    memcpy((char*)page + hdr->upper, item, len);
+    slot_set(&slots[slot], hdr->upper, len, SLOT_NORMAL);
+
+    return slot;
+}
+
+bool page_insert_item_at(void* page, uint16_t slot, const void* item, uint16_t len) {
+    page_header_t* hdr   = (page_header_t*)page;
+    page_slot_t*   slots = page_slots(page);
+    uint16_t       count = page_num_slots(page);
+
+    if (slot > count || (int)hdr->upper - (int)hdr->lower < (int)(len + sizeof(page_slot_t)))
+        return false;
+
+    memmove(&slots[slot + 1], &slots[slot], (size_t)(count - slot) * sizeof(page_slot_t));
+    hdr->lower += sizeof(page_slot_t);
+    hdr->upper -= len;
+    memcpy((char*)page + hdr->upper, item, len);
+    slot_set(&slots[slot], hdr->upper, len, SLOT_NORMAL);
+
+    return true;
+}
+
+void page_remove_item_at(void* page, uint16_t slot) {
+    page_header_t* hdr   = (page_header_t*)page;
+    page_slot_t*   slots = page_slots(page);
+    uint16_t       count = page_num_slots(page);
+
+    if (slot >= count)
+        return;
+
+    memmove(&slots[slot], &slots[slot + 1], (size_t)(count - slot - 1) * sizeof(page_slot_t));
+    hdr->lower -= sizeof(page_slot_t);
+}
+
+page_slot_state_t page_slot_state(const void* page, uint16_t slot) {
+    if (slot >= page_num_slots(page))
+        return SLOT_UNUSED;
+    return slot_state(&page_slots(page)[slot]);
+}
+
+void* page_get_item(void* page, uint16_t slot, uint16_t* len) {
+    if (slot >= page_num_slots(page))
+        return NULL;
+
+    page_slot_t* s = &page_slots(page)[slot];
+    if (slot_state(s) != SLOT_NORMAL)
+        return NULL;
+
+    if (len)
+        *len = s->length & PAGE_SLOT_LENGTH_MASK;
+    return (char*)page + s->offset;
+}
+
+void page_set_slot_dead(void* page, uint16_t slot) {
+    if (slot >= page_num_slots(page))
+        return;
+
+    page_slot_t* s = &page_slots(page)[slot];
+    slot_set(s, s->offset, s->length & PAGE_SLOT_LENGTH_MASK, SLOT_DEAD);
+}
+
+void page_set_slot_redirect(void* page, uint16_t slot, uint16_t target) {
+    if (slot >= page_num_slots(page))
+        return;
+    slot_set(&page_slots(page)[slot], target, 0, SLOT_REDIRECT);
+}
+
+uint16_t page_get_redirect(const void* page, uint16_t slot) {
+    return page_slots(page)[slot].offset;
+}
+
+void page_set_slot_unused(void* page, uint16_t slot) {
+    if (slot >= page_num_slots(page))
+        return;
+    slot_set(&page_slots(page)[slot], 0, 0, SLOT_UNUSED);
+}
+
+/* Order live items by descending offset so they can be slid towards the page end */
+static int compare_offset_desc(const void* a, const void* b) {
+    const page_slot_t* sa = *(page_slot_t* const*)a;
+    const page_slot_t* sb = *(page_slot_t* const*)b;
+    return (int)sb->offset - (int)sa->offset;
+}
+
+void page_compact(void* page) {
+    page_header_t* hdr   = (page_header_t*)page;
+    page_slot_t*   slots = page_slots(page);
+    uint16_t       count = page_num_slots(page);
+    page_slot_t*   live[PAGE_SIZE / sizeof(page_slot_t)];
+    uint16_t       num_live = 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        if (slot_state(&slots[i]) == SLOT_NORMAL)
+            live[num_live++] = &slots[i];
+        else if (slot_state(&slots[i]) == SLOT_DEAD)
+            slot_set(&slots[i], 0, 0, SLOT_DEAD);
+    }
+
+    /*
+     * Moving items from the highest offset down never overwrites an item
+     * that has not been moved yet, so memmove in place is safe.
+     */
+    qsort(live, num_live, sizeof(page_slot_t*), compare_offset_desc);
+
+    uint16_t upper = hdr->special;
+    for (uint16_t i = 0; i < num_live; i++) {
+        uint16_t len = live[i]->length & PAGE_SLOT_LENGTH_MASK;
+        upper        = (uint16_t)(upper - len);
+        memmove((char*)page + upper, (char*)page + live[i]->offset, len);
+        live[i]->offset = upper;
+    }
+    hdr->upper = upper;
+
+    /* Trailing unused line pointers can be given back as well */
+    while (count > 0 && slot_state(&slots[count - 1]) == SLOT_UNUSED) {
+        count--;
+        hdr->lower -= sizeof(page_slot_t);
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * @file sync_scan.c
+ * @brief Implementation of the synchronized scan coordinator
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/storage/sync_scan.h>
+
+/**
+ * Scan position of one file
+ */
+typedef struct {
+    uint32_t  file_id;  /* Storage file identifier, 0 if the entry is free */
+    page_id_t location; /* Page most recently reported */
+    uint64_t  last_use; /* LRU clock value of the last access */
+} sync_scan_entry_t;
+
+static sync_mutex_t      scan_lock = SYNC_MUTEX_INITIALIZER;
+static sync_scan_entry_t scan_entries[SYNC_SCAN_MAX_FILES];
+static uint64_t          scan_clock;
+
+/* Find the entry for a file, optionally claiming the least recently used one */
+static sync_scan_entry_t* find_entry(uint32_t file_id, bool create) {
+    sync_scan_entry_t* victim = &scan_entries[0];
+
+    for (int i = 0; i < SYNC_SCAN_MAX_FILES; i++) {
+        sync_scan_entry_t* entry = &scan_entries[i];
+        if (entry->file_id == file_id) {
+            entry->last_use = ++scan_clock;
+            return entry;
+        }
+        if (entry->last_use < victim->last_use)
+            victim = entry;
+    }
+
+    if (!create)
+        return NULL;
+
+    victim->file_id  = file_id;
+    victim->location = 0;
+    victim->last_use = ++scan_clock;
+    return victim;
+}
+
+page_id_t sync_scan_get_location(uint32_t file_id, uint32_t num_pages) {
+    sync_mutex_lock(&scan_lock);
+    sync_scan_entry_t* entry    = find_entry(file_id, true);
+    page_id_t          location = entry->location;
+    sync_mutex_unlock(&scan_lock);
+
+    /* The file may have shrunk since the position was reported */
+    return location < num_pages ? location : 0;
+}
+
+void sync_scan_report_location(uint32_t file_id, page_id_t page_id) {
+    if (page_id % SYNC_SCAN_REPORT_INTERVAL != 0)
+        return;
+
+    sync_mutex_lock(&scan_lock);
+    find_entry(file_id, true)->location = page_id;
+    sync_mutex_unlock(&scan_lock);
+}
+
+void sync_scan_forget(uint32_t file_id) {
+    sync_mutex_lock(&scan_lock);
+    sync_scan_entry_t* entry = find_entry(file_id, false);
+    if (entry) {
+        entry->file_id  = 0;
+        entry->location = 0;
+        entry->last_use = 0;
+    }
+    sync_mutex_unlock(&scan_lock);
+}
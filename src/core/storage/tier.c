@@ -0,0 +1,888 @@
+/**
+ * @file tier.c
+ * @brief Implementation of tier segment files
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/storage/codec.h>
+#include <monodb/core/storage/tier.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS
+#pragma warning(disable:4996)   // disable deprecated function warnings
+#endif
+
+/* Platform-specific includes */
+#ifdef _WIN32
+#include <io.h>
+#define fsync_compat(f) _commit(_fileno(f))
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define fsync_compat(f) fsync(fileno(f))
+#endif
+
+#define TIER_MAGIC   0x54494552 /* "TIER" */
+#define TIER_VERSION 2
+
+/* Version whose integer columns are byte planes too; still readable */
+#define TIER_VERSION_PLANES 1
+
+/* Largest encoding of one byte plane of a block: literal runs add a byte per 128 */
+#define TIER_PLANE_BOUND (TIER_BLOCK_ROWS + TIER_BLOCK_ROWS / 128 + 1)
+
+/**
+ * File header, at offset 0. Column descriptors follow it, then the blocks,
+ * then the block directory (8-byte aligned): one tier_block_t per block
+ * followed by one tier_zone_t per block and column.
+ */
+typedef struct {
+    uint32_t magic;       /* TIER_MAGIC */
+    uint16_t version;     /* TIER_VERSION */
+    uint16_t num_columns; /* Columns per row */
+    uint32_t row_size;    /* Row length in bytes */
+    uint32_t block_rows;  /* Rows per full block */
+    uint64_t num_rows;    /* Rows in the file */
+    uint32_t num_blocks;  /* Blocks in the file */
+    uint32_t reserved;
+    uint64_t directory; /* Offset of the block directory */
+} tier_header_t;
+
+/**
+ * Directory entry of a block. A block starts with the encoded length of
+ * each column chunk (uint32_t each), followed by the chunks in column order.
+ * Integer column chunks are codec streams (codec.h) of the values widened
+ * to 64 bits, each with the codec chosen for it; byte column chunks are
+ * run-length compressed byte planes.
+ */
+typedef struct {
+    uint64_t offset; /* Offset of the block in the file */
+    uint32_t length; /* Encoded length */
+    uint32_t rows;   /* Rows in the block */
+} tier_block_t;
+
+/**
+ * Zone map entry: value range of one column within one block
+ */
+typedef struct {
+    uint64_t min;
+    uint64_t max;
+} tier_zone_t;
+
+/**
+ * Segment writer structure
+ */
+struct tier_writer_t {
+    char*         path;       /* Final path */
+    char*         tmp_path;   /* Path written until the file is complete */
+    FILE*         file;       /* Output file */
+    tier_layout_t layout;     /* Row layout */
+    uint8_t*      rows;       /* Rows of the block being filled */
+    uint32_t      block_fill; /* Rows in the block being filled */
+    uint8_t*      out;        /* Encoded block */
+    uint64_t*     values;     /* One integer column of the block being filled */
+    uint64_t      offset;     /* Current file length */
+    uint64_t      num_rows;   /* Rows appended */
+    tier_block_t* blocks;     /* Directory entries of the written blocks */
+    tier_zone_t*  zones;      /* Zone maps of the written blocks */
+    uint32_t      num_blocks; /* Blocks written */
+    uint32_t      cap_blocks; /* Capacity of blocks and zones */
+};
+
+/**
+ * Segment structure
+ */
+struct tier_segment_t {
+    char*               path;     /* Path of the segment file */
+    sync_mutex_t        map_lock; /* Serializes the first mapping */
+    atomic_bool         mapped;   /* File mapped and validated */
+    const uint8_t*      data;     /* Mapped file */
+    uint64_t            size;     /* Mapped length */
+#ifdef _WIN32
+    HANDLE              handle;  /* File handle */
+    HANDLE              mapping; /* File mapping handle */
+#endif
+    tier_header_t       header; /* Copy of the header */
+    tier_layout_t       layout; /* Row layout */
+    const tier_block_t* blocks; /* Block directory within the mapping */
+    const tier_zone_t*  zones;  /* Zone maps within the mapping */
+
+    /* Statistics */
+    _Atomic uint64_t blocks_read;
+    _Atomic uint64_t blocks_skipped;
+};
+
+/**
+ * Segment scan structure
+ */
+struct tier_scan_t {
+    tier_segment_t* segment;    /* Segment being scanned */
+    tier_filter_t   filter;     /* Range filter */
+    bool            has_filter; /* Whether the filter applies */
+    bool            selected;   /* Whether sel lists the rows of the block passing the filter */
+    uint32_t        block;      /* Next block to decode */
+    uint32_t        block_rows; /* Rows in the decoded block, or in sel */
+    uint32_t        row;        /* Next row of the decoded block, or entry of sel */
+    uint8_t*        rows;       /* Decoded block */
+    uint64_t*       values;     /* One decoded integer column */
+    uint32_t*       sel;        /* Rows passing the filter, found on the compressed column */
+};
+
+/* Read an integer column as a 64-bit value, sign-extending signed columns */
+static uint64_t column_value(const tier_column_t* col, const uint8_t* row) {
+    const uint8_t* p = row + col->offset;
+    bool           s = col->type == TIER_COLUMN_INT;
+    switch (col->size) {
+        case 1: {
+            uint8_t v;
+            memcpy(&v, p, 1);
+            return s ? (uint64_t)(int64_t)(int8_t)v : v;
+        }
+        case 2: {
+            uint16_t v;
+            memcpy(&v, p, 2);
+            return s ? (uint64_t)(int64_t)(int16_t)v : v;
+        }
+        case 4: {
+            uint32_t v;
+            memcpy(&v, p, 4);
+            return s ? (uint64_t)(int64_t)(int32_t)v : v;
+        }
+        default: {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            return v;
+        }
+    }
+}
+
+/* Store a 64-bit value into an integer column, truncating it to the column's width */
+static void store_value(const tier_column_t* col, uint8_t* row, uint64_t value) {
+    uint8_t* p = row + col->offset;
+    switch (col->size) {
+        case 1: {
+            uint8_t v = (uint8_t)value;
+            memcpy(p, &v, 1);
+            break;
+        }
+        case 2: {
+            uint16_t v = (uint16_t)value;
+            memcpy(p, &v, 2);
+            break;
+        }
+        case 4: {
+            uint32_t v = (uint32_t)value;
+            memcpy(p, &v, 4);
+            break;
+        }
+        default:
+            memcpy(p, &value, 8);
+            break;
+    }
+}
+
+/* Largest encoding of one column chunk of a block */
+static size_t chunk_bound(const tier_column_t* col) {
+    if (col->type == TIER_COLUMN_BYTES)
+        return (size_t)col->size * TIER_PLANE_BOUND;
+    return codec_bound(TIER_BLOCK_ROWS);
+}
+
+/* Order two column values by the column's signedness */
+static bool value_less(const tier_column_t* col, uint64_t a, uint64_t b) {
+    if (col->type == TIER_COLUMN_INT)
+        return (int64_t)a < (int64_t)b;
+    return a < b;
+}
+
+bool tier_layout_valid(const tier_layout_t* layout) {
+    if (!layout || layout->row_size == 0 || layout->num_columns == 0 ||
+        layout->num_columns > TIER_MAX_COLUMNS)
+        return false;
+
+    for (uint16_t i = 0; i < layout->num_columns; i++) {
+        const tier_column_t* col = &layout->columns[i];
+        if (col->size == 0 || (uint32_t)col->offset + col->size > layout->row_size)
+            return false;
+        if (col->type == TIER_COLUMN_BYTES)
+            continue;
+        if (col->type != TIER_COLUMN_UINT && col->type != TIER_COLUMN_INT)
+            return false;
+        if (col->size != 1 && col->size != 2 && col->size != 4 && col->size != 8)
+            return false;
+    }
+    return true;
+}
+
+bool tier_filter_valid(const tier_layout_t* layout, const tier_filter_t* filter) {
+    return layout && filter && filter->column < layout->num_columns &&
+           layout->columns[filter->column].type != TIER_COLUMN_BYTES;
+}
+
+bool tier_row_matches(const tier_layout_t* layout, const void* row, const tier_filter_t* filter) {
+    const tier_column_t* col   = &layout->columns[filter->column];
+    uint64_t             value = column_value(col, (const uint8_t*)row);
+    return !value_less(col, value, filter->lo) && !value_less(col, filter->hi, value);
+}
+
+/*
+ * Run-length encode one byte plane. A control byte below 128 announces
+ * that many plus one literal bytes; 128 and above repeat the next byte
+ * (control - 126) times, i.e. runs of 2 to 129.
+ */
+static size_t plane_encode(const uint8_t* in, size_t n, uint8_t* out) {
+    size_t i = 0, o = 0;
+    while (i < n) {
+        size_t run = 1;
+        while (i + run < n && run < 129 && in[i + run] == in[i])
+            run++;
+        if (run >= 2) {
+            out[o++] = (uint8_t)(run + 126);
+            out[o++] = in[i];
+            i += run;
+            continue;
+        }
+
+        /* Literals up to the start of the next run */
+        size_t lit = 1;
+        while (i + lit < n && lit < 128 && !(i + lit + 1 < n && in[i + lit] == in[i + lit + 1]))
+            lit++;
+        out[o++] = (uint8_t)(lit - 1);
+        memcpy(out + o, in + i, lit);
+        o += lit;
+        i += lit;
+    }
+    return o;
+}
+
+/* Decode one byte plane of n values into out at the given stride; returns bytes consumed or 0 */
+static size_t plane_decode(const uint8_t* in, size_t len, uint8_t* out, size_t n, size_t stride) {
+    size_t i = 0, o = 0;
+    while (o < n) {
+        if (i >= len)
+            return 0;
+        uint8_t c = in[i++];
+        if (c < 128) {
+            size_t k = (size_t)c + 1;
+            if (i + k > len || o + k > n)
+                return 0;
+            for (size_t j = 0; j < k; j++)
+                out[(o++) * stride] = in[i++];
+        } else {
+            size_t k = (size_t)c - 126;
+            if (i >= len || o + k > n)
+                return 0;
+            uint8_t v = in[i++];
+            for (size_t j = 0; j < k; j++)
+                out[(o++) * stride] = v;
+        }
+    }
+    return i;
+}
+
+static bool write_bytes(tier_writer_t* writer, const void* data, size_t len) {
+    if (len && fwrite(data, 1, len, writer->file) != len)
+        return false;
+    writer->offset += len;
+    return true;
+}
+
+/* Encode and write the block being filled, recording its directory entry and zone map */
+static bool flush_block(tier_writer_t* writer) {
+    uint32_t             n      = writer->block_fill;
+    const tier_layout_t* layout = &writer->layout;
+    if (n == 0)
+        return true;
+
+    if (writer->num_blocks == writer->cap_blocks) {
+        uint32_t      cap    = writer->cap_blocks ? writer->cap_blocks * 2 : 16;
+        tier_block_t* blocks = (tier_block_t*)realloc(writer->blocks, cap * sizeof(tier_block_t));
+        if (!blocks)
+            return false;
+        writer->blocks = blocks;
+        tier_zone_t* zones =
+            (tier_zone_t*)realloc(writer->zones, (size_t)cap * layout->num_columns *
+                                                     sizeof(tier_zone_t));
+        if (!zones)
+            return false;
+        writer->zones      = zones;
+        writer->cap_blocks = cap;
+    }
+
+    /* Column chunk lengths first, then the chunks */
+    uint8_t  plane[TIER_BLOCK_ROWS];
+    uint32_t lengths[TIER_MAX_COLUMNS];
+    size_t   header = layout->num_columns * sizeof(uint32_t);
+    size_t   o      = header;
+    for (uint16_t c = 0; c < layout->num_columns; c++) {
+        const tier_column_t* col   = &layout->columns[c];
+        size_t               start = o;
+        tier_zone_t* zone = &writer->zones[(size_t)writer->num_blocks * layout->num_columns + c];
+        if (col->type == TIER_COLUMN_BYTES) {
+            for (uint16_t b = 0; b < col->size; b++) {
+                for (uint32_t r = 0; r < n; r++)
+                    plane[r] = writer->rows[(size_t)r * layout->row_size + col->offset + b];
+                o += plane_encode(plane, n, writer->out + o);
+            }
+            lengths[c] = (uint32_t)(o - start);
+            zone->min  = 0;
+            zone->max  = UINT64_MAX;
+            continue;
+        }
+
+        /* Integer columns: the codec the block's values suggest */
+        bool      is_signed = col->type == TIER_COLUMN_INT;
+        uint64_t* values    = writer->values;
+        for (uint32_t r = 0; r < n; r++)
+            values[r] = column_value(col, writer->rows + (size_t)r * layout->row_size);
+        codec_kind_t kind = codec_choose(values, n, is_signed);
+        o += codec_encode(values, n, is_signed, kind, writer->out + o);
+        lengths[c] = (uint32_t)(o - start);
+
+        zone->min = zone->max = values[0];
+        for (uint32_t r = 1; r < n; r++) {
+            if (value_less(col, values[r], zone->min))
+                zone->min = values[r];
+            if (value_less(col, zone->max, values[r]))
+                zone->max = values[r];
+        }
+    }
+    memcpy(writer->out, lengths, header);
+
+    tier_block_t* block = &writer->blocks[writer->num_blocks];
+    block->offset       = writer->offset;
+    block->length       = (uint32_t)o;
+    block->rows         = n;
+    if (!write_bytes(writer, writer->out, o))
+        return false;
+
+    writer->num_blocks++;
+    writer->block_fill = 0;
+    return true;
+}
+
+static void writer_free(tier_writer_t* writer) {
+    if (writer->file)
+        fclose(writer->file);
+    free(writer->path);
+    free(writer->tmp_path);
+    free(writer->rows);
+    free(writer->out);
+    free(writer->values);
+    free(writer->blocks);
+    free(writer->zones);
+    free(writer);
+}
+
+tier_writer_t* tier_writer_create(const char* path, const tier_layout_t* layout) {
+    if (!path || !tier_layout_valid(layout))
+        return NULL;
+
+    tier_writer_t* writer = (tier_writer_t*)calloc(1, sizeof(tier_writer_t));
+    if (!writer)
+        return NULL;
+
+    size_t out_size = layout->num_columns * sizeof(uint32_t);
+    for (uint16_t i = 0; i < layout->num_columns; i++)
+        out_size += chunk_bound(&layout->columns[i]);
+
+    size_t len       = strlen(path);
+    writer->layout   = *layout;
+    writer->path     = (char*)malloc(len + 1);
+    writer->tmp_path = (char*)malloc(len + 5);
+    writer->rows     = (uint8_t*)calloc(TIER_BLOCK_ROWS, layout->row_size);
+    writer->out      = (uint8_t*)malloc(out_size);
+    writer->values   = (uint64_t*)malloc(TIER_BLOCK_ROWS * sizeof(uint64_t));
+    if (!writer->path || !writer->tmp_path || !writer->rows || !writer->out || !writer->values) {
+        writer_free(writer);
+        return NULL;
+    }
+    strcpy(writer->path, path);
+    memcpy(writer->tmp_path, path, len);
+    strcpy(writer->tmp_path + len, ".tmp");
+
+    writer->file = fopen(writer->tmp_path, "wb");
+    if (!writer->file) {
+        writer_free(writer);
+        return NULL;
+    }
+
+    /* The header is rewritten once the directory location is known */
+    tier_header_t header;
+    memset(&header, 0, sizeof(header));
+    bool ok = write_bytes(writer, &header, sizeof(header));
+    for (uint16_t i = 0; ok && i < layout->num_columns; i++)
+        ok = write_bytes(writer, &layout->columns[i], sizeof(tier_column_t));
+    if (!ok) {
+        tier_writer_abort(writer);
+        return NULL;
+    }
+
+    return writer;
+}
+
+bool tier_writer_append(tier_writer_t* writer, const void* row) {
+    if (!writer || !row)
+        return false;
+
+    memcpy(writer->rows + (size_t)writer->block_fill * writer->layout.row_size, row,
+           writer->layout.row_size);
+    writer->block_fill++;
+    writer->num_rows++;
+    return writer->block_fill < TIER_BLOCK_ROWS || flush_block(writer);
+}
+
+uint64_t tier_writer_rows(const tier_writer_t* writer) { return writer->num_rows; }
+
+bool tier_writer_finish(tier_writer_t* writer) {
+    if (!writer)
+        return false;
+
+    static const uint8_t padding[8] = {0};
+
+    bool ok = flush_block(writer) && write_bytes(writer, padding, (8 - writer->offset % 8) % 8);
+
+    tier_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic       = TIER_MAGIC;
+    header.version     = TIER_VERSION;
+    header.num_columns = writer->layout.num_columns;
+    header.row_size    = writer->layout.row_size;
+    header.block_rows  = TIER_BLOCK_ROWS;
+    header.num_rows    = writer->num_rows;
+    header.num_blocks  = writer->num_blocks;
+    header.directory   = writer->offset;
+
+    ok = ok && write_bytes(writer, writer->blocks, writer->num_blocks * sizeof(tier_block_t)) &&
+         write_bytes(writer, writer->zones,
+                     (size_t)writer->num_blocks * writer->layout.num_columns *
+                         sizeof(tier_zone_t));
+    ok = ok && fseek(writer->file, 0, SEEK_SET) == 0 &&
+         fwrite(&header, 1, sizeof(header), writer->file) == sizeof(header);
+    ok = ok && fflush(writer->file) == 0 && fsync_compat(writer->file) == 0;
+    ok = fclose(writer->file) == 0 && ok;
+    writer->file = NULL;
+
+    /* Only a complete, durable file ever carries the final name */
+    ok = ok && rename(writer->tmp_path, writer->path) == 0;
+    if (!ok)
+        remove(writer->tmp_path);
+
+    writer_free(writer);
+    return ok;
+}
+
+void tier_writer_abort(tier_writer_t* writer) {
+    if (!writer)
+        return;
+
+    if (writer->file) {
+        fclose(writer->file);
+        writer->file = NULL;
+    }
+    remove(writer->tmp_path);
+    writer_free(writer);
+}
+
+tier_segment_t* tier_segment_open(const char* path) {
+    if (!path)
+        return NULL;
+
+    tier_segment_t* segment = (tier_segment_t*)calloc(1, sizeof(tier_segment_t));
+    if (!segment)
+        return NULL;
+
+    segment->path = (char*)malloc(strlen(path) + 1);
+    if (!segment->path) {
+        free(segment);
+        return NULL;
+    }
+    strcpy(segment->path, path);
+    sync_mutex_init(&segment->map_lock);
+    atomic_init(&segment->mapped, false);
+    atomic_init(&segment->blocks_read, 0);
+    atomic_init(&segment->blocks_skipped, 0);
+
+    return segment;
+}
+
+static void unmap_file(tier_segment_t* segment) {
+    if (!segment->data)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(segment->data);
+    CloseHandle(segment->mapping);
+    CloseHandle(segment->handle);
+#else
+    munmap((void*)segment->data, (size_t)segment->size);
+#endif
+    segment->data = NULL;
+}
+
+static bool map_file(tier_segment_t* segment) {
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    segment->handle = CreateFileA(segment->path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (segment->handle == INVALID_HANDLE_VALUE)
+        return false;
+    if (!GetFileSizeEx(segment->handle, &size) || size.QuadPart == 0) {
+        CloseHandle(segment->handle);
+        return false;
+    }
+    segment->mapping = CreateFileMappingA(segment->handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!segment->mapping) {
+        CloseHandle(segment->handle);
+        return false;
+    }
+    segment->data = (const uint8_t*)MapViewOfFile(segment->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!segment->data) {
+        CloseHandle(segment->mapping);
+        CloseHandle(segment->handle);
+        return false;
+    }
+    segment->size = (uint64_t)size.QuadPart;
+    return true;
+#else
+    int fd = open(segment->path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    segment->data = (const uint8_t*)data;
+    segment->size = (uint64_t)st.st_size;
+    return true;
+#endif
+}
+
+/* Check the header and directory of a freshly mapped file */
+static bool validate(tier_segment_t* segment) {
+    tier_header_t* header = &segment->header;
+    if (segment->size < sizeof(tier_header_t))
+        return false;
+    memcpy(header, segment->data, sizeof(tier_header_t));
+    if (header->magic != TIER_MAGIC ||
+        (header->version != TIER_VERSION && header->version != TIER_VERSION_PLANES) ||
+        header->num_columns == 0 || header->num_columns > TIER_MAX_COLUMNS ||
+        header->row_size == 0 || header->row_size > UINT16_MAX ||
+        header->block_rows != TIER_BLOCK_ROWS)
+        return false;
+
+    uint64_t columns_end = sizeof(tier_header_t) + header->num_columns * sizeof(tier_column_t);
+    uint64_t dir_size    = (uint64_t)header->num_blocks *
+                        (sizeof(tier_block_t) + header->num_columns * sizeof(tier_zone_t));
+    if (columns_end > header->directory || header->directory % 8 != 0 ||
+        header->directory + dir_size != segment->size)
+        return false;
+
+    segment->layout.row_size    = (uint16_t)header->row_size;
+    segment->layout.num_columns = header->num_columns;
+    memcpy(segment->layout.columns, segment->data + sizeof(tier_header_t),
+           header->num_columns * sizeof(tier_column_t));
+    if (!tier_layout_valid(&segment->layout))
+        return false;
+
+    segment->blocks = (const tier_block_t*)(segment->data + header->directory);
+    segment->zones  = (const tier_zone_t*)(segment->blocks + header->num_blocks);
+
+    uint64_t rows = 0;
+    for (uint32_t i = 0; i < header->num_blocks; i++) {
+        const tier_block_t* block = &segment->blocks[i];
+        if (block->offset < columns_end || block->offset + block->length > header->directory ||
+            block->rows == 0 || block->rows > TIER_BLOCK_ROWS ||
+            block->length < header->num_columns * sizeof(uint32_t))
+            return false;
+        rows += block->rows;
+    }
+    return rows == header->num_rows;
+}
+
+/* Map and validate the file on first use */
+static bool ensure_mapped(tier_segment_t* segment) {
+    if (atomic_load_explicit(&segment->mapped, memory_order_acquire))
+        return true;
+
+    sync_mutex_lock(&segment->map_lock);
+    bool ok = atomic_load_explicit(&segment->mapped, memory_order_relaxed);
+    if (!ok) {
+        ok = map_file(segment);
+        if (ok && !validate(segment)) {
+            unmap_file(segment);
+            ok = false;
+        }
+        if (ok)
+            atomic_store_explicit(&segment->mapped, true, memory_order_release);
+    }
+    sync_mutex_unlock(&segment->map_lock);
+    return ok;
+}
+
+void tier_segment_close(tier_segment_t* segment) {
+    if (!segment)
+        return;
+
+    unmap_file(segment);
+    sync_mutex_destroy(&segment->map_lock);
+    free(segment->path);
+    free(segment);
+}
+
+const char* tier_segment_path(const tier_segment_t* segment) { return segment->path; }
+
+const tier_layout_t* tier_segment_layout(tier_segment_t* segment) {
+    return segment && ensure_mapped(segment) ? &segment->layout : NULL;
+}
+
+bool tier_segment_get_stats(tier_segment_t* segment, tier_segment_stats_t* stats) {
+    if (!segment || !stats || !ensure_mapped(segment))
+        return false;
+
+    stats->rows           = segment->header.num_rows;
+    stats->blocks         = segment->header.num_blocks;
+    stats->file_size      = segment->size;
+    stats->raw_size       = segment->header.num_rows * segment->header.row_size;
+    stats->blocks_read    = atomic_load(&segment->blocks_read);
+    stats->blocks_skipped = atomic_load(&segment->blocks_skipped);
+    return true;
+}
+
+tier_scan_t* tier_scan_begin(tier_segment_t* segment, const tier_filter_t* filter) {
+    if (!segment || !ensure_mapped(segment) ||
+        (filter && !tier_filter_valid(&segment->layout, filter)))
+        return NULL;
+
+    tier_scan_t* scan = (tier_scan_t*)calloc(1, sizeof(tier_scan_t));
+    if (!scan)
+        return NULL;
+
+    /* Bytes not covered by any column stay zero */
+    scan->rows   = (uint8_t*)calloc(TIER_BLOCK_ROWS, segment->layout.row_size);
+    scan->values = (uint64_t*)malloc(TIER_BLOCK_ROWS * sizeof(uint64_t));
+    scan->sel    = (uint32_t*)malloc(TIER_BLOCK_ROWS * sizeof(uint32_t));
+    if (!scan->rows || !scan->values || !scan->sel) {
+        tier_scan_end(scan);
+        return NULL;
+    }
+
+    scan->segment = segment;
+    if (filter) {
+        scan->filter     = *filter;
+        scan->has_filter = true;
+    }
+    return scan;
+}
+
+/* Whether the zone map of a block admits rows passing the scan's filter */
+static bool block_may_match(const tier_scan_t* scan, uint32_t block) {
+    const tier_segment_t* segment = scan->segment;
+    if (!scan->has_filter)
+        return true;
+
+    const tier_column_t* col = &segment->layout.columns[scan->filter.column];
+    const tier_zone_t*   zone =
+        &segment->zones[(size_t)block * segment->layout.num_columns + scan->filter.column];
+    return !value_less(col, zone->max, scan->filter.lo) &&
+           !value_less(col, scan->filter.hi, zone->min);
+}
+
+/* Whether integer columns of a segment are codec streams rather than byte planes */
+static bool uses_codecs(const tier_segment_t* segment) {
+    return segment->header.version >= TIER_VERSION;
+}
+
+/* Find the chunk of a column within a block */
+static bool column_chunk(const tier_segment_t* segment, uint32_t index, uint16_t column,
+                         const uint8_t** chunk, uint32_t* length) {
+    const tier_block_t* block = &segment->blocks[index];
+    const uint8_t*      data  = segment->data + block->offset;
+    uint32_t            lengths[TIER_MAX_COLUMNS];
+    size_t              pos = segment->layout.num_columns * sizeof(uint32_t);
+    memcpy(lengths, data, pos);
+    for (uint16_t c = 0; c < column; c++) {
+        if (lengths[c] > block->length - pos)
+            return false;
+        pos += lengths[c];
+    }
+    if (lengths[column] > block->length - pos)
+        return false;
+    *chunk  = data + pos;
+    *length = lengths[column];
+    return true;
+}
+
+/* Decode every column of a block into the scan's row buffer */
+static bool decode_block(tier_scan_t* scan, uint32_t index) {
+    const tier_segment_t* segment = scan->segment;
+    const tier_layout_t*  layout  = &segment->layout;
+    const tier_block_t*   block   = &segment->blocks[index];
+    const uint8_t*        data    = segment->data + block->offset;
+
+    scan->block_rows = 0;
+
+    uint32_t lengths[TIER_MAX_COLUMNS];
+    size_t   pos = layout->num_columns * sizeof(uint32_t);
+    memcpy(lengths, data, pos);
+
+    for (uint16_t c = 0; c < layout->num_columns; c++) {
+        const tier_column_t* col = &layout->columns[c];
+        if (lengths[c] > block->length - pos)
+            return false;
+
+        const uint8_t* chunk = data + pos;
+        if (col->type != TIER_COLUMN_BYTES && uses_codecs(segment)) {
+            if (codec_decode(chunk, lengths[c], scan->values, block->rows) != lengths[c])
+                return false;
+            for (uint32_t r = 0; r < block->rows; r++)
+                store_value(col, scan->rows + (size_t)r * layout->row_size, scan->values[r]);
+            pos += lengths[c];
+            continue;
+        }
+
+        size_t used = 0;
+        for (uint16_t b = 0; b < col->size; b++) {
+            size_t n = plane_decode(chunk + used, lengths[c] - used,
+                                    scan->rows + col->offset + b, block->rows, layout->row_size);
+            if (n == 0)
+                return false;
+            used += n;
+        }
+        if (used != lengths[c])
+            return false;
+        pos += lengths[c];
+    }
+
+    scan->block_rows = block->rows;
+    scan->row        = 0;
+    return true;
+}
+
+/*
+ * Evaluate the scan's filter on the compressed filter column of a block,
+ * leaving the rows that pass in sel. Returns false if the stream is
+ * damaged.
+ */
+static bool select_block(tier_scan_t* scan, uint32_t index) {
+    const tier_segment_t* segment = scan->segment;
+    const tier_column_t*  col     = &segment->layout.columns[scan->filter.column];
+    const uint8_t*        chunk;
+    uint32_t              length;
+    if (!column_chunk(segment, index, scan->filter.column, &chunk, &length))
+        return false;
+
+    uint32_t n = codec_select(chunk, length, segment->blocks[index].rows,
+                              col->type == TIER_COLUMN_INT, scan->filter.lo, scan->filter.hi,
+                              scan->sel);
+    if (n == UINT32_MAX)
+        return false;
+    scan->block_rows = n;
+    scan->row        = 0;
+    return true;
+}
+
+bool tier_scan_next(tier_scan_t* scan, const void** row) {
+    if (!scan || !row)
+        return false;
+
+    tier_segment_t* segment = scan->segment;
+    for (;;) {
+        while (scan->row < scan->block_rows) {
+            uint32_t       i = scan->selected ? scan->sel[scan->row] : scan->row;
+            const uint8_t* r = scan->rows + (size_t)i * segment->layout.row_size;
+            scan->row++;
+            if (scan->selected || !scan->has_filter ||
+                tier_row_matches(&segment->layout, r, &scan->filter)) {
+                *row = r;
+                return true;
+            }
+        }
+
+        /* Move on to the next block the zone maps do not rule out */
+        while (scan->block < segment->header.num_blocks && !block_may_match(scan, scan->block)) {
+            atomic_fetch_add(&segment->blocks_skipped, 1);
+            scan->block++;
+        }
+        if (scan->block >= segment->header.num_blocks)
+            return false;
+
+        /* With codecs, the filter runs on the compressed column first; blocks where no row
+         * passes are not decoded */
+        uint32_t index = scan->block++;
+        scan->selected = scan->has_filter && uses_codecs(segment);
+        if (scan->selected) {
+            if (!select_block(scan, index))
+                return false;
+            if (scan->block_rows == 0) {
+                atomic_fetch_add(&segment->blocks_skipped, 1);
+                continue;
+            }
+        }
+
+        atomic_fetch_add(&segment->blocks_read, 1);
+        uint32_t selected = scan->block_rows;
+        if (!decode_block(scan, index))
+            return false;
+        if (scan->selected)
+            scan->block_rows = selected;
+    }
+}
+
+uint32_t tier_segment_read_column(tier_segment_t* segment, uint32_t block, uint16_t column,
+                                  uint64_t* values) {
+    if (!segment || !values || !ensure_mapped(segment) ||
+        block >= segment->header.num_blocks || column >= segment->layout.num_columns)
+        return 0;
+
+    const tier_column_t* col  = &segment->layout.columns[column];
+    uint32_t             rows = segment->blocks[block].rows;
+    const uint8_t*       chunk;
+    uint32_t             length;
+    if (col->type == TIER_COLUMN_BYTES || !column_chunk(segment, block, column, &chunk, &length))
+        return 0;
+
+    if (uses_codecs(segment))
+        return codec_decode(chunk, length, values, rows) == length ? rows : 0;
+
+    /* Byte planes: rebuild the column's bytes, then widen them */
+    uint8_t bytes[TIER_BLOCK_ROWS * 8];
+    size_t  used = 0;
+    memset(bytes, 0, (size_t)rows * col->size);
+    for (uint16_t b = 0; b < col->size; b++) {
+        size_t n = plane_decode(chunk + used, length - used, bytes + b, rows, col->size);
+        if (n == 0)
+            return 0;
+        used += n;
+    }
+    if (used != length)
+        return 0;
+
+    tier_column_t packed = {0, col->size, col->type};
+    for (uint32_t r = 0; r < rows; r++)
+        values[r] = column_value(&packed, bytes + (size_t)r * col->size);
+    return rows;
+}
+
+void tier_scan_end(tier_scan_t* scan) {
+    if (!scan)
+        return;
+
+    free(scan->rows);
+    free(scan->values);
+    free(scan->sel);
+    free(scan);
+}
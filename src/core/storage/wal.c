@@ -48,26 +48,30 @@ typedef __int64 ssize_t;
 #define ftruncate_compat ftruncate
 #endif
 
+/* Room for the WAL directory path, and for it followed by a segment file name */
+#define WAL_DIR_SIZE  256
+#define WAL_PATH_SIZE (WAL_DIR_SIZE + 32)
+
 // WAL segment metadata structure
 /**
  * WAL segment file information
  */
 typedef struct {
-    int                 fd;             /* File descriptor */
-    char                filename[256];  /* Filename of the segment */
-    uint32_t            segment_num;    /* Segment number */
-    wal_segment_state_t state;          /* State of the segment */
-    uint32_t            current_offset; /* Current write position */
+    int                 fd;                      /* File descriptor */
+    char                filename[WAL_PATH_SIZE]; /* Filename of the segment */
+    uint32_t            segment_num;             /* Segment number */
+    wal_segment_state_t state;                   /* State of the segment */
+    uint32_t            current_offset;          /* Current write position */
 } wal_segment_t;
 
 /**
  * WAL context structure
  */
 struct wal_context_t {
-    char           wal_dir[256];        /* WAL directory path */
-    uint32_t       segment_size;        /* Size of each WAL segment in bytes */
-    wal_segment_t* current_segment;     /* Current active segment */
-    wal_location_t last_write_location; /* Last write location */
+    char           wal_dir[WAL_DIR_SIZE]; /* WAL directory path */
+    uint32_t       segment_size;          /* Size of each WAL segment in bytes */
+    wal_segment_t* current_segment;       /* Current active segment */
+    wal_location_t last_write_location;   /* Last write location */
 
     /* Current record being built */
     wal_record_header_t* current_record;
@@ -276,6 +280,9 @@ static void log_recovery_progress(wal_recovery_context_t* context, bool force) {
 
 // Public: initialize WAL context and prepare first segment
 wal_context_t* wal_init(const char* wal_dir, uint32_t segment_size) {
+    if (!wal_dir || strlen(wal_dir) >= WAL_DIR_SIZE)
+        return NULL;
+
     /* Initialize CRC32 table if not already done */
     static bool crc32_initialized = false;
     if (!crc32_initialized) {
@@ -333,6 +340,11 @@ void wal_shutdown(wal_context_t* ctx) {
     free(ctx);
 }
 
+wal_location_t wal_last_location(const wal_context_t* ctx) {
+    wal_location_t none = {0, 0};
+    return ctx ? ctx->last_write_location : none;
+}
+
 /* Begin constructing a new WAL record (returns pointer to payload area) */
 void* wal_begin_record(wal_context_t* ctx, wal_record_type_t type, uint32_t xid,
                        uint16_t data_len) {
@@ -484,7 +496,7 @@ bool wal_read_record(wal_context_t* ctx, wal_location_t location, wal_record_hea
 
     if (need_to_open) {
         /* Need to open the segment file */
-        char filename[256];
+        char filename[WAL_PATH_SIZE];
         snprintf(filename, sizeof(filename), "%s/%08X%08X%08X", ctx->wal_dir,
                  (location.segment / 0xFFFFFFFF), (location.segment / 0xFFFF) & 0xFFFF,
                  location.segment & 0xFFFF);
@@ -661,7 +673,7 @@ static bool apply_recovery_record(wal_record_header_t* header,
     }
     
     /* Check if we have a handler for this record type */
-    if (header->type <= WAL_RECORD_SCHEMA && 
+    if (header->type <= WAL_RECORD_BTREE && 
         handlers->handlers[header->type] != NULL) {
         
         /* Call the specific handler for this record type */
@@ -703,7 +715,7 @@ static bool scan_records_for_recovery(wal_context_t* ctx,
     uint32_t current_segment = start_location.segment;
     uint32_t current_offset = start_location.offset;
     
-    char segment_path[256];
+    char segment_path[WAL_PATH_SIZE];
     FILE* segment_file = NULL;
     
     /* Process segments sequentially */
@@ -830,7 +842,11 @@ static bool scan_records_for_recovery(wal_context_t* ctx,
             
             transaction_info_t* txn = header.xid > 0 ? find_transaction(txn_map, header.xid) : NULL;
             
-            if (is_control_record || (txn && txn->state == XACT_COMMITTED)) {
+            /* Records without a transaction (physical changes) are always redone */
+            bool is_system_record = header.xid == 0 && !is_control_record &&
+                                    header.type != WAL_RECORD_NULL;
+
+            if (is_control_record || is_system_record || (txn && txn->state == XACT_COMMITTED)) {
                 if (callback && !callback(&header, data, user_data)) {
                     printf("Error: Callback failed for record at segment %u, offset %u\n",
                           current_segment, current_offset);
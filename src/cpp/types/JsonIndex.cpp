@@ -0,0 +1,430 @@
+/**
+ * @file JsonIndex.cpp
+ * @brief Path/value keys, compressed posting lists, the pending list and lookups
+ */
+
+#include <monodb/cpp/types/JsonIndex.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <monodb/core/storage/codec.h>
+}
+
+namespace monodb {
+
+namespace {
+
+/* Key path steps; a key is its path, kKeyValue, then the scalar's binary form */
+constexpr char kKeyValue  = '\0';
+constexpr char kKeyMember = '\1';
+constexpr char kKeyArray  = '\2';
+
+/* Lists shorter than this keep raw ids, smaller than a codec header and block bounds */
+constexpr size_t kRawIds = 8;
+
+/* Pending list bytes of a new key beyond its text, and of an id */
+constexpr size_t kPendingKeyOverhead = 64;
+constexpr size_t kPendingIdBytes     = 16;
+
+void append_member(std::string& path, std::string_view key) {
+    uint32_t len = static_cast<uint32_t>(key.size());
+    path += kKeyMember;
+    path.append(reinterpret_cast<const char*>(&len), sizeof(len));
+    path += key;
+}
+
+}  // namespace
+
+/* A key of a lookup: its posting list and pending changes */
+struct JsonIndex::Term {
+    const PostingList* list;     /* nullptr if the key has none */
+    const Pending*     pending;  /* nullptr if it has no changes */
+    size_t             estimate; /* Most ids the key can have */
+};
+
+/* Membership tests of ascending ids, decoding only the blocks that may hold them */
+class JsonIndex::Cursor {
+   public:
+    explicit Cursor(const PostingList* list) : list_(list) {}
+
+    bool has(uint64_t id) {
+        if (!list_)
+            return false;
+        const std::vector<Block>& blocks = list_->blocks;
+        if (blocks.empty()) {
+            if (!loaded_) {
+                if (list_->count)
+                    std::memcpy(ids_, list_->data.data(), list_->count * sizeof(uint64_t));
+                loaded_ = true;
+            }
+            while (pos_ < list_->count && ids_[pos_] < id)
+                pos_++;
+            return pos_ < list_->count && ids_[pos_] == id;
+        }
+        if (block_ < blocks.size() && blocks[block_].last < id) {
+            block_ = static_cast<size_t>(
+                std::partition_point(blocks.begin() + static_cast<ptrdiff_t>(block_), blocks.end(),
+                                     [id](const Block& b) { return b.last < id; }) -
+                blocks.begin());
+            loaded_ = false;
+        }
+        if (block_ >= blocks.size() || id < blocks[block_].first)
+            return false;
+        if (!loaded_) {
+            const Block& b   = blocks[block_];
+            size_t       end = block_ + 1 < blocks.size() ? blocks[block_ + 1].offset
+                                                          : list_->data.size();
+            codec_decode(list_->data.data() + b.offset, end - b.offset, ids_, b.count);
+            loaded_ = true;
+            pos_    = 0;
+        }
+        while (ids_[pos_] < id)
+            pos_++;
+        return ids_[pos_] == id;
+    }
+
+   private:
+    const PostingList* list_;
+    size_t             block_  = 0;
+    bool               loaded_ = false;
+    uint32_t           pos_    = 0;
+    uint64_t           ids_[kJsonPostingBlock];
+};
+
+JsonIndex::JsonIndex(size_t pending_limit) : pending_limit_(pending_limit) {}
+
+/* ---- Posting lists ---- */
+
+/* Adds ascending ids, all above the list's, refilling its last block first */
+void JsonIndex::append(PostingList& list, const uint64_t* ids, size_t n) {
+    std::vector<uint64_t> tail;
+    if (list.blocks.empty()) {
+        if (list.count + n < kRawIds) {
+            list.data.resize((list.count + n) * sizeof(uint64_t));
+            if (n)
+                std::memcpy(list.data.data() + list.count * sizeof(uint64_t), ids,
+                            n * sizeof(uint64_t));
+            list.count += n;
+            return;
+        }
+        tail.resize(list.count);
+        if (list.count)
+            std::memcpy(tail.data(), list.data.data(), list.count * sizeof(uint64_t));
+        list.data.clear();
+        list.count = 0;
+    } else if (list.blocks.back().count < kJsonPostingBlock) {
+        Block last = list.blocks.back();
+        tail.resize(last.count);
+        codec_decode(list.data.data() + last.offset, list.data.size() - last.offset, tail.data(),
+                     last.count);
+        list.blocks.pop_back();
+        list.data.resize(last.offset);
+        list.count -= last.count;
+    }
+    if (!tail.empty()) {
+        tail.insert(tail.end(), ids, ids + n);
+        ids = tail.data();
+        n   = tail.size();
+    }
+
+    for (size_t i = 0; i < n; i += kJsonPostingBlock) {
+        uint32_t     count  = static_cast<uint32_t>(std::min<size_t>(kJsonPostingBlock, n - i));
+        size_t       offset = list.data.size();
+        codec_kind_t kind   = codec_choose(ids + i, count, false);
+        list.data.resize(offset + codec_bound(count));
+        size_t len = codec_encode(ids + i, count, false, kind, list.data.data() + offset);
+        list.data.resize(offset + len);
+        list.blocks.push_back({ids[i], ids[i + count - 1], static_cast<uint32_t>(offset), count});
+    }
+    list.count += n;
+}
+
+void JsonIndex::decode(const PostingList& list, std::vector<uint64_t>& ids) {
+    ids.resize(list.count);
+    if (list.blocks.empty()) {
+        if (list.count)
+            std::memcpy(ids.data(), list.data.data(), list.count * sizeof(uint64_t));
+        return;
+    }
+    size_t at = 0;
+    for (size_t b = 0; b < list.blocks.size(); b++) {
+        const Block& block = list.blocks[b];
+        size_t end = b + 1 < list.blocks.size() ? list.blocks[b + 1].offset : list.data.size();
+        codec_decode(list.data.data() + block.offset, end - block.offset, ids.data() + at,
+                     block.count);
+        at += block.count;
+    }
+}
+
+/* ---- Pending list ---- */
+
+/* Sorts a key's changes by id, keeping the latest for each */
+void JsonIndex::normalize(Pending& pending) {
+    if (pending.sorted)
+        return;
+    std::vector<Op>& ops = pending.ops;
+    std::stable_sort(ops.begin(), ops.end(), [](const Op& a, const Op& b) { return a.id < b.id; });
+    size_t kept = 0;
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (i + 1 < ops.size() && ops[i + 1].id == ops[i].id)
+            continue;
+        ops[kept++] = ops[i];
+    }
+    ops.resize(kept);
+    pending.sorted = true;
+}
+
+/* Ascending ids with a normalized key's changes applied */
+void JsonIndex::merge(const std::vector<uint64_t>& ids, const Pending& pending,
+                      std::vector<uint64_t>& out) {
+    const std::vector<Op>& ops = pending.ops;
+    out.clear();
+    out.reserve(ids.size() + ops.size());
+    size_t i = 0, j = 0;
+    while (i < ids.size() || j < ops.size()) {
+        if (j == ops.size() || (i < ids.size() && ids[i] < ops[j].id)) {
+            out.push_back(ids[i++]);
+            continue;
+        }
+        if (i < ids.size() && ids[i] == ops[j].id)
+            i++;
+        if (ops[j].add)
+            out.push_back(ops[j].id);
+        j++;
+    }
+}
+
+void JsonIndex::change(uint64_t id, JsonValue doc, bool add) {
+    if (!doc)
+        return;
+    std::vector<std::string> keys;
+    std::string              path;
+    bool                     exact;
+    collectKeys(doc, path, keys, &exact);
+    keys.emplace_back();
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    for (std::string& key : keys) {
+        auto [it, created] = pending_.try_emplace(std::move(key));
+        Pending& pending   = it->second;
+        if (created)
+            pending_bytes_ += it->first.size() + kPendingKeyOverhead;
+        if (!pending.ops.empty() && pending.ops.back().id >= id)
+            pending.sorted = false;
+        pending.ops.push_back({id, add});
+    }
+    pending_ids_ += keys.size();
+    pending_bytes_ += keys.size() * kPendingIdBytes;
+    if (pending_bytes_ > pending_limit_)
+        flush();
+}
+
+void JsonIndex::insert(uint64_t id, JsonValue doc) { change(id, doc, true); }
+
+void JsonIndex::remove(uint64_t id, JsonValue doc) { change(id, doc, false); }
+
+void JsonIndex::flush() {
+    std::vector<uint64_t> ids, merged;
+    for (auto& [key, pending] : pending_) {
+        normalize(pending);
+        auto         found = lists_.find(key);
+        PostingList* list  = found == lists_.end() ? nullptr : &found->second;
+
+        /* Only ids above the list's: leave its full blocks as they are */
+        const std::vector<Op>& ops  = pending.ops;
+        uint64_t               last = 0;
+        if (list && list->blocks.empty())
+            std::memcpy(&last, list->data.data() + list->data.size() - sizeof(last), sizeof(last));
+        else if (list)
+            last = list->blocks.back().last;
+        if (std::all_of(ops.begin(), ops.end(), [](const Op& op) { return op.add; }) &&
+            (!list || ops.front().id > last)) {
+            if (!list)
+                list = &lists_[key];
+            merged.clear();
+            for (const Op& op : ops)
+                merged.push_back(op.id);
+            append(*list, merged.data(), merged.size());
+            continue;
+        }
+
+        ids.clear();
+        if (list)
+            decode(*list, ids);
+        merge(ids, pending, merged);
+        if (merged.empty()) {
+            if (list)
+                lists_.erase(found);
+            continue;
+        }
+        if (!list)
+            list = &lists_[key];
+        *list = PostingList();
+        append(*list, merged.data(), merged.size());
+        list->data.shrink_to_fit();
+    }
+    pending_.clear();
+    pending_ids_   = 0;
+    pending_bytes_ = 0;
+    merges_++;
+}
+
+/* ---- Lookups ---- */
+
+/*
+ * Keys of the scalars below a value, after `path`; clears *exact when
+ * containment of the value is more than the presence of its keys
+ */
+void JsonIndex::collectKeys(JsonValue value, std::string& path, std::vector<std::string>& keys,
+                            bool* exact) {
+    size_t mark = path.size();
+    switch (value.kind()) {
+        case JsonKind::Object:
+            if (!value.size())
+                *exact = false;
+            for (uint32_t i = 0; i < value.size(); i++) {
+                append_member(path, value.keyAt(i));
+                collectKeys(value.valueAt(i), path, keys, exact);
+                path.resize(mark);
+            }
+            break;
+        case JsonKind::Array:
+            if (!value.size())
+                *exact = false;
+            path += kKeyArray;
+            for (uint32_t i = 0; i < value.size(); i++) {
+                JsonValue element = value.at(i);
+                if (element.isArray() || element.isObject())
+                    *exact = false;
+                collectKeys(element, path, keys, exact);
+            }
+            path.resize(mark);
+            break;
+        default: {
+            std::span<const uint8_t> bytes = value.binary();
+            std::string&             key   = keys.emplace_back();
+            key.reserve(path.size() + 1 + bytes.size());
+            key = path;
+            key += kKeyValue;
+            key.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+            break;
+        }
+    }
+}
+
+/* Drops the ids a key does not have */
+void JsonIndex::filter(const Term& term, std::vector<uint64_t>& ids) {
+    Cursor    cursor(term.list);
+    const Op* op   = term.pending ? term.pending->ops.data() : nullptr;
+    const Op* end  = term.pending ? op + term.pending->ops.size() : nullptr;
+    size_t    kept = 0;
+    for (uint64_t id : ids) {
+        while (op != end && op->id < id)
+            op++;
+        bool present = op != end && op->id == id ? op->add : cursor.has(id);
+        if (present)
+            ids[kept++] = id;
+    }
+    ids.resize(kept);
+}
+
+/* Ids having every key, intersected from the rarest key up */
+void JsonIndex::lookup(std::vector<std::string>& keys, std::vector<uint64_t>& ids) const {
+    ids.clear();
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<Term> terms;
+    terms.reserve(keys.size());
+    for (const std::string& key : keys) {
+        Term term    = {nullptr, nullptr, 0};
+        auto list    = lists_.find(key);
+        auto pending = pending_.find(key);
+        if (list != lists_.end()) {
+            term.list = &list->second;
+            term.estimate += list->second.count;
+        }
+        if (pending != pending_.end()) {
+            normalize(pending->second);
+            term.pending = &pending->second;
+            term.estimate += pending->second.ops.size();
+        }
+        if (!term.estimate)
+            return;
+        terms.push_back(term);
+    }
+    std::sort(terms.begin(), terms.end(),
+              [](const Term& a, const Term& b) { return a.estimate < b.estimate; });
+
+    const Term& first = terms[0];
+    if (first.list)
+        decode(*first.list, ids);
+    if (first.pending) {
+        std::vector<uint64_t> merged;
+        merge(ids, *first.pending, merged);
+        ids.swap(merged);
+    }
+    for (size_t t = 1; t < terms.size() && !ids.empty(); t++)
+        filter(terms[t], ids);
+}
+
+bool JsonIndex::findContaining(JsonValue query, std::vector<uint64_t>& ids) const {
+    ids.clear();
+    if (!query)
+        return true;
+    std::vector<std::string> keys;
+    std::string              path;
+    bool                     exact = true;
+    collectKeys(query, path, keys, &exact);
+    if (keys.empty()) {
+        /* Nothing to look up: every document is a candidate */
+        keys.emplace_back();
+        exact = false;
+    }
+    lookup(keys, ids);
+    return exact;
+}
+
+bool JsonIndex::findEqual(const JsonPath& path, JsonValue value, std::vector<uint64_t>& ids) const {
+    ids.clear();
+    if (!value)
+        return true;
+    std::string prefix;
+    bool        exact = true;
+    for (const JsonPath::Step& step : path.steps_) {
+        if (step.is_index) {
+            prefix += kKeyArray;
+            exact = false;
+        } else {
+            append_member(prefix, step.key);
+        }
+    }
+
+    /* A container is looked up by the keys it contains, then compared */
+    std::vector<std::string> keys;
+    collectKeys(value, prefix, keys, &exact);
+    if (value.isArray() || value.isObject())
+        exact = false;
+    if (keys.empty())
+        keys.emplace_back();
+    lookup(keys, ids);
+    return exact;
+}
+
+JsonIndexStats JsonIndex::stats() const {
+    JsonIndexStats result = {};
+    result.keys           = lists_.size();
+    for (const auto& [key, list] : lists_) {
+        result.postings += list.count;
+        result.posting_bytes += list.data.size() + list.blocks.size() * sizeof(Block);
+    }
+    result.pending_ids   = pending_ids_;
+    result.pending_bytes = pending_bytes_;
+    result.merges        = merges_;
+    return result;
+}
+
+}  // namespace monodb
@@ -0,0 +1,1056 @@
+/**
+ * @file JsonType.cpp
+ * @brief JSON parsing into the binary format, validation and printing
+ */
+
+#include <monodb/cpp/types/JsonType.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace monodb {
+
+namespace {
+
+using json_detail::kEntry;
+using json_detail::kHeader;
+using json_detail::load32;
+
+void store32(uint8_t* p, uint32_t v) { std::memcpy(p, &v, sizeof(v)); }
+
+/* Bytes of the value at p */
+uint32_t value_size(const uint8_t* p) {
+    switch (static_cast<JsonKind>(p[0])) {
+        case JsonKind::Int:
+        case JsonKind::Double:
+            return 9;
+        case JsonKind::String:
+            return 5 + load32(p + 1);
+        case JsonKind::Array:
+        case JsonKind::Object:
+            return load32(p + 5);
+        default:
+            return 1;
+    }
+}
+
+bool is_space(uint8_t c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+/* Whether a number or literal may end before c */
+bool is_delimiter(uint8_t c) {
+    return is_space(c) || c == ',' || c == ']' || c == '}' || c == ':';
+}
+
+/* UTF-8 check: shortest forms, no surrogates, nothing above U+10FFFF */
+bool valid_utf8(const uint8_t* p, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        if (len - i >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p + i, 8);
+            if (!(word & 0x8080808080808080ULL)) {
+                i += 8;
+                continue;
+            }
+        }
+        uint8_t c = p[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+        uint32_t need, cp;
+        if (c >= 0xC2 && c <= 0xDF) {
+            need = 1;
+            cp   = c & 0x1F;
+        } else if ((c & 0xF0) == 0xE0) {
+            need = 2;
+            cp   = c & 0x0F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            need = 3;
+            cp   = c & 0x07;
+        } else {
+            return false;
+        }
+        if (len - i <= need)
+            return false;
+        for (uint32_t k = 1; k <= need; k++) {
+            if ((p[i + k] & 0xC0) != 0x80)
+                return false;
+            cp = cp << 6 | (p[i + k] & 0x3F);
+        }
+        if (need == 2 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF)))
+            return false;
+        if (need == 3 && (cp < 0x10000 || cp > 0x10FFFF))
+            return false;
+        i += need + 1;
+    }
+    return true;
+}
+
+/* ---- Stage one: structural positions ---- */
+
+/* Character classes of a 64-byte block, one bit per byte */
+struct BlockMasks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;    /* { } [ ] : , */
+    uint64_t space; /* Space, tab, line feed, carriage return */
+};
+
+/* [ and { differ only in bit 5, as do ] and }, so one compare of c | 0x20 finds both */
+BlockMasks classify(const uint8_t* block) {
+    BlockMasks m = {};
+#if defined(__AVX2__)
+    for (int half = 0; half < 2; half++) {
+        __m256i v     = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * half));
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        auto    bits  = [half](__m256i eq) {
+            return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(eq)))
+                   << (32 * half);
+        };
+        auto eq = [v](char c) { return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)); };
+        m.quote |= bits(eq('"'));
+        m.backslash |= bits(eq('\\'));
+        m.op |= bits(_mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')),
+                            _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(eq(':'), eq(','))));
+        m.space |= bits(_mm256_or_si256(_mm256_or_si256(eq(' '), eq('\t')),
+                                        _mm256_or_si256(eq('\n'), eq('\r'))));
+    }
+#elif defined(__SSE2__)
+    for (int quarter = 0; quarter < 4; quarter++) {
+        __m128i v     = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * quarter));
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        auto    bits  = [quarter](__m128i eq) {
+            return static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(eq)))
+                   << (16 * quarter);
+        };
+        auto eq = [v](char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); };
+        m.quote |= bits(eq('"'));
+        m.backslash |= bits(eq('\\'));
+        m.op |= bits(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')),
+                                               _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+                                  _mm_or_si128(eq(':'), eq(','))));
+        m.space |= bits(
+            _mm_or_si128(_mm_or_si128(eq(' '), eq('\t')), _mm_or_si128(eq('\n'), eq('\r'))));
+    }
+#else
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = 1ULL << i;
+        uint8_t  c   = block[i];
+        if (c == '"')
+            m.quote |= bit;
+        else if (c == '\\')
+            m.backslash |= bit;
+        else if ((c | 0x20) == '{' || (c | 0x20) == '}' || c == ':' || c == ',')
+            m.op |= bit;
+        else if (is_space(c))
+            m.space |= bit;
+    }
+#endif
+    return m;
+}
+
+/*
+ * Characters escaped by a backslash, without a loop over runs of
+ * backslashes (simdjson): a character is escaped when it follows an odd
+ * run. Adding the odd-position run starts to the runs carries each into
+ * the position after its run; comparing with the run's parity then tells
+ * odd runs from even ones. `carry` is whether the block's first character
+ * is escaped by the previous block.
+ */
+uint64_t escaped_chars(uint64_t backslash, uint64_t& carry) {
+    constexpr uint64_t even = 0x5555555555555555ULL;
+    backslash &= ~carry;
+    uint64_t follows    = backslash << 1 | carry;
+    uint64_t odd_starts = backslash & ~even & ~follows;
+    uint64_t even_runs  = odd_starts + backslash;
+    carry               = even_runs < backslash ? 1 : 0;
+    return (even ^ (even_runs << 1)) & follows;
+}
+
+/* Bit i set when an odd number of bits at or below i are */
+uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/*
+ * Positions of structural characters, opening quotes and the first
+ * character of numbers and literals, in order; fails on an unterminated
+ * string. `out` holds at least len entries.
+ */
+bool find_structurals(const uint8_t* text, size_t len, uint32_t* out, size_t* count) {
+    uint64_t escape_carry = 0, in_string_carry = 0, scalar_carry = 0;
+    size_t   n = 0;
+    uint8_t  tail[64];
+    for (size_t base = 0; base < len; base += 64) {
+        const uint8_t* block = text + base;
+        if (len - base < 64) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, len - base);
+            block = tail;
+        }
+        BlockMasks m         = classify(block);
+        uint64_t   quote     = m.quote & ~escaped_chars(m.backslash, escape_carry);
+        uint64_t   in_string = prefix_xor(quote) ^ in_string_carry;
+        in_string_carry      = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+        /* Scalar bytes: outside strings, not quotes, operators or spaces */
+        uint64_t scalar      = ~(m.op | m.space | m.quote | in_string);
+        uint64_t scalar_head = scalar & ~(scalar << 1 | scalar_carry);
+        scalar_carry         = scalar >> 63;
+
+        uint64_t bits = (m.op & ~in_string) | (quote & in_string) | scalar_head;
+        while (bits) {
+            out[n++] = static_cast<uint32_t>(base + std::countr_zero(bits));
+            bits &= bits - 1;
+        }
+    }
+    *count = n;
+    return !in_string_carry;
+}
+
+/* ---- Stage two: grammar and document ---- */
+
+/* A parsed value, in pre-order */
+struct Node {
+    JsonKind    kind;
+    uint32_t    count;   /* Containers: elements or kept members */
+    uint32_t    size;    /* Bytes of the binary form */
+    uint32_t    next;    /* Node after this one's subtree */
+    uint32_t    order;   /* Objects: first of the members in key order in Parser::order_ */
+    uint32_t    key_len; /* Object members: unescaped key */
+    const char* key;
+    union {
+        int64_t     i;
+        double      d;
+        const char* s; /* Unescaped string of size - 5 bytes */
+    };
+};
+
+bool key_less(const Node& a, const Node& b) {
+    if (a.key_len != b.key_len)
+        return a.key_len < b.key_len;
+    return a.key_len && std::memcmp(a.key, b.key, a.key_len) < 0;
+}
+
+bool key_equal(const Node& a, const Node& b) {
+    return a.key_len == b.key_len && (!a.key_len || !std::memcmp(a.key, b.key, a.key_len));
+}
+
+class Parser {
+   public:
+    explicit Parser(std::string_view text)
+        : text_(reinterpret_cast<const uint8_t*>(text.data())), len_(text.size()) {}
+
+    bool   run(std::vector<uint8_t>& out);
+    size_t error() const { return error_; }
+
+   private:
+    const uint8_t*              text_;
+    size_t                      len_;
+    std::unique_ptr<uint32_t[]> index_;     /* Structural positions */
+    size_t                      count_ = 0; /* Their number */
+    size_t                      pos_   = 0; /* Next one to read */
+    std::vector<Node>           nodes_;
+    std::vector<uint32_t>       order_;   /* Object members in key order, per object */
+    std::unique_ptr<uint8_t[]>  strings_; /* Unescaped strings, allocated on the first escape */
+    size_t                      used_  = 0;
+    size_t                      error_ = 0;
+
+    bool   fail(size_t offset) {
+        error_ = offset;
+        return false;
+    }
+    int    peek() const { return pos_ < count_ ? text_[index_[pos_]] : -1; }
+    size_t where() const { return pos_ < count_ ? index_[pos_] : len_; }
+
+    bool value(uint32_t depth, const char* key, uint32_t key_len);
+    bool object(uint32_t self, size_t at, uint32_t depth);
+    bool array(uint32_t self, size_t at, uint32_t depth);
+    bool string(size_t at, const char** out, uint32_t* out_len);
+    bool number(size_t at, Node& node);
+    bool literal(size_t at, Node& node);
+    void write(uint32_t self, uint8_t* out) const;
+};
+
+bool Parser::run(std::vector<uint8_t>& out) {
+    if (len_ >= std::numeric_limits<uint32_t>::max())
+        return fail(0);
+    index_.reset(new uint32_t[len_ + 1]);
+    if (!find_structurals(text_, len_, index_.get(), &count_))
+        return fail(len_);
+    nodes_.reserve(count_ / 2 + 1);
+    order_.reserve(count_ / 2 + 1);
+    if (!value(0, nullptr, 0))
+        return false;
+    if (pos_ != count_)
+        return fail(where());
+    out.resize(nodes_[0].size);
+    write(0, out.data());
+    return true;
+}
+
+bool Parser::value(uint32_t depth, const char* key, uint32_t key_len) {
+    if (pos_ >= count_)
+        return fail(len_);
+    size_t   at   = index_[pos_++];
+    uint32_t self = static_cast<uint32_t>(nodes_.size());
+    Node&    node = nodes_.emplace_back();
+    node.key      = key;
+    node.key_len  = key_len;
+    node.next     = self + 1;
+    node.size     = 1;
+    switch (text_[at]) {
+        case '{':
+            return object(self, at, depth);
+        case '[':
+            return array(self, at, depth);
+        case '"': {
+            uint32_t len;
+            node.kind = JsonKind::String;
+            if (!string(at, &node.s, &len))
+                return false;
+            node.size = 5 + len;
+            return true;
+        }
+        case 't':
+        case 'f':
+        case 'n':
+            return literal(at, node);
+        default:
+            return number(at, node);
+    }
+}
+
+bool Parser::object(uint32_t self, size_t at, uint32_t depth) {
+    nodes_[self].kind = JsonKind::Object;
+    if (depth >= kJsonMaxDepth)
+        return fail(at);
+    if (peek() == '}') {
+        pos_++;
+    } else {
+        for (;;) {
+            if (peek() != '"')
+                return fail(where());
+            const char* key;
+            uint32_t    key_len;
+            if (!string(index_[pos_++], &key, &key_len))
+                return false;
+            if (peek() != ':')
+                return fail(where());
+            pos_++;
+            if (!value(depth + 1, key, key_len))
+                return false;
+            int c = peek();
+            if (c == '}') {
+                pos_++;
+                break;
+            }
+            if (c != ',')
+                return fail(where());
+            pos_++;
+        }
+    }
+
+    /* Members in key order, keeping the last of duplicate keys */
+    size_t first = order_.size();
+    for (uint32_t c = self + 1; c < nodes_.size(); c = nodes_[c].next)
+        order_.push_back(c);
+    std::sort(order_.begin() + first, order_.end(), [this](uint32_t a, uint32_t b) {
+        const Node& x = nodes_[a];
+        const Node& y = nodes_[b];
+        return key_less(x, y) || (!key_less(y, x) && a < b);
+    });
+    size_t   kept = first;
+    uint64_t size = kHeader;
+    for (size_t i = first; i < order_.size(); i++) {
+        if (i + 1 < order_.size() && key_equal(nodes_[order_[i]], nodes_[order_[i + 1]]))
+            continue;
+        const Node& member = nodes_[order_[i]];
+        size += kEntry + member.key_len + member.size;
+        order_[kept++] = order_[i];
+    }
+    order_.resize(kept);
+    if (size > std::numeric_limits<uint32_t>::max())
+        return fail(at);
+
+    Node& node = nodes_[self];
+    node.count = static_cast<uint32_t>(kept - first);
+    node.order = static_cast<uint32_t>(first);
+    node.size  = static_cast<uint32_t>(size);
+    node.next  = static_cast<uint32_t>(nodes_.size());
+    return true;
+}
+
+bool Parser::array(uint32_t self, size_t at, uint32_t depth) {
+    nodes_[self].kind = JsonKind::Array;
+    if (depth >= kJsonMaxDepth)
+        return fail(at);
+    uint32_t count = 0;
+    uint64_t size  = kHeader;
+    if (peek() == ']') {
+        pos_++;
+    } else {
+        for (;;) {
+            uint32_t child = static_cast<uint32_t>(nodes_.size());
+            if (!value(depth + 1, nullptr, 0))
+                return false;
+            count++;
+            size += 4 + nodes_[child].size;
+            int c = peek();
+            if (c == ']') {
+                pos_++;
+                break;
+            }
+            if (c != ',')
+                return fail(where());
+            pos_++;
+        }
+    }
+    if (size > std::numeric_limits<uint32_t>::max())
+        return fail(at);
+    Node& node = nodes_[self];
+    node.count = count;
+    node.size  = static_cast<uint32_t>(size);
+    node.next  = static_cast<uint32_t>(nodes_.size());
+    return true;
+}
+
+/* Digit value of a hex character, or -1 */
+int hex_digit(uint8_t c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+/* Code unit of \uXXXX at p, or -1 */
+int32_t hex4(const uint8_t* p, const uint8_t* end) {
+    if (end - p < 4)
+        return -1;
+    int32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        int d = hex_digit(p[i]);
+        if (d < 0)
+            return -1;
+        v = v << 4 | d;
+    }
+    return v;
+}
+
+/* Length of the run of bytes at p that need no unescaping: not quotes, backslashes or controls */
+size_t plain_run(const uint8_t* p, const uint8_t* end) {
+    const uint8_t* start = p;
+#if defined(__SSE2__)
+    while (end - p >= 16) {
+        __m128i v     = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i ctrl  = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1F)), v);
+        __m128i stop  = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                                     ctrl);
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(stop));
+        if (mask)
+            return static_cast<size_t>(p - start) + std::countr_zero(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\' && *p >= 0x20)
+        p++;
+    return static_cast<size_t>(p - start);
+}
+
+/* Unescapes the string opening at `at`; plain strings are pointed to in place */
+bool Parser::string(size_t at, const char** out, uint32_t* out_len) {
+    const uint8_t* start = text_ + at + 1;
+    const uint8_t* end   = text_ + len_;
+    const uint8_t* p     = start + plain_run(start, end);
+    if (p < end && *p == '"') {
+        if (!valid_utf8(start, static_cast<size_t>(p - start)))
+            return fail(at);
+        *out     = reinterpret_cast<const char*>(start);
+        *out_len = static_cast<uint32_t>(p - start);
+        return true;
+    }
+
+    /* Unescaped strings are never longer than their text, so the buffer never grows */
+    if (!strings_)
+        strings_.reset(new uint8_t[len_]);
+    uint8_t* base = strings_.get() + used_;
+    uint8_t* dst  = base;
+    std::memcpy(dst, start, static_cast<size_t>(p - start));
+    dst += p - start;
+    for (;;) {
+        if (p >= end || *p < 0x20)
+            return fail(static_cast<size_t>(p - text_));
+        if (*p == '"')
+            break;
+        if (*p != '\\') {
+            size_t run = plain_run(p, end);
+            std::memcpy(dst, p, run);
+            dst += run;
+            p += run;
+            continue;
+        }
+        if (end - p < 2)
+            return fail(static_cast<size_t>(p - text_));
+        uint8_t c = p[1];
+        p += 2;
+        switch (c) {
+            case '"':
+            case '\\':
+            case '/':
+                *dst++ = c;
+                break;
+            case 'b':
+                *dst++ = '\b';
+                break;
+            case 'f':
+                *dst++ = '\f';
+                break;
+            case 'n':
+                *dst++ = '\n';
+                break;
+            case 'r':
+                *dst++ = '\r';
+                break;
+            case 't':
+                *dst++ = '\t';
+                break;
+            case 'u': {
+                int32_t cp = hex4(p, end);
+                if (cp < 0 || (cp >= 0xDC00 && cp <= 0xDFFF))
+                    return fail(static_cast<size_t>(p - text_));
+                p += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    bool    pair = end - p >= 2 && p[0] == '\\' && p[1] == 'u';
+                    int32_t low  = pair ? hex4(p + 2, end) : -1;
+                    if (low < 0xDC00 || low > 0xDFFF)
+                        return fail(static_cast<size_t>(p - text_));
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                if (cp < 0x80) {
+                    *dst++ = static_cast<uint8_t>(cp);
+                } else if (cp < 0x800) {
+                    *dst++ = static_cast<uint8_t>(0xC0 | cp >> 6);
+                    *dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+                } else if (cp < 0x10000) {
+                    *dst++ = static_cast<uint8_t>(0xE0 | cp >> 12);
+                    *dst++ = static_cast<uint8_t>(0x80 | (cp >> 6 & 0x3F));
+                    *dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+                } else {
+                    *dst++ = static_cast<uint8_t>(0xF0 | cp >> 18);
+                    *dst++ = static_cast<uint8_t>(0x80 | (cp >> 12 & 0x3F));
+                    *dst++ = static_cast<uint8_t>(0x80 | (cp >> 6 & 0x3F));
+                    *dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+                }
+                break;
+            }
+            default:
+                return fail(static_cast<size_t>(p - 1 - text_));
+        }
+    }
+    size_t len = static_cast<size_t>(dst - base);
+    if (!valid_utf8(base, len))
+        return fail(at);
+    used_ += len;
+    *out     = reinterpret_cast<const char*>(base);
+    *out_len = static_cast<uint32_t>(len);
+    return true;
+}
+
+/* An integer when the number has no fraction or exponent and fits 64 bits, else a double */
+bool Parser::number(size_t at, Node& node) {
+    const uint8_t* start = text_ + at;
+    const uint8_t* end   = text_ + len_;
+    const uint8_t* p     = start;
+    bool           neg   = *p == '-';
+    auto           digit = [&](const uint8_t* q) { return q < end && *q >= '0' && *q <= '9'; };
+    if (neg)
+        p++;
+    if (!digit(p))
+        return fail(static_cast<size_t>(p - text_));
+    const uint8_t* digits = p;
+    if (*p == '0')
+        p++;
+    else
+        while (digit(p))
+            p++;
+    const uint8_t* digits_end = p;
+    bool           integral   = true;
+    if (p < end && *p == '.') {
+        integral = false;
+        if (!digit(++p))
+            return fail(static_cast<size_t>(p - text_));
+        while (digit(p))
+            p++;
+    }
+    bool negative_exp = false;
+    if (p < end && (*p | 0x20) == 'e') {
+        integral = false;
+        p++;
+        if (p < end && (*p == '+' || *p == '-'))
+            negative_exp = *p++ == '-';
+        if (!digit(p))
+            return fail(static_cast<size_t>(p - text_));
+        while (digit(p))
+            p++;
+    }
+    if (p < end && !is_delimiter(*p))
+        return fail(static_cast<size_t>(p - text_));
+
+    node.size = 9;
+    if (integral && digits_end - digits <= 19) {
+        uint64_t v = 0;
+        for (const uint8_t* q = digits; q < digits_end; q++)
+            v = v * 10 + (*q - '0');
+        uint64_t limit = static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + neg;
+        if (v <= limit) {
+            node.kind = JsonKind::Int;
+            node.i    = neg ? static_cast<int64_t>(0 - v) : static_cast<int64_t>(v);
+            return true;
+        }
+    }
+    node.kind = JsonKind::Double;
+    auto result = std::from_chars(reinterpret_cast<const char*>(start),
+                                  reinterpret_cast<const char*>(p), node.d);
+    if (result.ec == std::errc::result_out_of_range && negative_exp)
+        node.d = neg ? -0.0 : 0.0;
+    else if (result.ec != std::errc())
+        return fail(at);
+    return true;
+}
+
+bool Parser::literal(size_t at, Node& node) {
+    static const struct {
+        const char* text;
+        size_t      len;
+        JsonKind    kind;
+    } literals[] = {
+        {"true", 4, JsonKind::True},
+        {"false", 5, JsonKind::False},
+        {"null", 4, JsonKind::Null},
+    };
+    for (const auto& lit : literals) {
+        if (len_ - at >= lit.len && !std::memcmp(text_ + at, lit.text, lit.len) &&
+            (len_ - at == lit.len || is_delimiter(text_[at + lit.len]))) {
+            node.kind = lit.kind;
+            return true;
+        }
+    }
+    return fail(at);
+}
+
+void Parser::write(uint32_t self, uint8_t* out) const {
+    const Node& node = nodes_[self];
+    out[0]           = static_cast<uint8_t>(node.kind);
+    switch (node.kind) {
+        case JsonKind::Int:
+            std::memcpy(out + 1, &node.i, 8);
+            break;
+        case JsonKind::Double:
+            std::memcpy(out + 1, &node.d, 8);
+            break;
+        case JsonKind::String:
+            store32(out + 1, node.size - 5);
+            std::memcpy(out + 5, node.s, node.size - 5);
+            break;
+        case JsonKind::Array: {
+            store32(out + 1, node.count);
+            store32(out + 5, node.size);
+            uint32_t offset = kHeader + 4 * node.count;
+            uint32_t child  = self + 1;
+            for (uint32_t i = 0; i < node.count; i++) {
+                store32(out + kHeader + 4 * i, offset);
+                write(child, out + offset);
+                offset += nodes_[child].size;
+                child = nodes_[child].next;
+            }
+            break;
+        }
+        case JsonKind::Object: {
+            store32(out + 1, node.count);
+            store32(out + 5, node.size);
+            const uint32_t* members    = order_.data() + node.order;
+            uint32_t        key_offset = kHeader + kEntry * node.count;
+            uint32_t        offset     = key_offset;
+            for (uint32_t i = 0; i < node.count; i++)
+                offset += nodes_[members[i]].key_len;
+            for (uint32_t i = 0; i < node.count; i++) {
+                const Node& member = nodes_[members[i]];
+                uint8_t*    entry  = out + kHeader + kEntry * i;
+                store32(entry, key_offset);
+                store32(entry + 4, member.key_len);
+                store32(entry + 8, offset);
+                std::memcpy(out + key_offset, member.key, member.key_len);
+                write(members[i], out + offset);
+                key_offset += member.key_len;
+                offset += member.size;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/* ---- Binary checks and printing ---- */
+
+/* Whether `avail` bytes at p start a well-formed value */
+bool validate(const uint8_t* p, size_t avail, uint32_t depth) {
+    if (!avail)
+        return false;
+    switch (static_cast<JsonKind>(p[0])) {
+        case JsonKind::Null:
+        case JsonKind::False:
+        case JsonKind::True:
+            return true;
+        case JsonKind::Int:
+            return avail >= 9;
+        case JsonKind::Double: {
+            double d;
+            if (avail < 9)
+                return false;
+            std::memcpy(&d, p + 1, 8);
+            return std::isfinite(d);
+        }
+        case JsonKind::String:
+            return avail >= 5 && load32(p + 1) <= avail - 5 && valid_utf8(p + 5, load32(p + 1));
+        case JsonKind::Array:
+        case JsonKind::Object:
+            break;
+        default:
+            return false;
+    }
+    if (avail < kHeader || depth >= kJsonMaxDepth)
+        return false;
+    bool     is_object = p[0] == static_cast<uint8_t>(JsonKind::Object);
+    uint32_t count     = load32(p + 1);
+    uint32_t size      = load32(p + 5);
+    uint32_t width     = is_object ? kEntry : 4;
+    if (size > avail || size < kHeader || count > (size - kHeader) / width)
+        return false;
+    uint32_t table_end = kHeader + width * count;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* entry  = p + kHeader + width * i;
+        uint32_t       offset = load32(entry + (is_object ? 8 : 0));
+        if (is_object) {
+            uint32_t key_offset = load32(entry);
+            uint32_t key_len    = load32(entry + 4);
+            if (key_offset < table_end || key_offset > size || key_len > size - key_offset ||
+                !valid_utf8(p + key_offset, key_len))
+                return false;
+            if (i) {
+                uint32_t prev_len = load32(entry - kEntry + 4);
+                int      cmp      = prev_len < key_len ? -1 : prev_len > key_len ? 1 : 0;
+                if (!cmp && key_len)
+                    cmp = std::memcmp(p + load32(entry - kEntry), p + key_offset, key_len);
+                if (cmp >= 0)
+                    return false;
+            }
+        }
+        if (offset < table_end || offset >= size || !validate(p + offset, size - offset, depth + 1))
+            return false;
+    }
+    return true;
+}
+
+void append_string(std::string& out, std::string_view s) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    size_t i = 0;
+    while (i < s.size()) {
+        size_t run = plain_run(reinterpret_cast<const uint8_t*>(s.data()) + i,
+                               reinterpret_cast<const uint8_t*>(s.data()) + s.size());
+        out.append(s.data() + i, run);
+        i += run;
+        if (i == s.size())
+            break;
+        uint8_t c = static_cast<uint8_t>(s[i++]);
+        out += '\\';
+        switch (c) {
+            case '"':
+            case '\\':
+                out += static_cast<char>(c);
+                break;
+            case '\b':
+                out += 'b';
+                break;
+            case '\f':
+                out += 'f';
+                break;
+            case '\n':
+                out += 'n';
+                break;
+            case '\r':
+                out += 'r';
+                break;
+            case '\t':
+                out += 't';
+                break;
+            default:
+                out += "u00";
+                out += hex[c >> 4];
+                out += hex[c & 15];
+                break;
+        }
+    }
+    out += '"';
+}
+
+void append_value(std::string& out, JsonValue value) {
+    char buf[32];
+    switch (value.kind()) {
+        case JsonKind::Null:
+            out += "null";
+            break;
+        case JsonKind::False:
+            out += "false";
+            break;
+        case JsonKind::True:
+            out += "true";
+            break;
+        case JsonKind::Int: {
+            auto result = std::to_chars(buf, buf + sizeof(buf), value.asInt());
+            out.append(buf, result.ptr);
+            break;
+        }
+        case JsonKind::Double: {
+            /* Shortest text that reads back the same; ".0" keeps integral doubles doubles */
+            auto             result = std::to_chars(buf, buf + sizeof(buf), value.asDouble());
+            std::string_view text(buf, static_cast<size_t>(result.ptr - buf));
+            out += text;
+            if (text.find_first_of(".e") == std::string_view::npos)
+                out += ".0";
+            break;
+        }
+        case JsonKind::String:
+            append_string(out, value.asString());
+            break;
+        case JsonKind::Array:
+            out += '[';
+            for (uint32_t i = 0; i < value.size(); i++) {
+                if (i)
+                    out += ',';
+                append_value(out, value.at(i));
+            }
+            out += ']';
+            break;
+        case JsonKind::Object:
+            out += '{';
+            for (uint32_t i = 0; i < value.size(); i++) {
+                if (i)
+                    out += ',';
+                append_string(out, value.keyAt(i));
+                out += ':';
+                append_value(out, value.valueAt(i));
+            }
+            out += '}';
+            break;
+    }
+}
+
+}  // namespace
+
+/* ---- JsonValue ---- */
+
+int64_t JsonValue::asInt() const {
+    if (!valid())
+        return 0;
+    if (kind() == JsonKind::Int) {
+        int64_t v;
+        std::memcpy(&v, data_ + 1, 8);
+        return v;
+    }
+    if (kind() != JsonKind::Double)
+        return 0;
+    double d = asDouble();
+    if (d >= 9223372036854775807.0)
+        return std::numeric_limits<int64_t>::max();
+    if (d <= -9223372036854775808.0)
+        return std::numeric_limits<int64_t>::min();
+    return static_cast<int64_t>(d);
+}
+
+double JsonValue::asDouble() const {
+    if (!valid())
+        return 0;
+    if (kind() == JsonKind::Int)
+        return static_cast<double>(asInt());
+    if (kind() != JsonKind::Double)
+        return 0;
+    double d;
+    std::memcpy(&d, data_ + 1, 8);
+    return d;
+}
+
+JsonValue JsonValue::find(const JsonPath& path) const {
+    JsonValue value = *this;
+    for (const JsonPath::Step& step : path.steps_) {
+        value = step.is_index ? value.at(step.index) : value.find(step.key);
+        if (!value)
+            break;
+    }
+    return value;
+}
+
+std::string_view JsonValue::keyAt(uint32_t index) const {
+    if (!isObject() || index >= size())
+        return {};
+    const uint8_t* entry = data_ + kHeader + kEntry * index;
+    return {reinterpret_cast<const char*>(data_ + load32(entry)), load32(entry + 4)};
+}
+
+JsonValue JsonValue::valueAt(uint32_t index) const {
+    if (!isObject())
+        return at(index);
+    if (index >= size())
+        return {};
+    return JsonValue(data_ + load32(data_ + kHeader + kEntry * index + 8));
+}
+
+std::span<const uint8_t> JsonValue::binary() const {
+    if (!valid())
+        return {};
+    return {data_, value_size(data_)};
+}
+
+std::string JsonValue::toString() const {
+    std::string out;
+    if (valid())
+        append_value(out, *this);
+    return out;
+}
+
+bool JsonValue::operator==(const JsonValue& other) const {
+    std::span<const uint8_t> a = binary(), b = other.binary();
+    return valid() == other.valid() && std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+bool JsonValue::contains(const JsonValue& other) const {
+    if (!valid() || !other.valid() || kind() != other.kind())
+        return false;
+    switch (kind()) {
+        case JsonKind::Object:
+            for (uint32_t i = 0; i < other.size(); i++) {
+                JsonValue mine = find(other.keyAt(i));
+                if (!mine || !mine.contains(other.valueAt(i)))
+                    return false;
+            }
+            return true;
+        case JsonKind::Array:
+            for (uint32_t i = 0; i < other.size(); i++) {
+                JsonValue wanted = other.at(i);
+                uint32_t  j      = 0;
+                while (j < size() && !at(j).contains(wanted))
+                    j++;
+                if (j == size())
+                    return false;
+            }
+            return true;
+        default:
+            return *this == other;
+    }
+}
+
+/* ---- JsonPath ---- */
+
+std::optional<JsonPath> JsonPath::parse(std::string_view text) {
+    JsonPath path;
+    size_t   pos = 0;
+    if (pos < text.size() && text[pos] == '$')
+        pos++;
+    bool first = true;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (c == '[') {
+            pos++;
+            if (pos < text.size() && text[pos] == '"') {
+                std::string key;
+                for (pos++; pos < text.size() && text[pos] != '"'; pos++) {
+                    if (text[pos] == '\\' && pos + 1 < text.size())
+                        pos++;
+                    key += text[pos];
+                }
+                if (pos >= text.size())
+                    return std::nullopt;
+                pos++;
+                path.key(key);
+            } else {
+                const char* end    = text.data() + text.size();
+                uint32_t    index  = 0;
+                auto        result = std::from_chars(text.data() + pos, end, index);
+                if (result.ec != std::errc())
+                    return std::nullopt;
+                pos = static_cast<size_t>(result.ptr - text.data());
+                path.index(index);
+            }
+            if (pos >= text.size() || text[pos] != ']')
+                return std::nullopt;
+            pos++;
+        } else if (c == '.' || first) {
+            if (c == '.')
+                pos++;
+            size_t end = text.find_first_of(".[]", pos);
+            if (end == std::string_view::npos)
+                end = text.size();
+            if (end == pos)
+                return std::nullopt;
+            path.key(text.substr(pos, end - pos));
+            pos = end;
+        } else {
+            return std::nullopt;
+        }
+        first = false;
+    }
+    return path;
+}
+
+JsonPath& JsonPath::key(std::string_view name) {
+    steps_.push_back({std::string(name), 0, false});
+    return *this;
+}
+
+JsonPath& JsonPath::index(uint32_t position) {
+    steps_.push_back({std::string(), position, true});
+    return *this;
+}
+
+/* ---- JsonType ---- */
+
+JsonType::JsonType() : bytes_(1, static_cast<uint8_t>(JsonKind::Null)) {}
+
+std::optional<JsonType> JsonType::parse(std::string_view text, size_t* error_offset) {
+    Parser               parser(text);
+    std::vector<uint8_t> bytes;
+    if (!parser.run(bytes)) {
+        if (error_offset)
+            *error_offset = parser.error();
+        return std::nullopt;
+    }
+    return JsonType(std::move(bytes));
+}
+
+std::optional<JsonType> JsonType::fromBinary(std::span<const uint8_t> bytes) {
+    if (!validate(bytes.data(), bytes.size(), 0) || value_size(bytes.data()) != bytes.size())
+        return std::nullopt;
+    return JsonType(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+}
+
+}  // namespace monodb
@@ -0,0 +1,304 @@
+/**
+ * @file test_analyze.c
+ * @brief Tests for ANALYZE: sketches, statistics of small and sampled tables, estimates and
+ *        auto-analyze
+ */
+
+#include <monodb/core/data/analyze.h>
+#include <monodb/core/storage/buffer.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+#define NUM_COLUMNS 4
+
+static const catalog_column_def_t columns[NUM_COLUMNS] = {
+    {"id", TYPE_INT64, false},
+    {"grp", TYPE_INT32, false},
+    {"score", TYPE_FLOAT64, false},
+    {"city", TYPE_TEXT, true},
+};
+
+static const char* const cities[] = {"Oslo", "Lima", "Accra"};
+
+/* Relative distance of an estimate from the truth */
+static double error_of(double estimate, double truth) {
+    double diff = estimate > truth ? estimate - truth : truth - estimate;
+    return diff / truth;
+}
+
+/*
+ * Row i: unique id; grp 0 for half the rows, 1 for a quarter, 2..9 for the
+ * rest; 1000 scores, 5 rows each per 5000; city NULL for a quarter
+ */
+static bool insert_rows(table_t* table, const record_schema_t* schema, uint32_t from,
+                        uint32_t to) {
+    record_value_t values[NUM_COLUMNS];
+    uint8_t        row[128];
+    for (uint32_t i = from; i < to; i++) {
+        uint32_t    bucket = i % 100;
+        const char* city   = cities[i % 3];
+        memset(values, 0, sizeof(values));
+        values[0].i       = i;
+        values[1].i       = bucket < 50 ? 0 : bucket < 75 ? 1 : 2 + bucket % 8;
+        values[2].f       = (double)(i * 7919u % 1000) / 10;
+        values[3].is_null = i % 4 == 0;
+        values[3].data    = city;
+        values[3].len     = (uint16_t)strlen(city);
+        uint16_t len      = record_schema_encode(schema, values, row, sizeof(row));
+        if (!len || !table_insert(table, row, len, 1, NULL))
+            return false;
+    }
+    return true;
+}
+
+/* Open an empty table and register it in the catalog */
+static table_t* open_table(buffer_pool_t* pool, const char* path, catalog_t* catalog,
+                           const char* name) {
+    remove(path);
+    table_t* table = table_open(pool, path);
+    if (table && !catalog_create_table(catalog, name, columns, NUM_COLUMNS, NULL)) {
+        table_close(table);
+        return NULL;
+    }
+    return table;
+}
+
+/* Statistics of a table, from a fresh snapshot */
+static const catalog_table_stats_t* stats_of(catalog_reader_t* reader, const char* name) {
+    const catalog_table_t* table = catalog_find_table(catalog_enter(reader), name);
+    return table ? table->stats : NULL;
+}
+
+/* Sketches count distinct values within a few percent and merge into a union */
+static bool test_hll(void) {
+    printf("  HyperLogLog sketches\n");
+
+    static uint8_t a[ANALYZE_HLL_SIZE], b[ANALYZE_HLL_SIZE], small[ANALYZE_HLL_SIZE];
+    for (uint64_t v = 0; v < 50000; v++)
+        analyze_hll_add(a, &v, sizeof(v));
+    for (uint64_t v = 25000; v < 75000; v++)
+        analyze_hll_add(b, &v, sizeof(v));
+    for (int pass = 0; pass < 10; pass++) {
+        for (uint64_t v = 0; v < 100; v++)
+            analyze_hll_add(small, &v, sizeof(v));
+    }
+
+    CHECK(error_of(analyze_hll_estimate(a), 50000) < 0.08, "large count");
+    CHECK(error_of(analyze_hll_estimate(small), 100) < 0.05, "small count, repeated values");
+    analyze_hll_merge(a, b);
+    CHECK(error_of(analyze_hll_estimate(a), 75000) < 0.08, "union");
+    return true;
+}
+
+/* A table smaller than the sample is read whole and described exactly */
+static bool test_whole_table(buffer_pool_t* pool, const record_schema_t* schema) {
+    printf("  ANALYZE of a whole table\n");
+
+    const char*       path    = "./test_analyze_whole.db";
+    catalog_t*        catalog = catalog_create();
+    catalog_reader_t* reader  = catalog_reader_open(catalog);
+    table_t*          table   = open_table(pool, path, catalog, "t");
+    CHECK(catalog && reader && table, "open");
+    CHECK(insert_rows(table, schema, 0, 5000), "insert rows");
+
+    CHECK(analyze_table(table, schema, catalog, "t", NULL), "analyze");
+    CHECK(!analyze_table(table, schema, catalog, "missing", NULL), "no such table");
+
+    const catalog_table_stats_t* stats = stats_of(reader, "t");
+    CHECK(stats && stats->rows == 5000 && stats->sampled_rows == 5000 &&
+              stats->sampled_pages == stats->pages && stats->num_columns == NUM_COLUMNS,
+          "table stats");
+
+    /* Unique column: no common values, a histogram from the smallest to the largest id */
+    const catalog_column_stats_t* id = &stats->columns[0];
+    int64_t                       first, last;
+    memcpy(&first, id->bounds[0].data, sizeof(first));
+    memcpy(&last, id->bounds[id->num_bounds - 1].data, sizeof(last));
+    CHECK(id->ndv == 5000 && id->num_mcvs == 0 && id->null_frac == 0 && id->avg_width == 8,
+          "id column");
+    CHECK(id->num_bounds == ANALYZE_DEFAULT_TARGET + 1 && first == 0 && last == 4999,
+          "id histogram");
+
+    /* Ten groups, all of them common values, most frequent first */
+    const catalog_column_stats_t* grp = &stats->columns[1];
+    int32_t                       top;
+    memcpy(&top, grp->mcvs[0].data, sizeof(top));
+    CHECK(grp->ndv == 10 && grp->num_mcvs == 10 && grp->num_bounds == 0, "grp column");
+    CHECK(top == 0 && grp->mcv_freqs[0] == 0.5 && grp->mcv_freqs[1] == 0.25, "grp frequencies");
+
+    /* Scores repeat evenly, so none stands out */
+    const catalog_column_stats_t* score = &stats->columns[2];
+    CHECK(score->ndv == 1000 && score->num_mcvs == 0 && score->num_bounds > 0, "score column");
+
+    const catalog_column_stats_t* city = &stats->columns[3];
+    CHECK(city->null_frac == 0.25 && city->ndv == 3 && city->num_mcvs == 3 &&
+              error_of(city->avg_width, 4 + 1.0 / 3) < 0.01,
+          "city column");
+    CHECK(city->hll_size == ANALYZE_HLL_SIZE && analyze_hll_estimate(city->hll) < 3.5,
+          "city sketch");
+
+    /* Estimates */
+    int32_t zero = 0, one = 1, seven = 7, absent = 99;
+    CHECK(analyze_estimate_eq(grp, TYPE_INT32, &zero, 4) == 0.5, "common value");
+    CHECK(analyze_estimate_eq(grp, TYPE_INT32, &one, 4) == 0.25, "second common value");
+    CHECK(error_of(analyze_estimate_eq(grp, TYPE_INT32, &seven, 4), 0.03) < 0.01, "rare group");
+    CHECK(analyze_estimate_eq(grp, TYPE_INT32, &absent, 4) < 0.001, "absent value");
+    CHECK(error_of(analyze_estimate_range(grp, TYPE_INT32, &one, 4, NULL, 0), 0.5) < 1e-9,
+          "grp >= 1");
+
+    int64_t lo = 1000, hi = 1999, key = 42;
+    CHECK(error_of(analyze_estimate_range(id, TYPE_INT64, &lo, 8, &hi, 8), 0.2) < 0.02,
+          "id range");
+    CHECK(error_of(analyze_estimate_range(id, TYPE_INT64, NULL, 0, &hi, 8), 0.4) < 0.02,
+          "id upper bound");
+    CHECK(error_of(analyze_estimate_eq(id, TYPE_INT64, &key, 8), 1.0 / 5000) < 0.01, "id key");
+
+    double below = 49.95;
+    CHECK(error_of(analyze_estimate_range(score, TYPE_FLOAT64, NULL, 0, &below, 8), 0.5) < 0.03,
+          "score range");
+    CHECK(error_of(analyze_estimate_eq(city, TYPE_TEXT, "Lima", 4), 0.25) < 0.01, "city value");
+    CHECK(error_of(analyze_estimate_range(city, TYPE_TEXT, "B", 1, "M", 1), 0.25) < 0.01,
+          "city range");
+    catalog_leave(reader);
+
+    table_close(table);
+    remove(path);
+    catalog_reader_close(reader);
+    catalog_destroy(catalog);
+    return true;
+}
+
+/* A larger table is sampled; row count, distinct values and estimates extrapolate */
+static bool test_sampled_table(buffer_pool_t* pool, const record_schema_t* schema) {
+    printf("  ANALYZE of a sampled table\n");
+
+    const char*       path    = "./test_analyze_sampled.db";
+    catalog_t*        catalog = catalog_create();
+    catalog_reader_t* reader  = catalog_reader_open(catalog);
+    table_t*          table   = open_table(pool, path, catalog, "t");
+    CHECK(catalog && reader && table, "open");
+    CHECK(insert_rows(table, schema, 0, 60000), "insert rows");
+
+    analyze_options_t options = {.sample_rows = 3000, .sample_pages = 60};
+    CHECK(analyze_table(table, schema, catalog, "t", &options), "analyze");
+
+    const catalog_table_stats_t* stats = stats_of(reader, "t");
+    CHECK(stats && stats->sampled_pages == 60 && stats->pages > 60 &&
+              stats->sampled_rows == 3000,
+          "sampled");
+    printf("    %u pages, %.0f rows estimated, id ndv %.0f, score ndv %.0f\n", stats->pages,
+           stats->rows, stats->columns[0].ndv, stats->columns[2].ndv);
+    CHECK(error_of(stats->rows, 60000) < 0.1, "row count");
+    CHECK(error_of(stats->columns[0].ndv, 60000) < 0.15, "unique column");
+    CHECK(error_of(stats->columns[1].ndv, 10) < 0.01, "few values");
+    CHECK(error_of(stats->columns[2].ndv, 1000) < 0.1, "repeated values");
+
+    const catalog_column_stats_t* grp = &stats->columns[1];
+    int32_t                       zero = 0;
+    int64_t                       lo = 15000, hi = 44999;
+    CHECK(error_of(analyze_estimate_eq(grp, TYPE_INT32, &zero, 4), 0.5) < 0.1, "common value");
+    CHECK(error_of(analyze_estimate_range(&stats->columns[0], TYPE_INT64, &lo, 8, &hi, 8), 0.5) <
+              0.1,
+          "id range");
+    CHECK(error_of(stats->columns[3].null_frac, 0.25) < 0.15, "NULL fraction");
+    catalog_leave(reader);
+
+    /* The same seed picks the same sample */
+    double rows = stats->rows;
+    CHECK(analyze_table(table, schema, catalog, "t", &options), "analyze again");
+    CHECK(stats_of(reader, "t")->rows == rows, "repeatable");
+    catalog_leave(reader);
+
+    table_close(table);
+    remove(path);
+    catalog_reader_close(reader);
+    catalog_destroy(catalog);
+    return true;
+}
+
+/* Tables are analyzed again once enough rows changed */
+static bool test_auto(buffer_pool_t* pool, const record_schema_t* schema) {
+    printf("  auto-analyze\n");
+
+    const char*       path    = "./test_analyze_auto.db";
+    catalog_t*        catalog = catalog_create();
+    catalog_reader_t* reader  = catalog_reader_open(catalog);
+    table_t*          table   = open_table(pool, path, catalog, "t");
+    CHECK(catalog && reader && table, "open");
+    CHECK(insert_rows(table, schema, 0, 1000), "insert rows");
+
+    /* Due after 50 + 10% of the rows changed */
+    analyze_policy_t policy = {0.1, 50};
+    bool             analyzed;
+    CHECK(analyze_auto(table, schema, catalog, "t", &policy, NULL, &analyzed) && analyzed,
+          "never analyzed");
+    CHECK(analyze_auto(table, schema, catalog, "t", &policy, NULL, &analyzed) && !analyzed,
+          "nothing changed");
+
+    CHECK(insert_rows(table, schema, 1000, 1100), "insert 100");
+    CHECK(analyze_auto(table, schema, catalog, "t", &policy, NULL, &analyzed) && !analyzed,
+          "below the threshold");
+    CHECK(stats_of(reader, "t")->rows == 1000, "old stats");
+    catalog_leave(reader);
+
+    CHECK(insert_rows(table, schema, 1100, 1200), "insert 100 more");
+    CHECK(analyze_auto(table, schema, catalog, "t", &policy, NULL, &analyzed) && analyzed,
+          "past the threshold");
+    CHECK(stats_of(reader, "t")->rows == 1200, "new stats");
+    catalog_leave(reader);
+    CHECK(!analyze_auto(table, schema, catalog, "missing", &policy, NULL, &analyzed) &&
+              !analyzed,
+          "no such table");
+
+    /* A row that is not of the schema fails ANALYZE and leaves the statistics */
+    uint8_t junk = 0xFF;
+    CHECK(table_insert(table, &junk, 1, 1, NULL), "insert junk");
+    CHECK(!analyze_table(table, schema, catalog, "t", NULL), "malformed row");
+    CHECK(stats_of(reader, "t")->rows == 1200, "stats kept");
+    catalog_leave(reader);
+
+    table_close(table);
+    remove(path);
+    catalog_reader_close(reader);
+    catalog_destroy(catalog);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB Analyze Test - Starting up...\n");
+
+    type_id_t types[NUM_COLUMNS];
+    for (int c = 0; c < NUM_COLUMNS; c++)
+        types[c] = columns[c].type;
+    buffer_pool_t*   pool   = buffer_pool_create(64);
+    record_schema_t* schema = record_schema_create(types, NULL, NUM_COLUMNS);
+    if (!pool || !schema) {
+        fprintf(stderr, "Failed to set up\n");
+        return 1;
+    }
+
+    bool ok = test_hll() && test_whole_table(pool, schema) && test_sampled_table(pool, schema) &&
+              test_auto(pool, schema);
+
+    record_schema_destroy(schema);
+    buffer_pool_destroy(pool);
+    if (!ok)
+        return 1;
+
+    printf("\nAnalyze test completed successfully\n");
+    return 0;
+}
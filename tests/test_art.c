@@ -0,0 +1,317 @@
+/**
+ * @file test_art.c
+ * @brief Tests for the adaptive radix tree
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/data/art.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+#define NUM_KEYS 50000
+
+/* Threads and keys per thread of the concurrency test */
+#define NUM_THREADS     4
+#define KEYS_PER_THREAD 20000
+
+/* 8-byte big-endian key, so keys sort numerically and none is a prefix of another */
+static void make_key(uint8_t* key, uint64_t i) {
+    for (int b = 0; b < 8; b++)
+        key[b] = (uint8_t)(i >> (56 - 8 * b));
+}
+
+/* Keys inserted in a scattered order are found with their values */
+static bool test_insert_get(art_t* tree) {
+    printf("  insert and lookup\n");
+
+    uint8_t key[8];
+    for (uint64_t i = 0; i < NUM_KEYS; i++) {
+        uint64_t k = (i * 7919) % NUM_KEYS;
+        make_key(key, k);
+        CHECK(art_insert(tree, key, 8, k * 3), "insert key");
+    }
+    make_key(key, 42);
+    CHECK(!art_insert(tree, key, 8, 0), "duplicate key is rejected");
+
+    for (uint64_t i = 0; i < NUM_KEYS; i++) {
+        uint64_t value = 0;
+        make_key(key, i);
+        CHECK(art_get(tree, key, 8, &value) && value == i * 3, "key is found with its value");
+    }
+    make_key(key, NUM_KEYS + 5);
+    CHECK(!art_get(tree, key, 8, NULL), "missing key is not found");
+    CHECK(!art_get(tree, key, 7, NULL), "inner path is not a key");
+
+    art_stats_t stats;
+    art_get_stats(tree, &stats);
+    CHECK(stats.leaves == NUM_KEYS, "one leaf per key");
+    CHECK(stats.nodes[3] > NUM_KEYS / 256 && stats.nodes[0] + stats.nodes[1] + stats.nodes[2] == 0,
+          "dense keys fill 256-child nodes");
+    return true;
+}
+
+/* Nodes grow through every size as children arrive and shrink back as they leave */
+static bool test_grow_shrink(void) {
+    printf("  node growth and shrinking\n");
+
+    art_t* tree = art_create();
+    CHECK(tree, "create tree");
+
+    /* One inner node under the root gains children 0..255 */
+    uint8_t     key[2] = {7, 0};
+    art_stats_t stats;
+    const int   sizes[] = {4, 16, 48, 256};
+    for (int s = 0, n = 0; s < 4; s++) {
+        for (; n < sizes[s]; n++) {
+            key[1] = (uint8_t)n;
+            CHECK(art_insert(tree, key, 2, (uint64_t)n), "insert key");
+        }
+        art_get_stats(tree, &stats);
+        CHECK(stats.nodes[s] == (s == 3 ? 2u : 1u), "node has grown to the next size");
+    }
+
+    for (int n = 255; n >= 2; n--) {
+        key[1] = (uint8_t)n;
+        CHECK(art_delete(tree, key, 2), "delete key");
+    }
+    art_get_stats(tree, &stats);
+    CHECK(stats.nodes[0] == 1 && stats.nodes[1] == 0 && stats.nodes[2] == 0 &&
+              stats.nodes[3] == 1,
+          "node has shrunk back to the smallest size");
+
+    /* A node left with one child gives way to it */
+    key[1] = 1;
+    CHECK(art_delete(tree, key, 2), "delete key");
+    art_get_stats(tree, &stats);
+    CHECK(stats.nodes[0] == 0 && stats.leaves == 1, "single-child node is removed");
+    key[1] = 0;
+    uint64_t value = 1;
+    CHECK(art_get(tree, key, 2, &value) && value == 0, "remaining key is found");
+    CHECK(!art_delete(tree, key, 1) && art_delete(tree, key, 2), "delete last key");
+    CHECK(!art_get(tree, key, 2, NULL), "tree is empty");
+
+    art_destroy(tree);
+    return true;
+}
+
+/* Keys sharing long runs of bytes are told apart past the bytes a node stores */
+static bool test_long_prefixes(void) {
+    printf("  long compressed paths\n");
+
+    art_t* tree = art_create();
+    CHECK(tree, "create tree");
+
+    char key[64];
+    for (uint32_t i = 0; i < 2000; i++) {
+        int len = snprintf(key, sizeof(key), "tenant/0000000042/orders/%08u;", i * 37);
+        CHECK(art_insert(tree, key, (uint16_t)len, i), "insert key");
+    }
+    /* Split the long shared path in the middle and past the stored bytes */
+    CHECK(art_insert(tree, "tenant/0000000042/invoices;", 27, 9000), "insert key");
+    CHECK(art_insert(tree, "tenant/0000000043;", 18, 9001), "insert key");
+    CHECK(!art_insert(tree, "tenant/0000000042/orders/", 25, 0),
+          "key that is a prefix of stored keys is rejected");
+    CHECK(!art_insert(tree, "tenant/0000000042/orders/00000037;x", 35, 0),
+          "key with a stored key as prefix is rejected");
+
+    for (uint32_t i = 0; i < 2000; i++) {
+        uint64_t value = 0;
+        int      len   = snprintf(key, sizeof(key), "tenant/0000000042/orders/%08u;", i * 37);
+        CHECK(art_get(tree, key, (uint16_t)len, &value) && value == i, "key is found");
+        key[len - 2]++;
+        CHECK(!art_get(tree, key, (uint16_t)len, NULL), "neighbouring key is not found");
+    }
+    CHECK(!art_get(tree, "tenant/0000000042/orderz/00000037;", 34, NULL),
+          "difference in an unstored path byte is caught at the leaf");
+
+    /* Deleting the split keys merges the paths again */
+    CHECK(art_delete(tree, "tenant/0000000043;", 18), "delete key");
+    CHECK(art_delete(tree, "tenant/0000000042/invoices;", 27), "delete key");
+    for (uint32_t i = 0; i < 2000; i += 3) {
+        int len = snprintf(key, sizeof(key), "tenant/0000000042/orders/%08u;", i * 37);
+        CHECK(art_get(tree, key, (uint16_t)len, NULL), "key survives merged paths");
+    }
+
+    art_destroy(tree);
+    return true;
+}
+
+static bool count_entry(const void* key, uint16_t key_len, uint64_t value, void* arg) {
+    uint64_t* state = (uint64_t*)arg;
+    (void)key;
+    (void)key_len;
+
+    /* state: count, previous value + 1 (0 before the first), whether the order held */
+    if (state[1] != 0 && value + 1 <= state[1])
+        state[2] = 0;
+    state[0]++;
+    state[1] = value + 1;
+    return true;
+}
+
+/* Prefix scans visit exactly the keys with the prefix, in key order */
+static bool test_scan_prefix(art_t* tree) {
+    printf("  prefix scans\n");
+
+    uint64_t state[3] = {0, 0, 1};
+    CHECK(art_scan_prefix(tree, NULL, 0, count_entry, state), "scan everything");
+    CHECK(state[0] == NUM_KEYS && state[2] == 1, "every key is visited in order");
+
+    /* Keys 0x1000..0x10ff share their first seven bytes */
+    uint8_t key[8];
+    make_key(key, 0x1000);
+    state[0] = state[1] = 0;
+    state[2]            = 1;
+    CHECK(art_scan_prefix(tree, key, 7, count_entry, state), "scan a prefix");
+    CHECK(state[0] == 256 && state[2] == 1 && state[1] == 0x10ff * 3 + 1,
+          "prefix scan visits its keys in order");
+
+    make_key(key, (uint64_t)1 << 40);
+    state[0] = 0;
+    CHECK(art_scan_prefix(tree, key, 3, count_entry, state) && state[0] == 0,
+          "scan of an absent prefix visits nothing");
+    return true;
+}
+
+static bool collect_tid(tuple_id_t tid, void* arg) {
+    uint32_t* counts = (uint32_t*)arg;
+    counts[0]++;
+    counts[1] += tid.slot;
+    return true;
+}
+
+/* As a secondary index a key holds many tuple IDs and never matches a longer key */
+static bool test_index_ops(void) {
+    printf("  secondary index access method\n");
+
+    art_t*             tree = art_create();
+    const index_ops_t* ops  = &art_index_ops;
+    CHECK(tree, "create tree");
+
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < 3000; i++) {
+        CHECK(ops->insert(tree, "status:open", 11, (tuple_id_t){i / 100, i}), "insert entry");
+        CHECK(ops->insert(tree, "status:opened", 13, (tuple_id_t){1, i}), "insert entry");
+        sum += i;
+    }
+    CHECK(ops->insert(tree, "", 0, (tuple_id_t){3, 3}), "empty key is indexed");
+    CHECK(!ops->insert(tree, "status:open", 11, (tuple_id_t){0, 5}),
+          "same key and tuple ID is rejected");
+    CHECK(ops->remove(tree, "status:open", 11, (tuple_id_t){0, 5}), "remove entry");
+    CHECK(!ops->remove(tree, "status:open", 11, (tuple_id_t){9, 6}), "wrong tuple ID is kept");
+
+    uint32_t counts[2] = {0, 0};
+    CHECK(ops->lookup(tree, "status:open", 11, collect_tid, counts), "lookup");
+    CHECK(counts[0] == 2999 && counts[1] == sum - 5, "lookup visits exactly the key's entries");
+    counts[0] = counts[1] = 0;
+    CHECK(ops->lookup(tree, "", 0, collect_tid, counts) && counts[0] == 1 && counts[1] == 3,
+          "empty key is found");
+    counts[0] = 0;
+    CHECK(ops->lookup(tree, "status:", 7, collect_tid, counts) && counts[0] == 0,
+          "shorter key matches nothing");
+
+    ops->close(tree);
+    return true;
+}
+
+/**
+ * Worker of the concurrency test
+ */
+typedef struct {
+    art_t*   tree;
+    uint32_t id;
+    bool     ok;
+} worker_t;
+
+static void* worker_main(void* arg) {
+    worker_t* worker = (worker_t*)arg;
+    uint8_t   key[8];
+
+    worker->ok = true;
+    for (uint32_t i = 0; i < KEYS_PER_THREAD && worker->ok; i++) {
+        /* Interleaved keys make the threads share nodes */
+        uint64_t id = (uint64_t)i * NUM_THREADS + worker->id;
+        make_key(key, id * 0x9E3779B1u);
+        worker->ok = art_insert(worker->tree, key, 8, id);
+
+        /* Read back an earlier key and delete every third one */
+        if (worker->ok && i >= 10) {
+            uint64_t back  = (uint64_t)(i - 10) * NUM_THREADS + worker->id;
+            uint64_t value = 0;
+            make_key(key, back * 0x9E3779B1u);
+            worker->ok = art_get(worker->tree, key, 8, &value) && value == back;
+            if (worker->ok && (i - 10) % 3 == 0)
+                worker->ok = art_delete(worker->tree, key, 8);
+        }
+    }
+    return NULL;
+}
+
+/* Threads inserting, reading and deleting through node changes leave exactly the expected keys */
+static bool test_concurrent(void) {
+    printf("  concurrent readers and writers\n");
+
+    art_t* tree = art_create();
+    CHECK(tree, "create tree");
+
+    sync_thread_t threads[NUM_THREADS];
+    worker_t      workers[NUM_THREADS];
+    for (uint32_t t = 0; t < NUM_THREADS; t++) {
+        workers[t] = (worker_t){tree, t, false};
+        CHECK(sync_thread_create(&threads[t], worker_main, &workers[t]), "start thread");
+    }
+    for (uint32_t t = 0; t < NUM_THREADS; t++)
+        sync_thread_join(threads[t]);
+    for (uint32_t t = 0; t < NUM_THREADS; t++)
+        CHECK(workers[t].ok, "every thread saw consistent results");
+
+    uint8_t key[8];
+    for (uint32_t t = 0; t < NUM_THREADS; t++) {
+        for (uint32_t i = 0; i < KEYS_PER_THREAD; i++) {
+            bool deleted = i + 10 < KEYS_PER_THREAD && i % 3 == 0;
+            make_key(key, ((uint64_t)i * NUM_THREADS + t) * 0x9E3779B1u);
+            CHECK(art_get(tree, key, 8, NULL) != deleted, "key present unless deleted");
+        }
+    }
+
+    art_stats_t stats;
+    art_get_stats(tree, &stats);
+    CHECK(stats.freed > 0, "removed leaves are reclaimed while the tree is in use");
+
+    art_destroy(tree);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB ART Test - Starting up...\n");
+
+    art_t* tree = art_create();
+    if (!tree) {
+        fprintf(stderr, "Failed to create a tree\n");
+        return 1;
+    }
+
+    bool ok = test_insert_get(tree) && test_scan_prefix(tree) && test_grow_shrink() &&
+              test_long_prefixes() && test_index_ops() && test_concurrent();
+    art_destroy(tree);
+
+    if (!ok)
+        return 1;
+
+    printf("\nART test completed successfully\n");
+    return 0;
+}
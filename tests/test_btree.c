@@ -0,0 +1,765 @@
+/**
+ * @file test_btree.c
+ * @brief Tests for the page-based B+tree
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/data/btree.h>
+#include <monodb/core/data/key.h>
+#include <monodb/core/storage/buffer.h>
+#include <monodb/core/storage/wal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Platform-specific includes */
+#ifdef _WIN32
+#include <direct.h>
+#define rmdir_compat _rmdir
+#else
+#include <unistd.h>
+#define rmdir_compat rmdir
+#endif
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+#define NUM_KEYS 20000
+
+/* WAL of the redo tests, and the single segment they write */
+#define WAL_DIR     "./test_btree_wal"
+#define WAL_SEGMENT WAL_DIR "/000000000000000000000001"
+
+/* Threads and keys per thread of the concurrency test */
+#define NUM_THREADS     4
+#define KEYS_PER_THREAD 6000
+
+/* Big-endian key so memcmp order matches numeric order */
+static void encode_key(uint8_t* key, uint32_t value) {
+    key[0] = (uint8_t)(value >> 24);
+    key[1] = (uint8_t)(value >> 16);
+    key[2] = (uint8_t)(value >> 8);
+    key[3] = (uint8_t)value;
+}
+
+static uint32_t decode_key(const uint8_t* key) {
+    return ((uint32_t)key[0] << 24) | ((uint32_t)key[1] << 16) | ((uint32_t)key[2] << 8) | key[3];
+}
+
+/* Keys inserted in scrambled order come back sorted and all reachable */
+static bool test_insert_get(btree_t* tree) {
+    printf("  insert and lookup\n");
+
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        uint32_t value = (i * 7919u) % NUM_KEYS;
+        uint8_t  key[4];
+        char     row[40];
+        encode_key(key, value);
+        int len = snprintf(row, sizeof(row), "row-%u", value);
+        CHECK(btree_insert(tree, key, 4, row, (uint16_t)len), "insert key");
+    }
+
+    uint8_t key[4];
+    encode_key(key, 42);
+    CHECK(!btree_insert(tree, key, 4, "dup", 3), "duplicate key is rejected");
+    CHECK(btree_height(tree) >= 2, "tree has grown");
+
+    for (uint32_t i = 0; i < NUM_KEYS; i += 13) {
+        char     row[40];
+        uint16_t len;
+        encode_key(key, i);
+        CHECK(btree_get(tree, key, 4, row, sizeof(row), &len), "lookup key");
+        row[len] = '\0';
+        char expected[40];
+        snprintf(expected, sizeof(expected), "row-%u", i);
+        CHECK(strcmp(row, expected) == 0, "lookup returns the stored value");
+    }
+
+    encode_key(key, NUM_KEYS + 5);
+    CHECK(!btree_get(tree, key, 4, NULL, 0, NULL), "missing key is not found");
+    return true;
+}
+
+/* Range scans return keys in order within their bounds */
+static bool test_range_scan(btree_t* tree) {
+    printf("  range scan\n");
+
+    uint8_t lo[4], hi[4];
+    encode_key(lo, 1000);
+    encode_key(hi, 3000);
+
+    btree_scan_t* scan = btree_scan_begin(tree, lo, 4, hi, 4);
+    CHECK(scan != NULL, "begin scan");
+
+    const void* key;
+    const void* value;
+    uint16_t    key_len, value_len;
+    uint32_t    expected = 1000;
+    while (btree_scan_next(scan, &key, &key_len, &value, &value_len)) {
+        CHECK(key_len == 4 && decode_key(key) == expected, "scan returns keys in order");
+        expected++;
+    }
+    CHECK(expected == 3000, "scan covers the whole range");
+    CHECK(btree_scan_leaves_read(scan) < 2000 / 50, "scan reads only the leaves of the range");
+    btree_scan_end(scan);
+
+    scan = btree_scan_begin(tree, NULL, 0, NULL, 0);
+    uint32_t count = 0;
+    while (btree_scan_next(scan, &key, &key_len, &value, &value_len))
+        count++;
+    btree_scan_end(scan);
+    CHECK(count == NUM_KEYS, "unbounded scan returns every key");
+    return true;
+}
+
+/* Composite keys of order-preserving encodings sort by their components */
+static bool test_normalized_keys(buffer_pool_t* pool) {
+    printf("  normalized keys\n");
+
+    const char* path = "./test_btree_keys.db";
+    remove(path);
+    btree_t* tree = btree_open(pool, path);
+    CHECK(tree, "open tree");
+
+    /* Names in index order: a prefix first, an embedded zero byte below any other byte */
+    static const char*    names[]    = {"", "a", "a\0", "a\0b", "ab", "b"};
+    static const uint16_t name_len[] = {0, 1, 2, 3, 2, 1};
+    const uint32_t        num_names  = 6, num_keys = 7 * num_names;
+
+    uint8_t  keys[7 * 6][32];
+    uint16_t lens[7 * 6];
+    for (uint32_t i = 0; i < num_keys; i++) {
+        uint32_t j = (i * 11) % num_keys; /* Insert out of order */
+        uint16_t n = key_put_i64(keys[j], (int64_t)(j / num_names) - 3);
+        lens[j]    = (uint16_t)(n + key_put_string(keys[j] + n, names[j % num_names],
+                                                   name_len[j % num_names]));
+        CHECK(btree_insert(tree, keys[j], lens[j], &j, sizeof(j)), "insert composite key");
+    }
+
+    btree_scan_t* scan = btree_scan_begin(tree, NULL, 0, NULL, 0);
+    const void*   key;
+    const void*   value;
+    uint16_t      key_len, value_len;
+    uint32_t      expected = 0;
+    while (btree_scan_next(scan, &key, &key_len, &value, &value_len)) {
+        uint32_t rank;
+        memcpy(&rank, value, sizeof(rank));
+        CHECK(rank == expected, "keys sort by region, then name");
+
+        uint8_t  name[32];
+        uint16_t len = 0;
+        CHECK(key_get_i64((const uint8_t*)key) == (int64_t)(rank / num_names) - 3,
+              "region decodes");
+        CHECK(key_get_string((const uint8_t*)key + 8, (uint16_t)(key_len - 8), name, &len) ==
+                      key_len - 8 &&
+                  len == name_len[rank % num_names] &&
+                  memcmp(name, names[rank % num_names], len) == 0,
+              "name decodes");
+        expected++;
+    }
+    btree_scan_end(scan);
+    CHECK(expected == num_keys, "scan returns every key");
+
+    /* The specialized compares order keys exactly as key_compare does */
+    for (uint32_t i = 0; i < num_keys; i++) {
+        for (uint32_t j = 0; j < num_keys; j++) {
+            int general = key_compare(keys[i], lens[i], keys[j], lens[j]);
+            int bytes   = key_compare_as(KEY_KIND_BYTES, keys[i], lens[i], keys[j], lens[j]);
+            int fixed   = key_compare_as(KEY_KIND_FIXED8, keys[i], 8, keys[j], 8);
+            CHECK((general < 0) == (bytes < 0) && (general > 0) == (bytes > 0),
+                  "byte string compare matches");
+            CHECK((fixed < 0) == (i / num_names < j / num_names) &&
+                      (fixed > 0) == (i / num_names > j / num_names),
+                  "fixed-width compare matches");
+        }
+    }
+    uint8_t lo[8], hi[8];
+    key_put_i64(lo, INT64_MIN);
+    key_put_i64(hi, -1);
+    CHECK(key_compare_as(KEY_KIND_FIXED8, lo, 8, hi, 8) < 0 && key_get_i64(lo) == INT64_MIN,
+          "signed extremes order and decode");
+    key_put_i32(lo, -1);
+    key_put_i32(hi, 0);
+    CHECK(key_compare_as(KEY_KIND_FIXED4, lo, 4, hi, 4) < 0 && key_get_i32(lo) == -1,
+          "negative 32-bit keys sort first");
+
+    btree_close(tree);
+    remove(path);
+    return true;
+}
+
+/* Deletes and growing updates keep the tree consistent */
+static bool test_delete_update(btree_t* tree) {
+    printf("  delete and update\n");
+
+    uint8_t key[4];
+    for (uint32_t i = 0; i < NUM_KEYS; i += 2) {
+        encode_key(key, i);
+        CHECK(btree_delete(tree, key, 4), "delete key");
+    }
+    encode_key(key, 0);
+    CHECK(!btree_delete(tree, key, 4), "double delete fails");
+
+    /* Larger values force splits of half-empty leaves */
+    char big[200];
+    memset(big, 'b', sizeof(big));
+    for (uint32_t i = 1; i < NUM_KEYS; i += 2) {
+        encode_key(key, i);
+        CHECK(btree_update(tree, key, 4, big, sizeof(big)), "update key");
+    }
+    encode_key(key, 2);
+    CHECK(!btree_update(tree, key, 4, big, sizeof(big)), "update of deleted key fails");
+
+    btree_scan_t* scan = btree_scan_begin(tree, NULL, 0, NULL, 0);
+    const void*   k;
+    const void*   value;
+    uint16_t      key_len, value_len;
+    uint32_t      count = 0;
+    while (btree_scan_next(scan, &k, &key_len, &value, &value_len)) {
+        CHECK(decode_key(k) % 2 == 1 && value_len == sizeof(big), "only updated keys remain");
+        count++;
+    }
+    btree_scan_end(scan);
+    CHECK(count == NUM_KEYS / 2, "scan after delete and update");
+    return true;
+}
+
+static bool collect_tid(tuple_id_t tid, void* arg) {
+    tuple_id_t* out = (tuple_id_t*)arg;
+    out[out[0].slot + 1] = tid;
+    out[0].slot++;
+    return true;
+}
+
+/* As a secondary index the tree holds duplicate keys, told apart by tuple ID */
+static bool test_index_ops(buffer_pool_t* pool) {
+    printf("  secondary index access method\n");
+
+    const char* path = "./test_btree_index.db";
+    remove(path);
+
+    btree_t* tree  = btree_open(pool, path);
+    index_t* index = tree ? index_create("dup", &btree_index_ops, tree, NULL, NULL) : NULL;
+    CHECK(tree && !index, "index requires a key extractor");
+
+    const index_ops_t* ops = &btree_index_ops;
+    for (uint16_t i = 0; i < 300; i++) {
+        const char* key = (i % 3 == 0) ? "apple" : (i % 3 == 1) ? "apples" : "app";
+        CHECK(ops->insert(tree, key, (uint16_t)strlen(key), (tuple_id_t){i / 10, i}),
+              "insert entry");
+    }
+    CHECK(ops->remove(tree, "apple", 5, (tuple_id_t){0, 3}), "remove entry");
+
+    tuple_id_t found[128];
+    memset(found, 0, sizeof(found));
+    CHECK(ops->lookup(tree, "apple", 5, collect_tid, found), "lookup");
+    CHECK(found[0].slot == 99, "lookup finds every duplicate but not longer keys");
+    for (uint16_t i = 1; i <= found[0].slot; i++)
+        CHECK(found[i].slot % 3 == 0 && found[i].slot != 3, "lookup returns the right tuples");
+
+    ops->close(tree);
+    remove(path);
+    return true;
+}
+
+/* Deleting most keys merges nodes and shrinks the tree; deleting all leaves a lone root */
+static bool test_merge(buffer_pool_t* pool) {
+    printf("  merges\n");
+
+    const char* path = "./test_btree_merge.db";
+    remove(path);
+    btree_t* tree = btree_open(pool, path);
+    CHECK(tree, "open tree");
+
+    uint8_t key[4];
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        encode_key(key, i);
+        CHECK(btree_insert(tree, key, 4, "value", 5), "insert key");
+    }
+    uint32_t height = btree_height(tree);
+    CHECK(height >= 2, "tree has grown");
+
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        encode_key(key, i);
+        CHECK(i % 100 == 0 || btree_delete(tree, key, 4), "delete key");
+    }
+
+    btree_stats_t stats;
+    btree_get_stats(tree, &stats);
+    CHECK(stats.merges > 0, "underfull nodes were merged");
+
+    btree_scan_t* scan = btree_scan_begin(tree, NULL, 0, NULL, 0);
+    const void*   k;
+    const void*   value;
+    uint16_t      key_len, value_len;
+    uint32_t      count = 0;
+    while (btree_scan_next(scan, &k, &key_len, &value, &value_len)) {
+        CHECK(decode_key(k) == count * 100, "scan returns the remaining keys in order");
+        count++;
+    }
+    CHECK(btree_scan_leaves_read(scan) < 5, "remaining keys share few leaves");
+    btree_scan_end(scan);
+    CHECK(count == NUM_KEYS / 100, "scan after merges");
+
+    for (uint32_t i = 0; i < NUM_KEYS; i += 100) {
+        encode_key(key, i);
+        CHECK(btree_get(tree, key, 4, NULL, 0, NULL), "lookup after merges");
+        CHECK(btree_delete(tree, key, 4), "delete remaining key");
+    }
+    CHECK(btree_height(tree) == 1, "empty tree collapses to its root");
+
+    encode_key(key, 7);
+    CHECK(btree_insert(tree, key, 4, "again", 5) && btree_get(tree, key, 4, NULL, 0, NULL),
+          "tree is usable after collapsing");
+
+    btree_close(tree);
+    remove(path);
+    return true;
+}
+
+/* Hierarchical keys sharing long prefixes, as tenant/region/user */
+static uint16_t prefix_key(char* key, uint32_t i) {
+    static const char* regions[] = {"eu-west-1", "eu-central-1", "us-east-1", "ap-south-1"};
+    return (uint16_t)snprintf(key, 64, "tenant-%04u/region-%s/user-%08u", i % 10,
+                              regions[(i / 10) % 4], i / 40);
+}
+
+/*
+ * Keys with long common prefixes are stored compactly and come back whole,
+ * including after keys outside every node prefix arrive and after deletes
+ */
+static bool test_prefix_keys(buffer_pool_t* pool) {
+    printf("  compressed keys\n");
+
+    const char* path = "./test_btree_prefix.db";
+    remove(path);
+    btree_t* tree = btree_open(pool, path);
+    CHECK(tree, "open tree");
+
+    char     key[64];
+    uint64_t raw = 0;
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        uint32_t n   = (i * 7919u) % NUM_KEYS;
+        uint16_t len = prefix_key(key, n);
+        CHECK(btree_insert(tree, key, len, &n, sizeof(n)), "insert key");
+        raw += len + sizeof(n);
+    }
+
+    /* Keys sorting before and after all others shorten the prefixes of the edge nodes */
+    CHECK(btree_insert(tree, "a", 1, "first", 5), "insert key before all others");
+    CHECK(btree_insert(tree, "tenant-", 7, "short", 5), "insert prefix of other keys");
+    CHECK(btree_insert(tree, "zz", 2, "end", 3), "insert key after all others");
+
+    for (uint32_t i = 0; i < NUM_KEYS; i += 7) {
+        uint32_t value = 0;
+        CHECK(btree_get(tree, key, prefix_key(key, i), &value, sizeof(value), NULL) && value == i,
+              "lookup returns the stored value");
+    }
+    CHECK(btree_get(tree, "tenant-", 7, NULL, 0, NULL), "lookup of the short key");
+    CHECK(!btree_get(tree, "tenant-0001/region-eu", 21, NULL, 0, NULL), "prefix is not a key");
+
+    btree_scan_t* scan = btree_scan_begin(tree, NULL, 0, NULL, 0);
+    const void*   k;
+    const void*   value;
+    uint16_t      key_len, value_len;
+    uint32_t      count = 0;
+    char          last[64];
+    uint16_t      last_len = 0;
+    while (btree_scan_next(scan, &k, &key_len, &value, &value_len)) {
+        CHECK(count == 0 || memcmp(last, k, last_len < key_len ? last_len : key_len) < 0 ||
+                  (memcmp(last, k, last_len < key_len ? last_len : key_len) == 0 &&
+                   last_len < key_len),
+              "scan returns keys in order");
+        if (value_len == sizeof(uint32_t)) {
+            uint32_t n;
+            memcpy(&n, value, sizeof(n));
+            CHECK(key_len == prefix_key(key, n) && memcmp(k, key, key_len) == 0,
+                  "scan returns whole keys");
+        }
+        memcpy(last, k, key_len);
+        last_len = key_len;
+        count++;
+    }
+    CHECK(count == NUM_KEYS + 3, "scan returns every key");
+    CHECK((uint64_t)btree_scan_leaves_read(scan) * PAGE_SIZE < raw,
+          "leaves hold less than the raw keys and values");
+    btree_scan_end(scan);
+
+    /* A range within one tenant */
+    scan  = btree_scan_begin(tree, "tenant-0003/", 12, "tenant-0004/", 12);
+    count = 0;
+    while (btree_scan_next(scan, &k, &key_len, &value, &value_len)) {
+        CHECK(key_len > 12 && memcmp(k, "tenant-0003/", 12) == 0, "range scan stays in range");
+        count++;
+    }
+    btree_scan_end(scan);
+    CHECK(count == NUM_KEYS / 10, "range scan returns the tenant");
+
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        if (i % 10 != 3)
+            CHECK(btree_delete(tree, key, prefix_key(key, i)), "delete key");
+    }
+    for (uint32_t i = 3; i < NUM_KEYS; i += 10) {
+        uint32_t v = 0;
+        CHECK(btree_get(tree, key, prefix_key(key, i), &v, sizeof(v), NULL) && v == i,
+              "lookup after deletes");
+    }
+
+    btree_close(tree);
+    remove(path);
+    return true;
+}
+
+/**
+ * Worker of the concurrency test
+ */
+typedef struct {
+    btree_t* tree;
+    uint32_t id;
+    bool     ok;
+} worker_t;
+
+/* Interleaved keys put every thread on the same leaves */
+static uint32_t worker_key(const worker_t* worker, uint32_t i) {
+    return i * NUM_THREADS + worker->id;
+}
+
+static void* worker_main(void* arg) {
+    worker_t* worker = (worker_t*)arg;
+    uint8_t   key[4];
+    uint32_t  value;
+
+    worker->ok = true;
+    for (uint32_t i = 0; i < KEYS_PER_THREAD && worker->ok; i++) {
+        encode_key(key, worker_key(worker, i));
+        value      = worker_key(worker, i);
+        worker->ok = btree_insert(worker->tree, key, 4, &value, sizeof(value));
+
+        /* Read back an earlier key and delete every third one */
+        if (worker->ok && i >= 10) {
+            uint32_t back = worker_key(worker, i - 10);
+            uint32_t got  = 0;
+            encode_key(key, back);
+            worker->ok = btree_get(worker->tree, key, 4, &got, sizeof(got), NULL) && got == back;
+            if (worker->ok && (i - 10) % 3 == 0)
+                worker->ok = btree_delete(worker->tree, key, 4);
+        }
+    }
+    return NULL;
+}
+
+/* Scans running alongside the writers always see keys in order */
+static void* scanner_main(void* arg) {
+    worker_t* worker = (worker_t*)arg;
+
+    worker->ok = true;
+    for (uint32_t round = 0; round < 20 && worker->ok; round++) {
+        btree_scan_t* scan = btree_scan_begin(worker->tree, NULL, 0, NULL, 0);
+        const void*   k;
+        const void*   value;
+        uint16_t      key_len, value_len;
+        bool          first = true;
+        uint32_t      last  = 0;
+        while (worker->ok && btree_scan_next(scan, &k, &key_len, &value, &value_len)) {
+            uint32_t current = decode_key(k);
+            worker->ok       = first || current > last;
+            first            = false;
+            last             = current;
+        }
+        btree_scan_end(scan);
+    }
+    return NULL;
+}
+
+/* Threads inserting, reading and deleting at once leave exactly the expected keys */
+static bool test_concurrent(buffer_pool_t* pool) {
+    printf("  concurrent readers and writers\n");
+
+    const char* path = "./test_btree_concurrent.db";
+    remove(path);
+    btree_t* tree = btree_open(pool, path);
+    CHECK(tree, "open tree");
+
+    sync_thread_t threads[NUM_THREADS + 1];
+    worker_t      workers[NUM_THREADS + 1];
+    for (uint32_t t = 0; t <= NUM_THREADS; t++) {
+        workers[t] = (worker_t){tree, t, false};
+        CHECK(sync_thread_create(&threads[t], t < NUM_THREADS ? worker_main : scanner_main,
+                                 &workers[t]),
+              "start thread");
+    }
+    for (uint32_t t = 0; t <= NUM_THREADS; t++)
+        sync_thread_join(threads[t]);
+    for (uint32_t t = 0; t <= NUM_THREADS; t++)
+        CHECK(workers[t].ok, "every thread saw consistent results");
+
+    uint32_t expected = 0;
+    for (uint32_t t = 0; t < NUM_THREADS; t++) {
+        for (uint32_t i = 0; i < KEYS_PER_THREAD; i++) {
+            uint8_t key[4];
+            bool    deleted = i + 10 < KEYS_PER_THREAD && i % 3 == 0;
+            encode_key(key, worker_key(&workers[t], i));
+            CHECK(btree_get(tree, key, 4, NULL, 0, NULL) != deleted, "key present unless deleted");
+            expected += !deleted;
+        }
+    }
+
+    btree_scan_t* scan = btree_scan_begin(tree, NULL, 0, NULL, 0);
+    const void*   k;
+    const void*   value;
+    uint16_t      key_len, value_len;
+    uint32_t      count = 0;
+    while (btree_scan_next(scan, &k, &key_len, &value, &value_len))
+        count++;
+    btree_scan_end(scan);
+    CHECK(count == expected, "scan returns every remaining key");
+
+    btree_close(tree);
+    remove(path);
+    return true;
+}
+
+/* Recovery passes its context; the redo state is its database instance */
+static bool redo_record(wal_record_header_t* header, void* data, void* arg) {
+    wal_recovery_context_t* recovery = (wal_recovery_context_t*)arg;
+    return btree_redo_apply((btree_redo_t*)recovery->db_instance, header, data);
+}
+
+/* Remove the WAL of a redo test: its segment, then the directory */
+static void remove_wal(void) {
+    remove(WAL_SEGMENT);
+    rmdir_compat(WAL_DIR);
+}
+
+/* Splits and merges logged to the WAL rebuild a lost index file */
+static bool test_wal_redo(buffer_pool_t* pool) {
+    printf("  WAL redo of splits and merges\n");
+
+    const char* path = "./test_btree_wal.db";
+    remove(path);
+    remove_wal();
+
+    wal_context_t* wal  = wal_init(WAL_DIR, 0);
+    btree_t*       tree = wal ? btree_open(pool, path) : NULL;
+    CHECK(tree, "open tree and WAL");
+    btree_set_wal(tree, wal);
+
+    uint8_t key[4];
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        encode_key(key, i);
+        CHECK(btree_insert(tree, key, 4, "value", 5), "insert key");
+    }
+    for (uint32_t i = NUM_KEYS / 4; i < NUM_KEYS / 2; i++) {
+        encode_key(key, i);
+        CHECK(btree_delete(tree, key, 4), "delete key");
+    }
+
+    btree_stats_t stats;
+    btree_get_stats(tree, &stats);
+    CHECK(stats.leaf_splits > 0 && stats.merges > 0, "tree split and merged");
+    uint32_t height = btree_height(tree);
+    btree_close(tree);
+
+    /* Lose the index file; redo must bring back its structure */
+    remove(path);
+    wal_recovery_context_t recovery;
+    memset(&recovery, 0, sizeof(recovery));
+    btree_redo_t* redo   = btree_redo_begin();
+    recovery.db_instance = redo;
+    CHECK(redo, "begin redo");
+    bool ok = wal_perform_recovery(wal, (wal_location_t){0, 0}, redo_record, &recovery);
+    btree_redo_end(redo);
+    wal_shutdown(wal);
+    CHECK(ok, "redo the WAL");
+
+    /* Leaf changes after a leaf's last split or merge are not logged, so check structure */
+    tree = btree_open(pool, path);
+    CHECK(tree && btree_height(tree) == height, "recovered tree has its height");
+
+    btree_scan_t* scan = btree_scan_begin(tree, NULL, 0, NULL, 0);
+    const void*   k;
+    const void*   value;
+    uint16_t      key_len, value_len;
+    uint32_t      count = 0;
+    int64_t       last  = -1;
+    while (btree_scan_next(scan, &k, &key_len, &value, &value_len)) {
+        CHECK((int64_t)decode_key(k) > last && decode_key(k) < NUM_KEYS, "keys come back in order");
+        last = decode_key(k);
+        count++;
+        CHECK(btree_get(tree, k, key_len, NULL, 0, NULL), "recovered key is reachable");
+    }
+    btree_scan_end(scan);
+    CHECK(count > NUM_KEYS / 2, "recovered leaves hold their keys");
+
+    btree_close(tree);
+    remove(path);
+    remove_wal();
+    return true;
+}
+
+/* Leaves of a tree, counted by a full scan */
+static uint32_t count_leaves(btree_t* tree) {
+    btree_scan_t* scan = btree_scan_begin(tree, NULL, 0, NULL, 0);
+    const void*   k;
+    const void*   value;
+    uint16_t      key_len, value_len;
+    while (btree_scan_next(scan, &k, &key_len, &value, &value_len))
+        continue;
+    uint32_t leaves = btree_scan_leaves_read(scan);
+    btree_scan_end(scan);
+    return leaves;
+}
+
+/* Leaves of a tree bulk loaded with keys 0, 2, 4, ... at a fill factor */
+static uint32_t bulk_leaves(buffer_pool_t* pool, uint32_t fillfactor) {
+    const char* path = "./test_btree_fill.db";
+    remove(path);
+    btree_t*      tree = btree_open(pool, path);
+    btree_bulk_t* bulk = tree ? btree_bulk_begin(tree, fillfactor) : NULL;
+    uint8_t       key[4];
+    for (uint32_t i = 0; bulk && i < NUM_KEYS; i++) {
+        encode_key(key, i * 2);
+        btree_bulk_add(bulk, key, 4, "value", 5);
+    }
+    uint32_t leaves = btree_bulk_finish(bulk) ? count_leaves(tree) : 0;
+    btree_close(tree);
+    remove(path);
+    return leaves;
+}
+
+/*
+ * A bulk loaded tree holds every key, packs its leaves to the fill factor,
+ * takes inserts afterwards and is rebuilt from the WAL alone
+ */
+static bool test_bulk_load(buffer_pool_t* pool) {
+    printf("  bulk load\n");
+
+    const char* path = "./test_btree_bulk.db";
+    remove(path);
+    remove_wal();
+
+    wal_context_t* wal  = wal_init(WAL_DIR, 0);
+    btree_t*       tree = wal ? btree_open(pool, path) : NULL;
+    CHECK(tree, "open tree and WAL");
+    btree_set_wal(tree, wal);
+
+    CHECK(!btree_bulk_begin(tree, BTREE_MIN_FILLFACTOR - 1), "fill factor is checked");
+    btree_bulk_t* bulk = btree_bulk_begin(tree, BTREE_DEFAULT_FILLFACTOR);
+    CHECK(bulk, "begin bulk load");
+
+    /* Even keys, so odd ones can be inserted between them later */
+    uint8_t key[4];
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        encode_key(key, i * 2);
+        CHECK(btree_bulk_add(bulk, key, 4, "value", 5), "add key in order");
+    }
+    CHECK(!btree_bulk_add(bulk, key, 4, "value", 5), "repeated key is rejected");
+    encode_key(key, 1);
+    CHECK(!btree_bulk_add(bulk, key, 4, "value", 5), "smaller key is rejected");
+    CHECK(btree_bulk_finish(bulk), "finish bulk load");
+    uint32_t height = btree_height(tree);
+    CHECK(height >= 2, "tree has inner levels");
+    CHECK(!btree_bulk_begin(tree, BTREE_DEFAULT_FILLFACTOR), "only empty trees are bulk loaded");
+    btree_close(tree);
+
+    /* Every page was logged whole: redo alone restores the tree */
+    remove(path);
+    wal_recovery_context_t recovery;
+    memset(&recovery, 0, sizeof(recovery));
+    btree_redo_t* redo   = btree_redo_begin();
+    recovery.db_instance = redo;
+    CHECK(redo, "begin redo");
+    bool ok = wal_perform_recovery(wal, (wal_location_t){0, 0}, redo_record, &recovery);
+    btree_redo_end(redo);
+    wal_shutdown(wal);
+    CHECK(ok, "redo the WAL");
+
+    tree = btree_open(pool, path);
+    CHECK(tree && btree_height(tree) == height, "recovered tree has its height");
+    for (uint32_t i = 0; i < NUM_KEYS * 2; i++) {
+        encode_key(key, i);
+        CHECK(btree_get(tree, key, 4, NULL, 0, NULL) == (i % 2 == 0),
+              "loaded keys and only those are found");
+    }
+
+    /* Inserts between the loaded keys split the packed leaves */
+    for (uint32_t i = 1; i < NUM_KEYS * 2; i += 2) {
+        encode_key(key, i);
+        CHECK(btree_insert(tree, key, 4, "value", 5), "insert between loaded keys");
+    }
+    btree_scan_t* scan = btree_scan_begin(tree, NULL, 0, NULL, 0);
+    const void*   k;
+    const void*   value;
+    uint16_t      key_len, value_len;
+    uint32_t      count = 0;
+    while (btree_scan_next(scan, &k, &key_len, &value, &value_len)) {
+        CHECK(decode_key(k) == count, "scan returns every key in order");
+        count++;
+    }
+    btree_scan_end(scan);
+    CHECK(count == NUM_KEYS * 2, "scan after inserts");
+    btree_close(tree);
+    remove(path);
+
+    /* Packed leaves: fewer than inserts in random order leave, more at a low fill factor */
+    tree = btree_open(pool, path);
+    CHECK(tree, "open tree");
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        encode_key(key, ((i * 7919u) % NUM_KEYS) * 2);
+        CHECK(btree_insert(tree, key, 4, "value", 5), "insert key");
+    }
+    uint32_t inserted = count_leaves(tree);
+    btree_close(tree);
+    remove(path);
+
+    uint32_t packed = bulk_leaves(pool, BTREE_DEFAULT_FILLFACTOR);
+    uint32_t sparse = bulk_leaves(pool, 50);
+    CHECK(packed > 0 && packed * 5 < inserted * 4, "bulk loaded leaves are fuller");
+    CHECK(sparse * 10 > packed * 16, "fill factor leaves room in the leaves");
+
+    remove_wal();
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB B+tree Test - Starting up...\n");
+
+    const char* path = "./test_btree.db";
+    remove(path);
+
+    buffer_pool_t* pool = buffer_pool_create(128);
+    btree_t*       tree = pool ? btree_open(pool, path) : NULL;
+    if (!tree) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return 1;
+    }
+
+    bool ok = test_insert_get(tree) && test_range_scan(tree);
+
+    /* The tree must survive a close and reopen */
+    btree_close(tree);
+    tree = btree_open(pool, path);
+    ok   = ok && tree && test_delete_update(tree) && test_index_ops(pool) && test_merge(pool) &&
+         test_prefix_keys(pool) && test_normalized_keys(pool) && test_concurrent(pool) &&
+         test_wal_redo(pool) && test_bulk_load(pool);
+
+    btree_close(tree);
+    buffer_pool_destroy(pool);
+    remove(path);
+
+    if (!ok)
+        return 1;
+
+    printf("\nB+tree test completed successfully\n");
+    return 0;
+}
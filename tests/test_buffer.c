@@ -0,0 +1,374 @@
+/**
+ * @file test_buffer.c
+ * @brief Tests for the buffer pool and buffer access strategies
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/storage/buffer.h>
+#include <monodb/core/storage/disk_manager.h>
+#include <monodb/core/storage/page.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                       \
+    do {                                                       \
+        if (!(cond)) {                                         \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                      \
+        }                                                      \
+    } while (0)
+
+/* Fill a file with num_pages initialized pages, each stamped with its number */
+static bool populate(buffer_pool_t* pool, disk_manager_t* dm, uint32_t num_pages) {
+    for (uint32_t i = 0; i < num_pages; i++) {
+        page_id_t   page_id;
+        buffer_id_t buf = buffer_extend(pool, dm, NULL, &page_id);
+        CHECK(buf >= 0, "extend file");
+        CHECK(page_id == i, "pages are allocated sequentially");
+
+        buffer_lock(pool, buf, BUFFER_LOCK_EXCLUSIVE);
+        void* page = buffer_page(pool, buf);
+        page_init(page, page_id, PAGE_TYPE_HEAP, 0);
+        memcpy((char*)page + sizeof(page_header_t), &i, sizeof(i));
+        buffer_mark_dirty(pool, buf);
+        buffer_unlock(pool, buf, BUFFER_LOCK_EXCLUSIVE);
+        buffer_release(pool, buf);
+    }
+    return true;
+}
+
+/* Pages written through a small pool must survive eviction and re-reads */
+static bool test_eviction_roundtrip(disk_manager_t* dm) {
+    printf("  eviction round trip\n");
+
+    buffer_pool_t* pool = buffer_pool_create(16);
+    CHECK(pool != NULL, "create pool");
+    CHECK(populate(pool, dm, 200), "populate file");
+
+    for (uint32_t i = 0; i < 200; i++) {
+        buffer_id_t buf = buffer_read(pool, dm, i, NULL);
+        CHECK(buf >= 0, "read page");
+
+        uint32_t stamp;
+        buffer_lock(pool, buf, BUFFER_LOCK_SHARE);
+        memcpy(&stamp, (char*)buffer_page(pool, buf) + sizeof(page_header_t), sizeof(stamp));
+        buffer_unlock(pool, buf, BUFFER_LOCK_SHARE);
+        buffer_release(pool, buf);
+
+        CHECK(stamp == i, "page contents survive eviction");
+    }
+
+    buffer_pool_stats_t stats;
+    buffer_pool_get_stats(pool, &stats);
+    CHECK(stats.evictions > 0, "small pool evicts");
+    CHECK(stats.dirty_writes >= 184, "dirty pages are written back");
+
+    buffer_pool_destroy(pool);
+    return true;
+}
+
+/* Pinned frames must never be chosen as victims */
+static bool test_pinned_frames(disk_manager_t* dm) {
+    printf("  pinned frames\n");
+
+    buffer_pool_t* pool = buffer_pool_create(4);
+    CHECK(pool != NULL, "create pool");
+
+    buffer_id_t pinned[4];
+    for (uint32_t i = 0; i < 4; i++) {
+        pinned[i] = buffer_read(pool, dm, i, NULL);
+        CHECK(pinned[i] >= 0, "pin page");
+    }
+
+    CHECK(buffer_read(pool, dm, 10, NULL) == INVALID_BUFFER, "full pool of pins fails cleanly");
+
+    buffer_release(pool, pinned[2]);
+    buffer_id_t buf = buffer_read(pool, dm, 10, NULL);
+    CHECK(buf == pinned[2], "only the unpinned frame is reused");
+    CHECK(buffer_page_id(pool, buf) == 10, "frame holds the new page");
+
+    buffer_release(pool, buf);
+    buffer_release(pool, pinned[0]);
+    buffer_release(pool, pinned[1]);
+    buffer_release(pool, pinned[3]);
+    buffer_pool_destroy(pool);
+    return true;
+}
+
+/* A sequential scan through a ring must leave the hot set resident */
+static bool test_ring_protects_hot_set(disk_manager_t* dm) {
+    printf("  ring protects hot set\n");
+
+    buffer_pool_t* pool = buffer_pool_create(64);
+    CHECK(pool != NULL, "create pool");
+
+    /* Warm up 32 hot pages with repeated normal access */
+    for (int round = 0; round < 3; round++) {
+        for (uint32_t i = 0; i < 32; i++) {
+            buffer_id_t buf = buffer_read(pool, dm, i, NULL);
+            CHECK(buf >= 0, "read hot page");
+            buffer_release(pool, buf);
+        }
+    }
+
+    buffer_strategy_t* scan = buffer_strategy_create(pool, BUFFER_ACCESS_BULKREAD);
+    CHECK(scan != NULL, "create bulk read strategy");
+    CHECK(buffer_strategy_ring_size(scan) == 8, "ring is capped at 1/8 of the pool");
+
+    for (uint32_t i = 32; i < 200; i++) {
+        buffer_id_t buf = buffer_read(pool, dm, i, scan);
+        CHECK(buf >= 0, "scan page");
+        buffer_release(pool, buf);
+    }
+
+    buffer_pool_stats_t stats;
+    buffer_pool_get_stats(pool, &stats);
+    CHECK(stats.ring_reuses >= 150, "scan recycles its ring");
+
+    buffer_pool_reset_stats(pool);
+    for (uint32_t i = 0; i < 32; i++) {
+        buffer_id_t buf = buffer_read(pool, dm, i, NULL);
+        CHECK(buf >= 0, "re-read hot page");
+        buffer_release(pool, buf);
+    }
+    buffer_pool_get_stats(pool, &stats);
+    CHECK(stats.misses[BUFFER_ACCESS_NORMAL] == 0, "hot set survived the scan");
+
+    /* Pages loaded by the ring are shared with normal readers */
+    buffer_id_t shared = buffer_read(pool, dm, 199, NULL);
+    CHECK(shared >= 0, "read page loaded by ring");
+    buffer_release(pool, shared);
+    buffer_pool_get_stats(pool, &stats);
+    CHECK(stats.hits[BUFFER_ACCESS_NORMAL] == 33, "ring pages are visible to other readers");
+
+    buffer_strategy_free(scan);
+    buffer_pool_destroy(pool);
+    return true;
+}
+
+/* Without a ring, the same scan flushes the hot set */
+static bool test_scan_without_ring(disk_manager_t* dm) {
+    printf("  scan without ring\n");
+
+    buffer_pool_t* pool = buffer_pool_create(64);
+    CHECK(pool != NULL, "create pool");
+
+    for (uint32_t i = 0; i < 32; i++) {
+        buffer_id_t buf = buffer_read(pool, dm, i, NULL);
+        CHECK(buf >= 0, "read hot page");
+        buffer_release(pool, buf);
+    }
+    for (uint32_t i = 32; i < 200; i++) {
+        buffer_id_t buf = buffer_read(pool, dm, i, NULL);
+        CHECK(buf >= 0, "scan page");
+        buffer_release(pool, buf);
+    }
+
+    buffer_pool_stats_t stats;
+    buffer_pool_reset_stats(pool);
+    for (uint32_t i = 0; i < 32; i++) {
+        buffer_id_t buf = buffer_read(pool, dm, i, NULL);
+        CHECK(buf >= 0, "re-read hot page");
+        buffer_release(pool, buf);
+    }
+    buffer_pool_get_stats(pool, &stats);
+    CHECK(stats.misses[BUFFER_ACCESS_NORMAL] > 0, "unrestricted scan evicts hot pages");
+
+    buffer_pool_destroy(pool);
+    return true;
+}
+
+/* Frames dropped with their file must leave the ring that held them */
+static bool test_drop_clears_ring(disk_manager_t* dm) {
+    printf("  dropped frames leave their ring\n");
+
+    const char* path = "./test_buffer_drop.db";
+    remove(path);
+    disk_manager_t* other = disk_manager_open(path);
+    CHECK(other != NULL, "open second file");
+
+    buffer_pool_t* pool = buffer_pool_create(64);
+    CHECK(pool != NULL, "create pool");
+    CHECK(populate(pool, other, 4), "populate second file");
+    CHECK(buffer_drop_file(pool, other), "drop second file");
+
+    buffer_strategy_t* scan = buffer_strategy_create_sized(pool, BUFFER_ACCESS_BULKREAD, 4);
+    CHECK(scan != NULL, "create ring");
+    for (uint32_t i = 0; i < 4; i++) {
+        buffer_id_t buf = buffer_read(pool, dm, i, scan);
+        CHECK(buf >= 0, "scan page");
+        buffer_release(pool, buf);
+    }
+    CHECK(buffer_drop_file(pool, dm), "drop scanned file");
+
+    /* The dropped frames are free again and go to normal readers */
+    for (uint32_t i = 0; i < 4; i++) {
+        buffer_id_t buf = buffer_read(pool, other, i, NULL);
+        CHECK(buf >= 0, "read page of second file");
+        buffer_release(pool, buf);
+    }
+
+    /* Continuing the scan must take new frames rather than those */
+    for (uint32_t i = 4; i < 8; i++) {
+        buffer_id_t buf = buffer_read(pool, dm, i, scan);
+        CHECK(buf >= 0, "scan page");
+        buffer_release(pool, buf);
+    }
+
+    buffer_pool_stats_t stats;
+    buffer_pool_reset_stats(pool);
+    for (uint32_t i = 0; i < 4; i++) {
+        buffer_id_t buf = buffer_read(pool, other, i, NULL);
+        CHECK(buf >= 0, "re-read page of second file");
+        buffer_release(pool, buf);
+    }
+    buffer_pool_get_stats(pool, &stats);
+    CHECK(stats.misses[BUFFER_ACCESS_NORMAL] == 0, "ring did not reuse frames it lost");
+
+    buffer_strategy_free(scan);
+    buffer_pool_destroy(pool);
+    disk_manager_close(other);
+    remove(path);
+    return true;
+}
+
+/* Writers bumping per-page counters against a flusher, on a pool far smaller than the file */
+#define DIRTY_WRITERS   2
+#define DIRTY_PAGES     48
+#define DIRTY_ROUNDS    2000
+
+typedef struct {
+    buffer_pool_t*  pool;
+    disk_manager_t* dm;
+    uint32_t        first; /* Pages first, first + DIRTY_WRITERS, ... belong to this writer */
+    uint32_t        counts[DIRTY_PAGES];
+    bool            ok;
+} dirty_writer_t;
+
+static atomic_bool dirty_done;
+
+static void* dirty_writer_main(void* arg) {
+    dirty_writer_t* writer = (dirty_writer_t*)arg;
+    writer->ok             = true;
+    for (uint32_t round = 0; round < DIRTY_ROUNDS && writer->ok; round++) {
+        uint32_t    nth     = round * 7 % (DIRTY_PAGES / DIRTY_WRITERS);
+        uint32_t    page_id = writer->first + nth * DIRTY_WRITERS;
+        buffer_id_t buf     = buffer_read(writer->pool, writer->dm, page_id, NULL);
+        if (buf < 0) {
+            writer->ok = false;
+            break;
+        }
+
+        /*
+         * Bump the counter a few times per pin, yielding in between so that
+         * flushes overlap the updates. A counter behind the last value
+         * written means an update was lost.
+         */
+        char* slot = (char*)buffer_page(writer->pool, buf) + sizeof(page_header_t) + 4;
+        for (int bump = 0; bump < 4 && writer->ok; bump++) {
+            uint32_t counter;
+            buffer_lock(writer->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+            memcpy(&counter, slot, sizeof(counter));
+            writer->ok = counter == writer->counts[page_id];
+            counter++;
+            memcpy(slot, &counter, sizeof(counter));
+            buffer_mark_dirty(writer->pool, buf);
+            buffer_unlock(writer->pool, buf, BUFFER_LOCK_EXCLUSIVE);
+            writer->counts[page_id] = counter;
+            sync_yield();
+        }
+        buffer_release(writer->pool, buf);
+    }
+    return NULL;
+}
+
+static void* dirty_flusher_main(void* arg) {
+    buffer_pool_t* pool = (buffer_pool_t*)arg;
+    while (!atomic_load(&dirty_done)) {
+        buffer_flush_all(pool);
+        sync_yield();
+    }
+    return NULL;
+}
+
+/* Pages dirtied while a flush or eviction writes them back must stay dirty */
+static bool test_dirty_during_write_back(disk_manager_t* dm) {
+    printf("  dirtied during write-back\n");
+
+    buffer_pool_t* pool = buffer_pool_create(8);
+    CHECK(pool != NULL, "create pool");
+
+    /* Start every counter at zero */
+    for (uint32_t i = 0; i < DIRTY_PAGES; i++) {
+        buffer_id_t buf = buffer_read(pool, dm, i, NULL);
+        CHECK(buf >= 0, "read page");
+        buffer_lock(pool, buf, BUFFER_LOCK_EXCLUSIVE);
+        memset((char*)buffer_page(pool, buf) + sizeof(page_header_t) + 4, 0, sizeof(uint32_t));
+        buffer_mark_dirty(pool, buf);
+        buffer_unlock(pool, buf, BUFFER_LOCK_EXCLUSIVE);
+        buffer_release(pool, buf);
+    }
+
+    sync_thread_t  threads[DIRTY_WRITERS + 1];
+    dirty_writer_t writers[DIRTY_WRITERS];
+    atomic_store(&dirty_done, false);
+    for (uint32_t t = 0; t < DIRTY_WRITERS; t++) {
+        writers[t] = (dirty_writer_t){.pool = pool, .dm = dm, .first = t};
+        CHECK(sync_thread_create(&threads[t], dirty_writer_main, &writers[t]), "start writer");
+    }
+    CHECK(sync_thread_create(&threads[DIRTY_WRITERS], dirty_flusher_main, pool), "start flusher");
+    for (uint32_t t = 0; t < DIRTY_WRITERS; t++)
+        sync_thread_join(threads[t]);
+    atomic_store(&dirty_done, true);
+    sync_thread_join(threads[DIRTY_WRITERS]);
+    for (uint32_t t = 0; t < DIRTY_WRITERS; t++)
+        CHECK(writers[t].ok, "no update was lost while pages were written back");
+
+    /* The file itself must hold the last counters */
+    CHECK(buffer_drop_file(pool, dm), "drop file from pool");
+    for (uint32_t i = 0; i < DIRTY_PAGES; i++) {
+        buffer_id_t buf = buffer_read(pool, dm, i, NULL);
+        CHECK(buf >= 0, "re-read page");
+        uint32_t counter;
+        memcpy(&counter, (char*)buffer_page(pool, buf) + sizeof(page_header_t) + 4,
+               sizeof(counter));
+        buffer_release(pool, buf);
+        CHECK(counter == writers[i % DIRTY_WRITERS].counts[i], "last counter reached disk");
+    }
+
+    buffer_pool_destroy(pool);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB Buffer Pool Test - Starting up...\n");
+
+    const char* path = "./test_buffer.db";
+    remove(path);
+
+    disk_manager_t* dm = disk_manager_open(path);
+    if (!dm) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return 1;
+    }
+
+    bool ok = test_eviction_roundtrip(dm) && test_pinned_frames(dm) &&
+              test_ring_protects_hot_set(dm) && test_scan_without_ring(dm) &&
+              test_drop_clears_ring(dm) && test_dirty_during_write_back(dm);
+
+    disk_manager_close(dm);
+    remove(path);
+
+    if (!ok)
+        return 1;
+
+    printf("\nBuffer pool test completed successfully\n");
+    return 0;
+}
@@ -0,0 +1,237 @@
+/**
+ * @file test_codec.c
+ * @brief Tests for the column codecs
+ */
+
+#include <monodb/core/storage/codec.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+/* Values per column: not a multiple of the unpacking chunk or vector width */
+#define NUM_VALUES 1003
+
+/**
+ * Test column: how it is generated and the codec it should get
+ */
+typedef struct {
+    const char*  name;
+    bool         is_signed;
+    codec_kind_t expected;
+} column_t;
+
+static const column_t columns[] = {
+    {"constant", false, CODEC_CONSTANT},   {"timestamps", false, CODEC_DELTA},
+    {"small range", true, CODEC_FOR},      {"status runs", false, CODEC_RLE},
+    {"random 64-bit", false, CODEC_PLAIN}, {"negative trend", true, CODEC_DELTA},
+};
+#define NUM_COLUMNS (sizeof(columns) / sizeof(columns[0]))
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void make_column(size_t c, uint64_t* values) {
+    uint64_t state = 0x2545F4914F6CDD1Dull + c;
+    for (uint32_t i = 0; i < NUM_VALUES; i++) {
+        uint64_t r = next_random(&state);
+        switch (c) {
+        case 0:
+            values[i] = 42;
+            break;
+        case 1:
+            values[i] = 1700000000000ull + i * 1000 + r % 8;
+            break;
+        case 2:
+            values[i] = (uint64_t)((int64_t)(r % 2000) - 1000);
+            break;
+        case 3:
+            values[i] = (i / 250) % 3;
+            break;
+        case 4:
+            values[i] = r;
+            break;
+        default:
+            values[i] = (uint64_t)(-(int64_t)i * 3 - (int64_t)(r % 2));
+            break;
+        }
+    }
+}
+
+static bool in_range(bool is_signed, uint64_t v, uint64_t lo, uint64_t hi) {
+    if (is_signed)
+        return (int64_t)v >= (int64_t)lo && (int64_t)v <= (int64_t)hi;
+    return v >= lo && v <= hi;
+}
+
+/* Each kind of column gets its codec and decodes to what was encoded */
+static bool test_round_trip(void) {
+    printf("  codec choice and round trip\n");
+
+    uint64_t values[NUM_VALUES], out[NUM_VALUES];
+    uint8_t* buf = (uint8_t*)malloc(codec_bound(NUM_VALUES));
+    CHECK(buf, "allocate");
+    for (size_t c = 0; c < NUM_COLUMNS; c++) {
+        make_column(c, values);
+        codec_kind_t kind = codec_choose(values, NUM_VALUES, columns[c].is_signed);
+        if (kind != columns[c].expected)
+            fprintf(stderr, "  %s: got codec %d\n", columns[c].name, (int)kind);
+        CHECK(kind == columns[c].expected, "codec chosen from the sample");
+
+        /* Every codec must reproduce every column, falling back where it cannot hold it */
+        for (int k = 0; k < CODEC_COUNT; k++) {
+            size_t len = codec_encode(values, NUM_VALUES, columns[c].is_signed, (codec_kind_t)k,
+                                      buf);
+            CHECK(len <= codec_bound(NUM_VALUES), "within bound");
+            memset(out, 0, sizeof(out));
+            CHECK(codec_decode(buf, len, out, NUM_VALUES) == len, "decode");
+            CHECK(memcmp(out, values, sizeof(values)) == 0, "values survive");
+        }
+
+        size_t len = codec_encode(values, NUM_VALUES, columns[c].is_signed, kind, buf);
+        CHECK(codec_stream_kind(buf, len) == kind, "stream records its codec");
+        CHECK(kind == CODEC_PLAIN || len < NUM_VALUES * 8 / 2, "stream is compressed");
+    }
+    free(buf);
+    return true;
+}
+
+/* Range selections on the encoded stream agree with filtering the values */
+static bool test_select(void) {
+    printf("  predicates on compressed streams\n");
+
+    uint64_t values[NUM_VALUES];
+    uint32_t sel[NUM_VALUES];
+    uint8_t* buf = (uint8_t*)malloc(codec_bound(NUM_VALUES));
+    CHECK(buf, "allocate");
+    for (size_t c = 0; c < NUM_COLUMNS; c++) {
+        bool is_signed = columns[c].is_signed;
+        make_column(c, values);
+        for (int k = 0; k < CODEC_COUNT; k++) {
+            size_t len = codec_encode(values, NUM_VALUES, is_signed, (codec_kind_t)k, buf);
+
+            /* Equality on a present value, ranges around stored values, and empty ranges */
+            uint64_t ranges[][2] = {{values[500], values[500]},
+                                    {values[10], values[700]},
+                                    {values[700], values[10]},
+                                    {0, 0},
+                                    {(uint64_t)INT64_MIN, (uint64_t)INT64_MAX},
+                                    {values[3] + 1, values[3] + 5}};
+            for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+                uint64_t lo = ranges[r][0], hi = ranges[r][1];
+                uint32_t n  = codec_select(buf, len, NUM_VALUES, is_signed, lo, hi, sel);
+                uint32_t expected = 0;
+                for (uint32_t i = 0; i < NUM_VALUES; i++) {
+                    if (!in_range(is_signed, values[i], lo, hi))
+                        continue;
+                    CHECK(expected < n && sel[expected] == i, "selected positions");
+                    expected++;
+                }
+                CHECK(n == expected, "selection count");
+            }
+        }
+    }
+    free(buf);
+    return true;
+}
+
+/* The AVX2 kernels agree with the scalar code at every width, count and starting position */
+static bool test_simd(void) {
+    bool simd = codec_set_simd(true);
+    printf("  AVX2 kernels against scalar code%s\n", simd ? "" : " (no AVX2: scalar only)");
+
+    uint64_t values[NUM_VALUES], out[2][NUM_VALUES];
+    uint32_t sel[2][NUM_VALUES];
+    uint8_t* buf = (uint8_t*)malloc(codec_bound(NUM_VALUES));
+    CHECK(buf, "allocate");
+    uint64_t seed = 7;
+    for (uint32_t width = 1; width <= 56; width++) {
+        uint64_t mask = (1ull << width) - 1;
+        for (uint32_t i = 0; i < NUM_VALUES; i++) {
+            seed      = seed * 6364136223846793005ull + 1442695040888963407ull;
+            values[i] = 1000 + ((seed >> 7) & mask);
+        }
+        values[0] = 1000;
+        values[1] = 1000 + mask;
+
+        /* Frame of reference, and deltas, over counts that leave each kind of tail */
+        for (int d = 0; d < 2; d++) {
+            codec_kind_t kind = d ? CODEC_DELTA : CODEC_FOR;
+            for (uint32_t n = 2; n <= NUM_VALUES; n += n < 16 ? 1 : 97) {
+                size_t   len = codec_encode(values, n, false, kind, buf);
+                uint64_t a   = values[n / 2], b = values[n - 1];
+                uint64_t lo  = a < b ? a : b, hi = a < b ? b : a;
+                uint32_t count[2];
+                for (int s = 0; s < 2; s++) {
+                    codec_set_simd(s == 0);
+                    CHECK(codec_decode(buf, len, out[s], n) == len, "decode");
+                    count[s] = codec_select(buf, len, n, false, lo, hi, sel[s]);
+                }
+                codec_set_simd(true);
+                CHECK(memcmp(out[0], values, n * sizeof(uint64_t)) == 0, "AVX2 decode");
+                CHECK(memcmp(out[1], values, n * sizeof(uint64_t)) == 0, "scalar decode");
+                CHECK(count[0] == count[1] && count[0] > 0, "selection counts agree");
+                CHECK(memcmp(sel[0], sel[1], count[0] * sizeof(uint32_t)) == 0,
+                      "selections agree");
+            }
+        }
+    }
+    free(buf);
+    return true;
+}
+
+/* Truncated and inconsistent streams are refused */
+static bool test_malformed(void) {
+    printf("  malformed streams\n");
+
+    uint64_t values[NUM_VALUES], out[NUM_VALUES];
+    uint32_t sel[NUM_VALUES];
+    uint8_t* buf = (uint8_t*)malloc(codec_bound(NUM_VALUES));
+    CHECK(buf, "allocate");
+
+    make_column(2, values);
+    size_t len = codec_encode(values, NUM_VALUES, true, CODEC_FOR, buf);
+    CHECK(codec_decode(buf, len - 1, out, NUM_VALUES) == 0, "truncated stream");
+    CHECK(codec_decode(buf, len, out, NUM_VALUES - 1) == 0, "wrong count");
+    CHECK(codec_select(buf, 8, NUM_VALUES, true, 0, 1, sel) == UINT32_MAX, "short header");
+    buf[1] = 60;
+    CHECK(codec_decode(buf, len, out, NUM_VALUES) == 0, "width too large");
+    buf[0] = CODEC_COUNT;
+    CHECK(codec_stream_kind(buf, len) == CODEC_COUNT, "unknown codec");
+
+    /* Run ends must cover the column in order */
+    make_column(3, values);
+    len          = codec_encode(values, NUM_VALUES, false, CODEC_RLE, buf);
+    uint32_t bad = NUM_VALUES + 1;
+    CHECK(codec_stream_kind(buf, len) == CODEC_RLE, "runs");
+    memcpy(buf + len - sizeof(bad), &bad, sizeof(bad));
+    CHECK(codec_decode(buf, len, out, NUM_VALUES) == 0, "run past the end");
+    free(buf);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB Codec Test - Starting up...\n");
+
+    if (!test_round_trip() || !test_select() || !test_simd() || !test_malformed())
+        return 1;
+
+    printf("\nCodec test completed successfully\n");
+    return 0;
+}
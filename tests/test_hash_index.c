@@ -0,0 +1,345 @@
+/**
+ * @file test_hash_index.c
+ * @brief Tests for the extendible hash index
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/data/bloom.h>
+#include <monodb/core/data/hash_index.h>
+#include <monodb/core/storage/buffer.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+#define NUM_KEYS 30000
+
+/* Threads and keys per thread of the concurrency test */
+#define NUM_THREADS     4
+#define KEYS_PER_THREAD 6000
+
+static uint16_t make_key(char* key, uint32_t i) {
+    return (uint16_t)snprintf(key, 32, "customer:%u", i);
+}
+
+/* Keys inserted one by one grow the directory and are each found with one page read */
+static bool test_insert_get(hash_index_t* index, buffer_pool_t* pool) {
+    printf("  insert, lookup and growth\n");
+
+    char key[32];
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        uint64_t value = (uint64_t)i * 3;
+        CHECK(hash_index_insert(index, key, make_key(key, i), &value, sizeof(value)),
+              "insert key");
+    }
+    uint64_t value = 0;
+    CHECK(!hash_index_insert(index, key, make_key(key, 42), &value, sizeof(value)),
+          "duplicate key is rejected");
+
+    hash_index_stats_t stats;
+    hash_index_get_stats(index, &stats);
+    CHECK(stats.global_depth >= 6 && stats.splits + 1 == stats.buckets && stats.doublings > 0,
+          "buckets split and the directory doubled");
+    CHECK(stats.overflow_pages == 0, "distinct keys need no overflow pages");
+
+    buffer_pool_stats_t before, after;
+    buffer_pool_get_stats(pool, &before);
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        uint16_t len = 0;
+        CHECK(hash_index_get(index, key, make_key(key, i), &value, sizeof(value), &len),
+              "key is found");
+        CHECK(len == sizeof(value) && value == (uint64_t)i * 3, "value matches");
+    }
+    buffer_pool_get_stats(pool, &after);
+    CHECK(after.hits[BUFFER_ACCESS_NORMAL] + after.misses[BUFFER_ACCESS_NORMAL] -
+                  before.hits[BUFFER_ACCESS_NORMAL] - before.misses[BUFFER_ACCESS_NORMAL] ==
+              NUM_KEYS,
+          "each lookup reads exactly one page");
+
+    CHECK(!hash_index_get(index, "customer:x", 10, NULL, 0, NULL), "missing key is not found");
+    uint8_t small[2];
+    uint16_t len = 0;
+    CHECK(hash_index_get(index, key, make_key(key, 7), small, sizeof(small), &len) &&
+              len == sizeof(value),
+          "short buffer reports the full length");
+    return true;
+}
+
+/* Absent keys are turned away by the bucket filters, mostly without reading a page */
+static bool test_filters(hash_index_t* index, buffer_pool_t* pool) {
+    printf("  bloom filters\n");
+
+    /* A filter at capacity has no false negatives and about the rate its size promises */
+    bloom_t* filter = bloom_create(10000, 10);
+    CHECK(filter, "create filter");
+    bool within = true;
+    for (uint32_t i = 0; i < 10000; i++)
+        within = bloom_add(filter, bloom_hash(&i, sizeof(i))) && within;
+    CHECK(within, "filter holds the keys it was sized for");
+    uint32_t extra = 10000;
+    CHECK(!bloom_add(filter, bloom_hash(&extra, sizeof(extra))), "filter reports it is full");
+    for (uint32_t i = 0; i < 10000; i++)
+        CHECK(bloom_may_contain(filter, bloom_hash(&i, sizeof(i))), "added key is found");
+    uint32_t false_positives = 0;
+    for (uint32_t i = 20000; i < 120000; i++)
+        false_positives += bloom_may_contain(filter, bloom_hash(&i, sizeof(i)));
+    CHECK(false_positives < 2000, "false positive rate is under 2% at 10 bits per key");
+    bloom_destroy(filter);
+
+    /* Every bucket has a filter, and only the filters' false positives read a page */
+    hash_index_stats_t before, after;
+    buffer_pool_stats_t pool_before, pool_after;
+    hash_index_get_stats(index, &before);
+    CHECK(before.filters == before.buckets && before.filter_memory > 0, "buckets have filters");
+    buffer_pool_get_stats(pool, &pool_before);
+    char key[32];
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        uint16_t len = (uint16_t)snprintf(key, sizeof(key), "absent:%u", i);
+        CHECK(!hash_index_get(index, key, len, NULL, 0, NULL), "absent key is not found");
+    }
+    buffer_pool_get_stats(pool, &pool_after);
+    hash_index_get_stats(index, &after);
+
+    uint64_t negatives = after.filter_negatives - before.filter_negatives;
+    uint64_t positives = after.filter_false_positives - before.filter_false_positives;
+    CHECK(negatives + positives == NUM_KEYS, "every lookup probes a filter");
+    CHECK(positives * 100 < NUM_KEYS, "false positive rate is under 1%");
+    CHECK(pool_after.hits[BUFFER_ACCESS_NORMAL] + pool_after.misses[BUFFER_ACCESS_NORMAL] -
+                  pool_before.hits[BUFFER_ACCESS_NORMAL] -
+                  pool_before.misses[BUFFER_ACCESS_NORMAL] ==
+              positives,
+          "only false positives read a page");
+    return true;
+}
+
+/* Deleted keys disappear, and their room is reused without further splits */
+static bool test_delete(hash_index_t* index) {
+    printf("  delete and reuse\n");
+
+    char key[32];
+    for (uint32_t i = 0; i < NUM_KEYS; i += 2)
+        CHECK(hash_index_delete(index, key, make_key(key, i)), "delete key");
+    CHECK(!hash_index_delete(index, key, make_key(key, 0)), "deleted key cannot be deleted again");
+
+    for (uint32_t i = 0; i < NUM_KEYS; i++)
+        CHECK(hash_index_get(index, key, make_key(key, i), NULL, 0, NULL) == (i % 2 == 1),
+              "only kept keys are found");
+
+    hash_index_stats_t before, after;
+    hash_index_get_stats(index, &before);
+    for (uint32_t i = 0; i < NUM_KEYS; i += 2) {
+        uint64_t value = (uint64_t)i * 3;
+        CHECK(hash_index_insert(index, key, make_key(key, i), &value, sizeof(value)),
+              "reinsert key");
+    }
+    hash_index_get_stats(index, &after);
+    CHECK(after.buckets == before.buckets, "reinserted keys fill the room deletes left");
+    return true;
+}
+
+/* Every key, the directory and the bucket depths survive a close and reopen */
+static bool test_reopen(hash_index_t* index) {
+    printf("  reopen\n");
+
+    hash_index_stats_t stats;
+    hash_index_get_stats(index, &stats);
+    CHECK(stats.buckets > 1 && stats.global_depth > 0, "index has grown");
+
+    char key[32];
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        uint64_t value = 0;
+        CHECK(hash_index_get(index, key, make_key(key, i), &value, sizeof(value), NULL) &&
+                  value == (uint64_t)i * 3,
+              "key survives a reopen");
+    }
+    hash_index_get_stats(index, &stats);
+    CHECK(stats.filters == stats.buckets, "lookups rebuild the bucket filters");
+
+    /* Growth continues from the stored depths */
+    for (uint32_t i = NUM_KEYS; i < 2 * NUM_KEYS; i++)
+        CHECK(hash_index_insert(index, key, make_key(key, i), &i, sizeof(i)), "insert key");
+    for (uint32_t i = 0; i < 2 * NUM_KEYS; i += 7)
+        CHECK(hash_index_get(index, key, make_key(key, i), NULL, 0, NULL), "key is found");
+    return true;
+}
+
+static bool collect_tid(tuple_id_t tid, void* arg) {
+    uint32_t* counts = (uint32_t*)arg;
+    counts[0]++;
+    counts[1] += tid.slot;
+    return true;
+}
+
+/* A key repeated with many tuple IDs spills into overflow pages and stays reachable */
+static bool test_index_ops(buffer_pool_t* pool) {
+    printf("  secondary index access method and overflow pages\n");
+
+    const char* path = "./test_hash_index_ops.db";
+    remove(path);
+
+    hash_index_t*      index = hash_index_open(pool, path);
+    const index_ops_t* ops   = &hash_index_ops;
+    CHECK(index, "open index");
+
+    /* Far more entries of one key than a page holds, between entries of other keys */
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < 3000; i++) {
+        char key[32];
+        CHECK(ops->insert(index, "status:open", 11, (tuple_id_t){i / 100, i}), "insert entry");
+        CHECK(ops->insert(index, key, make_key(key, i), (tuple_id_t){1, i}), "insert entry");
+        sum += i;
+    }
+    CHECK(!ops->insert(index, "status:open", 11, (tuple_id_t){0, 5}),
+          "same key and tuple ID is rejected");
+    CHECK(ops->remove(index, "status:open", 11, (tuple_id_t){0, 5}), "remove entry");
+    CHECK(!ops->remove(index, "status:open", 11, (tuple_id_t){9, 6}), "wrong tuple ID is kept");
+
+    hash_index_stats_t stats;
+    hash_index_get_stats(index, &stats);
+    CHECK(stats.overflow_pages > 0, "repeated key is chained to overflow pages");
+
+    uint32_t counts[2] = {0, 0};
+    CHECK(ops->lookup(index, "status:open", 11, collect_tid, counts), "lookup");
+    CHECK(counts[0] == 2999 && counts[1] == sum - 5, "lookup visits every other entry");
+    for (uint16_t i = 0; i < 3000; i += 11) {
+        char key[32];
+        counts[0] = counts[1] = 0;
+        CHECK(ops->lookup(index, key, make_key(key, i), collect_tid, counts), "lookup");
+        CHECK(counts[0] == 1 && counts[1] == i, "other keys are found once");
+    }
+
+    /* Removing the repeated key's entries leaves the other keys intact */
+    for (uint16_t i = 0; i < 3000; i++) {
+        if (i != 5)
+            CHECK(ops->remove(index, "status:open", 11, (tuple_id_t){i / 100, i}),
+                  "remove entry");
+    }
+    counts[0] = 0;
+    CHECK(ops->lookup(index, "status:open", 11, collect_tid, counts) && counts[0] == 0,
+          "every entry is removed");
+    for (uint16_t i = 0; i < 3000; i++) {
+        char key[32];
+        CHECK(ops->insert(index, key, make_key(key, i + 3000), (tuple_id_t){2, i}),
+              "insert entry");
+    }
+    for (uint16_t i = 0; i < 6000; i += 13) {
+        char key[32];
+        counts[0] = 0;
+        CHECK(ops->lookup(index, key, make_key(key, i), collect_tid, counts) && counts[0] == 1,
+              "keys survive splits of chained buckets");
+    }
+
+    ops->close(index);
+    remove(path);
+    return true;
+}
+
+/**
+ * Worker of the concurrency test
+ */
+typedef struct {
+    hash_index_t* index;
+    uint32_t      id;
+    bool          ok;
+} worker_t;
+
+static void* worker_main(void* arg) {
+    worker_t* worker = (worker_t*)arg;
+    char      key[32];
+
+    worker->ok = true;
+    for (uint32_t i = 0; i < KEYS_PER_THREAD && worker->ok; i++) {
+        uint32_t id = i * NUM_THREADS + worker->id;
+        worker->ok  = hash_index_insert(worker->index, key, make_key(key, id), &id, sizeof(id));
+
+        /* Read back an earlier key and delete every third one */
+        if (worker->ok && i >= 10) {
+            uint32_t back = (i - 10) * NUM_THREADS + worker->id;
+            uint32_t got  = 0;
+            uint16_t len  = make_key(key, back);
+            worker->ok    = hash_index_get(worker->index, key, len, &got, sizeof(got), NULL) &&
+                         got == back;
+            if (worker->ok && (i - 10) % 3 == 0)
+                worker->ok = hash_index_delete(worker->index, key, len);
+        }
+    }
+    return NULL;
+}
+
+/* Threads inserting, reading and deleting through splits leave exactly the expected keys */
+static bool test_concurrent(buffer_pool_t* pool) {
+    printf("  concurrent readers and writers\n");
+
+    const char* path = "./test_hash_index_concurrent.db";
+    remove(path);
+    hash_index_t* index = hash_index_open(pool, path);
+    CHECK(index, "open index");
+
+    sync_thread_t threads[NUM_THREADS];
+    worker_t      workers[NUM_THREADS];
+    for (uint32_t t = 0; t < NUM_THREADS; t++) {
+        workers[t] = (worker_t){index, t, false};
+        CHECK(sync_thread_create(&threads[t], worker_main, &workers[t]), "start thread");
+    }
+    for (uint32_t t = 0; t < NUM_THREADS; t++)
+        sync_thread_join(threads[t]);
+    for (uint32_t t = 0; t < NUM_THREADS; t++)
+        CHECK(workers[t].ok, "every thread saw consistent results");
+
+    char key[32];
+    for (uint32_t t = 0; t < NUM_THREADS; t++) {
+        for (uint32_t i = 0; i < KEYS_PER_THREAD; i++) {
+            bool deleted = i + 10 < KEYS_PER_THREAD && i % 3 == 0;
+            CHECK(hash_index_get(index, key, make_key(key, i * NUM_THREADS + t), NULL, 0, NULL) !=
+                      deleted,
+                  "key present unless deleted");
+        }
+    }
+
+    hash_index_close(index);
+    remove(path);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB Hash Index Test - Starting up...\n");
+
+    const char* path = "./test_hash_index.db";
+    remove(path);
+
+    buffer_pool_t* pool  = buffer_pool_create(128);
+    hash_index_t*  index = pool ? hash_index_open(pool, path) : NULL;
+    if (!index) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return 1;
+    }
+
+    bool ok = test_insert_get(index, pool) && test_filters(index, pool) && test_delete(index);
+
+    /* The index must survive a close and reopen */
+    hash_index_close(index);
+    index = hash_index_open(pool, path);
+    ok    = ok && index && test_reopen(index) && test_index_ops(pool) && test_concurrent(pool);
+
+    hash_index_close(index);
+    buffer_pool_destroy(pool);
+    remove(path);
+
+    if (!ok)
+        return 1;
+
+    printf("\nHash index test completed successfully\n");
+    return 0;
+}
@@ -0,0 +1,300 @@
+/**
+ * @file test_heap.c
+ * @brief Tests for heap files, HOT updates and synchronized sequential scans
+ */
+
+#include <monodb/core/storage/buffer.h>
+#include <monodb/core/storage/heap.h>
+#include <monodb/core/storage/sync_scan.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+#define NUM_TUPLES 4000
+
+/**
+ * Test row: a key plus filler so a page holds a few dozen rows
+ */
+typedef struct {
+    uint32_t key;
+    char     filler[124];
+} test_row_t;
+
+static tuple_id_t tids[NUM_TUPLES];
+
+/* Insert NUM_TUPLES rows and remember their addresses */
+static bool test_insert_fetch(heap_t* heap) {
+    printf("  insert and fetch\n");
+
+    for (uint32_t i = 0; i < NUM_TUPLES; i++) {
+        test_row_t row;
+        memset(&row, 'x', sizeof(row));
+        row.key = i;
+        CHECK(heap_insert(heap, &row, sizeof(row), 1, &tids[i]), "insert row");
+    }
+    CHECK(heap_num_pages(heap) > 32, "rows span many pages");
+
+    for (uint32_t i = 0; i < NUM_TUPLES; i += 7) {
+        test_row_t row;
+        uint16_t   len;
+        CHECK(heap_fetch(heap, tids[i], &row, sizeof(row), &len), "fetch row");
+        CHECK(len == sizeof(row) && row.key == i, "fetched row matches");
+    }
+
+    return true;
+}
+
+/* Deleted rows disappear from fetches and scans */
+static bool test_delete_scan(heap_t* heap) {
+    printf("  delete and scan\n");
+
+    for (uint32_t i = 0; i < NUM_TUPLES; i += 10)
+        CHECK(heap_delete(heap, tids[i], 2), "delete row");
+    CHECK(!heap_delete(heap, tids[0], 3), "double delete fails");
+    CHECK(!heap_fetch(heap, tids[0], NULL, 0, NULL), "deleted row is gone");
+
+    heap_scan_t* scan = heap_scan_begin(heap, HEAP_SCAN_PLAIN);
+    CHECK(scan != NULL, "begin scan");
+    CHECK(heap_scan_start_page(scan) == 0, "plain scan starts at page 0");
+
+    uint32_t    count = 0;
+    uint32_t    last  = 0;
+    tuple_id_t  tid;
+    const void* data;
+    uint16_t    len;
+    while (heap_scan_next(scan, &tid, &data, &len)) {
+        const test_row_t* row = (const test_row_t*)data;
+        CHECK(row->key % 10 != 0, "scan skips deleted rows");
+        CHECK(count == 0 || row->key > last, "plain scan returns rows in order");
+        last = row->key;
+        count++;
+    }
+    heap_scan_end(scan);
+
+    CHECK(count == NUM_TUPLES - NUM_TUPLES / 10, "scan returns every live row");
+    return true;
+}
+
+/* A second synchronized scan joins the first one and still sees every row once */
+static bool test_sync_scan(heap_t* heap) {
+    printf("  synchronized scan\n");
+
+    heap_scan_t* leader = heap_scan_begin(heap, HEAP_SCAN_SYNC);
+    CHECK(leader != NULL, "begin leader scan");
+
+    tuple_id_t  tid;
+    const void* data;
+    uint16_t    len;
+    while (heap_scan_next(leader, &tid, &data, &len)) {
+        if (tid.page_id >= 20)
+            break;
+    }
+
+    heap_scan_t* follower = heap_scan_begin(heap, HEAP_SCAN_SYNC);
+    CHECK(follower != NULL, "begin follower scan");
+    CHECK(heap_scan_start_page(follower) == 16, "follower starts at the leader's last report");
+
+    static uint8_t seen[NUM_TUPLES];
+    memset(seen, 0, sizeof(seen));
+    uint32_t  count   = 0;
+    bool      wrapped = false;
+    page_id_t prev    = heap_scan_start_page(follower);
+    while (heap_scan_next(follower, &tid, &data, &len)) {
+        const test_row_t* row = (const test_row_t*)data;
+        CHECK(row->key < NUM_TUPLES && !seen[row->key], "each row is returned once");
+        seen[row->key] = 1;
+        if (tid.page_id < prev)
+            wrapped = true;
+        prev = tid.page_id;
+        count++;
+    }
+    CHECK(wrapped, "follower wraps around the end of the heap");
+    CHECK(count == NUM_TUPLES - NUM_TUPLES / 10, "follower returns every live row");
+
+    heap_scan_end(follower);
+    heap_scan_end(leader);
+    return true;
+}
+
+/* Repeated updates of one row stay on its page and are reachable from the root */
+static bool test_hot_update(heap_t* heap) {
+    printf("  heap-only updates\n");
+
+    tuple_id_t   root = tids[1];
+    heap_stats_t stats;
+    test_row_t   row;
+    uint16_t     len;
+    memset(&row, 'u', sizeof(row));
+
+    /* Far more versions than fit on a page: pruning must keep making room */
+    for (uint32_t i = 0; i < 500; i++) {
+        tuple_id_t new_tid;
+        bool       hot;
+        row.key = NUM_TUPLES + i;
+        CHECK(heap_update(heap, root, &row, sizeof(row), 10 + i, true, &new_tid, &hot),
+              "update row");
+        CHECK(hot && new_tid.page_id == root.page_id, "update is heap-only");
+    }
+
+    heap_get_stats(heap, &stats);
+    CHECK(stats.hot_updates == 500 && stats.cold_updates == 0, "all updates were HOT");
+    CHECK(stats.prunes > 0 && stats.pruned_versions > 0, "chain was pruned on the way");
+
+    CHECK(heap_fetch(heap, root, &row, sizeof(row), &len), "fetch through the root");
+    CHECK(row.key == NUM_TUPLES + 499, "fetch returns the newest version");
+
+    /* A scan reports the chain once, under the root's address */
+    heap_scan_t* scan  = heap_scan_begin(heap, HEAP_SCAN_PLAIN);
+    uint32_t     found = 0;
+    tuple_id_t   tid;
+    const void*  data;
+    while (heap_scan_next(scan, &tid, &data, &len)) {
+        if (((const test_row_t*)data)->key >= NUM_TUPLES) {
+            CHECK(tid.page_id == root.page_id && tid.slot == root.slot, "scan reports the root");
+            found++;
+        }
+    }
+    heap_scan_end(scan);
+    CHECK(found == 1, "scan returns one version of the row");
+
+    /* A regular update moves the row; the old root no longer resolves */
+    tuple_id_t moved;
+    bool       hot;
+    CHECK(heap_update(heap, root, &row, sizeof(row), 600, false, &moved, &hot), "cold update");
+    CHECK(!hot, "update without allow_hot is not heap-only");
+    CHECK(!heap_fetch(heap, root, NULL, 0, NULL), "old root is superseded");
+    CHECK(heap_fetch(heap, moved, &row, sizeof(row), &len), "new version is fetchable");
+
+    /* Everything superseded on the page can be reclaimed */
+    heap_prune_page(heap, root.page_id);
+    CHECK(!heap_update(heap, root, &row, sizeof(row), 601, true, NULL, NULL),
+          "pruned root cannot be updated");
+
+    return true;
+}
+
+/* Count the pages the visibility map marks all-visible */
+static uint32_t count_visible(heap_t* heap) {
+    uint32_t visible = 0;
+    for (page_id_t p = 0; p < heap_num_pages(heap); p++)
+        visible += heap_page_all_visible(heap, p);
+    return visible;
+}
+
+/* Vacuum marks settled pages all-visible; any change clears the page's bit */
+static bool test_visibility_map(buffer_pool_t* pool) {
+    printf("  visibility map\n");
+
+    const char* path    = "./test_heap_vm.db";
+    const char* vm_path = "./test_heap_vm.db.vm";
+    remove(path);
+    remove(vm_path);
+
+    heap_t* heap = heap_open(pool, path);
+    CHECK(heap, "open heap");
+
+    /* Rows of an old transaction, then a few of a recent one on the last page */
+    tuple_id_t tid, recent;
+    test_row_t row;
+    memset(&row, 'v', sizeof(row));
+    for (uint32_t i = 0; i < 1000; i++)
+        CHECK(heap_insert(heap, &row, sizeof(row), 5, &tid), "insert row");
+    CHECK(heap_insert(heap, &row, sizeof(row), 100, &recent), "insert recent row");
+    uint32_t pages = heap_num_pages(heap);
+    CHECK(count_visible(heap) == 0, "new pages are not all-visible");
+
+    heap_vacuum_stats_t stats;
+    heap_set_prune_horizon(heap, 50);
+    CHECK(heap_vacuum(heap, &stats), "vacuum");
+    CHECK(stats.pages == pages && stats.all_visible == pages - 1, "vacuum reports its pages");
+    CHECK(!heap_page_all_visible(heap, recent.page_id) && count_visible(heap) == pages - 1,
+          "page with a row newer than the horizon is not all-visible");
+
+    heap_set_prune_horizon(heap, UINT32_MAX);
+    CHECK(heap_vacuum(heap, &stats) && count_visible(heap) == pages, "every page all-visible");
+
+    /* Deletes, updates and inserts each clear the bit of the page they change */
+    CHECK(heap_delete(heap, (tuple_id_t){0, 3}, 6), "delete row");
+    CHECK(!heap_page_all_visible(heap, 0), "delete clears the bit");
+    CHECK(heap_update(heap, (tuple_id_t){1, 2}, &row, sizeof(row), 7, true, NULL, NULL),
+          "update row");
+    CHECK(!heap_page_all_visible(heap, 1), "update clears the bit");
+    CHECK(heap_insert(heap, &row, sizeof(row), 8, &tid), "insert row");
+    CHECK(!heap_page_all_visible(heap, tid.page_id), "insert clears the bit");
+    CHECK(count_visible(heap) == heap_num_pages(heap) - 3, "other pages keep their bits");
+
+    /* Vacuum prunes the superseded versions and marks the pages again */
+    CHECK(heap_vacuum(heap, &stats) && stats.pruned_versions == 2, "vacuum prunes");
+    CHECK(count_visible(heap) == heap_num_pages(heap), "changed pages are all-visible again");
+
+    /* The map survives a clean close; opening consumes the saved file */
+    pages = heap_num_pages(heap);
+    heap_close(heap);
+    FILE* f = fopen(vm_path, "rb");
+    CHECK(f, "map is saved on close");
+    fclose(f);
+    heap = heap_open(pool, path);
+    CHECK(heap && count_visible(heap) == pages, "map is loaded on open");
+    f = fopen(vm_path, "rb");
+    CHECK(!f, "saved map is removed once loaded");
+
+    heap_close(heap);
+    remove(path);
+    remove(vm_path);
+    return true;
+}
+
+/* Scan position survives between scans and resets when the heap shrinks */
+static bool test_sync_scan_location(void) {
+    printf("  scan location bookkeeping\n");
+
+    sync_scan_report_location(424242, 48);
+    CHECK(sync_scan_get_location(424242, 100) == 48, "reported location is returned");
+    sync_scan_report_location(424242, 50);
+    CHECK(sync_scan_get_location(424242, 100) == 48, "reports between intervals are skipped");
+    CHECK(sync_scan_get_location(424242, 40) == 0, "location beyond the end restarts at 0");
+    sync_scan_forget(424242);
+    CHECK(sync_scan_get_location(424242, 100) == 0, "forgotten file starts at 0");
+
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB Heap Test - Starting up...\n");
+
+    const char* path = "./test_heap.db";
+    remove(path);
+
+    buffer_pool_t* pool = buffer_pool_create(256);
+    heap_t*        heap = pool ? heap_open(pool, path) : NULL;
+    if (!heap) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return 1;
+    }
+
+    bool ok = test_insert_fetch(heap) && test_delete_scan(heap) && test_sync_scan(heap) &&
+              test_hot_update(heap) && test_visibility_map(pool) && test_sync_scan_location();
+
+    heap_close(heap);
+    buffer_pool_destroy(pool);
+    remove(path);
+
+    if (!ok)
+        return 1;
+
+    printf("\nHeap test completed successfully\n");
+    return 0;
+}
@@ -0,0 +1,325 @@
+/**
+ * @file test_json.cpp
+ * @brief Tests for JsonType: parsing, the binary format, lookups, paths and printing
+ */
+
+#include <monodb/cpp/types/JsonType.hpp>
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+using monodb::JsonKind;
+using monodb::JsonPath;
+using monodb::JsonType;
+using monodb::JsonValue;
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+static bool parses(std::string_view text) { return JsonType::parse(text).has_value(); }
+
+static bool test_scalars() {
+    printf("Testing scalars...\n");
+
+    auto doc = JsonType::parse(" -42 ");
+    CHECK(doc && doc->root().kind() == JsonKind::Int && doc->root().asInt() == -42, "integer");
+    doc = JsonType::parse("9223372036854775807");
+    CHECK(doc && doc->root().asInt() == INT64_MAX, "largest integer");
+    doc = JsonType::parse("-9223372036854775808");
+    CHECK(doc && doc->root().kind() == JsonKind::Int && doc->root().asInt() == INT64_MIN,
+          "smallest integer");
+    doc = JsonType::parse("9223372036854775808");
+    CHECK(doc && doc->root().kind() == JsonKind::Double, "integer past 64 bits is a double");
+    doc = JsonType::parse("1.5e3");
+    CHECK(doc && doc->root().kind() == JsonKind::Double && doc->root().asDouble() == 1500,
+          "double");
+    CHECK(doc->root().asInt() == 1500, "double as integer");
+    doc = JsonType::parse("1e-400");
+    CHECK(doc && doc->root().asDouble() == 0, "underflow reads as zero");
+    CHECK(!parses("1e400"), "overflow rejected");
+    doc = JsonType::parse("true");
+    CHECK(doc && doc->root().isBool() && doc->root().asBool(), "true");
+    doc = JsonType::parse("false");
+    CHECK(doc && doc->root().isBool() && !doc->root().asBool(), "false");
+    doc = JsonType::parse("null");
+    CHECK(doc && doc->root().isNull(), "null");
+    CHECK(JsonType().root().isNull(), "default document is null");
+
+    for (const char* bad : {"", " ", "01", "-", "1.", ".5", "1e", "+1", "truex", "nul", "1 2",
+                            "tru", "1x", "NaN", "[1]]", "-01"})
+        CHECK(!parses(bad), bad);
+    return true;
+}
+
+static bool test_strings() {
+    printf("Testing strings...\n");
+
+    auto doc = JsonType::parse(R"("a\"b\\c\/d\b\f\n\r\tAé€😀")");
+    CHECK(doc, "escapes parse");
+    CHECK(doc->root().asString() == "a\"b\\c/d\b\f\n\r\tA\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80",
+          "escapes unescaped");
+    CHECK(doc->toString() ==
+              "\"a\\\"b\\\\c/d\\b\\f\\n\\r\\tA\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\"",
+          "escapes printed");
+    doc = JsonType::parse("\"caf\xc3\xa9\"");
+    CHECK(doc && doc->root().asString() == "caf\xc3\xa9", "raw UTF-8");
+
+    CHECK(!parses(R"("\ud83d")"), "lone high surrogate");
+    CHECK(!parses(R"("\ude00")"), "lone low surrogate");
+    CHECK(!parses(R"("\x")"), "unknown escape");
+    CHECK(!parses(R"("\u12")"), "short \\u escape");
+    CHECK(!parses("\"a\nb\""), "control character");
+    CHECK(!parses("\"\xc3\""), "truncated UTF-8");
+    CHECK(!parses("\"\xc0\xaf\""), "overlong UTF-8");
+    CHECK(!parses("\"\xed\xa0\x80\""), "encoded surrogate");
+    CHECK(!parses("\"abc"), "unterminated string");
+    CHECK(!parses("\"abc\\\""), "escaped closing quote");
+    CHECK(!parses("\"a\"\"b\""), "adjacent strings");
+    return true;
+}
+
+static bool test_containers() {
+    printf("Testing arrays and objects...\n");
+
+    auto doc = JsonType::parse(R"({"name": "ada", "tags": ["x", 2, null], "id": 7,
+                                   "nested": {"deep": {"k": [1, {"z": true}]}}, "": 0})");
+    CHECK(doc, "parse");
+    JsonValue root = doc->root();
+    CHECK(root.isObject() && root.size() == 5, "object size");
+    CHECK(root.find("name").asString() == "ada", "find string");
+    CHECK(root.find("id").asInt() == 7, "find integer");
+    CHECK(root.find("").asInt() == 0, "find empty key");
+    CHECK(!root.find("missing") && !root.find("nam") && !root.find("names"), "missing keys");
+    CHECK(!root.find("name").find("x") && !root.find("id").at(0), "lookups on scalars");
+
+    /* Keys are sorted by length, then bytes */
+    CHECK(root.keyAt(0) == "" && root.keyAt(1) == "id" && root.keyAt(2) == "name" &&
+              root.keyAt(3) == "tags" && root.keyAt(4) == "nested",
+          "key order");
+    CHECK(root.valueAt(1).asInt() == 7 && !root.valueAt(5), "values in key order");
+
+    JsonValue tags = root.find("tags");
+    CHECK(tags.isArray() && tags.size() == 3, "array size");
+    CHECK(tags.at(0).asString() == "x" && tags.at(1).asInt() == 2 && tags.at(2).isNull(),
+          "elements");
+    CHECK(!tags.at(3) && tags.valueAt(1).asInt() == 2, "element bounds");
+
+    auto path = JsonPath::parse("$.nested.deep.k[1].z");
+    CHECK(path && path->size() == 5, "path parse");
+    CHECK(root.find(*path).asBool(), "path lookup");
+    path = JsonPath::parse(R"(nested["deep"]["k"][0])");
+    CHECK(path && root.find(*path).asInt() == 1, "bracketed keys");
+    CHECK(!root.find(JsonPath().key("nested").key("k")), "path miss");
+    CHECK(root.find(JsonPath()) == root, "empty path");
+    CHECK(JsonPath::parse("$") && JsonPath::parse("a[0][1]"), "path forms");
+    CHECK(!JsonPath::parse("a.") && !JsonPath::parse("a[") && !JsonPath::parse("a[x]") &&
+              !JsonPath::parse("a..b") && !JsonPath::parse("a]"),
+          "malformed paths");
+
+    /* Duplicate keys keep the last value; key order does not matter */
+    doc = JsonType::parse(R"({"b": 1, "a": 2, "b": 3})");
+    CHECK(doc && doc->root().size() == 2 && doc->root().find("b").asInt() == 3, "duplicate keys");
+    auto other = JsonType::parse(R"({"a":2,"b":3})");
+    CHECK(other && *doc == *other, "equal documents have equal bytes");
+    CHECK(doc->toString() == R"({"a":2,"b":3})", "printed in key order");
+    other = JsonType::parse(R"({"a":2,"b":3.0})");
+    CHECK(other && !(*doc == *other), "integers differ from doubles");
+
+    auto hay      = JsonType::parse(R"({"a": 1, "b": {"c": [1, 2, {"d": "x"}]}, "e": [[1, 2]]})");
+    auto contains = [&hay](const char* text) {
+        auto needle = JsonType::parse(text);
+        return needle && hay->root().contains(needle->root());
+    };
+    CHECK(hay && contains("{}") && contains(R"({"a":1})") && contains(R"({"b":{"c":[2,1,1]}})") &&
+              contains(R"({"b":{"c":[{}]}})") && contains(R"({"e":[[2]]})"),
+          "containment");
+    CHECK(!contains(R"({"a":2})") && !contains(R"({"b":{"c":[3]}})") && !contains(R"({"e":[2]})") &&
+              !contains("[]") && !contains(R"({"a":1.0})") && !contains(R"({"f":null})"),
+          "no containment");
+
+    doc = JsonType::parse("[[], {}, [[]]]");
+    CHECK(doc && doc->toString() == "[[],{},[[]]]", "empty containers");
+
+    for (const char* bad : {"[1,]", "[,1]", "{\"a\"}", "{\"a\":}", "{\"a\" 1}", "{a:1}",
+                            "{\"a\":1,}", "[1 2]", "[", "{", "]", "{\"a\":1]", "[1}", "{1:2}"})
+        CHECK(!parses(bad), bad);
+
+    size_t error = 0;
+    CHECK(!JsonType::parse("[1, 2, x]", &error) && error == 7, "error offset");
+    return true;
+}
+
+static bool test_depth() {
+    printf("Testing nesting depth...\n");
+
+    std::string deep(monodb::kJsonMaxDepth, '[');
+    deep += std::string(monodb::kJsonMaxDepth, ']');
+    CHECK(parses(deep), "deepest nesting");
+    CHECK(!parses("[" + deep + "]"), "too deep");
+    return true;
+}
+
+/* Random value as compact JSON; strings mix escapes, backslash runs and UTF-8 */
+static void random_value(std::mt19937_64& rng, int depth, std::string& out) {
+    static const char* const pieces[] = {"a", "\\\\", "\\\"", "\\n", "\\u00e9", "\xc3\xa9",
+                                         "{[:,]}", " ", "\\ud83d\\ude00", "xyz0123456789"};
+    int kind = static_cast<int>(rng() % (depth > 4 ? 5 : 7));
+    switch (kind) {
+        case 0:
+            out += rng() % 2 ? "true" : "null";
+            break;
+        case 1:
+            out += std::to_string(static_cast<int64_t>(rng()) >> (rng() % 64));
+            break;
+        case 2:
+            out += std::to_string(static_cast<double>(rng() % 100000) / 64);
+            break;
+        case 3:
+        case 4: {
+            out += '"';
+            for (uint64_t n = rng() % 12; n > 0; n--)
+                out += pieces[rng() % 10];
+            out += '"';
+            break;
+        }
+        case 5: {
+            out += '[';
+            for (uint64_t n = rng() % 6, i = 0; i < n; i++) {
+                if (i)
+                    out += ',';
+                random_value(rng, depth + 1, out);
+            }
+            out += ']';
+            break;
+        }
+        default: {
+            out += '{';
+            for (uint64_t n = rng() % 6, i = 0; i < n; i++) {
+                if (i)
+                    out += ',';
+                out += "\"k" + std::to_string(rng() % 8) + (rng() % 4 ? "" : "\\\\") + "\":";
+                random_value(rng, depth + 1, out);
+            }
+            out += '}';
+            break;
+        }
+    }
+}
+
+/*
+ * Stage one works on 64-byte blocks with carries between them, so random
+ * documents are parsed compact and again with whitespace inserted between
+ * tokens, shifting every string, escape and number across block
+ * boundaries; both must give the same bytes, which must print back to
+ * text that parses to them again.
+ */
+static bool test_random_documents() {
+    printf("Testing random documents...\n");
+
+    std::mt19937_64 rng(7);
+    for (int round = 0; round < 3000; round++) {
+        std::string text;
+        random_value(rng, 0, text);
+
+        /* Whitespace between tokens only: after structural characters */
+        std::string spaced;
+        bool        in_string = false, escaped = false;
+        for (char c : text) {
+            spaced += c;
+            if (in_string) {
+                in_string = escaped || c != '"';
+                escaped   = !escaped && c == '\\';
+                continue;
+            }
+            if (c == '"') {
+                in_string = true;
+                continue;
+            }
+            if (c == '[' || c == '{' || c == ',' || c == ':')
+                spaced.append(rng() % 40, " \t\r\n"[rng() % 4]);
+        }
+
+        auto compact = JsonType::parse(text);
+        auto loose   = JsonType::parse(spaced);
+        CHECK(compact && loose, "random document parses");
+        CHECK(*compact == *loose, "whitespace does not change the document");
+        auto again = JsonType::parse(compact->toString());
+        CHECK(again && *again == *compact, "printed document parses back");
+        auto copy = JsonType::fromBinary(compact->binary());
+        CHECK(copy && *copy == *compact, "binary form validates");
+    }
+    return true;
+}
+
+/* Escapes of every parity ending at every offset of a 64-byte block */
+static bool test_escape_runs() {
+    printf("Testing backslash runs across blocks...\n");
+
+    for (size_t pad = 0; pad < 140; pad++) {
+        for (size_t run = 0; run < 70; run++) {
+            std::string text(pad, ' ');
+            text += '"';
+            text.append(run, '\\');
+            text += run % 2 ? "\"x\"" : "\"";
+            auto doc = JsonType::parse(text);
+            CHECK(doc && doc->root().isString(), "string with backslash run");
+            std::string_view s = doc->root().asString();
+            CHECK(s.size() == run / 2 + (run % 2 ? 2 : 0), "unescaped length");
+            CHECK(s.find_first_not_of(run % 2 ? "\\\"x" : "\\") == std::string_view::npos,
+                  "unescaped bytes");
+        }
+    }
+    return true;
+}
+
+static bool test_binary() {
+    printf("Testing binary validation...\n");
+
+    auto doc = JsonType::parse(R"({"a": [1, "two", {"b": null}], "cc": 2.5, "d": "x"})");
+    CHECK(doc, "parse");
+    std::span<const uint8_t> bytes = doc->binary();
+    CHECK(doc->root().binary().size() == bytes.size(), "value size");
+    CHECK(doc->root().find("a").at(1).binary().size() == 8, "string size");
+
+    std::vector<uint8_t> copy(bytes.begin(), bytes.end());
+    CHECK(!JsonType::fromBinary(std::span(copy.data(), copy.size() - 1)), "truncated");
+    CHECK(!JsonType::fromBinary({}), "empty");
+    copy.push_back(0);
+    CHECK(!JsonType::fromBinary(copy), "trailing bytes");
+    copy.pop_back();
+
+    /* Every single-byte corruption is rejected or still reads safely */
+    for (size_t i = 0; i < copy.size(); i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            copy[i] ^= static_cast<uint8_t>(1 << bit);
+            auto corrupt = JsonType::fromBinary(copy);
+            if (corrupt)
+                CHECK(JsonType::parse(corrupt->toString()), "accepted corruption prints JSON");
+            copy[i] ^= static_cast<uint8_t>(1 << bit);
+        }
+    }
+
+    /* Keys out of order are rejected */
+    auto two = JsonType::parse(R"({"a":1,"b":2})");
+    copy.assign(two->binary().begin(), two->binary().end());
+    std::swap(copy[monodb::json_detail::kHeader], copy[monodb::json_detail::kHeader + 12]);
+    CHECK(!JsonType::fromBinary(copy), "unsorted keys");
+    return true;
+}
+
+int main() {
+    printf("MonoDB Json Test - Starting up...\n");
+
+    if (!test_scalars() || !test_strings() || !test_containers() || !test_depth() ||
+        !test_random_documents() || !test_escape_runs() || !test_binary())
+        return 1;
+
+    printf("\nJson test completed successfully\n");
+    return 0;
+}
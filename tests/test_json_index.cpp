@@ -0,0 +1,254 @@
+/**
+ * @file test_json_index.cpp
+ * @brief Tests for JsonIndex: containment and path lookups against full scans, through
+ *        pending list merges, removals and updates
+ */
+
+#include <monodb/cpp/types/JsonIndex.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+
+using monodb::JsonIndex;
+using monodb::JsonPath;
+using monodb::JsonType;
+using monodb::JsonValue;
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+using Documents = std::map<uint64_t, JsonType>;
+
+/* Document from a small vocabulary, so that queries match many documents */
+static JsonType random_document(std::mt19937_64& rng) {
+    static const char* const types[] = {"order", "refund", "quote"};
+    static const char* const names[] = {"ada", "bob", "cy", "dee", "eve"};
+    std::string              text    = "{\"type\": \"" + std::string(types[rng() % 3]) + "\"";
+    text += ", \"n\": " + std::to_string(rng() % 10);
+    if (rng() % 4)
+        text += ", \"ok\": " + std::string(rng() % 2 ? "true" : "false");
+    text += ", \"tags\": [";
+    for (int t = 0, first = 1; t < 4; t++) {
+        if (rng() % 2) {
+            text += std::string(first ? "" : ", ") + "\"" + static_cast<char>('a' + t) + "\"";
+            first = 0;
+        }
+    }
+    text += "], \"owner\": {\"name\": \"" + std::string(names[rng() % 5]) +
+            "\", \"age\": " + std::to_string(20 + rng() % 5) + "}, \"items\": [";
+    for (uint64_t i = 0, n = rng() % 4; i < n; i++) {
+        text += std::string(i ? ", " : "") + "{\"sku\": " + std::to_string(rng() % 5) +
+                ", \"qty\": " + std::to_string(1 + rng() % 3) + "}";
+    }
+    text += "]}";
+    return *JsonType::parse(text);
+}
+
+/* Part of a value: some object members, some array elements, recursively */
+static void random_part(std::mt19937_64& rng, JsonValue value, std::string& out) {
+    if (value.isObject()) {
+        out += '{';
+        bool first = true;
+        for (uint32_t i = 0; i < value.size(); i++) {
+            if (rng() % 3)
+                continue;
+            out += first ? "" : ",";
+            out += "\"" + std::string(value.keyAt(i)) + "\":";
+            random_part(rng, value.valueAt(i), out);
+            first = false;
+        }
+        out += '}';
+    } else if (value.isArray()) {
+        out += '[';
+        bool first = true;
+        for (uint32_t i = 0; i < value.size(); i++) {
+            if (rng() % 2)
+                continue;
+            out += first ? "" : ",";
+            random_part(rng, value.at(i), out);
+            first = false;
+        }
+        out += ']';
+    } else {
+        out += value.toString();
+    }
+}
+
+/* Query candidates, rechecked when the index says so, against a full scan */
+static bool check_contains(const JsonIndex& index, const Documents& docs, JsonValue query) {
+    std::vector<uint64_t> ids, truth, matched;
+    bool                  exact = index.findContaining(query, ids);
+    for (const auto& [id, doc] : docs) {
+        if (doc.root().contains(query))
+            truth.push_back(id);
+    }
+    CHECK(std::is_sorted(ids.begin(), ids.end()), "candidates ascending");
+    for (uint64_t id : ids) {
+        auto doc = docs.find(id);
+        CHECK(doc != docs.end(), "candidate is an indexed document");
+        if (exact || doc->second.root().contains(query))
+            matched.push_back(id);
+    }
+    CHECK(matched == truth, "containment matches a full scan");
+    return true;
+}
+
+static bool check_equal(const JsonIndex& index, const Documents& docs, const JsonPath& path,
+                        JsonValue value) {
+    std::vector<uint64_t> ids, truth, matched;
+    bool                  exact = index.findEqual(path, value, ids);
+    for (const auto& [id, doc] : docs) {
+        if (doc.root().find(path) == value)
+            truth.push_back(id);
+    }
+    for (uint64_t id : ids) {
+        if (exact || docs.at(id).root().find(path) == value)
+            matched.push_back(id);
+    }
+    CHECK(matched == truth, "path equality matches a full scan");
+    return true;
+}
+
+/* Random queries: parts of indexed documents, and the fixed ones below */
+static bool check_queries(std::mt19937_64& rng, const JsonIndex& index, const Documents& docs,
+                          const std::vector<JsonType>& pool) {
+    static const char* const fixed[] = {
+        R"({"type": "refund"})",
+        R"({"tags": ["a", "c"]})",
+        R"({"owner": {"name": "eve", "age": 22}, "ok": true})",
+        R"({"items": [{"sku": 3, "qty": 2}]})",
+        R"({"items": [{}]})",
+        R"({"tags": []})",
+        R"({})",
+        R"([])",
+        R"({"type": "missing"})",
+        R"({"n": 3.0})",
+    };
+    for (const char* text : fixed) {
+        if (!check_contains(index, docs, JsonType::parse(text)->root()))
+            return false;
+    }
+    for (int q = 0; q < 200; q++) {
+        std::string text;
+        random_part(rng, pool[rng() % pool.size()].root(), text);
+        if (!check_contains(index, docs, JsonType::parse(text)->root()))
+            return false;
+    }
+
+    static const char* const paths[] = {"type", "owner.name", "owner", "items[0].sku", "tags[1]",
+                                        "n"};
+    for (int q = 0; q < 60; q++) {
+        auto            path  = JsonPath::parse(paths[q % 6]);
+        const JsonType& doc   = pool[rng() % pool.size()];
+        JsonValue       value = doc.root().find(*path);
+        auto            other = JsonType::parse("\"nobody\"");
+        if (!check_equal(index, docs, *path, value ? value : other->root()))
+            return false;
+    }
+    return true;
+}
+
+static bool test_lookups() {
+    printf("Testing lookups through merges, removals and updates...\n");
+
+    for (size_t limit : {size_t(0), size_t(4096), monodb::kJsonPendingLimit}) {
+        std::mt19937_64       rng(limit + 1);
+        JsonIndex             index(limit);
+        Documents             docs;
+        std::vector<JsonType> pool;
+
+        /* Ids spread out and inserted partly out of order */
+        std::vector<uint64_t> ids;
+        for (uint64_t i = 0; i < 1500; i++)
+            ids.push_back(i * 3 + 1);
+        std::shuffle(ids.begin() + 1000, ids.end(), rng);
+        for (uint64_t id : ids) {
+            JsonType doc = random_document(rng);
+            index.insert(id, doc.root());
+            pool.push_back(doc);
+            docs.emplace(id, std::move(doc));
+        }
+        if (!check_queries(rng, index, docs, pool))
+            return false;
+
+        /* Remove a third, update another third */
+        for (uint64_t id : ids) {
+            uint64_t action = rng() % 3;
+            if (action == 0) {
+                index.remove(id, docs.at(id).root());
+                docs.erase(id);
+            } else if (action == 1) {
+                JsonType doc = random_document(rng);
+                index.remove(id, docs.at(id).root());
+                index.insert(id, doc.root());
+                docs.at(id) = std::move(doc);
+            }
+        }
+        if (!check_queries(rng, index, docs, pool))
+            return false;
+
+        index.flush();
+        monodb::JsonIndexStats stats = index.stats();
+        CHECK(stats.pending_ids == 0 && stats.pending_bytes == 0 && stats.merges > 0, "merged");
+        if (!check_queries(rng, index, docs, pool))
+            return false;
+
+        /* Every document has the empty key, so the lists hold at least one id per document */
+        CHECK(stats.postings > docs.size() && stats.keys > 30, "posting lists");
+        if (limit == 4096)
+            CHECK(stats.merges > 10, "pending list merged as it fills");
+        if (limit == monodb::kJsonPendingLimit)
+            CHECK(stats.merges == 1, "pending list merged on flush only");
+    }
+    return true;
+}
+
+static bool test_compression() {
+    printf("Testing posting list compression...\n");
+
+    JsonIndex index;
+    auto      doc = JsonType::parse(R"({"kind": "dense"})");
+    for (uint64_t id = 0; id < 100000; id++)
+        index.insert(id * 2, doc->root());
+    index.flush();
+
+    monodb::JsonIndexStats stats = index.stats();
+    CHECK(stats.keys == 2 && stats.postings == 200000, "two dense lists");
+    CHECK(stats.posting_bytes * 8 < stats.postings * sizeof(uint64_t), "lists compress 8x");
+
+    std::vector<uint64_t> ids;
+    CHECK(index.findContaining(doc->root(), ids) && ids.size() == 100000, "dense lookup");
+    CHECK(ids.front() == 0 && ids.back() == 199998, "dense ids");
+
+    /* Appends after a merge extend the last block */
+    index.insert(200000, doc->root());
+    index.flush();
+    CHECK(index.findContaining(doc->root(), ids) && ids.size() == 100001, "appended id");
+    CHECK(ids.back() == 200000, "appended id last");
+
+    /* Removing every id drops the lists */
+    for (uint64_t id = 0; id <= 200000; id += 2)
+        index.remove(id, doc->root());
+    index.flush();
+    CHECK(index.stats().keys == 0 && index.stats().postings == 0, "lists dropped");
+    CHECK(index.findContaining(doc->root(), ids) && ids.empty(), "nothing left");
+    return true;
+}
+
+int main() {
+    printf("MonoDB JsonIndex Test - Starting up...\n");
+
+    if (!test_lookups() || !test_compression())
+        return 1;
+
+    printf("\nJsonIndex test completed successfully\n");
+    return 0;
+}
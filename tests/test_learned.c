@@ -0,0 +1,236 @@
+/**
+ * @file test_learned.c
+ * @brief Tests for the learned index
+ */
+
+#include <monodb/core/data/key.h>
+#include <monodb/core/data/learned.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+#define NUM_KEYS 200000
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Key i of a nearly regular sequence, as timestamps of arriving rows are */
+static uint64_t time_key(uint64_t i, uint64_t* seed) {
+    return 1700000000000ull + i * 1000 + next_random(seed) % 900;
+}
+
+/* Counts the values of a lookup and sums them */
+static bool collect_value(uint64_t value, void* arg) {
+    uint64_t* acc = (uint64_t*)arg;
+    acc[0]++;
+    acc[1] += value;
+    return true;
+}
+
+/* A bulk load finds every key, and no key between them, with few segments */
+static bool test_bulk_load(void) {
+    printf("  bulk load and lookup\n");
+
+    learned_entry_t* entries = (learned_entry_t*)malloc(NUM_KEYS * sizeof(learned_entry_t));
+    CHECK(entries, "allocate entries");
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for (uint64_t i = 0; i < NUM_KEYS; i++)
+        entries[i] = (learned_entry_t){time_key(i, &seed), i};
+
+    /* Loaded out of order, so the load sorts */
+    for (uint64_t i = 0; i < NUM_KEYS; i++) {
+        uint64_t        j   = next_random(&seed) % NUM_KEYS;
+        learned_entry_t tmp = entries[i];
+        entries[i]          = entries[j];
+        entries[j]          = tmp;
+    }
+
+    learned_index_t* index = learned_index_create(0);
+    CHECK(index, "create index");
+    CHECK(learned_index_load(index, entries, NUM_KEYS), "load entries");
+
+    for (uint64_t i = 0; i < NUM_KEYS; i++) {
+        uint64_t value = UINT64_MAX;
+        CHECK(learned_index_get(index, entries[i].key, &value) && value == entries[i].value,
+              "key is found with its value");
+        CHECK(!learned_index_get(index, entries[i].key + 1, NULL), "key between keys is absent");
+    }
+    CHECK(!learned_index_get(index, 0, NULL), "key below the first is not found");
+    CHECK(!learned_index_get(index, UINT64_MAX, NULL), "key above the last is not found");
+
+    learned_stats_t stats;
+    learned_index_get_stats(index, &stats);
+    CHECK(stats.entries == NUM_KEYS && stats.error == LEARNED_DEFAULT_ERROR, "stats count keys");
+    CHECK(stats.segments > 0 && stats.segments < NUM_KEYS / 100, "few segments fit the keys");
+    CHECK(stats.model_memory * 20 < stats.data_memory, "model is small beside the data");
+
+    /* Reloading replaces the contents */
+    learned_entry_t few[3] = {{5, 1}, {9, 2}, {5, 1}};
+    CHECK(learned_index_load(index, few, 3), "reload");
+    learned_index_get_stats(index, &stats);
+    CHECK(stats.entries == 2 && stats.rebuilds == 2, "duplicate entries are loaded once");
+    CHECK(learned_index_get(index, 9, NULL) && !learned_index_get(index, entries[0].key, NULL),
+          "old contents are gone");
+    CHECK(learned_index_load(index, NULL, 0) && !learned_index_get(index, 5, NULL),
+          "empty load");
+
+    learned_index_destroy(index);
+    free(entries);
+    return true;
+}
+
+/* Keys with many values: runs of duplicates longer than the model error */
+static bool test_duplicates(void) {
+    printf("  duplicate keys\n");
+
+    learned_index_t* index   = learned_index_create(4);
+    size_t           count   = 0;
+    learned_entry_t* entries = (learned_entry_t*)malloc(20000 * sizeof(learned_entry_t));
+    CHECK(index && entries, "create index");
+    for (uint64_t k = 0; k < 100; k++) {
+        uint64_t run = k % 10 == 0 ? 1000 : 1 + k % 7;
+        for (uint64_t v = 0; v < run; v++)
+            entries[count++] = (learned_entry_t){k * k, v * 3};
+    }
+    CHECK(learned_index_load(index, entries, count), "load entries");
+
+    for (uint64_t k = 0; k < 100; k++) {
+        uint64_t run = k % 10 == 0 ? 1000 : 1 + k % 7;
+        uint64_t acc[2] = {0, 0}, first = UINT64_MAX;
+        CHECK(learned_index_lookup(index, k * k, collect_value, acc) && acc[0] == run &&
+                  acc[1] == 3 * run * (run - 1) / 2,
+              "lookup visits every value of the key");
+        CHECK(learned_index_get(index, k * k, &first) && first == 0, "get returns the first value");
+        if (k > 1)
+            CHECK(!learned_index_get(index, k * k - 1, NULL), "key between runs is absent");
+    }
+
+    learned_index_destroy(index);
+    free(entries);
+    return true;
+}
+
+/* Inserts and removes go to the deltas, and compaction folds them into the model */
+static bool test_deltas(void) {
+    printf("  inserts, removes and compaction\n");
+
+    learned_index_t* index   = learned_index_create(0);
+    learned_entry_t* entries = (learned_entry_t*)malloc(10000 * sizeof(learned_entry_t));
+    CHECK(index && entries, "create index");
+    for (uint64_t i = 0; i < 10000; i++)
+        entries[i] = (learned_entry_t){i * 10, i};
+    CHECK(learned_index_load(index, entries, 10000), "load entries");
+
+    /* Odd keys are new; every fourth loaded entry goes away */
+    for (uint64_t i = 0; i < 3000; i++)
+        CHECK(learned_index_insert(index, i * 10 + 5, i), "insert entry");
+    CHECK(!learned_index_insert(index, 15, 1), "existing inserted entry is rejected");
+    CHECK(!learned_index_insert(index, 20, 2), "existing loaded entry is rejected");
+    CHECK(learned_index_insert(index, 20, 7), "new value of a loaded key");
+    for (uint64_t i = 0; i < 10000; i += 4)
+        CHECK(learned_index_remove(index, i * 10, i), "remove entry");
+    CHECK(!learned_index_remove(index, 0, 0), "removed entry cannot be removed again");
+    CHECK(!learned_index_remove(index, 30, 9), "absent entry cannot be removed");
+
+    learned_stats_t stats;
+    learned_index_get_stats(index, &stats);
+    CHECK(stats.rebuilds >= 2, "full deltas compact the index");
+    CHECK(stats.entries == 10000 + 3001 - 2500, "entries count both deltas");
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint64_t i = 0; i < 10000; i++) {
+            uint64_t value = 0;
+            bool     found = learned_index_get(index, i * 10, &value);
+            CHECK(found == (i % 4 != 0) && (!found || value == i), "loaded entries");
+            found = learned_index_get(index, i * 10 + 5, &value);
+            CHECK(found == (i < 3000) && (!found || value == i), "inserted entries");
+        }
+        uint64_t acc[2] = {0, 0};
+        CHECK(learned_index_lookup(index, 20, collect_value, acc) && acc[0] == 2 && acc[1] == 9,
+              "values of loaded and inserted entries merge");
+        CHECK(learned_index_compact(index), "compact");
+    }
+
+    /* A removed entry comes back through the delta */
+    CHECK(learned_index_insert(index, 40, 4) && learned_index_get(index, 40, NULL),
+          "removed entry is inserted again");
+    learned_index_get_stats(index, &stats);
+    CHECK(stats.delta == 1, "insert goes to the delta");
+    CHECK(learned_index_remove(index, 40, 4) && !learned_index_get(index, 40, NULL),
+          "inserted entry is removed from the delta");
+
+    /* An empty index takes inserts too */
+    learned_index_t* empty = learned_index_create(1);
+    CHECK(empty && learned_index_insert(empty, 7, 7) && learned_index_get(empty, 7, NULL) &&
+              learned_index_compact(empty) && learned_index_get(empty, 7, NULL),
+          "inserts into an empty index");
+    learned_index_destroy(empty);
+
+    learned_index_destroy(index);
+    free(entries);
+    return true;
+}
+
+/* Counts the tuple IDs of a lookup and sums their slots */
+static bool collect_tid(tuple_id_t tid, void* arg) {
+    uint32_t* counts = (uint32_t*)arg;
+    counts[0]++;
+    counts[1] += tid.slot;
+    return true;
+}
+
+static bool test_index_ops(void) {
+    printf("  secondary index access method\n");
+
+    learned_index_t*   index = learned_index_create(0);
+    const index_ops_t* ops   = &learned_index_ops;
+    CHECK(index, "create index");
+
+    uint8_t  key[8], other[8];
+    uint32_t sum = 0;
+    key_put_i64(key, -5);
+    key_put_i64(other, 5);
+    for (uint16_t i = 0; i < 3000; i++) {
+        CHECK(ops->insert(index, key, 8, (tuple_id_t){i / 100, i}), "insert entry");
+        CHECK(ops->insert(index, other, 8, (tuple_id_t){1, i}), "insert entry");
+        sum += i;
+    }
+    CHECK(!ops->insert(index, key, 8, (tuple_id_t){0, 5}), "same key and tuple ID is rejected");
+    CHECK(!ops->insert(index, key, 4, (tuple_id_t){0, 1}), "keys must be 8 bytes");
+    CHECK(ops->remove(index, key, 8, (tuple_id_t){0, 5}), "remove entry");
+    CHECK(!ops->remove(index, key, 8, (tuple_id_t){9, 6}), "wrong tuple ID is kept");
+
+    uint32_t counts[2] = {0, 0};
+    CHECK(ops->lookup(index, key, 8, collect_tid, counts), "lookup");
+    CHECK(counts[0] == 2999 && counts[1] == sum - 5, "lookup visits exactly the key's entries");
+
+    ops->close(index);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB Learned Index Test - Starting up...\n");
+
+    if (!(test_bulk_load() && test_duplicates() && test_deltas() && test_index_ops()))
+        return 1;
+
+    printf("\nLearned index test completed successfully\n");
+    return 0;
+}
@@ -0,0 +1,336 @@
+/**
+ * @file test_record.c
+ * @brief Tests for the compact row format
+ */
+
+#include <monodb/core/data/record.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+/* id, name, age, active, blob, score, city */
+static const type_id_t columns[] = {TYPE_INT64, TYPE_TEXT,    TYPE_INT32, TYPE_BOOL,
+                                    TYPE_BYTES, TYPE_FLOAT64, TYPE_TEXT};
+#define NUM_COLUMNS 7
+
+static void set_int(record_value_t* v, int64_t i) {
+    memset(v, 0, sizeof(*v));
+    v->i = i;
+}
+
+static void set_bytes(record_value_t* v, const void* data, uint16_t len) {
+    memset(v, 0, sizeof(*v));
+    v->data = data;
+    v->len  = len;
+}
+
+static void fill_row(record_value_t* values, const char* name, const char* city) {
+    set_int(&values[0], -1234567890123ll);
+    set_bytes(&values[1], name, (uint16_t)strlen(name));
+    set_int(&values[2], 42);
+    set_int(&values[3], 1);
+    set_bytes(&values[4], "\0\1\2", 3);
+    memset(&values[5], 0, sizeof(values[5]));
+    values[5].f = 2.5;
+    set_bytes(&values[6], city, (uint16_t)strlen(city));
+}
+
+/* Fixed fields come first at precomputed offsets; variable fields follow their offset table */
+static bool test_layout(const record_layout_t* layout) {
+    printf("  layout\n");
+
+    CHECK(layout->num_columns == NUM_COLUMNS && layout->num_var == 3, "column counts");
+    CHECK(layout->offsets[0] == 1 && layout->offsets[2] == 9 && layout->offsets[3] == 13 &&
+              layout->offsets[5] == 14,
+          "fixed fields follow the bitmap in column order");
+    CHECK(layout->offsets[1] == 0 && layout->offsets[4] == 1 && layout->offsets[6] == 2,
+          "variable fields number their table entries");
+    CHECK(layout->var_table == 22 && layout->var_data == 28, "offset table follows fixed area");
+
+    type_id_t bad = (type_id_t)99;
+    CHECK(!record_layout_create(&bad, 1), "unknown type is rejected");
+    CHECK(!record_layout_create(columns, 0), "empty schema is rejected");
+    return true;
+}
+
+/* Values survive a round trip, and each field is read directly */
+static bool test_round_trip(const record_layout_t* layout) {
+    printf("  encode, decode and field access\n");
+
+    record_value_t values[NUM_COLUMNS], out[NUM_COLUMNS];
+    uint8_t        rec[256];
+    fill_row(values, "Ada Lovelace", "London");
+
+    uint32_t size = record_encoded_size(layout, values);
+    uint16_t len  = record_encode(layout, values, rec, sizeof(rec));
+    CHECK(len > 0 && len == size && len == 28 + 12 + 3 + 6, "encoded size");
+    CHECK(record_encode(layout, values, rec, (uint16_t)(len - 1)) == 0, "short buffer rejected");
+    len = record_encode(layout, values, rec, sizeof(rec));
+
+    CHECK(record_decode(layout, rec, len, out), "decode");
+    CHECK(out[0].i == -1234567890123ll && out[2].i == 42 && out[3].i == 1 && out[5].f == 2.5,
+          "fixed values");
+    CHECK(out[1].len == 12 && memcmp(out[1].data, "Ada Lovelace", 12) == 0 && out[4].len == 3 &&
+              memcmp(out[4].data, "\0\1\2", 3) == 0 && out[6].len == 6 &&
+              memcmp(out[6].data, "London", 6) == 0,
+          "variable values");
+    for (int i = 0; i < NUM_COLUMNS; i++)
+        CHECK(!out[i].is_null, "no field is null");
+
+    /* Direct access reads the last variable field without touching the others */
+    uint16_t    city_len;
+    const void* city = record_get_bytes(layout, rec, 6, &city_len);
+    CHECK(city_len == 6 && memcmp(city, "London", 6) == 0, "last variable field");
+    CHECK(record_get_i64(layout, rec, 0) == -1234567890123ll &&
+              record_get_i32(layout, rec, 2) == 42 && record_get_bool(layout, rec, 3) == 1 &&
+              record_get_f64(layout, rec, 5) == 2.5,
+          "typed accessors");
+
+    /* Fixed fields change in place */
+    record_set_i32(layout, rec, 2, 43);
+    CHECK(record_get_i32(layout, rec, 2) == 43 && record_decode(layout, rec, len, out) &&
+              out[2].i == 43 && out[1].len == 12,
+          "in-place update");
+    return true;
+}
+
+/* Null fields keep their fixed slot, take no variable bytes, and can be set again */
+static bool test_nulls(const record_layout_t* layout) {
+    printf("  null fields\n");
+
+    record_value_t values[NUM_COLUMNS], out[NUM_COLUMNS];
+    uint8_t        rec[256];
+    fill_row(values, "", "Paris");
+    values[0].is_null = true;
+    values[4].is_null = true;
+
+    uint16_t len = record_encode(layout, values, rec, sizeof(rec));
+    CHECK(len == 28 + 5, "null and empty fields take no variable bytes");
+    CHECK(record_decode(layout, rec, len, out), "decode");
+    CHECK(out[0].is_null && out[4].is_null && !out[1].is_null && out[1].len == 0,
+          "null differs from empty");
+    CHECK(record_is_null(rec, 0) && record_is_null(rec, 4) && !record_is_null(rec, 6),
+          "null bitmap");
+    CHECK(out[6].len == 5 && memcmp(out[6].data, "Paris", 5) == 0, "field after a null");
+
+    record_set_i64(layout, rec, 0, 7);
+    CHECK(!record_is_null(rec, 0) && record_get_i64(layout, rec, 0) == 7, "setter clears null");
+    return true;
+}
+
+/* Truncated records and offset tables out of order are rejected */
+static bool test_malformed(const record_layout_t* layout) {
+    printf("  malformed records\n");
+
+    record_value_t values[NUM_COLUMNS], out[NUM_COLUMNS];
+    uint8_t        rec[256];
+    fill_row(values, "Grace", "Arlington");
+    uint16_t len = record_encode(layout, values, rec, sizeof(rec));
+
+    CHECK(record_validate(layout, rec, len), "valid record");
+    CHECK(!record_decode(layout, rec, 20, out), "record shorter than its fixed area");
+    CHECK(!record_validate(layout, rec, (uint16_t)(len - 1)), "field past the end");
+
+    uint16_t end = 29;
+    memcpy(rec + layout->var_table + 2, &end, sizeof(end));
+    CHECK(!record_validate(layout, rec, len), "end offsets out of order");
+
+    /* A row longer than 64 KiB does not encode */
+    char* big = (char*)malloc(UINT16_MAX);
+    CHECK(big, "allocate");
+    memset(big, 'x', UINT16_MAX);
+    fill_row(values, "x", "y");
+    set_bytes(&values[4], big, UINT16_MAX);
+    CHECK(record_encoded_size(layout, values) == 0, "oversized row");
+    free(big);
+    return true;
+}
+
+/* Values get dense codes in first-seen order; a full dictionary hands out none */
+static bool test_dictionary(void) {
+    printf("  string dictionary\n");
+
+    type_dict_t* dict = type_dict_create(3);
+    CHECK(dict && !type_dict_create(0), "create");
+    CHECK(type_dict_encode(dict, "active", 6) == 0 && type_dict_encode(dict, "closed", 6) == 1 &&
+              type_dict_encode(dict, "active", 6) == 0 && type_dict_encode(dict, "", 0) == 2,
+          "codes in first-seen order");
+    CHECK(type_dict_encode(dict, "trial", 5) == TYPE_DICT_NONE && type_dict_count(dict) == 3,
+          "full dictionary adds nothing");
+    CHECK(type_dict_find(dict, "closed", 6) == 1, "find");
+    CHECK(type_dict_find(dict, "close", 5) == TYPE_DICT_NONE, "find absent value");
+
+    uint16_t    len;
+    const void* value = type_dict_value(dict, 1, &len);
+    CHECK(value && len == 6 && memcmp(value, "closed", 6) == 0, "value of a code");
+    CHECK(!type_dict_value(dict, 3, &len), "unknown code");
+
+    /* Serialized values come back with the same codes */
+    uint8_t buf[64];
+    size_t  size = type_dict_serialize(dict, NULL, 0);
+    CHECK(size == 4 + 2 + 6 + 2 + 6 + 2 && type_dict_serialize(dict, buf, sizeof(buf)) == size,
+          "serialize");
+    type_dict_t* copy = type_dict_deserialize(buf, size, 8);
+    CHECK(copy && type_dict_count(copy) == 3 && type_dict_find(copy, "closed", 6) == 1 &&
+              type_dict_encode(copy, "trial", 5) == 3,
+          "deserialize");
+    CHECK(!type_dict_deserialize(buf, size - 1, 8) && !type_dict_deserialize(buf, size, 2),
+          "truncated or oversized input");
+    type_dict_destroy(copy);
+    type_dict_destroy(dict);
+    return true;
+}
+
+/* Dictionary columns store codes, match on them, and spill to inline bytes when full */
+static bool test_dictionary_columns(void) {
+    printf("  dictionary-encoded columns\n");
+
+    type_dict_t* dict       = type_dict_create(2);
+    type_dict_t* dicts[]    = {NULL, dict, NULL, NULL, NULL, NULL, NULL};
+    type_id_t    fixed_id[] = {TYPE_INT64};
+    CHECK(dict && !record_layout_create_dict(fixed_id, dicts + 1, 1), "dictionary on an integer");
+
+    record_layout_t* layout = record_layout_create_dict(columns, dicts, NUM_COLUMNS);
+    CHECK(layout && layout->codes[1] == 9 && layout->offsets[2] == 13 && layout->codes[6] == 0,
+          "code takes a fixed slot");
+
+    record_value_t values[NUM_COLUMNS], out[NUM_COLUMNS];
+    uint8_t        rows[4][256];
+    uint16_t       lens[4];
+    const char*    names[] = {"active", "closed", "active", "trial"};
+    for (int r = 0; r < 4; r++) {
+        fill_row(values, names[r], "Oslo");
+        lens[r] = record_encode(layout, values, rows[r], sizeof(rows[r]));
+        CHECK(lens[r] > 0 && record_validate(layout, rows[r], lens[r]), "encode");
+    }
+    CHECK(lens[0] == layout->var_data + 3 + 4, "coded value takes no variable bytes");
+    CHECK(lens[3] == lens[0] + 5, "value past capacity is stored inline");
+    CHECK(record_get_code(layout, rows[0], 1) == 0 && record_get_code(layout, rows[2], 1) == 0 &&
+              record_get_code(layout, rows[1], 1) == 1 &&
+              record_get_code(layout, rows[3], 1) == TYPE_DICT_NONE,
+          "codes");
+
+    /* Decoding looks the value up; inline values read as before */
+    CHECK(record_decode(layout, rows[1], lens[1], out) && out[1].i == 1 && out[1].len == 6 &&
+              memcmp(out[1].data, "closed", 6) == 0,
+          "decode coded value");
+    CHECK(record_decode(layout, rows[3], lens[3], out) && out[1].len == 5 &&
+              memcmp(out[1].data, "trial", 5) == 0 && out[6].len == 4,
+          "decode inline value");
+
+    record_match_t match;
+    int            hits = 0;
+    record_match_init(layout, 1, "active", 6, &match);
+    for (int r = 0; r < 4; r++)
+        hits += record_match(layout, rows[r], &match);
+    CHECK(match.code == 0 && hits == 2, "match on codes");
+    record_match_init(layout, 1, "trial", 5, &match);
+    CHECK(match.code == TYPE_DICT_NONE && !record_match(layout, rows[0], &match) &&
+              record_match(layout, rows[3], &match),
+          "match inline value");
+    record_match_init(layout, 6, "Oslo", 4, &match);
+    CHECK(record_match(layout, rows[2], &match), "match plain column");
+
+    /* A code the dictionary does not know is rejected */
+    uint32_t bad = 7;
+    memcpy(rows[0] + layout->codes[1], &bad, sizeof(bad));
+    CHECK(!record_validate(layout, rows[0], lens[0]), "unknown code");
+
+    record_layout_destroy(layout);
+    type_dict_destroy(dict);
+    return true;
+}
+
+/* Older rows read added columns as their defaults and move to the new version when rewritten */
+static bool test_added_columns(void) {
+    printf("  added columns and schema versions\n");
+
+    record_schema_t* v0 = record_schema_create(columns, NULL, NUM_COLUMNS);
+    CHECK(v0 && v0->num_versions == 1, "create schema");
+
+    record_value_t values[NUM_COLUMNS + 2], out[NUM_COLUMNS + 2];
+    uint8_t        old_row[256], new_row[256], upgraded[256];
+    fill_row(values, "Ada", "Oslo");
+    uint16_t old_len = record_schema_encode(v0, values, old_row, sizeof(old_row));
+    CHECK(old_len > RECORD_VERSION_SIZE && record_schema_version(old_row) == 0, "encode at v0");
+
+    /* Add a NOT NULL integer with a default, then a text column defaulting to NULL */
+    int32_t          level = 7;
+    record_schema_t* v1    = record_schema_add_column(v0, TYPE_INT32, NULL, &level, 4);
+    CHECK(!record_schema_add_column(v0, TYPE_INT32, NULL, &level, 8), "default of wrong size");
+    record_schema_t* v2 = v1 ? record_schema_add_column(v1, TYPE_TEXT, NULL, NULL, 0) : NULL;
+    CHECK(v2 && v2->num_versions == 3 && record_schema_current(v2)->num_columns == NUM_COLUMNS + 2,
+          "add columns");
+    CHECK(v2->layouts[0]->var_data == v0->layouts[0]->var_data, "old version keeps its layout");
+    record_schema_destroy(v1);
+
+    /* The old row reads the defaults; its own fields are untouched */
+    CHECK(record_schema_decode(v2, old_row, old_len, out), "decode old row");
+    CHECK(out[0].i == -1234567890123ll && out[1].len == 3 && memcmp(out[1].data, "Ada", 3) == 0,
+          "old fields");
+    CHECK(!out[NUM_COLUMNS].is_null && out[NUM_COLUMNS].i == 7 && out[NUM_COLUMNS + 1].is_null,
+          "defaults");
+
+    const void*            rec;
+    uint16_t               rec_len;
+    const record_layout_t* layout = record_schema_layout(v2, old_row, old_len, &rec, &rec_len);
+    CHECK(layout == v2->layouts[0] && record_get_i32(layout, rec, 2) == 42, "old row's layout");
+
+    /* New rows and rewritten old rows carry the current version */
+    set_int(&values[NUM_COLUMNS], 3);
+    set_bytes(&values[NUM_COLUMNS + 1], "gold", 4);
+    uint16_t new_len = record_schema_encode(v2, values, new_row, sizeof(new_row));
+    CHECK(new_len > old_len && record_schema_version(new_row) == 2, "encode at v2");
+    CHECK(record_schema_decode(v2, new_row, new_len, out) && out[NUM_COLUMNS].i == 3 &&
+              out[NUM_COLUMNS + 1].len == 4,
+          "decode new row");
+
+    uint16_t up_len = record_schema_upgrade(v2, old_row, old_len, upgraded, sizeof(upgraded));
+    CHECK(up_len > 0 && record_schema_version(upgraded) == 2, "upgrade old row");
+    layout = record_schema_layout(v2, upgraded, up_len, &rec, &rec_len);
+    CHECK(layout == record_schema_current(v2) && record_get_i32(layout, rec, NUM_COLUMNS) == 7 &&
+              record_is_null(rec, NUM_COLUMNS + 1) && record_get_i32(layout, rec, 2) == 42,
+          "upgraded row holds the defaults");
+
+    /* Rows of versions the schema does not know are refused */
+    CHECK(!record_schema_decode(v0, new_row, new_len, out), "version from the future");
+    CHECK(!record_schema_decode(v2, old_row, 1, out), "short row");
+
+    record_schema_destroy(v0);
+    record_schema_destroy(v2);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB Record Test - Starting up...\n");
+
+    record_layout_t* layout = record_layout_create(columns, NUM_COLUMNS);
+    if (!layout) {
+        fprintf(stderr, "Failed to create a layout\n");
+        return 1;
+    }
+
+    bool ok = test_layout(layout) && test_round_trip(layout) && test_nulls(layout) &&
+              test_malformed(layout) && test_dictionary() && test_dictionary_columns() &&
+              test_added_columns();
+    record_layout_destroy(layout);
+
+    if (!ok)
+        return 1;
+
+    printf("\nRecord test completed successfully\n");
+    return 0;
+}
@@ -0,0 +1,462 @@
+/**
+ * @file test_schema.c
+ * @brief Tests for the snapshot catalog
+ */
+
+#include <monodb/core/catalog/schema.h>
+#include <monodb/core/common/sync.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+#define NUM_READERS   4
+#define STRESS_TABLES 16
+#define STRESS_ROUNDS 2000
+
+static const catalog_column_def_t orders[] = {
+    {"id", TYPE_INT64, false},
+    {"customer", TYPE_TEXT, false},
+    {"total", TYPE_FLOAT64, true},
+};
+
+/* Tables and columns can be created, found and dropped */
+static bool test_ddl(void) {
+    printf("  DDL and lookups\n");
+
+    catalog_t*        catalog = catalog_create();
+    catalog_reader_t* reader  = catalog_reader_open(catalog);
+    CHECK(catalog && reader, "create");
+
+    const catalog_snapshot_t* snapshot = catalog_enter(reader);
+    CHECK(catalog_snapshot_version(snapshot) == 0 && catalog_num_tables(snapshot) == 0, "empty");
+    catalog_leave(reader);
+
+    uint32_t id_orders = 0, id_items = 0;
+    CHECK(catalog_create_table(catalog, "orders", orders, 3, &id_orders), "create orders");
+    CHECK(catalog_create_table(catalog, "items", orders, 2, &id_items), "create items");
+    CHECK(id_orders != 0 && id_items > id_orders, "identifiers");
+
+    snapshot = catalog_enter(reader);
+    CHECK(catalog_snapshot_version(snapshot) == 2 && catalog_num_tables(snapshot) == 2, "tables");
+    const catalog_table_t* table = catalog_find_table(snapshot, "orders");
+    CHECK(table && table->id == id_orders && table->version == 1 && table->num_columns == 3,
+          "find by name");
+    CHECK(catalog_get_table(snapshot, id_items) == catalog_find_table(snapshot, "items"),
+          "find by identifier");
+    CHECK(catalog_table_at(snapshot, 0) == table && !catalog_table_at(snapshot, 2), "positions");
+    const catalog_column_t* column = catalog_find_column(table, "total");
+    CHECK(column && column->ordinal == 2 && column->type == TYPE_FLOAT64 && column->nullable,
+          "find column");
+    CHECK(!catalog_find_column(table, "missing") && !catalog_find_table(snapshot, "missing"),
+          "missing names");
+    catalog_leave(reader);
+
+    /* Names must be valid and unique */
+    char long_name[CATALOG_NAME_MAX + 2];
+    memset(long_name, 'x', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    catalog_column_def_t duplicate[] = {{"a", TYPE_INT32, false}, {"a", TYPE_BOOL, false}};
+    catalog_column_def_t bad_type[]  = {{"a", (type_id_t)TYPE_COUNT, false}};
+    CHECK(!catalog_create_table(catalog, "orders", orders, 3, NULL), "duplicate table");
+    CHECK(!catalog_create_table(catalog, "", orders, 3, NULL), "empty name");
+    CHECK(!catalog_create_table(catalog, long_name, orders, 3, NULL), "long name");
+    CHECK(!catalog_create_table(catalog, "t", duplicate, 2, NULL), "duplicate column");
+    CHECK(!catalog_create_table(catalog, "t", bad_type, 1, NULL), "unknown type");
+    CHECK(!catalog_create_table(catalog, "t", orders, 0, NULL), "no columns");
+
+    CHECK(catalog_rename_table(catalog, "items", "lines"), "rename");
+    CHECK(!catalog_rename_table(catalog, "lines", "orders"), "rename onto a taken name");
+    CHECK(!catalog_rename_table(catalog, "items", "other"), "rename a missing table");
+    CHECK(catalog_drop_table(catalog, "orders"), "drop");
+    CHECK(!catalog_drop_table(catalog, "orders"), "drop twice");
+
+    snapshot = catalog_enter(reader);
+    table    = catalog_find_table(snapshot, "lines");
+    CHECK(catalog_num_tables(snapshot) == 1 && table && table->id == id_items &&
+              table->version == 2 && !catalog_find_table(snapshot, "items"),
+          "renamed table keeps its identifier");
+    CHECK(catalog_find_column(table, "customer"), "renamed table keeps its columns");
+    catalog_leave(reader);
+
+    /* Identifiers are not reused */
+    uint32_t id = 0;
+    CHECK(catalog_create_table(catalog, "orders", orders, 3, &id) && id > id_items, "new id");
+
+    catalog_reader_close(reader);
+    catalog_destroy(catalog);
+    return true;
+}
+
+/* A reader keeps its snapshot across DDL, which is freed once it leaves */
+static bool test_isolation(void) {
+    printf("  snapshot isolation and reclamation\n");
+
+    catalog_t*        catalog = catalog_create();
+    catalog_reader_t* inside  = catalog_reader_open(catalog);
+    catalog_reader_t* other   = catalog_reader_open(catalog);
+    CHECK(catalog && inside && other, "create");
+    CHECK(catalog_create_table(catalog, "orders", orders, 3, NULL), "create orders");
+
+    const catalog_snapshot_t* old   = catalog_enter(inside);
+    const catalog_table_t*    table = catalog_find_table(old, "orders");
+    CHECK(catalog_drop_table(catalog, "orders"), "drop");
+    CHECK(catalog_create_table(catalog, "items", orders, 1, NULL), "create items");
+
+    /* The old snapshot is untouched and still readable */
+    CHECK(catalog_find_table(old, "orders") == table && !catalog_find_table(old, "items"),
+          "old snapshot unchanged");
+    CHECK(strcmp(table->columns[1].name, "customer") == 0, "old table readable");
+
+    const catalog_snapshot_t* now = catalog_enter(other);
+    CHECK(!catalog_find_table(now, "orders") && catalog_find_table(now, "items"), "new snapshot");
+    catalog_leave(other);
+
+    catalog_stats_t stats;
+    catalog_get_stats(catalog, &stats);
+    CHECK(stats.readers == 2 && stats.retired == 2 && stats.reclaimed == 1, "retired, kept");
+
+    catalog_leave(inside);
+    CHECK(catalog_reclaim(catalog) == 2, "reclaimed after leaving");
+    catalog_get_stats(catalog, &stats);
+    CHECK(stats.retired == 0 && stats.reclaimed == 3 && stats.version == 3, "stats");
+
+    /* A reader entering after DDL does not hold back older snapshots */
+    catalog_enter(inside);
+    CHECK(catalog_create_table(catalog, "lines", orders, 2, NULL), "create lines");
+    catalog_get_stats(catalog, &stats);
+    CHECK(stats.retired == 1, "snapshot current at entry kept");
+    catalog_leave(inside);
+    catalog_enter(inside);
+    CHECK(catalog_create_table(catalog, "parts", orders, 2, NULL), "create parts");
+    catalog_get_stats(catalog, &stats);
+    CHECK(stats.retired == 1 && stats.reclaimed == 4, "earlier snapshot freed by DDL");
+    catalog_leave(inside);
+
+    catalog_reader_close(other);
+    catalog_reader_close(inside);
+    catalog_get_stats(catalog, &stats);
+    CHECK(stats.readers == 0, "readers closed");
+    catalog_destroy(catalog);
+    return true;
+}
+
+/* Added columns record their version and default; older snapshots keep the old table */
+static bool test_add_column(void) {
+    printf("  instant ADD COLUMN\n");
+
+    catalog_t*        catalog = catalog_create();
+    catalog_reader_t* reader  = catalog_reader_open(catalog);
+    CHECK(catalog && reader, "create");
+    CHECK(catalog_create_table(catalog, "orders", orders, 3, NULL), "create orders");
+
+    const catalog_snapshot_t* before = catalog_enter(reader);
+    int64_t                   zero   = 0;
+    catalog_column_def_t      status = {"status", TYPE_TEXT, false};
+    catalog_column_def_t      points = {"points", TYPE_INT64, false};
+    catalog_column_def_t      note   = {"note", TYPE_TEXT, true};
+    CHECK(catalog_add_column(catalog, "orders", &status, "new", 3), "add status");
+    CHECK(catalog_add_column(catalog, "orders", &points, &zero, sizeof(zero)), "add points");
+    CHECK(catalog_add_column(catalog, "orders", &note, NULL, 0), "add nullable note");
+
+    CHECK(!catalog_add_column(catalog, "orders", &status, "x", 1), "column name taken");
+    CHECK(!catalog_add_column(catalog, "missing", &note, NULL, 0), "no such table");
+    catalog_column_def_t strict = {"strict", TYPE_INT32, false};
+    CHECK(!catalog_add_column(catalog, "orders", &strict, NULL, 0), "NOT NULL without default");
+    CHECK(!catalog_add_column(catalog, "orders", &strict, &zero, sizeof(zero)),
+          "default of the wrong size");
+
+    /* A reader inside the catalog still sees three columns */
+    CHECK(catalog_find_table(before, "orders")->num_columns == 3, "old snapshot unchanged");
+    catalog_leave(reader);
+
+    const catalog_snapshot_t* after = catalog_enter(reader);
+    const catalog_table_t*    table = catalog_find_table(after, "orders");
+    CHECK(table && table->num_columns == 6 && table->version == 4, "columns added");
+    const catalog_column_t* column = catalog_find_column(table, "status");
+    CHECK(column && column->ordinal == 3 && column->since == 2 && column->default_len == 3 &&
+              memcmp(column->default_data, "new", 3) == 0,
+          "text default");
+    column = catalog_find_column(table, "points");
+    CHECK(column && column->since == 3 && column->default_len == 8, "integer default");
+    column = catalog_find_column(table, "note");
+    CHECK(column && column->since == 4 && !column->default_data && column->nullable,
+          "NULL default");
+    CHECK(catalog_find_column(table, "id")->since == 1, "original columns");
+    catalog_leave(reader);
+
+    catalog_reader_close(reader);
+    catalog_destroy(catalog);
+    return true;
+}
+
+/* Statistics are copied into the catalog and follow the table through DDL */
+static bool test_stats(void) {
+    printf("  planner statistics\n");
+
+    catalog_t*        catalog = catalog_create();
+    catalog_reader_t* reader  = catalog_reader_open(catalog);
+    CHECK(catalog && reader, "create");
+    CHECK(catalog_create_table(catalog, "orders", orders, 3, NULL), "create orders");
+
+    const catalog_snapshot_t* snapshot = catalog_enter(reader);
+    CHECK(!catalog_find_table(snapshot, "orders")->stats, "not analyzed yet");
+    catalog_leave(reader);
+
+    /* Caller buffers go away once the statistics are set */
+    char                   text[2][8] = {"alpha", "omega"};
+    catalog_value_t        bounds[2]  = {{text[0], 5}, {text[1], 5}};
+    double                 freq       = 0.5;
+    uint8_t                hll[16]    = {3, 1};
+    catalog_column_stats_t columns[2] = {
+        {.null_frac = 0.1, .ndv = 1000, .avg_width = 8},
+        {.ndv = 40, .num_mcvs = 1, .mcvs = bounds, .mcv_freqs = &freq, .num_bounds = 2,
+         .bounds = bounds, .hll_size = 16, .hll = hll},
+    };
+    catalog_table_stats_t stats = {.rows = 5000, .pages = 60, .sampled_pages = 60,
+                                   .sampled_rows = 5000, .changes = 7, .num_columns = 2,
+                                   .columns = columns};
+    CHECK(catalog_set_stats(catalog, "orders", &stats), "set stats");
+    memset(text, 'x', sizeof(text));
+    memset(hll, 0, sizeof(hll));
+
+    CHECK(!catalog_set_stats(catalog, "missing", &stats), "no such table");
+    stats.num_columns = 4;
+    CHECK(!catalog_set_stats(catalog, "orders", &stats), "more columns than the table");
+
+    snapshot = catalog_enter(reader);
+    const catalog_table_t*       table = catalog_find_table(snapshot, "orders");
+    const catalog_table_stats_t* got   = table ? table->stats : NULL;
+    CHECK(got && got->rows == 5000 && got->changes == 7 && got->num_columns == 2,
+          "table stats");
+    CHECK(table->version == 1, "stats leave the schema version alone");
+    const catalog_column_stats_t* column = &got->columns[1];
+    CHECK(got->columns[0].null_frac == 0.1 && column->ndv == 40 && column->num_mcvs == 1 &&
+              column->mcv_freqs[0] == 0.5 && column->num_bounds == 2,
+          "column stats");
+    CHECK(memcmp(column->mcvs[0].data, "alpha", 5) == 0 &&
+              memcmp(column->bounds[1].data, "omega", 5) == 0,
+          "values copied");
+    CHECK(column->hll_size == 16 && column->hll[0] == 3 && column->hll[1] == 1, "sketch copied");
+    catalog_leave(reader);
+
+    /* Renaming and adding a column keep them; the old snapshot's copy stays valid */
+    const catalog_snapshot_t* old = catalog_enter(reader);
+    int64_t                   one = 1;
+    catalog_column_def_t      tag = {"tag", TYPE_INT64, false};
+    CHECK(catalog_rename_table(catalog, "orders", "sales"), "rename");
+    CHECK(catalog_add_column(catalog, "sales", &tag, &one, sizeof(one)), "add column");
+    CHECK(catalog_find_table(old, "orders")->stats->rows == 5000, "old snapshot");
+    catalog_leave(reader);
+
+    snapshot = catalog_enter(reader);
+    table    = catalog_find_table(snapshot, "sales");
+    CHECK(table && table->stats && table->stats->rows == 5000 &&
+              memcmp(table->stats->columns[1].bounds[0].data, "alpha", 5) == 0,
+          "stats follow the table");
+    catalog_leave(reader);
+
+    catalog_reader_close(reader);
+    catalog_destroy(catalog);
+    return true;
+}
+
+/* Recovery passes its context; the catalog is its database instance */
+static bool redo_record(wal_record_header_t* header, void* data, void* arg) {
+    wal_recovery_context_t* recovery = (wal_recovery_context_t*)arg;
+    return catalog_redo((catalog_t*)recovery->db_instance, header, data);
+}
+
+/* Logged DDL replays into an empty catalog */
+static bool test_wal_redo(void) {
+    printf("  WAL logging and redo of DDL\n");
+
+    const char* wal_dir = "./test_schema_wal";
+    remove("./test_schema_wal/000000000000000000000001");
+
+    wal_context_t* wal     = wal_init(wal_dir, 0);
+    catalog_t*     catalog = wal ? catalog_create() : NULL;
+    CHECK(catalog, "create catalog and WAL");
+    catalog_set_wal(catalog, wal);
+
+    double               flag = 1.5;
+    catalog_column_def_t rate = {"rate", TYPE_FLOAT64, false};
+    catalog_column_def_t tag  = {"tag", TYPE_BYTES, true};
+    CHECK(catalog_create_table(catalog, "orders", orders, 3, NULL) &&
+              catalog_create_table(catalog, "items", orders, 2, NULL) &&
+              catalog_create_table(catalog, "scratch", orders, 1, NULL),
+          "create tables");
+    CHECK(catalog_add_column(catalog, "orders", &rate, &flag, sizeof(flag)) &&
+              catalog_add_column(catalog, "items", &tag, "\0\1", 2) &&
+              catalog_rename_table(catalog, "items", "lines") &&
+              catalog_drop_table(catalog, "scratch"),
+          "change tables");
+    CHECK(wal_flush(wal, true), "flush");
+    catalog_destroy(catalog);
+
+    catalog_t* recovered = catalog_create();
+    CHECK(recovered, "create recovered catalog");
+    wal_recovery_context_t recovery;
+    memset(&recovery, 0, sizeof(recovery));
+    recovery.db_instance = recovered;
+    bool ok = wal_perform_recovery(wal, (wal_location_t){0, 0}, redo_record, &recovery);
+    wal_shutdown(wal);
+    CHECK(ok, "redo the WAL");
+
+    catalog_reader_t*         reader   = catalog_reader_open(recovered);
+    const catalog_snapshot_t* snapshot = catalog_enter(reader);
+    const catalog_table_t*    orders_t = catalog_find_table(snapshot, "orders");
+    const catalog_table_t*    lines    = catalog_find_table(snapshot, "lines");
+    CHECK(catalog_snapshot_version(snapshot) == 7 && catalog_num_tables(snapshot) == 2,
+          "every statement replayed");
+    CHECK(orders_t && orders_t->id == 1 && orders_t->num_columns == 4 && lines && lines->id == 2,
+          "tables keep their identifiers");
+    const catalog_column_t* column = catalog_find_column(orders_t, "rate");
+    double                  value  = 0;
+    if (column && column->default_data)
+        memcpy(&value, column->default_data, sizeof(value));
+    CHECK(column && column->since == 2 && !column->nullable && value == 1.5, "double default");
+    column = catalog_find_column(lines, "tag");
+    CHECK(column && column->default_len == 2 && memcmp(column->default_data, "\0\1", 2) == 0,
+          "bytes default");
+    CHECK(!catalog_find_table(snapshot, "scratch") && !catalog_get_table(snapshot, 3),
+          "dropped table stays dropped");
+    catalog_leave(reader);
+
+    /* Identifiers continue after the replayed ones */
+    uint32_t id = 0;
+    CHECK(catalog_create_table(recovered, "scratch", orders, 1, &id) && id == 4, "next id");
+
+    /* A record for a table that does not exist does not apply */
+    uint8_t             bad[9] = {2, 0, 0, 0, 99, 0, 0, 0, 0};
+    wal_record_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.type     = WAL_RECORD_SCHEMA;
+    header.data_len = sizeof(bad);
+    CHECK(!catalog_redo(recovered, &header, bad), "drop of an unknown table");
+    header.data_len = 3;
+    CHECK(!catalog_redo(recovered, &header, bad), "truncated record");
+
+    catalog_reader_close(reader);
+    catalog_destroy(recovered);
+    return true;
+}
+
+typedef struct {
+    catalog_t*   catalog;
+    atomic_bool* stop;
+    uint64_t     lookups;
+    bool         ok;
+} stress_reader_t;
+
+/* Look tables up while DDL runs; every table seen must be consistent */
+static void* stress_read(void* arg) {
+    stress_reader_t*  ctx    = (stress_reader_t*)arg;
+    catalog_reader_t* reader = catalog_reader_open(ctx->catalog);
+    ctx->ok                  = reader != NULL;
+    uint64_t last_version    = 0;
+    while (ctx->ok && !atomic_load(ctx->stop)) {
+        const catalog_snapshot_t* snapshot = catalog_enter(reader);
+        uint64_t                  version  = catalog_snapshot_version(snapshot);
+        ctx->ok                            = version >= last_version;
+        last_version                       = version;
+        for (uint32_t t = 0; ctx->ok && t < STRESS_TABLES; t++) {
+            char name[16];
+            snprintf(name, sizeof(name), "t%u", t);
+            const catalog_table_t* table = catalog_find_table(snapshot, name);
+            if (!table)
+                continue;
+            /* Table t has t % 4 + 1 columns named c0, c1, ... */
+            const catalog_column_t* column = catalog_find_column(table, "c0");
+            ctx->ok = strcmp(table->name, name) == 0 && table->num_columns == t % 4 + 1 &&
+                      column && column->ordinal == 0 &&
+                      catalog_get_table(snapshot, table->id) == table;
+            ctx->lookups++;
+        }
+        catalog_leave(reader);
+    }
+    catalog_reader_close(reader);
+    return NULL;
+}
+
+/* Readers and DDL run concurrently; every replaced snapshot is freed in the end */
+static bool test_concurrent(void) {
+    printf("  concurrent readers and DDL\n");
+
+    catalog_t* catalog = catalog_create();
+    CHECK(catalog, "create");
+    catalog_column_def_t columns[4] = {{"c0", TYPE_INT64, false},
+                                       {"c1", TYPE_TEXT, true},
+                                       {"c2", TYPE_INT32, false},
+                                       {"c3", TYPE_BYTES, true}};
+
+    atomic_bool     stop = false;
+    stress_reader_t readers[NUM_READERS];
+    sync_thread_t   threads[NUM_READERS];
+    for (int i = 0; i < NUM_READERS; i++) {
+        readers[i] = (stress_reader_t){catalog, &stop, 0, true};
+        CHECK(sync_thread_create(&threads[i], stress_read, &readers[i]), "start reader");
+    }
+
+    /* Create, rename back and forth and drop tables */
+    uint64_t ddl = 0;
+    bool     ok  = true;
+    for (uint32_t round = 0; ok && round < STRESS_ROUNDS; round++) {
+        uint32_t t = round % STRESS_TABLES;
+        char     name[16], moved[16];
+        snprintf(name, sizeof(name), "t%u", t);
+        snprintf(moved, sizeof(moved), "moved%u", t);
+        if (round / STRESS_TABLES % 2 == 0) {
+            ok = catalog_create_table(catalog, name, columns, (uint16_t)(t % 4 + 1), NULL) &&
+                 catalog_rename_table(catalog, name, moved) &&
+                 catalog_rename_table(catalog, moved, name);
+            ddl += 3;
+        } else {
+            ok = catalog_drop_table(catalog, name);
+            ddl++;
+        }
+    }
+    atomic_store(&stop, true);
+    for (int i = 0; i < NUM_READERS; i++)
+        sync_thread_join(threads[i]);
+    CHECK(ok, "DDL");
+
+    uint64_t lookups = 0;
+    for (int i = 0; i < NUM_READERS; i++) {
+        CHECK(readers[i].ok, "readers see consistent snapshots");
+        lookups += readers[i].lookups;
+    }
+    printf("    %llu DDL statements, %llu lookups\n", (unsigned long long)ddl,
+           (unsigned long long)lookups);
+
+    catalog_stats_t stats;
+    catalog_reclaim(catalog);
+    catalog_get_stats(catalog, &stats);
+    CHECK(stats.version == ddl && stats.retired == 0 && stats.reclaimed == ddl,
+          "every replaced snapshot freed");
+    catalog_destroy(catalog);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB Schema Test - Starting up...\n");
+
+    if (!test_ddl() || !test_isolation() || !test_add_column() || !test_stats() ||
+        !test_wal_redo() || !test_concurrent())
+        return 1;
+
+    printf("\nSchema test completed successfully\n");
+    return 0;
+}
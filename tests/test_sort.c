@@ -0,0 +1,131 @@
+/**
+ * @file test_sort.c
+ * @brief Tests for the external merge sort
+ */
+
+#include <monodb/core/data/sort.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+/* Enough records of a few dozen bytes to fill many minimum-size buffers */
+#define NUM_RECORDS 200000
+
+/* Key of record i: "key-" and a zero-padded number, without padding for some */
+static uint16_t record_key(char* key, uint32_t i) {
+    return (uint16_t)snprintf(key, 32, i % 5 == 0 ? "key-%u" : "key-%08u", i);
+}
+
+/* Records added in scrambled order come back in key order, each exactly once */
+static bool test_order(uint32_t workers, size_t memory, bool spills) {
+    printf("  %u workers, %s\n", workers, spills ? "spilling runs" : "in memory");
+
+    const char* prefix = "./test_sort";
+    sort_t*     sort   = sort_begin(prefix, memory, workers);
+    CHECK(sort, "begin sort");
+
+    char key[32];
+    for (uint32_t i = 0; i < NUM_RECORDS; i++) {
+        uint32_t n = (uint32_t)(((uint64_t)i * 7919u) % NUM_RECORDS);
+        CHECK(sort_add(sort, key, record_key(key, n), &n, sizeof(n)), "add record");
+    }
+    CHECK(sort_finish(sort), "finish sort");
+    CHECK(!sort_add(sort, key, 1, NULL, 0), "no records after finishing");
+
+    sort_stats_t stats;
+    sort_get_stats(sort, &stats);
+    CHECK(stats.records == NUM_RECORDS, "records are counted");
+    CHECK(spills ? stats.runs > 1 && stats.spilled_bytes > 0 : stats.runs == 0,
+          "runs are spilled only when memory runs out");
+
+    const void* k;
+    const void* value;
+    uint16_t    key_len, value_len;
+    char        last[32];
+    uint16_t    last_len = 0;
+    uint32_t    count    = 0;
+    uint8_t*    seen     = (uint8_t*)calloc(NUM_RECORDS, 1);
+    CHECK(seen, "allocate seen flags");
+    while (sort_next(sort, &k, &key_len, &value, &value_len)) {
+        uint16_t min = last_len < key_len ? last_len : key_len;
+        int      cmp = memcmp(last, k, min);
+        CHECK(count == 0 || cmp < 0 || (cmp == 0 && last_len < key_len),
+              "records come back in key order");
+
+        uint32_t n;
+        CHECK(value_len == sizeof(n), "value length is kept");
+        memcpy(&n, value, sizeof(n));
+        CHECK(n < NUM_RECORDS && !seen[n] && key_len == record_key(key, n) &&
+                  memcmp(k, key, key_len) == 0,
+              "each record comes back once with its value");
+        seen[n] = 1;
+        memcpy(last, k, key_len);
+        last_len = key_len;
+        count++;
+    }
+    free(seen);
+    CHECK(count == NUM_RECORDS && !sort_failed(sort), "every record comes back");
+
+    sort_end(sort);
+    FILE* run = fopen("./test_sort.run0", "rb");
+    if (run)
+        fclose(run);
+    CHECK(!run, "run files are removed");
+    return true;
+}
+
+/* Equal keys are ordered by value; an empty sort returns nothing */
+static bool test_ties(void) {
+    printf("  equal keys and empty sorts\n");
+
+    sort_t* sort = sort_begin("./test_sort", 0, 0);
+    CHECK(sort, "begin sort");
+    CHECK(sort_add(sort, "k", 1, "b", 1) && sort_add(sort, "k", 1, "ab", 2) &&
+              sort_add(sort, "k", 1, "a", 1) && sort_add(sort, "", 0, NULL, 0),
+          "add records");
+    CHECK(sort_finish(sort), "finish sort");
+
+    static const char* expected[] = {"", "a", "ab", "b"};
+    const void*        k;
+    const void*        value;
+    uint16_t           key_len, value_len;
+    for (size_t i = 0; i < 4; i++) {
+        CHECK(sort_next(sort, &k, &key_len, &value, &value_len), "next record");
+        CHECK(value_len == strlen(expected[i]) && memcmp(value, expected[i], value_len) == 0,
+              "empty key first, then values in order");
+    }
+    CHECK(!sort_next(sort, &k, &key_len, &value, &value_len), "sort is exhausted");
+    sort_end(sort);
+
+    sort = sort_begin("./test_sort", 0, 2);
+    CHECK(sort && sort_finish(sort), "finish an empty sort");
+    CHECK(!sort_next(sort, &k, &key_len, &value, &value_len), "empty sort returns nothing");
+    sort_end(sort);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB Sort Test - Starting up...\n");
+
+    bool ok = test_order(0, 64u * 1024 * 1024, false) && test_order(0, SORT_MIN_MEMORY, true) &&
+              test_order(2, SORT_MIN_MEMORY * 3, true) && test_ties();
+
+    if (!ok)
+        return 1;
+
+    printf("\nSort test completed successfully\n");
+    return 0;
+}
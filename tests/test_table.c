@@ -0,0 +1,1133 @@
+/**
+ * @file test_table.c
+ * @brief Tests for tables: index maintenance across HOT updates, index-organized tables,
+ *        sorted and concurrent index builds, covering and partial indexes,
+ *        tiering of cold rows, index usage statistics and advice
+ */
+
+#include <monodb/core/common/sync.h>
+#include <monodb/core/data/key.h>
+#include <monodb/core/data/table.h>
+#include <monodb/core/storage/buffer.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+#define NUM_ROWS    200
+#define MAX_ENTRIES 1024
+
+/**
+ * Test row: indexed id plus an unindexed counter
+ */
+typedef struct {
+    uint32_t id;
+    uint32_t counter;
+    char     filler[56];
+} test_row_t;
+
+/**
+ * Unordered in-memory index used as the access method under test
+ */
+typedef struct {
+    uint32_t   keys[MAX_ENTRIES];
+    tuple_id_t tids[MAX_ENTRIES];
+    uint32_t   count;
+} mock_index_t;
+
+static bool same_tid(tuple_id_t a, tuple_id_t b) {
+    return a.page_id == b.page_id && a.slot == b.slot;
+}
+
+static bool mock_insert(void* state, const void* key, uint16_t key_len, tuple_id_t tid) {
+    mock_index_t* index = (mock_index_t*)state;
+    if (key_len != sizeof(uint32_t) || index->count >= MAX_ENTRIES)
+        return false;
+    memcpy(&index->keys[index->count], key, sizeof(uint32_t));
+    index->tids[index->count++] = tid;
+    return true;
+}
+
+static bool mock_remove(void* state, const void* key, uint16_t key_len, tuple_id_t tid) {
+    mock_index_t* index = (mock_index_t*)state;
+    uint32_t      k;
+    if (key_len != sizeof(uint32_t))
+        return false;
+    memcpy(&k, key, sizeof(k));
+    for (uint32_t i = 0; i < index->count; i++) {
+        if (index->keys[i] == k && same_tid(index->tids[i], tid)) {
+            index->keys[i] = index->keys[--index->count];
+            index->tids[i] = index->tids[index->count];
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool mock_lookup(void* state, const void* key, uint16_t key_len, index_visit_fn visit,
+                        void* arg) {
+    mock_index_t* index = (mock_index_t*)state;
+    uint32_t      k;
+    if (key_len != sizeof(uint32_t))
+        return false;
+    memcpy(&k, key, sizeof(k));
+    for (uint32_t i = 0; i < index->count; i++) {
+        if (index->keys[i] == k && !visit(index->tids[i], arg))
+            break;
+    }
+    return true;
+}
+
+static const index_ops_t mock_ops = {mock_insert, mock_remove, mock_lookup, NULL, NULL, NULL};
+
+static bool id_key(const void* tuple, uint16_t len, void* key, uint16_t* key_len, void* arg) {
+    (void)arg;
+    if (len < sizeof(test_row_t))
+        return false;
+    memcpy(key, &((const test_row_t*)tuple)->id, sizeof(uint32_t));
+    *key_len = sizeof(uint32_t);
+    return true;
+}
+
+static bool collect_row(tuple_id_t tid, const void* data, uint16_t len, void* arg) {
+    (void)tid;
+    (void)len;
+    memcpy(arg, data, sizeof(test_row_t));
+    return false;
+}
+
+/* Look a row up by id; returns false if no live row has the id */
+/* The id as an 8-byte key, the width learned indexes take */
+static bool wide_id_key(const void* tuple, uint16_t len, void* key, uint16_t* key_len, void* arg) {
+    (void)arg;
+    if (len < sizeof(test_row_t))
+        return false;
+    *key_len = key_put_u64((uint8_t*)key, ((const test_row_t*)tuple)->id);
+    return true;
+}
+
+static bool find_row(table_t* table, index_t* index, uint32_t id, test_row_t* row) {
+    row->id = UINT32_MAX;
+    table_index_lookup(table, index, &id, sizeof(id), collect_row, row);
+    return row->id == id;
+}
+
+static tuple_id_t tids[NUM_ROWS];
+
+/* Rows inserted before and after the index is attached are both indexed */
+static bool test_build_and_insert(table_t* table, mock_index_t* mock, index_t** index) {
+    printf("  index build and insert\n");
+
+    for (uint32_t i = 0; i < NUM_ROWS; i++) {
+        test_row_t row = {i, 0, {0}};
+        if (i == NUM_ROWS / 2) {
+            *index = index_create("rows_id", &mock_ops, mock, id_key, NULL);
+            CHECK(*index && table_add_index(table, *index), "attach index");
+        }
+        CHECK(table_insert(table, &row, sizeof(row), 1, &tids[i]), "insert row");
+    }
+
+    CHECK(mock->count == NUM_ROWS, "every row has an entry");
+    CHECK(table_find_index(table, "rows_id") == *index, "index found by name");
+
+    test_row_t row;
+    CHECK(find_row(table, *index, 7, &row) && row.counter == 0, "lookup early row");
+    CHECK(find_row(table, *index, NUM_ROWS - 1, &row), "lookup late row");
+    return true;
+}
+
+/* Counter updates are heap-only and leave the index alone */
+static bool test_hot_updates(table_t* table, mock_index_t* mock, index_t* index) {
+    printf("  counter updates skip the index\n");
+
+    index_stats_t before, after;
+    index_get_stats(index, &before);
+
+    for (uint32_t round = 1; round <= 50; round++) {
+        for (uint32_t i = 0; i < NUM_ROWS; i += 4) {
+            test_row_t row = {i, round, {0}};
+            tuple_id_t new_tid;
+            CHECK(table_update(table, tids[i], &row, sizeof(row), 1 + round, &new_tid),
+                  "update counter");
+            CHECK(same_tid(new_tid, tids[i]), "row keeps its address");
+        }
+    }
+
+    index_get_stats(index, &after);
+    CHECK(after.inserts == before.inserts && after.removes == before.removes,
+          "no index writes for HOT updates");
+    CHECK(mock->count == NUM_ROWS, "index is unchanged");
+
+    table_stats_t stats;
+    table_get_stats(table, &stats);
+    CHECK(stats.hot_updates == stats.updates, "every counter update was HOT");
+
+    test_row_t row;
+    CHECK(find_row(table, index, 8, &row) && row.counter == 50, "lookup sees newest version");
+    return true;
+}
+
+/* Changing the indexed column or disabling HOT repoints the index */
+static bool test_cold_updates(table_t* table, mock_index_t* mock, index_t* index) {
+    printf("  key updates and deletes maintain the index\n");
+
+    test_row_t row = {NUM_ROWS + 1, 0, {0}};
+    tuple_id_t moved;
+    CHECK(table_update(table, tids[3], &row, sizeof(row), 100, &moved), "update key");
+    CHECK(!same_tid(moved, tids[3]), "key update moves the row");
+    CHECK(!find_row(table, index, 3, &row), "old key is gone");
+    CHECK(find_row(table, index, NUM_ROWS + 1, &row), "new key is found");
+    CHECK(mock->count == NUM_ROWS, "entry was replaced, not added");
+
+    table_set_hot_updates(table, false);
+    row = (test_row_t){5, 99, {0}};
+    CHECK(table_update(table, tids[5], &row, sizeof(row), 101, &moved), "update with HOT off");
+    CHECK(!same_tid(moved, tids[5]), "row moves when HOT is disabled");
+    CHECK(find_row(table, index, 5, &row) && row.counter == 99, "lookup after regular update");
+    table_set_hot_updates(table, true);
+
+    CHECK(table_delete(table, moved, 102), "delete row");
+    CHECK(!find_row(table, index, 5, &row), "deleted row is not found");
+    CHECK(!table_delete(table, moved, 103), "double delete fails");
+    CHECK(mock->count == NUM_ROWS - 1, "entry of deleted row is removed");
+    return true;
+}
+
+/* Big-endian id so key order matches numeric order */
+static bool pk_key(const void* tuple, uint16_t len, void* key, uint16_t* key_len, void* arg) {
+    (void)arg;
+    if (len < sizeof(test_row_t))
+        return false;
+    uint32_t id = ((const test_row_t*)tuple)->id;
+    uint8_t* k  = (uint8_t*)key;
+    k[0]        = (uint8_t)(id >> 24);
+    k[1]        = (uint8_t)(id >> 16);
+    k[2]        = (uint8_t)(id >> 8);
+    k[3]        = (uint8_t)id;
+    *key_len    = 4;
+    return true;
+}
+
+static bool counter_key(const void* tuple, uint16_t len, void* key, uint16_t* key_len,
+                        void* arg) {
+    (void)arg;
+    if (len < sizeof(test_row_t))
+        return false;
+    memcpy(key, &((const test_row_t*)tuple)->counter, sizeof(uint32_t));
+    *key_len = sizeof(uint32_t);
+    return true;
+}
+
+typedef struct {
+    uint32_t count;
+    uint32_t last_id;
+    bool     ordered;
+} scan_state_t;
+
+static bool check_order(tuple_id_t tid, const void* data, uint16_t len, void* arg) {
+    (void)tid;
+    (void)len;
+    scan_state_t*     state = (scan_state_t*)arg;
+    const test_row_t* row   = (const test_row_t*)data;
+    if (state->count > 0 && row->id <= state->last_id)
+        state->ordered = false;
+    state->last_id = row->id;
+    state->count++;
+    return true;
+}
+
+/* Rows live in the primary tree; secondaries resolve through primary keys */
+static bool test_clustered(buffer_pool_t* pool) {
+    printf("  index-organized table\n");
+
+    const char* path = "./test_table_iot.db";
+    remove(path);
+    remove("./test_table_iot.db.by_counter");
+
+    table_t* table = table_open_clustered(pool, path, pk_key, NULL);
+    CHECK(table && table_is_clustered(table) && !table_heap(table), "open clustered table");
+
+    /* Reverse order, so storage order only matches key order if the tree sorts */
+    for (uint32_t i = 2000; i-- > 0;) {
+        test_row_t row = {i, i % 10, {0}};
+        CHECK(table_insert(table, &row, sizeof(row), 1, NULL), "insert row");
+    }
+    test_row_t dup = {7, 0, {0}};
+    CHECK(!table_insert(table, &dup, sizeof(dup), 1, NULL), "duplicate primary key is rejected");
+    CHECK(table_create_index(table, "by_counter", counter_key, NULL), "create secondary index");
+
+    uint8_t      lo[4] = {0, 0, 0x01, 0x00}, hi[4] = {0, 0, 0x02, 0x00};
+    scan_state_t state = {0, 0, true};
+    CHECK(table_range_scan(table, lo, 4, hi, 4, check_order, &state), "range scan");
+    CHECK(state.count == 256 && state.ordered && state.last_id == 0x1FF,
+          "range scan returns the key range in order");
+
+    uint32_t counter = 3;
+    state            = (scan_state_t){0, 0, true};
+    CHECK(table_lookup(table, "by_counter", &counter, sizeof(counter), check_order, &state),
+          "secondary lookup");
+    CHECK(state.count == 200, "secondary lookup finds every row");
+
+    /* Changing the primary key moves the row; its secondary entry follows */
+    test_row_t row = {5000, 3, {0}};
+    uint8_t    pk[4];
+    uint16_t   pk_len;
+    pk_key(&(test_row_t){3, 0, {0}}, sizeof(test_row_t), pk, &pk_len, NULL);
+    CHECK(table_update_key(table, pk, pk_len, &row, sizeof(row), 2), "update primary key");
+    CHECK(!table_fetch_key(table, pk, pk_len, NULL, 0, NULL), "old key is gone");
+    state = (scan_state_t){0, 0, true};
+    table_lookup(table, "by_counter", &counter, sizeof(counter), check_order, &state);
+    CHECK(state.count == 200 && state.last_id == 5000, "secondary entry points at the new key");
+
+    pk_key(&row, sizeof(row), pk, &pk_len, NULL);
+    CHECK(table_delete_key(table, pk, pk_len, 3), "delete row");
+    state = (scan_state_t){0, 0, true};
+    table_lookup(table, "by_counter", &counter, sizeof(counter), check_order, &state);
+    CHECK(state.count == 199, "deleted row leaves the secondary index");
+
+    CHECK(!table_update(table, INVALID_TUPLE_ID, &row, sizeof(row), 4, NULL),
+          "tuple-ID updates are refused");
+
+    table_close(table);
+    remove(path);
+    remove("./test_table_iot.db.by_counter");
+    return true;
+}
+
+static bool count_row(tuple_id_t tid, const void* data, uint16_t len, void* arg) {
+    (void)tid;
+    (void)data;
+    (void)len;
+    (*(uint32_t*)arg)++;
+    return true;
+}
+
+/* Indexes created over existing rows are sorted and bulk loaded, then maintained as usual */
+static bool test_sorted_build(buffer_pool_t* pool) {
+    printf("  sorted index build\n");
+
+    const char* path = "./test_table_build.db";
+    remove(path);
+    remove("./test_table_build.db.by_id");
+    remove("./test_table_build.db.by_counter");
+
+    table_t* table = table_open(pool, path);
+    CHECK(table, "open table");
+
+    /* Two rows per id, inserted in scrambled order */
+    for (uint32_t i = 0; i < NUM_ROWS * 20; i++) {
+        test_row_t row = {(i * 7919u) % (NUM_ROWS * 10), i, {0}};
+        CHECK(table_insert(table, &row, sizeof(row), 1, NULL), "insert row");
+    }
+    CHECK(table_create_index(table, "by_id", id_key, NULL), "build index");
+    CHECK(!table_create_index(table, "by_id", id_key, NULL), "index names stay unique");
+
+    table_stats_t stats;
+    table_get_stats(table, &stats);
+    CHECK(stats.index_loaded == NUM_ROWS * 20, "entries are bulk loaded");
+
+    for (uint32_t id = 0; id < NUM_ROWS * 10; id++) {
+        uint32_t count = 0;
+        CHECK(table_lookup(table, "by_id", &id, sizeof(id), count_row, &count) && count == 2,
+              "lookup finds both rows of an id");
+    }
+
+    /* The built index takes inserts like any other */
+    test_row_t row = {NUM_ROWS * 10, 0, {0}};
+    CHECK(table_insert(table, &row, sizeof(row), 2, NULL), "insert after the build");
+    uint32_t id    = NUM_ROWS * 10;
+    uint32_t count = 0;
+    CHECK(table_lookup(table, "by_id", &id, sizeof(id), count_row, &count) && count == 1,
+          "lookup finds the new row");
+
+    table_set_index_fillfactor(table, 50);
+    CHECK(table_create_index(table, "by_counter", counter_key, NULL), "build sparse index");
+    table_get_stats(table, &stats);
+    CHECK(stats.index_loaded == NUM_ROWS * 40 + 1, "second index is bulk loaded");
+    uint32_t counter = 17;
+    count            = 0;
+    CHECK(table_lookup(table, "by_counter", &counter, sizeof(counter), count_row, &count) &&
+              count == 1,
+          "lookup in the sparse index");
+
+    table_close(table);
+    remove(path);
+    remove("./test_table_build.db.by_id");
+    remove("./test_table_build.db.by_counter");
+    return true;
+}
+
+/*
+ * Every access method serves lookups and follows updates; ART and learned
+ * indexes are rebuilt on open
+ */
+static bool test_index_methods(buffer_pool_t* pool) {
+    printf("  index access methods\n");
+
+    const char* path = "./test_table_methods.db";
+    remove(path);
+    remove("./test_table_methods.db.by_counter");
+
+    table_t* table = table_open(pool, path);
+    CHECK(table, "open table");
+    for (uint32_t i = 0; i < NUM_ROWS * 10; i++) {
+        test_row_t row = {i, i % 50, {0}};
+        CHECK(table_insert(table, &row, sizeof(row), 1, &tids[i % NUM_ROWS]), "insert row");
+    }
+    CHECK(table_create_index_using(table, "by_id", TABLE_INDEX_ART, id_key, NULL),
+          "create ART index");
+    CHECK(table_create_index_using(table, "by_counter", TABLE_INDEX_HASH, counter_key, NULL),
+          "create hash index");
+    CHECK(table_create_index_using(table, "by_wide_id", TABLE_INDEX_LEARNED, wide_id_key, NULL),
+          "create learned index");
+    CHECK(!table_create_index_using(table, "by_id", TABLE_INDEX_HASH, id_key, NULL),
+          "index names stay unique across methods");
+    CHECK(!table_create_index_using(table, "by_short_id", TABLE_INDEX_LEARNED, id_key, NULL),
+          "learned indexes take 8-byte keys only");
+
+    test_row_t row;
+    uint32_t   count = 0, counter = 7;
+    CHECK(find_row(table, table_find_index(table, "by_id"), 1234, &row) && row.counter == 34,
+          "ART lookup");
+    CHECK(table_lookup(table, "by_counter", &counter, sizeof(counter), count_row, &count) &&
+              count == NUM_ROWS / 5,
+          "hash lookup");
+
+    /* The last rows inserted move to a new counter, and both indexes follow */
+    for (uint32_t i = 0; i < NUM_ROWS; i++) {
+        test_row_t moved = {NUM_ROWS * 9 + i, 1000, {0}};
+        CHECK(table_update(table, tids[i], &moved, sizeof(moved), 2, NULL), "update row");
+    }
+    counter = 1000;
+    count   = 0;
+    CHECK(table_lookup(table, "by_counter", &counter, sizeof(counter), count_row, &count) &&
+              count == NUM_ROWS,
+          "hash index follows updates");
+    CHECK(find_row(table, table_find_index(table, "by_id"), NUM_ROWS * 9, &row) &&
+              row.counter == 1000,
+          "ART index follows updates");
+    for (uint32_t i = 0; i < NUM_ROWS * 10; i += 7) {
+        uint8_t key[8];
+        count = 0;
+        key_put_u64(key, i);
+        CHECK(table_lookup(table, "by_wide_id", key, sizeof(key), count_row, &count) &&
+                  count == 1,
+              "learned index follows updates");
+    }
+
+    /* After a reopen the ART index is built again from the rows */
+    table_close(table);
+    table = table_open(pool, path);
+    CHECK(table, "reopen table");
+    CHECK(table_create_index_using(table, "by_id", TABLE_INDEX_ART, id_key, NULL),
+          "rebuild ART index");
+    for (uint32_t id = 0; id < NUM_ROWS * 10; id += 37)
+        CHECK(find_row(table, table_find_index(table, "by_id"), id, &row), "rebuilt ART lookup");
+    table_close(table);
+
+    remove(path);
+    remove("./test_table_methods.db.by_counter");
+
+    table = table_open_clustered(pool, path, pk_key, NULL);
+    CHECK(table, "open clustered table");
+    CHECK(!table_create_index_using(table, "by_id", TABLE_INDEX_ART, id_key, NULL),
+          "index-organized tables take B+tree indexes only");
+    table_close(table);
+    remove(path);
+    return true;
+}
+
+/* B+tree and hash indexes are reattached from their files after a reopen, not rebuilt */
+static bool test_reopen_indexes(buffer_pool_t* pool) {
+    printf("  persistent indexes across a reopen\n");
+
+    const char* path = "./test_table_reopen.db";
+    remove(path);
+    remove("./test_table_reopen.db.by_id");
+    remove("./test_table_reopen.db.by_counter");
+
+    table_t* table = table_open(pool, path);
+    CHECK(table, "open table");
+    for (uint32_t i = 0; i < NUM_ROWS * 5; i++) {
+        test_row_t row = {i, i % 50, {0}};
+        CHECK(table_insert(table, &row, sizeof(row), 1, NULL), "insert row");
+    }
+    CHECK(table_create_index_using(table, "by_id", TABLE_INDEX_BTREE, id_key, NULL),
+          "create B+tree index");
+    CHECK(table_create_index_using(table, "by_counter", TABLE_INDEX_HASH, counter_key, NULL),
+          "create hash index");
+    table_close(table);
+
+    table = table_open(pool, path);
+    CHECK(table, "reopen table");
+    CHECK(table_create_index_using(table, "by_id", TABLE_INDEX_BTREE, id_key, NULL),
+          "reattach B+tree index");
+    CHECK(table_create_index_using(table, "by_counter", TABLE_INDEX_HASH, counter_key, NULL),
+          "reattach hash index");
+    table_stats_t stats;
+    table_get_stats(table, &stats);
+    CHECK(stats.index_loaded == 0 && stats.index_inserts == 0, "index is not rebuilt");
+    for (uint32_t id = 0; id < NUM_ROWS * 5; id += 7) {
+        uint32_t count = 0;
+        CHECK(table_lookup(table, "by_id", &id, sizeof(id), count_row, &count) && count == 1,
+              "lookup in the reattached B+tree index");
+    }
+    for (uint32_t counter = 0; counter < 50; counter += 7) {
+        uint32_t count = 0;
+        CHECK(table_lookup(table, "by_counter", &counter, sizeof(counter), count_row, &count) &&
+                  count == NUM_ROWS / 10,
+              "lookup in the reattached hash index");
+    }
+
+    /* The reattached index takes changes, and keeps them across the next reopen */
+    test_row_t row = {NUM_ROWS * 5, 0, {0}};
+    CHECK(table_insert(table, &row, sizeof(row), 2, NULL), "insert after the reopen");
+    table_close(table);
+    table = table_open(pool, path);
+    CHECK(table && table_create_index(table, "by_id", id_key, NULL), "reattach again");
+    CHECK(table_create_index_using(table, "by_counter", TABLE_INDEX_HASH, counter_key, NULL),
+          "reattach hash index again");
+    uint32_t id = NUM_ROWS * 5, counter = 0, count = 0;
+    CHECK(table_lookup(table, "by_id", &id, sizeof(id), count_row, &count) && count == 1,
+          "row inserted after the reopen");
+    count = 0;
+    CHECK(table_lookup(table, "by_counter", &counter, sizeof(counter), count_row, &count) &&
+              count == NUM_ROWS / 10 + 1,
+          "hash entry of the row inserted after the reopen");
+    table_close(table);
+
+    remove(path);
+    remove("./test_table_reopen.db.by_id");
+    remove("./test_table_reopen.db.by_counter");
+    return true;
+}
+
+/* Sums the INCLUDE payloads (row ids) an index-only lookup returns */
+static bool sum_payload(tuple_id_t tid, const void* data, uint16_t len, void* arg) {
+    (void)tid;
+    uint32_t id;
+    if (len != sizeof(id))
+        return false;
+    memcpy(&id, data, sizeof(id));
+    *(uint32_t*)arg += id;
+    return true;
+}
+
+/* Covering lookups skip the heap for rows on all-visible pages only */
+static bool test_index_only(buffer_pool_t* pool) {
+    printf("  covering indexes and index-only lookups\n");
+
+    const char* path = "./test_table_covering.db";
+    const char* files[] = {"./test_table_covering.db.by_counter", "./test_table_covering.db.vm"};
+    remove(path);
+    for (int i = 0; i < 2; i++)
+        remove(files[i]);
+
+    table_t* table = table_open(pool, path);
+    CHECK(table, "open table");
+    for (uint32_t i = 0; i < NUM_ROWS; i++) {
+        test_row_t row = {i, i % 10, {0}};
+        CHECK(table_insert(table, &row, sizeof(row), 1, &tids[i]), "insert row");
+    }
+    table_index_def_t def = {"by_counter", TABLE_INDEX_BTREE, counter_key, NULL, id_key, NULL,
+                             NULL,         NULL};
+    CHECK(table_create_index_def(table, &def), "create covering index");
+    CHECK(index_is_covering(table_find_index(table, "by_counter")), "index carries INCLUDE");
+
+    /* Rows with counter 3 have ids 3, 13, ..., 193 */
+    table_explain_t explain;
+    uint32_t        counter = 3, sum = 0;
+    CHECK(table_index_only_lookup(table, "by_counter", &counter, sizeof(counter), sum_payload,
+                                  &sum, &explain),
+          "index-only lookup");
+    CHECK(sum == 1960 && explain.rows == 20 && explain.covering, "payloads come from the index");
+    CHECK(explain.heap_fetches == 20 && explain.fetches_avoided == 0,
+          "rows are checked in the heap before a vacuum");
+
+    heap_vacuum_stats_t vacuum;
+    CHECK(table_vacuum(table, &vacuum) && vacuum.all_visible == vacuum.pages, "vacuum table");
+    sum = 0;
+    CHECK(table_index_only_lookup(table, "by_counter", &counter, sizeof(counter), sum_payload,
+                                  &sum, &explain) &&
+              sum == 1960,
+          "lookup after vacuum");
+    CHECK(explain.heap_fetches == 0 && explain.fetches_avoided == 20,
+          "all-visible pages are not read");
+
+    /* Changing an INCLUDE column updates the index entry, so it cannot be heap-only */
+    table_stats_t before, after;
+    table_get_stats(table, &before);
+    test_row_t row = {1003, 3, {0}};
+    CHECK(table_update(table, tids[3], &row, sizeof(row), 2, NULL), "update row");
+    table_get_stats(table, &after);
+    CHECK(after.hot_updates == before.hot_updates, "INCLUDE change is not a HOT update");
+    CHECK(table_delete(table, tids[13], 3), "delete row");
+
+    sum = 0;
+    CHECK(table_index_only_lookup(table, "by_counter", &counter, sizeof(counter), sum_payload,
+                                  &sum, &explain),
+          "lookup after changes");
+    CHECK(sum == 1960 - 3 + 1003 - 13 && explain.rows == 19, "index returns the live rows");
+    CHECK(explain.heap_fetches > 0 && explain.fetches_avoided > 0,
+          "changed pages are checked in the heap again");
+
+    char line[128];
+    table_explain_format(&explain, line, sizeof(line));
+    CHECK(strstr(line, "Index Only Scan using by_counter (covering)") &&
+              strstr(line, "heap_fetches_avoided="),
+          "EXPLAIN reports heap fetches avoided");
+
+    table_get_stats(table, &after);
+    CHECK(after.fetches_avoided >= 20 + explain.fetches_avoided, "table stats count lookups");
+
+    /* INCLUDE needs a B+tree index on a heap table */
+    def = (table_index_def_t){"by_id", TABLE_INDEX_ART, id_key, NULL, counter_key, NULL, NULL,
+                              NULL};
+    CHECK(!table_create_index_def(table, &def), "ART index takes no INCLUDE columns");
+    def.method = TABLE_INDEX_HASH;
+    CHECK(!table_create_index_def(table, &def), "hash index takes no INCLUDE columns");
+    table_close(table);
+    remove(path);
+    for (int i = 0; i < 2; i++)
+        remove(files[i]);
+
+    table = table_open_clustered(pool, path, pk_key, NULL);
+    CHECK(table, "open clustered table");
+    def.method = TABLE_INDEX_BTREE;
+    CHECK(!table_create_index_def(table, &def), "index-organized tables take no INCLUDE columns");
+    table_close(table);
+    remove(path);
+    return true;
+}
+
+/* Partial index predicate: rows with counter 0 are the "active" ones */
+static bool is_active(const void* tuple, uint16_t len, void* arg) {
+    (void)arg;
+    return len >= sizeof(test_row_t) && ((const test_row_t*)tuple)->counter == 0;
+}
+
+/* Expression key: the lower-cased name kept in the filler */
+static bool lower_name(const void* tuple, uint16_t len, void* key, uint16_t* key_len,
+                       void* arg) {
+    (void)arg;
+    if (len < sizeof(test_row_t))
+        return false;
+    const char* name = ((const test_row_t*)tuple)->filler;
+    uint16_t    n    = 0;
+    while (n < sizeof(((test_row_t*)0)->filler) && name[n]) {
+        ((char*)key)[n] = (char)(name[n] >= 'A' && name[n] <= 'Z' ? name[n] + 32 : name[n]);
+        n++;
+    }
+    *key_len = n;
+    return true;
+}
+
+/* Run a query; returns the number of rows and the EXPLAIN line */
+static uint32_t select_rows(table_t* table, const table_query_t* query, char* line) {
+    table_explain_t explain;
+    uint32_t        count = 0;
+    if (!table_select(table, query, count_row, &count, &explain))
+        return UINT32_MAX;
+    table_explain_format(&explain, line, 128);
+    return explain.rows == count ? count : UINT32_MAX;
+}
+
+/* Partial indexes hold only matching rows; queries use them when their conditions imply it */
+static bool test_partial_indexes(buffer_pool_t* pool) {
+    printf("  partial and expression indexes\n");
+
+    const char* path    = "./test_table_partial.db";
+    const char* files[] = {"./test_table_partial.db.active_by_id", "./test_table_partial.db.by_id",
+                           "./test_table_partial.db.by_name"};
+    remove(path);
+    for (int i = 0; i < 3; i++)
+        remove(files[i]);
+
+    table_t* table = table_open(pool, path);
+    CHECK(table, "open table");
+    for (uint32_t i = 0; i < NUM_ROWS; i++) {
+        test_row_t row = {i, i % 4, {0}};
+        snprintf(row.filler, sizeof(row.filler), "User%u", i);
+        CHECK(table_insert(table, &row, sizeof(row), 1, &tids[i]), "insert row");
+    }
+
+    table_index_def_t def = {"active_by_id", TABLE_INDEX_BTREE, id_key, NULL,
+                             NULL,           NULL,              is_active, NULL};
+    CHECK(table_create_index_def(table, &def), "create partial index");
+    def = (table_index_def_t){"by_name", TABLE_INDEX_HASH, lower_name, NULL, NULL, NULL, NULL,
+                              NULL};
+    CHECK(table_create_index_def(table, &def), "create expression index");
+
+    table_stats_t before, after;
+    table_get_stats(table, &before);
+    CHECK(before.index_loaded == NUM_ROWS / 4, "partial index holds the active rows only");
+
+    /* A query whose conditions include the predicate uses the partial index */
+    index_predicate_t active = {is_active, NULL};
+    uint32_t          id     = 8;
+    char              line[128];
+    table_query_t     query = {id_key, NULL, &id, sizeof(id), &active, 1, NULL};
+    CHECK(select_rows(table, &query, line) == 1 &&
+              strcmp(line, "Index Scan using active_by_id (partial) (rows=1)") == 0,
+          "partial index serves an implied query");
+    id = 9;
+    CHECK(select_rows(table, &query, line) == 0, "inactive row is not returned");
+
+    /* Without the condition the partial index would miss rows */
+    query.num_conditions = 0;
+    CHECK(select_rows(table, &query, line) == 1 && strcmp(line, "Seq Scan (rows=1)") == 0,
+          "query without the predicate scans the table");
+
+    /* The expression index serves queries on the same expression */
+    char          name[] = "user12";
+    table_query_t by_name = {lower_name, NULL, name, 6, NULL, 0, NULL};
+    CHECK(select_rows(table, &by_name, line) == 1 &&
+              strcmp(line, "Index Scan using by_name (rows=1)") == 0,
+          "expression index serves its expression");
+
+    /* With a full index too, the partial one is still preferred when it applies */
+    CHECK(table_create_index(table, "by_id", id_key, NULL), "create full index");
+    CHECK(select_rows(table, &query, line) == 1 &&
+              strcmp(line, "Index Scan using by_id (rows=1)") == 0,
+          "full index serves the unconditioned query");
+    query.num_conditions = 1;
+    id                   = 12;
+    CHECK(select_rows(table, &query, line) == 1 && strstr(line, "active_by_id (partial)"),
+          "partial index preferred over the full one");
+
+    /* Rows move in and out of the partial index as the predicate changes */
+    test_row_t row = {12, 1, {0}};
+    snprintf(row.filler, sizeof(row.filler), "User12");
+    CHECK(table_update(table, tids[12], &row, sizeof(row), 2, &tids[12]), "deactivate row");
+    CHECK(select_rows(table, &query, line) == 0, "deactivated row leaves the partial index");
+    row = (test_row_t){13, 0, {0}};
+    snprintf(row.filler, sizeof(row.filler), "User13");
+    CHECK(table_update(table, tids[13], &row, sizeof(row), 2, &tids[13]), "activate row");
+    id = 13;
+    CHECK(select_rows(table, &query, line) == 1, "activated row enters the partial index");
+
+    /* Changes among rows outside the partial index leave its entries alone */
+    table_get_stats(table, &before);
+    row = (test_row_t){14, 3, {0}};
+    snprintf(row.filler, sizeof(row.filler), "User14");
+    CHECK(table_update(table, tids[14], &row, sizeof(row), 3, NULL), "update inactive row");
+    table_get_stats(table, &after);
+    CHECK(after.hot_updates == before.hot_updates + 1, "update stays heap-only");
+
+    table_close(table);
+    remove(path);
+    for (int i = 0; i < 3; i++)
+        remove(files[i]);
+
+    /* Secondary indexes of index-organized tables can be partial too */
+    table = table_open_clustered(pool, path, pk_key, NULL);
+    CHECK(table, "open clustered table");
+    for (uint32_t i = 0; i < NUM_ROWS; i++) {
+        test_row_t r = {i, i % 4, {0}};
+        CHECK(table_insert(table, &r, sizeof(r), 1, NULL), "insert row");
+    }
+    def = (table_index_def_t){"active_by_id", TABLE_INDEX_BTREE, id_key, NULL, NULL, NULL,
+                              is_active,      NULL};
+    CHECK(table_create_index_def(table, &def), "create partial secondary index");
+    id = 40;
+    CHECK(select_rows(table, &query, line) == 1 && strstr(line, "active_by_id (partial)"),
+          "partial secondary index serves the query");
+
+    uint8_t  pk[4];
+    uint16_t pk_len;
+    row = (test_row_t){40, 1, {0}};
+    pk_key(&row, sizeof(row), pk, &pk_len, NULL);
+    CHECK(table_update_key(table, pk, pk_len, &row, sizeof(row), 2), "deactivate row");
+    CHECK(select_rows(table, &query, line) == 0, "deactivated row leaves the secondary index");
+    query.num_conditions = 0;
+    CHECK(select_rows(table, &query, line) == 1 && strcmp(line, "Seq Scan (rows=1)") == 0,
+          "clustered table falls back to a full scan");
+
+    table_close(table);
+    remove(path);
+    remove(files[0]);
+    return true;
+}
+
+/* Writers and rows per writer of the concurrent build test */
+#define BUILD_WRITERS 4
+#define BUILD_ROWS    1000
+
+/**
+ * Writer of the concurrent build test; each owns its own rows
+ */
+typedef struct {
+    table_t*          table;
+    uint32_t          id;
+    tuple_id_t        tids[BUILD_ROWS];
+    test_row_t        rows[BUILD_ROWS];
+    _Atomic uint32_t* ops;
+    atomic_bool*      stop;
+    bool              ok;
+} build_writer_t;
+
+/* Bump counters, and every seventh change replace the row by a new one */
+static void* build_writer_main(void* arg) {
+    build_writer_t* w = (build_writer_t*)arg;
+
+    w->ok = true;
+    for (uint32_t k = 0; w->ok && !atomic_load(w->stop); k++) {
+        uint32_t    j   = k % BUILD_ROWS;
+        test_row_t* row = &w->rows[j];
+        row->counter    = (row->counter + 1) % 16;
+        if (k % 7 == 0) {
+            row->id += BUILD_WRITERS * BUILD_ROWS;
+            w->ok = table_delete(w->table, w->tids[j], 2) &&
+                    table_insert(w->table, row, sizeof(*row), 2, &w->tids[j]);
+        } else {
+            w->ok = table_update(w->table, w->tids[j], row, sizeof(*row), 2, &w->tids[j]);
+        }
+        atomic_fetch_add(w->ops, 1);
+    }
+    return NULL;
+}
+
+/**
+ * Key extractor of the index built concurrently. The first call, made by
+ * the build's scan or by the first writer to log a change, waits for the
+ * writers to make more changes, so the side log is sure to have work.
+ */
+typedef struct {
+    _Atomic uint32_t* ops;
+    atomic_bool       waited;
+} build_hook_t;
+
+static bool hooked_counter_key(const void* tuple, uint16_t len, void* key, uint16_t* key_len,
+                               void* arg) {
+    build_hook_t* hook = (build_hook_t*)arg;
+    if (!atomic_exchange(&hook->waited, true)) {
+        uint32_t target = atomic_load(hook->ops) + 500;
+        for (uint32_t i = 0; i < 1000 && atomic_load(hook->ops) < target; i++)
+            sync_sleep_ms(1);
+    }
+    return counter_key(tuple, len, key, key_len, NULL);
+}
+
+static bool count_tid(tuple_id_t tid, void* arg) {
+    (void)tid;
+    (*(uint32_t*)arg)++;
+    return true;
+}
+
+/* Repeated full scans of an expression earn a proposed index; unused indexes a proposed drop */
+static bool test_index_advice(buffer_pool_t* pool) {
+    printf("  index usage statistics and advice\n");
+
+    const char* path = "./test_table_advice.db";
+    const char* files[] = {"./test_table_advice.db.by_counter", "./test_table_advice.db.by_id"};
+    remove(path);
+    for (int i = 0; i < 2; i++)
+        remove(files[i]);
+
+    table_t* table = table_open(pool, path);
+    CHECK(table, "open table");
+    for (uint32_t i = 0; i < NUM_ROWS * 10; i++) {
+        test_row_t row = {i, i % 50, {0}};
+        CHECK(table_insert(table, &row, sizeof(row), 1, NULL), "insert row");
+    }
+    CHECK(table_create_index_using(table, "by_counter", TABLE_INDEX_HASH, counter_key, NULL),
+          "create hash index");
+
+    uint32_t      id    = 0;
+    char          line[128];
+    table_query_t query = {id_key, NULL, &id, sizeof(id), NULL, 0, "id"};
+    for (id = 0; id < 20; id++)
+        CHECK(select_rows(table, &query, line) == 1 && strcmp(line, "Seq Scan (rows=1)") == 0,
+              "query scans the table");
+
+    table_advice_t advice[4];
+    uint32_t       count = table_index_advice(table, advice, 4);
+    CHECK(count == 2 && advice[0].kind == TABLE_ADVICE_CREATE && advice[0].expr == id_key &&
+              advice[0].queries == 20 && advice[0].benefit > 0,
+          "index on the scanned expression is proposed");
+    CHECK(advice[0].saved == 20 * (NUM_ROWS * 10 - 8.0) && advice[0].upkeep == NUM_ROWS * 40.0,
+          "benefit follows the cost model");
+    CHECK(table_advice_format(&advice[0], line, sizeof(line)) > 0 &&
+              strncmp(line, "CREATE INDEX ON id (queries=20 ", 31) == 0,
+          "creation advice line");
+    CHECK(advice[1].kind == TABLE_ADVICE_DROP && strcmp(advice[1].index, "by_counter") == 0 &&
+              advice[1].queries == 0 && advice[1].benefit == advice[1].upkeep,
+          "unused index is proposed for dropping");
+    CHECK(table_advice_format(&advice[1], line, sizeof(line)) > 0 &&
+              strncmp(line, "DROP INDEX by_counter (queries=0 ", 33) == 0,
+          "drop advice line");
+
+    /* Once the index exists the queries use it, and it pays for itself */
+    CHECK(table_create_index(table, "by_id", id_key, NULL), "create advised index");
+    for (id = 0; id < 20; id++)
+        CHECK(select_rows(table, &query, line) == 1 &&
+                  strcmp(line, "Index Scan using by_id (rows=1)") == 0,
+              "query uses the new index");
+    index_stats_t stats;
+    index_get_stats(table_find_index(table, "by_id"), &stats);
+    CHECK(stats.lookups == 20 && stats.tuples == 20, "index counts its scans and tuples");
+    count = table_index_advice(table, advice, 4);
+    CHECK(count == 1 && advice[0].kind == TABLE_ADVICE_DROP &&
+              strcmp(advice[0].index, "by_counter") == 0,
+          "used index is kept and nothing more is proposed");
+
+    table_shape_stats_t shapes[TABLE_MAX_QUERY_SHAPES];
+    CHECK(table_get_query_shapes(table, shapes, TABLE_MAX_QUERY_SHAPES) == 1 &&
+              shapes[0].calls == 40 && shapes[0].index_scans == 20 && shapes[0].rows == 40 &&
+              shapes[0].examined == 20 * NUM_ROWS * 10 + 20 &&
+              strcmp(shapes[0].expr_name, "id") == 0,
+          "one shape gathers the queries");
+
+    table_close(table);
+    remove(path);
+    for (int i = 0; i < 2; i++)
+        remove(files[i]);
+    return true;
+}
+
+/* An index built while writers change rows ends up with exactly the live rows' entries */
+static bool test_concurrent_build(buffer_pool_t* pool) {
+    printf("  concurrent index build\n");
+
+    const char* path       = "./test_table_online.db";
+    const char* index_path = "./test_table_online.db.by_counter";
+    remove(path);
+    remove(index_path);
+
+    table_t* table = table_open(pool, path);
+    CHECK(table && table_create_index(table, "by_id", id_key, NULL), "open table");
+
+    static build_writer_t writers[BUILD_WRITERS];
+    _Atomic uint32_t      ops  = 0;
+    atomic_bool           stop = false;
+    for (uint32_t t = 0; t < BUILD_WRITERS; t++) {
+        build_writer_t* w = &writers[t];
+        *w                = (build_writer_t){table, t, {{0, 0}}, {{0, 0, {0}}}, &ops, &stop, false};
+        for (uint32_t j = 0; j < BUILD_ROWS; j++) {
+            w->rows[j] = (test_row_t){t * BUILD_ROWS + j, j % 16, {0}};
+            CHECK(table_insert(table, &w->rows[j], sizeof(test_row_t), 1, &w->tids[j]),
+                  "insert row");
+        }
+    }
+
+    sync_thread_t threads[BUILD_WRITERS];
+    for (uint32_t t = 0; t < BUILD_WRITERS; t++)
+        CHECK(sync_thread_create(&threads[t], build_writer_main, &writers[t]), "start writer");
+
+    build_hook_t      hook = {&ops, false};
+    table_index_def_t def  = {"by_counter", TABLE_INDEX_BTREE, hooked_counter_key, &hook, NULL,
+                              NULL,         NULL,              NULL};
+    bool              built = table_create_index_concurrently(table, &def);
+
+    /* Writers keep going after the switch, now maintaining the new index directly */
+    uint32_t after_switch = atomic_load(&ops) + 200;
+    for (uint32_t i = 0; i < 1000 && atomic_load(&ops) < after_switch; i++)
+        sync_sleep_ms(1);
+    atomic_store(&stop, true);
+    for (uint32_t t = 0; t < BUILD_WRITERS; t++)
+        sync_thread_join(threads[t]);
+    for (uint32_t t = 0; t < BUILD_WRITERS; t++)
+        CHECK(writers[t].ok, "writers succeed throughout the build");
+    CHECK(built, "concurrent build");
+
+    table_stats_t stats;
+    table_get_stats(table, &stats);
+    CHECK(stats.side_log_merged > 0, "changes made during the build came through the side log");
+
+    /* Every live row has exactly one entry under its current counter, and nothing else */
+    uint32_t expected[16] = {0};
+    for (uint32_t t = 0; t < BUILD_WRITERS; t++) {
+        for (uint32_t j = 0; j < BUILD_ROWS; j++)
+            expected[writers[t].rows[j].counter]++;
+    }
+    index_t* index = table_find_index(table, "by_counter");
+    CHECK(index, "index is attached");
+    for (uint32_t c = 0; c < 16; c++) {
+        uint32_t entries = 0, rows = 0;
+        CHECK(index_lookup(index, &c, sizeof(c), count_tid, &entries), "raw lookup");
+        CHECK(table_lookup(table, "by_counter", &c, sizeof(c), count_row, &rows), "lookup");
+        CHECK(entries == expected[c] && rows == expected[c], "index matches the live rows");
+    }
+
+    def.name   = "by_counter2";
+    def.method = TABLE_INDEX_HASH;
+    CHECK(!table_create_index_concurrently(table, &def), "only B+tree indexes build online");
+    def.name   = "by_counter";
+    def.method = TABLE_INDEX_BTREE;
+    CHECK(!table_create_index_concurrently(table, &def), "index names stay unique");
+
+    table_close(table);
+    remove(path);
+    remove(index_path);
+    remove("./test_table_online.db.by_id");
+    return true;
+}
+
+static const tier_layout_t row_layout = {
+    sizeof(test_row_t),
+    3,
+    {{0, 4, TIER_COLUMN_UINT}, {4, 4, TIER_COLUMN_UINT}, {8, 56, TIER_COLUMN_BYTES}}};
+
+/* Rows below the threshold id are cold */
+static bool below_id(const void* data, uint16_t len, void* arg) {
+    (void)len;
+    return ((const test_row_t*)data)->id < *(const uint32_t*)arg;
+}
+
+/* Count the rows of a table scan and how many came from tier segments */
+static bool count_scan(table_t* table, const tier_filter_t* filter, uint32_t* rows,
+                       uint32_t* tiered) {
+    table_scan_t* scan = table_scan_begin(table, filter);
+    CHECK(scan, "begin table scan");
+
+    tuple_id_t  tid;
+    const void* data;
+    uint16_t    len;
+    *rows = *tiered = 0;
+    while (table_scan_next(scan, &tid, &data, &len)) {
+        CHECK(len == sizeof(test_row_t), "scan returns whole rows");
+        (*rows)++;
+        if (tid.page_id == INVALID_TUPLE_ID.page_id)
+            (*tiered)++;
+    }
+    table_scan_end(scan);
+    return true;
+}
+
+/* Cold rows move to segments; scans still see every row, also after a reopen */
+static bool test_tiering(buffer_pool_t* pool) {
+    printf("  tiering cold rows\n");
+
+    const char* path = "./test_table_tier.db";
+    char        files[4][64];
+    snprintf(files[0], sizeof(files[0]), "%s.by_id", path);
+    snprintf(files[1], sizeof(files[1]), "%s.tiers", path);
+    snprintf(files[2], sizeof(files[2]), "%s.tier0", path);
+    snprintf(files[3], sizeof(files[3]), "%s.tier1", path);
+    remove(path);
+    for (int i = 0; i < 4; i++)
+        remove(files[i]);
+
+    table_t* table = table_open(pool, path);
+    CHECK(table && table_create_index(table, "by_id", id_key, NULL), "open table");
+    for (uint32_t i = 0; i < 3000; i++) {
+        test_row_t row = {i, i % 7, {0}};
+        CHECK(table_insert(table, &row, sizeof(row), 1, NULL), "insert row");
+    }
+
+    uint32_t            threshold = 2000;
+    table_tier_policy_t policy    = {row_layout, below_id, &threshold, 100, 10, 2};
+    uint64_t            moved;
+    CHECK(!table_tier(table, &moved), "tiering needs a policy");
+    CHECK(table_set_tier_policy(table, &policy), "set policy");
+    CHECK(table_tier(table, &moved) && moved == 2000, "pass moves the cold rows");
+
+    uint32_t rows, tiered;
+    CHECK(count_scan(table, NULL, &rows, &tiered), "scan");
+    CHECK(rows == 3000 && tiered == 2000, "scan unions hot and tiered rows");
+
+    uint32_t   id    = 5;
+    test_row_t found = {UINT32_MAX, 0, {0}};
+    CHECK(table_lookup(table, "by_id", &id, sizeof(id), collect_row, &found) &&
+              found.id == UINT32_MAX,
+          "tiered rows leave the indexes");
+
+    /* Queries on the indexed expression scan instead, finding tiered and hot rows alike */
+    char          line[128];
+    table_query_t query = {id_key, NULL, &id, sizeof(id), NULL, 0, NULL};
+    CHECK(select_rows(table, &query, line) == 1 && strcmp(line, "Seq Scan (rows=1)") == 0,
+          "query finds a tiered row");
+    id = 2500;
+    CHECK(select_rows(table, &query, line) == 1 && strcmp(line, "Seq Scan (rows=1)") == 0,
+          "query finds a hot row");
+
+    tier_filter_t filter = {0, 1500, 2499};
+    CHECK(count_scan(table, &filter, &rows, &tiered), "filtered scan");
+    CHECK(rows == 1000 && tiered == 500, "filter applies to hot and tiered rows");
+
+    tier_segment_stats_t stats;
+    CHECK(table_get_tier_stats(table, &stats), "tier stats");
+    CHECK(stats.blocks_skipped == 1 && stats.file_size < stats.raw_size / 4,
+          "zone maps skip blocks of a compressed segment");
+
+    /* Too few cold rows: nothing is written */
+    threshold = 2050;
+    CHECK(table_tier(table, &moved) && moved == 0, "small batch stays hot");
+
+    /* The background thread picks up rows that turn cold later */
+    threshold = 2500;
+    CHECK(table_start_tiering(table) && !table_start_tiering(table), "start background tiering");
+    table_stats_t table_stats;
+    for (int i = 0; i < 500; i++) {
+        table_get_stats(table, &table_stats);
+        if (table_stats.tiered_rows == 2500)
+            break;
+        sync_sleep_ms(10);
+    }
+    table_stop_tiering(table);
+    CHECK(table_stats.tiered_rows == 2500 && table_stats.segments == 2,
+          "background pass moves the new cold rows");
+    table_close(table);
+
+    /* Published segments are found again */
+    table = table_open(pool, path);
+    CHECK(table, "reopen table");
+    CHECK(count_scan(table, NULL, &rows, &tiered), "scan after reopen");
+    CHECK(rows == 3000 && tiered == 2500, "segments survive a reopen");
+
+    tier_layout_t other = row_layout;
+    other.columns[1].type = TIER_COLUMN_INT;
+    policy.layout         = other;
+    CHECK(!table_set_tier_policy(table, &policy), "policy must match existing segments");
+
+    table_close(table);
+    remove(path);
+    for (int i = 0; i < 4; i++)
+        remove(files[i]);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB Table Test - Starting up...\n");
+
+    const char* path = "./test_table.db";
+    remove(path);
+
+    static mock_index_t mock;
+    buffer_pool_t*      pool  = buffer_pool_create(64);
+    table_t*            table = pool ? table_open(pool, path) : NULL;
+    index_t*            index = NULL;
+    if (!table) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return 1;
+    }
+
+    bool ok = test_build_and_insert(table, &mock, &index) &&
+              test_hot_updates(table, &mock, index) && test_cold_updates(table, &mock, index) &&
+              test_clustered(pool) && test_sorted_build(pool) && test_index_methods(pool) &&
+              test_reopen_indexes(pool) && test_index_only(pool) && test_partial_indexes(pool) &&
+              test_index_advice(pool) && test_concurrent_build(pool) && test_tiering(pool);
+
+    table_close(table);
+    buffer_pool_destroy(pool);
+    remove(path);
+
+    if (!ok)
+        return 1;
+
+    printf("\nTable test completed successfully\n");
+    return 0;
+}
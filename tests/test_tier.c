@@ -0,0 +1,207 @@
+/**
+ * @file test_tier.c
+ * @brief Tests for tier segment files
+ */
+
+#include <monodb/core/storage/tier.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                      \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", msg, __FILE__, __LINE__); \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+/* Enough rows for several full blocks and a partial one */
+#define NUM_ROWS (TIER_BLOCK_ROWS * 3 + 100)
+
+/**
+ * Test row: a time-ordered reading
+ */
+typedef struct {
+    uint32_t ts;
+    int32_t  delta;
+    uint64_t value;
+    char     label[16];
+} test_row_t;
+
+static const tier_layout_t layout = {
+    sizeof(test_row_t),
+    4,
+    {{0, 4, TIER_COLUMN_UINT},
+     {4, 4, TIER_COLUMN_INT},
+     {8, 8, TIER_COLUMN_UINT},
+     {16, 16, TIER_COLUMN_BYTES}}};
+
+static void make_row(test_row_t* row, uint32_t i) {
+    memset(row, 0, sizeof(*row));
+    row->ts    = 1000000 + i;
+    row->delta = (int32_t)i - NUM_ROWS / 2;
+    row->value = (uint64_t)i * 2654435761u;
+    snprintf(row->label, sizeof(row->label), "sensor-%u", i % 4);
+}
+
+/* Rows come back unchanged and in order; the file is smaller than the rows */
+static bool test_roundtrip(const char* path) {
+    printf("  write and read back\n");
+
+    tier_writer_t* writer = tier_writer_create(path, &layout);
+    CHECK(writer, "create writer");
+    for (uint32_t i = 0; i < NUM_ROWS; i++) {
+        test_row_t row;
+        make_row(&row, i);
+        CHECK(tier_writer_append(writer, &row), "append row");
+    }
+    CHECK(tier_writer_rows(writer) == NUM_ROWS, "writer counts rows");
+    CHECK(tier_writer_finish(writer), "finish segment");
+
+    tier_segment_t* segment = tier_segment_open(path);
+    CHECK(segment, "open segment");
+
+    tier_scan_t* scan = tier_scan_begin(segment, NULL);
+    CHECK(scan, "begin scan");
+    const void* data;
+    uint32_t    count = 0;
+    while (tier_scan_next(scan, &data)) {
+        test_row_t row;
+        make_row(&row, count);
+        CHECK(memcmp(data, &row, sizeof(row)) == 0, "row matches what was written");
+        count++;
+    }
+    tier_scan_end(scan);
+    CHECK(count == NUM_ROWS, "scan returns every row");
+
+    tier_segment_stats_t stats;
+    CHECK(tier_segment_get_stats(segment, &stats), "segment stats");
+    CHECK(stats.rows == NUM_ROWS && stats.blocks == 4, "segment holds every block");
+    CHECK(stats.file_size * 2 < stats.raw_size, "segment is compressed");
+
+    /* Integer columns decode straight into vectors, signed ones sign-extended */
+    uint64_t values[TIER_BLOCK_ROWS];
+    CHECK(tier_segment_read_column(segment, 3, 1, values) == 100, "last block is partial");
+    for (uint32_t i = 0; i < 100; i++) {
+        test_row_t row;
+        make_row(&row, TIER_BLOCK_ROWS * 3 + i);
+        CHECK((int64_t)values[i] == row.delta, "column vector matches the rows");
+    }
+    CHECK(tier_segment_read_column(segment, 0, 2, values) == TIER_BLOCK_ROWS &&
+              values[7] == 7ull * 2654435761u,
+          "unsigned column vector");
+    CHECK(!tier_segment_read_column(segment, 0, 3, values) &&
+              !tier_segment_read_column(segment, 4, 0, values),
+          "byte columns and missing blocks are refused");
+
+    tier_segment_close(segment);
+    return true;
+}
+
+/* Range filters skip blocks by their zone maps and compare signed columns as signed */
+static bool test_filters(const char* path) {
+    printf("  zone map filters\n");
+
+    tier_segment_t* segment = tier_segment_open(path);
+    CHECK(segment, "open segment");
+
+    tier_filter_t filter = {0, 1000000 + TIER_BLOCK_ROWS + 10, 1000000 + TIER_BLOCK_ROWS + 19};
+    tier_scan_t*  scan   = tier_scan_begin(segment, &filter);
+    CHECK(scan, "begin filtered scan");
+    const void* data;
+    uint32_t    count = 0;
+    while (tier_scan_next(scan, &data))
+        count++;
+    tier_scan_end(scan);
+    CHECK(count == 10, "filtered scan returns the range");
+
+    tier_segment_stats_t stats;
+    tier_segment_get_stats(segment, &stats);
+    CHECK(stats.blocks_read == 1 && stats.blocks_skipped == 3, "other blocks are skipped");
+
+    /* Negative bounds on the signed column */
+    filter = (tier_filter_t){1, (uint64_t)(int64_t)-5, (uint64_t)(int64_t)4};
+    scan   = tier_scan_begin(segment, &filter);
+    count  = 0;
+    while (tier_scan_next(scan, &data)) {
+        CHECK(((const test_row_t*)data)->delta >= -5 && ((const test_row_t*)data)->delta <= 4,
+              "signed filter bounds");
+        count++;
+    }
+    tier_scan_end(scan);
+    CHECK(count == 10, "signed filter returns the range");
+
+    /* Every zone map admits this range, but no value lies in it: the compressed column rules
+     * out each block without decoding it */
+    tier_segment_get_stats(segment, &stats);
+    uint64_t read = stats.blocks_read, skipped = stats.blocks_skipped;
+    filter        = (tier_filter_t){2, 1, 2};
+    scan          = tier_scan_begin(segment, &filter);
+    CHECK(scan && !tier_scan_next(scan, &data), "no row in the range");
+    tier_scan_end(scan);
+    tier_segment_get_stats(segment, &stats);
+    CHECK(stats.blocks_read == read && stats.blocks_skipped == skipped + 4,
+          "blocks are ruled out on compressed data");
+
+    filter = (tier_filter_t){3, 0, 1};
+    CHECK(!tier_scan_begin(segment, &filter), "byte columns cannot be filtered");
+
+    tier_segment_close(segment);
+    return true;
+}
+
+/* Damaged files and bad layouts are refused */
+static bool test_invalid(const char* path) {
+    printf("  invalid files and layouts\n");
+
+    tier_layout_t bad = layout;
+    bad.columns[1].size = 3;
+    CHECK(!tier_layout_valid(&bad), "odd integer width is rejected");
+    bad = layout;
+    bad.columns[3].offset = 20;
+    CHECK(!tier_writer_create(path, &bad), "column past the row end is rejected");
+
+    /* Truncate the segment; it must no longer map */
+    FILE* file = fopen(path, "rb");
+    CHECK(file, "open segment file");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* data = (char*)malloc((size_t)size);
+    CHECK(data && fread(data, 1, (size_t)size, file) == (size_t)size, "read segment file");
+    fclose(file);
+
+    file = fopen(path, "wb");
+    CHECK(file, "rewrite segment file");
+    fwrite(data, 1, (size_t)size - 8, file);
+    fclose(file);
+    free(data);
+
+    tier_segment_t* segment = tier_segment_open(path);
+    CHECK(segment && !tier_segment_layout(segment) && !tier_scan_begin(segment, NULL),
+          "truncated segment is rejected");
+    tier_segment_close(segment);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    /* Mark unused parameters */
+    (void)argc;
+    (void)argv;
+
+    printf("MonoDB Tier Test - Starting up...\n");
+
+    const char* path = "./test_tier.seg";
+    remove(path);
+
+    bool ok = test_roundtrip(path) && test_filters(path) && test_invalid(path);
+    remove(path);
+
+    if (!ok)
+        return 1;
+
+    printf("\nTier test completed successfully\n");
+    return 0;
+}
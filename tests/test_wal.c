@@ -17,7 +17,7 @@ int main(int argc, char* argv[]) {
     printf("MonoDB WAL Test - Starting up...\n");
 
     /* WAL configuration */
-    const char* wal_dir      = "./test_wal";
+    const char* wal_dir      = "./test_wal_data";
     uint32_t    segment_size = 16 * 1024 * 1024; /* 16MB segment size */
 
     printf("Initializing WAL system in directory: %s\n", wal_dir);